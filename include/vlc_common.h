@@ -492,6 +492,8 @@ typedef struct update_t update_t;
 #define VLC_EACCES         (-EACCES)
 /** Operation not supported */
 #define VLC_ENOTSUP        (-ENOTSUP)
+/** Not ready yet, try again later */
+#define VLC_EAGAIN         (-EAGAIN)
 
 /** @} */
 
@@ -283,7 +283,41 @@ enum demux_query_e
      * work in future VLC versions, nor with all demux filters
      */
     DEMUX_FILTER_ENABLE,
-    DEMUX_FILTER_DISABLE
+    DEMUX_FILTER_DISABLE,
+
+    /** Statistics of the programs demuxed on their own threads.
+     * arg1= int i_group (-1 for all the programs),
+     * arg2= struct vlc_demux_program_stats * res=can fail */
+    DEMUX_GET_PROGRAM_STATS,
+
+    /** Statistics of adaptive streaming.
+     * arg1= struct vlc_demux_adaptive_stats * res=can fail */
+    DEMUX_GET_ADAPTIVE_STATS
+};
+
+/**
+ * Statistics of the programs demuxed on their own threads
+ * \see DEMUX_GET_PROGRAM_STATS
+ */
+struct vlc_demux_program_stats
+{
+    uint64_t packets; /**< packets demuxed by the program threads */
+    uint64_t bytes; /**< bytes demuxed by the program threads */
+    vlc_tick_t latency; /**< average delay before a packet is demuxed */
+    vlc_tick_t latency_max; /**< worst delay before a packet is demuxed */
+};
+
+/**
+ * Statistics of adaptive streaming
+ * \see DEMUX_GET_ADAPTIVE_STATS
+ */
+struct vlc_demux_adaptive_stats
+{
+    vlc_tick_t live_latency; /**< playback delay behind the live edge */
+    double catchup_rate; /**< playback rate correction to reach the target */
+    unsigned http2_connections; /**< shared HTTP/2 connections established */
+    unsigned http2_failures; /**< origins unreachable or without HTTP/2 */
+    uint64_t http2_requests; /**< requests sent over those connections */
 };
 
 /*************************************************************************
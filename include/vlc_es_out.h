@@ -113,6 +113,11 @@ enum es_out_query_e
     ES_OUT_SPU_SET_HIGHLIGHT, /* arg1= es_out_id_t* (spu es),
                                  arg2= const vlc_spu_highlight_t *, res=can fail  */
 
+    /* Speed up or slow down playback by a small factor, applied on top of the
+     * user rate, to converge on a live latency target. 1.0 resets it.
+     * Fails if the playback is not paced by the clock (timeshift, sout...) */
+    ES_OUT_SET_RATE_CORRECTION, /* arg1=double res=can fail */
+
     /* First value usable for private control */
     ES_OUT_PRIVATE_START = 0x10000,
 };
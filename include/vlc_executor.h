@@ -31,6 +31,24 @@ extern "C" {
 /** Executor type (opaque) */
 typedef struct vlc_executor vlc_executor_t;
 
+struct vlc_executor_queue;
+
+/**
+ * Priority of a runnable.
+ *
+ * Queued runnables of a higher priority are always started before those of a
+ * lower priority, regardless of their submission order. Runnables of the same
+ * priority are started in submission order.
+ */
+enum vlc_executor_priority {
+    /** Background work */
+    VLC_EXECUTOR_PRIORITY_LOW,
+    /** Default priority (see vlc_executor_Submit()) */
+    VLC_EXECUTOR_PRIORITY_NORMAL,
+    /** Work the user is waiting for */
+    VLC_EXECUTOR_PRIORITY_HIGH,
+};
+
 /**
  * A Runnable encapsulates a task to be run from an executor thread.
  */
@@ -60,6 +78,8 @@ struct vlc_runnable {
 
     /* Private data used by the vlc_executor_t (do not touch) */
     struct vlc_list node;
+    struct vlc_executor_queue *queue;
+    enum vlc_executor_priority priority;
 };
 
 /**
@@ -145,6 +165,21 @@ vlc_executor_Delete(vlc_executor_t *executor);
 VLC_API void
 vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable);
 
+/**
+ * Submit a runnable for execution with a given priority.
+ *
+ * This is equivalent to vlc_executor_Submit(), except that the runnable is
+ * started before any queued runnable of a lower priority.
+ *
+ * \param executor the executor
+ * \param runnable the task to run
+ * \param priority the priority of the task
+ */
+VLC_API void
+vlc_executor_SubmitWithPriority(vlc_executor_t *executor,
+                                struct vlc_runnable *runnable,
+                                enum vlc_executor_priority priority);
+
 /**
  * Cancel a runnable previously submitted.
  *
@@ -113,6 +113,14 @@ struct vlc_filter_operations
         /* TODO: video filter drain */
         /** Drain (audio filter) */
         block_t *(*drain_audio)(filter_t *);
+
+        /** Style generation (text renderer)
+         *
+         * Returns a value that changes whenever the settings read on each
+         * rendering change, so that rendered regions can be reused until
+         * then. If NULL, the rendering only depends on the region.
+         */
+        uint64_t (*render_generation)(filter_t *);
     };
 
     /** Flush
@@ -884,6 +884,104 @@ static inline size_t vlc_fifo_Count (vlc_fifo_t *fifo)
     return depth;
 }
 
+/**
+ * @}
+ * \defgroup spsc_fifo Single producer single consumer block FIFO
+ * Lock-free block queue between one producer and one consumer thread
+ *
+ * Queueing and dequeueing never lock. The FIFO does not block either:
+ * the consumer announces that it is about to wait with vlc_spsc_fifo_Park(),
+ * and the producer wakes it up through the caller's own lock and condition
+ * variable, only when vlc_spsc_fifo_Queue() returns true. The consumer thus
+ * takes whole batches of blocks per wake up.
+ *
+ * Several threads may act as the producer, or as the consumer, as long as
+ * the callers serialize them, e.g. with a lock.
+ * @{
+ */
+
+typedef struct vlc_spsc_fifo vlc_spsc_fifo_t;
+
+/**
+ * Creates a single producer single consumer FIFO of blocks.
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API vlc_spsc_fifo_t *vlc_spsc_fifo_New(void) VLC_USED VLC_MALLOC;
+
+/**
+ * Deletes a FIFO created by vlc_spsc_fifo_New().
+ *
+ * @note Any queued blocks are also deleted.
+ * @warning No other threads may be using the FIFO.
+ */
+VLC_API void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *);
+
+/**
+ * Queues one block (producer side).
+ *
+ * @param block block to queue, not a linked-list
+ * @retval true the consumer is parked and must be woken up by the caller
+ * @retval false the consumer will see the block without being woken up
+ */
+VLC_API bool vlc_spsc_fifo_Queue(vlc_spsc_fifo_t *, vlc_frame_t *block) VLC_USED;
+
+/**
+ * Counts the blocks queued since the FIFO creation (producer side).
+ *
+ * The value can be passed to vlc_spsc_fifo_Discard() to drop all blocks
+ * queued so far, as the producer cannot dequeue.
+ */
+VLC_API uint64_t vlc_spsc_fifo_GetMark(const vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Dequeues the first block, if any (consumer side).
+ *
+ * @return the first block or NULL if the FIFO is empty
+ */
+VLC_API vlc_frame_t *vlc_spsc_fifo_Dequeue(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Releases the blocks queued before a mark (consumer side).
+ *
+ * @param mark value of vlc_spsc_fifo_GetMark() at the time the blocks to
+ * discard were all queued
+ */
+VLC_API void vlc_spsc_fifo_Discard(vlc_spsc_fifo_t *, uint64_t mark);
+
+/**
+ * Parks the consumer before it waits (consumer side).
+ *
+ * The consumer must check this function and wait atomically with regards to
+ * the producer wake up, i.e. while holding the lock the producer takes to
+ * signal it. It must call vlc_spsc_fifo_Unpark() once done waiting.
+ *
+ * @retval true the FIFO is empty, the consumer can wait
+ * @retval false blocks were queued, the consumer shall not wait
+ */
+VLC_API bool vlc_spsc_fifo_Park(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Unparks the consumer after it waited (consumer side).
+ */
+VLC_API void vlc_spsc_fifo_Unpark(vlc_spsc_fifo_t *);
+
+/**
+ * Counts blocks in a FIFO.
+ *
+ * This function can be called from any thread. The value may be outdated
+ * as soon as it is returned.
+ */
+VLC_API size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Counts bytes in a FIFO.
+ *
+ * This function can be called from any thread. The value may be outdated
+ * as soon as it is returned.
+ */
+VLC_API size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *) VLC_USED;
+
 /** @} */
 
 /** @} */
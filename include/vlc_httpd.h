@@ -101,6 +101,9 @@ typedef struct httpd_message_t
     int64_t i_body_offset;
     size_t  i_body;
     uint8_t *p_body;
+    /* if not NULL, p_body points into this block, which is released instead
+     * of freeing p_body: the body can then be shared with other answers */
+    block_t *p_body_block;
 
 } httpd_message_t;
 
@@ -113,6 +116,12 @@ VLC_API httpd_url_t * httpd_UrlNew( httpd_host_t *, const char *psz_url, const c
 VLC_API int httpd_UrlCatch( httpd_url_t *, int i_msg, httpd_callback_t, httpd_callback_sys_t * );
 /* delete a url */
 VLC_API void httpd_UrlDelete( httpd_url_t * );
+/* A callback can return VLC_EAGAIN to defer a request it cannot answer yet.
+ * The request is then handled again after httpd_UrlSignal(), or answered with
+ * 503 Service Unavailable after HTTPD_DEFER_TIMEOUT. */
+#define HTTPD_DEFER_TIMEOUT VLC_TICK_FROM_SEC(10)
+/* retry the deferred requests of a url */
+VLC_API void httpd_UrlSignal( httpd_url_t * );
 
 VLC_API char* httpd_ClientIP( const httpd_client_t *cl, char *, int * );
 VLC_API char* httpd_ServerIP( const httpd_client_t *cl, char *, int * );
@@ -537,6 +537,17 @@ struct input_stats_t
     float f_demux_bitrate;
     uint64_t i_demux_corrupted;
     uint64_t i_demux_discontinuity;
+    uint64_t i_demux_program_packets;   /**< Packets demuxed by program threads */
+    uint64_t i_demux_program_bytes;     /**< Bytes demuxed by program threads */
+    vlc_tick_t i_demux_program_latency; /**< Average program thread queuing */
+    vlc_tick_t i_demux_program_latency_max; /**< Worst program thread queuing */
+
+    /* Adaptive streaming */
+    vlc_tick_t i_adaptive_latency; /**< Playback delay behind the live edge */
+    float f_adaptive_rate;         /**< Live latency catch-up rate */
+    uint64_t i_adaptive_http2_connections; /**< Shared HTTP/2 connections */
+    uint64_t i_adaptive_http2_failures; /**< Origins without HTTP/2 */
+    uint64_t i_adaptive_http2_requests; /**< Requests over HTTP/2 */
 
     /* Decoders */
     uint64_t i_decoded_audio;
@@ -546,10 +557,31 @@ struct input_stats_t
     uint64_t i_displayed_pictures;
     uint64_t i_late_pictures;
     uint64_t i_lost_pictures;
+    uint64_t i_spu_cache_hits;          /**< Text regions not rendered again */
+    uint64_t i_spu_cache_misses;        /**< Text regions rendered */
 
     /* Aout */
     uint64_t i_played_abuffers;
     uint64_t i_lost_abuffers;
+
+    /* Prefetch */
+    uint64_t i_prefetch_size;           /**< Current buffer size */
+    uint64_t i_prefetch_hits;           /**< Reads served from the buffer */
+    uint64_t i_prefetch_stalls;         /**< Reads that waited for data */
+    uint64_t i_prefetch_seeks;          /**< Seeks of the source */
+
+    /* Timeshift */
+    uint64_t i_timeshift_size;          /**< Current size of the ring file */
+    uint64_t i_timeshift_fill;          /**< Bytes not played back yet */
+    vlc_tick_t i_timeshift_write_latency; /**< Average page write time */
+    uint64_t i_timeshift_index;         /**< Time index entries */
+
+    /* Stream output */
+    uint64_t i_sent_packets;            /**< Datagrams sent */
+    uint64_t i_sent_bytes;              /**< Bytes sent */
+    uint64_t i_send_calls;              /**< Send system calls */
+    uint64_t i_paced_packets;           /**< Datagrams held back by pacing */
+    vlc_tick_t i_pacing_slip_max;       /**< Worst pacing slip */
 };
 
 /**
@@ -223,6 +223,35 @@ enum sout_stream_query_e
      * \endcode
      */
     SOUT_STREAM_IS_SYNCHRONOUS,
+
+    /**
+     * Collect the transmission counters of the network outputs.
+     *
+     * Outputs add their counters to the structure, so that the counters of
+     * all the outputs of a chain are summed. Filters forward the query.
+     * This control should fail and do nothing if not implemented.
+     *
+     * \param struct sout_stream_stats* Counters to add to
+     *
+     * Usage:
+     * \code{c}
+     * struct sout_stream_stats stats = { 0 };
+     * sout_StreamControl(stream, SOUT_STREAM_GET_STATS, &stats);
+     * \endcode
+     */
+    SOUT_STREAM_GET_STATS,
+};
+
+/**
+ * Stream output transmission counters, see ::SOUT_STREAM_GET_STATS.
+ */
+struct sout_stream_stats
+{
+    uint64_t sent_packets; /**< datagrams sent */
+    uint64_t sent_bytes; /**< payload bytes sent */
+    uint64_t send_calls; /**< send system calls */
+    uint64_t paced_packets; /**< datagrams held back by a pacer */
+    vlc_tick_t slip_max; /**< worst pacing slip */
 };
 
 typedef struct vlc_frame_t vlc_frame_t;
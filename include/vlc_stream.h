@@ -270,6 +270,10 @@ enum stream_query_e
     STREAM_GET_SIGNAL,                      /**< arg1=(double *pf_quality), arg2=(double *pf_strength) res=can fail */
     STREAM_GET_TAGS,                        /**< arg1=(const block_t **) res=can fail */
     STREAM_GET_TYPE,                        /**< arg1=(int*) res=can fail */
+    STREAM_GET_PREFETCH_STATS,              /**< arg1=(struct vlc_stream_prefetch_stats *) res=can fail */
+    STREAM_CAN_PEEK_BLOCK,                  /**< arg1=(bool *) res=can fail
+                                                 Whether blocks are views of the source data, which can be
+                                                 peeked in place rather than copied. */
 
     STREAM_SET_PAUSE_STATE = 0x200,         /**< arg1=(bool) res=can fail */
     STREAM_SET_TITLE,                       /**< arg1=(int) res=can fail */
@@ -284,6 +288,19 @@ enum stream_query_e
     STREAM_GET_PRIVATE_ID_STATE,            /**< arg1=(int i_private_data) arg2=(bool *) res=can fail */
 };
 
+/**
+ * Prefetch buffer counters, see ::STREAM_GET_PREFETCH_STATS.
+ */
+struct vlc_stream_prefetch_stats
+{
+    uint64_t buffer_size; /**< current buffer size, adapted to the source */
+    uint64_t reads; /**< read requests */
+    uint64_t hits; /**< reads served without waiting for the source */
+    uint64_t stalls; /**< reads that waited for the source */
+    vlc_tick_t stall_time; /**< total waiting time */
+    uint64_t seeks; /**< seeks of the source */
+};
+
 /**
  * Reads data from a byte stream.
  *
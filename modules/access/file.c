@@ -50,10 +50,14 @@
 #else
 #   include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
 #include <vlc_access.h>
+#include <vlc_atomic.h>
 #include <vlc_interrupt.h>
 #ifdef _WIN32
 # include <vlc_charset.h>
@@ -61,11 +65,44 @@
 #include <vlc_fs.h>
 #include <vlc_url.h>
 
+#ifdef HAVE_MMAP
+/* Window of the file mapped in memory, shared by the blocks pointing to it */
+struct file_map
+{
+    vlc_atomic_rc_t rc;
+    uint64_t offset; /* file offset of the window, multiple of the size */
+    size_t length;
+    unsigned char *base;
+    bool sequential; /* whether sequential paging is advised */
+};
+
+struct file_view
+{
+    block_t block;
+    struct file_map *map;
+};
+
+/* Size of the mapped windows (must be a multiple of the page size) */
+# define FILE_MAP_WINDOW ((sizeof (void *) > 4) ? (64 << 20) : (8 << 20))
+/* Largest block handed out */
+# define FILE_MAP_BLOCK (256 << 10)
+/* Read-ahead distance hinted once the access pattern is sequential */
+# define FILE_MAP_AHEAD (4 << 20)
+/* Consecutive blocks after which the access pattern counts as sequential */
+# define FILE_MAP_SEQUENTIAL 4
+#endif
+
 typedef struct
 {
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    struct file_map *map;
+    uint64_t offset;
+    uint64_t size;
+    unsigned sequential;
+#endif
 } access_sys_t;
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -169,6 +206,140 @@ static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
 
+#ifdef HAVE_MMAP
+static block_t *BlockMap (stream_t *, bool *);
+static int MapSeek (stream_t *, uint64_t);
+
+static void MapRelease (struct file_map *map)
+{
+    if (vlc_atomic_rc_dec (&map->rc))
+    {
+        munmap (map->base, map->length);
+        free (map);
+    }
+}
+
+static void FileViewRelease (block_t *block)
+{
+    struct file_view *view = container_of (block, struct file_view, block);
+
+    MapRelease (view->map);
+    free (view);
+}
+
+static const struct vlc_block_callbacks file_view_cbs =
+{
+    FileViewRelease,
+};
+
+/**
+ * Returns the window mapping the given offset, mapping it if needed.
+ * The offset must be within the known file size.
+ */
+static struct file_map *MapWindow (stream_t *p_access, uint64_t offset)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct file_map *map = p_sys->map;
+
+    if (map != NULL && offset >= map->offset
+     && offset - map->offset < map->length)
+        return map;
+
+    uint64_t start = offset - (offset % FILE_MAP_WINDOW);
+    size_t length = FILE_MAP_WINDOW;
+
+    if (p_sys->size - start < length)
+        length = p_sys->size - start;
+
+    void *base = mmap (NULL, length, PROT_READ, MAP_SHARED, p_sys->fd, start);
+    if (base == MAP_FAILED)
+    {
+        msg_Err (p_access, "cannot map file: %s", vlc_strerror_c(errno));
+        return NULL;
+    }
+
+    map = malloc (sizeof (*map));
+    if (unlikely(map == NULL))
+    {
+        munmap (base, length);
+        return NULL;
+    }
+
+    vlc_atomic_rc_init (&map->rc);
+    map->offset = start;
+    map->length = length;
+    map->base = base;
+    map->sequential = false;
+
+    /* The blocks still pointing to the previous window keep it alive */
+    if (p_sys->map != NULL)
+        MapRelease (p_sys->map);
+    p_sys->map = map;
+    return map;
+}
+
+/**
+ * Tunes the kernel paging of the current window to the access pattern of
+ * the demuxer: read-ahead while the file is read linearly, default paging
+ * after it seeks around.
+ */
+static void MapAdvise (access_sys_t *p_sys, struct file_map *map,
+                       size_t begin, size_t end)
+{
+#ifdef HAVE_POSIX_MADVISE
+    bool sequential = p_sys->sequential >= FILE_MAP_SEQUENTIAL;
+
+    if (map->sequential != sequential)
+    {
+        posix_madvise (map->base, map->length,
+                       sequential ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_NORMAL);
+        map->sequential = sequential;
+    }
+
+    if (!sequential || end >= map->length)
+        return;
+
+    /* Request the next stretches when the pattern turns sequential, then
+     * whenever reading crosses into a new one */
+    if (p_sys->sequential != FILE_MAP_SEQUENTIAL
+     && begin / FILE_MAP_AHEAD == end / FILE_MAP_AHEAD)
+        return;
+
+    size_t ahead = map->length - end;
+    if (ahead > 2 * FILE_MAP_AHEAD)
+        ahead = 2 * FILE_MAP_AHEAD;
+    posix_madvise (map->base + end, ahead, POSIX_MADV_WILLNEED);
+#else
+    VLC_UNUSED(p_sys); VLC_UNUSED(map); VLC_UNUSED(begin); VLC_UNUSED(end);
+#endif
+}
+
+static int MapInit (stream_t *p_access, const struct stat *st)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if (!var_InheritBool (p_access, "file-mmap")
+     || !S_ISREG (st->st_mode) || st->st_size <= 0
+     || IsRemote (p_sys->fd, p_access->psz_filepath))
+        return VLC_EGENERIC;
+
+    p_sys->map = NULL;
+    p_sys->offset = 0;
+    p_sys->size = st->st_size;
+    p_sys->sequential = 0;
+
+    /* Map the beginning early: demuxers start by probing it */
+    if (MapWindow (p_access, 0) == NULL)
+        return VLC_EGENERIC;
+
+    p_access->pf_read = NULL;
+    p_access->pf_block = BlockMap;
+    p_access->pf_seek = MapSeek;
+    msg_Dbg (p_access, "using memory-mapped reads");
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * FileOpen: open the file
  *****************************************************************************/
@@ -252,12 +423,20 @@ int FileOpen( vlc_object_t *p_this )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+#ifdef HAVE_MMAP
+    p_sys->map = NULL;
+#endif
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
         p_access->pf_seek = FileSeek;
         p_sys->b_pace_control = true;
 
+#ifdef HAVE_MMAP
+        if (MapInit (p_access, &st) == VLC_SUCCESS)
+            return VLC_SUCCESS;
+#endif
+
         /* Demuxers will need the beginning of the file for probing. */
         posix_fadvise (fd, 0, 4096, POSIX_FADV_WILLNEED);
         /* In most cases, we only read the file once. */
@@ -292,7 +471,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -300,6 +479,10 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_MMAP
+    if (p_sys->map != NULL)
+        MapRelease (p_sys->map);
+#endif
     vlc_close (p_sys->fd);
 }
 
@@ -338,6 +521,68 @@ static int FileSeek (stream_t *p_access, uint64_t i_pos)
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * BlockMap: hand out a view of the mapped file, without copying
+ *****************************************************************************/
+static block_t *BlockMap (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if (p_sys->offset >= p_sys->size)
+    {   /* The file may be growing, e.g. while it is being recorded */
+        struct stat st;
+
+        if (fstat (p_sys->fd, &st) == 0 && (uint64_t)st.st_size > p_sys->size)
+            p_sys->size = st.st_size;
+        if (p_sys->offset >= p_sys->size)
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    struct file_map *map = MapWindow (p_access, p_sys->offset);
+    if (map == NULL)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    struct file_view *view = malloc (sizeof (*view));
+    if (unlikely(view == NULL))
+        return NULL;
+
+    size_t offset = p_sys->offset - map->offset;
+    size_t length = map->length - offset;
+
+    if (length > FILE_MAP_BLOCK)
+        length = FILE_MAP_BLOCK;
+
+    block_Init (&view->block, &file_view_cbs, map->base + offset, length);
+    vlc_atomic_rc_inc (&map->rc);
+    view->map = map;
+
+    p_sys->offset += length;
+    if (p_sys->sequential < UINT_MAX)
+        p_sys->sequential++;
+    MapAdvise (p_sys, map, offset, offset + length);
+    return &view->block;
+}
+
+static int MapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if (i_pos != p_sys->offset)
+    {
+        p_sys->offset = i_pos;
+        p_sys->sequential = 0;
+    }
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
@@ -361,6 +606,12 @@ static int FileControl( stream_t *p_access, int i_query, va_list args )
             *pb_bool = p_sys->b_pace_control;
             break;
 
+        case STREAM_CAN_PEEK_BLOCK:
+            /* Memory-mapped blocks are views of the file */
+            pb_bool = va_arg( args, bool * );
+            *pb_bool = (p_access->pf_block != NULL);
+            break;
+
         case STREAM_GET_SIZE:
         case STREAM_GET_MTIME:
         {
@@ -30,6 +30,12 @@
 #include "fs.h"
 #include <vlc_plugin.h>
 
+#define FILE_MMAP_TEXT N_("Memory-mapped reads")
+#define FILE_MMAP_LONGTEXT N_( \
+    "Read local files through memory mappings instead of copying their " \
+    "data. This is faster, but VLC may crash if the file is truncated " \
+    "while it is being read.")
+
 vlc_module_begin ()
     set_description( N_("File input") )
     set_shortname( N_("File") )
@@ -37,6 +43,9 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+#ifdef HAVE_MMAP
+    add_bool("file-mmap", false, FILE_MMAP_TEXT, FILE_MMAP_LONGTEXT)
+#endif
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
@@ -25,6 +25,8 @@
 #include <assert.h>
 #include <vlc_common.h>
 #include <vlc_network.h>
+#include <vlc_strings.h>
+#include <vlc_threads.h>
 #include <vlc_tls.h>
 #include <vlc_url.h>
 #include "transport.h"
@@ -96,6 +98,310 @@ static char *vlc_http_proxy_find(const char *hostname, unsigned port,
 }
 
 
+struct vlc_http_pool_conn
+{
+    struct vlc_http_pool_conn *next;
+    struct vlc_http_conn *conn; /**< NULL if HTTP/2 is not available */
+    bool connecting;
+    bool confirmed; /**< whether a response was received */
+    bool secure;
+    unsigned failures; /**< consecutive failures */
+    vlc_tick_t retry; /**< when to try HTTP/2 again if not available */
+    unsigned port;
+    char host[];
+};
+
+struct vlc_http_pool
+{
+    struct vlc_logger *logger;
+    vlc_object_t *obj;
+    vlc_tls_client_t *creds;
+    bool h2c;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    struct vlc_http_pool_conn *conns;
+    struct vlc_http_pool_stats stats;
+};
+
+static struct vlc_http_pool_conn **vlc_http_pool_find(struct vlc_http_pool *pool,
+                                                      bool https,
+                                                      const char *host,
+                                                      unsigned port)
+{
+    struct vlc_http_pool_conn **pp;
+
+    for (pp = &pool->conns; *pp != NULL; pp = &(*pp)->next)
+    {
+        const struct vlc_http_pool_conn *pc = *pp;
+
+        if (pc->secure == https && pc->port == port
+         && !vlc_ascii_strcasecmp(pc->host, host))
+            break;
+    }
+    return pp;
+}
+
+static vlc_tls_t *vlc_http_pool_connect_tcp(struct vlc_http_pool *pool,
+                                            const char *host, unsigned port)
+{
+    struct addrinfo hints =
+    {
+        .ai_socktype = SOCK_STREAM,
+        .ai_protocol = IPPROTO_TCP,
+    }, *res;
+
+    int val = vlc_getaddrinfo_i11e(host, port, &hints, &res);
+    if (val != 0)
+    {
+        vlc_http_err(pool->logger, "cannot resolve %s: %s", host,
+                     gai_strerror(val));
+        return NULL;
+    }
+
+    vlc_tls_t *tcp = NULL;
+    for (const struct addrinfo *p = res; p != NULL && tcp == NULL;
+         p = p->ai_next)
+        tcp = vlc_tls_SocketOpenAddrInfo(p, true);
+
+    freeaddrinfo(res);
+    return tcp;
+}
+
+static struct vlc_http_conn *vlc_http_pool_connect(struct vlc_http_pool *pool,
+                                                   vlc_tls_client_t *creds,
+                                                   const char *host,
+                                                   unsigned port,
+                                                   struct vlc_http_conn **h1)
+{
+    vlc_tls_t *tls;
+
+    if (creds != NULL)
+    {
+        bool http2 = true;
+
+        tls = vlc_https_connect(creds, host, port, &http2);
+        if (tls != NULL && !http2)
+        {   /* The server negotiated HTTP/1.1: rather than closing the
+             * session, hand it over to the requesting connection manager. */
+            *h1 = vlc_h1_conn_create(pool->logger, tls, false);
+            if (unlikely(*h1 == NULL))
+                vlc_tls_Close(tls);
+            return NULL;
+        }
+    }
+    else
+        tls = vlc_http_pool_connect_tcp(pool, host, port);
+
+    if (tls == NULL)
+        return NULL;
+
+    struct vlc_http_conn *conn = vlc_h2_conn_create(pool->logger, tls);
+    if (unlikely(conn == NULL))
+        vlc_tls_Close(tls);
+    return conn;
+}
+
+/* Delay before trying an origin again, doubled after each failure */
+#define VLC_HTTP_POOL_RETRY VLC_TICK_FROM_SEC(30)
+#define VLC_HTTP_POOL_RETRY_MAX_SHIFT 4
+
+static void vlc_http_pool_fail(struct vlc_http_pool *pool,
+                               struct vlc_http_pool_conn *pc)
+{
+    unsigned shift = pc->failures;
+
+    if (shift > VLC_HTTP_POOL_RETRY_MAX_SHIFT)
+        shift = VLC_HTTP_POOL_RETRY_MAX_SHIFT;
+
+    pc->conn = NULL;
+    pc->confirmed = false;
+    pc->failures++;
+    pc->retry = vlc_tick_now() + (VLC_HTTP_POOL_RETRY << shift);
+    pool->stats.failures++;
+}
+
+/**
+ * Updates the state of a pooled connection after a request.
+ *
+ * A connection that never got any response is assumed not to support
+ * HTTP/2, so that the origin is not tried again for a while.
+ */
+static void vlc_http_pool_update(struct vlc_http_pool *pool, bool https,
+                                 const char *host, unsigned port,
+                                 struct vlc_http_conn *conn, bool success)
+{
+    vlc_mutex_lock(&pool->lock);
+
+    struct vlc_http_pool_conn *pc = *vlc_http_pool_find(pool, https, host,
+                                                        port);
+    if (pc != NULL && pc->conn == conn && !pc->confirmed)
+    {
+        if (success)
+        {
+            pc->confirmed = true;
+            pc->failures = 0;
+        }
+        else
+        {
+            vlc_http_dbg(pool->logger, "%s:%u does not support HTTP/2",
+                         host, port);
+            vlc_http_pool_fail(pool, pc);
+            vlc_http_conn_release(conn);
+        }
+    }
+    vlc_mutex_unlock(&pool->lock);
+}
+
+static struct vlc_http_msg *vlc_http_pool_request(struct vlc_http_pool *pool,
+                                                  bool https,
+                                                  const char *host,
+                                                  unsigned port,
+                                                  const struct vlc_http_msg *req,
+                                                  bool payload,
+                                                  struct vlc_http_conn **h1)
+{
+    *h1 = NULL;
+    if (!https && !pool->h2c)
+        return NULL;
+    if (port == 0)
+        port = https ? 443 : 80;
+
+    char *proxy = vlc_http_proxy_find(host, port, https);
+    if (proxy != NULL)
+    {   /* Let the connection manager deal with proxies */
+        free(proxy);
+        return NULL;
+    }
+
+    struct vlc_http_pool_conn *pc;
+    struct vlc_http_conn *conn = NULL;
+    struct vlc_http_stream *stream = NULL;
+
+    vlc_mutex_lock(&pool->lock);
+    while (stream == NULL)
+    {
+        struct vlc_http_pool_conn **pp = vlc_http_pool_find(pool, https,
+                                                            host, port);
+        pc = *pp;
+        if (pc == NULL)
+        {   /* First request to this origin */
+            size_t len = strlen(host) + 1;
+
+            pc = malloc(sizeof (*pc) + len);
+            if (unlikely(pc == NULL))
+                break;
+
+            pc->conn = NULL;
+            pc->connecting = false;
+            pc->confirmed = false;
+            pc->secure = https;
+            pc->failures = 0;
+            pc->retry = VLC_TICK_INVALID;
+            pc->port = port;
+            memcpy(pc->host, host, len);
+            pc->next = pool->conns;
+            pool->conns = pc;
+        }
+        else if (pc->connecting)
+        {   /* Wait for the other request to establish the connection */
+            vlc_cond_wait(&pool->wait, &pool->lock);
+            continue;
+        }
+        else if (pc->conn != NULL)
+        {
+            conn = pc->conn;
+            stream = vlc_http_stream_open(conn, req, payload);
+            if (stream == NULL)
+            {   /* Get rid of closing or failed connection, and reconnect */
+                *pp = pc->next;
+                vlc_http_conn_release(conn);
+                free(pc);
+            }
+            continue;
+        }
+        else if (vlc_tick_now() < pc->retry)
+            break; /* HTTP/2 not supported, or server unreachable */
+
+        /* Connect, or try again after the previous failure expired */
+        if (https && pool->creds == NULL)
+            pool->creds = vlc_tls_ClientCreate(pool->obj);
+
+        vlc_tls_client_t *creds = https ? pool->creds : NULL;
+        bool ok = !https || creds != NULL;
+
+        pc->connecting = true;
+        vlc_mutex_unlock(&pool->lock);
+        conn = ok ? vlc_http_pool_connect(pool, creds, host, port, h1)
+                  : NULL;
+        vlc_mutex_lock(&pool->lock);
+
+        pc->connecting = false;
+        if (conn != NULL)
+        {
+            pc->conn = conn;
+            pool->stats.connections++;
+        }
+        else
+            vlc_http_pool_fail(pool, pc);
+        vlc_cond_broadcast(&pool->wait);
+    }
+
+    if (stream != NULL)
+        pool->stats.requests++;
+    vlc_mutex_unlock(&pool->lock);
+
+    if (stream == NULL)
+        return NULL;
+
+    struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+    vlc_http_pool_update(pool, https, host, port, conn, m != NULL);
+    return m;
+}
+
+struct vlc_http_pool *vlc_http_pool_create(vlc_object_t *obj, bool h2c)
+{
+    struct vlc_http_pool *pool = malloc(sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    pool->logger = obj->logger;
+    pool->obj = obj;
+    pool->creds = NULL;
+    pool->h2c = h2c;
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    pool->conns = NULL;
+    pool->stats.connections = 0;
+    pool->stats.failures = 0;
+    pool->stats.requests = 0;
+    return pool;
+}
+
+void vlc_http_pool_destroy(struct vlc_http_pool *pool)
+{
+    while (pool->conns != NULL)
+    {
+        struct vlc_http_pool_conn *pc = pool->conns;
+
+        assert(!pc->connecting);
+        pool->conns = pc->next;
+        if (pc->conn != NULL)
+            vlc_http_conn_release(pc->conn);
+        free(pc);
+    }
+    if (pool->creds != NULL)
+        vlc_tls_ClientDelete(pool->creds);
+    free(pool);
+}
+
+void vlc_http_pool_get_stats(struct vlc_http_pool *pool,
+                             struct vlc_http_pool_stats *stats)
+{
+    vlc_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    vlc_mutex_unlock(&pool->lock);
+}
+
 struct vlc_http_mgr
 {
     struct vlc_logger *logger;
@@ -103,6 +409,7 @@ struct vlc_http_mgr
     vlc_tls_client_t *creds;
     struct vlc_http_cookie_jar_t *jar;
     struct vlc_http_conn *conn;
+    struct vlc_http_pool *pool;
 };
 
 static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
@@ -278,6 +585,34 @@ struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
     if (port && vlc_http_port_blocked(port))
         return NULL;
 
+    if (mgr->pool != NULL && idempotent)
+    {
+        struct vlc_http_conn *conn;
+        struct vlc_http_msg *resp = vlc_http_pool_request(mgr->pool, https,
+                                                          host, port, m,
+                                                          payload, &conn);
+        if (resp != NULL)
+            return resp;
+
+        if (conn != NULL)
+        {   /* HTTP/1.1 origin: reuse the TLS session of the probe */
+            if (mgr->creds == NULL)
+                mgr->creds = vlc_tls_ClientCreate(mgr->obj);
+            if (mgr->creds != NULL)
+            {
+                if (mgr->conn != NULL)
+                    vlc_http_mgr_release(mgr, mgr->conn);
+                mgr->conn = conn;
+
+                resp = vlc_http_mgr_reuse(mgr, host, port, m, payload);
+                if (resp != NULL)
+                    return resp;
+            }
+            else
+                vlc_http_conn_release(conn);
+        }
+    }
+
     return (https ? vlc_https_request : vlc_http_request)(mgr, host, port, m,
                                                           idempotent, payload);
 }
@@ -299,9 +634,16 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->creds = NULL;
     mgr->jar = jar;
     mgr->conn = NULL;
+    mgr->pool = NULL;
     return mgr;
 }
 
+void vlc_http_mgr_set_pool(struct vlc_http_mgr *mgr, struct vlc_http_pool *pool)
+{
+    assert(mgr->conn == NULL);
+    mgr->pool = pool;
+}
+
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
 {
     if (mgr->conn != NULL)
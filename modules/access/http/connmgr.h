@@ -76,4 +76,58 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
  */
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr);
 
+/**
+ * \defgroup http_pool Multiplexed connections pool
+ * Shared HTTP/2 connections
+ * @{
+ */
+
+struct vlc_http_pool;
+
+struct vlc_http_pool_stats
+{
+    unsigned connections; /**< HTTP/2 connections established */
+    unsigned failures; /**< Origins found unreachable or without HTTP/2 */
+    unsigned long requests; /**< Requests sent over those connections */
+};
+
+/**
+ * Creates a pool of multiplexed HTTP connections
+ *
+ * The pool keeps at most one HTTP/2 connection per origin server, and
+ * multiplexes the requests of all the connection managers attached to it,
+ * from any thread. Requests to servers that do not support HTTP/2 are left
+ * to each connection manager. If such a server negotiated HTTP/1.1 over
+ * TLS-ALPN, its TLS session is handed over to the first connection manager
+ * that requested it. Such servers, and unreachable ones, are tried again
+ * after a delay growing with each consecutive failure.
+ *
+ * @param obj parent VLC object
+ * @param h2c whether to use HTTP/2 over unencrypted HTTP, assuming server
+ *            support (prior knowledge) rather than upgrading
+ */
+struct vlc_http_pool *vlc_http_pool_create(vlc_object_t *obj, bool h2c);
+
+/**
+ * Destroys a pool of multiplexed HTTP connections
+ *
+ * All the connection managers attached to the pool must have been destroyed.
+ * Connections are closed once their last stream is closed.
+ */
+void vlc_http_pool_destroy(struct vlc_http_pool *pool);
+
+void vlc_http_pool_get_stats(struct vlc_http_pool *pool,
+                             struct vlc_http_pool_stats *stats);
+
+/**
+ * Attaches a connection manager to a pool of multiplexed connections
+ *
+ * Idempotent requests of the manager are sent through the pool first.
+ * This must be called before any request.
+ */
+void vlc_http_mgr_set_pool(struct vlc_http_mgr *mgr,
+                           struct vlc_http_pool *pool);
+
+/** @} */
+
 /** @} */
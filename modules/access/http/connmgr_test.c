@@ -0,0 +1,480 @@
+/*****************************************************************************
+ * connmgr_test.c: HTTP connection manager test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifndef SOCK_CLOEXEC
+# define SOCK_CLOEXEC 0
+# define accept4(a,b,c,d) accept(a,b,c)
+#endif
+#ifdef _WIN32
+# include <winsock2.h>
+#else
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+#endif
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_network.h>
+#include <vlc_threads.h>
+#include <vlc_tick.h>
+#include <vlc_tls.h>
+#include "h2frame.h"
+#include "connmgr.h"
+#include "message.h"
+
+const char vlc_module_name[] = "test_http_connmgr";
+
+/* Stub server answering HTTP/1.1 and HTTP/2 with prior knowledge (h2c).
+ * Each new connection is delayed, standing for the handshakes. */
+
+#define SETUP_DELAY VLC_TICK_FROM_MS(40)
+#define BODY_SIZE 4096
+#define MAX_CONNECTIONS 32
+
+static const char h2_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+struct server
+{
+    int fd;
+    unsigned port;
+    bool h2c;
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    unsigned connections;
+    struct server_client
+    {
+        const struct server *srv;
+        int fd;
+        vlc_thread_t thread;
+    } clients[MAX_CONNECTIONS];
+};
+
+static char body[BODY_SIZE];
+
+static bool recv_all(int fd, void *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t val = recv(fd, buf, len, 0);
+        if (val <= 0)
+            return false;
+        buf = (char *)buf + val;
+        len -= val;
+    }
+    return true;
+}
+
+static void send_all(int fd, const void *buf, size_t len)
+{
+    ssize_t val = send(fd, buf, len, MSG_NOSIGNAL);
+    assert(val == (ssize_t)len);
+}
+
+static void send_frame(int fd, struct vlc_h2_frame *f)
+{
+    assert(f != NULL);
+    send_all(fd, f->data, vlc_h2_frame_size(f));
+    free(f);
+}
+
+static void server_h2(int fd)
+{
+    send_frame(fd, vlc_h2_frame_settings());
+
+    for (;;)
+    {
+        uint8_t hdr[9];
+        if (!recv_all(fd, hdr, sizeof (hdr)))
+            break;
+
+        size_t len = (hdr[0] << 16) | (hdr[1] << 8) | hdr[2];
+        uint_fast8_t type = hdr[3];
+        uint_fast8_t flags = hdr[4];
+        uint_fast32_t id = GetDWBE(hdr + 5) & 0x7fffffff;
+        uint8_t payload[len ? len : 1];
+
+        if (!recv_all(fd, payload, len))
+            break;
+
+        if (type == 0x4 /* SETTINGS */ && !(flags & 0x1 /* ACK */))
+            send_frame(fd, vlc_h2_frame_settings_ack());
+
+        if (type == 0x1 /* HEADERS */)
+        {
+            struct vlc_http_msg *m = vlc_http_resp_create(200);
+            assert(m != NULL);
+            vlc_http_msg_add_header(m, "Content-Length", "%u", BODY_SIZE);
+            send_frame(fd, vlc_http_msg_h2_frame(m, NULL, id, false));
+            vlc_http_msg_destroy(m);
+            send_frame(fd, vlc_h2_frame_data(id, body, BODY_SIZE, true));
+        }
+    }
+}
+
+static void server_h1(int fd, const char *buf, size_t buflen)
+{
+    char req[1024];
+
+    memcpy(req, buf, buflen);
+    for (;;)
+    {
+        while (strnstr(req, "\r\n\r\n", buflen) == NULL)
+        {
+            if (buflen >= sizeof (req) - 1)
+                return;
+            ssize_t val = recv(fd, req + buflen, sizeof (req) - 1 - buflen, 0);
+            if (val <= 0)
+                return;
+            buflen += val;
+        }
+
+        char *end = strnstr(req, "\r\n\r\n", buflen) + 4;
+        char resp[128 + BODY_SIZE];
+        int len = snprintf(resp, 128, "HTTP/1.1 200 OK\r\n"
+                           "Content-Length: %u\r\n\r\n", BODY_SIZE);
+        memcpy(resp + len, body, BODY_SIZE);
+        send_all(fd, resp, len + BODY_SIZE);
+
+        buflen -= end - req;
+        memmove(req, end, buflen);
+    }
+}
+
+static void server_process(const struct server *srv, int fd)
+{
+    char buf[sizeof (h2_preface) - 1];
+    size_t buflen = 0;
+
+    vlc_tick_wait(vlc_tick_now() + SETUP_DELAY);
+
+    /* Tell HTTP/2 prior knowledge from HTTP/1.x requests */
+    while (buflen < sizeof (buf))
+    {
+        ssize_t val = recv(fd, buf + buflen, sizeof (buf) - buflen, 0);
+        if (val <= 0)
+            return;
+        buflen += val;
+        if (memcmp(buf, h2_preface, buflen))
+            break;
+    }
+
+    if (memcmp(buf, h2_preface, buflen))
+        server_h1(fd, buf, buflen);
+    else if (srv->h2c)
+        server_h2(fd);
+    else
+    {
+        static const char h1_error[] = "HTTP/1.1 505 Not Supported\r\n"
+                                       "Connection: close\r\n\r\n";
+        send_all(fd, h1_error, strlen(h1_error));
+    }
+}
+
+static void *server_client_thread(void *data)
+{
+    struct server_client *client = data;
+
+    server_process(client->srv, client->fd);
+    shutdown(client->fd, SHUT_WR);
+    return NULL;
+}
+
+static void *server_thread(void *data)
+{
+    struct server *srv = data;
+
+    for (;;)
+    {
+        int fd = accept4(srv->fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd == -1)
+            continue;
+
+        int canc = vlc_savecancel();
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &(int){ 1 }, sizeof (int));
+        vlc_mutex_lock(&srv->lock);
+        assert(srv->connections < MAX_CONNECTIONS);
+        struct server_client *client = &srv->clients[srv->connections++];
+        client->srv = srv;
+        client->fd = fd;
+        if (vlc_clone(&client->thread, server_client_thread, client))
+            assert(!"Thread error");
+        vlc_mutex_unlock(&srv->lock);
+        vlc_restorecancel(canc);
+    }
+    vlc_assert_unreachable();
+}
+
+static int server_start(struct server *srv, bool h2c)
+{
+    int fd = socket(PF_INET, SOCK_STREAM|SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd == -1)
+        return -1;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+
+    if (bind(fd, (struct sockaddr *)&addr, addrlen)
+     || getsockname(fd, (struct sockaddr *)&addr, &addrlen)
+     || listen(fd, 16))
+    {
+        vlc_close(fd);
+        return -1;
+    }
+
+    srv->fd = fd;
+    srv->port = ntohs(addr.sin_port);
+    srv->h2c = h2c;
+    srv->connections = 0;
+    vlc_mutex_init(&srv->lock);
+    if (vlc_clone(&srv->thread, server_thread, srv))
+        assert(!"Thread error");
+    return 0;
+}
+
+static void server_stop(struct server *srv)
+{
+    vlc_cancel(srv->thread);
+    vlc_join(srv->thread, NULL);
+
+    for (unsigned i = 0; i < srv->connections; i++)
+    {
+        struct server_client *client = &srv->clients[i];
+
+        shutdown(client->fd, SHUT_RDWR);
+        vlc_join(client->thread, NULL);
+        vlc_close(client->fd);
+    }
+    vlc_close(srv->fd);
+}
+
+/* Stub TLS: plain TCP, with the server protocol from ALPN */
+
+static const char *server_alp;
+
+vlc_tls_client_t *vlc_tls_ClientCreate(vlc_object_t *obj)
+{
+    vlc_tls_client_t *crd = malloc(sizeof (*crd));
+    assert(crd != NULL);
+    (void) obj;
+    return crd;
+}
+
+void vlc_tls_ClientDelete(vlc_tls_client_t *crd)
+{
+    free(crd);
+}
+
+vlc_tls_t *vlc_tls_SocketOpenTLS(vlc_tls_client_t *crd, const char *hostname,
+                                 unsigned port, const char *service,
+                                 const char *const *alpn, char **alp)
+{
+    const char *proto = NULL;
+
+    assert(crd != NULL);
+    assert(!strcmp(hostname, "127.0.0.1"));
+    (void) service;
+
+    vlc_tls_t *tls = vlc_tls_SocketOpenTCP(NULL, hostname, port);
+    if (tls == NULL)
+        return NULL;
+
+    for (size_t i = 0; alpn != NULL && alpn[i] != NULL; i++)
+        if (proto == NULL || !strcmp(alpn[i], server_alp))
+            proto = alpn[i];
+
+    if (alp != NULL)
+        *alp = (proto != NULL) ? strdup(proto) : NULL;
+    return tls;
+}
+
+/* Clients, each with their own connection manager, as the adaptive
+ * demuxer downloaders */
+
+#define CLIENTS 4
+#define REQUESTS 8
+
+struct client
+{
+    vlc_object_t *obj;
+    struct vlc_http_pool *pool;
+    bool https;
+    unsigned port;
+    vlc_tick_t delay; /* streams are not all started at once */
+    vlc_tick_t first_response;
+    vlc_tick_t total;
+};
+
+static void *client_thread(void *data)
+{
+    struct client *c = data;
+    char authority[32];
+
+    snprintf(authority, sizeof (authority), "127.0.0.1:%u", c->port);
+
+    struct vlc_http_mgr *mgr = vlc_http_mgr_create(c->obj, NULL);
+    assert(mgr != NULL);
+    if (c->pool != NULL)
+        vlc_http_mgr_set_pool(mgr, c->pool);
+
+    vlc_tick_wait(vlc_tick_now() + c->delay);
+
+    const vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < REQUESTS; i++)
+    {
+        struct vlc_http_msg *req = vlc_http_req_create("GET",
+                                                       c->https ? "https"
+                                                                : "http",
+                                                       authority, "/segment");
+        assert(req != NULL);
+
+        const vlc_tick_t begin = vlc_tick_now();
+        struct vlc_http_msg *resp = vlc_http_mgr_request(mgr, c->https,
+                                                         "127.0.0.1", c->port,
+                                                         req, true, false);
+        vlc_http_msg_destroy(req);
+        assert(resp != NULL);
+        assert(vlc_http_msg_get_status(resp) == 200);
+        if (i == 0)
+            c->first_response = vlc_tick_now() - begin;
+
+        size_t total = 0;
+        block_t *block;
+        while ((block = vlc_http_msg_read(resp)) != NULL)
+        {
+            assert(block != vlc_http_error);
+            assert(!memcmp(block->p_buffer, body + total, block->i_buffer));
+            total += block->i_buffer;
+            block_Release(block);
+        }
+        assert(total == BODY_SIZE);
+        vlc_http_msg_destroy(resp);
+    }
+
+    c->total = vlc_tick_now() - start;
+    vlc_http_mgr_destroy(mgr);
+    return NULL;
+}
+
+static unsigned run(const char *name, bool server_h2c, bool pool_h2c,
+                    bool pooled, const char *alp)
+{
+    server_alp = alp;
+
+    struct server srv;
+    if (server_start(&srv, server_h2c))
+        exit(77);
+
+    vlc_object_t obj = { .logger = NULL };
+    struct vlc_http_pool *pool = NULL;
+    if (pooled)
+    {
+        pool = vlc_http_pool_create(&obj, pool_h2c);
+        assert(pool != NULL);
+    }
+
+    struct client clients[CLIENTS];
+    vlc_thread_t threads[CLIENTS];
+
+    for (unsigned i = 0; i < CLIENTS; i++)
+    {
+        clients[i].obj = &obj;
+        clients[i].pool = pool;
+        clients[i].https = alp != NULL;
+        clients[i].port = srv.port;
+        clients[i].delay = i * 2 * SETUP_DELAY;
+        if (vlc_clone(&threads[i], client_thread, &clients[i]))
+            assert(!"Thread error");
+    }
+
+    vlc_tick_t first = 0, total = 0;
+    for (unsigned i = 0; i < CLIENTS; i++)
+    {
+        vlc_join(threads[i], NULL);
+        first += clients[i].first_response;
+        total += clients[i].total;
+    }
+
+    struct vlc_http_pool_stats stats = { 0 };
+    if (pool != NULL)
+    {
+        vlc_http_pool_get_stats(pool, &stats);
+        vlc_http_pool_destroy(pool);
+    }
+
+    server_stop(&srv);
+
+    printf("%-18s %2u connection(s), %2u over HTTP/2, %u failed, average "
+           "first response %3"PRId64" ms, %u requests %3"PRId64" ms\n",
+           name, srv.connections, stats.connections, stats.failures,
+           MS_FROM_VLC_TICK(first / CLIENTS), REQUESTS,
+           MS_FROM_VLC_TICK(total / CLIENTS));
+
+    if (pooled && server_h2c && (pool_h2c || alp != NULL))
+        assert(stats.requests == CLIENTS * REQUESTS);
+    return srv.connections;
+}
+
+int main(void)
+{
+    unsetenv("http_proxy");
+    unsetenv("HTTP_PROXY");
+
+    for (size_t i = 0; i < sizeof (body); i++)
+        body[i] = i * 7;
+
+    /* one HTTP/1.1 connection per manager */
+    assert(run("HTTP/1.1", true, false, false, NULL) == CLIENTS);
+    /* the pool only handles unencrypted HTTP with prior knowledge */
+    assert(run("pool, no h2c", true, false, true, NULL) == CLIENTS);
+    /* all requests multiplexed over a single connection */
+    assert(run("pool, h2c", true, true, true, NULL) == 1);
+    /* fallback to HTTP/1.1 when the server does not support h2c */
+    unsigned count = run("pool, no server", false, true, true, NULL);
+    assert(count > CLIENTS && count <= 2 * CLIENTS);
+    /* HTTP/2 negotiated over TLS, multiplexed */
+    assert(run("pool, TLS h2", true, false, true, "h2") == 1);
+    /* the HTTP/1.1 TLS session is handed over, and not tried again */
+    assert(run("pool, TLS http/1.1", false, false, true, "http/1.1")
+           == CLIENTS);
+    return 0;
+}
@@ -41,6 +41,7 @@
 
 #include "h2frame.h"
 #include "h2output.h"
+#include "hpack.h"
 #include "conn.h"
 #include "message.h"
 
@@ -52,6 +53,7 @@ struct vlc_h2_conn
 {
     struct vlc_http_conn conn;
     struct vlc_h2_output *out; /**< Send thread */
+    struct hpack_encoder *encoder; /**< Header compressor */
     void *opaque;
 
     struct vlc_h2_stream *streams; /**< List of open streams */
@@ -539,11 +541,17 @@ static struct vlc_http_stream *vlc_h2_stream_open(struct vlc_http_conn *c,
     s->id = conn->next_id;
     conn->next_id += 2;
 
-    struct vlc_h2_frame *f = vlc_http_msg_h2_frame(msg, s->id, !has_data);
-    if (f == NULL)
+    /* Header blocks are compressed and queued in the same order,
+     * as the HPACK compression state depends on it. */
+    struct vlc_h2_frame *f = vlc_http_msg_h2_frame(msg, conn->encoder, s->id,
+                                                   !has_data);
+    if (f == NULL || vlc_h2_conn_queue(conn, f))
+    {   /* The HPACK encoder state may no longer match the peer decoder,
+         * so that no further header block can be sent. */
+        vlc_http_err(CO(conn), "cannot send header block");
+        conn->next_id = 0x80000000;
         goto error;
-
-    vlc_h2_conn_queue(conn, f);
+    }
 
     s->older = conn->streams;
     if (s->older != NULL)
@@ -586,6 +594,9 @@ static void vlc_h2_setting(void *ctx, uint_fast16_t id, uint_fast32_t value)
 
     switch (id)
     {
+        case VLC_H2_SETTING_HEADER_TABLE_SIZE:
+            hpack_encode_resize(conn->encoder, value);
+            break;
         case VLC_H2_SETTING_INITIAL_WINDOW_SIZE:
             vlc_h2_initial_window_update(conn, value);
             break;
@@ -825,8 +836,9 @@ static void *vlc_h2_recv_thread(void *data)
     vlc_cleanup_pop();
     vlc_h2_parse_destroy(parser);
 fail:
-    /* Terminate any remaining stream */
+    /* Terminate any remaining stream, and prevent adding new ones */
     vlc_mutex_lock(&conn->lock);
+    conn->next_id = 0x80000000;
     for (struct vlc_h2_stream *s = conn->streams; s != NULL; s = s->older)
         vlc_h2_stream_reset(s, VLC_H2_CANCEL);
     vlc_mutex_unlock(&conn->lock);
@@ -846,6 +858,7 @@ static void vlc_h2_conn_destroy(struct vlc_h2_conn *conn)
     vlc_tls_Shutdown(conn->conn.tls, true);
 
     vlc_tls_Close(conn->conn.tls);
+    hpack_encode_destroy(conn->encoder);
     free(conn);
 }
 
@@ -880,6 +893,8 @@ struct vlc_http_conn *vlc_h2_conn_create(void *ctx, struct vlc_tls *tls)
     conn->conn.cbs = &vlc_h2_conn_callbacks;
     conn->conn.tls = tls;
     conn->out = vlc_h2_output_create(tls, true);
+    /* Larger header table sizes advertised by the peer are not used */
+    conn->encoder = hpack_encode_init(VLC_H2_DEFAULT_MAX_HEADER_TABLE);
     conn->opaque = ctx;
     conn->streams = NULL;
     conn->next_id = 1; /* TODO: server side */
@@ -890,6 +905,11 @@ struct vlc_http_conn *vlc_h2_conn_create(void *ctx, struct vlc_tls *tls)
 
     if (unlikely(conn->out == NULL))
         goto error;
+    if (unlikely(conn->encoder == NULL))
+    {
+        vlc_h2_output_destroy(conn->out);
+        goto error;
+    }
 
     vlc_mutex_init(&conn->lock);
     vlc_cond_init(&conn->send_wait);
@@ -902,6 +922,8 @@ struct vlc_http_conn *vlc_h2_conn_create(void *ctx, struct vlc_tls *tls)
     }
     return &conn->conn;
 error:
+    if (conn->encoder != NULL)
+        hpack_encode_destroy(conn->encoder);
     free(conn);
     return NULL;
 }
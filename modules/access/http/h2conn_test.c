@@ -139,7 +139,7 @@ static void stream_reply(uint_fast32_t id, bool nodata)
     assert(m != NULL);
     vlc_http_msg_add_agent(m, "VLC-h2-tester");
 
-    conn_send(vlc_http_msg_h2_frame(m, id, nodata));
+    conn_send(vlc_http_msg_h2_frame(m, NULL, id, nodata));
     vlc_http_msg_destroy(m);
 }
 
@@ -149,7 +149,8 @@ static void stream_continuation(uint_fast32_t id)
         { ":status", "100" },
     };
 
-    conn_send(vlc_h2_frame_headers(id, VLC_H2_DEFAULT_MAX_FRAME, false, 1, h));
+    conn_send(vlc_h2_frame_headers(NULL, id, VLC_H2_DEFAULT_MAX_FRAME, false,
+                                   1, h));
 }
 
 static void stream_data(uint_fast32_t id, const char *str, bool eos)
@@ -151,14 +151,35 @@ enum {
     VLC_H2_CONTINUATION_END_HEADERS = 0x04,
 };
 
+/**
+ * Compresses a header block.
+ *
+ * If an HPACK encoder is provided, the buffer must be large enough, as
+ * the encoder state cannot be rolled back.
+ */
+static size_t vlc_h2_hpack_encode(struct hpack_encoder *enc,
+                                  uint8_t *restrict buf, size_t size,
+                                  unsigned count,
+                                  const char *const headers[][2])
+{
+    if (enc == NULL)
+        return hpack_encode(buf, size, headers, count);
+
+    size_t len = hpack_encode_block(enc, buf, size, headers, count);
+    assert(len <= size);
+    return len;
+}
+
 struct vlc_h2_frame *
-vlc_h2_frame_headers(uint_fast32_t stream_id, uint_fast32_t mtu, bool eos,
+vlc_h2_frame_headers(struct hpack_encoder *enc, uint_fast32_t stream_id,
+                     uint_fast32_t mtu, bool eos,
                      unsigned count, const char *const headers[][2])
 {
     struct vlc_h2_frame *f;
     uint8_t flags = eos ? VLC_H2_HEADERS_END_STREAM : 0;
 
-    size_t len = hpack_encode(NULL, 0, headers, count);
+    size_t len = (enc != NULL) ? hpack_encode_bound(headers, count)
+                               : hpack_encode(NULL, 0, headers, count);
 
     if (likely(len <= mtu))
     {   /* Most common case: single frame - with zero copy */
@@ -168,47 +189,71 @@ vlc_h2_frame_headers(uint_fast32_t stream_id, uint_fast32_t mtu, bool eos,
         if (unlikely(f == NULL))
             return NULL;
 
-        hpack_encode(vlc_h2_frame_payload(f), len, headers, count);
+        /* Shrink the frame down from the worst case length */
+        len = vlc_h2_hpack_encode(enc, vlc_h2_frame_payload(f), len,
+                                  count, headers);
+        f->data[0] = len >> 16;
+        f->data[1] = len >> 8;
+        f->data[2] = len;
         return f;
     }
 
-    /* Edge case: HEADERS frame then CONTINUATION frame(s) */
+    /* Edge case: HEADERS frame then CONTINUATION frame(s)
+     * All the frames the worst case length may need are allocated before
+     * compressing, so that no allocation fails once the encoder state was
+     * updated. */
     uint8_t *payload = malloc(len);
     if (unlikely(payload == NULL))
         return NULL;
 
-    hpack_encode(payload, len, headers, count);
-
     struct vlc_h2_frame **pp = &f, *n;
-    const uint8_t *offset = payload;
     uint_fast8_t type = VLC_H2_FRAME_HEADERS;
 
     f = NULL;
 
-    while (len > mtu)
+    for (size_t left = len; left > 0; left -= (left > mtu) ? mtu : left)
     {
         n = vlc_h2_frame_alloc(type, flags, stream_id, mtu);
         if (unlikely(n == NULL))
             goto error;
 
-        memcpy(vlc_h2_frame_payload(n), offset, mtu);
         *pp = n;
         pp = &n->next;
-
         type = VLC_H2_FRAME_CONTINUATION;
         flags = 0;
-        offset += mtu;
-        len -= mtu;
     }
 
-    flags |= VLC_H2_CONTINUATION_END_HEADERS;
+    len = vlc_h2_hpack_encode(enc, payload, len, count, headers);
 
-    n = vlc_h2_frame_alloc(type, flags, stream_id, len);
-    if (unlikely(n == NULL))
-        goto error;
+    const uint8_t *offset = payload;
 
-    memcpy(vlc_h2_frame_payload(n), offset, len);
-    *pp = n;
+    for (n = f;; n = n->next)
+    {
+        size_t n_len = (len > mtu) ? mtu : len;
+
+        memcpy(vlc_h2_frame_payload(n), offset, n_len);
+        offset += n_len;
+        len -= n_len;
+
+        if (len == 0)
+        {   /* Last frame: shrink it and drop the unused ones */
+            n->data[0] = n_len >> 16;
+            n->data[1] = n_len >> 8;
+            n->data[2] = n_len;
+            n->data[4] |= VLC_H2_CONTINUATION_END_HEADERS;
+
+            struct vlc_h2_frame *unused = n->next;
+
+            n->next = NULL;
+            while (unused != NULL)
+            {
+                n = unused->next;
+                free(unused);
+                unused = n;
+            }
+            break;
+        }
+    }
 
     free(payload);
     return f;
@@ -35,8 +35,11 @@ struct vlc_h2_frame
 
 size_t vlc_h2_frame_size(const struct vlc_h2_frame *);
 
+struct hpack_encoder;
+
 struct vlc_h2_frame *
-vlc_h2_frame_headers(uint_fast32_t stream_id, uint_fast32_t mtu, bool eos,
+vlc_h2_frame_headers(struct hpack_encoder *enc, uint_fast32_t stream_id,
+                     uint_fast32_t mtu, bool eos,
                      unsigned count, const char *const headers[][2]);
 struct vlc_h2_frame *
 vlc_h2_frame_data(uint_fast32_t stream_id, const void *buf, size_t len,
@@ -32,6 +32,7 @@
 #include <string.h>
 
 #include "h2frame.h"
+#include "hpack.h"
 #include <vlc_common.h>
 #include "conn.h"
 
@@ -272,7 +273,16 @@ static struct vlc_h2_frame *localize(struct vlc_h2_frame *f)
 static struct vlc_h2_frame *response(bool eos)
 {
     /* Use ridiculously small MTU to test headers fragmentation */
-    return vlc_h2_frame_headers(STREAM_ID, 16, eos, resp_hdrc, resp_hdrv);
+    return vlc_h2_frame_headers(NULL, STREAM_ID, 16, eos,
+                                resp_hdrc, resp_hdrv);
+}
+
+static struct hpack_encoder *encoder;
+
+static struct vlc_h2_frame *compressed_response(bool eos)
+{
+    return vlc_h2_frame_headers(encoder, STREAM_ID, 16, eos,
+                                resp_hdrc, resp_hdrv);
 }
 
 static struct vlc_h2_frame *data(bool eos)
@@ -305,6 +315,15 @@ static struct vlc_h2_frame *unknown(void)
     return retype(ping(), 200);
 }
 
+static size_t chain_size(const struct vlc_h2_frame *f)
+{
+    size_t size = 0;
+
+    for (; f != NULL; f = f->next)
+        size += vlc_h2_frame_size(f);
+    return size;
+}
+
 /* Test harness */
 static unsigned test_raw_seqv(struct vlc_h2_parser *p, va_list ap)
 {
@@ -461,7 +480,7 @@ int main(void)
 
     ret = test_seq(CTX, rst_stream(),
                         vlc_h2_frame_window_update(0, 0x1000),
-                        vlc_h2_frame_headers(STREAM_ID + 2,
+                        vlc_h2_frame_headers(NULL, STREAM_ID + 2,
                                              VLC_H2_DEFAULT_MAX_FRAME, true,
                                              resp_hdrc, resp_hdrv),
                         NULL);
@@ -471,6 +490,26 @@ int main(void)
     assert(stream_blocks == 0);
     assert(stream_ends == 0);
 
+    /* Stateful header compression, with table size changes */
+    encoder = hpack_encode_init(VLC_H2_MAX_HEADER_TABLE);
+    assert(encoder != NULL);
+
+    struct vlc_h2_frame *first = compressed_response(false);
+    struct vlc_h2_frame *second = compressed_response(false);
+    assert(first != NULL && second != NULL);
+    assert(chain_size(second) < chain_size(first));
+
+    hpack_encode_resize(encoder, 0);
+    hpack_encode_resize(encoder, 128);
+    struct vlc_h2_frame *third = compressed_response(true);
+
+    ret = test_seq(CTX, first, data(false), second, data(false), third, NULL);
+    assert(ret == 5);
+    assert(stream_header_tables == 3);
+    assert(stream_blocks == 2);
+    assert(stream_ends == 1);
+    hpack_encode_destroy(encoder);
+
     test_preface_fail();
     test_header_block_fail();
 
@@ -37,7 +37,7 @@
 #include "hpack.h"
 
 /** Static Table header names */
-static const char hpack_names[][28] =
+const char hpack_names[HPACK_STATIC_ENTRIES][28] =
 {
     ":authority", ":method", ":method", ":path", ":path", ":scheme", ":scheme",
     ":status", ":status", ":status", ":status", ":status", ":status",
@@ -55,7 +55,7 @@ static const char hpack_names[][28] =
 };
 
 /** Static Table header values */
-static const char hpack_values[][14] =
+const char hpack_values[HPACK_STATIC_VALUES][14] =
 {
     "", "GET", "POST", "/", "/index.html", "http", "https", "200", "204",
     "206", "304", "400", "404", "500", "", "gzip, deflate"
@@ -67,6 +67,7 @@ struct hpack_decoder
     size_t entries;
     size_t size;
     size_t max_size;
+    size_t limit; /**< Upper bound for the dynamic table size */
 };
 
 struct hpack_decoder *hpack_decode_init(size_t header_table_size)
@@ -79,6 +80,7 @@ struct hpack_decoder *hpack_decode_init(size_t header_table_size)
     dec->entries = 0;
     dec->size = 0;
     dec->max_size = header_table_size;
+    dec->limit = header_table_size;
     return dec;
 }
 
@@ -534,8 +536,8 @@ static int hpack_decode_tbl_update(struct hpack_decoder *dec,
     if (max < 0)
         return -1;
 
-    if ((size_t)max > dec->max_size)
-    {   /* Increasing the maximum is not permitted per the specification */
+    if ((size_t)max > dec->limit)
+    {   /* Exceeding the protocol setting is not permitted */
         errno = EINVAL;
         return -1;
     }
@@ -25,6 +25,14 @@
  * @{
  */
 
+/** Number of entries in the HPACK static table */
+#define HPACK_STATIC_ENTRIES 61
+/** Number of leading static table entries with a non-empty value */
+#define HPACK_STATIC_VALUES  16
+
+extern const char hpack_names[HPACK_STATIC_ENTRIES][28];
+extern const char hpack_values[HPACK_STATIC_VALUES][14];
+
 struct hpack_decoder;
 
 struct hpack_decoder *hpack_decode_init(size_t header_table_size);
@@ -38,4 +46,40 @@ size_t hpack_encode_hdr_neverindex(uint8_t *restrict buf, size_t size,
 size_t hpack_encode(uint8_t *restrict buf, size_t size,
                     const char *const headers[][2], unsigned count);
 
+struct hpack_encoder;
+
+/**
+ * Creates a stateful HPACK compressor.
+ *
+ * \param header_table_size initial and maximum dynamic table size
+ */
+struct hpack_encoder *hpack_encode_init(size_t header_table_size);
+void hpack_encode_destroy(struct hpack_encoder *);
+
+/**
+ * Changes the dynamic table size.
+ *
+ * The size is capped to the value passed to hpack_encode_init().
+ * The change is signaled to the decoder at the start of the next header block.
+ */
+void hpack_encode_resize(struct hpack_encoder *, size_t header_table_size);
+
+/**
+ * Computes the worst-case length of a compressed header block.
+ */
+size_t hpack_encode_bound(const char *const headers[][2], unsigned count);
+
+/**
+ * Compresses a header block, updating the dynamic table.
+ *
+ * Unlike hpack_encode(), this function changes the encoder state, and must
+ * be called exactly once per header block, in transmission order.
+ *
+ * \param size buffer size, at least hpack_encode_bound() bytes
+ * \return the compressed header block length
+ */
+size_t hpack_encode_block(struct hpack_encoder *enc, uint8_t *restrict buf,
+                          size_t size, const char *const headers[][2],
+                          unsigned count);
+
 /** @} */
@@ -27,19 +27,20 @@
 #endif
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "hpack.h"
 
 /*
- * This is currently the simplest possible HPACK compressor: it does not
+ * hpack_encode() is the simplest possible HPACK compressor: it does not
  * compress anything and is stateless.
- * TODO:
- *  - use static Huffman compression when useful,
- *  - use header names and values from the static HPACK table,
- *  - become stateful and let the caller specify the indexed flag,
- *  - let caller specify the never-indexed flag.
+ *
+ * hpack_encode_block() is a stateful compressor using the static table,
+ * the dynamic table and Huffman coding. It must be fed the header blocks of
+ * a given connection in transmission order.
  */
 
 static size_t hpack_encode_int(uint8_t *restrict buf, size_t size,
@@ -175,11 +176,472 @@ size_t hpack_encode(uint8_t *restrict buf, size_t size,
     return ret;
 }
 
+/*** Stateful compression ***/
+
+/** Huffman code (RFC 7541 appendix B) */
+static const struct
+{
+    uint32_t code;
+    uint8_t length;
+} hpack_huffman[256] =
+{
+    { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 },
+    { 0xfffffe4, 28 }, { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 },
+    { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+    { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 },
+    { 0xfffffec, 28 }, { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 },
+    { 0xffffff0, 28 }, { 0xffffff1, 28 }, { 0xffffff2, 28 },
+    { 0x3ffffffe, 30 }, { 0xffffff3, 28 }, { 0xffffff4, 28 },
+    { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 }, { 0xffffff8, 28 },
+    { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 }, { 0x14, 6 },
+    { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 }, { 0x1ff9, 13 }, { 0x15, 6 },
+    { 0xf8, 8 }, { 0x7fa, 11 }, { 0x3fa, 10 }, { 0x3fb, 10 }, { 0xf9, 8 },
+    { 0x7fb, 11 }, { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 },
+    { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 }, { 0x1a, 6 }, { 0x1b, 6 },
+    { 0x1c, 6 }, { 0x1d, 6 }, { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 },
+    { 0xfb, 8 }, { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 },
+    { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 }, { 0x5f, 7 },
+    { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 }, { 0x63, 7 }, { 0x64, 7 },
+    { 0x65, 7 }, { 0x66, 7 }, { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 },
+    { 0x6a, 7 }, { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+    { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 }, { 0xfc, 8 },
+    { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 }, { 0x7fff0, 19 }, { 0x1ffc, 13 },
+    { 0x3ffc, 14 }, { 0x22, 6 }, { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 },
+    { 0x4, 5 }, { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 }, { 0x27, 6 },
+    { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 }, { 0x28, 6 }, { 0x29, 6 },
+    { 0x2a, 6 }, { 0x7, 5 }, { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 },
+    { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 }, { 0x79, 7 },
+    { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 }, { 0x7fc, 11 }, { 0x3ffd, 14 },
+    { 0x1ffd, 13 }, { 0xffffffc, 28 }, { 0xfffe6, 20 }, { 0x3fffd2, 22 },
+    { 0xfffe7, 20 }, { 0xfffe8, 20 }, { 0x3fffd3, 22 }, { 0x3fffd4, 22 },
+    { 0x3fffd5, 22 }, { 0x7fffd9, 23 }, { 0x3fffd6, 22 }, { 0x7fffda, 23 },
+    { 0x7fffdb, 23 }, { 0x7fffdc, 23 }, { 0x7fffdd, 23 }, { 0x7fffde, 23 },
+    { 0xffffeb, 24 }, { 0x7fffdf, 23 }, { 0xffffec, 24 }, { 0xffffed, 24 },
+    { 0x3fffd7, 22 }, { 0x7fffe0, 23 }, { 0xffffee, 24 }, { 0x7fffe1, 23 },
+    { 0x7fffe2, 23 }, { 0x7fffe3, 23 }, { 0x7fffe4, 23 }, { 0x1fffdc, 21 },
+    { 0x3fffd8, 22 }, { 0x7fffe5, 23 }, { 0x3fffd9, 22 }, { 0x7fffe6, 23 },
+    { 0x7fffe7, 23 }, { 0xffffef, 24 }, { 0x3fffda, 22 }, { 0x1fffdd, 21 },
+    { 0xfffe9, 20 }, { 0x3fffdb, 22 }, { 0x3fffdc, 22 }, { 0x7fffe8, 23 },
+    { 0x7fffe9, 23 }, { 0x1fffde, 21 }, { 0x7fffea, 23 }, { 0x3fffdd, 22 },
+    { 0x3fffde, 22 }, { 0xfffff0, 24 }, { 0x1fffdf, 21 }, { 0x3fffdf, 22 },
+    { 0x7fffeb, 23 }, { 0x7fffec, 23 }, { 0x1fffe0, 21 }, { 0x1fffe1, 21 },
+    { 0x3fffe0, 22 }, { 0x1fffe2, 21 }, { 0x7fffed, 23 }, { 0x3fffe1, 22 },
+    { 0x7fffee, 23 }, { 0x7fffef, 23 }, { 0xfffea, 20 }, { 0x3fffe2, 22 },
+    { 0x3fffe3, 22 }, { 0x3fffe4, 22 }, { 0x7ffff0, 23 }, { 0x3fffe5, 22 },
+    { 0x3fffe6, 22 }, { 0x7ffff1, 23 }, { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 },
+    { 0xfffeb, 20 }, { 0x7fff1, 19 }, { 0x3fffe7, 22 }, { 0x7ffff2, 23 },
+    { 0x3fffe8, 22 }, { 0x1ffffec, 25 }, { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 },
+    { 0x3ffffe4, 26 }, { 0x7ffffde, 27 }, { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 },
+    { 0xfffff1, 24 }, { 0x1ffffed, 25 }, { 0x7fff2, 19 }, { 0x1fffe3, 21 },
+    { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 }, { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 },
+    { 0x7ffffe2, 27 }, { 0xfffff2, 24 }, { 0x1fffe4, 21 }, { 0x1fffe5, 21 },
+    { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 }, { 0xffffffd, 28 }, { 0x7ffffe3, 27 },
+    { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 }, { 0xfffec, 20 }, { 0xfffff3, 24 },
+    { 0xfffed, 20 }, { 0x1fffe6, 21 }, { 0x3fffe9, 22 }, { 0x1fffe7, 21 },
+    { 0x1fffe8, 21 }, { 0x7ffff3, 23 }, { 0x3fffea, 22 }, { 0x3fffeb, 22 },
+    { 0x1ffffee, 25 }, { 0x1ffffef, 25 }, { 0xfffff4, 24 }, { 0xfffff5, 24 },
+    { 0x3ffffea, 26 }, { 0x7ffff4, 23 }, { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 },
+    { 0x3ffffec, 26 }, { 0x3ffffed, 26 }, { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 },
+    { 0x7ffffe9, 27 }, { 0x7ffffea, 27 }, { 0x7ffffeb, 27 }, { 0xffffffe, 28 },
+    { 0x7ffffec, 27 }, { 0x7ffffed, 27 }, { 0x7ffffee, 27 }, { 0x7ffffef, 27 },
+    { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+};
+
+static unsigned char hpack_tolower(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static size_t hpack_huffman_length(const char *str, size_t len, bool lower)
+{
+    uint_fast64_t bits = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = str[i];
+
+        bits += hpack_huffman[lower ? hpack_tolower(c) : c].length;
+    }
+    return (bits + 7) / 8;
+}
+
+static void hpack_encode_huffman(uint8_t *restrict buf, size_t size,
+                                 const char *str, size_t len, bool lower)
+{
+    uint_fast64_t acc = 0;
+    unsigned bits = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = str[i];
+
+        if (lower)
+            c = hpack_tolower(c);
+
+        /* At most 7 pending bits plus a 30-bits code: no overflow */
+        acc = (acc << hpack_huffman[c].length) | hpack_huffman[c].code;
+        bits += hpack_huffman[c].length;
+
+        while (bits >= 8)
+        {
+            bits -= 8;
+            if (size > 0)
+            {
+                *(buf++) = acc >> bits;
+                size--;
+            }
+        }
+    }
+
+    /* Pad with the most significant bits of EOS */
+    if (bits > 0 && size > 0)
+        *buf = (acc << (8 - bits)) | (0xFF >> bits);
+}
+
+/**
+ * Encodes a string literal, with Huffman coding unless it would be longer.
+ */
+static size_t hpack_encode_str(uint8_t *restrict buf, size_t size,
+                               const char *str, bool lower)
+{
+    size_t len = strlen(str);
+    size_t hlen = hpack_huffman_length(str, len, lower);
+
+    if (hlen > len)
+        return (lower ? hpack_encode_str_raw_lower : hpack_encode_str_raw)
+                   (buf, size, str);
+
+    if (size > 0)
+        *buf = 0x80;
+
+    size_t ret = hpack_encode_int(buf, size, hlen, 7);
+    if (ret < size)
+        hpack_encode_huffman(buf + ret, size - ret, str, len, lower);
+    ret += hlen;
+    return ret;
+}
+
+struct hpack_encoder
+{
+    char **table; /**< Dynamic table entries, oldest first */
+    size_t entries;
+    size_t size;
+    size_t max_size; /**< Current dynamic table size */
+    size_t limit; /**< Upper bound for the dynamic table size */
+    size_t min_size; /**< Smallest table size since last size update */
+    bool resized; /**< Whether a dynamic table size update is pending */
+};
+
+struct hpack_encoder *hpack_encode_init(size_t header_table_size)
+{
+    struct hpack_encoder *enc = malloc(sizeof (*enc));
+    if (enc == NULL)
+        return NULL;
+
+    enc->table = NULL;
+    enc->entries = 0;
+    enc->size = 0;
+    enc->max_size = header_table_size;
+    enc->limit = header_table_size;
+    enc->min_size = header_table_size;
+    enc->resized = false;
+    return enc;
+}
+
+void hpack_encode_destroy(struct hpack_encoder *enc)
+{
+    for (size_t i = 0; i < enc->entries; i++)
+        free(enc->table[i]);
+    free(enc->table);
+    free(enc);
+}
+
+static size_t hpack_entry_size(const char *entry)
+{
+    size_t namelen = strlen(entry);
+
+    return 32 + namelen + strlen(entry + namelen + 1);
+}
+
+static void hpack_encode_evict(struct hpack_encoder *enc, size_t max)
+{
+    size_t evicted = 0;
+
+    while (enc->size > max)
+    {
+        assert(evicted < enc->entries);
+        enc->size -= hpack_entry_size(enc->table[evicted]);
+        free(enc->table[evicted]);
+        evicted++;
+    }
+
+    if (evicted > 0)
+    {
+        enc->entries -= evicted;
+        memmove(enc->table, enc->table + evicted,
+                sizeof (enc->table[0]) * enc->entries);
+    }
+}
+
+void hpack_encode_resize(struct hpack_encoder *enc, size_t header_table_size)
+{
+    if (header_table_size > enc->limit)
+        header_table_size = enc->limit;
+    if (header_table_size == enc->max_size)
+        return;
+
+    if (header_table_size < enc->min_size)
+        enc->min_size = header_table_size;
+    enc->max_size = header_table_size;
+    enc->resized = true;
+    hpack_encode_evict(enc, header_table_size);
+}
+
+static bool hpack_name_equal(const char *name, const char *lower)
+{
+    unsigned char c;
+
+    do
+    {
+        c = hpack_tolower(*(name++));
+        if (c != (unsigned char)*(lower++))
+            return false;
+    }
+    while (c != '\0');
+
+    return true;
+}
+
+/**
+ * Looks up a header in the static and dynamic tables.
+ *
+ * \param name_idx index of an entry with the same name [OUT]
+ * \return the index of an entry with the same name and value, or 0
+ */
+static size_t hpack_encode_lookup(const struct hpack_encoder *enc,
+                                  const char *name, const char *value,
+                                  size_t *restrict name_idx)
+{
+    *name_idx = 0;
+
+    for (size_t i = 0; i < HPACK_STATIC_ENTRIES; i++)
+    {
+        if (!hpack_name_equal(name, hpack_names[i]))
+            continue;
+
+        const char *v = (i < HPACK_STATIC_VALUES) ? hpack_values[i] : "";
+
+        if (!strcmp(value, v))
+            return i + 1;
+        if (*name_idx == 0)
+            *name_idx = i + 1;
+    }
+
+    for (size_t i = 0; i < enc->entries; i++)
+    {
+        const char *entry = enc->table[enc->entries - (i + 1)];
+
+        if (!hpack_name_equal(name, entry))
+            continue;
+
+        if (!strcmp(value, entry + strlen(entry) + 1))
+            return HPACK_STATIC_ENTRIES + i + 1;
+        if (*name_idx == 0)
+            *name_idx = HPACK_STATIC_ENTRIES + i + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Checks whether a header should never be stored in any compression table,
+ * so that its value cannot be guessed from the compressed length.
+ */
+static bool hpack_is_sensitive(const char *name)
+{
+    static const char names[][20] = {
+        "authorization", "cookie", "proxy-authorization", "set-cookie",
+    };
+
+    for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); i++)
+        if (hpack_name_equal(name, names[i]))
+            return true;
+    return false;
+}
+
+/**
+ * Checks whether a header value is expected to change on every request.
+ * Indexing those would only evict useful entries from the dynamic table.
+ */
+static bool hpack_is_volatile(const char *name)
+{
+    return hpack_name_equal(name, ":path") || hpack_name_equal(name, "range");
+}
+
+/**
+ * Inserts an entry at the head of the dynamic table.
+ * \return 0 on success, -1 on memory error (the table is then unchanged).
+ */
+static int hpack_encode_append(struct hpack_encoder *enc,
+                               const char *name, const char *value)
+{
+    size_t namelen = strlen(name), valuelen = strlen(value);
+    char *entry = malloc(namelen + valuelen + 2);
+    if (entry == NULL)
+        return -1;
+
+    for (size_t i = 0; i <= namelen; i++)
+        entry[i] = hpack_tolower(name[i]);
+    memcpy(entry + namelen + 1, value, valuelen + 1);
+
+    char **newtab = realloc(enc->table,
+                            sizeof (enc->table[0]) * (enc->entries + 1));
+    if (newtab == NULL)
+    {
+        free(entry);
+        return -1;
+    }
+
+    enc->table = newtab;
+    /* Evict before appending, as the decoder does the same afterward */
+    hpack_encode_evict(enc, enc->max_size - (32 + namelen + valuelen));
+    enc->table[enc->entries++] = entry;
+    enc->size += 32 + namelen + valuelen;
+    return 0;
+}
+
+static size_t hpack_encode_hdr(struct hpack_encoder *enc,
+                               uint8_t *restrict buf, size_t size,
+                               const char *name, const char *value)
+{
+    bool sensitive = hpack_is_sensitive(name);
+    size_t name_idx;
+    size_t idx = hpack_encode_lookup(enc, name, value, &name_idx);
+
+    if (idx != 0 && !sensitive)
+    {   /* Indexed header field */
+        if (size > 0)
+            *buf = 0x80;
+        return hpack_encode_int(buf, size, idx, 7);
+    }
+
+    uint8_t prefix;
+    unsigned n;
+
+    if (sensitive)
+    {   /* Literal header field never indexed */
+        prefix = 0x10;
+        n = 4;
+    }
+    else
+    if (!hpack_is_volatile(name)
+     && 32 + strlen(name) + strlen(value) <= enc->max_size
+     && hpack_encode_append(enc, name, value) == 0)
+    {   /* Literal header field with incremental indexing */
+        prefix = 0x40;
+        n = 6;
+    }
+    else
+    {   /* Literal header field without indexing */
+        prefix = 0x00;
+        n = 4;
+    }
+
+    if (size > 0)
+        *buf = prefix;
+
+    size_t ret = hpack_encode_int(buf, size, name_idx, n), val;
+    if (size >= ret)
+    {
+        buf += ret;
+        size -= ret;
+    }
+    else
+        size = 0;
+
+    if (name_idx == 0)
+    {
+        val = hpack_encode_str(buf, size, name, true);
+        if (size >= val)
+        {
+            buf += val;
+            size -= val;
+        }
+        else
+            size = 0;
+        ret += val;
+    }
+
+    ret += hpack_encode_str(buf, size, value, false);
+    return ret;
+}
+
+static size_t hpack_encode_tbl_update(uint8_t *restrict buf, size_t size,
+                                      size_t max)
+{
+    if (size > 0)
+        *buf = 0x20;
+    return hpack_encode_int(buf, size, max, 5);
+}
+
+/** Worst case length of the dynamic table size updates */
+#define HPACK_UPDATES_BOUND (2 * (1 + (sizeof (size_t) * 8 + 6) / 7))
+
+size_t hpack_encode_bound(const char *const headers[][2], unsigned count)
+{
+    /* The never-indexed raw literal representation from hpack_encode() is
+     * never shorter than the representation chosen by hpack_encode_hdr():
+     * indices are at most 2 bytes long with the default table sizes, and
+     * Huffman coding is only used when it is shorter. */
+    return hpack_encode(NULL, 0, headers, count) + HPACK_UPDATES_BOUND;
+}
+
+size_t hpack_encode_block(struct hpack_encoder *enc, uint8_t *restrict buf,
+                          size_t size, const char *const headers[][2],
+                          unsigned count)
+{
+    size_t ret = 0, val;
+
+    if (enc->resized)
+    {   /* Signal the smallest size, so the decoder evicts the same entries */
+        if (enc->min_size < enc->max_size)
+        {
+            val = hpack_encode_tbl_update(buf, size, enc->min_size);
+            assert(val <= size);
+            buf += val;
+            size -= val;
+            ret += val;
+        }
+
+        val = hpack_encode_tbl_update(buf, size, enc->max_size);
+        assert(val <= size);
+        buf += val;
+        size -= val;
+        ret += val;
+
+        enc->min_size = enc->max_size;
+        enc->resized = false;
+    }
+
+    while (count > 0)
+    {
+        val = hpack_encode_hdr(enc, buf, size, headers[0][0], headers[0][1]);
+        assert(val <= size);
+        buf += val;
+        size -= val;
+
+        ret += val;
+        headers++;
+        count--;
+    }
+    return ret;
+}
+
 /*** Test cases ***/
 #ifdef ENC_TEST
 # include <stdarg.h>
-# include <stdlib.h>
 # include <stdio.h>
+# include <time.h>
 
 static void test_integer(unsigned n, uintmax_t value)
 {
@@ -287,10 +749,230 @@ static void test_resps(void)
                NULL);
 }
 
+static void test_rfc_block(struct hpack_encoder *enc, const char *expect,
+                           size_t len, const char *const headers[][2],
+                           unsigned count)
+{
+    uint8_t buf[256];
+
+    assert(hpack_encode_bound(headers, count) <= sizeof (buf));
+    assert(hpack_encode_block(enc, buf, sizeof (buf), headers, count) == len);
+    assert(!memcmp(buf, expect, len));
+}
+
+static void test_rfc(void)
+{
+    /* RFC 7541 C.4: requests with Huffman coding */
+    static const char *const req1[][2] = {
+        { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+        { ":authority", "www.example.com" },
+    };
+    static const char *const req2[][2] = {
+        { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+        { ":authority", "www.example.com" }, { "cache-control", "no-cache" },
+    };
+    static const char *const req3[][2] = {
+        { ":method", "GET" }, { ":scheme", "https" },
+        { ":path", "/index.html" }, { ":authority", "www.example.com" },
+        { "Custom-Key", "custom-value" },
+    };
+    struct hpack_encoder *enc = hpack_encode_init(4096);
+    assert(enc != NULL);
+
+    test_rfc_block(enc, "\x82\x86\x84\x41\x8c\xf1\xe3\xc2\xe5\xf2\x3a\x6b\xa0"
+                   "\xab\x90\xf4\xff", 17, req1, 4);
+    test_rfc_block(enc, "\x82\x86\x84\xbe\x58\x86\xa8\xeb\x10\x64\x9c\xbf", 12,
+                   req2, 5);
+    test_rfc_block(enc, "\x82\x87\x85\xbf\x40\x88\x25\xa8\x49\xe9\x5b\xa9\x7d"
+                   "\x7f\x89\x25\xa8\x49\xe9\x5b\xb8\xe8\xb4\xbf", 24,
+                   req3, 5);
+    hpack_encode_destroy(enc);
+
+    /* RFC 7541 C.6: responses with Huffman coding and eviction */
+    static const char *const resp1[][2] = {
+        { ":status", "302" }, { "cache-control", "private" },
+        { "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+        { "location", "https://www.example.com" },
+    };
+    static const char *const resp2[][2] = {
+        { ":status", "307" }, { "cache-control", "private" },
+        { "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+        { "location", "https://www.example.com" },
+    };
+
+    enc = hpack_encode_init(256);
+    assert(enc != NULL);
+    test_rfc_block(enc, "\x48\x82\x64\x02\x58\x85\xae\xc3\x77\x1a\x4b\x61\x96"
+                   "\xd0\x7a\xbe\x94\x10\x54\xd4\x44\xa8\x20\x05\x95\x04\x0b"
+                   "\x81\x66\xe0\x82\xa6\x2d\x1b\xff\x6e\x91\x9d\x29\xad\x17"
+                   "\x18\x63\xc7\x8f\x0b\x97\xc8\xe9\xae\x82\xae\x43\xd3", 54,
+                   resp1, 4);
+    test_rfc_block(enc, "\x48\x83\x64\x0e\xff\xc1\xc0\xbf", 8, resp2, 4);
+    hpack_encode_destroy(enc);
+}
+
+static void test_roundtrip(struct hpack_encoder *enc,
+                           struct hpack_decoder *dec,
+                           const char *const headers[][2], unsigned count)
+{
+    uint8_t buf[8192];
+    char *eheaders[32][2];
+
+    size_t bound = hpack_encode_bound(headers, count);
+    assert(bound <= sizeof (buf));
+
+    size_t length = hpack_encode_block(enc, buf, bound, headers, count);
+    assert(length <= bound);
+
+    int ecount = hpack_decode(dec, buf, length, eheaders, 32);
+    assert((unsigned)ecount == count);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        test_lowercase(eheaders[i][0]);
+        assert(!strcasecmp(eheaders[i][0], headers[i][0]));
+        assert(!strcmp(eheaders[i][1], headers[i][1]));
+        free(eheaders[i][1]);
+        free(eheaders[i][0]);
+    }
+}
+
+static void test_huffman(void)
+{
+    /* Every possible octet, so every Huffman code is exercised */
+    char all[256];
+    for (unsigned i = 0; i < 255; i++)
+        all[i] = i + 1;
+    all[255] = '\0';
+
+    const char *const headers[][2] = {
+        { "x-all", all }, { all + 128, "x" }, { "Mixed-CASE", all + 200 },
+    };
+
+    struct hpack_encoder *enc = hpack_encode_init(4096);
+    struct hpack_decoder *dec = hpack_decode_init(4096);
+    assert(enc != NULL && dec != NULL);
+
+    for (unsigned i = 0; i < 3; i++)
+        test_roundtrip(enc, dec, headers, 3);
+
+    hpack_decode_destroy(dec);
+    hpack_encode_destroy(enc);
+}
+
+static void test_fuzz(void)
+{
+    static const char *const names[] = {
+        ":method", ":scheme", ":authority", ":path", "Accept", "range",
+        "user-agent", "authorization", "cookie", "x-custom", "if-none-match",
+    };
+    static const char *const values[] = {
+        "GET", "https", "", "/", "bytes=0-", "*/*", "gzip, deflate",
+        "example.org", "VLC/4.0.0 LibVLC/4.0.0", "no-cache",
+    };
+    const unsigned nnames = sizeof (names) / sizeof (names[0]);
+    const unsigned nvalues = sizeof (values) / sizeof (values[0]);
+    char random_values[16][64];
+
+    srand(42);
+
+    for (unsigned round = 0; round < 20; round++)
+    {
+        struct hpack_encoder *enc = hpack_encode_init(4096);
+        struct hpack_decoder *dec = hpack_decode_init(4096);
+        assert(enc != NULL && dec != NULL);
+
+        for (unsigned block = 0; block < 200; block++)
+        {
+            const char *headers[24][2];
+            unsigned count = rand() % 24;
+
+            if (rand() % 16 == 0)
+                hpack_encode_resize(enc, (rand() % 5) * 1024);
+            if (rand() % 64 == 0)
+            {   /* Several resizes between two header blocks */
+                hpack_encode_resize(enc, rand() % 128);
+                hpack_encode_resize(enc, 4096);
+            }
+
+            for (unsigned i = 0; i < count; i++)
+            {
+                headers[i][0] = names[rand() % nnames];
+
+                if (rand() % 4)
+                    headers[i][1] = values[rand() % nvalues];
+                else
+                {
+                    char *v = random_values[i % 16];
+                    size_t len = rand() % 64;
+
+                    for (size_t j = 0; j < len; j++)
+                        v[j] = 1 + rand() % 255;
+                    v[len] = '\0';
+                    headers[i][1] = v;
+                }
+            }
+
+            test_roundtrip(enc, dec, headers, count);
+        }
+
+        hpack_decode_destroy(dec);
+        hpack_encode_destroy(enc);
+    }
+}
+
+static void test_bench(void)
+{
+    /* Typical adaptive streaming segment requests over one connection */
+    enum { REQUESTS = 10000 };
+    char path[64], range[32];
+    const char *const headers[][2] = {
+        { ":method", "GET" },
+        { ":scheme", "https" },
+        { ":authority", "cdn.example.com" },
+        { ":path", path },
+        { "accept", "*/*" },
+        { "accept-language", "en_US" },
+        { "user-agent", "VLC/4.0.0 LibVLC/4.0.0" },
+        { "referer", "https://www.example.com/live/index.html" },
+        { "range", range },
+    };
+    const unsigned count = sizeof (headers) / sizeof (headers[0]);
+    uint8_t buf[1024];
+    size_t stateless = 0, stateful = 0;
+
+    struct hpack_encoder *enc = hpack_encode_init(4096);
+    assert(enc != NULL);
+
+    clock_t start = clock();
+
+    for (unsigned i = 0; i < REQUESTS; i++)
+    {
+        snprintf(path, sizeof (path), "/live/1080p/segment-%u.m4s", 1000 + i);
+        snprintf(range, sizeof (range), "bytes=%u-", (i % 4) * 65536);
+
+        stateless += hpack_encode(NULL, 0, headers, count);
+        stateful += hpack_encode_block(enc, buf, sizeof (buf), headers, count);
+    }
+
+    clock_t end = clock();
+
+    printf(" %u requests: %zu bytes uncompressed, %zu bytes compressed"
+           " (%.1f%%), %.0f ns per request\n", REQUESTS, stateless, stateful,
+           100. * stateful / stateless,
+           1e9 * (end - start) / CLOCKS_PER_SEC / REQUESTS);
+    assert(stateful * 3 < stateless);
+    hpack_encode_destroy(enc);
+}
+
 int main(void)
 {
     test_integers();
     test_reqs();
     test_resps();
+    test_rfc();
+    test_huffman();
+    test_fuzz();
+    test_bench();
 }
 #endif /* TEST */
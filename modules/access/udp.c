@@ -35,6 +35,12 @@
 # include "config.h"
 #endif
 
+#ifdef ENABLE_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_access.h>
@@ -47,19 +53,115 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#ifdef HAVE_RECVMMSG
+# include <netinet/udp.h>
+#endif
 
 /* Buffer can be max theoretical datagram content minus anticipated MTU.
  * IPv6 headers are larger than IPv4, ignore IPv6 jumbograms.
  */
 #define MRU 65507u
 
+#ifdef HAVE_RECVMMSG
+/* Ring of datagram slots filled by a single recvmmsg() call. The slots are
+ * allocated once, and handed out to the reader in order until the ring is
+ * drained, so that the receive path neither allocates nor issues one system
+ * call per datagram. */
+struct udp_ring
+{
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+    char *buf;
+    unsigned size; /* number of slots */
+    unsigned count; /* datagrams received by the last batch */
+    unsigned index; /* next datagram to hand out */
+};
+
+static int udp_ring_Init(struct udp_ring *ring, unsigned size)
+{
+    ring->msgs = vlc_alloc(size, sizeof (*ring->msgs));
+    ring->iovs = vlc_alloc(size, sizeof (*ring->iovs));
+    ring->buf = vlc_alloc(size, MRU);
+    if (unlikely(ring->msgs == NULL || ring->iovs == NULL || ring->buf == NULL))
+    {
+        free(ring->buf);
+        free(ring->iovs);
+        free(ring->msgs);
+        return VLC_ENOMEM;
+    }
+
+    for (unsigned i = 0; i < size; i++)
+    {
+        ring->iovs[i].iov_base = ring->buf + (size_t)i * MRU;
+        ring->iovs[i].iov_len = MRU;
+        memset(&ring->msgs[i], 0, sizeof (ring->msgs[i]));
+        ring->msgs[i].msg_hdr.msg_iov = &ring->iovs[i];
+        ring->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    ring->size = size;
+    ring->count = 0;
+    ring->index = 0;
+    return VLC_SUCCESS;
+}
+
+static void udp_ring_Clean(struct udp_ring *ring)
+{
+    free(ring->buf);
+    free(ring->iovs);
+    free(ring->msgs);
+}
+
+/**
+ * Receives as many pending datagrams as fit in the ring.
+ *
+ * The ring must have been drained. Unless flags contains MSG_WAITFORONE,
+ * the socket should be known to be readable.
+ *
+ * \return the number of datagrams received, or -1 on error
+ */
+static int udp_ring_Recv(struct udp_ring *ring, int fd, int flags)
+{
+    assert(ring->index == ring->count);
+
+    int val = recvmmsg(fd, ring->msgs, ring->size, flags, NULL);
+
+    ring->index = 0;
+    ring->count = (val > 0) ? val : 0;
+    return val;
+}
+
+/**
+ * Takes the next received datagram out of the ring.
+ *
+ * \return a pointer to the payload, or NULL if the ring is drained
+ */
+static char *udp_ring_Get(struct udp_ring *ring, size_t *restrict len,
+                          bool *restrict truncated)
+{
+    if (ring->index >= ring->count)
+        return NULL;
+
+    const struct mmsghdr *msg = &ring->msgs[ring->index];
+
+    *len = msg->msg_len;
+    *truncated = (msg->msg_hdr.msg_flags & MSG_TRUNC) != 0;
+    return ring->iovs[ring->index++].iov_base;
+}
+#endif
+
 typedef struct {
     int fd;
     int timeout;
 
     size_t length;
     char *offset;
-    char buf[MRU];
+#ifdef HAVE_RECVMMSG
+    struct udp_ring ring;
+    bool batch;
+    bool truncated;
+#endif
+    char buf[]; /**< MRU bytes, only without batching */
 } access_sys_t;
 
 static int Control(stream_t *access, int query, va_list args)
@@ -132,6 +234,52 @@ static ssize_t Read(stream_t *access, void *buf, size_t len)
     return val;
 }
 
+#ifdef HAVE_RECVMMSG
+static ssize_t ReadBatch(stream_t *access, void *buf, size_t len)
+{
+    access_sys_t *sys = access->p_sys;
+
+    while (sys->length == 0) {
+        bool truncated;
+        char *data = udp_ring_Get(&sys->ring, &sys->length, &truncated);
+
+        if (data != NULL) {
+            /* empty (0 bytes) payloads are simply skipped */
+            sys->offset = data;
+            if (unlikely(truncated) && !sys->truncated) {
+                msg_Err(access, "%zu bytes datagram truncated", sys->length);
+                sys->truncated = true;
+            }
+            continue;
+        }
+
+        struct pollfd ufd[1];
+
+        ufd[0].fd = sys->fd;
+        ufd[0].events = POLLIN;
+
+        switch (vlc_poll_i11e(ufd, 1, sys->timeout)) {
+            case 0:
+                msg_Err(access, "receive time-out");
+                return 0;
+            case -1:
+                return -1;
+        }
+
+        if (udp_ring_Recv(&sys->ring, sys->fd, MSG_DONTWAIT) <= 0)
+            return -1;
+    }
+
+    if (len > sys->length)
+        len = sys->length;
+
+    memcpy(buf, sys->offset, len);
+    sys->offset += len;
+    sys->length -= len;
+    return len;
+}
+#endif
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -143,7 +291,14 @@ static int Open( vlc_object_t *p_this )
     if( p_access->b_preparsing )
         return VLC_EGENERIC;
 
-    sys = vlc_obj_malloc( p_this, sizeof( *sys ) );
+#ifdef HAVE_RECVMMSG
+    const int64_t batch = var_InheritInteger( p_access, "udp-batch" );
+#else
+    const int64_t batch = 1;
+#endif
+
+    /* The overflow buffer is only needed when reading one datagram at once */
+    sys = vlc_obj_malloc( p_this, sizeof( *sys ) + ( batch > 1 ? 0 : MRU ) );
     if( unlikely( sys == NULL ) )
         return VLC_ENOMEM;
 
@@ -217,6 +372,31 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    sys->batch = batch > 1;
+    sys->truncated = false;
+    if( sys->batch )
+    {
+        if( udp_ring_Init( &sys->ring, __MIN(batch, 1024) ) != VLC_SUCCESS )
+        {
+            net_Close( sys->fd );
+            return VLC_ENOMEM;
+        }
+
+# ifdef UDP_GRO
+        /* Datagram boundaries are irrelevant to the byte stream we expose,
+         * so let the kernel coalesce segments of the same flow. */
+        if( var_InheritBool( p_access, "udp-gro" )
+         && setsockopt( sys->fd, IPPROTO_UDP, UDP_GRO, &(int){ 1 },
+                        sizeof (int) ) == 0 )
+            msg_Dbg( p_access, "UDP generic receive offload enabled" );
+# endif
+        p_access->pf_read = ReadBatch;
+        msg_Dbg( p_access, "receiving up to %u datagrams per call",
+                 sys->ring.size );
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -229,9 +409,21 @@ static void Close( vlc_object_t *p_this )
     access_sys_t *sys = p_access->p_sys;
 
     net_Close( sys->fd );
+#ifdef HAVE_RECVMMSG
+    if( sys->batch )
+        udp_ring_Clean( &sys->ring );
+#endif
 }
 
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Datagrams per receive call")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams fetched from the kernel at once. " \
+    "Set to 1 to receive one datagram at a time." )
+#define GRO_TEXT N_("Generic receive offload")
+#define GRO_LONGTEXT N_( \
+    "Let the kernel coalesce consecutive datagrams of the stream, " \
+    "if supported." )
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -240,9 +432,189 @@ vlc_module_begin()
 
     add_obsolete_integer("udp-buffer") /* since 3.0.0 */
     add_integer("udp-timeout", -1, TIMEOUT_TEXT, NULL)
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range("udp-batch", 32, 1, 1024,
+                           BATCH_TEXT, BATCH_LONGTEXT)
+    add_bool("udp-gro", true, GRO_TEXT, GRO_LONGTEXT)
+#endif
 
     set_capability("access", 0)
     add_shortcut("udp", "udpstream", "udp4", "udp6")
 
     set_callbacks(Open, Close)
 vlc_module_end()
+
+#if defined(ENABLE_TEST) && defined(HAVE_RECVMMSG)
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#define TEST_PAYLOAD (7 * 188)
+
+static int test_OpenLoopback(int *rx, int *tx)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+
+    *rx = socket(AF_INET, SOCK_DGRAM, 0);
+    *tx = socket(AF_INET, SOCK_DGRAM, 0);
+    if (*rx == -1 || *tx == -1
+     || bind(*rx, (struct sockaddr *)&addr, sizeof (addr))
+     || getsockname(*rx, (struct sockaddr *)&addr, &addrlen)
+     || connect(*tx, (struct sockaddr *)&addr, addrlen))
+    {
+        if (*rx != -1)
+            close(*rx);
+        if (*tx != -1)
+            close(*tx);
+        return -1;
+    }
+
+    struct timeval tv = { .tv_usec = 100000 };
+    setsockopt(*rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+    setsockopt(*rx, SOL_SOCKET, SO_RCVBUF, &(int){ 4 << 20 }, sizeof (int));
+    return 0;
+}
+
+static void test_Ordering(int rx, int tx)
+{
+    struct udp_ring ring;
+    char payload[TEST_PAYLOAD];
+    uint32_t expected = 0;
+
+    int val = udp_ring_Init(&ring, 16);
+    assert(val == VLC_SUCCESS);
+    memset(payload, 0x47, sizeof (payload));
+
+    for (int round = 0; round < 4; round++)
+    {
+        for (uint32_t i = 0; i < 24; i++)
+        {
+            uint32_t seq = round * 24 + i;
+
+            memcpy(payload, &seq, sizeof (seq));
+            ssize_t sent = send(tx, payload, TEST_PAYLOAD - i, 0);
+            assert(sent == TEST_PAYLOAD - i);
+        }
+
+        unsigned received = 0;
+
+        while (received < 24)
+        {
+            val = udp_ring_Recv(&ring, rx, MSG_WAITFORONE);
+            assert(val > 0);
+
+            char *data;
+            size_t len;
+            bool truncated;
+
+            while ((data = udp_ring_Get(&ring, &len, &truncated)) != NULL)
+            {
+                uint32_t seq;
+
+                memcpy(&seq, data, sizeof (seq));
+                assert(seq == expected);
+                assert(len == TEST_PAYLOAD - (seq % 24));
+                assert(!truncated);
+                expected++;
+                received++;
+            }
+        }
+    }
+
+    udp_ring_Clean(&ring);
+}
+
+struct test_sender
+{
+    int fd;
+    atomic_bool stop;
+};
+
+static void *test_Send(void *data)
+{
+    struct test_sender *sender = data;
+    char payload[TEST_PAYLOAD];
+
+    memset(payload, 0x47, sizeof (payload));
+    while (!atomic_load_explicit(&sender->stop, memory_order_relaxed))
+        send(sender->fd, payload, sizeof (payload), 0);
+    return NULL;
+}
+
+static void test_Throughput(int rx, int tx, unsigned batch)
+{
+    struct test_sender sender = { .fd = tx, .stop = false };
+    struct udp_ring ring;
+    vlc_thread_t th;
+    uint64_t packets = 0, calls = 0;
+
+    int val = udp_ring_Init(&ring, batch);
+    assert(val == VLC_SUCCESS);
+    val = vlc_clone(&th, test_Send, &sender);
+    assert(val == 0);
+
+    vlc_tick_t start = vlc_tick_now();
+    vlc_tick_t deadline = start + VLC_TICK_FROM_MS(250);
+
+    while (vlc_tick_now() < deadline)
+    {
+        val = udp_ring_Recv(&ring, rx, MSG_WAITFORONE);
+
+        if (val <= 0)
+            continue;
+        packets += val;
+        calls++;
+
+        size_t len;
+        bool truncated;
+        while (udp_ring_Get(&ring, &len, &truncated) != NULL)
+            assert(len == TEST_PAYLOAD);
+    }
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    atomic_store(&sender.stop, true);
+    vlc_join(th, NULL);
+    udp_ring_Clean(&ring);
+
+    /* drain what is left in the socket buffer */
+    char discard[MRU];
+    while (recv(rx, discard, sizeof (discard), MSG_DONTWAIT) >= 0);
+
+    double secs = secf_from_vlc_tick(elapsed);
+    printf("batch %4u: %8.1f kpkt/s %8.1f Mbit/s %6.2f pkt/call\n", batch,
+           packets / secs / 1000., packets * TEST_PAYLOAD * 8 / secs / 1e6,
+           calls ? (double)packets / calls : 0.);
+}
+
+int main(void)
+{
+    int rx, tx;
+
+    if (test_OpenLoopback(&rx, &tx))
+    {
+        perror("loopback socket");
+        return 77;
+    }
+
+    test_Ordering(rx, tx);
+
+    static const unsigned batches[] = { 1, 8, 32, 64, 256 };
+    for (size_t i = 0; i < ARRAY_SIZE(batches); i++)
+        test_Throughput(rx, tx, batches[i]);
+
+    close(tx);
+    close(rx);
+    return 0;
+}
+#elif defined(ENABLE_TEST)
+int main(void)
+{
+    return 77; /* recvmmsg() not available */
+}
+#endif
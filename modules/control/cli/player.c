@@ -934,6 +934,19 @@ static int Statistics(struct cli_client *cl, const char *const *args,
                    item->p_stats->i_lost_abuffers);
         cli_printf(cl, "|");
 
+        /* Stream output */
+        if (item->p_stats->i_sent_packets > 0)
+        {
+            cli_printf(cl, "%s", _("+-[Streaming]"));
+            cli_printf(cl, _("| packets sent     :    %5"PRIi64),
+                       item->p_stats->i_sent_packets);
+            cli_printf(cl, _("| bytes sent       : %8.0f KiB"),
+                       (float)(item->p_stats->i_sent_bytes) / 1024.f);
+            cli_printf(cl, _("| send calls       :    %5"PRIi64),
+                       item->p_stats->i_send_calls);
+            cli_printf(cl, "|");
+        }
+
         vlc_mutex_unlock(&item->lock);
         cli_printf(cl,  "+----[ end of statistical info ]" );
     }
@@ -36,6 +36,7 @@
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
 #include "logic/PredictiveAdaptationLogic.hpp"
 #include "logic/NearOptimalAdaptationLogic.hpp"
+#include "logic/ThroughputAdaptationLogic.hpp"
 #include "logic/BufferingLogic.hpp"
 #include "tools/Debug.hpp"
 #ifdef ADAPTIVE_DEBUGGING_LOGIC
@@ -43,6 +44,7 @@
 #endif
 #include <vlc_stream.h>
 #include <vlc_demux.h>
+#include <vlc_input_item.h>
 #include <vlc_threads.h>
 
 #include <algorithm>
@@ -74,6 +76,7 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
     b_preparsing = false;
     nextPlaylistupdate = 0;
     demux.pcr_syncpoint = TimestampSynchronizationPoint::RandomAccess;
+    demux.buffering = 0;
     vlc_mutex_init(&demux.lock);
     vlc_cond_init(&demux.cond);
     vlc_mutex_init(&cached.lock);
@@ -85,6 +88,11 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
     cached.playlistEnd = 0;
     cached.playlistLength = 0;
     cached.lastupdate = 0;
+    live.b_enabled = false;
+    live.latency = VLC_TICK_INVALID;
+    live.rate = 1.0;
+    live.b_rate_control = true;
+    live.lastupdate = VLC_TICK_INVALID;
 }
 
 PlaylistManager::~PlaylistManager   ()
@@ -155,6 +163,9 @@ bool PlaylistManager::init(bool b_preparsing)
     if(!setupPeriod())
         return false;
 
+    live.b_enabled = playlist->isLive() && bufferingLogic->isLowLatency(playlist);
+    resources->getConnManager()->setLowLatency(live.b_enabled);
+
     playlist->playbackStart = time(nullptr);
     nextPlaylistupdate = playlist->playbackStart;
 
@@ -237,6 +248,14 @@ AbstractStream::BufferingStatus PlaylistManager::bufferize(Times deadline,
     }
     std::sort(prioritized_streams.begin(), prioritized_streams.end(), streamCompare);
 
+    vlc_tick_t i_buffering = VLC_TICK_INVALID;
+    for(const PrioritizedAbstractStream &pst : prioritized_streams)
+    {
+        if(pst.st->isValid() && !pst.st->isDisabled() && pst.st->isSelected() &&
+           (i_buffering == VLC_TICK_INVALID || pst.demuxed_amount < i_buffering))
+            i_buffering = pst.demuxed_amount;
+    }
+
     for(PrioritizedAbstractStream &pst : prioritized_streams)
     {
         AbstractStream *st = pst.st;
@@ -272,6 +291,8 @@ AbstractStream::BufferingStatus PlaylistManager::bufferize(Times deadline,
     }
 
     vlc_mutex_locker locker(&demux.lock);
+    if(i_buffering != VLC_TICK_INVALID)
+        demux.buffering = i_buffering;
     if(demux.times.continuous == VLC_TICK_INVALID &&
         /* don't wait minbuffer on simple discontinuity or restart */
        (demux.pcr_syncpoint == TimestampSynchronizationPoint::Discontinuity ||
@@ -489,6 +510,7 @@ int PlaylistManager::doDemux(vlc_tick_t increment)
     vlc_mutex_unlock(&demux.lock);
 
     updateControlsPosition();
+    updateLiveLatency();
 
     switch(status)
     {
@@ -687,8 +709,22 @@ int PlaylistManager::doControl(int i_query, va_list args)
         }
 
         case DEMUX_GET_PTS_DELAY:
-            *va_arg (args, vlc_tick_t *) = VLC_TICK_FROM_SEC(1);
+            *va_arg (args, vlc_tick_t *) = getPtsDelay();
+            break;
+
+        case DEMUX_GET_ADAPTIVE_STATS:
+        {
+            struct vlc_demux_adaptive_stats *stats =
+                    va_arg(args, struct vlc_demux_adaptive_stats *);
+            *stats = {};
+            if(live.b_enabled)
+            {
+                stats->live_latency = live.latency;
+                stats->catchup_rate = live.rate;
+            }
+            resources->getConnManager()->getStats(stats);
             break;
+        }
 
         default:
             return VLC_EGENERIC;
@@ -855,6 +891,62 @@ void PlaylistManager::updateControlsPosition()
                             startTimes.segment.demux, cached.f_position));
 }
 
+#define LOW_LATENCY_PTS_DELAY VLC_TICK_FROM_MS(500)
+vlc_tick_t PlaylistManager::getPtsDelay() const
+{
+    return live.b_enabled ? LOW_LATENCY_PTS_DELAY : VLC_TICK_FROM_SEC(1);
+}
+
+void PlaylistManager::updateLiveLatency()
+{
+    if(!live.b_enabled)
+        return;
+
+    vlc_tick_t now = vlc_tick_now();
+    if(live.lastupdate != VLC_TICK_INVALID &&
+       now - live.lastupdate < VLC_TICK_FROM_SEC(1))
+        return;
+    live.lastupdate = now;
+
+    vlc_tick_t edge, position;
+    {
+        vlc_mutex_locker locker(&cached.lock);
+        if(cached.i_time == VLC_TICK_INVALID ||
+           cached.playlistStart == cached.playlistEnd)
+            return;
+        edge = VLC_TICK_0 + cached.playlistEnd;
+        position = cached.i_time;
+    }
+
+    vlc_tick_t buffering;
+    {
+        vlc_mutex_locker locker(&demux.lock);
+        buffering = demux.buffering;
+    }
+
+    /* Playback lags the demuxed position by the PTS delay */
+    live.latency = std::max(edge - position, INT64_C(0)) + getPtsDelay();
+
+    double rate = 1.0;
+    if(live.b_rate_control)
+        rate = bufferingLogic->getCatchUpRate(playlist, live.latency, buffering);
+    if(rate != live.rate)
+    {
+        if(es_out_Control(p_demux->out, ES_OUT_SET_RATE_CORRECTION, rate) == VLC_SUCCESS)
+        {
+            msg_Dbg(p_demux, "live latency %" PRId64 "ms buffering %" PRId64 "ms, "
+                             "catch-up rate %.3f", MS_FROM_VLC_TICK(live.latency),
+                    MS_FROM_VLC_TICK(buffering), rate);
+            live.rate = rate;
+        }
+        else
+        {
+            msg_Warn(p_demux, "playback rate can't be adjusted, no latency catch-up");
+            live.b_rate_control = false;
+        }
+    }
+}
+
 AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::LogicType type, AbstractConnectionManager *conn)
 {
     vlc_object_t *obj = VLC_OBJECT(p_demux);
@@ -897,6 +989,15 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
             logic = noplogic;
             break;
         }
+        case AbstractAdaptationLogic::LogicType::Throughput:
+        {
+            ThroughputAdaptationLogic *tputlogic =
+                    new (std::nothrow) ThroughputAdaptationLogic(obj);
+            if(tputlogic)
+                conn->setDownloadRateObserver(tputlogic);
+            logic = tputlogic;
+            break;
+        }
         case AbstractAdaptationLogic::LogicType::Predictive:
         {
             AbstractAdaptationLogic *predictivelogic =
@@ -941,6 +1042,13 @@ AbstractBufferingLogic *PlaylistManager::createBufferingLogic() const
         v = var_InheritInteger(p_demux, "adaptive-maxbuffer");
         if(v)
             bl->setUserMaxBuffering(VLC_TICK_FROM_MS(v));
+        v = var_InheritInteger(p_demux, "adaptive-livelatency");
+        if(v)
+            bl->setUserLiveLatency(VLC_TICK_FROM_MS(v));
+        bl->setUserCatchUpRate(var_InheritFloat(p_demux, "adaptive-catchup"));
+        int i = var_InheritInteger(p_demux, "adaptive-lowlatency");
+        if(i >= 0)
+            bl->setLowDelay(i > 0);
     }
     return bl;
 }
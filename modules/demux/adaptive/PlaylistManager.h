@@ -97,6 +97,8 @@ namespace adaptive
             void unsetPeriod();
 
             void updateControlsPosition();
+            void updateLiveLatency();
+            vlc_tick_t getPtsDelay() const;
 
             /* local factories */
             virtual AbstractAdaptationLogic *createLogic(AbstractAdaptationLogic::LogicType,
@@ -125,6 +127,7 @@ namespace adaptive
             {
                 TimestampSynchronizationPoint pcr_syncpoint;
                 Times times, firsttimes;
+                vlc_tick_t  buffering; /* lowest demuxed amount */
                 mutable vlc_mutex_t lock;
                 vlc_cond_t  cond;
             } demux;
@@ -147,6 +150,16 @@ namespace adaptive
                 time_t      lastupdate;
             } cached;
 
+            /* Low latency, in demux thread */
+            struct
+            {
+                bool        b_enabled;
+                vlc_tick_t  latency;
+                double      rate; /* catch-up rate */
+                bool        b_rate_control; /* es_out accepts rate changes */
+                vlc_tick_t  lastupdate;
+            } live;
+
             SynchronizationReferences synchronizationReferences;
 
         private:
@@ -64,9 +64,10 @@ SharedResources * SharedResources::createDefault(vlc_object_t *obj,
 {
     AuthStorage *auth = new AuthStorage(obj);
     Keyring *keyring = new Keyring(obj);
-    HTTPConnectionManager *m = new HTTPConnectionManager(obj);
+    unsigned downloaders = var_InheritInteger(obj, "adaptive-downloaders");
+    HTTPConnectionManager *m = new HTTPConnectionManager(obj, downloaders);
     if(!var_InheritBool(obj, "adaptive-use-access")) /* only use http from access */
-        m->addFactory(new LibVLCHTTPConnectionFactory(auth));
+        m->addFactory(new LibVLCHTTPConnectionFactory(obj, auth));
     m->addFactory(new StreamUrlConnectionFactory());
     ConnectionParams params(playlisturl);
     if(params.isLocal())
@@ -81,13 +81,34 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_HTTP2_TEXT N_("Share HTTP/2 connections")
+#define ADAPT_HTTP2_LONGTEXT N_("Multiplex all requests to a server over a " \
+    "single HTTP/2 connection when supported")
+
+#define ADAPT_H2C_TEXT N_("Use HTTP/2 without TLS")
+#define ADAPT_H2C_LONGTEXT N_("Assume unencrypted HTTP servers support " \
+    "HTTP/2 (h2c), falling back to HTTP/1.1 otherwise")
+
 #define ADAPT_LOWLATENCY_TEXT N_("Low latency")
 #define ADAPT_LOWLATENCY_LONGTEXT N_("Overrides low latency parameters")
 
+#define ADAPT_LIVELATENCY_TEXT N_("Low latency target (ms)")
+#define ADAPT_LIVELATENCY_LONGTEXT N_("Latency from the live edge to maintain " \
+    "in low latency mode. 0 uses the playlist target, or a default one")
+
+#define ADAPT_CATCHUP_TEXT N_("Low latency catch-up rate")
+#define ADAPT_CATCHUP_LONGTEXT N_("Maximum playback speed change used to " \
+    "converge on the low latency target. 0 disables it")
+
+#define ADAPT_DOWNLOADERS_TEXT N_("Concurrent downloads")
+#define ADAPT_DOWNLOADERS_LONGTEXT N_("Number of segments that can be " \
+    "downloaded at the same time, across all streams")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::LogicType::Default,
                                 AbstractAdaptationLogic::LogicType::Predictive,
                                 AbstractAdaptationLogic::LogicType::NearOptimal,
+                                AbstractAdaptationLogic::LogicType::Throughput,
                                 AbstractAdaptationLogic::LogicType::RateBased,
                                 AbstractAdaptationLogic::LogicType::FixedRate,
                                 AbstractAdaptationLogic::LogicType::AlwaysLowest,
@@ -97,6 +118,7 @@ static const char *const ppsz_logics_values[] = {
                                 "",
                                 "predictive",
                                 "nearoptimal",
+                                "throughput",
                                 "rate",
                                 "fixedrate",
                                 "lowest",
@@ -105,6 +127,7 @@ static const char *const ppsz_logics_values[] = {
 static const char *const ppsz_logics[] = { N_("Default"),
                                            N_("Predictive"),
                                            N_("Near Optimal"),
+                                           N_("Throughput and Buffer Based"),
                                            N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
@@ -135,6 +158,8 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, nullptr )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT )
+        add_bool   ( "adaptive-http2", true, ADAPT_HTTP2_TEXT, ADAPT_HTTP2_LONGTEXT )
+        add_bool   ( "adaptive-h2c", false, ADAPT_H2C_TEXT, ADAPT_H2C_LONGTEXT )
         add_integer( "adaptive-livedelay",
                      MS_FROM_VLC_TICK(AbstractBufferingLogic::DEFAULT_LIVE_BUFFERING),
                      ADAPT_BUFFER_TEXT, ADAPT_BUFFER_LONGTEXT )
@@ -143,6 +168,14 @@ vlc_module_begin ()
                      ADAPT_MAXBUFFER_TEXT, nullptr )
         add_integer( "adaptive-lowlatency", -1, ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT )
             change_integer_list(rgi_latency, ppsz_latency)
+        add_integer( "adaptive-livelatency", 0,
+                     ADAPT_LIVELATENCY_TEXT, ADAPT_LIVELATENCY_LONGTEXT )
+        add_float( "adaptive-catchup", AbstractBufferingLogic::DEFAULT_CATCHUP_RATE,
+                   ADAPT_CATCHUP_TEXT, ADAPT_CATCHUP_LONGTEXT )
+            change_float_range( 0, 0.5 )
+        add_integer( "adaptive-downloaders", 2,
+                     ADAPT_DOWNLOADERS_TEXT, ADAPT_DOWNLOADERS_LONGTEXT )
+            change_integer_range( 1, 8 )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -60,7 +60,7 @@ const BytesRange & AbstractChunkSource::getBytesRange() const
     return bytesRange;
 }
 
-const std::string & AbstractChunkSource::getContentType() const
+std::string AbstractChunkSource::getContentType() const
 {
     return EmptyStr;
 }
@@ -91,7 +91,7 @@ AbstractChunk::~AbstractChunk()
     source->recycle();
 }
 
-const std::string & AbstractChunk::getContentType() const
+std::string AbstractChunk::getContentType() const
 {
     return source->getContentType();
 }
@@ -265,13 +265,25 @@ StorageID HTTPChunkSource::makeStorageID(const std::string &s, const BytesRange
     return std::to_string(r.getStartByte())+ std::to_string(r.getEndByte()) + '@' + s;
 }
 
-const std::string & HTTPChunkSource::getContentType() const
+std::string HTTPChunkSource::getContentType() const
 {
+    /* Copied under the lock: the connection can be released and reused
+     * by another chunk as soon as it is unlocked */
     mutex_locker locker {lock};
     if(connection)
         return connection->getContentType();
     else
-        return EmptyStr;
+        return contentType;
+}
+
+void HTTPChunkSource::releaseConnection()
+{
+    if(connection)
+    {
+        contentType = connection->getContentType();
+        connection->setUsed(false);
+        connection = nullptr;
+    }
 }
 
 void HTTPChunkSource::setIdentifier(const std::string &s, const BytesRange &r)
@@ -343,8 +355,13 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
+    waiting = 0;
     p_read = nullptr;
     inblockreadoffset = 0;
+    lowlatency = false;
+    lastReadTime = VLC_TICK_INVALID;
+    active.size = 0;
+    active.time = 0;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -373,6 +390,12 @@ bool HTTPChunkBufferedSource::isDone() const
     return done;
 }
 
+bool HTTPChunkBufferedSource::isStarving() const
+{
+    mutex_locker locker {lock};
+    return waiting > 0;
+}
+
 void HTTPChunkBufferedSource::hold()
 {
     mutex_locker locker {lock};
@@ -386,6 +409,13 @@ void HTTPChunkBufferedSource::release()
     avail.signal();
 }
 
+const vlc_tick_t HTTPChunkBufferedSource::LOW_LATENCY_IDLE_THRESHOLD = VLC_TICK_FROM_MS(50);
+
+void HTTPChunkBufferedSource::setLowLatency(bool b)
+{
+    lowlatency = b;
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     {
@@ -419,7 +449,12 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_tick_t latency;
     } rate = {0,0,0};
 
-    ssize_t ret = connection->read(p_block->p_buffer, readsize);
+    /* In low latency mode, segments are still being produced while they are
+     * downloaded: hand over each chunk to the demuxer as soon as it arrives */
+    const vlc_tick_t readStart = vlc_tick_now();
+    ssize_t ret = lowlatency ? connection->readPartial(p_block->p_buffer, readsize)
+                             : connection->read(p_block->p_buffer, readsize);
+    const vlc_tick_t readEnd = vlc_tick_now();
     if(ret <= 0)
     {
         block_Release(p_block);
@@ -430,6 +465,8 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         rate.size = buffered;
         rate.time = downloadEndTime - requestStartTime;
         rate.latency = responseTime - requestStartTime;
+        /* let the next chunk reuse it while this one is being read */
+        releaseConnection();
         avail.signal();
     }
     else
@@ -443,21 +480,50 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
             p_read = p_block;
             inblockreadoffset = 0;
         }
-        if((size_t) ret < readsize)
+        if(lowlatency)
+        {
+            /* The download time mostly measures the encoder pace. Only
+             * account for data received back to back for the throughput. */
+            if(lastReadTime != VLC_TICK_INVALID &&
+               readEnd - lastReadTime < LOW_LATENCY_IDLE_THRESHOLD)
+            {
+                active.size += ret;
+                active.time += readEnd - lastReadTime;
+            }
+            lastReadTime = readEnd;
+        }
+        else
+        {
+            /* Time spent between bufferize calls, while the downloader
+             * serves other sources, is not transfer time */
+            active.size += ret;
+            active.time += readEnd - readStart;
+        }
+        if(lowlatency ? (contentLength && buffered >= contentLength)
+                      : (size_t) ret < readsize)
         {
             done = true;
             downloadEndTime = vlc_tick_now();
             rate.size = buffered;
             rate.time = downloadEndTime - requestStartTime;
             rate.latency = responseTime - requestStartTime;
+            releaseConnection();
         }
         avail.signal();
     }
 
+    if(rate.size && lowlatency && active.time)
+    {
+        rate.size = active.size;
+        rate.time = active.time;
+    }
+
     if(rate.size && rate.time && type == ChunkType::Segment)
     {
         connManager->updateDownloadRate(sourceid, rate.size,
                                         rate.time, rate.latency);
+        if(active.size && active.time)
+            connManager->updateTransferRate(sourceid, active.size, active.time);
     }
 }
 
@@ -483,7 +549,11 @@ block_t * HTTPChunkBufferedSource::readBlock()
     mutex_locker locker {lock};
 
     while(!p_read && !done)
+    {
+        waiting++;
         avail.wait(lock);
+        waiting--;
+    }
 
     if(!p_read && done)
     {
@@ -509,7 +579,11 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
     mutex_locker locker {lock};
 
     while(readsize > (buffered - consumed) && !done)
+    {
+        waiting++;
         avail.wait(lock);
+        waiting--;
+    }
 
     block_t *p_block = nullptr;
     if(!readsize || (buffered == consumed) || !(p_block = block_Alloc(readsize)) )
@@ -567,7 +641,7 @@ ProbeableChunk::~ProbeableChunk()
     delete source;
 }
 
-const std::string & ProbeableChunk::getContentType() const
+std::string ProbeableChunk::getContentType() const
 {
     return source->getContentType();
 }
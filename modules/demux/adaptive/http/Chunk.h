@@ -59,7 +59,7 @@ namespace adaptive
             PREREQ_INTERFACE(ChunkInterface);
 
             public:
-                virtual const std::string & getContentType  () const = 0;
+                virtual std::string getContentType  () const = 0;
                 virtual RequestStatus getRequestStatus() const = 0;
 
                 virtual block_t *   readBlock       () = 0;
@@ -79,7 +79,7 @@ namespace adaptive
                 const BytesRange &  getBytesRange   () const;
                 ChunkType           getChunkType    () const;
                 const StorageID &   getStorageID    () const;
-                const std::string & getContentType  () const override;
+                std::string         getContentType  () const override;
                 RequestStatus getRequestStatus() const override;
                 virtual void        recycle() = 0;
 
@@ -100,7 +100,7 @@ namespace adaptive
             public:
                 virtual ~AbstractChunk();
 
-                const std::string & getContentType  () const override;
+                std::string getContentType  () const override;
                 RequestStatus getRequestStatus      () const override;
                 size_t        getBytesRead          () const override;
                 bool          hasMoreData           () const override;
@@ -131,7 +131,7 @@ namespace adaptive
                 block_t *   read            (size_t)  override;
                 bool        hasMoreData     () const  override;
                 size_t      getBytesRead    () const  override;
-                const std::string & getContentType() const override;
+                std::string getContentType  () const  override;
                 void        recycle() override;
 
                 static const size_t CHUNK_SIZE = 32768;
@@ -143,8 +143,10 @@ namespace adaptive
                                 bool = false);
 
                 virtual bool        prepare();
+                void                releaseConnection();
                 void                setIdentifier(const std::string &, const BytesRange &);
                 AbstractConnection    *connection;
+                std::string         contentType; /* once connection released */
                 AbstractConnectionManager *connManager;
                 mutable vlc::threads::mutex lock;
                 size_t              consumed; /* read pointer */
@@ -178,8 +180,13 @@ namespace adaptive
                                         bool = false);
                 void               bufferize(size_t);
                 bool               isDone() const;
+                bool               isStarving() const;
                 void               hold();
                 void               release();
+                void               setLowLatency(bool);
+
+                /* gap between reads above which the server is waiting for data */
+                static const vlc_tick_t LOW_LATENCY_IDLE_THRESHOLD;
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -191,6 +198,14 @@ namespace adaptive
                 bool                eof;
                 vlc::threads::condition_variable avail;
                 bool                held;
+                unsigned            waiting; /* blocked readers */
+                bool                lowlatency; /* consume chunks as they arrive */
+                vlc_tick_t          lastReadTime;
+                struct
+                {
+                    size_t size;
+                    vlc_tick_t time;
+                } active; /* data received without waiting on the server */
         };
 
         class HTTPChunk : public AbstractChunk
@@ -210,7 +225,7 @@ namespace adaptive
                 ProbeableChunk(ChunkInterface *);
                 virtual ~ProbeableChunk();
 
-                const std::string & getContentType  () const override;
+                std::string getContentType  () const override;
                 RequestStatus getRequestStatus() const override;
 
                 block_t *   readBlock       () override;
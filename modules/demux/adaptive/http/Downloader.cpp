@@ -29,22 +29,27 @@
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::StreamQueue::StreamQueue(const ID &id_)
+    : id(id_)
+{
+    busy = false;
+}
+
+Downloader::Downloader(unsigned workers_)
 {
     killed = false;
-    thread_handle_valid = false;
-    current = nullptr;
-    cancel_current = false;
+    workers = workers_ ? workers_ : 1;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread, static_cast<void *>(this)))
+    while(threads.size() < workers)
     {
-        return false;
+        vlc_thread_t th;
+        if(vlc_clone(&th, downloaderThread, static_cast<void *>(this)))
+            return !threads.empty();
+        threads.push_back(th);
     }
-    thread_handle_valid = true;
     return true;
 }
 
@@ -52,41 +57,107 @@ Downloader::~Downloader()
 {
     kill();
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, nullptr);
+    for(vlc_thread_t th : threads)
+        vlc_join(th, nullptr);
+
+    while(!queues.empty())
+    {
+        StreamQueue *queue = queues.front();
+        queues.pop_front();
+        for(HTTPChunkBufferedSource *source : queue->chunks)
+            source->release();
+        delete queue;
+    }
 }
 
 void Downloader::kill()
 {
     vlc::threads::mutex_locker locker {lock};
     killed = true;
-    wait_cond.signal();
+    wait_cond.broadcast();
+}
+
+Downloader::StreamQueue * Downloader::getQueue(const ID &id)
+{
+    for(StreamQueue *queue : queues)
+        if(queue->id == id)
+            return queue;
+    return nullptr;
 }
 
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc::threads::mutex_locker locker {lock};
+    StreamQueue *queue = getQueue(source->sourceid);
+    if(!queue)
+    {
+        queue = new StreamQueue(source->sourceid);
+        queues.push_back(queue);
+    }
     source->hold();
-    chunks.push_back(source);
+    queue->chunks.push_back(source);
     wait_cond.signal();
 }
 
+bool Downloader::isCurrent(const HTTPChunkBufferedSource *source) const
+{
+    for(const HTTPChunkBufferedSource *s : current)
+        if(s == source)
+            return true;
+    return false;
+}
+
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc::threads::mutex_locker locker {lock};
-    while (current == source)
+    if(isCurrent(source))
     {
-        cancel_current = true;
-        updated_cond.wait(lock);
+        cancelled.push_back(source);
+        while(isCurrent(source))
+            updated_cond.wait(lock);
     }
 
     if(!source->isDone())
     {
-        chunks.remove(source);
+        StreamQueue *queue = getQueue(source->sourceid);
+        if(queue)
+        {
+            queue->chunks.remove(source);
+            if(queue->chunks.empty() && !queue->busy)
+            {
+                queues.remove(queue);
+                delete queue;
+            }
+        }
         source->release();
     }
 }
 
+Downloader::StreamQueue * Downloader::pick()
+{
+    StreamQueue *picked = nullptr;
+    for(StreamQueue *queue : queues)
+    {
+        if(queue->busy || queue->chunks.empty())
+            continue;
+        if(queue->chunks.front()->isStarving())
+        {
+            picked = queue;
+            break;
+        }
+        if(!picked)
+            picked = queue;
+    }
+
+    /* round robin */
+    if(picked)
+    {
+        queues.remove(picked);
+        queues.push_back(picked);
+    }
+    return picked;
+}
+
 void * Downloader::downloaderThread(void *opaque)
 {
     vlc_thread_set_name("vlc-adapt-dl");
@@ -101,7 +172,8 @@ void Downloader::Run()
     {
         lock.lock();
 
-        while(chunks.empty() && !killed)
+        StreamQueue *queue = nullptr;
+        while(!killed && (queue = pick()) == nullptr)
             wait_cond.wait(lock);
 
         if(killed)
@@ -110,18 +182,32 @@ void Downloader::Run()
             break;
         }
 
-        current = chunks.front();
+        HTTPChunkBufferedSource *source = queue->chunks.front();
+        queue->busy = true;
+        current.push_back(source);
         lock.unlock();
-        current->bufferize(HTTPChunkSource::CHUNK_SIZE);
+        source->bufferize(HTTPChunkSource::CHUNK_SIZE);
         lock.lock();
-        if(current->isDone() || cancel_current)
+        current.remove(source);
+        queue->busy = false;
+        bool b_cancelled = false;
+        for(const HTTPChunkBufferedSource *s : cancelled)
+            b_cancelled |= (s == source);
+        if(b_cancelled)
+            cancelled.remove(source);
+        if(source->isDone() || b_cancelled)
         {
-            chunks.pop_front();
-            current->release();
+            queue->chunks.pop_front();
+            source->release();
+            if(queue->chunks.empty())
+            {
+                queues.remove(queue);
+                delete queue;
+            }
         }
-        cancel_current = false;
-        current = nullptr;
-        updated_cond.signal();
+        /* the stream can be served by another worker */
+        wait_cond.signal();
+        updated_cond.broadcast();
         lock.unlock();
     }
 }
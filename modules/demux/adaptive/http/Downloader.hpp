@@ -26,6 +26,7 @@
 #include <vlc_threads.h>
 #include <vlc_cxx_helpers.hpp>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -33,10 +34,16 @@ namespace adaptive
     namespace http
     {
 
+        /* Pool of download workers.
+         * Sources are queued per stream (adaptation set) and each stream
+         * has at most one source being downloaded at a time, so that they
+         * complete in order. Workers go through the streams one
+         * CHUNK_SIZE at a time, serving first those with a starving reader,
+         * so that a large chunk on one stream can't delay the others. */
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1);
                 ~Downloader();
                 Downloader(Downloader&&) = delete;
                 Downloader& operator=(const Downloader&) = delete;
@@ -46,18 +53,29 @@ namespace adaptive
                 void cancel(HTTPChunkBufferedSource *);
 
             private:
+                class StreamQueue
+                {
+                    public:
+                        StreamQueue(const ID &);
+                        ID id;
+                        std::list<HTTPChunkBufferedSource *> chunks;
+                        bool busy;
+                };
                 static void * downloaderThread(void *);
                 void Run();
                 void kill();
-                vlc_thread_t thread_handle;
+                StreamQueue * getQueue(const ID &);
+                StreamQueue * pick();
+                bool isCurrent(const HTTPChunkBufferedSource *) const;
+                std::vector<vlc_thread_t> threads;
+                unsigned     workers;
                 vlc::threads::mutex lock;
                 vlc::threads::condition_variable wait_cond;
                 vlc::threads::condition_variable updated_cond;
-                bool         thread_handle_valid;
                 bool         killed;
-                bool         cancel_current;
-                std::list<HTTPChunkBufferedSource *> chunks;
-                HTTPChunkBufferedSource *current;
+                std::list<StreamQueue *> queues;
+                std::list<HTTPChunkBufferedSource *> current;
+                std::list<HTTPChunkBufferedSource *> cancelled;
         };
 
     }
@@ -30,6 +30,7 @@
 
 #include <vlc_stream.h>
 #include <vlc_keystore.h>
+#include <vlc_demux.h>
 
 extern "C"
 {
@@ -64,6 +65,11 @@ bool AbstractConnection::prepare(const ConnectionParams &params_)
     return true;
 }
 
+ssize_t AbstractConnection::readPartial(void *p_buffer, size_t len)
+{
+    return read(p_buffer, len);
+}
+
 size_t AbstractConnection::getContentLength() const
 {
     return contentLength;
@@ -87,10 +93,13 @@ const ConnectionParams & AbstractConnection::getRedirection() const
 class adaptive::http::LibVLCHTTPSource : public adaptive::BlockStreamInterface
 {
      public:
-        LibVLCHTTPSource(vlc_object_t *p_object_, struct vlc_http_cookie_jar_t *jar)
+        LibVLCHTTPSource(vlc_object_t *p_object_, struct vlc_http_cookie_jar_t *jar,
+                         struct vlc_http_pool *pool)
         {
             p_object = p_object_;
             http_mgr = vlc_http_mgr_create(p_object, jar);
+            if(http_mgr && pool)
+                vlc_http_mgr_set_pool(http_mgr, pool);
             http_res = nullptr;
             totalRead = 0;
         }
@@ -347,10 +356,11 @@ const struct vlc_http_resource_cbs LibVLCHTTPSource::callbacks =
     LibVLCHTTPSource::validateresponse_handler,
 };
 
-LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object_, AuthStorage *auth)
+LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object_, AuthStorage *auth,
+                                           struct vlc_http_pool *pool)
     : AbstractConnection( p_object_ )
 {
-    source = new adaptive::http::LibVLCHTTPSource(p_object_, auth->getJar());
+    source = new adaptive::http::LibVLCHTTPSource(p_object_, auth->getJar(), pool);
     sourceStream = new ChunksSourceStream(p_object, source);
     stream = nullptr;
     char *psz_useragent = var_InheritString(p_object_, "http-user-agent");
@@ -471,6 +481,13 @@ ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
     return read;
 }
 
+ssize_t LibVLCHTTPConnection::readPartial(void *p_buffer, size_t len)
+{
+    ssize_t read = vlc_stream_ReadPartial(stream, p_buffer, len);
+    bytesRead = source->getTotalRead();
+    return read;
+}
+
 void LibVLCHTTPConnection::setUsed( bool b )
 {
     available = !b;
@@ -586,6 +603,32 @@ ssize_t StreamUrlConnection::read(void *p_buffer, size_t len)
     return ret;
 }
 
+ssize_t StreamUrlConnection::readPartial(void *p_buffer, size_t len)
+{
+    if( !p_streamurl )
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
+    if (toRead == 0)
+        return VLC_SUCCESS;
+
+    if(len > toRead)
+        len = toRead;
+
+    /* short reads are expected here, only an empty one means EOF */
+    ssize_t ret = vlc_stream_ReadPartial(p_streamurl, p_buffer, len);
+    if(ret > 0)
+        bytesRead += ret;
+
+    if(ret <= 0 || contentLength == bytesRead )
+        reset();
+
+    return ret;
+}
+
 void StreamUrlConnection::setUsed( bool b )
 {
     available = !b;
@@ -593,10 +636,32 @@ void StreamUrlConnection::setUsed( bool b )
        reset();
 }
 
-LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory( AuthStorage *auth )
+LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory( vlc_object_t *p_obj_,
+                                                          AuthStorage *auth )
     : AbstractConnectionFactory()
 {
+    p_obj = p_obj_;
     authStorage = auth;
+    pool = nullptr;
+    if(var_InheritBool(p_obj, "adaptive-http2"))
+        pool = vlc_http_pool_create(p_obj, var_InheritBool(p_obj, "adaptive-h2c"));
+}
+
+LibVLCHTTPConnectionFactory::~LibVLCHTTPConnectionFactory()
+{
+    if(pool)
+        vlc_http_pool_destroy(pool);
+}
+
+void LibVLCHTTPConnectionFactory::getStats(struct vlc_demux_adaptive_stats *stats) const
+{
+    if(!pool)
+        return;
+    struct vlc_http_pool_stats poolstats;
+    vlc_http_pool_get_stats(pool, &poolstats);
+    stats->http2_connections += poolstats.connections;
+    stats->http2_failures += poolstats.failures;
+    stats->http2_requests += poolstats.requests;
 }
 
 AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t *p_object,
@@ -605,7 +670,7 @@ AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t
     if((params.getScheme() != "http" && params.getScheme() != "https") ||
        params.getHostname().empty())
         return nullptr;
-    return new LibVLCHTTPConnection(p_object, authStorage);
+    return new LibVLCHTTPConnection(p_object, authStorage, pool);
 }
 
 StreamUrlConnectionFactory::StreamUrlConnectionFactory()
@@ -30,6 +30,9 @@
 #include <vlc_common.h>
 #include <string>
 
+struct vlc_http_pool;
+struct vlc_demux_adaptive_stats;
+
 namespace adaptive
 {
     class ChunksSourceStream;
@@ -55,6 +58,8 @@ namespace adaptive
                 virtual RequestStatus request(const std::string& path,
                                               const BytesRange & = BytesRange()) = 0;
                 virtual ssize_t read        (void *p_buffer, size_t len) = 0;
+                /* returns as soon as some data is available */
+                virtual ssize_t readPartial (void *p_buffer, size_t len);
 
                 virtual size_t  getContentLength() const;
                 virtual size_t  getBytesRead() const;
@@ -78,12 +83,14 @@ namespace adaptive
        class LibVLCHTTPConnection : public AbstractConnection
        {
             public:
-               LibVLCHTTPConnection(vlc_object_t *, AuthStorage *);
+               LibVLCHTTPConnection(vlc_object_t *, AuthStorage *,
+                                    struct vlc_http_pool * = nullptr);
                virtual ~LibVLCHTTPConnection();
                bool    canReuse     (const ConnectionParams &) const override;
                RequestStatus request(const std::string& path,
                                      const BytesRange & = BytesRange()) override;
                ssize_t read         (void *p_buffer, size_t len) override;
+               ssize_t readPartial  (void *p_buffer, size_t len) override;
                void    setUsed      ( bool ) override;
 
             private:
@@ -106,6 +113,7 @@ namespace adaptive
                 RequestStatus request(const std::string& path,
                                       const BytesRange & = BytesRange()) override;
                 ssize_t read        (void *p_buffer, size_t len) override;
+                ssize_t readPartial (void *p_buffer, size_t len) override;
 
                 void    setUsed( bool ) override;
 
@@ -120,16 +128,20 @@ namespace adaptive
                AbstractConnectionFactory() {}
                virtual ~AbstractConnectionFactory() {}
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &) = 0;
+               virtual void getStats(struct vlc_demux_adaptive_stats *) const {}
        };
 
        class LibVLCHTTPConnectionFactory : public AbstractConnectionFactory
        {
            public:
-               LibVLCHTTPConnectionFactory( AuthStorage * );
-               virtual ~LibVLCHTTPConnectionFactory() = default;
+               LibVLCHTTPConnectionFactory( vlc_object_t *, AuthStorage * );
+               virtual ~LibVLCHTTPConnectionFactory();
                AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &) override;
+               void getStats(struct vlc_demux_adaptive_stats *) const override;
            private:
+               vlc_object_t *p_obj;
                AuthStorage *authStorage;
+               struct vlc_http_pool *pool; /* shared HTTP/2 connections */
        };
 
        class StreamUrlConnectionFactory : public AbstractConnectionFactory
@@ -42,6 +42,7 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = nullptr;
+    b_lowlatency = false;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
@@ -62,22 +63,39 @@ void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid,
     }
 }
 
+void AbstractConnectionManager::updateTransferRate(const adaptive::ID &sourceid, size_t size,
+                                                   vlc_tick_t time)
+{
+    if(rateObserver)
+        rateObserver->updateTransferRate(sourceid, size, time);
+}
+
 void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
 {
     rateObserver = obs;
 }
 
+void AbstractConnectionManager::setLowLatency(bool b)
+{
+    b_lowlatency = b;
+}
+
 void AbstractConnectionManager::deleteSource(AbstractChunkSource *source)
 {
     delete source;
 }
 
-HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_)
+void AbstractConnectionManager::getStats(struct vlc_demux_adaptive_stats *) const
+{
+}
+
+HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_,
+                                                 unsigned downloaders)
     : AbstractConnectionManager( p_object_ ),
       localAllowed(false)
 {
     vlc_mutex_init(&lock);
-    downloader = new Downloader();
+    downloader = new Downloader(downloaders);
     downloaderhp = new Downloader();
     downloader->start();
     downloaderhp->start();
@@ -190,11 +208,17 @@ AbstractChunkSource *HTTPConnectionManager::makeSource(const std::string &url,
                 }
             }
             // fallthrough
-        case ChunkType::Segment:
         case ChunkType::Key:
         case ChunkType::Playlist:
         default:
             return new HTTPChunkBufferedSource(url, this, id, type, range);
+        case ChunkType::Segment:
+        {
+            HTTPChunkBufferedSource *source =
+                    new HTTPChunkBufferedSource(url, this, id, type, range);
+            source->setLowLatency(b_lowlatency);
+            return source;
+        }
     }
 }
 
@@ -276,3 +300,9 @@ void HTTPConnectionManager::addFactory(AbstractConnectionFactory *factory)
 {
     factories.push_back(factory);
 }
+
+void HTTPConnectionManager::getStats(struct vlc_demux_adaptive_stats *stats) const
+{
+    for(const AbstractConnectionFactory *factory : factories)
+        factory->getStats(stats);
+}
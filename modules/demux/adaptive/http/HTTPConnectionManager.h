@@ -35,6 +35,8 @@
 #include <list>
 #include <string>
 
+struct vlc_demux_adaptive_stats;
+
 namespace adaptive
 {
     namespace http
@@ -67,11 +69,16 @@ namespace adaptive
 
                 virtual void updateDownloadRate(const ID &, size_t,
                                                 vlc_tick_t, vlc_tick_t) override;
+                virtual void updateTransferRate(const ID &, size_t,
+                                                vlc_tick_t) override;
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                void setLowLatency(bool);
+                virtual void getStats(struct vlc_demux_adaptive_stats *) const;
 
             protected:
                 void deleteSource(AbstractChunkSource *);
                 vlc_object_t                                       *p_object;
+                bool                                                b_lowlatency;
 
             private:
                 IDownloadRateObserver                              *rateObserver;
@@ -80,7 +87,8 @@ namespace adaptive
         class HTTPConnectionManager : public AbstractConnectionManager
         {
             public:
-                HTTPConnectionManager           (vlc_object_t *p_object);
+                HTTPConnectionManager           (vlc_object_t *p_object,
+                                                 unsigned downloaders = 1);
                 virtual ~HTTPConnectionManager  ();
 
                 void    closeAllConnections ()  override;
@@ -94,6 +102,7 @@ namespace adaptive
                 void cancel(AbstractChunkSource *)  override;
                 void         setLocalConnectionsAllowed();
                 void         addFactory(AbstractConnectionFactory *);
+                void getStats(struct vlc_demux_adaptive_stats *) const override;
 
             private:
                 void    releaseAllConnections ();
@@ -51,6 +51,8 @@ namespace adaptive
                 virtual BaseRepresentation* getNextRepresentation(BaseAdaptationSet *, BaseRepresentation *) = 0;
                 void                        updateDownloadRate     (const ID &, size_t,
                                                                     vlc_tick_t, vlc_tick_t) override;
+                void                        updateTransferRate     (const ID &, size_t,
+                                                                    vlc_tick_t) override {}
                 void                        trackerEvent           (const TrackerEvent &) override {}
                 void                        setMaxDeviceResolution (int, int);
 
@@ -63,6 +65,7 @@ namespace adaptive
                     FixedRate,
                     Predictive,
                     NearOptimal,
+                    Throughput,
                 };
 
             protected:
@@ -31,6 +31,7 @@
 
 #include <limits>
 #include <cassert>
+#include <cmath>
 
 using namespace adaptive;
 using namespace adaptive::playlist;
@@ -40,12 +41,17 @@ const vlc_tick_t AbstractBufferingLogic::BUFFERING_LOWEST_LIMIT = VLC_TICK_FROM_
 const vlc_tick_t AbstractBufferingLogic::DEFAULT_MIN_BUFFERING = VLC_TICK_FROM_SEC(6);
 const vlc_tick_t AbstractBufferingLogic::DEFAULT_MAX_BUFFERING = VLC_TICK_FROM_SEC(30);
 const vlc_tick_t AbstractBufferingLogic::DEFAULT_LIVE_BUFFERING = VLC_TICK_FROM_SEC(15);
+const vlc_tick_t AbstractBufferingLogic::DEFAULT_LIVE_LATENCY = VLC_TICK_FROM_SEC(3);
+const vlc_tick_t AbstractBufferingLogic::LIVE_LATENCY_TOLERANCE = VLC_TICK_FROM_MS(250);
+const double AbstractBufferingLogic::DEFAULT_CATCHUP_RATE = 0.05;
 
 AbstractBufferingLogic::AbstractBufferingLogic()
 {
     userMinBuffering = 0;
     userMaxBuffering = 0;
     userLiveDelay = 0;
+    userLiveLatency = 0;
+    userCatchUpRate = DEFAULT_CATCHUP_RATE;
 }
 
 void AbstractBufferingLogic::setLowDelay(bool b)
@@ -68,6 +74,16 @@ void AbstractBufferingLogic::setUserLiveDelay(vlc_tick_t v)
     userLiveDelay = v;
 }
 
+void AbstractBufferingLogic::setUserLiveLatency(vlc_tick_t v)
+{
+    userLiveLatency = v;
+}
+
+void AbstractBufferingLogic::setUserCatchUpRate(double v)
+{
+    userCatchUpRate = v;
+}
+
 /* Try to never buffer up to really end */
 /* Enforce no overlap for demuxers segments 3.0.0 */
 /* FIXME: check duration instead ? */
@@ -128,7 +144,7 @@ vlc_tick_t DefaultBufferingLogic::getMaxBuffering(const BasePlaylist *p) const
 vlc_tick_t DefaultBufferingLogic::getLiveDelay(const BasePlaylist *p) const
 {
     if(isLowLatency(p))
-        return getMinBuffering(p);
+        return std::max(getLiveLatency(p), getMinBuffering(p));
     vlc_tick_t delay = userLiveDelay ? userLiveDelay
                                      : DEFAULT_LIVE_BUFFERING;
     if(p->suggestedPresentationDelay)
@@ -389,3 +405,48 @@ bool DefaultBufferingLogic::isLowLatency(const BasePlaylist *p) const
 {
     return userLowLatency.value_or(p->isLowLatency());
 }
+
+vlc_tick_t DefaultBufferingLogic::getLiveLatency(const BasePlaylist *p) const
+{
+    if(userLiveLatency)
+        return userLiveLatency;
+    if(p->targetLatency)
+        return p->targetLatency;
+    return DEFAULT_LIVE_LATENCY;
+}
+
+double DefaultBufferingLogic::getCatchUpRate(const BasePlaylist *p, vlc_tick_t latency,
+                                             vlc_tick_t buffering) const
+{
+    if(!p->isLive() || !isLowLatency(p) || latency == VLC_TICK_INVALID)
+        return 1.0;
+
+    const vlc_tick_t target = getLiveDelay(p);
+    const vlc_tick_t delta = latency - target;
+    if(delta > -LIVE_LATENCY_TOLERANCE && delta < LIVE_LATENCY_TOLERANCE)
+        return 1.0;
+    /* Way behind, the user paused or seeked back: don't drag to the edge */
+    if(delta > 3 * target)
+        return 1.0;
+
+    /* Playlist can restrict the playback rate range */
+    double maxdeviation = userCatchUpRate;
+    if(delta > 0)
+    {
+        if(p->maxPlaybackRate > 1.0)
+            maxdeviation = std::min(maxdeviation, p->maxPlaybackRate - 1.0);
+        /* Don't speed up on a starving buffer, it would only rebuffer */
+        if(buffering < BUFFERING_LOWEST_LIMIT / 4)
+            return 1.0;
+    }
+    else if(p->minPlaybackRate > 0.0 && p->minPlaybackRate < 1.0)
+    {
+        maxdeviation = std::min(maxdeviation, 1.0 - p->minPlaybackRate);
+    }
+    if(maxdeviation <= 0.0)
+        return 1.0;
+
+    /* Proportional close to the target, saturating away from it */
+    const double x = secf_from_vlc_tick(delta);
+    return 1.0 + maxdeviation * (2.0 / (1.0 + std::exp(-5.0 * x)) - 1.0);
+}
@@ -48,19 +48,30 @@ namespace adaptive
                 virtual vlc_tick_t getMaxBuffering(const BasePlaylist *) const = 0;
                 virtual vlc_tick_t getLiveDelay(const BasePlaylist *) const = 0;
                 virtual vlc_tick_t getStableBuffering(const BasePlaylist *) const = 0;
+                virtual bool isLowLatency(const BasePlaylist *) const = 0;
+                /* playback rate to converge on the live latency target */
+                virtual double getCatchUpRate(const BasePlaylist *, vlc_tick_t latency,
+                                              vlc_tick_t buffering) const = 0;
                 void setUserMinBuffering(vlc_tick_t);
                 void setUserMaxBuffering(vlc_tick_t);
                 void setUserLiveDelay(vlc_tick_t);
+                void setUserLiveLatency(vlc_tick_t);
+                void setUserCatchUpRate(double);
                 void setLowDelay(bool);
                 static const vlc_tick_t BUFFERING_LOWEST_LIMIT;
                 static const vlc_tick_t DEFAULT_MIN_BUFFERING;
                 static const vlc_tick_t DEFAULT_MAX_BUFFERING;
                 static const vlc_tick_t DEFAULT_LIVE_BUFFERING;
+                static const vlc_tick_t DEFAULT_LIVE_LATENCY;
+                static const vlc_tick_t LIVE_LATENCY_TOLERANCE;
+                static const double DEFAULT_CATCHUP_RATE;
 
             protected:
                 vlc_tick_t userMinBuffering;
                 vlc_tick_t userMaxBuffering;
                 vlc_tick_t userLiveDelay;
+                vlc_tick_t userLiveLatency;
+                double userCatchUpRate;
                 optional<bool> userLowLatency;
         };
 
@@ -74,13 +85,16 @@ namespace adaptive
                 vlc_tick_t getMaxBuffering(const BasePlaylist *) const override;
                 vlc_tick_t getLiveDelay(const BasePlaylist *) const override;
                 vlc_tick_t getStableBuffering(const BasePlaylist *) const override;
+                bool isLowLatency(const BasePlaylist *) const override;
+                double getCatchUpRate(const BasePlaylist *, vlc_tick_t,
+                                      vlc_tick_t) const override;
                 static const unsigned SAFETY_BUFFERING_EDGE_OFFSET;
                 static const unsigned SAFETY_EXPURGING_OFFSET;
 
             protected:
                 vlc_tick_t getBufferingOffset(const BasePlaylist *) const;
                 uint64_t getLiveStartSegmentNumber(BaseRepresentation *) const;
-                bool isLowLatency(const BasePlaylist *) const;
+                vlc_tick_t getLiveLatency(const BasePlaylist *) const;
         };
     }
 }
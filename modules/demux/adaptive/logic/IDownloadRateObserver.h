@@ -41,6 +41,9 @@ namespace adaptive
         public:
             virtual void updateDownloadRate(const ID &, size_t,
                                             vlc_tick_t, vlc_tick_t) = 0;
+            /* size and time spent receiving it, without request
+             * latency and idle gaps */
+            virtual void updateTransferRate(const ID &, size_t, vlc_tick_t) = 0;
     };
 }
 
@@ -0,0 +1,299 @@
+/*
+ * ThroughputAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "ThroughputAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../tools/Debug.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+/*
+ * Throughput rule while the buffer is low, then buffer based selection
+ * (BOLA, as in dash.js), which is only allowed to step up to what the
+ * network sustains and to step down to it.
+ *
+ * The throughput is a percentile of the transfer rates of the last
+ * segments. Samples only account for the time spent receiving data,
+ * and are weighted by it: slow transfers weigh more.
+ */
+
+#define minimumBufferS VLC_TICK_FROM_SEC(6)  /* Qmin */
+#define bufferTargetS  VLC_TICK_FROM_SEC(30) /* Qmax */
+
+ThroughputContext::ThroughputContext()
+    : buffering_min( minimumBufferS )
+    , buffering_level( 0 )
+    , buffering_target( bufferTargetS )
+{ }
+
+ThroughputAdaptationLogic::ThroughputAdaptationLogic(vlc_object_t *obj)
+    : AbstractAdaptationLogic(obj)
+    , estimateBps( 0 )
+    , usedBps( 0 )
+{
+    vlc_mutex_init(&lock);
+}
+
+ThroughputAdaptationLogic::~ThroughputAdaptationLogic()
+{
+
+}
+
+BaseRepresentation *
+ThroughputAdaptationLogic::getThroughputQuality(BaseAdaptationSet *adaptSet,
+                                                RepresentationSelector &selector,
+                                                unsigned bps) const
+{
+    BaseRepresentation *m = selector.select(adaptSet, bps);
+    if(m == selector.lowest(adaptSet))
+    {
+        /* Handle HLS specific cases where the lowest is audio only. Try to pick first A+V */
+        BaseRepresentation *n = selector.higher(adaptSet, m);
+        if(m != n  && m->getCodecs().size() == 1 && n->getCodecs().size() > 1)
+            m = n;
+    }
+    return m;
+}
+
+BaseRepresentation *
+ThroughputAdaptationLogic::getBufferQuality(BaseAdaptationSet *adaptSet,
+                                            RepresentationSelector &selector,
+                                            const ThroughputContext &ctx)
+{
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+
+    /* utilities are relative to the lowest quality, which is 1 */
+    const float base = std::log((float)lowest->getBandwidth());
+    const float umax = std::log((float)highest->getBandwidth()) - base + 1.0f;
+
+    /* the highest quality is picked once the buffer reaches the target */
+    const float gammaP = (umax - 1.0f) / ((float)ctx.buffering_target / ctx.buffering_min - 1.0f);
+    const float Vp = secf_from_vlc_tick(ctx.buffering_min) / gammaP;
+    const float Q = secf_from_vlc_tick(ctx.buffering_level);
+
+    BaseRepresentation *ret = nullptr;
+    BaseRepresentation *prev = nullptr;
+    float argmax = 0;
+    for(BaseRepresentation *rep = lowest;
+                            rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        const float u = std::log((float)rep->getBandwidth()) - base + 1.0f;
+        const float arg = (Vp * (u + gammaP) - Q) / rep->getBandwidth();
+        if(ret == nullptr || argmax <= arg)
+        {
+            ret = rep;
+            argmax = arg;
+        }
+        prev = rep;
+    }
+    return ret;
+}
+
+BaseRepresentation *ThroughputAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet,
+                                                                     BaseRepresentation *prevRep)
+{
+    RepresentationSelector selector(maxwidth, maxheight);
+
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    if(lowest == nullptr || highest == nullptr)
+        return nullptr;
+
+    if(lowest == highest)
+        return lowest;
+
+    vlc_mutex_lock(&lock);
+
+    std::map<ID, ThroughputContext>::iterator it = streams.find(adaptSet->getID());
+    if(it == streams.end())
+    {
+        vlc_mutex_unlock(&lock);
+        return lowest;
+    }
+    ThroughputContext ctxcopy = (*it).second;
+
+    const unsigned bps = (uint64_t) getAvailableBw(estimateBps, prevRep) * SAFETY / 100;
+
+    vlc_mutex_unlock(&lock);
+
+    BaseRepresentation *m = getThroughputQuality(adaptSet, selector, bps);
+
+    /* Starting, or the buffer is too low to absorb a wrong guess */
+    if(prevRep == nullptr || ctxcopy.buffering_level < ctxcopy.buffering_min ||
+       ctxcopy.buffering_target <= ctxcopy.buffering_min)
+    {
+        BwDebug( msg_Info(p_obj, "buffering level %.2f%% rep %" PRId64 " kBps %u kBps (throughput)",
+                 (float) 100 * ctxcopy.buffering_level / ctxcopy.buffering_target,
+                 m->getBandwidth()/8000, bps / 8000); );
+        return m;
+    }
+
+    BaseRepresentation *b = getBufferQuality(adaptSet, selector, ctxcopy);
+    if(b->getBandwidth() > prevRep->getBandwidth())
+    {
+        /* do not step up beyond the sustainable rate */
+        if(b->getBandwidth() > m->getBandwidth())
+            b = (m->getBandwidth() > prevRep->getBandwidth()) ? m : prevRep;
+    }
+    else if(b->getBandwidth() < prevRep->getBandwidth())
+    {
+        /* neither step down below it */
+        if(b->getBandwidth() < m->getBandwidth())
+            b = (m->getBandwidth() < prevRep->getBandwidth()) ? m : prevRep;
+    }
+
+    BwDebug( msg_Info(p_obj, "buffering level %.2f%% rep %" PRId64 " kBps %u kBps",
+             (float) 100 * ctxcopy.buffering_level / ctxcopy.buffering_target,
+             b->getBandwidth()/8000, bps / 8000); );
+
+    return b;
+}
+
+unsigned ThroughputAdaptationLogic::getAvailableBw(unsigned i_bw, const BaseRepresentation *curRep) const
+{
+    unsigned i_remain = i_bw;
+    if(i_remain > usedBps)
+        i_remain -= usedBps;
+    else
+        i_remain = 0;
+    if(curRep)
+        i_remain += curRep->getBandwidth();
+    return std::min(i_remain, i_bw);
+}
+
+/* bits per second of a transfer, clamped to the range of the estimate */
+static unsigned transferBps(uint64_t size, vlc_tick_t time)
+{
+    const uint64_t max = std::numeric_limits<unsigned>::max();
+    const uint64_t bits = size * 8;
+    const uint64_t t = time;
+    if(bits / t >= max / CLOCK_FREQ)
+        return max;
+    return std::min(bits / t * CLOCK_FREQ + bits % t * CLOCK_FREQ / t, max);
+}
+
+unsigned ThroughputAdaptationLogic::computeEstimate() const
+{
+    std::vector<Sample> sorted(samples.begin(), samples.end());
+    std::sort(sorted.begin(), sorted.end(), [](const Sample &a, const Sample &b)
+                { return transferBps(a.size, a.time) < transferBps(b.size, b.time); });
+
+    vlc_tick_t total = 0;
+    for(const Sample &s : sorted)
+        total += s.time;
+
+    vlc_tick_t sum = 0;
+    for(const Sample &s : sorted)
+    {
+        sum += s.time;
+        if(sum * 100 >= total * PERCENTILE)
+            return transferBps(s.size, s.time);
+    }
+    return 0;
+}
+
+unsigned ThroughputAdaptationLogic::getThroughputEstimate() const
+{
+    vlc_mutex_locker locker(&lock);
+    return estimateBps;
+}
+
+void ThroughputAdaptationLogic::updateTransferRate(const ID &, size_t size, vlc_tick_t time)
+{
+    if(unlikely(time <= 0 || size == 0))
+        return;
+
+    vlc_mutex_locker locker(&lock);
+    samples.push_back({size, time});
+    if(samples.size() > WINDOW_SIZE)
+        samples.pop_front();
+    estimateBps = computeEstimate();
+
+    BwDebug(msg_Dbg(p_obj, "transfer %" PRId64 " kBps -> estimate %u kBps",
+                    uint64_t{transferBps(size, time)} / 8000, estimateBps / 8000));
+}
+
+void ThroughputAdaptationLogic::trackerEvent(const TrackerEvent &ev)
+{
+    switch(ev.getType())
+    {
+    case TrackerEvent::Type::RepresentationSwitch:
+        {
+            const RepresentationSwitchEvent &event =
+                    static_cast<const RepresentationSwitchEvent &>(ev);
+            vlc_mutex_locker locker(&lock);
+            if(event.prev)
+                usedBps -= event.prev->getBandwidth();
+            if(event.next)
+                usedBps += event.next->getBandwidth();
+            BwDebug(msg_Info(p_obj, "New total bandwidth usage %u kBps", (usedBps / 8000)));
+        }
+        break;
+
+    case TrackerEvent::Type::BufferingStateUpdate:
+        {
+            const BufferingStateUpdatedEvent &event =
+                    static_cast<const BufferingStateUpdatedEvent &>(ev);
+            const ID &id = *event.id;
+            vlc_mutex_locker locker(&lock);
+            if(event.enabled)
+            {
+                if(streams.find(id) == streams.end())
+                    streams.insert(std::pair<ID, ThroughputContext>(id, ThroughputContext()));
+            }
+            else
+            {
+                std::map<ID, ThroughputContext>::iterator it = streams.find(id);
+                if(it != streams.end())
+                    streams.erase(it);
+            }
+        }
+        break;
+
+    case TrackerEvent::Type::BufferingLevelChange:
+        {
+            const BufferingLevelChangedEvent &event =
+                    static_cast<const BufferingLevelChangedEvent &>(ev);
+            const ID &id = *event.id;
+            vlc_mutex_locker locker(&lock);
+            ThroughputContext &ctx = streams[id];
+            ctx.buffering_min = event.minimum;
+            ctx.buffering_level = event.current;
+            ctx.buffering_target = event.target;
+        }
+        break;
+
+    default:
+            break;
+    }
+}
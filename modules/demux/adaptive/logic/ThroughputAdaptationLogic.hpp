@@ -0,0 +1,85 @@
+/*
+ * ThroughputAdaptationLogic.hpp
+ *****************************************************************************
+ * Copyright (C) 2026 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef THROUGHPUTADAPTATIONLOGIC_HPP
+#define THROUGHPUTADAPTATIONLOGIC_HPP
+
+#include "AbstractAdaptationLogic.h"
+#include "Representationselectors.hpp"
+#include <deque>
+#include <map>
+
+#include <vlc_threads.h>
+
+namespace adaptive
+{
+    namespace logic
+    {
+        class ThroughputContext
+        {
+            friend class ThroughputAdaptationLogic;
+
+            public:
+                ThroughputContext();
+
+            private:
+                vlc_tick_t buffering_min;
+                vlc_tick_t buffering_level;
+                vlc_tick_t buffering_target;
+        };
+
+        class ThroughputAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                ThroughputAdaptationLogic(vlc_object_t *);
+                virtual ~ThroughputAdaptationLogic();
+
+                BaseRepresentation* getNextRepresentation(BaseAdaptationSet *,
+                                                          BaseRepresentation *) override;
+                void                updateTransferRate     (const ID &, size_t,
+                                                            vlc_tick_t) override;
+                void                trackerEvent           (const TrackerEvent &) override;
+                unsigned            getThroughputEstimate  () const;
+
+                static const unsigned WINDOW_SIZE = 12;   /* samples */
+                static const unsigned PERCENTILE  = 50;   /* of the transfer time */
+                static const unsigned SAFETY      = 90;   /* % of the estimate used */
+
+            private:
+                struct Sample
+                {
+                    size_t size;
+                    vlc_tick_t time;
+                };
+                BaseRepresentation *        getThroughputQuality(BaseAdaptationSet *, RepresentationSelector &,
+                                                                 unsigned) const;
+                BaseRepresentation *        getBufferQuality(BaseAdaptationSet *, RepresentationSelector &,
+                                                             const ThroughputContext &);
+                unsigned                    getAvailableBw(unsigned, const BaseRepresentation *) const;
+                unsigned                    computeEstimate() const;
+                std::deque<Sample>          samples;
+                std::map<adaptive::ID, ThroughputContext> streams;
+                unsigned                    estimateBps;
+                unsigned                    usedBps;
+                mutable vlc_mutex_t         lock;
+        };
+    }
+}
+
+#endif // THROUGHPUTADAPTATIONLOGIC_HPP
@@ -48,6 +48,9 @@ BasePlaylist::BasePlaylist (vlc_object_t *p_object_) :
     timeShiftBufferDepth = 0;
     suggestedPresentationDelay = 0;
     presentationStartOffset = 0;
+    targetLatency = 0;
+    minPlaybackRate = 0;
+    maxPlaybackRate = 0;
     b_needsUpdates = true;
 }
 
@@ -162,6 +165,9 @@ bool BasePlaylist::needsUpdates() const
 void BasePlaylist::updateWith(BasePlaylist *updatedPlaylist)
 {
     availabilityEndTime = updatedPlaylist->availabilityEndTime;
+    targetLatency = updatedPlaylist->targetLatency;
+    minPlaybackRate = updatedPlaylist->minPlaybackRate;
+    maxPlaybackRate = updatedPlaylist->maxPlaybackRate;
 
     for(size_t i = 0; i < periods.size() && i < updatedPlaylist->periods.size(); i++)
         periods.at(i)->updateWith(updatedPlaylist->periods.at(i));
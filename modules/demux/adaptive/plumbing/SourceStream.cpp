@@ -142,6 +142,10 @@ ssize_t ChunksSourceStream::Read(uint8_t *buf, size_t size)
 
     while(i_toread && !b_eof)
     {
+        /* Don't wait for the next block, short reads are fine */
+        if(!p_block && i_copied)
+            break;
+
         if(!p_block && !(p_block = source->readNextBlock()))
         {
             b_eof = true;
@@ -0,0 +1,254 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2026 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../http/HTTPConnectionManager.h"
+#include "../../http/HTTPConnection.hpp"
+#include "../../http/ConnectionParams.hpp"
+#include "../../http/Chunk.h"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_cxx_helpers.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+/* Stub server: resources are served instantly, and the path ends with
+ * their size. Requests for the held resource wait until it is released,
+ * as if the server stalled on it. */
+struct StubServer
+{
+    std::atomic<unsigned> connections;
+    std::atomic<unsigned> requests;
+    vlc::threads::mutex lock;
+    vlc::threads::condition_variable cond;
+    std::string held;
+    bool stalled;
+    std::vector<std::string> paths; /* in request order */
+};
+
+class StubConnection : public AbstractConnection
+{
+    public:
+        StubConnection(StubServer *s) : AbstractConnection(nullptr), server(s) {}
+        virtual ~StubConnection() = default;
+
+        bool canReuse(const ConnectionParams &p) const override
+        {
+            return available && params.getHostname() == p.getHostname();
+        }
+
+        RequestStatus request(const std::string &path,
+                              const BytesRange & = BytesRange()) override
+        {
+            server->requests++;
+            {
+                vlc::threads::mutex_locker locker {server->lock};
+                server->paths.push_back(path);
+                if(path == server->held)
+                {
+                    server->stalled = true;
+                    server->cond.broadcast();
+                    /* the deadline only avoids hanging if the test fails */
+                    vlc_tick_t deadline = vlc_tick_now() + VLC_TICK_FROM_SEC(10);
+                    while(!server->held.empty() &&
+                          server->cond.timedwait(server->lock, deadline) == 0);
+                }
+            }
+            contentLength = std::strtoul(&path[path.rfind('/') + 1], nullptr, 10);
+            contentType = "video/mp4";
+            bytesRead = 0;
+            return RequestStatus::Success;
+        }
+
+        ssize_t read(void *p_buffer, size_t len) override
+        {
+            if(len > contentLength - bytesRead)
+                len = contentLength - bytesRead;
+            if(len == 0)
+                return 0;
+            std::memset(p_buffer, 0, len);
+            bytesRead += len;
+            return len;
+        }
+
+        void setUsed(bool b) override
+        {
+            available = !b;
+        }
+
+    private:
+        StubServer *server;
+};
+
+class StubConnectionFactory : public AbstractConnectionFactory
+{
+    public:
+        StubConnectionFactory(StubServer *s) : server(s) {}
+        virtual ~StubConnectionFactory() = default;
+        AbstractConnection * createConnection(vlc_object_t *,
+                                              const ConnectionParams &) override
+        {
+            server->connections++;
+            return new StubConnection(server);
+        }
+
+    private:
+        StubServer *server;
+};
+
+#define SEGMENT_COUNT    12
+#define SUBS_PATH        "/subs/init/1048576"
+
+static void ReadAll(AbstractChunkSource *source)
+{
+    while(source->hasMoreData())
+    {
+        block_t *b = source->readBlock();
+        if(b)
+            block_Release(b);
+    }
+}
+
+static void Release(StubServer *server)
+{
+    vlc::threads::mutex_locker locker {server->lock};
+    server->held.clear();
+    server->cond.broadcast();
+}
+
+/* Returns the position of a request, or the number of requests if it was
+ * never made */
+static size_t RequestIndex(StubServer *server, const std::string &path)
+{
+    vlc::threads::mutex_locker locker {server->lock};
+    return std::find(server->paths.begin(), server->paths.end(), path)
+           - server->paths.begin();
+}
+
+/* Starts a large subtitles init segment, then the audio and video segments,
+ * and reads the video then the audio. With several downloaders, the server
+ * stalls on the subtitles until all of the video and audio is read. */
+static void Play(StubServer *server, unsigned downloaders)
+{
+    HTTPConnectionManager manager(nullptr, downloaders);
+    manager.addFactory(new StubConnectionFactory(server));
+
+    server->connections = 0;
+    server->requests = 0;
+    server->paths.clear();
+    server->stalled = false;
+    server->held = downloaders > 1 ? SUBS_PATH : "";
+
+    AbstractChunkSource *subs = manager.makeSource("http://stub" SUBS_PATH,
+                                                   ID("subs"), ChunkType::Init,
+                                                   BytesRange());
+    manager.start(subs);
+
+    std::vector<AbstractChunkSource *> video, audio;
+    for(unsigned i = 0; i < SEGMENT_COUNT; i++)
+    {
+        std::string n = std::to_string(i);
+        video.push_back(manager.makeSource("http://stub/video/" + n + "/196608",
+                                           ID("video"), ChunkType::Segment,
+                                           BytesRange()));
+        audio.push_back(manager.makeSource("http://stub/audio/" + n + "/16384",
+                                           ID("audio"), ChunkType::Segment,
+                                           BytesRange()));
+        manager.start(video.back());
+        manager.start(audio.back());
+    }
+
+    for(AbstractChunkSource *source : video)
+    {
+        ReadAll(source);
+        source->recycle();
+    }
+    for(AbstractChunkSource *source : audio)
+    {
+        ReadAll(source);
+        source->recycle();
+    }
+
+    if(downloaders > 1)
+    {
+        vlc::threads::mutex_locker locker {server->lock};
+        /* the video and audio did not wait behind the subtitles */
+        Expect(server->stalled);
+        Expect(!server->held.empty());
+    }
+    Release(server);
+    ReadAll(subs);
+    subs->recycle();
+
+    /* each stream is requested in order */
+    for(const char *stream : {"video", "audio"})
+    {
+        size_t prev = 0;
+        for(unsigned i = 0; i < SEGMENT_COUNT; i++)
+        {
+            std::string n = std::to_string(i);
+            size_t index = RequestIndex(server, std::string("/") + stream +
+                                        "/" + n + (*stream == 'v' ? "/196608"
+                                                                  : "/16384"));
+            Expect(index < server->paths.size());
+            Expect(i == 0 || index > prev);
+            prev = index;
+        }
+    }
+    Expect(RequestIndex(server, SUBS_PATH) < server->paths.size());
+
+    std::cerr << "  " << downloaders << " downloader(s): "
+              << server->connections << " connection(s) for "
+              << server->requests << " requests" << std::endl;
+}
+
+int Downloader_test()
+{
+    StubServer server;
+
+    try
+    {
+        for(unsigned downloaders : {1, 3})
+        {
+            Play(&server, downloaders);
+
+            Expect(server.requests == 2 * SEGMENT_COUNT + 1);
+            /* connections are reused once their chunk is downloaded: at most
+             * one per stream is in use at a time */
+            Expect(server.connections <= 3);
+        }
+    } catch(...) {
+        Release(&server);
+        return 1;
+    }
+
+    return 0;
+}
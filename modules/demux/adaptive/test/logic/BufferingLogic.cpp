@@ -143,8 +143,42 @@ int BufferingLogic_test()
         Expect(bufferinglogic.getMaxBuffering(playlist) < DefaultBufferingLogic::DEFAULT_MAX_BUFFERING);
         Expect(bufferinglogic.getMinBuffering(playlist) >= DefaultBufferingLogic::BUFFERING_LOWEST_LIMIT);
         Expect(bufferinglogic.getLiveDelay(playlist) >= DefaultBufferingLogic::BUFFERING_LOWEST_LIMIT);
+        Expect(bufferinglogic.getLiveDelay(playlist) == std::max(DefaultBufferingLogic::DEFAULT_LIVE_LATENCY,
+                                                                 DefaultBufferingLogic::BUFFERING_LOWEST_LIMIT));
+
+        playlist->targetLatency = DefaultBufferingLogic::DEFAULT_LIVE_LATENCY * 2;
+        Expect(bufferinglogic.getLiveDelay(playlist) == playlist->targetLatency);
+        bufferinglogic.setUserLiveLatency(DefaultBufferingLogic::DEFAULT_LIVE_LATENCY * 3);
+        Expect(bufferinglogic.getLiveDelay(playlist) == DefaultBufferingLogic::DEFAULT_LIVE_LATENCY * 3);
+        bufferinglogic.setUserLiveLatency(0);
+        playlist->targetLatency = 0;
+
+        /* catch-up */
+        const vlc_tick_t target = bufferinglogic.getLiveDelay(playlist);
+        const vlc_tick_t buffering = DefaultBufferingLogic::BUFFERING_LOWEST_LIMIT;
+        Expect(bufferinglogic.getCatchUpRate(playlist, target, buffering) == 1.0);
+        Expect(bufferinglogic.getCatchUpRate(playlist, target + DefaultBufferingLogic::LIVE_LATENCY_TOLERANCE / 2,
+                                             buffering) == 1.0);
+        double rate = bufferinglogic.getCatchUpRate(playlist, target + VLC_TICK_FROM_SEC(1), buffering);
+        Expect(rate > 1.0);
+        Expect(rate <= 1.0 + DefaultBufferingLogic::DEFAULT_CATCHUP_RATE);
+        Expect(bufferinglogic.getCatchUpRate(playlist, target + VLC_TICK_FROM_SEC(2), buffering) > rate);
+        rate = bufferinglogic.getCatchUpRate(playlist, target - VLC_TICK_FROM_SEC(1), buffering);
+        Expect(rate < 1.0);
+        Expect(rate >= 1.0 - DefaultBufferingLogic::DEFAULT_CATCHUP_RATE);
+        /* starving or far behind */
+        Expect(bufferinglogic.getCatchUpRate(playlist, target + VLC_TICK_FROM_SEC(1), 0) == 1.0);
+        Expect(bufferinglogic.getCatchUpRate(playlist, target * 10, buffering) == 1.0);
+
+        playlist->maxPlaybackRate = 1.01f;
+        Expect(bufferinglogic.getCatchUpRate(playlist, target + VLC_TICK_FROM_SEC(2), buffering) <= 1.01);
+        playlist->maxPlaybackRate = 0;
+        bufferinglogic.setUserCatchUpRate(0);
+        Expect(bufferinglogic.getCatchUpRate(playlist, target + VLC_TICK_FROM_SEC(1), buffering) == 1.0);
+        bufferinglogic.setUserCatchUpRate(DefaultBufferingLogic::DEFAULT_CATCHUP_RATE);
 
         playlist->b_lowlatency = false;
+        Expect(bufferinglogic.getCatchUpRate(playlist, target + VLC_TICK_FROM_SEC(1), buffering) == 1.0);
         Expect(bufferinglogic.getStartSegmentNumber(rep) == number);
 
         while(segmentList->getTotalLength() <
@@ -0,0 +1,336 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2026 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../playlist/BasePlaylist.hpp"
+#include "../../playlist/BasePeriod.h"
+#include "../../playlist/BaseAdaptationSet.h"
+#include "../../playlist/BaseRepresentation.h"
+#include "../../logic/ThroughputAdaptationLogic.hpp"
+#include "../../logic/NearOptimalAdaptationLogic.hpp"
+#include "../../logic/RateBasedAdaptationLogic.h"
+#include "../../SegmentTracker.hpp"
+
+#include "../test.hpp"
+
+#include <iomanip>
+#include <limits>
+#include <vector>
+
+using namespace adaptive;
+using namespace adaptive::playlist;
+using namespace logic;
+
+namespace
+{
+
+/* Replays a bandwidth trace against a logic, downloading segments
+ * one after another for a single stream, and plays them back. */
+
+struct TracePoint
+{
+    vlc_tick_t duration;
+    uint64_t bps;
+};
+
+struct Metrics
+{
+    uint64_t averageBps;
+    unsigned switches;
+    vlc_tick_t rebuffering;
+    unsigned stalls;
+};
+
+const vlc_tick_t SEGMENT_DURATION = VLC_TICK_FROM_SEC(4);
+const vlc_tick_t REQUEST_LATENCY = VLC_TICK_FROM_MS(80);
+const vlc_tick_t MIN_BUFFERING = VLC_TICK_FROM_SEC(6);
+const vlc_tick_t MAX_BUFFERING = VLC_TICK_FROM_SEC(30);
+const vlc_tick_t TARGET_BUFFERING = VLC_TICK_FROM_SEC(20);
+const unsigned SEGMENTS = 150;
+
+class Trace
+{
+    public:
+        Trace(const std::vector<TracePoint> &p) : points(p)
+        {
+            total = 0;
+            for(const TracePoint &tp : points)
+                total += tp.duration;
+        }
+
+        /* bandwidth at time t, the trace loops */
+        const TracePoint & at(vlc_tick_t t, vlc_tick_t *remain) const
+        {
+            t %= total;
+            for(const TracePoint &tp : points)
+            {
+                if(t < tp.duration)
+                {
+                    *remain = tp.duration - t;
+                    return tp;
+                }
+                t -= tp.duration;
+            }
+            *remain = points.front().duration;
+            return points.front();
+        }
+
+        /* time needed to receive size bytes from time t */
+        vlc_tick_t transfer(vlc_tick_t t, uint64_t size) const
+        {
+            vlc_tick_t elapsed = 0;
+            double bits = size * 8.0;
+            while(bits > 0)
+            {
+                vlc_tick_t remain;
+                const TracePoint &tp = at(t + elapsed, &remain);
+                const double chunk = (double) tp.bps * remain / CLOCK_FREQ;
+                if(chunk >= bits)
+                {
+                    elapsed += bits * CLOCK_FREQ / tp.bps + 1;
+                    break;
+                }
+                bits -= chunk;
+                elapsed += remain;
+            }
+            return elapsed;
+        }
+
+    private:
+        std::vector<TracePoint> points;
+        vlc_tick_t total;
+};
+
+Metrics Simulate(AbstractAdaptationLogic &logic, BaseAdaptationSet *set,
+                 const Trace &trace)
+{
+    const ID &id = set->getID();
+    Metrics m = {0, 0, 0, 0};
+
+    logic.trackerEvent(BufferingStateUpdatedEvent(id, true));
+    logic.trackerEvent(BufferingLevelChangedEvent(id, MIN_BUFFERING, MAX_BUFFERING,
+                                                  0, TARGET_BUFFERING));
+
+    vlc_tick_t now = 0;
+    vlc_tick_t buffering = 0;
+    bool playing = false;
+    BaseRepresentation *prev = nullptr;
+    uint64_t sum = 0;
+
+    for(unsigned i = 0; i < SEGMENTS; i++)
+    {
+        BaseRepresentation *rep = logic.getNextRepresentation(set, prev);
+        if(rep != prev)
+        {
+            if(prev)
+                m.switches++;
+            logic.trackerEvent(RepresentationSwitchEvent(prev, rep));
+            prev = rep;
+        }
+        sum += rep->getBandwidth();
+
+        const uint64_t size = rep->getBandwidth() * SEGMENT_DURATION / CLOCK_FREQ / 8;
+        const vlc_tick_t transfer = trace.transfer(now + REQUEST_LATENCY, size);
+        const vlc_tick_t elapsed = REQUEST_LATENCY + transfer;
+        now += elapsed;
+
+        if(playing)
+        {
+            if(elapsed > buffering)
+            {
+                m.stalls++;
+                m.rebuffering += elapsed - buffering;
+                buffering = 0;
+            }
+            else buffering -= elapsed;
+        }
+        buffering += SEGMENT_DURATION;
+        playing = playing || buffering >= MIN_BUFFERING;
+
+        logic.updateDownloadRate(id, size, elapsed, REQUEST_LATENCY);
+        logic.updateTransferRate(id, size, transfer);
+
+        /* buffer is full, wait for playback to drain it */
+        if(buffering > MAX_BUFFERING)
+        {
+            now += buffering - MAX_BUFFERING;
+            buffering = MAX_BUFFERING;
+        }
+
+        logic.trackerEvent(BufferingLevelChangedEvent(id, MIN_BUFFERING, MAX_BUFFERING,
+                                                      buffering, TARGET_BUFFERING));
+    }
+
+    logic.trackerEvent(RepresentationSwitchEvent(prev, nullptr));
+    logic.trackerEvent(BufferingStateUpdatedEvent(id, false));
+
+    m.averageBps = sum / SEGMENTS;
+    return m;
+}
+
+void Report(const char *logic, const char *trace, const Metrics &m)
+{
+    std::cerr << "  " << std::left << std::setw(12) << trace
+              << std::setw(12) << logic
+              << " avg " << std::right << std::setw(5) << m.averageBps / 1000 << " kbps"
+              << " switches " << std::setw(3) << m.switches
+              << " stalls " << std::setw(2) << m.stalls
+              << " rebuffering " << MS_FROM_VLC_TICK(m.rebuffering) << " ms"
+              << std::endl;
+}
+
+class SimulationPlaylist : public BasePlaylist
+{
+    public:
+        SimulationPlaylist() : BasePlaylist(nullptr) {}
+        virtual ~SimulationPlaylist() {}
+        bool isLive() const override { return false; }
+};
+
+}
+
+int ThroughputAdaptationLogic_test()
+{
+    static const uint64_t bitrates[] = { 300000, 750000, 1200000, 2400000,
+                                         4000000, 6000000 };
+
+    SimulationPlaylist *playlist = nullptr;
+    try
+    {
+        playlist = new SimulationPlaylist();
+        BasePeriod *period = nullptr;
+        BaseAdaptationSet *set = nullptr;
+        try
+        {
+            period = new BasePeriod(playlist);
+            set = new BaseAdaptationSet(period);
+        } catch(...) {
+            delete period;
+            delete set;
+            std::rethrow_exception(std::current_exception());
+        }
+        set->setID(ID("video"));
+        period->addAdaptationSet(set);
+        playlist->addPeriod(period);
+        for(uint64_t bitrate : bitrates)
+        {
+            BaseRepresentation *rep = new BaseRepresentation(set);
+            rep->setBandwidth(bitrate);
+            set->addRepresentation(rep);
+        }
+
+        /* transfer rates only account for time receiving data */
+        {
+            ThroughputAdaptationLogic logic(nullptr);
+            Expect(logic.getThroughputEstimate() == 0);
+            logic.updateTransferRate(set->getID(), 500000, VLC_TICK_FROM_SEC(1));
+            Expect(logic.getThroughputEstimate() == 4000000);
+            /* slow transfers weigh more */
+            logic.updateTransferRate(set->getID(), 500000, VLC_TICK_FROM_SEC(4));
+            Expect(logic.getThroughputEstimate() == 1000000);
+            for(unsigned i = 0; i < ThroughputAdaptationLogic::WINDOW_SIZE; i++)
+                logic.updateTransferRate(set->getID(), 1000000, VLC_TICK_FROM_SEC(1));
+            Expect(logic.getThroughputEstimate() == 8000000);
+        }
+
+        /* rates beyond the range of the estimate saturate */
+        {
+            ThroughputAdaptationLogic logic(nullptr);
+            logic.updateTransferRate(set->getID(), 600000000, VLC_TICK_FROM_MS(100));
+            Expect(logic.getThroughputEstimate() == std::numeric_limits<unsigned>::max());
+            logic.updateTransferRate(set->getID(), 3000000000, 1);
+            Expect(logic.getThroughputEstimate() == std::numeric_limits<unsigned>::max());
+        }
+
+        const std::vector<TracePoint> steady = {
+            { VLC_TICK_FROM_SEC(600), 5000000 },
+        };
+        const std::vector<TracePoint> stepdown = {
+            { VLC_TICK_FROM_SEC(120), 8000000 },
+            { VLC_TICK_FROM_SEC(600), 1500000 },
+        };
+        const std::vector<TracePoint> fluctuating = {
+            { VLC_TICK_FROM_SEC(10), 6000000 },
+            { VLC_TICK_FROM_SEC(5),  1000000 },
+            { VLC_TICK_FROM_SEC(15), 3500000 },
+            { VLC_TICK_FROM_SEC(3),   600000 },
+            { VLC_TICK_FROM_SEC(20), 9000000 },
+            { VLC_TICK_FROM_SEC(8),  2000000 },
+        };
+        const struct
+        {
+            const char *name;
+            Trace trace;
+        } traces[] = {
+            { "steady", Trace(steady) },
+            { "stepdown", Trace(stepdown) },
+            { "fluctuating", Trace(fluctuating) },
+        };
+
+        for(const auto &t : traces)
+        {
+            Metrics rate, nearoptimal, throughput;
+            {
+                RateBasedAdaptationLogic logic(nullptr);
+                rate = Simulate(logic, set, t.trace);
+                Report("rate", t.name, rate);
+            }
+            {
+                NearOptimalAdaptationLogic logic(nullptr);
+                nearoptimal = Simulate(logic, set, t.trace);
+                Report("nearoptimal", t.name, nearoptimal);
+            }
+            {
+                ThroughputAdaptationLogic logic(nullptr);
+                throughput = Simulate(logic, set, t.trace);
+                Report("throughput", t.name, throughput);
+            }
+            Expect(throughput.rebuffering <= rate.rebuffering);
+            Expect(throughput.rebuffering <= nearoptimal.rebuffering);
+        }
+
+        /* no stall and best sustainable quality on a steady link */
+        {
+            ThroughputAdaptationLogic logic(nullptr);
+            Metrics m = Simulate(logic, set, traces[0].trace);
+            Expect(m.stalls == 0);
+            Expect(m.averageBps >= 3500000);
+            Expect(m.switches <= 4);
+        }
+
+        /* follows a drop without stalling once the buffer is built */
+        {
+            ThroughputAdaptationLogic logic(nullptr);
+            Metrics m = Simulate(logic, set, traces[1].trace);
+            Expect(m.stalls == 0);
+        }
+
+        delete playlist;
+    }
+    catch(...)
+    {
+        delete playlist;
+        return 1;
+    }
+
+    return 0;
+}
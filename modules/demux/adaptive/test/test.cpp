@@ -46,9 +46,11 @@ int main()
     TEST(Conversions) ||
     TEST(TemplatedUri) ||
     TEST(BufferingLogic) ||
+    TEST(ThroughputAdaptationLogic) ||
     TEST(CommandsQueue) ||
     TEST(M3U8MasterPlaylist) ||
     TEST(M3U8Playlist) ||
-    TEST(SegmentTracker)
+    TEST(SegmentTracker) ||
+    TEST(Downloader)
     ;
 }
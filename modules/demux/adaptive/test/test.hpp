@@ -47,7 +47,9 @@ int M3U8MasterPlaylist_test();
 int M3U8Playlist_test();
 int CommandsQueue_test();
 int BufferingLogic_test();
+int ThroughputAdaptationLogic_test();
 int FakeEsOut_test();
 int SegmentTracker_test();
+int Downloader_test();
 
 #endif
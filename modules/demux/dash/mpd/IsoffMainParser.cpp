@@ -98,6 +98,7 @@ MPD * IsoffMainParser::parse()
     {
         parseMPDAttributes(mpd, root);
         parseProgramInformation(DOMHelper::getFirstChildElementByName(root, "ProgramInformation", getDASHNamespace()), mpd);
+        parseServiceDescription(DOMHelper::getFirstChildElementByName(root, "ServiceDescription", getDASHNamespace()), mpd);
         parseMPDBaseUrl(mpd, root);
         parsePeriods(mpd, root);
         mpd->addAttribute(new StartnumberAttr(1));
@@ -581,6 +582,29 @@ void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
     }
 }
 
+void IsoffMainParser::parseServiceDescription(Node * node, MPD *mpd)
+{
+    if(!node)
+        return;
+
+    /* Low latency playback parameters, values in ms */
+    Node *child = DOMHelper::getFirstChildElementByName(node, "Latency", getDASHNamespace());
+    if(child && child->hasAttribute("target"))
+    {
+        uint64_t target = Integer<uint64_t>(child->getAttributeValue("target"));
+        mpd->targetLatency = VLC_TICK_FROM_MS(target);
+    }
+
+    child = DOMHelper::getFirstChildElementByName(node, "PlaybackRate", getDASHNamespace());
+    if(child)
+    {
+        if(child->hasAttribute("min"))
+            mpd->minPlaybackRate = Integer<double>(child->getAttributeValue("min"));
+        if(child->hasAttribute("max"))
+            mpd->maxPlaybackRate = Integer<double>(child->getAttributeValue("max"));
+    }
+}
+
 Profile IsoffMainParser::getProfile() const
 {
     Profile res(Profile::Name::Unknown);
@@ -47,6 +47,7 @@
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
 #include "ts_metadata.h"
+#include "ts_workers.h"
 #include "sections.h"
 #include "pes.h"
 #include "timestamps.h"
@@ -124,6 +125,12 @@ static void Close ( vlc_object_t * );
 #define TS_OFFSETFIX_TEXT   "Try to fix too early PCR (or late DTS)"
 #define TS_GENERATED_PCR_OFFSET_TEXT "Offset in ms for generated PCR"
 
+#define PROGRAM_THREADS_TEXT N_("Program threads")
+#define PROGRAM_THREADS_LONGTEXT N_( \
+    "Number of threads gathering the PES and handling the PCR of the " \
+    "programs, so that demuxing all programs of a multiplex scales with " \
+    "the number of cores. 0 demuxes all programs on the input thread." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -164,6 +171,8 @@ vlc_module_begin ()
     add_bool( "ts-pcr-offsetfix", true, TS_OFFSETFIX_TEXT, NULL )
     add_integer_with_range( "ts-generated-pcr-offset", 120, 0, 500,
                             TS_GENERATED_PCR_OFFSET_TEXT, NULL )
+    add_integer_with_range( "ts-program-threads", 0, 0, 64,
+                            PROGRAM_THREADS_TEXT, PROGRAM_THREADS_LONGTEXT )
 
     set_capability( "demux", 10 )
     set_callbacks( Open, Close )
@@ -184,15 +193,31 @@ void UpdatePESFilters( demux_t *p_demux, bool b_all );
 static inline void FlushESBuffer( ts_stream_t *p_pes );
 static void UpdatePIDScrambledState( demux_t *p_demux, ts_pid_t *p_pid, bool );
 
-static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, int * );
-static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
+static bool ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, ts_header_t,
+                             const uint8_t *p, uint32_t *, int * );
+static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, const uint8_t *, uint32_t );
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
+static void WorkerPESData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
+static bool ProgramIsSharded( demux_sys_t *, ts_pmt_t * );
+static ts_pmt_t * PIDShardedProgram( demux_sys_t *, const ts_pid_t * );
+
+static void DrainPIDWorkers( demux_sys_t *, ts_pid_t * );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, vlc_tick_t i_pcr );
+static void ProgramSetPCRAt( demux_t *p_demux, ts_pmt_t *p_prg, vlc_tick_t i_pcr, uint64_t i_pos );
+static void ProgramOutputPCR( demux_t *p_demux, ts_pmt_t *p_prg, vlc_tick_t i_pcr, uint64_t i_pos );
+static void OutputDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain );
+
+/* Most packets peeked and handled in place at once */
+#define TS_BATCH_MAX 64
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static unsigned PeekTSPackets( demux_t *p_demux, const uint8_t **, ts_header_t *, unsigned );
+static bool DemuxTSPacket( demux_t *p_demux, ts_pid_t *, ts_header_t, const uint8_t *, block_t *, bool * );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, vlc_tick_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, ts_90khz_t );
+static bool ProgramUsesPCRPID( const ts_pmt_t *, const ts_pid_t * );
+static void ProgramPCRHandle( demux_t *p_demux, ts_pmt_t *, ts_90khz_t, uint64_t );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 
 #define PROBE_CHUNK_COUNT 500
@@ -396,6 +421,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
     p_sys->csa = NULL;
+    p_sys->workers = NULL;
     p_sys->b_start_record = false;
     p_sys->record_dir_path = NULL;
 
@@ -539,6 +565,22 @@ static int Open( vlc_object_t *p_this )
             if( Demux( p_demux ) != VLC_DEMUXER_SUCCESS )
                 break;
     }
+    else
+    {
+        unsigned i_threads = var_InheritInteger( p_demux, "ts-program-threads" );
+        if( i_threads > 0 )
+        {
+            static const ts_workers_callbacks_t cbs = {
+                .pf_packet = WorkerPESData,
+                .pf_pcr = ProgramPCRHandle,
+                .pf_send = OutputDataChain,
+                .pf_set_pcr = ProgramOutputPCR,
+            };
+            p_sys->workers = ts_workers_New( p_demux, &cbs, i_threads );
+            if( p_sys->workers )
+                msg_Dbg( p_demux, "demuxing programs on %u threads", i_threads );
+        }
+    }
 
     return VLC_SUCCESS;
 }
@@ -557,6 +599,9 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( p_sys->workers )
+        ts_workers_Delete( p_sys->workers );
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     vlc_mutex_lock( &p_sys->csa_lock );
@@ -630,14 +675,19 @@ static int Demux( demux_t *p_demux )
         p_sys->patfix.status = PAT_FIXTRIED;
     }
 
-    /* We read at most 100 TS packet or until a frame is completed */
-    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
+    /* We read at most i_ts_read TS packets or until a frame is completed */
+    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; )
     {
-        bool         b_frame = false;
-        int          i_header = 0;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        ts_header_t headers[TS_BATCH_MAX];
+        const uint8_t *p_peek;
+        unsigned i_count = PeekTSPackets( p_demux, &p_peek, headers,
+                                          p_sys->i_ts_read - i_pkt );
+        block_t *p_pkt = NULL;
+
+        /* Lost sync, truncated packet or end of stream: read packet-wise */
+        if( i_count == 0 && !(p_pkt = ReadTSPacket( p_demux )) )
         {
+            DrainWorkers( p_sys );
             return VLC_DEMUXER_EOF;
         }
 
@@ -649,122 +699,79 @@ static int Demux( demux_t *p_demux )
             p_sys->b_start_record = false;
         }
 
-        /* Early reject truncated packets from hw devices */
-        if( unlikely(p_pkt->i_buffer < TS_PACKET_SIZE_188) )
-        {
-            block_Release( p_pkt );
-            continue;
-        }
-
-        /* Reject any fully uncorrected packet. Even PID can be incorrect */
-        if( p_pkt->p_buffer[1]&0x80 )
-        {
-            msg_Dbg( p_demux, "transport_error_indicator set (pid=%d)",
-                     PIDGet( p_pkt ) );
-            block_Release( p_pkt );
-            continue;
-        }
-
-        /* Parse the TS packet */
-        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
-        if( !SEEN(p_pid) )
-        {
-            if( p_pid->type == TYPE_FREE )
-                msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
-            p_pid->i_flags |= FLAG_SEEN;
-            if( p_pid->i_pid == 0x01 )
-                p_sys->b_valid_scrambling = true;
-        }
-
-        /* Drop duplicates and invalid (DOES NOT drop corrupted) */
-        p_pkt = ProcessTSPacket( p_demux, p_pid, p_pkt, &i_header );
-        if( !p_pkt )
-            continue;
-
-        if( !SCRAMBLED(*p_pid) != !(p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) &&
-            ( p_pkt->p_buffer[1] & 0x40 ) ) /* update on payload start */
-        {
-            UpdatePIDScrambledState( p_demux, p_pid, p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED );
-        }
-
-        /* Adaptation field cannot be scrambled */
-        ts_90khz_t i_pcr = GetPCR( p_pkt );
-        if( i_pcr != TS_90KHZ_INVALID )
-            PCRHandle( p_demux, p_pid, i_pcr );
-
-        /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
-        if( !SEEN( GetPID( p_sys, 0 ) ) &&
-            (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-            (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
-        {
-            ProbePES( p_demux, p_pid, p_pkt );
-        }
-
-        switch( p_pid->type )
+        if( p_pkt != NULL )
         {
-        case TYPE_PAT:
-        case TYPE_PMT:
-            /* PAT and PMT are not allowed to be scrambled */
-            ts_psi_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+            i_pkt++;
 
-        case TYPE_STREAM:
-            p_sys->b_end_preparse = true;
-
-            if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
+            /* Early reject truncated packets from hw devices */
+            if( unlikely(p_pkt->i_buffer < TS_PACKET_SIZE_188) )
             {
-                msg_Dbg( p_demux, "Creating delayed ES" );
-                AddAndCreateES( p_demux, p_pid, true );
-                UpdatePESFilters( p_demux, p_sys->seltype == PROGRAM_ALL );
+                block_Release( p_pkt );
+                continue;
             }
 
-            /* Emulate HW filter */
-            if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
+            /* Reject any fully uncorrected packet. Even PID can be incorrect */
+            const ts_header_t h = GetPacketHeader( p_pkt->p_buffer );
+            if( TS_HEADER_ERROR(h) )
             {
-                /* That packet is for an unselected ES, don't waste time/memory gathering its data */
+                msg_Dbg( p_demux, "transport_error_indicator set (pid=%d)",
+                         TS_HEADER_PID(h) );
                 block_Release( p_pkt );
                 continue;
             }
 
-            if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
+            ts_pid_t *p_pid = GetPID( p_sys, TS_HEADER_PID(h) );
+            if( DemuxTSPacket( p_demux, p_pid, h, p_pkt->p_buffer, p_pkt, NULL ) ||
+                ( b_wait_es && p_sys->i_pmt_es > 0 ) )
+                break;
+            continue;
+        }
+
+        /* Handle the packets in place, looking the PID up once per run of
+         * packets of the same PID */
+        ts_pid_t *p_pid = NULL;
+        bool b_stop = false;
+        bool b_repeek = false;
+
+        for( unsigned i = 0; i < i_count && !b_stop && !b_repeek; i++ )
+        {
+            const uint8_t *p = &p_peek[i * p_sys->i_packet_size
+                                       + p_sys->i_packet_header_size];
+            const ts_header_t h = headers[i];
+
+            if( unlikely(TS_HEADER_ERROR(h)) )
             {
-                b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header );
+                /* Reject any fully uncorrected packet. Even PID can be incorrect */
+                msg_Dbg( p_demux, "transport_error_indicator set (pid=%d)",
+                         TS_HEADER_PID(h) );
             }
-            else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
+            else
             {
-                b_frame = GatherSectionsData( p_demux, p_pid, p_pkt, i_header );
+                if( p_pid == NULL || p_pid->i_pid != TS_HEADER_PID(h) )
+                    p_pid = GetPID( p_sys, TS_HEADER_PID(h) );
+
+                /* Tables handlers may probe the stream, invalidating the
+                 * peeked data: peek again only after they ran. Null,
+                 * unknown, duplicated and filtered out packets never reach
+                 * them and stay in the batch */
+                b_stop = DemuxTSPacket( p_demux, p_pid, h, p, NULL, &b_repeek ) ||
+                         ( b_wait_es && p_sys->i_pmt_es > 0 );
             }
-            else // pid->u.p_pes->transport == TS_TRANSPORT_IGNORE
-            {
-                block_Release( p_pkt );
-            }
-
-            break;
-
-        case TYPE_SI:
-            if( (p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) == 0 )
-                ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
-
-        case TYPE_PSIP:
-            if( (p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) == 0 )
-                ts_psip_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
 
-        case TYPE_CAT:
-        default:
-            /* We have to handle PCR if present */
-            block_Release( p_pkt );
-            break;
+            vlc_stream_Read( p_sys->stream, NULL, p_sys->i_packet_size );
+            i_pkt++;
         }
 
-        if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
+        if( b_stop )
             break;
     }
 
+    if( p_sys->workers )
+    {
+        ts_workers_Flush( p_sys->workers );
+        ts_workers_Output( p_sys->workers );
+    }
+
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -892,6 +899,38 @@ void UpdatePESFilters( demux_t *p_demux, bool b_all )
     }
 }
 
+static int GetProgramStats( demux_t *p_demux, int i_group,
+                            struct vlc_demux_program_stats *p_stats )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+
+    if( p_sys->workers == NULL )
+        return VLC_EGENERIC;
+
+    uint64_t i_runs = 0;
+    vlc_tick_t i_latency = 0;
+    memset( p_stats, 0, sizeof(*p_stats) );
+    for( int i=0; i<p_pat->programs.i_size; i++ )
+    {
+        const ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( i_group != -1 && p_pmt->i_number != i_group )
+            continue;
+
+        ts_workers_program_stats_t stats;
+        ts_workers_GetProgramStats( p_sys->workers, p_pmt, &stats );
+        p_stats->packets += stats.i_packets;
+        p_stats->bytes += stats.i_bytes;
+        p_stats->latency_max = __MAX( p_stats->latency_max, stats.i_latency_max );
+        i_runs += stats.i_packets + stats.i_pcrs;
+        i_latency += stats.i_latency;
+    }
+    if( i_runs > 0 )
+        p_stats->latency = i_latency / (vlc_tick_t)i_runs;
+
+    return VLC_SUCCESS;
+}
+
 static int Control( demux_t *p_demux, int i_query, va_list args )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -902,6 +941,17 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     const ts_pmt_t *p_pmt = NULL;
     const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
 
+    /* Polled by the input statistics: answered with the workers running */
+    if( i_query == DEMUX_GET_PROGRAM_STATS )
+    {
+        i_int = va_arg( args, int );
+        return GetProgramStats( p_demux, i_int,
+                                va_arg( args, struct vlc_demux_program_stats * ) );
+    }
+
+    /* Programs state is read, or reset on seek */
+    DrainWorkers( p_sys );
+
     for( int i=0; i<p_pat->programs.i_size && !p_pmt; i++ )
     {
         if( p_pat->programs.p_elems[i]->u.p_pmt->b_selected )
@@ -1466,6 +1516,13 @@ static block_t * ConvertPESBlock( demux_t *p_demux, ts_es_t *p_es,
  * fanouts current block to all subdecoders / shared pid es
  ****************************************************************************/
 static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
+{
+    /* Workers leave the es_out to the input thread */
+    if( !ts_workers_QueueSend( p_es->p_program, p_es, p_chain ) )
+        OutputDataChain( p_demux, p_es, p_chain );
+}
+
+static void OutputDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
@@ -1862,6 +1919,210 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+/*
+ * Peeks up to i_max packets, and returns how many of them are in sync along
+ * with their header fields. Packets out of sync are left to ReadTSPacket().
+ */
+static unsigned PeekTSPackets( demux_t *p_demux, const uint8_t **pp_peek,
+                               ts_header_t *p_headers, unsigned i_max )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( i_max > TS_BATCH_MAX )
+        i_max = TS_BATCH_MAX;
+
+    ssize_t i_peek = vlc_stream_Peek( p_sys->stream, pp_peek,
+                                      i_max * p_sys->i_packet_size );
+    if( i_peek < (ssize_t)p_sys->i_packet_size )
+        return 0;
+
+    return ScanPackets( *pp_peek + p_sys->i_packet_header_size,
+                        i_peek / p_sys->i_packet_size,
+                        p_sys->i_packet_size, p_headers );
+}
+
+/* Returns the packet as a block, copying it if it is handled in place */
+static block_t *PacketBlock( const uint8_t *p, block_t *p_pkt, uint32_t i_flags )
+{
+    if( p_pkt == NULL )
+    {
+        p_pkt = block_Alloc( TS_PACKET_SIZE_188 );
+        if( unlikely(p_pkt == NULL) )
+            return NULL;
+        memcpy( p_pkt->p_buffer, p, TS_PACKET_SIZE_188 );
+    }
+
+    /* For now, ignore additional error correction
+     * TODO: handle Reed-Solomon 204,188 error correction */
+    p_pkt->i_buffer = TS_PACKET_SIZE_188;
+    p_pkt->i_flags |= i_flags;
+    return p_pkt;
+}
+
+/*
+ * Handles one packet, either read as a block or peeked in place (p_pkt is
+ * NULL), given its header fields. Peeked packets are only copied to a block
+ * when their payload is gathered. Returns true once a frame is completed.
+ * If not NULL, *pb_tables is set when the packet went to a tables handler,
+ * which may have moved or reconfigured the stream.
+ */
+static bool DemuxTSPacket( demux_t *p_demux, ts_pid_t *p_pid, ts_header_t h,
+                           const uint8_t *p, block_t *p_pkt, bool *pb_tables )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool         b_frame = false;
+    uint32_t     i_flags = 0;
+    int          i_header = 0;
+    bool         b_tables = false;
+
+    if( !SEEN(p_pid) )
+    {
+        if( p_pid->type == TYPE_FREE )
+            msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
+        /* The PID flags are read by the worker of its program */
+        DrainPIDWorkers( p_sys, p_pid );
+        p_pid->i_flags |= FLAG_SEEN;
+        if( p_pid->i_pid == 0x01 )
+        {
+            DrainWorkers( p_sys );
+            p_sys->b_valid_scrambling = true;
+        }
+    }
+
+    /* Descramble in place, on our own copy */
+    if( TS_HEADER_SCRAMBLED(h) && p_sys->csa && p_pid->i_pid != 0x1FFF )
+    {
+        p_pkt = PacketBlock( p, p_pkt, 0 );
+        if( unlikely(p_pkt == NULL) )
+            return false;
+        p = p_pkt->p_buffer;
+
+        vlc_mutex_lock( &p_sys->csa_lock );
+        csa_Decrypt( p_sys->csa, p_pkt->p_buffer, p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+        h = GetPacketHeader( p );
+    }
+
+    /* Drop duplicates and invalid (DOES NOT drop corrupted) */
+    if( !ProcessTSPacket( p_demux, p_pid, h, p, &i_flags, &i_header ) )
+        goto out;
+
+    if( !SCRAMBLED(*p_pid) != !(i_flags & BLOCK_FLAG_SCRAMBLED) &&
+        TS_HEADER_UNIT_START(h) ) /* update on payload start */
+    {
+        DrainPIDWorkers( p_sys, p_pid );
+        UpdatePIDScrambledState( p_demux, p_pid, i_flags & BLOCK_FLAG_SCRAMBLED );
+    }
+
+    /* Adaptation field cannot be scrambled */
+    if( TS_HEADER_ADAPTATION(h) )
+    {
+        ts_90khz_t i_pcr = GetPacketPCR( p, TS_PACKET_SIZE_188 );
+        if( i_pcr != TS_90KHZ_INVALID )
+            PCRHandle( p_demux, p_pid, i_pcr );
+    }
+
+    /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
+    if( !SEEN( GetPID( p_sys, 0 ) ) &&
+        TS_HEADER_UNIT_START(h) && !TS_HEADER_ERROR(h) &&
+        TS_HEADER_PAYLOAD(h) && !TS_HEADER_SCRAMBLED(h) )
+    {
+        p_pkt = PacketBlock( p, p_pkt, i_flags );
+        if( unlikely(p_pkt == NULL) )
+            return false;
+        p = p_pkt->p_buffer;
+        ProbePES( p_demux, p_pid, p_pkt );
+    }
+
+    switch( p_pid->type )
+    {
+    case TYPE_PAT:
+    case TYPE_PMT:
+        /* PAT and PMT are not allowed to be scrambled. Their callbacks
+         * take back the programs they update from the workers */
+        ts_psi_Packet_Push( p_pid, p );
+        b_tables = true;
+        break;
+
+    case TYPE_STREAM:
+        p_sys->b_end_preparse = true;
+
+        if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
+        {
+            DrainWorkers( p_sys );
+            msg_Dbg( p_demux, "Creating delayed ES" );
+            AddAndCreateES( p_demux, p_pid, true );
+            UpdatePESFilters( p_demux, p_sys->seltype == PROGRAM_ALL );
+            b_tables = true;
+        }
+
+        /* Emulate HW filter */
+        if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
+        {
+            /* That packet is for an unselected ES, don't waste time/memory gathering its data */
+            break;
+        }
+
+        if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
+        {
+            p_pkt = PacketBlock( p, p_pkt, i_flags );
+            if( unlikely(p_pkt == NULL) )
+                return false;
+
+            ts_pmt_t *p_pmt = PIDShardedProgram( p_sys, p_pid );
+            if( p_pmt )
+            {
+                ts_workers_PushPacket( p_sys->workers, p_pmt, p_pid, p_pkt, i_header );
+            }
+            else
+            {
+                /* Shared PIDs also feed the programs of their other ES */
+                DrainPIDWorkers( p_sys, p_pid );
+                b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header );
+            }
+            p_pkt = NULL;
+        }
+        else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
+        {
+            DrainPIDWorkers( p_sys, p_pid );
+            b_frame = GatherSectionsData( p_demux, p_pid, p, i_flags );
+            b_tables = true;
+        }
+        /* else pid->u.p_pes->transport == TS_TRANSPORT_IGNORE */
+        break;
+
+    case TYPE_SI:
+        /* SI and PSIP tables only update the programs metadata, which the
+         * workers never read */
+        if( (i_flags & BLOCK_FLAG_SCRAMBLED) == 0 )
+        {
+            ts_si_Packet_Push( p_pid, p );
+            b_tables = true;
+        }
+        break;
+
+    case TYPE_PSIP:
+        if( (i_flags & BLOCK_FLAG_SCRAMBLED) == 0 )
+        {
+            ts_psip_Packet_Push( p_pid, p );
+            b_tables = true;
+        }
+        break;
+
+    case TYPE_CAT:
+    default:
+        /* We have to handle PCR if present */
+        break;
+    }
+
+out:
+    if( p_pkt != NULL )
+        block_Release( p_pkt );
+    if( pb_tables != NULL )
+        *pb_tables = b_tables;
+    return b_frame;
+}
+
 static inline void UpdateESScrambledState( es_out_t *out, const ts_es_t *p_es, bool b_scrambled )
 {
     for( ; p_es; p_es = p_es->p_next )
@@ -2221,12 +2482,24 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, vlc_tick_t i_pcr )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    ProgramSetPCRAt( p_demux, p_pmt, i_pcr, vlc_stream_Tell( p_sys->stream ) );
+}
+
+/* i_pos is the stream position of the PCR, as workers cannot tell it */
+static void ProgramSetPCRAt( demux_t *p_demux, ts_pmt_t *p_pmt, vlc_tick_t i_pcr,
+                             uint64_t i_pos )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
     /* Check if we have enqueued blocks waiting the/before the
        PCR barrier, and then adapt pcr so they have valid PCR when dequeuing */
     if( p_pmt->pcr.i_current == VLC_TICK_INVALID && p_pmt->pcr.b_fix_done )
     {
         vlc_tick_t i_mindts = VLC_TICK_INVALID;
 
+        /* Never run by workers, as sharded programs have a PCR */
+        DrainWorkers( p_sys );
+
         ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
         for( int i=0; i< p_pat->programs.i_size; i++ )
         {
@@ -2262,20 +2535,30 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, vlc_tick_t i_pcr )
         p_pmt->pcr.i_first = i_pcr; // now seen
     }
 
-    if ( p_sys->i_pmt_es )
+    /* Workers leave the es_out to the input thread */
+    if( !ts_workers_QueuePCR( p_pmt, i_pcr, i_pos ) )
+        ProgramOutputPCR( p_demux, p_pmt, i_pcr, i_pos );
+}
+
+static void ProgramOutputPCR( demux_t *p_demux, ts_pmt_t *p_pmt, vlc_tick_t i_pcr,
+                              uint64_t i_pos )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->i_pmt_es )
+        return;
+
+    es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, i_pcr );
+    /* growing files/named fifo handling */
+    if( p_sys->b_access_control == false &&
+        i_pos > p_pmt->i_last_dts_byte )
     {
-        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, i_pcr );
-        /* growing files/named fifo handling */
-        if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+        if( p_pmt->i_last_dts_byte == 0 ) /* first run */
+            p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
+        else
         {
-            if( p_pmt->i_last_dts_byte == 0 ) /* first run */
-                p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
-            else
-            {
-                p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
-            }
+            p_pmt->i_last_dts = i_pcr;
+            p_pmt->i_last_dts_byte = i_pos;
         }
     }
 }
@@ -2379,38 +2662,49 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, ts_90khz_t i_pcr )
 
     /* Search program and set the PCR */
     ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    const uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
     for( int i = 0; i < p_pat->programs.i_size; i++ )
     {
         ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
-        if( p_pmt->pcr.b_disable )
+
+        /* Only queued to the programs that take their clock from that pid */
+        if( !ProgramUsesPCRPID( p_pmt, pid ) )
             continue;
 
-        vlc_tick_t i_past_pcr = p_pmt->pcr.i_current;
-        if( i_past_pcr == VLC_TICK_INVALID )
-            i_past_pcr = p_pmt->pcr.i_first;
+        if( ProgramIsSharded( p_sys, p_pmt ) )
+            ts_workers_PushPCR( p_sys->workers, p_pmt, i_pcr, i_pos );
+        else
+            ProgramPCRHandle( p_demux, p_pmt, i_pcr, i_pos );
+    }
+}
 
-        vlc_tick_t i_program_pcr = TimeStampWrapAround( i_past_pcr, FROM_SCALE(i_pcr) );
+/* Whether pid carries the PCR of the program. Only reads state changed by
+ * the input thread, so it also holds for sharded programs */
+static bool ProgramUsesPCRPID( const ts_pmt_t *p_pmt, const ts_pid_t *pid )
+{
+    if( p_pmt->pcr.b_disable )
+        return false;
 
-        if( p_pmt->i_pid_pcr == 0x1FFF ) /* That program has no dedicated PCR pid ISO/IEC 13818-1 2.4.4.9 */
-        {
-            if( PIDReferencedByProgram( p_pmt, pid->i_pid ) ) /* PCR shall be on pid itself */
-            {
-                /* ? update PCR for the whole group program ? */
-                ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
-            }
-        }
-        else /* set PCR provided by current pid to program(s) referencing it */
-        {
-            /* Can be dedicated PCR pid (no owned then) or another pid (owner == pmt) */
-            if( p_pmt->i_pid_pcr == pid->i_pid ) /* If that program references current pid as PCR */
-            {
-                /* We've found a target group for update */
-                PCRCheckDTS( p_demux, p_pmt, FROM_SCALE(i_pcr) );
-                ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
-            }
-        }
+    if( p_pmt->i_pid_pcr == 0x1FFF ) /* That program has no dedicated PCR pid ISO/IEC 13818-1 2.4.4.9 */
+        return PIDReferencedByProgram( p_pmt, pid->i_pid ); /* PCR shall be on pid itself */
 
-    }
+    /* Can be dedicated PCR pid (no owned then) or another pid (owner == pmt) */
+    return p_pmt->i_pid_pcr == pid->i_pid;
+}
+
+static void ProgramPCRHandle( demux_t *p_demux, ts_pmt_t *p_pmt,
+                              ts_90khz_t i_pcr, uint64_t i_pos )
+{
+    vlc_tick_t i_past_pcr = p_pmt->pcr.i_current;
+    if( i_past_pcr == VLC_TICK_INVALID )
+        i_past_pcr = p_pmt->pcr.i_first;
+
+    vlc_tick_t i_program_pcr = TimeStampWrapAround( i_past_pcr, FROM_SCALE(i_pcr) );
+
+    /* Without a PCR pid, the PCR is sent on one of the program pids */
+    if( p_pmt->i_pid_pcr != 0x1FFF )
+        PCRCheckDTS( p_demux, p_pmt, FROM_SCALE(i_pcr) );
+    ProgramSetPCRAt( p_demux, p_pmt, i_program_pcr, i_pos );
 }
 
 int FindPCRCandidate( ts_pmt_t *p_pmt )
@@ -2480,20 +2774,22 @@ static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
                 p_pmt->pcr.b_disable = true;
             msg_Warn( p_demux, "No PCR received for program %d, set up workaround using pid %d",
                       p_pmt->i_number, i_cand );
+            /* Never run by workers, but filters of all programs are updated */
+            DrainWorkers( p_sys );
             UpdatePESFilters( p_demux, p_sys->seltype == PROGRAM_ALL );
         }
         p_pmt->pcr.b_fix_done = true;
     }
 }
 
-static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, int *pi_skip )
+static bool ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, ts_header_t h,
+                             const uint8_t *p, uint32_t *pi_flags, int *pi_skip )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint8_t *p = p_pkt->p_buffer;
-    const bool b_adaptation = p[3]&0x20;
-    const bool b_payload    = p[3]&0x10;
-    const bool b_scrambled  = p[3]&0xc0;
-    const int  i_cc         = p[3]&0x0f; /* continuity counter */
+    const bool b_adaptation = TS_HEADER_ADAPTATION(h);
+    const bool b_payload    = TS_HEADER_PAYLOAD(h);
+    const bool b_scrambled  = TS_HEADER_SCRAMBLED(h);
+    const int  i_cc         = TS_HEADER_CC(h); /* continuity counter */
     bool       b_discontinuity = false;  /* discontinuity */
 
     /* transport_scrambling_control is ignored */
@@ -2507,26 +2803,11 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
 
     /* Drop null packets */
     if( unlikely(pid->i_pid == 0x1FFF) )
-    {
-        block_Release( p_pkt );
-        return NULL;
-    }
-
-    /* For now, ignore additional error correction
-     * TODO: handle Reed-Solomon 204,188 error correction */
-    p_pkt->i_buffer = TS_PACKET_SIZE_188;
+        return false;
 
+    /* Packets are descrambled by the caller if there is a descrambler */
     if( b_scrambled )
-    {
-        if( p_sys->csa )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Decrypt( p_sys->csa, p_pkt->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
-        else
-            p_pkt->i_flags |= BLOCK_FLAG_SCRAMBLED;
-    }
+        *pi_flags |= BLOCK_FLAG_SCRAMBLED;
 
     /* We don't have any adaptation_field, so payload starts
      * immediately after the 4 byte TS header */
@@ -2537,8 +2818,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
         if( p[4] + 5 > 188 /* adaptation field only == 188 */ )
         {
             /* Broken is broken */
-            block_Release( p_pkt );
-            return NULL;
+            return false;
         }
         else if( p[4] > 0 )
         {
@@ -2553,7 +2833,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
 
                 /* ... or don't ignore for our Bluray still frames and seek hacks */
                 if(p[5] == 0x82 && !strncmp((const char *)&p[7], "VLC_DISCONTINU", 14))
-                    p_pkt->i_flags |= BLOCK_FLAG_PRIVATE_SOURCE_RANDOM_ACCESS;
+                    *pi_flags |= BLOCK_FLAG_PRIVATE_SOURCE_RANDOM_ACCESS;
             }
 #if 0
             if( p[5]&0x40 )
@@ -2587,7 +2867,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
             }
             else if( i_diff == 0 && pid->i_dup == 0 &&
                      !memcmp(pid->prevpktbytes, /* see comment below */
-                             &p_pkt->p_buffer[1], PREVPKTKEEPBYTES)  )
+                             &p[1], PREVPKTKEEPBYTES)  )
             {
                 /* Discard duplicated payload 2.4.3.3 */
                 /* Added previous pkt bytes comparison for
@@ -2596,8 +2876,7 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
                  * That should not need CRC or full payload as it should be
                  * restarting with PSI packets */
                 pid->i_dup++;
-                block_Release( p_pkt );
-                return NULL;
+                return false;
             }
             else if( i_diff != 0 && !b_discontinuity )
             {
@@ -2606,11 +2885,11 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
 
                 pid->i_cc = i_cc;
                 pid->i_dup = 0;
-                p_pkt->i_flags |= BLOCK_FLAG_PRIVATE_PACKET_LOSS;
+                *pi_flags |= BLOCK_FLAG_PRIVATE_PACKET_LOSS;
             }
             else pid->i_cc = i_cc;
         }
-        memcpy(pid->prevpktbytes, &p_pkt->p_buffer[1], PREVPKTKEEPBYTES);
+        memcpy(pid->prevpktbytes, &p[1], PREVPKTKEEPBYTES);
     }
     else /* Ignore all 00 or 10 as in 2.4.3.3 CC counter must not be
             incremented in those cases, but there is humax inserting
@@ -2622,12 +2901,9 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
     }
 
     if( unlikely(!(b_payload || b_adaptation)) ) /* Invalid, ignore */
-    {
-        block_Release( p_pkt );
-        return NULL;
-    }
+        return false;
 
-    return p_pkt;
+    return true;
 }
 
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt, size_t i_skip )
@@ -2652,24 +2928,98 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt, si
                           i_append_pcr );
 }
 
-static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt, size_t i_skip )
+static void WorkerPESData( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt, size_t i_skip )
+{
+    GatherPESData( p_demux, p_pid, p_pkt, i_skip );
+}
+
+/* Whether no other program shares the program PIDs, nor their state.
+ * Stream processors call the es_out, so their programs are never sharded. */
+static bool ProgramOwnsPIDs( const ts_pmt_t *p_pmt )
 {
-    VLC_UNUSED(i_skip); VLC_UNUSED(p_demux);
+    for( int i=0; i<p_pmt->e_streams.i_size; i++ )
+    {
+        const ts_pid_t *p_pid = p_pmt->e_streams.p_elems[i];
+        if( p_pid->type != TYPE_STREAM || p_pid->i_refcount != 1 )
+            return false;
+
+        const ts_stream_t *p_stream = p_pid->u.p_stream;
+        if( p_stream->transport != TS_TRANSPORT_PES || p_stream->p_proc ||
+            p_stream->p_es == NULL || p_stream->p_es->p_next ||
+            p_stream->p_es->p_program != p_pmt )
+            return false;
+    }
+    return true;
+}
+
+/* Programs are handed over to a worker once their PCR is steady, as the PCR
+ * fixups and the first PCR look at, and alter, the other programs */
+static bool ProgramIsSharded( demux_sys_t *p_sys, ts_pmt_t *p_pmt )
+{
+    if( p_sys->workers == NULL )
+        return false;
+    if( ts_workers_IsSharded( p_sys->workers, p_pmt ) )
+        return true;
+
+    /* Not run by any worker since the last drain: its state can be read */
+    if( !p_pmt->pcr.b_fix_done || p_pmt->pcr.b_disable ||
+        p_pmt->pcr.i_current == VLC_TICK_INVALID ||
+        ( !p_sys->b_access_control && p_pmt->i_last_dts_byte == 0 ) ||
+        !ProgramOwnsPIDs( p_pmt ) )
+        return false;
+
+    ts_workers_Shard( p_sys->workers, p_pmt );
+    return true;
+}
+
+/* Returns the program whose worker gathers that PID, if any */
+static ts_pmt_t * PIDShardedProgram( demux_sys_t *p_sys, const ts_pid_t *p_pid )
+{
+    if( p_sys->workers == NULL )
+        return NULL;
+
+    /* PIDs shared by several programs stay on the input thread */
+    const ts_es_t *p_es = p_pid->u.p_stream->p_es;
+    if( p_es == NULL || p_es->p_next != NULL || p_es->p_program == NULL ||
+        !ProgramIsSharded( p_sys, p_es->p_program ) )
+        return NULL;
+
+    return p_es->p_program;
+}
+
+void DrainWorkers( demux_sys_t *p_sys )
+{
+    if( p_sys->workers )
+        ts_workers_Drain( p_sys->workers );
+}
+
+/* Only takes back the programs carrying that pid */
+static void DrainPIDWorkers( demux_sys_t *p_sys, ts_pid_t *p_pid )
+{
+    if( p_sys->workers == NULL || p_pid->type != TYPE_STREAM )
+        return;
+
+    for( ts_es_t *p_es = p_pid->u.p_stream->p_es; p_es; p_es = p_es->p_next )
+        if( p_es->p_program )
+            ts_workers_DrainProgram( p_sys->workers, p_es->p_program );
+}
+
+static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *p_pid, const uint8_t *p, uint32_t i_flags )
+{
+    VLC_UNUSED(p_demux);
     bool b_ret = false;
 
-    if( p_pkt->i_flags & BLOCK_FLAG_DISCONTINUITY )
+    if( i_flags & BLOCK_FLAG_DISCONTINUITY )
     {
         ts_sections_processor_Reset( p_pid->u.p_stream->p_sections_proc );
     }
 
-    if( (p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) == 0 )
+    if( (i_flags & BLOCK_FLAG_SCRAMBLED) == 0 )
     {
-        ts_sections_processor_Push( p_pid->u.p_stream->p_sections_proc, p_pkt->p_buffer );
+        ts_sections_processor_Push( p_pid->u.p_stream->p_sections_proc, p );
         b_ret = true;
     }
 
-    block_Release( p_pkt );
-
     return b_ret;
 }
 
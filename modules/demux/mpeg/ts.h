@@ -26,6 +26,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_workers_t ts_workers_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -99,6 +100,9 @@ struct demux_sys_t
     bool        b_split_es;
     bool        b_valid_scrambling;
 
+    /* Program worker threads, NULL when demuxing on the input thread */
+    ts_workers_t *workers;
+
     bool        b_trust_pcr;
     bool        b_check_pcr_offset;
     unsigned    i_generated_pcr_dpb_offset;
@@ -149,6 +153,9 @@ void UpdatePESFilters( demux_t *p_demux, bool b_all );
 int ProbeStart( demux_t *p_demux, int i_program );
 int ProbeEnd( demux_t *p_demux, int i_program );
 
+/* Takes all programs back from the workers, see ts_workers.h */
+void DrainWorkers( demux_sys_t * );
+
 void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool b_create_delayed );
 int FindPCRCandidate( ts_pmt_t *p_pmt );
 
@@ -21,6 +21,10 @@
 
 #include "timestamps.h"
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 #define TS_PACKET_SIZE_188 188
 #define TS_PACKET_SIZE_192 192
 #define TS_PACKET_SIZE_204 204
@@ -43,13 +47,11 @@ static inline int PIDGet( const block_t *p )
     return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
 }
 
-static inline ts_90khz_t GetPCR( const block_t *p_pkt )
+static inline ts_90khz_t GetPacketPCR( const uint8_t *p, size_t i_size )
 {
-    const uint8_t *p = p_pkt->p_buffer;
-
     ts_90khz_t i_pcr = TS_90KHZ_INVALID;
 
-    if(unlikely(p_pkt->i_buffer < 12))
+    if(unlikely(i_size < 12))
         return i_pcr;
 
     const uint8_t i_adaption = p[3] & 0x30;
@@ -69,4 +71,75 @@ static inline ts_90khz_t GetPCR( const block_t *p_pkt )
     return i_pcr;
 }
 
+static inline ts_90khz_t GetPCR( const block_t *p_pkt )
+{
+    return GetPacketPCR( p_pkt->p_buffer, p_pkt->i_buffer );
+}
+
+/* Header fields of a packet, as extracted by ScanPackets():
+ * bits 0-12 PID, 13 priority, 14 payload unit start, 15 transport error,
+ * 16-19 continuity counter, 20-21 adaptation field control,
+ * 22-23 scrambling control */
+typedef uint32_t ts_header_t;
+
+#define TS_HEADER_PID(h)        ((h) & 0x1FFF)
+#define TS_HEADER_UNIT_START(h) ((h) & 0x4000)
+#define TS_HEADER_ERROR(h)      ((h) & 0x8000)
+#define TS_HEADER_CC(h)         (((h) >> 16) & 0x0F)
+#define TS_HEADER_ADAPTATION(h) ((h) & 0x200000)
+#define TS_HEADER_PAYLOAD(h)    ((h) & 0x100000)
+#define TS_HEADER_SCRAMBLED(h)  ((h) & 0xC00000)
+
+static inline ts_header_t GetPacketHeader( const uint8_t *p )
+{
+    return p[2] | (p[1] << 8) | ((uint32_t)p[3] << 16);
+}
+
+/**
+ * Checks the sync byte of up to i_count packets laid out every i_stride
+ * bytes, and extracts their header fields.
+ *
+ * \return the number of leading packets with a valid sync byte
+ */
+static inline unsigned ScanPackets( const uint8_t *p, unsigned i_count,
+                                    size_t i_stride, ts_header_t *p_headers )
+{
+    unsigned i = 0;
+
+#ifdef __SSE2__
+    /* Four headers at a time, the x86 loads being little-endian */
+    const __m128i sync = _mm_set1_epi32( 0x47 );
+    const __m128i low = _mm_set1_epi32( 0xFF );
+
+    for( ; i + 4 <= i_count; i += 4 )
+    {
+        uint32_t words[4];
+        for( unsigned j = 0; j < 4; j++ )
+            memcpy( &words[j], &p[(i + j) * i_stride], 4 );
+
+        __m128i h = _mm_loadu_si128( (const __m128i *)words );
+        __m128i f = _mm_and_si128( _mm_srli_epi32( h, 16 ), low );
+        f = _mm_or_si128( f, _mm_and_si128( h, _mm_set1_epi32( 0xFF00 ) ) );
+        f = _mm_or_si128( f, _mm_and_si128( _mm_srli_epi32( h, 8 ),
+                                            _mm_set1_epi32( 0xFF0000 ) ) );
+        _mm_storeu_si128( (__m128i *)&p_headers[i], f );
+
+        int i_synced = _mm_movemask_ps( _mm_castsi128_ps(
+                           _mm_cmpeq_epi32( _mm_and_si128( h, low ), sync ) ) );
+        if( i_synced != 0xF )
+            return i + ctz( ~(unsigned)i_synced );
+    }
+#endif
+
+    for( ; i < i_count; i++ )
+    {
+        const uint8_t *h = &p[i * i_stride];
+
+        if( h[0] != 0x47 )
+            break;
+        p_headers[i] = GetPacketHeader( h );
+    }
+    return i;
+}
+
 #endif
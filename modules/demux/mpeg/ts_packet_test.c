@@ -0,0 +1,309 @@
+/*****************************************************************************
+ * ts_packet_test.c: TS packets scanning unit tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ts_packet.h"
+
+#define BAILOUT(run) { fprintf(stderr, "failed %s line %d\n", run, __LINE__); \
+                        return 1; }
+
+/* Synthetic MPTS: each program has a video, an audio and a PMT PID */
+#define PROGRAMS 8
+#define PACKETS  (1 << 16)
+
+/* Most packets scanned at once by the tests */
+#define SCAN_MAX 67
+
+static uint16_t pid_table[1 + 3 * PROGRAMS + 1];
+
+static int ComparePID( const void *a, const void *b )
+{
+    return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+static void WritePacket( uint8_t *p, uint16_t i_pid, unsigned i_cc,
+                         bool b_start, bool b_adaptation )
+{
+    p[0] = 0x47;
+    p[1] = (b_start ? 0x40 : 0x00) | (i_pid >> 8);
+    p[2] = i_pid & 0xFF;
+    p[3] = (b_adaptation ? 0x30 : 0x10) | (i_cc & 0x0F);
+    memset( &p[4], 0xFF, TS_PACKET_SIZE_188 - 4 );
+    if( b_adaptation )
+    {
+        p[4] = 7;
+        p[5] = 0x10;
+    }
+}
+
+/* Video packets come in runs, like a muxer interleaving its outputs */
+static void BuildMPTS( uint8_t *p_buf, size_t i_stride, size_t i_prefix )
+{
+    unsigned cc[8192] = { 0 };
+    unsigned i_pat = 0, i_program = 0, i_run = 0;
+    unsigned n = 0;
+
+    pid_table[n++] = 0;
+    for( unsigned i = 0; i < PROGRAMS; i++ )
+    {
+        pid_table[n++] = 0x100 + i;
+        pid_table[n++] = 0x200 + 2 * i;
+        pid_table[n++] = 0x201 + 2 * i;
+    }
+    pid_table[n++] = 0x1FFF;
+    qsort( pid_table, n, sizeof (pid_table[0]), ComparePID );
+
+    for( unsigned i = 0; i < PACKETS; i++ )
+    {
+        uint8_t *p = &p_buf[i * i_stride];
+        uint16_t i_pid;
+
+        memset( p, 0xA5, i_prefix );
+        p += i_prefix;
+
+        if( i_pat++ == 500 )
+        {
+            i_pid = 0;
+            i_pat = 0;
+        }
+        else if( (i % 97) == 0 )
+            i_pid = 0x100 + (i / 97) % PROGRAMS;
+        else if( (i % 13) == 0 )
+            i_pid = 0x201 + 2 * ((i / 13) % PROGRAMS);
+        else if( (i % 31) == 0 )
+            i_pid = 0x1FFF;
+        else
+        {
+            if( i_run++ == 7 )
+            {
+                i_run = 0;
+                i_program = (i_program + 1) % PROGRAMS;
+            }
+            i_pid = 0x200 + 2 * i_program;
+        }
+        WritePacket( p, i_pid, cc[i_pid]++, i_run == 0, (i % 40) == 0 );
+    }
+}
+
+static ts_header_t ReferenceHeader( const uint8_t *p )
+{
+    return ((p[1] & 0x1F) << 8) | p[2] | ((p[1] & 0xE0) << 8) |
+           ((uint32_t)p[3] << 16);
+}
+
+static int TestScan( uint8_t *p_buf, size_t i_stride, size_t i_prefix )
+{
+    ts_header_t headers[SCAN_MAX];
+
+    BuildMPTS( p_buf, i_stride, i_prefix );
+
+    /* All counts, so that both the vector and the scalar tails are used */
+    for( unsigned i_count = 1; i_count <= SCAN_MAX; i_count++ )
+    {
+        const uint8_t *p = &p_buf[i_count * 3 * i_stride + i_prefix];
+
+        if( ScanPackets( p, i_count, i_stride, headers ) != i_count )
+            BAILOUT( "in sync" );
+
+        for( unsigned i = 0; i < i_count; i++ )
+        {
+            const uint8_t *h = &p[i * i_stride];
+
+            if( headers[i] != ReferenceHeader( h ) ||
+                TS_HEADER_PID(headers[i]) != (((h[1] & 0x1F) << 8) | h[2]) ||
+                TS_HEADER_CC(headers[i]) != (h[3] & 0x0F) ||
+                !TS_HEADER_UNIT_START(headers[i]) != !(h[1] & 0x40) ||
+                !TS_HEADER_ADAPTATION(headers[i]) != !(h[3] & 0x20) ||
+                !TS_HEADER_PAYLOAD(headers[i]) != !(h[3] & 0x10) ||
+                TS_HEADER_ERROR(headers[i]) || TS_HEADER_SCRAMBLED(headers[i]) )
+                BAILOUT( "fields" );
+        }
+    }
+
+    /* Sync loss at every position */
+    for( unsigned i_lost = 0; i_lost < SCAN_MAX; i_lost++ )
+    {
+        uint8_t *p = &p_buf[i_prefix];
+
+        p[i_lost * i_stride] = 0x46;
+        if( ScanPackets( p, SCAN_MAX, i_stride, headers ) != i_lost )
+            BAILOUT( "sync loss" );
+        p[i_lost * i_stride] = 0x47;
+    }
+
+    /* Error and scrambling bits */
+    uint8_t *p = &p_buf[i_prefix];
+    p[1] |= 0x80;
+    p[3] |= 0x80;
+    if( ScanPackets( p, 1, i_stride, headers ) != 1 ||
+        !TS_HEADER_ERROR(headers[0]) || !TS_HEADER_SCRAMBLED(headers[0]) )
+        BAILOUT( "flags" );
+
+    return 0;
+}
+
+static double Now( void )
+{
+    struct timespec ts;
+
+    timespec_get( &ts, TIME_UTC );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Stands for the PID table lookup of the demuxer */
+static const uint16_t *LookupPID( uint16_t i_pid )
+{
+    return bsearch( &i_pid, pid_table, ARRAY_SIZE(pid_table),
+                    sizeof (pid_table[0]), ComparePID );
+}
+
+/* Only the first program is played, as when watching a multiplex: the
+ * packets of its elementary streams are gathered, others are dropped */
+static bool IsGathered( uint16_t i_pid )
+{
+    return i_pid == 0x200 || i_pid == 0x201;
+}
+
+static volatile uintptr_t sink;
+
+/* One packet at a time, each read into its own block, as was done before */
+static unsigned BenchPacketWise( const uint8_t *p_buf, size_t i_stride )
+{
+    uintptr_t acc = 0;
+    unsigned i_lookups = 0;
+
+    for( unsigned i = 0; i < PACKETS; i++ )
+    {
+        uint8_t *p = malloc( i_stride );
+        if( p == NULL )
+            abort();
+        memcpy( p, &p_buf[i * i_stride], i_stride );
+
+        if( p[0] != 0x47 )
+            abort();
+
+        const uint16_t *p_pid = LookupPID( ((p[1] & 0x1F) << 8) | p[2] );
+        i_lookups++;
+        acc += (p_pid - pid_table) + (p[3] & 0x0F);
+        free( p );
+    }
+    sink = acc;
+    return i_lookups;
+}
+
+/* Batches of scanned headers handled in place, looking the PID up once per
+ * run and only copying the packets to gather */
+static unsigned BenchBatched( const uint8_t *p_buf, size_t i_stride )
+{
+    ts_header_t headers[64];
+    uintptr_t acc = 0;
+    unsigned i_lookups = 0;
+
+    for( unsigned i = 0; i < PACKETS; i += 64 )
+    {
+        const uint8_t *p = &p_buf[i * i_stride];
+
+        if( ScanPackets( p, 64, i_stride, headers ) != 64 )
+            abort();
+
+        const uint16_t *p_pid = NULL;
+        for( unsigned j = 0; j < 64; j++ )
+        {
+            if( p_pid == NULL || *p_pid != TS_HEADER_PID(headers[j]) )
+            {
+                p_pid = LookupPID( TS_HEADER_PID(headers[j]) );
+                i_lookups++;
+            }
+            acc += (p_pid - pid_table) + TS_HEADER_CC(headers[j]);
+
+            if( IsGathered( *p_pid ) )
+            {
+                uint8_t *p_pkt = malloc( TS_PACKET_SIZE_188 );
+                if( p_pkt == NULL )
+                    abort();
+                memcpy( p_pkt, &p[j * i_stride], TS_PACKET_SIZE_188 );
+                acc += p_pkt[3];
+                free( p_pkt );
+            }
+        }
+    }
+    sink = acc;
+    return i_lookups;
+}
+
+static void Bench( const char *psz_name, const uint8_t *p_buf, size_t i_stride,
+                   unsigned (*pf_bench)( const uint8_t *, size_t ) )
+{
+    unsigned i_lookups = 0, i_rounds = 0;
+    double start = Now(), elapsed;
+
+    do
+    {
+        i_lookups = pf_bench( p_buf, i_stride );
+        i_rounds++;
+        elapsed = Now() - start;
+    }
+    while( elapsed < 0.2 );
+
+    printf( "%-12s %3zu bytes: %8.2f Mpackets/s, %5u PID lookups per %u packets\n",
+            psz_name, i_stride, i_rounds * (double)PACKETS / elapsed / 1e6,
+            i_lookups, PACKETS );
+}
+
+int main( void )
+{
+    static const size_t strides[] = {
+        TS_PACKET_SIZE_188, TS_PACKET_SIZE_192, TS_PACKET_SIZE_204,
+    };
+    uint8_t *p_buf = malloc( (size_t)PACKETS * TS_PACKET_SIZE_MAX );
+    if( p_buf == NULL )
+        return 1;
+
+    for( size_t i = 0; i < ARRAY_SIZE(strides); i++ )
+    {
+        /* 192-byte packets carry a 4-byte prefix (Blu-ray M2TS) */
+        size_t i_prefix = strides[i] == TS_PACKET_SIZE_192 ? 4 : 0;
+
+        if( TestScan( p_buf, strides[i], i_prefix ) )
+        {
+            free( p_buf );
+            return 1;
+        }
+    }
+
+    for( size_t i = 0; i < ARRAY_SIZE(strides); i++ )
+    {
+        BuildMPTS( p_buf, strides[i], 0 );
+        Bench( "packet-wise", p_buf, strides[i], BenchPacketWise );
+        Bench( "batched", p_buf, strides[i], BenchBatched );
+    }
+
+    free( p_buf );
+    return 0;
+}
@@ -138,6 +138,9 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
     msg_Dbg( p_demux, "new PAT ts_id=%d version=%d current_next=%d",
              p_dvbpsipat->i_ts_id, p_dvbpsipat->i_version, p_dvbpsipat->b_current_next );
 
+    /* Programs are added and removed */
+    DrainWorkers( p_sys );
+
     /* Save old programs array */
     DECL_ARRAY(ts_pid_t *) old_pmt_rm;
     old_pmt_rm.i_alloc = p_pat->programs.i_alloc;
@@ -1901,6 +1904,9 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
         return;
     }
 
+    /* PIDs move between programs, and all the filters are updated */
+    DrainWorkers( p_sys );
+
     /* Save old es array */
     DECL_ARRAY(ts_pid_t *) pid_to_decref;
     pid_to_decref.i_alloc = p_pmt->e_streams.i_alloc;
@@ -37,6 +37,7 @@
 #include "ts_psi.h"
 #include "ts_si.h"
 #include "ts_psip.h"
+#include "ts_workers.h"
 
 ts_pat_t *ts_pat_New( demux_t *p_demux )
 {
@@ -119,6 +120,8 @@ ts_pmt_t *ts_pmt_New( demux_t *p_demux )
 
     pmt->pcr.b_fix_done = false;
 
+    ts_workers_ProgramInit( pmt );
+
     pmt->eit.i_event_length = 0;
     pmt->eit.i_event_start = 0;
 
@@ -78,6 +78,20 @@ struct ts_pmt_t
     uint64_t i_last_dts_byte;
     bool b_last_dts_probed;
 
+    /* Worker thread and stats, see ts_workers.h */
+    struct
+    {
+        int        i_index; /* -1 until sharded */
+        uint64_t   i_epoch; /* sharded while matching the workers epoch */
+        void      *p_running; /* worker running the program, set by itself */
+        /* locked by the worker */
+        uint64_t   i_packets;
+        uint64_t   i_bytes;
+        uint64_t   i_pcrs;
+        vlc_tick_t i_latency; /* total queuing delay */
+        vlc_tick_t i_latency_max;
+    } worker;
+
     /* CA */
     //en50221_capmt_info_t *capmt;
 
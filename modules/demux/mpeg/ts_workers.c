@@ -0,0 +1,479 @@
+/*****************************************************************************
+ * ts_workers.c: TS Demux per program worker threads
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_threads.h>
+#include <vlc_vector.h>
+
+#include "ts_pid.h"
+#include "ts_streams.h"
+#include "ts_streams_private.h"
+#include "ts_workers.h"
+
+#include <assert.h>
+#include <string.h>
+
+/* Packets queued to a worker before it is woken up */
+#define WORKER_BATCH  32
+/* Packets queued to a worker before the input thread waits for it */
+#define WORKER_QUEUE  1024
+
+typedef struct
+{
+    ts_pmt_t   *p_pmt;
+    ts_pid_t   *p_pid;
+    block_t    *p_pkt; /* NULL for a PCR of p_pmt */
+    size_t      i_skip;
+    ts_90khz_t  i_pcr;
+    uint64_t    i_pos;
+    vlc_tick_t  i_date; /* when handed over by the input thread */
+} ts_work_t;
+
+/* es_out call left to the input thread */
+typedef struct
+{
+    ts_pmt_t   *p_pmt;
+    ts_es_t    *p_es;
+    block_t    *p_chain; /* NULL for a PCR of p_pmt */
+    vlc_tick_t  i_pcr;
+    uint64_t    i_pos;
+} ts_output_t;
+
+typedef struct VLC_VECTOR(ts_output_t) ts_outputs_t;
+
+typedef struct
+{
+    vlc_thread_t  thread;
+    ts_workers_t *p_owner;
+
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;  /* signaled on new work or closing */
+    vlc_cond_t    idle;  /* signaled on free room or when drained */
+    ts_work_t     queue[WORKER_QUEUE];
+    unsigned      i_first;
+    unsigned      i_count;
+    bool          b_busy;
+    bool          b_closing;
+    ts_outputs_t  outputs; /* run, not sent yet */
+
+    /* Only used by the worker thread */
+    ts_outputs_t  pending; /* queued during the current run */
+
+    /* Only used by the input thread */
+    ts_work_t     batch[WORKER_BATCH]; /* not queued yet */
+    unsigned      i_batch;
+    ts_outputs_t  sending;
+} ts_worker_t;
+
+struct ts_workers_t
+{
+    demux_t      *p_demux;
+    const ts_workers_callbacks_t *cbs;
+    unsigned      i_next; /* round robin program assignment */
+    uint64_t      i_epoch; /* bumped on drain */
+    unsigned      i_count;
+    ts_workers_stats_t stats;
+    ts_worker_t   workers[];
+};
+
+static void ReleaseOutputs( ts_outputs_t *p_outputs )
+{
+    ts_output_t *p_output;
+    vlc_vector_foreach_ref( p_output, p_outputs )
+        if( p_output->p_chain )
+            block_ChainRelease( p_output->p_chain );
+    vlc_vector_clear( p_outputs );
+}
+
+/* Called with the worker lock held */
+static void WorkStats( ts_work_t *p_work, vlc_tick_t i_now )
+{
+    ts_pmt_t *p_pmt = p_work->p_pmt;
+
+    vlc_tick_t i_latency = i_now - p_work->i_date;
+    p_pmt->worker.i_latency += i_latency;
+    if( i_latency > p_pmt->worker.i_latency_max )
+        p_pmt->worker.i_latency_max = i_latency;
+
+    if( p_work->p_pkt )
+    {
+        p_pmt->worker.i_packets++;
+        p_pmt->worker.i_bytes += p_work->p_pkt->i_buffer;
+    }
+    else
+        p_pmt->worker.i_pcrs++;
+}
+
+static void RunWork( ts_worker_t *p_worker, ts_work_t *p_work )
+{
+    const ts_workers_callbacks_t *cbs = p_worker->p_owner->cbs;
+    demux_t *p_demux = p_worker->p_owner->p_demux;
+    ts_pmt_t *p_pmt = p_work->p_pmt;
+
+    p_pmt->worker.p_running = p_worker;
+    if( p_work->p_pkt )
+        cbs->pf_packet( p_demux, p_work->p_pid, p_work->p_pkt, p_work->i_skip );
+    else
+        cbs->pf_pcr( p_demux, p_pmt, p_work->i_pcr, p_work->i_pos );
+    p_pmt->worker.p_running = NULL;
+}
+
+static void *WorkerThread( void *data )
+{
+    ts_worker_t *p_worker = data;
+    ts_work_t works[WORKER_BATCH];
+
+    vlc_thread_set_name( "vlc-ts-program" );
+
+    vlc_mutex_lock( &p_worker->lock );
+    for( ;; )
+    {
+        while( p_worker->i_count == 0 && !p_worker->b_closing )
+        {
+            p_worker->b_busy = false;
+            vlc_cond_broadcast( &p_worker->idle );
+            vlc_cond_wait( &p_worker->wait, &p_worker->lock );
+        }
+
+        /* Pending work is always run, even when closing */
+        if( p_worker->i_count == 0 )
+            break;
+
+        const vlc_tick_t i_now = vlc_tick_now();
+        unsigned i_works = __MIN( p_worker->i_count, WORKER_BATCH );
+        for( unsigned i = 0; i < i_works; i++ )
+        {
+            works[i] = p_worker->queue[p_worker->i_first];
+            p_worker->i_first = (p_worker->i_first + 1) % WORKER_QUEUE;
+            WorkStats( &works[i], i_now );
+        }
+        p_worker->i_count -= i_works;
+        p_worker->b_busy = true;
+        vlc_cond_broadcast( &p_worker->idle );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        for( unsigned i = 0; i < i_works; i++ )
+            RunWork( p_worker, &works[i] );
+
+        vlc_mutex_lock( &p_worker->lock );
+        if( p_worker->pending.size > 0 &&
+            !vlc_vector_push_all( &p_worker->outputs, p_worker->pending.data,
+                                  p_worker->pending.size ) )
+            ReleaseOutputs( &p_worker->pending );
+        vlc_vector_clear( &p_worker->pending );
+    }
+    vlc_mutex_unlock( &p_worker->lock );
+
+    return NULL;
+}
+
+static void WorkerFlush( ts_worker_t *p_worker )
+{
+    if( p_worker->i_batch == 0 )
+        return;
+
+    vlc_mutex_lock( &p_worker->lock );
+    while( WORKER_QUEUE - p_worker->i_count < p_worker->i_batch )
+        vlc_cond_wait( &p_worker->idle, &p_worker->lock );
+
+    for( unsigned i = 0; i < p_worker->i_batch; i++ )
+    {
+        unsigned i_last = (p_worker->i_first + p_worker->i_count) % WORKER_QUEUE;
+        p_worker->queue[i_last] = p_worker->batch[i];
+        p_worker->i_count++;
+    }
+    p_worker->i_batch = 0;
+    vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    p_worker->p_owner->stats.i_flushes++;
+}
+
+static void WorkerOutput( ts_worker_t *p_worker )
+{
+    ts_workers_t *p_workers = p_worker->p_owner;
+    const ts_workers_callbacks_t *cbs = p_workers->cbs;
+
+    /* Swapped, so that the worker does not wait for the es_out */
+    vlc_mutex_lock( &p_worker->lock );
+    ts_outputs_t outputs = p_worker->outputs;
+    p_worker->outputs = p_worker->sending;
+    vlc_mutex_unlock( &p_worker->lock );
+    p_worker->sending = outputs;
+
+    ts_output_t *p_output;
+    vlc_vector_foreach_ref( p_output, &p_worker->sending )
+    {
+        if( p_output->p_chain )
+            cbs->pf_send( p_workers->p_demux, p_output->p_es, p_output->p_chain );
+        else
+            cbs->pf_set_pcr( p_workers->p_demux, p_output->p_pmt,
+                             p_output->i_pcr, p_output->i_pos );
+    }
+    p_workers->stats.i_outputs += p_worker->sending.size;
+    vlc_vector_clear( &p_worker->sending );
+}
+
+static void WorkerDrain( ts_worker_t *p_worker )
+{
+    WorkerFlush( p_worker );
+
+    vlc_mutex_lock( &p_worker->lock );
+    while( p_worker->i_count > 0 || p_worker->b_busy )
+        vlc_cond_wait( &p_worker->idle, &p_worker->lock );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    WorkerOutput( p_worker );
+}
+
+void ts_workers_Shard( ts_workers_t *p_workers, ts_pmt_t *p_pmt )
+{
+    if( p_pmt->worker.i_index < 0 )
+    {
+        p_pmt->worker.i_index = p_workers->i_next++ % p_workers->i_count;
+        msg_Dbg( p_workers->p_demux, "program %d demuxed by worker %d",
+                 p_pmt->i_number, p_pmt->worker.i_index );
+    }
+    p_pmt->worker.i_epoch = p_workers->i_epoch;
+}
+
+bool ts_workers_IsSharded( const ts_workers_t *p_workers, const ts_pmt_t *p_pmt )
+{
+    return p_pmt->worker.i_epoch == p_workers->i_epoch;
+}
+
+static ts_work_t * WorkerBatch( ts_workers_t *p_workers, ts_pmt_t *p_pmt )
+{
+    assert( ts_workers_IsSharded( p_workers, p_pmt ) );
+
+    ts_worker_t *p_worker = &p_workers->workers[p_pmt->worker.i_index];
+    if( p_worker->i_batch == WORKER_BATCH )
+        WorkerFlush( p_worker );
+
+    ts_work_t *p_work = &p_worker->batch[p_worker->i_batch++];
+    p_work->p_pmt = p_pmt;
+    p_work->i_date = vlc_tick_now();
+    return p_work;
+}
+
+void ts_workers_PushPacket( ts_workers_t *p_workers, ts_pmt_t *p_pmt,
+                            ts_pid_t *p_pid, block_t *p_pkt, size_t i_skip )
+{
+    ts_work_t *p_work = WorkerBatch( p_workers, p_pmt );
+    p_work->p_pid = p_pid;
+    p_work->p_pkt = p_pkt;
+    p_work->i_skip = i_skip;
+    p_workers->stats.i_packets++;
+}
+
+void ts_workers_PushPCR( ts_workers_t *p_workers, ts_pmt_t *p_pmt,
+                         ts_90khz_t i_pcr, uint64_t i_pos )
+{
+    ts_work_t *p_work = WorkerBatch( p_workers, p_pmt );
+    p_work->p_pid = NULL;
+    p_work->p_pkt = NULL;
+    p_work->i_pcr = i_pcr;
+    p_work->i_pos = i_pos;
+    p_workers->stats.i_pcrs++;
+}
+
+void ts_workers_Flush( ts_workers_t *p_workers )
+{
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+        WorkerFlush( &p_workers->workers[i] );
+}
+
+void ts_workers_Output( ts_workers_t *p_workers )
+{
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+        WorkerOutput( &p_workers->workers[i] );
+}
+
+void ts_workers_Drain( ts_workers_t *p_workers )
+{
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+        WorkerDrain( &p_workers->workers[i] );
+
+    p_workers->i_epoch++;
+    p_workers->stats.i_drains++;
+}
+
+void ts_workers_DrainProgram( ts_workers_t *p_workers, ts_pmt_t *p_pmt )
+{
+    /* Nothing is queued for programs taken back by the last drain */
+    if( !ts_workers_IsSharded( p_workers, p_pmt ) )
+        return;
+
+    WorkerDrain( &p_workers->workers[p_pmt->worker.i_index] );
+
+    p_pmt->worker.i_epoch = 0; /* never matches the workers epoch */
+    p_workers->stats.i_program_drains++;
+}
+
+bool ts_workers_QueueSend( ts_pmt_t *p_pmt, ts_es_t *p_es, block_t *p_chain )
+{
+    ts_worker_t *p_worker = p_pmt ? p_pmt->worker.p_running : NULL;
+    if( p_worker == NULL )
+        return false;
+
+    if( p_chain == NULL )
+        return true;
+
+    ts_output_t output = {
+        .p_pmt = p_pmt,
+        .p_es = p_es,
+        .p_chain = p_chain,
+    };
+    if( !vlc_vector_push( &p_worker->pending, output ) )
+        block_ChainRelease( p_chain );
+    return true;
+}
+
+bool ts_workers_QueuePCR( ts_pmt_t *p_pmt, vlc_tick_t i_pcr, uint64_t i_pos )
+{
+    ts_worker_t *p_worker = p_pmt->worker.p_running;
+    if( p_worker == NULL )
+        return false;
+
+    ts_output_t output = {
+        .p_pmt = p_pmt,
+        .i_pcr = i_pcr,
+        .i_pos = i_pos,
+    };
+    vlc_vector_push( &p_worker->pending, output );
+    return true;
+}
+
+void ts_workers_GetStats( const ts_workers_t *p_workers, ts_workers_stats_t *p_stats )
+{
+    *p_stats = p_workers->stats;
+}
+
+void ts_workers_GetProgramStats( ts_workers_t *p_workers, const ts_pmt_t *p_pmt,
+                                 ts_workers_program_stats_t *p_stats )
+{
+    memset( p_stats, 0, sizeof(*p_stats) );
+    if( p_pmt->worker.i_index < 0 )
+        return;
+
+    ts_worker_t *p_worker = &p_workers->workers[p_pmt->worker.i_index];
+    vlc_mutex_lock( &p_worker->lock );
+    p_stats->i_packets = p_pmt->worker.i_packets;
+    p_stats->i_bytes = p_pmt->worker.i_bytes;
+    p_stats->i_pcrs = p_pmt->worker.i_pcrs;
+    p_stats->i_latency = p_pmt->worker.i_latency;
+    p_stats->i_latency_max = p_pmt->worker.i_latency_max;
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+static void WorkerStop( ts_worker_t *p_worker )
+{
+    WorkerFlush( p_worker );
+
+    vlc_mutex_lock( &p_worker->lock );
+    p_worker->b_closing = true;
+    vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    vlc_join( p_worker->thread, NULL );
+
+    ReleaseOutputs( &p_worker->outputs );
+    vlc_vector_destroy( &p_worker->outputs );
+    vlc_vector_destroy( &p_worker->pending );
+    vlc_vector_destroy( &p_worker->sending );
+}
+
+ts_workers_t * ts_workers_New( demux_t *p_demux, const ts_workers_callbacks_t *cbs,
+                               unsigned i_threads )
+{
+    assert( i_threads > 0 );
+
+    ts_workers_t *p_workers = malloc( sizeof(*p_workers) +
+                                      i_threads * sizeof(p_workers->workers[0]) );
+    if( !p_workers )
+        return NULL;
+
+    p_workers->p_demux = p_demux;
+    p_workers->cbs = cbs;
+    p_workers->i_next = 0;
+    p_workers->i_epoch = 1;
+    p_workers->i_count = 0;
+    memset( &p_workers->stats, 0, sizeof(p_workers->stats) );
+
+    for( unsigned i = 0; i < i_threads; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->workers[i];
+
+        p_worker->p_owner = p_workers;
+        vlc_mutex_init( &p_worker->lock );
+        vlc_cond_init( &p_worker->wait );
+        vlc_cond_init( &p_worker->idle );
+        p_worker->i_first = 0;
+        p_worker->i_count = 0;
+        p_worker->b_busy = false;
+        p_worker->b_closing = false;
+        vlc_vector_init( &p_worker->outputs );
+        vlc_vector_init( &p_worker->pending );
+        p_worker->i_batch = 0;
+        vlc_vector_init( &p_worker->sending );
+
+        if( vlc_clone( &p_worker->thread, WorkerThread, p_worker ) )
+        {
+            vlc_vector_destroy( &p_worker->outputs );
+            vlc_vector_destroy( &p_worker->pending );
+            vlc_vector_destroy( &p_worker->sending );
+            ts_workers_Delete( p_workers );
+            return NULL;
+        }
+        p_workers->i_count++;
+    }
+
+    return p_workers;
+}
+
+void ts_workers_Delete( ts_workers_t *p_workers )
+{
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+        WorkerStop( &p_workers->workers[i] );
+
+    const ts_workers_stats_t *p_stats = &p_workers->stats;
+    msg_Dbg( p_workers->p_demux, "workers: %"PRIu64" packets, %"PRIu64" PCR in %"
+             PRIu64" batches, %"PRIu64" outputs, %"PRIu64" drains, %"PRIu64
+             " program drains", p_stats->i_packets, p_stats->i_pcrs,
+             p_stats->i_flushes, p_stats->i_outputs, p_stats->i_drains,
+             p_stats->i_program_drains );
+    free( p_workers );
+}
+
+void ts_workers_ProgramInit( ts_pmt_t *p_pmt )
+{
+    p_pmt->worker.i_index = -1;
+    p_pmt->worker.i_epoch = 0;
+    p_pmt->worker.p_running = NULL;
+    p_pmt->worker.i_packets = 0;
+    p_pmt->worker.i_bytes = 0;
+    p_pmt->worker.i_pcrs = 0;
+    p_pmt->worker.i_latency = 0;
+    p_pmt->worker.i_latency_max = 0;
+}
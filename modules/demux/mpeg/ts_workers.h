@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * ts_workers.h: TS Demux per program worker threads
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_WORKERS_H
+#define VLC_TS_WORKERS_H
+
+#include "timestamps.h"
+
+/* Per program PES gathering and PCR handling, run on worker threads.
+ *
+ * The input thread still syncs, checks continuity and handles the tables,
+ * then hands the packets of the programs it shards over to their worker.
+ * A program always runs on the same worker, so its packets stay ordered.
+ * Only programs whose PIDs are all their own are sharded, and anything else
+ * touching a sharded program must drain the workers first.
+ *
+ * Workers never call the es_out: the blocks and PCR they produce are queued,
+ * then sent in order by the input thread (ts_workers_Output). */
+
+typedef struct ts_workers_t ts_workers_t;
+
+typedef struct
+{
+    /* gathers a PES packet, i_skip bytes past the TS header */
+    void (*pf_packet)( demux_t *, ts_pid_t *, block_t *, size_t i_skip );
+    /* handles a PCR of the program, at byte position i_pos of the stream */
+    void (*pf_pcr)( demux_t *, ts_pmt_t *, ts_90khz_t, uint64_t i_pos );
+
+    /* run by the input thread on the output queued by the workers */
+    void (*pf_send)( demux_t *, ts_es_t *, block_t * );
+    void (*pf_set_pcr)( demux_t *, ts_pmt_t *, vlc_tick_t, uint64_t i_pos );
+} ts_workers_callbacks_t;
+
+/* Counters of the input thread side */
+typedef struct
+{
+    uint64_t i_packets;        /* PES packets queued */
+    uint64_t i_pcrs;           /* PCR queued */
+    uint64_t i_flushes;        /* batches handed over to a worker */
+    uint64_t i_drains;         /* waits for all the workers */
+    uint64_t i_program_drains; /* waits for the worker of a single program */
+    uint64_t i_outputs;        /* blocks chains and PCR sent for the workers */
+} ts_workers_stats_t;
+
+ts_workers_t * ts_workers_New( demux_t *, const ts_workers_callbacks_t *,
+                               unsigned i_threads );
+/* Runs the pending packets, then joins the threads.
+ * Output not sent yet is dropped. */
+void ts_workers_Delete( ts_workers_t * );
+
+/* Hands a program over to its worker, until the next drain */
+void ts_workers_Shard( ts_workers_t *, ts_pmt_t * );
+bool ts_workers_IsSharded( const ts_workers_t *, const ts_pmt_t * );
+
+void ts_workers_PushPacket( ts_workers_t *, ts_pmt_t *, ts_pid_t *,
+                            block_t *, size_t i_skip );
+/* Only for the programs taking their clock from the PID it was sent on */
+void ts_workers_PushPCR( ts_workers_t *, ts_pmt_t *, ts_90khz_t, uint64_t i_pos );
+/* Queues the packets batched so far */
+void ts_workers_Flush( ts_workers_t * );
+/* Sends the output the workers queued so far, without waiting for them */
+void ts_workers_Output( ts_workers_t * );
+/* Waits until all queued packets have been run, sends their output, and
+ * takes all programs back to the input thread */
+void ts_workers_Drain( ts_workers_t * );
+/* Waits until the packets queued for that program have been run, sends their
+ * output, and takes it back to the input thread. The other programs stay with
+ * their worker. */
+void ts_workers_DrainProgram( ts_workers_t *, ts_pmt_t * );
+
+/* Called by the callbacks: queue the output of the program for the input
+ * thread when run by a worker, otherwise return false */
+bool ts_workers_QueueSend( ts_pmt_t *, ts_es_t *, block_t * );
+bool ts_workers_QueuePCR( ts_pmt_t *, vlc_tick_t, uint64_t i_pos );
+
+/* Counters of a program, as run by its worker */
+typedef struct
+{
+    uint64_t   i_packets;
+    uint64_t   i_bytes;
+    uint64_t   i_pcrs;
+    vlc_tick_t i_latency; /* total queuing delay */
+    vlc_tick_t i_latency_max;
+} ts_workers_program_stats_t;
+
+void ts_workers_GetStats( const ts_workers_t *, ts_workers_stats_t * );
+void ts_workers_GetProgramStats( ts_workers_t *, const ts_pmt_t *,
+                                 ts_workers_program_stats_t * );
+
+void ts_workers_ProgramInit( ts_pmt_t * );
+
+#endif
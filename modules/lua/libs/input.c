@@ -625,13 +625,37 @@ static int vlclua_input_item_stats( lua_State *L )
         STATS_FLOAT( demux_bitrate )
         STATS_INT( demux_corrupted )
         STATS_INT( demux_discontinuity )
+        STATS_INT( demux_program_packets )
+        STATS_INT( demux_program_bytes )
+        STATS_INT( demux_program_latency )
+        STATS_INT( demux_program_latency_max )
+        STATS_INT( adaptive_latency )
+        STATS_FLOAT( adaptive_rate )
+        STATS_INT( adaptive_http2_connections )
+        STATS_INT( adaptive_http2_failures )
+        STATS_INT( adaptive_http2_requests )
         STATS_INT( decoded_audio )
         STATS_INT( decoded_video )
         STATS_INT( displayed_pictures )
         STATS_INT( late_pictures )
         STATS_INT( lost_pictures )
+        STATS_INT( spu_cache_hits )
+        STATS_INT( spu_cache_misses )
         STATS_INT( played_abuffers )
         STATS_INT( lost_abuffers )
+        STATS_INT( prefetch_size )
+        STATS_INT( prefetch_hits )
+        STATS_INT( prefetch_stalls )
+        STATS_INT( prefetch_seeks )
+        STATS_INT( timeshift_size )
+        STATS_INT( timeshift_fill )
+        STATS_INT( timeshift_write_latency )
+        STATS_INT( timeshift_index )
+        STATS_INT( sent_packets )
+        STATS_INT( sent_bytes )
+        STATS_INT( send_calls )
+        STATS_INT( paced_packets )
+        STATS_INT( pacing_slip_max )
 #undef STATS_INT
 #undef STATS_FLOAT
     }
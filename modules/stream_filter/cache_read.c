@@ -25,424 +25,643 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
 
 #include <vlc_common.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_list.h>
 #include <vlc_plugin.h>
 #include <vlc_stream.h>
-#include <vlc_interrupt.h>
+#include <vlc_vector.h>
 
 // #define STREAM_DEBUG 1
 
 /*
- * Complex scheme using multiple track to avoid seeking
+ * Sparse block cache
+ *
+ * The stream is split in fixed size blocks, indexed by offset in a binary
+ * tree. The blocks fetched from upstream are kept, whatever their position,
+ * until the memory limit is reached. The least recently used blocks are then
+ * either dropped, or written to a temporary file if spilling to disk is
+ * enabled. Blocks are kept in least recently used order, in one list for
+ * those in memory and another for those on disk.
+ *
+ * Method:
+ *  - Seeks are lazy: they only move the read offset. Upstream only seeks
+ *    when reading a block which is not in the cache.
+ *  - On a miss, the missing blocks following the requested one are fetched
+ *    in the same upstream request, up to the size requested by the reader or
+ *    the size of the cached range preceding it: sequential reads double the
+ *    read-ahead, random reads (e.g. demuxer index parsing) only fetch what
+ *    they need.
+ *  - Short forward gaps are read through rather than seeked over, and the
+ *    data read on the way is cached too.
+ *  - With a non seekable upstream, data before the upstream offset is only
+ *    available as long as it stays in the cache.
  */
 
-/* How many tracks we have, currently only used for stream mode */
+#define STREAM_CACHE_BLOCK_SIZE (32 * 1024)
+/* Maximum read-ahead, in blocks */
+#define STREAM_CACHE_RUN_MAX 128
+/* Forward gap read through instead of seeking, in bytes */
+#define STREAM_CACHE_SKIP STREAM_CACHE_BLOCK_SIZE
+
 #ifdef OPTIMIZE_MEMORY
-#   define STREAM_CACHE_TRACK 1
-    /* Max size of our cache 128Ko per track */
-#   define STREAM_CACHE_SIZE  (STREAM_CACHE_TRACK*1024*128)
+    /* Default memory limit in KiB */
+#   define STREAM_CACHE_SIZE 128
 #else
-#   define STREAM_CACHE_TRACK 3
-    /* Max size of our cache 4Mo per track */
-#   define STREAM_CACHE_SIZE  (4*STREAM_CACHE_TRACK*1024*1024)
+#   define STREAM_CACHE_SIZE (12 * 1024)
 #endif
 
-/* How many data we try to prebuffer
- * XXX it should be small to avoid useless latency but big enough for
- * efficient demux probing */
-#define STREAM_CACHE_PREBUFFER_SIZE (128)
-
-/* Method:
- *  - We use ring buffers, only one if unseekable, all if seekable
- *  - Upon seek date current ring, then search if one ring match the pos,
- *      yes: switch to it, seek the access to match the end of the ring
- *      no: search the ring with i_end the closer to i_pos,
- *          if close enough, read data and use this ring
- *          else use the oldest ring, seek and use it.
- *
- *  TODO: - with access non seekable: use all space available for only one ring, but
- *          we have to support seekable/non-seekable switch on the fly.
- *        - compute a good value for i_read_size
- *        - ?
- */
-#define STREAM_READ_ATONCE 1024
-#define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
-
-typedef struct
+struct cache_block
 {
-    vlc_tick_t date;
-
-    uint64_t i_start;
-    uint64_t i_end;
-
-    uint8_t *p_buffer;
-
-} stream_track_t;
+    uint64_t index; /* Offset divided by the block size */
+    struct vlc_list node; /* In the memory or disk LRU list */
+    unsigned length; /* Cached bytes, from the block start */
+    uint8_t *data; /* NULL if spilled to disk */
+    uint32_t slot; /* Spill file slot, if spilled */
+};
 
 typedef struct
 {
     uint64_t     i_pos;      /* Current reading offset */
+    uint64_t     i_upstream; /* Upstream reading offset */
 
-    unsigned     i_offset;   /* Buffer offset in the current track */
-    int          i_tk;       /* Current track */
-    stream_track_t tk[STREAM_CACHE_TRACK];
+    /* Blocks by index */
+    void        *p_index;
+    size_t       i_blocks;
+    struct vlc_list mem_lru; /* Blocks held in memory, least recent first */
+    struct vlc_list disk_lru; /* Spilled blocks, least recent first */
+    size_t       i_mem;      /* Blocks held in memory */
+    size_t       i_mem_max;
 
-    /* Global buffer */
+    /* Upstream read buffer */
     uint8_t     *p_buffer;
+    size_t       i_buffer;
 
-    /* */
-    unsigned     i_used; /* Used since last read */
-    unsigned     i_read_size;
+    /* Spill file */
+    int          fd;
+    char        *psz_file;
+    uint32_t     i_slots;    /* Slots used so far */
+    uint32_t     i_slots_max;
+    struct VLC_VECTOR(uint32_t) free_slots;
 
     struct
     {
-        /* Stat about reading data */
         uint64_t i_read_count;
-        uint64_t i_bytes;
+        uint64_t i_hits;
+        uint64_t i_requests; /* Upstream requests */
+        uint64_t i_seeks; /* Upstream seeks */
+        uint64_t i_bytes; /* Upstream bytes */
+        uint64_t i_spills;
+        uint64_t i_loads;
         vlc_tick_t i_read_time;
     } stat;
 } stream_sys_t;
 
-static int AStreamRefillStream(stream_t *s)
+/****************************************************************************
+ * Block index
+ ****************************************************************************/
+static int BlockCmp(const void *a, const void *b)
 {
-    stream_sys_t *sys = s->p_sys;
-    stream_track_t *tk = &sys->tk[sys->i_tk];
+    const struct cache_block *x = a, *y = b;
 
-    /* We read but won't increase i_start after initial start + offset */
-    int i_toread =
-        __MIN(sys->i_used, STREAM_CACHE_TRACK_SIZE -
-               (tk->i_end - tk->i_start - sys->i_offset));
+    return (x->index > y->index) - (x->index < y->index);
+}
 
-    if (i_toread <= 0) return VLC_SUCCESS; /* EOF */
+static struct cache_block *BlockLookup(stream_sys_t *sys, uint64_t index)
+{
+    const struct cache_block key = { .index = index };
+    void **node = tfind(&key, &sys->p_index, BlockCmp);
 
-#ifdef STREAM_DEBUG
-    msg_Dbg(s, "AStreamRefillStream: used=%d toread=%d",
-                 sys->i_used, i_toread);
-#endif
+    return node != NULL ? *node : NULL;
+}
 
-    vlc_tick_t start = vlc_tick_now();
-    while (i_toread > 0)
-    {
-        int i_off = tk->i_end % STREAM_CACHE_TRACK_SIZE;
-        int i_read;
+/* Marks a block as the most recently used */
+static void BlockTouch(stream_sys_t *sys, struct cache_block *b)
+{
+    vlc_list_remove(&b->node);
+    vlc_list_append(&b->node, b->data != NULL ? &sys->mem_lru
+                                              : &sys->disk_lru);
+}
 
-        if (vlc_killed())
-            return VLC_EGENERIC;
+static void BlockRemove(stream_sys_t *sys, struct cache_block *b)
+{
+    tdelete(b, &sys->p_index, BlockCmp);
+    vlc_list_remove(&b->node);
+    sys->i_blocks--;
+
+    if (b->data != NULL)
+    {
+        free(b->data);
+        sys->i_mem--;
+    }
+    else
+        vlc_vector_push(&sys->free_slots, b->slot);
+    free(b);
+}
 
-        i_read = __MIN(i_toread, STREAM_CACHE_TRACK_SIZE - i_off);
-        i_read = vlc_stream_Read(s->s, &tk->p_buffer[i_off], i_read);
+static void BlockFree(void *node)
+{
+    struct cache_block *b = node;
 
-        /* msg_Dbg(s, "AStreamRefillStream: read=%d", i_read); */
-        if (i_read <  0)
-        {
-            continue;
-        }
-        else if (i_read == 0)
-            return VLC_SUCCESS;
+    free(b->data);
+    free(b);
+}
 
-        /* Update end */
-        tk->i_end += i_read;
+static void BlockFlush(stream_sys_t *sys)
+{
+    tdestroy(sys->p_index, BlockFree);
+    sys->p_index = NULL;
+    sys->i_blocks = 0;
+    vlc_list_init(&sys->mem_lru);
+    vlc_list_init(&sys->disk_lru);
+    vlc_vector_clear(&sys->free_slots);
+    sys->i_mem = 0;
+    sys->i_slots = 0;
+}
 
-        /* Windows of STREAM_CACHE_TRACK_SIZE */
-        if (tk->i_start + STREAM_CACHE_TRACK_SIZE < tk->i_end)
-        {
-            unsigned i_invalid = tk->i_end - tk->i_start - STREAM_CACHE_TRACK_SIZE;
+/****************************************************************************
+ * Spill file
+ ****************************************************************************/
+static int GetTmpFile(char **filename)
+{
+    char *dir = config_GetUserDir(VLC_CACHE_DIR);
 
-            tk->i_start += i_invalid;
-            sys->i_offset -= i_invalid;
-        }
+    if (dir != NULL
+     && asprintf(filename, "%s"DIR_SEP PACKAGE_NAME"-cache.XXXXXX", dir) >= 0)
+    {
+        vlc_mkdir(dir, 0700);
+        free(dir);
 
-        i_toread -= i_read;
-        sys->i_used -= i_read;
+        int fd = vlc_mkstemp(*filename);
+        if (fd != -1)
+            return fd;
 
-        sys->stat.i_bytes += i_read;
-        sys->stat.i_read_count++;
+        free(*filename);
     }
+    else
+        free(dir);
 
-    sys->stat.i_read_time += vlc_tick_now() - start;
-    return VLC_SUCCESS;
+    *filename = strdup(DIR_SEP"tmp"DIR_SEP PACKAGE_NAME"-cache.XXXXXX");
+    if (unlikely(*filename == NULL))
+        return -1;
+
+    int fd = vlc_mkstemp(*filename);
+    if (fd != -1)
+        return fd;
+
+    free(*filename);
+    return -1;
 }
 
-static void AStreamPrebufferStream(stream_t *s)
+static int SlotIO(stream_t *s, uint8_t *buf, size_t len, uint32_t slot,
+                  bool out)
 {
     stream_sys_t *sys = s->p_sys;
-    vlc_tick_t start = vlc_tick_now();
-    bool first = true;
+    off_t offset = (off_t)slot * STREAM_CACHE_BLOCK_SIZE;
+    size_t done = 0;
 
-    msg_Dbg(s, "starting pre-buffering");
-    for (;;)
+    while (done < len)
     {
-        stream_track_t *tk = &sys->tk[sys->i_tk];
-        vlc_tick_t now = vlc_tick_now();
+        ssize_t val;
+#ifdef _WIN32
+        if (lseek(sys->fd, offset + done, SEEK_SET) == -1)
+            return -1;
+        val = out ? write(sys->fd, buf + done, len - done)
+                  : read(sys->fd, buf + done, len - done);
+#else
+        val = out ? pwrite(sys->fd, buf + done, len - done, offset + done)
+                  : pread(sys->fd, buf + done, len - done, offset + done);
+#endif
+        if (val < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            msg_Err(s, "cannot %s cache file: %s", out ? "write" : "read",
+                    vlc_strerror_c(errno));
+            return -1;
+        }
+        if (val == 0)
+            return -1;
+        done += val;
+    }
+    return 0;
+}
 
-        int i_read;
-        int i_buffered = tk->i_end - tk->i_start;
+/* Writes a block to the spill file, dropping the least recently used spilled
+ * block if the file is full */
+static int BlockSpill(stream_t *s, struct cache_block *b,
+                      const struct cache_block *keep)
+{
+    stream_sys_t *sys = s->p_sys;
+    uint32_t slot;
 
-        if (vlc_killed() || i_buffered >= STREAM_CACHE_PREBUFFER_SIZE)
-        {
-            int64_t i_byterate;
+    if (sys->fd == -1)
+        return -1;
 
-            /* Update stat */
-            sys->stat.i_bytes = i_buffered;
-            sys->stat.i_read_time = now - start;
-            i_byterate = (CLOCK_FREQ * sys->stat.i_bytes) /
-                         (sys->stat.i_read_time+1);
+    if (sys->free_slots.size == 0 && sys->i_slots >= sys->i_slots_max)
+    {
+        struct cache_block *lru = NULL, *t;
 
-            msg_Dbg(s, "pre-buffering done %"PRId64" bytes in %"PRId64"s - "
-                    "%"PRId64" KiB/s", sys->stat.i_bytes,
-                    SEC_FROM_VLC_TICK(sys->stat.i_read_time), i_byterate / 1024);
-            break;
-        }
+        vlc_list_foreach(t, &sys->disk_lru, node)
+            if (t != keep)
+            {
+                lru = t;
+                break;
+            }
+        if (lru == NULL)
+            return -1;
+        BlockRemove(sys, lru);
+    }
 
-        i_read = STREAM_CACHE_TRACK_SIZE - i_buffered;
-        i_read = __MIN((int)sys->i_read_size, i_read);
-        i_read = vlc_stream_Read(s->s, &tk->p_buffer[i_buffered], i_read);
-        if (i_read <  0)
-            continue;
-        else if (i_read == 0)
-            break;  /* EOF */
+    if (sys->free_slots.size > 0)
+    {
+        slot = vlc_vector_last(&sys->free_slots);
+        vlc_vector_remove_noshrink(&sys->free_slots,
+                                   sys->free_slots.size - 1);
+    }
+    else
+        slot = sys->i_slots++;
+
+    if (SlotIO(s, b->data, b->length, slot, true))
+    {
+        vlc_vector_push(&sys->free_slots, slot);
+        return -1;
+    }
 
-        if (first)
+    b->slot = slot;
+    sys->stat.i_spills++;
+    return 0;
+}
+
+/* Takes the buffer of the least recently used block held in memory */
+static uint8_t *BlockEvict(stream_t *s, const struct cache_block *keep)
+{
+    stream_sys_t *sys = s->p_sys;
+    struct cache_block *lru = NULL, *b;
+
+    vlc_list_foreach(b, &sys->mem_lru, node)
+        if (b != keep)
         {
-            msg_Dbg(s, "received first data after %"PRId64" ms",
-                    MS_FROM_VLC_TICK(vlc_tick_now() - start));
-            first = false;
+            lru = b;
+            break;
         }
+    if (lru == NULL)
+        return NULL;
+
+    uint8_t *data = lru->data;
 
-        tk->i_end += i_read;
-        sys->stat.i_read_count++;
+    if (BlockSpill(s, lru, keep) == 0)
+    {
+        lru->data = NULL;
+        BlockTouch(sys, lru);
+    }
+    else
+    {   /* Drop the block, its buffer is reused */
+        tdelete(lru, &sys->p_index, BlockCmp);
+        vlc_list_remove(&lru->node);
+        sys->i_blocks--;
+        free(lru);
     }
+    return data;
 }
 
-/****************************************************************************
- * AStreamControlReset:
- ****************************************************************************/
-static void AStreamControlReset(stream_t *s)
+static uint8_t *BlockBuffer(stream_t *s, const struct cache_block *keep)
 {
     stream_sys_t *sys = s->p_sys;
 
-    sys->i_pos = 0;
+    if (sys->i_mem < sys->i_mem_max)
+    {
+        uint8_t *data = malloc(STREAM_CACHE_BLOCK_SIZE);
+        if (likely(data != NULL))
+        {
+            sys->i_mem++;
+            return data;
+        }
+    }
+    return BlockEvict(s, keep);
+}
 
-    /* Setup our tracks */
-    sys->i_offset = 0;
-    sys->i_tk     = 0;
-    sys->i_used   = 0;
+/* Brings a spilled block back to memory */
+static int BlockLoad(stream_t *s, struct cache_block *b)
+{
+    stream_sys_t *sys = s->p_sys;
+    uint8_t *data = BlockBuffer(s, b);
+
+    if (unlikely(data == NULL))
+        return -1;
 
-    for (unsigned i = 0; i < STREAM_CACHE_TRACK; i++)
+    if (SlotIO(s, data, b->length, b->slot, false))
     {
-        sys->tk[i].date  = 0;
-        sys->tk[i].i_start = sys->i_pos;
-        sys->tk[i].i_end   = sys->i_pos;
+        free(data);
+        sys->i_mem--;
+        BlockRemove(sys, b);
+        return -1;
     }
 
-    /* Do the prebuffering */
-    AStreamPrebufferStream(s);
+    vlc_vector_push(&sys->free_slots, b->slot);
+    b->data = data;
+    BlockTouch(sys, b);
+    sys->stat.i_loads++;
+    return 0;
 }
 
-static ssize_t AStreamReadStream(stream_t *s, void *buf, size_t len)
+static struct cache_block *BlockNew(stream_t *s, uint64_t index)
 {
     stream_sys_t *sys = s->p_sys;
-    stream_track_t *tk = &sys->tk[sys->i_tk];
+    struct cache_block *b = malloc(sizeof (*b));
 
-    if (tk->i_start >= tk->i_end)
-        return 0; /* EOF */
+    if (unlikely(b == NULL))
+        return NULL;
 
-#ifdef STREAM_DEBUG
-    msg_Dbg(s, "AStreamReadStream: %zd pos=%"PRId64" tk=%d start=%"PRId64
-            " offset=%d end=%"PRId64, len, sys->i_pos, sys->i_tk,
-            tk->i_start, sys->i_offset, tk->i_end);
-#endif
+    b->data = BlockBuffer(s, NULL);
+    if (unlikely(b->data == NULL))
+    {
+        free(b);
+        return NULL;
+    }
+    b->index = index;
+    b->length = 0;
 
-    unsigned i_off = (tk->i_start + sys->i_offset) % STREAM_CACHE_TRACK_SIZE;
-    size_t i_current = __MIN(tk->i_end - tk->i_start - sys->i_offset,
-                             STREAM_CACHE_TRACK_SIZE - i_off);
-    ssize_t i_copy = __MIN(i_current, len);
-    if (i_copy <= 0)
-        return 0; /* EOF */
+    void **node = tsearch(b, &sys->p_index, BlockCmp);
+    if (node == NULL || *node != b)
+    {
+        free(b->data);
+        sys->i_mem--;
+        free(b);
+        return NULL;
+    }
+    vlc_list_append(&b->node, &sys->mem_lru);
+    sys->i_blocks++;
+    return b;
+}
 
-    /* Copy data */
-    /* msg_Dbg(s, "AStreamReadStream: copy %zd", i_copy); */
-    if (buf != NULL)
-        memcpy(buf, &tk->p_buffer[i_off], i_copy);
-    sys->i_offset += i_copy;
+/****************************************************************************
+ * Upstream
+ ****************************************************************************/
+/* Copies data read from upstream to the blocks. The data which cannot be
+ * appended to a block is not retained. */
+static void Store(stream_t *s, const uint8_t *buf, size_t len)
+{
+    stream_sys_t *sys = s->p_sys;
 
-    /* Update pos now */
-    sys->i_pos += i_copy;
+    while (len > 0)
+    {
+        uint64_t index = sys->i_upstream / STREAM_CACHE_BLOCK_SIZE;
+        unsigned offset = sys->i_upstream % STREAM_CACHE_BLOCK_SIZE;
+        size_t copy = __MIN(len, STREAM_CACHE_BLOCK_SIZE - offset);
+        struct cache_block *b = BlockLookup(sys, index);
 
-    /* */
-    sys->i_used += i_copy;
+        if (b == NULL && offset == 0)
+            b = BlockNew(s, index);
+        else if (b != NULL && b->data == NULL && BlockLoad(s, b))
+            b = NULL;
 
-    if (tk->i_end + i_copy <= tk->i_start + sys->i_offset + len)
-    {
-        const size_t i_read_requested = VLC_CLIP(len - i_copy,
-                                                 STREAM_READ_ATONCE / 2,
-                                                 STREAM_READ_ATONCE * 10);
-        if (sys->i_used < i_read_requested)
-            sys->i_used = i_read_requested;
+        if (b != NULL && b->length == offset)
+        {
+            memcpy(b->data + offset, buf, copy);
+            b->length += copy;
+            BlockTouch(sys, b);
+        }
 
-        AStreamRefillStream(s);
+        sys->i_upstream += copy;
+        buf += copy;
+        len -= copy;
     }
-
-    return i_copy;
 }
 
-static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
+/* Reads up to len bytes from upstream, blocking until at least min bytes */
+static ssize_t UpstreamRead(stream_t *s, size_t len, size_t min)
 {
     stream_sys_t *sys = s->p_sys;
-    stream_track_t *p_current = &sys->tk[sys->i_tk];
+    size_t done = 0;
 
-    if (p_current->i_start >= p_current->i_end  && i_pos >= p_current->i_end)
-        return 0; /* EOF */
-
-#ifdef STREAM_DEBUG
-    msg_Dbg(s, "AStreamSeekStream: to %"PRId64" pos=%"PRId64
-             " tk=%d start=%"PRId64" offset=%d end=%"PRId64,
-             i_pos, sys->i_pos, sys->i_tk, p_current->i_start,
-             sys->i_offset, p_current->i_end);
-#endif
+    if (sys->i_buffer < len)
+    {
+        uint8_t *buf = realloc(sys->p_buffer, len);
+        if (unlikely(buf == NULL))
+            return -1;
+        sys->p_buffer = buf;
+        sys->i_buffer = len;
+    }
 
-    bool   b_aseek;
-    vlc_stream_Control(s->s, STREAM_CAN_SEEK, &b_aseek);
-    if (!b_aseek && i_pos < p_current->i_start)
+    while (done < len)
     {
-        msg_Warn(s, "AStreamSeekStream: can't seek");
-        return VLC_EGENERIC;
+        ssize_t val = vlc_stream_ReadPartial(s->s, sys->p_buffer + done,
+                                             len - done);
+
+        sys->stat.i_requests++;
+        if (val <= 0)
+        {
+            if (done == 0)
+                return val;
+            break;
+        }
+        done += val;
+        if (done >= min)
+            break;
     }
 
-    bool   b_afastseek;
-    vlc_stream_Control(s->s, STREAM_CAN_FASTSEEK, &b_afastseek);
+    Store(s, sys->p_buffer, done);
+    sys->stat.i_bytes += done;
+    return done;
+}
 
-    /* FIXME compute seek cost (instead of static 'stupid' value) */
-    uint64_t i_skip_threshold;
-    if (b_aseek)
-        i_skip_threshold = b_afastseek ? 128 : 3 * sys->i_read_size;
-    else
-        i_skip_threshold = INT64_MAX;
+/* Read-ahead: as many blocks as the cached range preceding the index */
+static unsigned ReadAheadSize(stream_sys_t *sys, uint64_t index, unsigned max)
+{
+    unsigned run = 1;
 
-    /* Date the current track */
-    p_current->date = vlc_tick_now();
+    while (run < max && index >= run
+        && BlockLookup(sys, index - run) != NULL)
+        run++;
+    return run;
+}
 
-    /* Search a new track slot */
-    stream_track_t *tk = NULL;
-    int i_tk_idx = -1;
+/* Fetches at least min bytes of the block at the given index, and the
+ * missing blocks after it, up to the given size */
+static int Fetch(stream_t *s, uint64_t index, unsigned min, size_t size)
+{
+    stream_sys_t *sys = s->p_sys;
+    struct cache_block *b = BlockLookup(sys, index);
+    unsigned length = b != NULL ? b->length : 0;
+    uint64_t offset = index * STREAM_CACHE_BLOCK_SIZE + length;
+    vlc_tick_t start = vlc_tick_now();
+    uint64_t stream_size;
 
-    /* Prefer the current track */
-    if (p_current->i_start <= i_pos && i_pos <= p_current->i_end + i_skip_threshold)
-    {
-        tk = p_current;
-        i_tk_idx = sys->i_tk;
-    }
-    if (!tk)
+    assert(min > length);
+    if (vlc_stream_GetSize(s->s, &stream_size) == VLC_SUCCESS
+     && offset >= stream_size)
+        return VLC_SUCCESS; /* EOF */
+
+    if (sys->i_upstream != offset)
     {
-        /* Try to maximize already read data */
-        for (int i = 0; i < STREAM_CACHE_TRACK; i++)
+        struct cache_block *up = BlockLookup(sys, sys->i_upstream
+                                                  / STREAM_CACHE_BLOCK_SIZE);
+        bool b_aseek, b_afastseek;
+
+        if (vlc_stream_Control(s->s, STREAM_CAN_SEEK, &b_aseek))
+            b_aseek = false;
+        if (vlc_stream_Control(s->s, STREAM_CAN_FASTSEEK, &b_afastseek))
+            b_afastseek = false;
+
+        /* Read through short gaps, unless the data is already cached */
+        if (offset > sys->i_upstream
+         && (!b_aseek
+          || (!b_afastseek && offset - sys->i_upstream <= STREAM_CACHE_SKIP
+           && (up == NULL || up->length
+                             <= sys->i_upstream % STREAM_CACHE_BLOCK_SIZE))))
         {
-            stream_track_t *t = &sys->tk[i];
-
-            if (t->i_start > i_pos || i_pos > t->i_end)
-                continue;
-
-            if (!tk || tk->i_end < t->i_end)
+            while (sys->i_upstream < offset)
             {
-                tk = t;
-                i_tk_idx = i;
+                size_t gap = __MIN(offset - sys->i_upstream,
+                                   STREAM_CACHE_RUN_MAX
+                                   * STREAM_CACHE_BLOCK_SIZE);
+                ssize_t val = UpstreamRead(s, gap, gap);
+
+                if (val <= 0)
+                    return val < 0 ? VLC_EGENERIC : VLC_SUCCESS; /* EOF */
             }
+            /* The block may have been filled on the way */
+            b = BlockLookup(sys, index);
+            length = b != NULL ? b->length : 0;
+            if (length >= min)
+                return VLC_SUCCESS;
+            if (index * STREAM_CACHE_BLOCK_SIZE + length != offset)
+                return VLC_EGENERIC;
         }
-    }
-    if (!tk)
-    {
-        /* Use the oldest unused */
-        for (int i = 0; i < STREAM_CACHE_TRACK; i++)
+        else
         {
-            stream_track_t *t = &sys->tk[i];
-
-            if (!tk || tk->date > t->date)
+            if (!b_aseek)
             {
-                tk = t;
-                i_tk_idx = i;
+                msg_Warn(s, "cannot seek back to %"PRIu64, offset);
+                return VLC_EGENERIC;
             }
-        }
-    }
-    assert(i_tk_idx >= 0 && i_tk_idx < STREAM_CACHE_TRACK);
-
-    if (tk != p_current)
-        i_skip_threshold = 0;
-    if (tk->i_start <= i_pos && i_pos <= tk->i_end + i_skip_threshold)
-    {
 #ifdef STREAM_DEBUG
-        msg_Err(s, "AStreamSeekStream: reusing %d start=%"PRId64
-                 " end=%"PRId64"(%s)",
-                 i_tk_idx, tk->i_start, tk->i_end,
-                 tk != p_current ? "seek" : i_pos > tk->i_end ? "skip" : "noseek");
+            msg_Dbg(s, "hard seek from %"PRIu64" to %"PRIu64,
+                    sys->i_upstream, offset);
 #endif
-        if (tk != p_current)
-        {
-            assert(b_aseek);
-
-            /* Seek at the end of the buffer
-             * TODO it is stupid to seek now, it would be better to delay it
-             */
-            if (vlc_stream_Seek(s->s, tk->i_end))
+            if (vlc_stream_Seek(s->s, offset))
             {
-                msg_Err(s, "AStreamSeekStream: hard seek failed");
+                msg_Err(s, "hard seek failed");
                 return VLC_EGENERIC;
             }
-        }
-        else if (i_pos > tk->i_end)
-        {
-            uint64_t i_skip = i_pos - tk->i_end;
-            while (i_skip > 0)
-            {
-                const int i_read_max = __MIN(10 * STREAM_READ_ATONCE, i_skip);
-                int i_read = 0;
-                if ((i_read = AStreamReadStream(s, NULL, i_read_max)) < 0)
-                {
-                    msg_Err(s, "AStreamSeekStream: skip failed");
-                    return VLC_EGENERIC;
-                } else if (i_read == 0)
-                    return VLC_SUCCESS; /* EOF */
-                i_skip -= i_read_max;
-            }
+            sys->i_upstream = offset;
+            sys->stat.i_seeks++;
         }
     }
-    else
-    {
+
+    /* Coalesce the missing blocks in one upstream request: the read-ahead,
+     * or what the reader asked for */
+    unsigned max = __MIN(STREAM_CACHE_RUN_MAX, __MAX(sys->i_mem_max / 2, 1));
+    unsigned run = __MIN(__MAX(ReadAheadSize(sys, index, max),
+                               (length + size + STREAM_CACHE_BLOCK_SIZE - 1)
+                               / STREAM_CACHE_BLOCK_SIZE), max);
+    unsigned count = 1;
+
+    while (count < run && BlockLookup(sys, index + count) == NULL)
+        count++;
+
 #ifdef STREAM_DEBUG
-        msg_Err(s, "AStreamSeekStream: hard seek");
+    msg_Dbg(s, "fetching %u blocks from %"PRIu64, count, offset);
 #endif
-        /* Nothing good, seek and choose oldest segment */
-        if (vlc_stream_Seek(s->s, i_pos))
-        {
-            msg_Err(s, "AStreamSeekStream: hard seek failed");
-            return VLC_EGENERIC;
-        }
 
-        tk->i_start = i_pos;
-        tk->i_end   = i_pos;
+    if (UpstreamRead(s, count * STREAM_CACHE_BLOCK_SIZE - length,
+                     min - length) < 0)
+        return VLC_EGENERIC;
+
+    sys->stat.i_read_time += vlc_tick_now() - start;
+    return VLC_SUCCESS;
+}
+
+/****************************************************************************
+ * Stream callbacks
+ ****************************************************************************/
+static ssize_t AStreamReadStream(stream_t *s, void *buf, size_t len)
+{
+    stream_sys_t *sys = s->p_sys;
+    uint64_t index = sys->i_pos / STREAM_CACHE_BLOCK_SIZE;
+    unsigned offset = sys->i_pos % STREAM_CACHE_BLOCK_SIZE;
+    struct cache_block *b = BlockLookup(sys, index);
+
+    sys->stat.i_read_count++;
+
+    if (b != NULL && offset < b->length)
+    {
+        if (b->data == NULL && BlockLoad(s, b))
+            b = NULL;
+        else
+            sys->stat.i_hits++;
     }
-    sys->i_offset = i_pos - tk->i_start;
-    sys->i_tk = i_tk_idx;
-    sys->i_pos = i_pos;
 
-    /* If there is not enough data left in the track, refill  */
-    /* TODO How to get a correct value for
-     *    - refilling threshold
-     *    - how much to refill
-     */
-    if (tk->i_end < tk->i_start + sys->i_offset + sys->i_read_size)
+    if (b == NULL || offset >= b->length)
     {
-        if (sys->i_used < STREAM_READ_ATONCE / 2)
-            sys->i_used = STREAM_READ_ATONCE / 2;
+        if (Fetch(s, index, offset + 1, len))
+            return -1;
+
+        b = BlockLookup(sys, index);
+        if (b == NULL || offset >= b->length)
+            return 0; /* EOF */
+        assert(b->data != NULL);
+    }
+
+    size_t copy = __MIN(len, b->length - offset);
+
+#ifdef STREAM_DEBUG
+    msg_Dbg(s, "AStreamReadStream: %zu pos=%"PRIu64" block=%"PRIu64
+            " length=%u", len, sys->i_pos, index, b->length);
+#endif
+
+    if (buf != NULL)
+        memcpy(buf, b->data + offset, copy);
+    BlockTouch(sys, b);
+    sys->i_pos += copy;
+    return copy;
+}
+
+static int AStreamSeekStream(stream_t *s, uint64_t i_pos)
+{
+    stream_sys_t *sys = s->p_sys;
 
-        if (AStreamRefillStream(s))
+    if (i_pos < sys->i_upstream)
+    {
+        struct cache_block *b = BlockLookup(sys,
+                                            i_pos / STREAM_CACHE_BLOCK_SIZE);
+        bool b_aseek;
+
+        if ((b == NULL || i_pos % STREAM_CACHE_BLOCK_SIZE >= b->length)
+         && (vlc_stream_Control(s->s, STREAM_CAN_SEEK, &b_aseek) || !b_aseek))
+        {
+            msg_Warn(s, "AStreamSeekStream: can't seek");
             return VLC_EGENERIC;
+        }
     }
+
+    /* The upstream seek, if any, is delayed until data is missing */
+    sys->i_pos = i_pos;
     return VLC_SUCCESS;
 }
 
+/****************************************************************************
+ * AStreamControlReset:
+ ****************************************************************************/
+static void AStreamControlReset(stream_t *s)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    BlockFlush(sys);
+    sys->i_pos = 0;
+    sys->i_upstream = 0;
+}
+
 /****************************************************************************
  * AStreamControl:
  ****************************************************************************/
@@ -464,6 +683,7 @@ static int AStreamControl(stream_t *s, int i_query, va_list args)
         case STREAM_GET_SIGNAL:
         case STREAM_GET_TAGS:
         case STREAM_GET_TYPE:
+        case STREAM_GET_PREFETCH_STATS:
         case STREAM_SET_PAUSE_STATE:
         case STREAM_SET_PRIVATE_ID_STATE:
         case STREAM_SET_PRIVATE_ID_CA:
@@ -488,6 +708,24 @@ static int AStreamControl(stream_t *s, int i_query, va_list args)
     return VLC_SUCCESS;
 }
 
+static void Release(stream_sys_t *sys)
+{
+    BlockFlush(sys);
+    vlc_vector_destroy(&sys->free_slots);
+    free(sys->p_buffer);
+
+    if (sys->fd != -1)
+    {
+        vlc_close(sys->fd);
+        if (sys->psz_file != NULL)
+        {
+            vlc_unlink(sys->psz_file);
+            free(sys->psz_file);
+        }
+    }
+    free(sys);
+}
+
 static int Open(vlc_object_t *obj)
 {
     stream_t *s = (stream_t *)obj;
@@ -499,51 +737,63 @@ static int Open(vlc_object_t *obj)
     if (unlikely(sys == NULL))
         return VLC_ENOMEM;
 
-    /* Common field */
-    sys->i_pos = 0;
+    sys->i_pos = vlc_stream_Tell(s->s);
+    sys->i_upstream = sys->i_pos;
+
+    sys->p_index = NULL;
+    sys->i_blocks = 0;
+    vlc_list_init(&sys->mem_lru);
+    vlc_list_init(&sys->disk_lru);
+    vlc_vector_init(&sys->free_slots);
+    sys->i_mem = 0;
+    sys->i_mem_max = __MAX(1, (var_InheritInteger(s, "cache-read-memory")
+                               << 10) / STREAM_CACHE_BLOCK_SIZE);
+    sys->p_buffer = NULL;
+    sys->i_buffer = 0;
+
+    sys->fd = -1;
+    sys->psz_file = NULL;
+    sys->i_slots = 0;
+    sys->i_slots_max = __MIN((var_InheritInteger(s, "cache-read-disk")
+                              << 20) / STREAM_CACHE_BLOCK_SIZE, UINT32_MAX);
 
     /* Stats */
-    sys->stat.i_bytes = 0;
-    sys->stat.i_read_time = 0;
-    sys->stat.i_read_count = 0;
-
-    msg_Dbg(s, "Using stream method for AStream*");
+    memset(&sys->stat, 0, sizeof (sys->stat));
 
-    /* Allocate/Setup our tracks */
-    sys->i_offset = 0;
-    sys->i_tk     = 0;
-    sys->p_buffer = malloc(STREAM_CACHE_SIZE);
-    if (sys->p_buffer == NULL)
-    {
-        free(sys);
-        return VLC_ENOMEM;
-    }
-
-    sys->i_used   = 0;
-    sys->i_read_size = STREAM_READ_ATONCE;
-    static_assert (STREAM_READ_ATONCE >= 256,
-                   "Invalid STREAM_READ_ATONCE value");
+    s->p_sys = sys;
 
-    for (unsigned i = 0; i < STREAM_CACHE_TRACK; i++)
+    if (sys->i_slots_max > 0)
     {
-        sys->tk[i].date  = 0;
-        sys->tk[i].i_start = sys->i_pos;
-        sys->tk[i].i_end   = sys->i_pos;
-        sys->tk[i].p_buffer = &sys->p_buffer[i * STREAM_CACHE_TRACK_SIZE];
+        sys->fd = GetTmpFile(&sys->psz_file);
+        if (sys->fd == -1)
+            msg_Warn(s, "cannot create cache file: %s",
+                     vlc_strerror_c(errno));
+#ifndef _WIN32
+        else
+        {
+            vlc_unlink(sys->psz_file);
+            free(sys->psz_file);
+            sys->psz_file = NULL;
+        }
+#endif
     }
 
-    s->p_sys = sys;
-
-    /* Do the prebuffering */
-    AStreamPrebufferStream(s);
+    msg_Dbg(s, "using %zu KiB of memory%s, %u KiB blocks",
+            (sys->i_mem_max * STREAM_CACHE_BLOCK_SIZE) >> 10,
+            sys->fd != -1 ? " and a spill file" : "",
+            STREAM_CACHE_BLOCK_SIZE >> 10);
 
-    if (sys->tk[sys->i_tk].i_end <= 0)
+    /* Fetch the first block for demux probing */
+    vlc_tick_t start = vlc_tick_now();
+    if (Fetch(s, sys->i_pos / STREAM_CACHE_BLOCK_SIZE, 1, 0)
+     || sys->i_blocks == 0)
     {
         msg_Err(s, "cannot pre fill buffer");
-        free(sys->p_buffer);
-        free(sys);
+        Release(sys);
         return VLC_EGENERIC;
     }
+    msg_Dbg(s, "received first data after %"PRId64" ms",
+            MS_FROM_VLC_TICK(vlc_tick_now() - start));
 
     s->pf_read = AStreamReadStream;
     s->pf_seek = AStreamSeekStream;
@@ -559,8 +809,13 @@ static void Close(vlc_object_t *obj)
     stream_t *s = (stream_t *)obj;
     stream_sys_t *sys = s->p_sys;
 
-    free(sys->p_buffer);
-    free(sys);
+    msg_Dbg(s, "%"PRIu64" reads, %"PRIu64" hits, %"PRIu64" upstream "
+            "requests, %"PRIu64" seeks, %"PRIu64" KiB in %"PRId64" ms, "
+            "%"PRIu64" spills, %"PRIu64" loads", sys->stat.i_read_count,
+            sys->stat.i_hits, sys->stat.i_requests, sys->stat.i_seeks,
+            sys->stat.i_bytes >> 10, MS_FROM_VLC_TICK(sys->stat.i_read_time),
+            sys->stat.i_spills, sys->stat.i_loads);
+    Release(sys);
 }
 
 vlc_module_begin()
@@ -570,4 +825,14 @@ vlc_module_begin()
 
     set_description(N_("Byte stream cache"))
     set_callbacks(Open, Close)
+
+    add_integer("cache-read-memory", STREAM_CACHE_SIZE, N_("Memory size"),
+                N_("Maximum memory used to retain the data read from the "
+                   "stream (KiB)."))
+        change_integer_range(32, 1 << 22)
+    add_integer("cache-read-disk", 0, N_("Disk size"),
+                N_("Maximum size of the temporary file holding the data "
+                   "evicted from memory (MiB). Zero keeps the data in "
+                   "memory only."))
+        change_integer_range(0, 1 << 20)
 vlc_module_end()
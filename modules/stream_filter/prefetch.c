@@ -34,6 +34,20 @@
 #include <vlc_stream.h>
 #include <vlc_fs.h>
 #include <vlc_interrupt.h>
+#include <vlc_tick.h>
+
+/* The buffer starts small, then adapts to the consumption rate, so that it
+ * covers the longest of the following durations: the PTS delay,
+ * PREFETCH_HORIZON or PREFETCH_LATENCY_FACTOR times the upstream latency. */
+#define PREFETCH_MIN_SIZE       (256 << 10)
+#define PREFETCH_HORIZON        VLC_TICK_FROM_SEC(4)
+#define PREFETCH_LATENCY_FACTOR 16
+/* Upstream read requests cover at least PREFETCH_READ_PERIOD of consumption
+ * or twice the upstream latency, and at least PREFETCH_MIN_READ bytes. */
+#define PREFETCH_MIN_READ       (64 << 10)
+#define PREFETCH_READ_PERIOD    VLC_TICK_FROM_MS(100)
+/* Consumption rate sampling period */
+#define PREFETCH_RATE_WINDOW    VLC_TICK_FROM_MS(500)
 
 struct stream_ctrl
 {
@@ -73,9 +87,28 @@ typedef struct
     uint64_t     stream_offset;
     size_t       buffer_length;
     size_t       buffer_size;
+    size_t       buffer_max;
     char        *buffer;
+    size_t       read_size;
     size_t       seek_threshold;
 
+    /* Consumption rate and upstream latency estimation */
+    vlc_tick_t   rate_date;
+    vlc_tick_t   rate_stall;
+    uint64_t     rate_bytes;
+    uint64_t     rate; /**< bytes per second */
+    vlc_tick_t   latency;
+
+    struct
+    {
+        unsigned long reads;
+        unsigned long hits;
+        unsigned long stalls;
+        unsigned long seeks;
+        vlc_tick_t    stall;
+        size_t        peak_size;
+    } stats;
+
     struct stream_ctrl *controls;
 } stream_sys_t;
 
@@ -86,9 +119,13 @@ static ssize_t ThreadRead(stream_t *stream, void *buf, size_t length)
     vlc_mutex_unlock(&sys->lock);
     assert(length > 0);
 
+    vlc_tick_t start = vlc_tick_now();
     ssize_t val = vlc_stream_ReadPartial(stream->s, buf, length);
+    vlc_tick_t latency = vlc_tick_now() - start;
 
     vlc_mutex_lock(&sys->lock);
+    if (val > 0)
+        sys->latency = (7 * sys->latency + latency) / 8;
     return val;
 }
 
@@ -103,6 +140,7 @@ static int ThreadSeek(stream_t *stream, uint64_t seek_offset)
         msg_Err(stream, "cannot seek (to offset %"PRIu64")", seek_offset);
 
     vlc_mutex_lock(&sys->lock);
+    sys->stats.seeks++;
 
     return (val == VLC_SUCCESS) ? 0 : -1;
 }
@@ -124,6 +162,107 @@ static int ThreadControl(stream_t *stream, int query, ...)
     return ret;
 }
 
+/**
+ * Reallocates the circular buffer, retaining the unread data and as much
+ * historical data as fits.
+ */
+static int Resize(stream_t *stream, size_t size)
+{
+    stream_sys_t *sys = stream->p_sys;
+    uint64_t offset = sys->buffer_offset;
+    size_t length = sys->buffer_length;
+
+    if (length > size)
+    {   /* Discard the oldest data */
+        offset += length - size;
+        length = size;
+    }
+
+    char *buffer = malloc(size);
+    if (unlikely(buffer == NULL))
+        return -1;
+
+    for (uint64_t pos = offset; pos < offset + length;)
+    {
+        size_t from = pos % sys->buffer_size, to = pos % size;
+        size_t copy = offset + length - pos;
+
+        /* Do not step past the sharp edges of either circular buffer */
+        if (copy > sys->buffer_size - from)
+            copy = sys->buffer_size - from;
+        if (copy > size - to)
+            copy = size - to;
+
+        memcpy(buffer + to, sys->buffer + from, copy);
+        pos += copy;
+    }
+
+    msg_Dbg(stream, "buffer size: %zu -> %zu bytes (rate: %"PRIu64" B/s, "
+            "latency: %"PRId64" us)", sys->buffer_size, size, sys->rate,
+            US_FROM_VLC_TICK(sys->latency));
+
+    free(sys->buffer);
+    sys->buffer = buffer;
+    sys->buffer_size = size;
+    sys->buffer_offset = offset;
+    sys->buffer_length = length;
+    if (size > sys->stats.peak_size)
+        sys->stats.peak_size = size;
+    return 0;
+}
+
+/**
+ * Adapts the buffer and read request sizes to the consumption rate and to
+ * the upstream latency.
+ */
+static void Adapt(stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    if (sys->rate == 0)
+    {   /* Not measured yet: start with small requests to get the first
+         * data quickly, then grow them to fill the buffer quickly. */
+        if (sys->read_size < sys->buffer_size / 2)
+            sys->read_size *= 2;
+        return;
+    }
+
+    vlc_tick_t horizon = __MAX(sys->pts_delay, PREFETCH_HORIZON);
+    horizon = __MAX(horizon, PREFETCH_LATENCY_FACTOR * sys->latency);
+
+    /* Read-ahead data, plus the retained historical data (1/8) */
+    uint64_t target = sys->rate * horizon / CLOCK_FREQ * 8 / 7;
+    size_t size = PREFETCH_MIN_SIZE;
+
+    /* Power of two sizes provide some hysteresis */
+    while (size < target && size < sys->buffer_max)
+        size *= 2;
+    if (size > sys->buffer_max)
+        size = sys->buffer_max;
+
+    size_t unread = 0;
+    if (sys->stream_offset >= sys->buffer_offset
+     && sys->stream_offset - sys->buffer_offset < sys->buffer_length)
+        unread = sys->buffer_offset + sys->buffer_length - sys->stream_offset;
+
+    if (size > sys->buffer_size
+     || (size <= sys->buffer_size / 4 && unread <= size))
+        Resize(stream, size);
+
+    /* Request enough data at once to keep up with the consumption despite
+     * the latency of every request. The latency includes the transfer, so
+     * this only converges if the bandwidth is twice the consumption rate;
+     * otherwise the buffer size bounds the requests anyway. */
+    vlc_tick_t period = __MAX(PREFETCH_READ_PERIOD, 2 * sys->latency);
+    uint64_t read_size = sys->rate * period / CLOCK_FREQ;
+
+    if (read_size < PREFETCH_MIN_READ)
+        read_size = PREFETCH_MIN_READ;
+    if (read_size > __MAX(sys->buffer_size / 4, 1))
+        read_size = __MAX(sys->buffer_size / 4, 1);
+    sys->read_size = read_size;
+}
+
 static void *Thread(void *data)
 {
     vlc_thread_set_name("vlc-prefetch");
@@ -226,19 +365,30 @@ static void *Thread(void *data)
         size_t len = sys->buffer_size - sys->buffer_length;
         if (len == 0)
         {   /* Buffer is full */
-            if (history == 0)
+            /* Keep the most recent historical data, so that short backward
+             * seeks, as done by many demuxers, do not reach upstream. */
+            size_t retain = sys->buffer_size / 8;
+
+            if (history <= retain)
             {   /* Wait for data to be read */
                 vlc_cond_wait(&sys->wait_space, &sys->lock);
                 continue;
             }
 
             /* Discard some historical data to make room. */
-            len = history > sys->buffer_length ? sys->buffer_length : history;
+            len = history - retain;
+            if (history > sys->buffer_length)
+                len = sys->buffer_length;
+            if (len > sys->read_size)
+                len = sys->read_size;
 
             sys->buffer_offset += len;
             sys->buffer_length -= len;
         }
 
+        if (len > sys->read_size)
+            len = sys->read_size;
+
         size_t offset = (sys->buffer_offset + sys->buffer_length)
                         % sys->buffer_size;
          /* Do not step past the sharp edge of the circular buffer */
@@ -261,6 +411,7 @@ static void *Thread(void *data)
         //msg_Dbg(stream, "buffer: %zu/%zu", sys->buffer_length,
         //        sys->buffer_size);
         vlc_cond_signal(&sys->wait_data);
+        Adapt(stream);
     }
 
     sys->error = true;
@@ -314,6 +465,10 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
         vlc_cond_signal(&sys->wait_space);
     }
 
+    vlc_tick_t stall = VLC_TICK_INVALID;
+
+    sys->stats.reads++;
+
     while ((copy = BufferLevel(stream, &eof)) == 0 && !eof)
     {
         void *data[2];
@@ -324,11 +479,25 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
             return 0;
         }
 
+        if (stall == VLC_TICK_INVALID)
+            stall = vlc_tick_now();
+
         vlc_interrupt_forward_start(sys->interrupt, data);
         vlc_cond_wait(&sys->wait_data, &sys->lock);
         vlc_interrupt_forward_stop(data);
     }
 
+    vlc_tick_t now = vlc_tick_now();
+
+    if (stall != VLC_TICK_INVALID)
+    {
+        sys->stats.stalls++;
+        sys->stats.stall += now - stall;
+        sys->rate_stall += now - stall;
+    }
+    else
+        sys->stats.hits++;
+
     offset = sys->stream_offset % sys->buffer_size;
     if (copy > buflen)
         copy = buflen;
@@ -338,6 +507,27 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
 
     memcpy(buf, sys->buffer + offset, copy);
     sys->stream_offset += copy;
+
+    /* The first sample is taken sooner, so as to size the buffer soon */
+    vlc_tick_t window = sys->rate ? PREFETCH_RATE_WINDOW
+                                  : PREFETCH_RATE_WINDOW / 4;
+
+    sys->rate_bytes += copy;
+    if (now - sys->rate_date >= window)
+    {
+        vlc_tick_t elapsed = now - sys->rate_date;
+        /* Waiting for upstream does not count toward the consumption rate,
+         * but only up to half of the period, lest a stall inflates it. */
+        elapsed -= __MIN(sys->rate_stall, elapsed / 2);
+
+        uint64_t rate = sys->rate_bytes * CLOCK_FREQ / elapsed;
+
+        sys->rate = sys->rate ? (3 * sys->rate + rate) / 4 : rate;
+        sys->rate_date = now;
+        sys->rate_stall = 0;
+        sys->rate_bytes = 0;
+    }
+
     vlc_cond_signal(&sys->wait_space);
     vlc_mutex_unlock(&sys->lock);
     return copy;
@@ -388,12 +578,31 @@ static int Control(stream_t *stream, int query, va_list args)
         case STREAM_GET_TAGS:
         case STREAM_GET_TYPE:
             return VLC_EGENERIC;
+        case STREAM_GET_PREFETCH_STATS:
+        {
+            struct vlc_stream_prefetch_stats *stats =
+                va_arg(args, struct vlc_stream_prefetch_stats *);
+
+            vlc_mutex_lock(&sys->lock);
+            stats->buffer_size = sys->buffer_size;
+            stats->reads = sys->stats.reads;
+            stats->hits = sys->stats.hits;
+            stats->stalls = sys->stats.stalls;
+            stats->stall_time = sys->stats.stall;
+            stats->seeks = sys->stats.seeks;
+            vlc_mutex_unlock(&sys->lock);
+            break;
+        }
         case STREAM_SET_PAUSE_STATE:
         {
             bool paused = va_arg(args, unsigned);
 
             vlc_mutex_lock(&sys->lock);
             sys->paused = paused;
+            /* Do not account the pause in the consumption rate */
+            sys->rate_date = vlc_tick_now();
+            sys->rate_stall = 0;
+            sys->rate_bytes = 0;
             vlc_cond_signal(&sys->wait_space);
             vlc_mutex_unlock (&sys->lock);
             break;
@@ -470,17 +679,27 @@ static int Open(vlc_object_t *obj)
     sys->buffer_offset = 0;
     sys->stream_offset = 0;
     sys->buffer_length = 0;
-    sys->buffer_size = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
+    sys->buffer_max = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
     sys->seek_threshold = var_InheritInteger(obj, "prefetch-seek-threshold");
+    sys->rate_date = vlc_tick_now();
+    sys->rate_stall = 0;
+    sys->rate_bytes = 0;
+    sys->rate = 0;
+    sys->latency = 0;
+    memset(&sys->stats, 0, sizeof (sys->stats));
     sys->controls = NULL;
 
     uint64_t size = stream_Size(stream->s);
     if (size > 0)
     {   /* No point allocating a buffer larger than the source stream */
-        if (sys->buffer_size > size)
-            sys->buffer_size = size;
+        if (sys->buffer_max > size)
+            sys->buffer_max = size;
     }
 
+    sys->buffer_size = __MIN(PREFETCH_MIN_SIZE, sys->buffer_max);
+    sys->read_size = __MIN(PREFETCH_MIN_READ, sys->buffer_size);
+    sys->stats.peak_size = sys->buffer_size;
+
     sys->buffer = malloc(sys->buffer_size);
     if (sys->buffer == NULL)
         goto error;
@@ -501,7 +720,8 @@ static int Open(vlc_object_t *obj)
         goto error;
     }
 
-    msg_Dbg(stream, "using %zu bytes buffer", sys->buffer_size);
+    msg_Dbg(stream, "using %zu bytes buffer (up to %zu bytes)",
+            sys->buffer_size, sys->buffer_max);
     stream->pf_read = Read;
     stream->pf_seek = Seek;
     stream->pf_control = Control;
@@ -531,6 +751,14 @@ static void Close (vlc_object_t *obj)
     vlc_join(sys->thread, NULL);
     vlc_interrupt_destroy(sys->interrupt);
 
+    msg_Dbg(stream, "%lu reads, %lu served from buffer (%.1f%%), "
+            "%lu stalls (%"PRId64" ms), %lu upstream seeks, buffer size: %zu "
+            "bytes (peak: %zu bytes)", sys->stats.reads, sys->stats.hits,
+            sys->stats.reads ? 100. * sys->stats.hits / sys->stats.reads : 0.,
+            sys->stats.stalls, MS_FROM_VLC_TICK(sys->stats.stall),
+            sys->stats.seeks,
+            sys->buffer_size, sys->stats.peak_size);
+
     while(sys->controls)
     {
         struct stream_ctrl *ctrl = sys->controls;
@@ -550,7 +778,8 @@ vlc_module_begin()
     set_callbacks(Open, Close)
 
     add_integer("prefetch-buffer-size", 1 << 14, N_("Buffer size"),
-                N_("Prefetch buffer size (KiB)"))
+                N_("Maximum prefetch buffer size (KiB). The buffer size "
+                   "adapts to the consumption rate up to this value."))
         change_integer_range(4, 1 << 20)
     add_obsolete_integer("prefetch-read-size") /* since 4.0.0 */
     add_integer("prefetch-seek-threshold", 1 << 14, N_("Seek threshold"),
@@ -0,0 +1,233 @@
+/*****************************************************************************
+ * dgram.c: batched and paced datagram output helpers
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+#include <vlc_sout.h>
+#ifdef HAVE_SENDMMSG
+# include <netinet/udp.h>
+#endif
+
+#include "dgram.h"
+
+void sout_dgram_Init(struct sout_dgram *dg, int fd, bool gso)
+{
+    dg->fd = fd;
+#ifdef UDP_SEGMENT
+    dg->gso = gso;
+#else
+    dg->gso = false;
+    (void) gso;
+#endif
+    memset(&dg->stats, 0, sizeof (dg->stats));
+}
+
+#ifdef UDP_SEGMENT
+static size_t MsgLength(const struct msghdr *msg)
+{
+    size_t len = 0;
+
+    for (size_t i = 0; i < (size_t)msg->msg_iovlen; i++)
+        len += msg->msg_iov[i].iov_len;
+    return len;
+}
+
+/* Theoretical maximum payload of a single (offloaded) UDP send */
+# define GSO_MAX_SIZE 65507u
+/* Maximum number of segments the kernel accepts per send */
+# define GSO_MAX_SEGS 64u
+
+/**
+ * Sends the leading run of equally-sized datagrams with a single
+ * segmentation offload call.
+ *
+ * \return the number of datagrams sent, 0 if offloading does not apply,
+ * or -1 on error
+ */
+static int SendSegments(struct sout_dgram *dg, const struct msghdr *msgv,
+                        unsigned msgc)
+{
+    struct iovec iov[256];
+    size_t segsize = MsgLength(&msgv[0]);
+    size_t total = 0, iovc = 0;
+    unsigned count = 0;
+
+    if (segsize == 0)
+        return 0;
+
+    while (count < msgc && count < GSO_MAX_SEGS)
+    {
+        const struct msghdr *msg = &msgv[count];
+        size_t len = MsgLength(msg);
+
+        if (len > segsize || len == 0 || total + len > GSO_MAX_SIZE
+         || iovc + msg->msg_iovlen > ARRAY_SIZE(iov))
+            break;
+
+        memcpy(iov + iovc, msg->msg_iov, msg->msg_iovlen * sizeof (*iov));
+        iovc += msg->msg_iovlen;
+        total += len;
+        count++;
+
+        if (len < segsize) /* only the last segment can be shorter */
+            break;
+    }
+
+    if (count < 2)
+        return 0;
+
+    union {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr hdr = {
+        .msg_name = msgv[0].msg_name,
+        .msg_namelen = msgv[0].msg_namelen,
+        .msg_iov = iov,
+        .msg_iovlen = iovc,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+    uint16_t gso_size = segsize;
+
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (gso_size));
+    memcpy(CMSG_DATA(cmsg), &gso_size, sizeof (gso_size));
+
+    dg->stats.calls++;
+    if (sendmsg(dg->fd, &hdr, 0) < 0)
+    {
+        switch (errno)
+        {
+            case EINVAL:
+            case EIO:
+            case ENOPROTOOPT:
+            case EOPNOTSUPP:
+                /* Not supported by the kernel, socket or device */
+                dg->gso = false;
+                return 0;
+        }
+        return -1;
+    }
+
+    dg->stats.packets += count;
+    dg->stats.bytes += total;
+    return count;
+}
+#endif
+
+int sout_dgram_Send(struct sout_dgram *dg, const struct msghdr *msgv,
+                    unsigned msgc)
+{
+    unsigned sent = 0;
+
+    assert(msgc <= SOUT_DGRAM_BATCH_MAX);
+
+    while (sent < msgc)
+    {
+        int val;
+
+#ifdef UDP_SEGMENT
+        if (dg->gso && msgc - sent > 1)
+        {
+            val = SendSegments(dg, msgv + sent, msgc - sent);
+            if (val > 0)
+            {
+                sent += val;
+                continue;
+            }
+            if (val < 0)
+                goto error;
+        }
+#endif
+#ifdef HAVE_SENDMMSG
+        struct mmsghdr mmsg[SOUT_DGRAM_BATCH_MAX];
+        unsigned count = msgc - sent;
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            mmsg[i].msg_hdr = msgv[sent + i];
+            mmsg[i].msg_len = 0;
+        }
+
+        dg->stats.calls++;
+        val = sendmmsg(dg->fd, mmsg, count, 0);
+        if (val <= 0)
+            goto error;
+
+        for (int i = 0; i < val; i++)
+            dg->stats.bytes += mmsg[i].msg_len;
+#else
+        dg->stats.calls++;
+
+        ssize_t len = sendmsg(dg->fd, &msgv[sent], 0);
+        if (len < 0)
+            goto error;
+
+        dg->stats.bytes += len;
+        val = 1;
+#endif
+        dg->stats.packets += val;
+        sent += val;
+    }
+    return sent;
+
+error:
+    return (sent > 0) ? (int)sent : -1;
+}
+
+void sout_dgram_Report(struct sout_stream_stats *restrict out,
+                       const struct sout_dgram_stats *restrict stats)
+{
+    out->sent_packets += stats->packets;
+    out->sent_bytes += stats->bytes;
+    out->send_calls += stats->calls;
+    out->paced_packets += stats->paced;
+    if (stats->slip_max > out->slip_max)
+        out->slip_max = stats->slip_max;
+}
+
+void sout_pacer_Init(struct sout_pacer *pacer, uint64_t rate, size_t burst)
+{
+    pacer->rate = rate;
+    pacer->depth = rate ? vlc_tick_from_frac(burst * 8, rate) : 0;
+    pacer->next = VLC_TICK_INVALID;
+}
+
+void sout_pacer_Consume(struct sout_pacer *pacer, size_t bytes,
+                        vlc_tick_t now)
+{
+    if (pacer->rate == 0)
+        return;
+
+    pacer->next = sout_pacer_When(pacer, now)
+                + vlc_tick_from_frac(bytes * 8, pacer->rate);
+}
+
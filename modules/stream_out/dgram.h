@@ -0,0 +1,142 @@
+/*****************************************************************************
+ * dgram.h: batched and paced datagram output helpers
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SOUT_DGRAM_H
+#define VLC_SOUT_DGRAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vlc_tick.h>
+
+/** Maximum number of datagrams handed to the kernel at once */
+#define SOUT_DGRAM_BATCH_MAX 64
+
+struct msghdr;
+struct sout_stream_stats;
+
+/**
+ * Per-output transmission counters.
+ */
+struct sout_dgram_stats
+{
+    uint64_t calls; /**< send system calls */
+    uint64_t packets; /**< datagrams sent */
+    uint64_t bytes; /**< payload bytes sent */
+    uint64_t paced; /**< datagrams delayed by the pacer */
+    vlc_tick_t slip; /**< cumulated pacing slip */
+    vlc_tick_t slip_max; /**< worst pacing slip */
+};
+
+/**
+ * Datagram socket sender.
+ */
+struct sout_dgram
+{
+    int fd;
+    bool gso; /**< whether to try UDP segmentation offload */
+    struct sout_dgram_stats stats;
+};
+
+void sout_dgram_Init(struct sout_dgram *, int fd, bool gso);
+
+/**
+ * Sends a batch of datagrams.
+ *
+ * The datagrams are passed to the kernel with as few system calls as
+ * possible: a single segmentation offload send when they have the same size
+ * (except for the last one), or otherwise a sendmmsg() call.
+ *
+ * \param msgv datagrams to send
+ * \param msgc number of datagrams (at most SOUT_DGRAM_BATCH_MAX)
+ * \return the number of datagrams sent, or -1 on error if none were sent
+ * (errno is set accordingly)
+ */
+int sout_dgram_Send(struct sout_dgram *, const struct msghdr *msgv,
+                    unsigned msgc);
+
+/**
+ * Records the pacing slip of a datagram that was held back until its
+ * scheduled transmission time.
+ */
+static inline void sout_dgram_Slip(struct sout_dgram_stats *stats,
+                                   vlc_tick_t slip)
+{
+    if (slip < 0)
+        slip = 0;
+    stats->paced++;
+    stats->slip += slip;
+    if (slip > stats->slip_max)
+        stats->slip_max = slip;
+}
+
+/**
+ * Adds the counters of a closed output to cumulated counters.
+ */
+static inline void sout_dgram_Merge(struct sout_dgram_stats *restrict total,
+                                    const struct sout_dgram_stats *restrict stats)
+{
+    total->calls += stats->calls;
+    total->packets += stats->packets;
+    total->bytes += stats->bytes;
+    total->paced += stats->paced;
+    total->slip += stats->slip;
+    if (stats->slip_max > total->slip_max)
+        total->slip_max = stats->slip_max;
+}
+
+/**
+ * Adds transmission counters to stream output statistics.
+ */
+void sout_dgram_Report(struct sout_stream_stats *,
+                       const struct sout_dgram_stats *);
+
+/**
+ * Token bucket pacer.
+ *
+ * The bucket is expressed in time: each datagram pushes the virtual
+ * transmission time forward by its duration at the configured rate, and up
+ * to \p depth worth of unused time can be accumulated to absorb bursts.
+ */
+struct sout_pacer
+{
+    uint64_t rate; /**< bits per second, or 0 if disabled */
+    vlc_tick_t depth; /**< bucket depth */
+    vlc_tick_t next; /**< earliest transmission time of the next datagram */
+};
+
+void sout_pacer_Init(struct sout_pacer *, uint64_t rate, size_t burst);
+
+/**
+ * Gets the earliest time at which the next datagram can be sent.
+ */
+static inline vlc_tick_t sout_pacer_When(const struct sout_pacer *pacer,
+                                         vlc_tick_t now)
+{
+    if (pacer->next == VLC_TICK_INVALID || pacer->next < now - pacer->depth)
+        return now - pacer->depth;
+    return pacer->next;
+}
+
+/**
+ * Consumes tokens for a datagram sent at the given time.
+ */
+void sout_pacer_Consume(struct sout_pacer *, size_t bytes, vlc_tick_t now);
+
+#endif
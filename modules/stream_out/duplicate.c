@@ -117,6 +117,9 @@ static void PCRSelectorDel( sout_stream_t *stream, void *id )
 }
 static int PCRSelectorControl( sout_stream_t *stream, int query, va_list args )
 {
+    /* The shared sink is queried once by the duplicate stream itself */
+    if( query == SOUT_STREAM_GET_STATS )
+        return VLC_EGENERIC;
     return sout_StreamControlVa( stream->p_next, query, args );
 }
 static int PCRSelectorSend( sout_stream_t *stream,
@@ -197,10 +200,23 @@ static int Control( sout_stream_t *p_stream, int i_query, va_list args )
             }
             return VLC_SUCCESS;
         }
+
+        case SOUT_STREAM_GET_STATS:
+        {
+            struct sout_stream_stats *stats =
+                va_arg(args, struct sout_stream_stats *);
+            sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+            duplicated_stream_t *dup_stream;
+            vlc_vector_foreach_ref( dup_stream, &p_sys->streams )
+                sout_StreamControl( dup_stream->stream, i_query, stats );
+            if( p_stream->p_next != NULL )
+                sout_StreamControl( p_stream->p_next, i_query, stats );
+            return VLC_SUCCESS;
+        }
     }
 
     return VLC_EGENERIC;
-    (void)p_stream;
 }
 
 /*****************************************************************************
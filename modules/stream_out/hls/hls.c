@@ -21,6 +21,8 @@
 #include "config.h"
 #endif
 
+#include <limits.h>
+
 #include <vlc_common.h>
 
 #include <vlc_block.h>
@@ -88,12 +90,23 @@ typedef struct hls_playlist
     const char *name;
     struct vlc_logger *logger;
 
+    /**
+     * Protects the manifest and the live edge, read by the HTTP server to
+     * answer the blocking playlist reloads.
+     */
+    vlc_mutex_t lock;
+
     /**
      * Current playlist manifest as in RFC 8216 section 4.3.3.
      */
     struct hls_storage *manifest;
     httpd_url_t *http_manifest;
 
+    /** ID of the segment being built, and count of its parts. */
+    unsigned int edge_segment;
+    unsigned int edge_part;
+    bool edge_ended;
+
     bool ended;
 
     /**
@@ -101,6 +114,13 @@ typedef struct hls_playlist
      */
     vlc_tick_t muxed_duration;
 
+    /**
+     * Low-latency segmentation: length of the last complete GOP, and of the
+     * current GOP so far. The muxed output holds the part being built.
+     */
+    vlc_tick_t gop_length;
+    vlc_tick_t gop_progress;
+
     struct vlc_list node;
 } hls_playlist_t;
 
@@ -167,27 +187,29 @@ typedef struct
             (i_##it == 0 ? &sys->variant_playlists : &sys->media_playlists),   \
             node)
 
-static int HTTPCallback(httpd_callback_sys_t *sys,
-                        httpd_client_t *client,
-                        httpd_message_t *answer,
-                        const httpd_message_t *query)
+static inline bool IsLowLatencyPlaylist(const hls_playlist_t *playlist)
 {
-    if (answer == NULL || query == NULL || client == NULL)
-        return VLC_SUCCESS;
-
-    struct hls_storage *storage = (struct hls_storage *)sys;
+    return playlist->type != HLS_PLAYLIST_TYPE_WEBVTT &&
+           hls_config_IsLowLatencyEnabled(playlist->config);
+}
 
-    httpd_MsgAdd(answer, "Content-Type", "%s", storage->mime);
+static void HTTPAnswer(httpd_message_t *answer,
+                       const httpd_message_t *query,
+                       block_t *content,
+                       const char *mime)
+{
+    httpd_MsgAdd(answer, "Content-Type", "%s", mime);
     httpd_MsgAdd(answer, "Cache-Control", "no-cache");
 
     answer->i_proto = HTTPD_PROTO_HTTP;
     answer->i_version = 0;
     answer->i_type = HTTPD_MSG_ANSWER;
 
-    const ssize_t size = storage->get_content(storage, &answer->p_body);
-    if (size != -1)
+    if (content != NULL)
     {
-        answer->i_body = size;
+        answer->p_body_block = content;
+        answer->p_body = content->p_buffer;
+        answer->i_body = content->i_buffer;
         answer->i_status = 200;
     }
     else
@@ -196,7 +218,94 @@ static int HTTPCallback(httpd_callback_sys_t *sys,
     if (httpd_MsgGet(query, "Connection") != NULL)
         httpd_MsgAdd(answer, "Connection", "close");
     httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
+}
+
+static int HTTPCallback(httpd_callback_sys_t *sys,
+                        httpd_client_t *client,
+                        httpd_message_t *answer,
+                        const httpd_message_t *query)
+{
+    if (answer == NULL || query == NULL || client == NULL)
+        return VLC_SUCCESS;
 
+    struct hls_storage *storage = (struct hls_storage *)sys;
+
+    /* The content is shared with the storage rather than copied. */
+    HTTPAnswer(answer, query, storage->get_content(storage), storage->mime);
+    return VLC_SUCCESS;
+}
+
+/**
+ * Parse the delivery directives of a blocking playlist reload, as in
+ * RFC 8216bis section 6.2.5.2.
+ *
+ * \retval true if the request asks for a future segment or part.
+ */
+static bool ParseBlockingReload(const char *args,
+                                unsigned int *msn,
+                                unsigned int *part)
+{
+    bool blocking = false;
+
+    *part = UINT_MAX;
+    for (const char *it = args; it != NULL; it = strchr(it, '&'))
+    {
+        if (*it == '&')
+            ++it;
+        if (sscanf(it, "_HLS_msn=%u", msn) == 1)
+            blocking = true;
+        else
+            sscanf(it, "_HLS_part=%u", part);
+    }
+    return blocking;
+}
+
+static int HTTPPlaylistCallback(httpd_callback_sys_t *sys,
+                                httpd_client_t *client,
+                                httpd_message_t *answer,
+                                const httpd_message_t *query)
+{
+    if (answer == NULL || query == NULL || client == NULL)
+        return VLC_SUCCESS;
+
+    hls_playlist_t *playlist = (hls_playlist_t *)sys;
+    unsigned int msn, part;
+
+    vlc_mutex_lock(&playlist->lock);
+    if (IsLowLatencyPlaylist(playlist) && !playlist->edge_ended &&
+        ParseBlockingReload((const char *)query->psz_args, &msn, &part))
+    {
+        if (msn > playlist->edge_segment + 1)
+        {
+            /* Too far in the future to be waited for. */
+            vlc_mutex_unlock(&playlist->lock);
+            answer->i_proto = HTTPD_PROTO_HTTP;
+            answer->i_version = 0;
+            answer->i_type = HTTPD_MSG_ANSWER;
+            answer->i_status = 400;
+            if (httpd_MsgGet(query, "Connection") != NULL)
+                httpd_MsgAdd(answer, "Connection", "close");
+            httpd_MsgAdd(answer, "Content-Length", "0");
+            return VLC_SUCCESS;
+        }
+
+        /* Segments are complete once the next one is being built, parts as
+         * soon as they are added. */
+        if (msn > playlist->edge_segment ||
+            (msn == playlist->edge_segment &&
+             (part == UINT_MAX || part >= playlist->edge_part)))
+        {
+            vlc_mutex_unlock(&playlist->lock);
+            return VLC_EAGAIN;
+        }
+    }
+
+    struct hls_storage *manifest = playlist->manifest;
+    const char *mime = manifest->mime;
+    block_t *content = manifest->get_content(manifest);
+    vlc_mutex_unlock(&playlist->lock);
+
+    HTTPAnswer(answer, query, content, mime);
     return VLC_SUCCESS;
 }
 
@@ -419,6 +528,19 @@ GeneratePlaylistManifest(const hls_playlist_t *playlist)
     // First version adding CMAF fragments support.
     MANIFEST_ADD_TAG("#EXT-X-VERSION:7");
 
+    const bool low_latency = IsLowLatencyPlaylist(playlist);
+    if (low_latency)
+    {
+        const double part_duration =
+            secf_from_vlc_tick(playlist->config->part_length);
+        MANIFEST_ADD_TAG("#EXT-X-SERVER-CONTROL:%sPART-HOLD-BACK=%.3f",
+                         (playlist->http_manifest != NULL)
+                             ? "CAN-BLOCK-RELOAD=YES,"
+                             : "",
+                         3 * part_duration);
+        MANIFEST_ADD_TAG("#EXT-X-PART-INF:PART-TARGET=%.3f", part_duration);
+    }
+
     const bool will_destroy_segments = playlist->config->max_segments == 0;
     if (playlist->ended)
         MANIFEST_ADD_TAG("#EXT-X-PLAYLIST-TYPE:VOD");
@@ -429,16 +551,40 @@ GeneratePlaylistManifest(const hls_playlist_t *playlist)
     MANIFEST_ADD_TAG("#EXT-X-MEDIA-SEQUENCE:%u",
                      (first_seg == NULL) ? 0u : first_seg->id);
 
+#define MANIFEST_ADD_PARTS(parts)                                              \
+    do                                                                         \
+    {                                                                          \
+        const hls_part_t *part;                                                \
+        hls_part_Foreach_const(parts, part)                                    \
+        {                                                                      \
+            MANIFEST_ADD_TAG("#EXT-X-PART:DURATION=%.3f,URI=\"%s\"%s",         \
+                             secf_from_vlc_tick(part->length),                 \
+                             part->url,                                        \
+                             part->independent ? ",INDEPENDENT=YES" : "");     \
+        }                                                                      \
+    } while (0)
+
     const hls_segment_t *segment;
     hls_segment_queue_Foreach_const(&playlist->segments, segment)
     {
+        MANIFEST_ADD_PARTS(&segment->parts);
         MANIFEST_ADD_TAG("#EXTINF:%.2f,", secf_from_vlc_tick(segment->length));
         MANIFEST_ADD_TAG("%s", segment->url);
     }
 
+    if (low_latency)
+    {
+        MANIFEST_ADD_PARTS(&playlist->segments.parts);
+        if (playlist->segments.hint != NULL && !playlist->ended)
+            MANIFEST_ADD_TAG("#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\"",
+                             playlist->segments.hint->url);
+    }
+
     if (playlist->ended)
         MANIFEST_ADD_TAG("#EXT-X-ENDLIST");
 
+#undef MANIFEST_ADD_PARTS
+
 #undef MANIFEST_ADD_TAG
 
     if (vlc_memstream_close(&out) != 0)
@@ -461,17 +607,20 @@ static int UpdatePlaylistManifest(hls_playlist_t *playlist)
     if (unlikely(new_manifest == NULL))
         return VLC_EGENERIC;
 
-    if (playlist->http_manifest != NULL)
-    {
-        httpd_UrlCatch(playlist->http_manifest,
-                       HTTPD_MSG_GET,
-                       HTTPCallback,
-                       (httpd_callback_sys_t *)new_manifest);
-    }
-
-    if (playlist->manifest != NULL)
-        hls_storage_Destroy(playlist->manifest);
+    vlc_mutex_lock(&playlist->lock);
+    struct hls_storage *old_manifest = playlist->manifest;
     playlist->manifest = new_manifest;
+    playlist->edge_segment = playlist->segments.total_segments;
+    playlist->edge_part = playlist->segments.part_count;
+    playlist->edge_ended = playlist->ended;
+    vlc_mutex_unlock(&playlist->lock);
+
+    if (old_manifest != NULL)
+        hls_storage_Destroy(old_manifest);
+
+    /* Answer the blocking reloads waiting for this update. */
+    if (playlist->http_manifest != NULL)
+        httpd_UrlSignal(playlist->http_manifest);
     return VLC_SUCCESS;
 }
 
@@ -624,6 +773,114 @@ static bool IsSegmentReady(enum hls_playlist_type type,
     return buffer->length >= seglen;
 }
 
+static int AddPart(hls_playlist_t *playlist,
+                   sout_stream_sys_t *sys,
+                   bool ends_segment)
+{
+    hls_block_chain_t part = playlist->muxed_output;
+    hls_block_chain_Reset(&playlist->muxed_output);
+
+    if (ends_segment && hls_config_IsMemStorageEnabled(&sys->config) &&
+        hls_segment_queue_IsAtMaxCapacity(&playlist->segments))
+    {
+        const hls_segment_t *to_be_removed =
+            hls_segment_GetFirst(&playlist->segments);
+        sys->current_memory_cached -=
+            hls_storage_GetSize(to_be_removed->storage);
+    }
+
+    const bool independent = IsSegmentSelfDecodable(&part);
+    const vlc_tick_t segment_length =
+        playlist->segments.parts_length + part.length;
+    /* The segment starts with its first part. */
+    const hls_part_t *first_part = vlc_list_first_entry_or_null(
+        &playlist->segments.parts, hls_part_t, priv_node);
+    const bool self_decodable =
+        (first_part != NULL) ? first_part->independent : independent;
+
+    const int status = hls_segment_queue_NewPart(&playlist->segments,
+                                                 part.begin,
+                                                 part.length,
+                                                 independent,
+                                                 ends_segment);
+    if (unlikely(status != VLC_SUCCESS))
+    {
+        vlc_error(playlist->logger,
+                  "Part creation failed in segment '%u'",
+                  playlist->segments.total_segments + 1);
+        return status;
+    }
+
+    if (ends_segment)
+    {
+        playlist->muxed_duration += segment_length;
+        if (!self_decodable)
+            vlc_warning(playlist->logger,
+                        "Segment '%u' does not start with a synchronization "
+                        "frame. It will not be decodable on its own.",
+                        playlist->segments.total_segments);
+        vlc_debug(playlist->logger,
+                  "Segment '%u' created",
+                  playlist->segments.total_segments);
+    }
+
+    return UpdatePlaylistManifest(playlist);
+}
+
+/**
+ * Low-latency segmentation: the muxed output is published in parts as soon as
+ * they reach the part length, and the segments end on the synchronization
+ * frames.
+ */
+static int AppendLowLatency(hls_playlist_t *playlist,
+                            sout_stream_sys_t *sys,
+                            block_t *chain)
+{
+    const struct hls_config *config = playlist->config;
+    hls_block_chain_t *part = &playlist->muxed_output;
+
+    while (chain != NULL)
+    {
+        block_t *block = chain;
+        chain = block->p_next;
+        block->p_next = NULL;
+
+        const vlc_tick_t segment_length =
+            playlist->segments.parts_length + part->length;
+        bool ends_segment = false;
+        if (block->i_flags & BLOCK_FLAG_HEADER)
+        {
+            /* End the segment here if the next GOP would not fit, supposing
+             * it is as long as the last one. */
+            playlist->gop_length = playlist->gop_progress;
+            playlist->gop_progress = 0;
+            ends_segment = segment_length + playlist->gop_length >
+                           config->segment_length;
+        }
+        /* Without a synchronization frame in time, the segment is cut
+         * anyway. */
+        if (segment_length + block->i_length > config->segment_length)
+            ends_segment = true;
+
+        if (part->begin != NULL &&
+            (ends_segment ||
+             part->length + block->i_length > config->part_length))
+        {
+            if (AddPart(playlist, sys, ends_segment) != VLC_SUCCESS)
+            {
+                block_Release(block);
+                block_ChainRelease(chain);
+                return VLC_EGENERIC;
+            }
+        }
+
+        block_ChainLastAppend(&part->end, block);
+        part->length += block->i_length;
+        playlist->gop_progress += block->i_length;
+    }
+    return VLC_SUCCESS;
+}
+
 static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
 {
     sout_stream_sys_t *sys = access->p_sys;
@@ -651,6 +908,16 @@ static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
     hls_playlist_t *it;
     hls_playlists_foreach(it)
     {
+        /* Low-latency playlists are segmented on their own, as the muxed
+         * output comes. */
+        if (IsLowLatencyPlaylist(it))
+        {
+            if (it->access == access &&
+                AppendLowLatency(it, sys, block) != VLC_SUCCESS)
+                return -1;
+            continue;
+        }
+
         /* Append the muxed output to the playlist tied to this access call. */
         if (it->access == access)
         {
@@ -670,6 +937,8 @@ static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
     {
         hls_playlists_foreach (it)
         {
+            if (IsLowLatencyPlaylist(it))
+                continue;
             while (IsSegmentReady(it->type,
                                   &it->muxed_output,
                                   sys->config.segment_length) &&
@@ -756,6 +1025,8 @@ static hls_playlist_t *CreatePlaylist(sout_stream_t *stream,
     playlist->config = &sys->config;
     playlist->ended = false;
     playlist->muxed_duration = 0;
+    playlist->gop_length = 0;
+    playlist->gop_progress = 0;
 
     playlist->url = FormatPlaylistManifestURL(playlist);
     if (unlikely(playlist->url == NULL))
@@ -772,11 +1043,16 @@ static hls_playlist_t *CreatePlaylist(sout_stream_t *stream,
         .playlist_type = type,
         .httpd_ref = sys->http_host,
         .httpd_callback = HTTPCallback,
+        .logger = playlist->logger,
     };
     hls_segment_queue_Init(&playlist->segments, &config, &sys->config);
+    if (IsLowLatencyPlaylist(playlist) &&
+        hls_segment_queue_AnnouncePart(&playlist->segments) != VLC_SUCCESS)
+        goto manifest_err;
 
     hls_block_chain_Reset(&playlist->muxed_output);
 
+    vlc_mutex_init(&playlist->lock);
     playlist->manifest = NULL;
     if (sys->http_host != NULL)
     {
@@ -791,6 +1067,14 @@ static hls_playlist_t *CreatePlaylist(sout_stream_t *stream,
     if (UpdatePlaylistManifest(playlist) != VLC_SUCCESS)
         goto error;
 
+    if (playlist->http_manifest != NULL)
+    {
+        httpd_UrlCatch(playlist->http_manifest,
+                       HTTPD_MSG_GET,
+                       HTTPPlaylistCallback,
+                       (httpd_callback_sys_t *)playlist);
+    }
+
     vlc_list_init(&playlist->tracks);
 
     vlc_info(playlist->logger, "Playlist created");
@@ -828,6 +1112,15 @@ static void DeletePlaylist(hls_playlist_t *playlist)
     block_ChainRelease(playlist->muxed_output.begin);
     hls_segment_queue_Clear(&playlist->segments);
 
+    if (playlist->http_manifest != NULL)
+    {
+        struct hls_storage_stats stats;
+        hls_segment_queue_GetStats(&playlist->segments, &stats);
+        vlc_info(playlist->logger,
+                 "%u segment request(s), %" PRIu64 " bytes served",
+                 stats.hits, stats.bytes);
+    }
+
     vlc_list_remove(&playlist->node);
 
     vlc_LogDestroy(playlist->logger);
@@ -941,7 +1234,10 @@ static void Del(sout_stream_t *stream, void *id)
             map->playlist_ref = NULL;
 
         track->playlist_ref->ended = true;
-        ExtractAndAddSegment(track->playlist_ref, sys);
+        if (!IsLowLatencyPlaylist(track->playlist_ref))
+            ExtractAndAddSegment(track->playlist_ref, sys);
+        else if (track->playlist_ref->muxed_output.begin != NULL)
+            AddPart(track->playlist_ref, sys, true);
         UpdatePlaylistManifest(track->playlist_ref);
 
         DeletePlaylist(track->playlist_ref);
@@ -1054,6 +1350,7 @@ static int Open(vlc_object_t *this)
                                           "num-seg",
                                           "out-dir",
                                           "pace",
+                                          "part-len",
                                           "seg-len",
                                           "variants",
                                           NULL};
@@ -1067,11 +1364,22 @@ static int Open(vlc_object_t *this)
     sys->config.pace = var_GetBool(stream, SOUT_CFG_PREFIX "pace");
     sys->config.segment_length =
         VLC_TICK_FROM_SEC(var_GetInteger(stream, SOUT_CFG_PREFIX "seg-len"));
+    sys->config.part_length =
+        VLC_TICK_FROM_MS(var_GetInteger(stream, SOUT_CFG_PREFIX "part-len"));
     sys->config.max_memory =
         BYTES_FROM_KB(var_GetInteger(stream, SOUT_CFG_PREFIX "max-memory"));
 
     int status = VLC_EINVAL;
 
+    if (sys->config.part_length < 0 ||
+        sys->config.part_length >= sys->config.segment_length)
+    {
+        msg_Err(stream,
+                "The part length must be shorter than the segment length. See "
+                "\"" SOUT_CFG_PREFIX "part-len\"");
+        goto variant_error;
+    }
+
     vlc_vector_init(&sys->variant_stream_maps);
     char *variants = var_GetNonEmptyString(stream, SOUT_CFG_PREFIX "variants");
     if (variants == NULL)
@@ -1173,6 +1481,13 @@ variant_error:
 #define PACE_LONGTEXT                                                          \
     N_("Enable input pacing, the media will play at playback rate")
 #define PACE_TEXT N_("Enable pacing")
+#define PARTLEN_LONGTEXT                                                       \
+    N_("Length of the partial segments in milliseconds. When set, the "       \
+       "playlists are published in low-latency mode: the segments are made "   \
+       "available in parts as soon as they are muxed, and the HTTP server "    \
+       "holds the playlist reloads until the next part is ready. 0 disables "  \
+       "low-latency mode")
+#define PARTLEN_TEXT N_("Partial segment length (ms)")
 #define SEGLEN_LONGTEXT N_("Length of segments in seconds")
 #define SEGLEN_TEXT N_("Segment length (sec)")
 
@@ -1191,6 +1506,7 @@ vlc_module_begin()
     add_integer(SOUT_CFG_PREFIX "num-seg", 0, NUMSEG_TEXT, NUMSEG_TEXT)
     add_string(SOUT_CFG_PREFIX "out-dir", NULL, OUTDIR_TEXT, OUTDIR_LONGTEXT)
     add_bool(SOUT_CFG_PREFIX "pace", false, PACE_TEXT, PACE_LONGTEXT)
+    add_integer(SOUT_CFG_PREFIX "part-len", 0, PARTLEN_TEXT, PARTLEN_LONGTEXT)
     add_integer(SOUT_CFG_PREFIX "seg-len", 4, SEGLEN_TEXT, SEGLEN_LONGTEXT)
 
     set_callback(Open)
@@ -33,6 +33,8 @@ struct hls_config
     unsigned int max_segments;
     bool pace;
     vlc_tick_t segment_length;
+    /** Length of the partial segments, 0 when low-latency is disabled. */
+    vlc_tick_t part_length;
     size_t max_memory;
 };
 
@@ -51,6 +53,12 @@ hls_config_IsMemStorageEnabled(const struct hls_config *config)
     return config->outdir == NULL;
 }
 
+static inline bool
+hls_config_IsLowLatencyEnabled(const struct hls_config *config)
+{
+    return config->part_length != 0;
+}
+
 struct hls_sub_segmenter;
 sout_mux_t *CreateSubtitleSegmenter(sout_access_out_t *access,
                                     const struct hls_config *config);
@@ -25,6 +25,7 @@
 
 #include <vlc_common.h>
 
+#include <vlc_block.h>
 #include <vlc_httpd.h>
 #include <vlc_list.h>
 #include <vlc_tick.h>
@@ -33,10 +34,61 @@
 #include "segments.h"
 #include "storage.h"
 
-static void hls_segment_Destroy(hls_segment_t *segment)
+static void hls_part_Destroy(hls_segment_queue_t *queue, hls_part_t *part)
 {
+    if (part->http_url != NULL)
+        httpd_UrlDelete(part->http_url);
+    if (part->storage != NULL)
+    {
+        struct hls_storage_stats stats;
+        hls_storage_GetStats(part->storage, &stats);
+        queue->served_hits += stats.hits;
+        queue->served_bytes += stats.bytes;
+        hls_storage_Destroy(part->storage);
+    }
+    free(part->url);
+    free(part);
+}
+
+static void hls_part_ClearList(hls_segment_queue_t *queue,
+                               struct vlc_list *parts)
+{
+    hls_part_t *it;
+    vlc_list_foreach (it, parts, priv_node)
+        hls_part_Destroy(queue, it);
+    vlc_list_init(parts);
+}
+
+static void hls_part_AddStats(const struct vlc_list *parts,
+                              struct hls_storage_stats *stats)
+{
+    const hls_part_t *it;
+    hls_part_Foreach_const(parts, it)
+    {
+        struct hls_storage_stats part_stats;
+        hls_storage_GetStats(it->storage, &part_stats);
+        stats->hits += part_stats.hits;
+        stats->bytes += part_stats.bytes;
+    }
+}
+
+static void hls_segment_Destroy(hls_segment_queue_t *queue,
+                                hls_segment_t *segment)
+{
+    hls_part_ClearList(queue, &segment->parts);
     if (segment->http_url != NULL)
+    {
         httpd_UrlDelete(segment->http_url);
+
+        struct hls_storage_stats stats;
+        hls_storage_GetStats(segment->storage, &stats);
+        queue->served_hits += stats.hits;
+        queue->served_bytes += stats.bytes;
+        vlc_debug(queue->logger,
+                  "Segment '%u' removed after %u request(s), %" PRIu64
+                  " bytes served",
+                  segment->id, stats.hits, stats.bytes);
+    }
     hls_storage_Destroy(segment->storage);
     free(segment->url);
     free(segment);
@@ -71,13 +123,50 @@ void hls_segment_queue_Init(hls_segment_queue_t *queue,
 
     queue->hls_config = hls_config;
 
+    queue->logger = config->logger;
+    queue->served_hits = 0;
+    queue->served_bytes = 0;
+
     vlc_list_init(&queue->segments);
+
+    vlc_list_init(&queue->parts);
+    queue->part_count = 0;
+    queue->parts_length = 0;
+    queue->hint = NULL;
 }
 
 void hls_segment_queue_Clear(hls_segment_queue_t *queue)
 {
     hls_segment_t *it;
-    hls_segment_queue_Foreach(queue, it) { hls_segment_Destroy(it); }
+    hls_segment_queue_Foreach(queue, it) { hls_segment_Destroy(queue, it); }
+    vlc_list_init(&queue->segments);
+
+    hls_part_ClearList(queue, &queue->parts);
+    queue->part_count = 0;
+    queue->parts_length = 0;
+    if (queue->hint != NULL)
+    {
+        hls_part_Destroy(queue, queue->hint);
+        queue->hint = NULL;
+    }
+}
+
+void hls_segment_queue_GetStats(const hls_segment_queue_t *queue,
+                                struct hls_storage_stats *stats)
+{
+    stats->hits = queue->served_hits;
+    stats->bytes = queue->served_bytes;
+
+    const hls_segment_t *it;
+    hls_segment_queue_Foreach_const(queue, it)
+    {
+        struct hls_storage_stats segment_stats;
+        hls_storage_GetStats(it->storage, &segment_stats);
+        stats->hits += segment_stats.hits;
+        stats->bytes += segment_stats.bytes;
+        hls_part_AddStats(&it->parts, stats);
+    }
+    hls_part_AddStats(&queue->parts, stats);
 }
 
 int hls_segment_queue_NewSegment(hls_segment_queue_t *queue,
@@ -90,6 +179,7 @@ int hls_segment_queue_NewSegment(hls_segment_queue_t *queue,
 
     segment->id = queue->total_segments;
     segment->length = length;
+    vlc_list_init(&segment->parts);
 
     if (asprintf(&segment->url,
                  "%s/playlist-%u-%u.%s",
@@ -131,7 +221,7 @@ int hls_segment_queue_NewSegment(hls_segment_queue_t *queue,
         hls_segment_t *old = hls_segment_GetFirst(queue);
         assert(old != NULL);
         vlc_list_remove(&old->priv_node);
-        hls_segment_Destroy(old);
+        hls_segment_Destroy(queue, old);
     }
 
     ++queue->total_segments;
@@ -144,3 +234,185 @@ nomem:
     free(segment);
     return VLC_ENOMEM;
 }
+
+static int HintCallback(httpd_callback_sys_t *sys,
+                        httpd_client_t *client,
+                        httpd_message_t *answer,
+                        const httpd_message_t *query)
+{
+    if (answer == NULL || query == NULL || client == NULL)
+        return VLC_SUCCESS;
+
+    /* The part is not muxed yet: hold the request until it is. */
+    return VLC_EAGAIN;
+    (void)sys;
+}
+
+static hls_part_t *hls_part_New(hls_segment_queue_t *queue)
+{
+    hls_part_t *part = malloc(sizeof(*part));
+    if (unlikely(part == NULL))
+        return NULL;
+
+    part->id = queue->part_count;
+    part->length = 0;
+    part->independent = false;
+    part->storage = NULL;
+
+    /* The segment being built gets the next segment ID. */
+    if (asprintf(&part->url,
+                 "%s/playlist-%u-%u.%u.%s",
+                 queue->hls_config->base_url,
+                 queue->playlist_id,
+                 queue->total_segments,
+                 part->id,
+                 queue->file_extension) == -1)
+    {
+        free(part);
+        return NULL;
+    }
+
+    if (queue->httpd_ref != NULL)
+    {
+        part->http_url = httpd_UrlNew(queue->httpd_ref, part->url, NULL, NULL);
+        if (part->http_url == NULL)
+        {
+            free(part->url);
+            free(part);
+            return NULL;
+        }
+        httpd_UrlCatch(part->http_url, HTTPD_MSG_GET, HintCallback, NULL);
+    }
+    else
+        part->http_url = NULL;
+    return part;
+}
+
+/**
+ * Remove the parts more than three target durations away from the live edge,
+ * as advised by RFC 8216bis section 6.2.2. Their segments remain.
+ */
+static void hls_segment_queue_TrimParts(hls_segment_queue_t *queue)
+{
+    const vlc_tick_t window = 3 * queue->hls_config->segment_length;
+    vlc_tick_t age = 0;
+
+    hls_segment_t *it;
+    vlc_list_reverse_foreach (it, &queue->segments, priv_node)
+    {
+        if (age > window)
+        {
+            if (vlc_list_is_empty(&it->parts))
+                break;
+            hls_part_ClearList(queue, &it->parts);
+        }
+        age += it->length;
+    }
+}
+
+/* Adds the segment made of all the parts built so far to the queue. */
+static int hls_segment_queue_EndParts(hls_segment_queue_t *queue)
+{
+    block_t *content = NULL;
+    block_t **last = &content;
+
+    /* The segment shares the data of its parts, gathered once. */
+    hls_part_t *part;
+    vlc_list_foreach (part, &queue->parts, priv_node)
+    {
+        block_t *shared = hls_storage_Share(part->storage);
+        if (unlikely(shared == NULL))
+        {
+            block_ChainRelease(content);
+            return VLC_ENOMEM;
+        }
+        block_ChainLastAppend(&last, shared);
+    }
+
+    const int status =
+        hls_segment_queue_NewSegment(queue, content, queue->parts_length);
+    if (unlikely(status != VLC_SUCCESS))
+        return status;
+
+    hls_segment_t *segment = vlc_list_last_entry_or_null(
+        &queue->segments, hls_segment_t, priv_node);
+    assert(segment != NULL);
+    vlc_list_foreach (part, &queue->parts, priv_node)
+    {
+        vlc_list_remove(&part->priv_node);
+        vlc_list_append(&part->priv_node, &segment->parts);
+    }
+    queue->part_count = 0;
+    queue->parts_length = 0;
+
+    hls_segment_queue_TrimParts(queue);
+    return VLC_SUCCESS;
+}
+
+int hls_segment_queue_NewPart(hls_segment_queue_t *queue,
+                              block_t *content,
+                              vlc_tick_t length,
+                              bool independent,
+                              bool ends_segment)
+{
+    hls_part_t *part = queue->hint;
+    queue->hint = NULL;
+    if (part == NULL)
+    {
+        part = hls_part_New(queue);
+        if (unlikely(part == NULL))
+        {
+            block_ChainRelease(content);
+            return VLC_ENOMEM;
+        }
+    }
+    assert(part->id == queue->part_count);
+
+    part->length = length;
+    part->independent = independent;
+
+    const struct hls_storage_config storage_conf = {
+        .name = part->url + strlen(queue->hls_config->base_url) + 1,
+        .mime = "video/MP2T",
+    };
+    part->storage =
+        hls_storage_FromBlocks(content, &storage_conf, queue->hls_config);
+    if (unlikely(part->storage == NULL))
+    {
+        hls_part_Destroy(queue, part);
+        return VLC_ENOMEM;
+    }
+
+    if (part->http_url != NULL)
+    {
+        httpd_UrlCatch(part->http_url,
+                       HTTPD_MSG_GET,
+                       queue->httpd_callback,
+                       (httpd_callback_sys_t *)part->storage);
+        /* Answer the clients that followed the preload hint. */
+        httpd_UrlSignal(part->http_url);
+    }
+
+    vlc_list_append(&part->priv_node, &queue->parts);
+    ++queue->part_count;
+    queue->parts_length += length;
+
+    if (ends_segment)
+    {
+        const int status = hls_segment_queue_EndParts(queue);
+        if (unlikely(status != VLC_SUCCESS))
+            return status;
+    }
+
+    return hls_segment_queue_AnnouncePart(queue);
+}
+
+int hls_segment_queue_AnnouncePart(hls_segment_queue_t *queue)
+{
+    assert(queue->hint == NULL);
+    if (queue->httpd_ref == NULL)
+        return VLC_SUCCESS;
+
+    queue->hint = hls_part_New(queue);
+    return (queue->hint != NULL) ? VLC_SUCCESS : VLC_ENOMEM;
+}
@@ -21,7 +21,30 @@
 #define HLS_SEGMENTS_H
 
 struct hls_storage;
+struct hls_storage_stats;
 struct hls_config;
+struct vlc_logger;
+
+/**
+ * Partial segment, as in the low-latency extension of RFC 8216bis section
+ * 4.4.4.9.
+ */
+typedef struct hls_part
+{
+    char *url;
+    /** Index of the part in its segment. */
+    unsigned int id;
+    vlc_tick_t length;
+    /** The part starts with a synchronization frame. */
+    bool independent;
+
+    /** NULL as long as the part is only announced by a preload hint. */
+    struct hls_storage *storage;
+
+    httpd_url_t *http_url;
+
+    struct vlc_list priv_node;
+} hls_part_t;
 
 typedef struct hls_segment
 {
@@ -33,6 +56,12 @@ typedef struct hls_segment
 
     httpd_url_t *http_url;
 
+    /**
+     * The parts the segment was published as, while the segment is close
+     * enough to the live edge.
+     */
+    struct vlc_list parts;
+
     struct vlc_list priv_node;
 } hls_segment_t;
 
@@ -43,6 +72,8 @@ struct hls_segment_queue_config
 
     httpd_host_t *httpd_ref;
     httpd_callback_t httpd_callback;
+
+    struct vlc_logger *logger;
 };
 
 typedef struct
@@ -57,7 +88,19 @@ typedef struct
 
     const struct hls_config *hls_config;
 
+    struct vlc_logger *logger;
+    /** Requests served by the segments and parts removed from the queue. */
+    unsigned int served_hits;
+    uint64_t served_bytes;
+
     struct vlc_list segments;
+
+    /** Parts of the segment being built, in low-latency mode. */
+    struct vlc_list parts;
+    unsigned int part_count;
+    vlc_tick_t parts_length;
+    /** The next part, announced before it is muxed. */
+    hls_part_t *hint;
 } hls_segment_queue_t;
 
 #define hls_segment_queue_Foreach(queue, it)                                   \
@@ -66,12 +109,20 @@ typedef struct
     vlc_list_foreach_const (it, &(queue)->segments, priv_node)
 #define hls_segment_GetFirst(queue)                                            \
     vlc_list_first_entry_or_null(&(queue)->segments, hls_segment_t, priv_node);
+#define hls_part_Foreach_const(parts, it)                                      \
+    vlc_list_foreach_const (it, parts, priv_node)
 
 void hls_segment_queue_Init(hls_segment_queue_t *,
                             const struct hls_segment_queue_config *,
                             const struct hls_config *);
 void hls_segment_queue_Clear(hls_segment_queue_t *);
 
+/**
+ * Get the serving statistics of all the segments, past and present.
+ */
+void hls_segment_queue_GetStats(const hls_segment_queue_t *,
+                                struct hls_storage_stats *);
+
 /**
  * Add a new segment to the queue.
  *
@@ -88,6 +139,38 @@ int hls_segment_queue_NewSegment(hls_segment_queue_t *,
                                  block_t *content,
                                  vlc_tick_t length);
 
+/**
+ * Add a new part to the segment being built.
+ *
+ * The part takes the place of the announced hint, if any. When the part ends
+ * its segment, the segment is added to the queue from all of its parts, as
+ * with \ref hls_segment_queue_NewSegment. Then the next part is announced.
+ *
+ * \param content A chain of block containing part's data.
+ * \param length The media time size of the part.
+ * \param independent Whether the part starts with a synchronization frame.
+ * \param ends_segment Whether the part is the last of its segment.
+ *
+ * \retval VLC_SUCCESS on success.
+ * \retval VLC_ENOMEM on internal allocation failure.
+ */
+int hls_segment_queue_NewPart(hls_segment_queue_t *,
+                              block_t *content,
+                              vlc_tick_t length,
+                              bool independent,
+                              bool ends_segment);
+
+/**
+ * Announce the next part, as in a preload hint.
+ *
+ * If the queue is served over HTTP, the URL of the next part is registered
+ * ahead of time, and held until the part is muxed. Otherwise, this is a no-op.
+ *
+ * \retval VLC_SUCCESS on success.
+ * \retval VLC_ENOMEM on internal allocation failure.
+ */
+int hls_segment_queue_AnnouncePart(hls_segment_queue_t *);
+
 static inline bool
 hls_segment_queue_IsAtMaxCapacity(const hls_segment_queue_t *queue)
 {
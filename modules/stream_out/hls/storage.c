@@ -23,11 +23,13 @@
 
 #include <assert.h>
 #include <fcntl.h>
+#include <stdatomic.h>
 
 #include <unistd.h>     /* close() */
 
 #include <vlc_common.h>
 
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
 
@@ -37,126 +39,96 @@
 struct storage_priv
 {
     hls_storage_t storage;
-    void (*destroy)(struct storage_priv *storage);
-    size_t size;
+    /** Held by the storage itself and by every block served from it. */
+    vlc_atomic_rc_t rc;
+    /** The whole immutable content, in a single block. */
+    block_t *content;
 
-    union
-    {
-        struct
-        {
-            block_t *content;
-        } mem;
+    atomic_uint hits;
+    atomic_uint_least64_t bytes;
+};
 
-        struct
-        {
-            char *path;
-        } fs;
-    };
+/**
+ * Block referencing the storage content.
+ */
+struct storage_ref
+{
+    block_t self;
+    struct storage_priv *priv;
 };
 
-static void mem_storage_Destroy(struct storage_priv *priv)
+static void storage_Release(struct storage_priv *priv)
 {
-    block_ChainRelease(priv->mem.content);
+    if (!vlc_atomic_rc_dec(&priv->rc))
+        return;
+
+    block_Release(priv->content);
     free(priv);
 }
 
-static ssize_t mem_storage_GetContent(const hls_storage_t *storage,
-                                      uint8_t **dest)
+static void storage_ref_Release(block_t *block)
 {
-    const struct storage_priv *priv =
-        container_of(storage, struct storage_priv, storage);
-
-    *dest = malloc(priv->size);
-    if (unlikely(*dest == NULL))
-        return -1;
+    struct storage_ref *ref = container_of(block, struct storage_ref, self);
 
-    uint8_t *cursor = *dest;
-    for (const block_t *it = priv->mem.content; it != NULL; it = it->p_next)
-    {
-        memcpy(cursor, it->p_buffer, it->i_buffer);
-        cursor += it->i_buffer;
-    }
-    return priv->size;
+    storage_Release(ref->priv);
+    free(ref);
 }
 
-static hls_storage_t *mem_storage_FromBlock(block_t *content)
+static const struct vlc_block_callbacks storage_ref_cbs = {
+    storage_ref_Release,
+};
+
+static block_t *storage_Ref(struct storage_priv *priv)
 {
-    struct storage_priv *priv = malloc(sizeof(*priv));
-    if (unlikely(priv == NULL))
+    struct storage_ref *ref = malloc(sizeof(*ref));
+    if (unlikely(ref == NULL))
         return NULL;
 
-    priv->storage.get_content = mem_storage_GetContent;
-    priv->destroy = mem_storage_Destroy;
-    priv->mem.content = content;
-    block_ChainProperties(content, NULL, &priv->size, NULL);
-    return &priv->storage;
+    block_Init(&ref->self, &storage_ref_cbs,
+               priv->content->p_buffer, priv->content->i_buffer);
+    vlc_atomic_rc_inc(&priv->rc);
+    ref->priv = priv;
+    return &ref->self;
 }
 
-static hls_storage_t *mem_storage_FromBytes(void *bytes, size_t size)
+static block_t *storage_GetContent(hls_storage_t *storage)
 {
-    struct storage_priv *priv = malloc(sizeof(*priv));
-    if (unlikely(priv == NULL))
-        return NULL;
+    struct storage_priv *priv =
+        container_of(storage, struct storage_priv, storage);
 
-    block_t *content = block_heap_Alloc(bytes, size);
-    if (unlikely(content == NULL))
-    {
-        free(priv);
+    block_t *ref = storage_Ref(priv);
+    if (unlikely(ref == NULL))
         return NULL;
-    }
 
-    priv->storage.get_content = mem_storage_GetContent;
-    priv->destroy = mem_storage_Destroy;
-    priv->size = size;
-    priv->mem.content = content;
-    return &priv->storage;
+    atomic_fetch_add_explicit(&priv->hits, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&priv->bytes, priv->content->i_buffer,
+                              memory_order_relaxed);
+    return ref;
 }
 
-static ssize_t fs_storage_Read(int fd, uint8_t buf[], size_t len)
+static hls_storage_t *storage_New(block_t *content)
 {
-    size_t total = 0;
-    while (total < len)
+    struct storage_priv *priv = malloc(sizeof(*priv));
+    if (unlikely(priv == NULL))
     {
-        const ssize_t n = read(fd, buf + total, len - total);
-        if (n == -1)
-        {
-            if (errno == EINTR || errno == EAGAIN)
-                continue;
-            return -1;
-        }
-        else if (n == 0)
-            break;
-
-        total += n;
+        block_Release(content);
+        return NULL;
     }
-    return total;
+
+    priv->storage.get_content = storage_GetContent;
+    vlc_atomic_rc_init(&priv->rc);
+    priv->content = content;
+    atomic_init(&priv->hits, 0);
+    atomic_init(&priv->bytes, 0);
+    return &priv->storage;
 }
 
-static ssize_t fs_storage_GetContent(const hls_storage_t *storage,
-                                     uint8_t **dest)
+/* Gathers the chain in a single block, once for all the clients. */
+static block_t *storage_Gather(block_t *content)
 {
-    const struct storage_priv *priv =
-        container_of(storage, struct storage_priv, storage);
-
-    const int fd = vlc_open(priv->fs.path, O_RDONLY);
-
-    if (fd == -1)
-        return -1;
-
-    *dest = malloc(priv->size);
-    if (unlikely(*dest == NULL))
-        goto err;
-
-    const ssize_t read = fs_storage_Read(fd, *dest, priv->size);
-    if (read == -1)
-        goto err;
-
-    close(fd);
-    return read;
-err:
-    free(dest);
-    close(fd);
-    return -1;
+    if (content == NULL)
+        return block_Alloc(0);
+    return block_ChainGather(content);
 }
 
 static int fs_storage_Write(int fd, const uint8_t *data, size_t len)
@@ -177,12 +149,6 @@ static int fs_storage_Write(int fd, const uint8_t *data, size_t len)
     return VLC_SUCCESS;
 }
 
-static void fs_storage_Destroy(struct storage_priv *priv)
-{
-    free(priv->fs.path);
-    free(priv);
-}
-
 static inline char *fs_storage_CreatePath(const char *outdir,
                                           const char *storage_name)
 {
@@ -193,86 +159,64 @@ static inline char *fs_storage_CreatePath(const char *outdir,
     return ret;
 }
 
-static hls_storage_t *
-fs_storage_FromBlock(block_t *content,
-                     const struct hls_storage_config *config,
-                     const struct hls_config *hls_config)
+/**
+ * Writes the content to its file and returns the block to serve it from.
+ *
+ * The file is written aside and renamed, so that the manifests, which are
+ * rewritten over and over, are always complete on disk, and so that a mapping
+ * of the previous version remains valid for the clients still reading it.
+ */
+static block_t *fs_storage_Persist(block_t *content,
+                                   const struct hls_storage_config *config,
+                                   const struct hls_config *hls_config)
 {
-    struct storage_priv *priv = malloc(sizeof(*priv));
-    if (unlikely(priv == NULL))
+    char *path = fs_storage_CreatePath(hls_config->outdir, config->name);
+    char *tmp_path;
+    if (unlikely(path == NULL))
         goto err;
-
-    priv->fs.path = fs_storage_CreatePath(hls_config->outdir, config->name);
-    if (unlikely(priv->fs.path == NULL))
+    if (unlikely(asprintf(&tmp_path, "%s.tmp", path) == -1))
+    {
+        free(path);
         goto err;
+    }
 
-    const int fd = vlc_open(priv->fs.path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    int fd = vlc_open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
     if (fd == -1)
-        goto err;
+        goto err_path;
+
+    const int status = fs_storage_Write(fd, content->p_buffer,
+                                        content->i_buffer);
+    close(fd);
+    if (status != VLC_SUCCESS || vlc_rename(tmp_path, path) != 0)
+    {
+        vlc_unlink(tmp_path);
+        goto err_path;
+    }
+    free(tmp_path);
 
-    size_t size = 0;
-    for (const block_t *it = content; it != NULL; it = it->p_next)
+#ifndef _WIN32
+    /* Serve the page cache rather than keeping a copy on the heap. Windows
+     * cannot replace a file while it is mapped. */
+    fd = vlc_open(path, O_RDONLY);
+    if (fd != -1)
     {
-        const int status = fs_storage_Write(fd, it->p_buffer, it->i_buffer);
-        if (status != VLC_SUCCESS)
+        block_t *mapped = block_File(fd, false);
+        close(fd);
+        if (mapped != NULL)
         {
-            close(fd);
-            goto err;
+            block_Release(content);
+            content = mapped;
         }
-        size += it->i_buffer;
     }
+#endif
+    free(path);
+    return content;
 
-    close(fd);
-    block_ChainRelease(content);
-
-    priv->storage.get_content = fs_storage_GetContent;
-    priv->size = size;
-    priv->destroy = fs_storage_Destroy;
-
-    return &priv->storage;
-err:
-    block_ChainRelease(content);
-    if (priv != NULL)
-        free(priv->fs.path);
-    free(priv);
-    return NULL;
-}
-
-static hls_storage_t *
-fs_storage_FromBytes(void *bytes,
-                     size_t size,
-                     const struct hls_storage_config *config,
-                     const struct hls_config *hls_config)
-{
-    struct storage_priv *priv = malloc(sizeof(*priv));
-    if (unlikely(priv == NULL))
-        return NULL;
-
-    priv->fs.path = fs_storage_CreatePath(hls_config->outdir, config->name);
-    if (unlikely(priv->fs.path == NULL))
-        goto err;
-
-    const int fd = vlc_open(priv->fs.path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
-    if (fd == -1)
-        goto err;
-
-    const int status = fs_storage_Write(fd, bytes, size);
-    close(fd);
-
-    if (unlikely(status != VLC_SUCCESS))
-        goto err;
-
-    priv->storage.get_content = fs_storage_GetContent;
-    priv->size = size;
-    priv->destroy = fs_storage_Destroy;
-
-    free(bytes);
-    return &priv->storage;
+err_path:
+    free(tmp_path);
+    free(path);
 err:
-    free(bytes);
-    if (priv != NULL)
-        free(priv->fs.path);
-    free(priv);
+    block_Release(content);
     return NULL;
 }
 
@@ -280,12 +224,18 @@ hls_storage_t *hls_storage_FromBlocks(block_t *content,
                                       const struct hls_storage_config *config,
                                       const struct hls_config *hls_config)
 {
-    hls_storage_t *storage;
-    if (hls_config_IsMemStorageEnabled(hls_config))
-        storage = mem_storage_FromBlock(content);
-    else
-        storage = fs_storage_FromBlock(content, config, hls_config);
+    content = storage_Gather(content);
+    if (unlikely(content == NULL))
+        return NULL;
+
+    if (!hls_config_IsMemStorageEnabled(hls_config))
+    {
+        content = fs_storage_Persist(content, config, hls_config);
+        if (content == NULL)
+            return NULL;
+    }
 
+    hls_storage_t *storage = storage_New(content);
     if (storage != NULL)
         storage->mime = config->mime;
     return storage;
@@ -296,27 +246,37 @@ hls_storage_t *hls_storage_FromBytes(void *data,
                                      const struct hls_storage_config *config,
                                      const struct hls_config *hls_config)
 {
-    hls_storage_t *storage;
-    if (hls_config_IsMemStorageEnabled(hls_config))
-        storage = mem_storage_FromBytes(data, size);
-    else
-        storage = fs_storage_FromBytes(data, size, config, hls_config);
+    block_t *content = block_heap_Alloc(data, size);
+    if (unlikely(content == NULL))
+        return NULL;
+    return hls_storage_FromBlocks(content, config, hls_config);
+}
 
-    if (storage != NULL)
-        storage->mime = config->mime;
-    return storage;
+block_t *hls_storage_Share(hls_storage_t *storage)
+{
+    return storage_Ref(container_of(storage, struct storage_priv, storage));
 }
 
 size_t hls_storage_GetSize(const hls_storage_t *storage)
 {
     const struct storage_priv *priv =
         container_of(storage, struct storage_priv, storage);
-    return priv->size;
+    return priv->content->i_buffer;
+}
+
+void hls_storage_GetStats(const hls_storage_t *storage,
+                          struct hls_storage_stats *stats)
+{
+    const struct storage_priv *priv =
+        container_of(storage, struct storage_priv, storage);
+
+    stats->hits = atomic_load_explicit(&priv->hits, memory_order_relaxed);
+    stats->bytes = atomic_load_explicit(&priv->bytes, memory_order_relaxed);
 }
 
 void hls_storage_Destroy(hls_storage_t *storage)
 {
     struct storage_priv *priv =
         container_of(storage, struct storage_priv, storage);
-    priv->destroy(priv);
+    storage_Release(priv);
 }
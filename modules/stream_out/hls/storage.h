@@ -23,6 +23,11 @@
 /**
  * Handy simple storage abstraction to allow seamless support of in-memory or
  * filesystem HLS segment/manifest storage.
+ *
+ * Either way, the content is kept as a single immutable buffer: a heap copy
+ * for in-memory storage, a read-only mapping of the written file otherwise.
+ * The buffer is reference counted and freed once the storage is destroyed
+ * and no client is being served from it anymore.
  */
 
 struct hls_storage_config
@@ -35,15 +40,30 @@ typedef struct hls_storage
 {
     const char *mime;
     /**
-     * Get a copy of the whole storage content.
+     * Get the whole storage content.
+     *
+     * The content is immutable and shared rather than copied: the returned
+     * block references the storage data, which remains valid until the block
+     * is released, even if the storage is destroyed in the meantime. The block
+     * can thus be handed to several HTTP clients at once.
      *
-     * \param[out] dest Pointer on a byte buffer, will be freshly allocated by
-     * the function call. \return Byte count of the byte buffer. \retval -1 On
-     * allocation error.
+     * \return A block of the content, to be released by the caller.
+     * \retval NULL On allocation error.
      */
-    ssize_t (*get_content)(const struct hls_storage *, uint8_t **dest);
+    block_t *(*get_content)(struct hls_storage *);
 } hls_storage_t;
 
+/**
+ * Serving statistics of a storage.
+ */
+struct hls_storage_stats
+{
+    /** Number of times the content was requested. */
+    unsigned hits;
+    /** Total byte count of the served content. */
+    uint64_t bytes;
+};
+
 /**
  * Create an HLS opaque storage from a chain of blocks.
  *
@@ -78,8 +98,18 @@ hls_storage_t *hls_storage_FromBytes(void *data,
                                      const struct hls_storage_config *,
                                      const struct hls_config *) VLC_USED;
 
+/**
+ * Get the whole storage content, to build another storage from it.
+ *
+ * Same as \ref hls_storage_t.get_content, except that the content is not
+ * accounted as served.
+ */
+block_t *hls_storage_Share(hls_storage_t *) VLC_USED;
+
 size_t hls_storage_GetSize(const hls_storage_t *);
 
+void hls_storage_GetStats(const hls_storage_t *, struct hls_storage_stats *);
+
 void hls_storage_Destroy(hls_storage_t *);
 
 #endif
@@ -54,6 +54,7 @@
 
 #include "rtp.h"
 #include "sdp_helper.h"
+#include "dgram.h"
 
 #include <sys/types.h>
 #include <unistd.h>
@@ -311,12 +312,16 @@ typedef struct
     vlc_mutex_t      lock_es;
     int              i_es;
     sout_stream_id_sys_t **es;
+
+    /* Counters of the deleted ES */
+    struct sout_dgram_stats stats;
 } sout_stream_sys_t;
 
 typedef struct rtp_sink_t
 {
     int rtp_fd;
     rtcp_sender_t *rtcp;
+    struct sout_dgram dgram;
 } rtp_sink_t;
 
 struct sout_stream_id_sys_t
@@ -357,18 +362,43 @@ struct sout_stream_id_sys_t
     } listen;
 
     vlc_tick_t        i_caching;
+    /* Pacing and removed sinks counters, protected by lock_sink */
+    struct sout_dgram_stats stats;
 };
 
-static int Control(sout_stream_t *stream, int query, va_list args)
+static void GetStats(sout_stream_t *stream, struct sout_stream_stats *out)
 {
-    (void) stream;
+    sout_stream_sys_t *sys = stream->p_sys;
+
+    /* ES are only deleted with the stream output lock held, as here */
+    sout_dgram_Report(out, &sys->stats);
+
+    vlc_mutex_lock(&sys->lock_es);
+    for (int i = 0; i < sys->i_es; i++)
+    {
+        sout_stream_id_sys_t *id = sys->es[i];
+
+        vlc_mutex_lock(&id->lock_sink);
+        sout_dgram_Report(out, &id->stats);
+        for (int j = 0; j < id->sinkc; j++)
+            sout_dgram_Report(out, &id->sinkv[j].dgram.stats);
+        vlc_mutex_unlock(&id->lock_sink);
+    }
+    vlc_mutex_unlock(&sys->lock_es);
+}
 
+static int Control(sout_stream_t *stream, int query, va_list args)
+{
     switch (query)
     {
         case SOUT_STREAM_IS_SYNCHRONOUS:
             *va_arg(args, bool *) = true;
             break;
 
+        case SOUT_STREAM_GET_STATS:
+            GetStats(stream, va_arg(args, struct sout_stream_stats *));
+            break;
+
         default:
             return VLC_EGENERIC;
     }
@@ -507,6 +537,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_pts_zero = vlc_tick_now();
     p_sys->i_es = 0;
     p_sys->es   = NULL;
+    memset( &p_sys->stats, 0, sizeof (p_sys->stats) );
     p_sys->rtsp = NULL;
     p_sys->psz_sdp = NULL;
 
@@ -954,6 +985,7 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt, const char
     id->b_first_packet = true;
     id->i_caching =
         VLC_TICK_FROM_MS(var_GetInteger( p_stream, SOUT_CFG_PREFIX "caching"));
+    memset( &id->stats, 0, sizeof (id->stats) );
 
     vlc_rand_bytes (&id->i_sequence, sizeof (id->i_sequence));
     vlc_rand_bytes (id->ssrc, sizeof (id->ssrc));
@@ -1201,6 +1233,7 @@ static void Del( sout_stream_t *p_stream, void *_id )
     if( p_sys->b_export_sap ) SapSetup( p_stream );
     if( p_sys->psz_sdp_file != NULL ) FileSetup( p_stream );
 
+    sout_dgram_Merge( &p_sys->stats, &id->stats );
     free( id );
 }
 
@@ -1345,6 +1378,30 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
+#ifdef HAVE_SRTP
+static block_t *ProtectRTP( sout_stream_id_sys_t *id, block_t *out )
+{
+    if( id->srtp == NULL )
+        return out;
+
+    /* FIXME: this is awfully inefficient */
+    size_t len = out->i_buffer;
+    out = block_Realloc( out, 0, len + 10 );
+    out->i_buffer = len;
+
+    int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+    if( val )
+    {
+        msg_Dbg( id->p_stream, "SRTP sending error: %s",
+                 vlc_strerror_c(val) );
+        block_Release( out );
+        return NULL;
+    }
+    out->i_buffer = len;
+    return out;
+}
+#endif
+
 static void* ThreadSend( void *data )
 {
     vlc_thread_set_name("vlc-rt-send");
@@ -1359,61 +1416,107 @@ static void* ThreadSend( void *data )
 #endif
     sout_stream_id_sys_t *id = data;
     vlc_tick_t i_caching = id->i_caching;
-    block_t *out;
+    block_t *held = NULL;
 
-    while ((out = vlc_queue_DequeueKillable(&id->queue, &id->dead)) != NULL)
+    for (;;)
     {
+        block_t *out = held;
+
+        if (out == NULL)
+            out = vlc_queue_DequeueKillable(&id->queue, &id->dead);
+        if (out == NULL)
+            break;
+        held = NULL;
+
+        vlc_tick_t deadline = out->i_dts + i_caching;
+        vlc_tick_wait (deadline);
+
+        vlc_tick_t now = vlc_tick_now();
+
+        /* Send the packets that are already due along with this one */
+        block_t *batch[SOUT_DGRAM_BATCH_MAX];
+        struct iovec iov[SOUT_DGRAM_BATCH_MAX];
+        struct msghdr msgv[SOUT_DGRAM_BATCH_MAX];
+        unsigned count = 0;
+        /* Each packet slips from its own deadline */
+        struct sout_dgram_stats paced = { 0 };
+
+        for (;;)
+        {
 #ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
-
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            if( val )
+            out = ProtectRTP( id, out );
+            if( out != NULL )
+#endif
             {
-                msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                continue;
+                sout_dgram_Slip( &paced, now - (out->i_dts + i_caching) );
+                iov[count].iov_base = out->p_buffer;
+                iov[count].iov_len = out->i_buffer;
+                msgv[count] = (struct msghdr) {
+                    .msg_iov = &iov[count],
+                    .msg_iovlen = 1,
+                };
+                batch[count++] = out;
+            }
+
+            if (count >= ARRAY_SIZE(batch))
+                break;
+
+            vlc_queue_Lock(&id->queue);
+            out = vlc_queue_DequeueUnlocked(&id->queue);
+            vlc_queue_Unlock(&id->queue);
+
+            if (out == NULL)
+                break;
+            if (out->i_dts + i_caching > now)
+            {
+                held = out;
+                break;
             }
-            out->i_buffer = len;
         }
-#endif
-        vlc_tick_wait (out->i_dts + i_caching);
 
-        ssize_t len = out->i_buffer;
+        if (count == 0)
+            continue;
 
         vlc_mutex_lock( &id->lock_sink );
+        sout_dgram_Merge( &id->stats, &paced );
+
         unsigned deadc = 0; /* How many dead sockets? */
         int deadv[id->sinkc ? id->sinkc : 1]; /* Dead sockets list */
 
         for( int i = 0; i < id->sinkc; i++ )
         {
+            rtp_sink_t *sink = &id->sinkv[i];
+
 #ifdef HAVE_SRTP
             if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+                for( unsigned j = 0; j < count; j++ )
+                    SendRTCP( sink->rtcp, batch[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
+            int val = sout_dgram_Send( &sink->dgram, msgv, count );
+            if( val < (int)count
              && net_errno != EAGAIN && net_errno != EWOULDBLOCK
              && net_errno != ENOBUFS && net_errno != ENOMEM )
             {
                 int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
+                getsockopt( sink->rtp_fd, SOL_SOCKET, SO_TYPE,
                             &type, &(socklen_t){ sizeof(type) });
                 if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
+                {   /* ICMP soft error: ignore and retry */
+                    unsigned done = (val > 0) ? val : 0;
+                    sout_dgram_Send( &sink->dgram, msgv + done, count - done );
+                }
                 else
                     /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
+                    deadv[deadc++] = sink->rtp_fd;
             }
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
+        id->i_seq_sent_next =
+            ntohs(((uint16_t *) batch[count - 1]->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+
+        for( unsigned i = 0; i < count; i++ )
+            block_Release( batch[i] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
@@ -1450,7 +1553,8 @@ static void *rtp_listen_thread( void *data )
 
 int rtp_add_sink( sout_stream_id_sys_t *id, int fd, bool rtcp_mux, uint16_t *seq )
 {
-    rtp_sink_t sink = { fd, NULL };
+    rtp_sink_t sink = { .rtp_fd = fd, .rtcp = NULL };
+    sout_dgram_Init( &sink.dgram, fd, false );
     sink.rtcp = OpenRTCP( VLC_OBJECT( id->p_stream ), fd, IPPROTO_UDP,
                           rtcp_mux );
     if( sink.rtcp == NULL )
@@ -1466,7 +1570,8 @@ int rtp_add_sink( sout_stream_id_sys_t *id, int fd, bool rtcp_mux, uint16_t *seq
 
 void rtp_del_sink( sout_stream_id_sys_t *id, int fd )
 {
-    rtp_sink_t sink = { fd, NULL };
+    rtp_sink_t sink = { .rtp_fd = fd, .rtcp = NULL };
+    sout_dgram_Init( &sink.dgram, fd, false );
 
     /* NOTE: must be safe to use if fd is not included */
     vlc_mutex_lock( &id->lock_sink );
@@ -1476,11 +1581,18 @@ void rtp_del_sink( sout_stream_id_sys_t *id, int fd )
         {
             sink = id->sinkv[i];
             TAB_ERASE(id->sinkc, id->sinkv, i);
+            sout_dgram_Merge( &id->stats, &sink.dgram.stats );
             break;
         }
     }
     vlc_mutex_unlock( &id->lock_sink );
 
+    const struct sout_dgram_stats *stats = &sink.dgram.stats;
+    if( stats->calls > 0 )
+        msg_Dbg( id->p_stream, "socket %d: sent %"PRIu64" packets in %"PRIu64
+                 " calls, %.2f packets per call", fd, stats->packets,
+                 stats->calls, (double)stats->packets / stats->calls );
+
     CloseRTCP( sink.rtcp );
     net_Close( sink.rtp_fd );
 }
@@ -373,6 +373,8 @@ static int Control( sout_stream_t *p_stream, int i_query, va_list args )
         {
             return sout_StreamControl(p_stream->p_next, i_query, va_arg(args, bool *));
         }
+        case SOUT_STREAM_GET_STATS:
+            return sout_StreamControlVa( p_stream->p_next, i_query, args );
     }
     return VLC_EGENERIC;
 }
@@ -38,7 +38,12 @@
 
 #include <vlc_network.h>
 #include <vlc_memstream.h>
+#include <vlc_queue.h>
 #include "sdp_helper.h"
+#include "dgram.h"
+
+/* Maximum number of blocks gathered into a single datagram */
+#define IOV_PER_DGRAM 16
 
 struct sout_stream_udp
 {
@@ -47,6 +52,17 @@ struct sout_stream_udp
     session_descriptor_t *sap;
     int fd;
     uint_fast16_t mtu;
+    unsigned batch;
+    vlc_mutex_t lock; /* protects the dgram counters */
+    struct sout_dgram dgram;
+    struct sout_pacer pacer;
+    /* When pacing, datagrams are sent by a thread, so that the muxer does not
+     * wait with the stream output lock held */
+    vlc_thread_t thread;
+    vlc_queue_t queue;
+    bool dead;
+    struct msghdr msgv[SOUT_DGRAM_BATCH_MAX];
+    struct iovec iov[SOUT_DGRAM_BATCH_MAX * IOV_PER_DGRAM];
 };
 
 static void *
@@ -131,52 +147,107 @@ static session_descriptor_t *CreateSDP(vlc_object_t *obj, int fd)
 
 static int Control(sout_stream_t *stream, int query, va_list args)
 {
+    struct sout_stream_udp *sys = stream->p_sys;
+
     switch (query) {
         case SOUT_STREAM_IS_SYNCHRONOUS:
             *va_arg(args, bool *) = true;
             break;
 
+        case SOUT_STREAM_GET_STATS:
+            vlc_mutex_lock(&sys->lock);
+            sout_dgram_Report(va_arg(args, struct sout_stream_stats *),
+                              &sys->dgram.stats);
+            vlc_mutex_unlock(&sys->lock);
+            break;
+
         default:
             return VLC_EGENERIC;
     }
 
-    (void) stream;
     return VLC_SUCCESS;
 }
 
-static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
+/**
+ * Gathers blocks into a single datagram, up to the MTU.
+ *
+ * \return the datagram size
+ */
+static size_t Gather(const struct sout_stream_udp *sys, block_t **restrict pp,
+                     struct iovec *iov, size_t *restrict iovlen)
+{
+    block_t *unsent = *pp;
+    size_t tosend = 0;
+
+    *iovlen = 0;
+    do {
+        if (*iovlen >= IOV_PER_DGRAM)
+            break;
+        if (unsent->i_buffer + tosend > sys->mtu && likely(*iovlen > 0))
+            break;
+
+        iov[*iovlen].iov_base = unsent->p_buffer;
+        iov[*iovlen].iov_len = unsent->i_buffer;
+        (*iovlen)++;
+        tosend += unsent->i_buffer;
+        unsent = unsent->p_next;
+    } while (unsent != NULL);
+
+    *pp = unsent;
+    return tosend;
+}
+
+static ssize_t Write(struct sout_stream_udp *sys, block_t *block)
 {
-    struct sout_stream_udp *sys = access->p_sys;
     ssize_t total = 0;
 
     while (block != NULL) {
-        struct iovec iov[16];
         block_t *unsent = block;
-        unsigned iovlen = 0;
-        size_t tosend = 0;
+        struct iovec *iov = sys->iov;
+        unsigned msgc = 0;
+        vlc_tick_t now = vlc_tick_now();
 
-        /* Count how many blocks to gather */
+        /* Gather as many datagrams as the pacer lets through */
         do {
-            if (iovlen >= ARRAY_SIZE(iov))
-                break;
-            if (unsent->i_buffer + tosend > sys->mtu && likely(iovlen > 0))
-                break;
-
-            iov[iovlen].iov_base = unsent->p_buffer;
-            iov[iovlen].iov_len = unsent->i_buffer;
-            iovlen++;
-            tosend += unsent->i_buffer;
-            unsent = unsent->p_next;
-        } while (unsent != NULL);
+            block_t *first = unsent;
+            size_t iovlen;
+            size_t len = Gather(sys, &unsent, iov, &iovlen);
+
+            if (sys->pacer.rate != 0) {
+                vlc_tick_t when = sout_pacer_When(&sys->pacer, now);
+
+                if (when > now) {
+                    if (msgc > 0) {
+                        unsent = first;
+                        break;
+                    }
+                    vlc_tick_wait(when);
+                    now = vlc_tick_now();
+                    vlc_mutex_lock(&sys->lock);
+                    sout_dgram_Slip(&sys->dgram.stats, now - when);
+                    vlc_mutex_unlock(&sys->lock);
+                }
+                sout_pacer_Consume(&sys->pacer, len, now);
+            }
+
+            sys->msgv[msgc++] = (struct msghdr) {
+                .msg_iov = iov,
+                .msg_iovlen = iovlen,
+            };
+            iov += iovlen;
+        } while (unsent != NULL && msgc < sys->batch);
 
         /* Send */
-        struct msghdr hdr = { .msg_iov = iov, .msg_iovlen = iovlen };
-        ssize_t val = sendmsg(sys->fd, &hdr, 0);
+        vlc_mutex_lock(&sys->lock);
+        int val = sout_dgram_Send(&sys->dgram, sys->msgv, msgc);
+        vlc_mutex_unlock(&sys->lock);
 
-        if (val < 0)
-            msg_Err(access, "send error: %s", vlc_strerror_c(errno));
-        else
-            total += val;
+        if (val < (int)msgc)
+            msg_Err(sys->access, "send error: %s", vlc_strerror_c(errno));
+
+        for (int i = 0; i < val; i++)
+            for (size_t j = 0; j < (size_t)sys->msgv[i].msg_iovlen; j++)
+                total += sys->msgv[i].msg_iov[j].iov_len;
 
         /* Free */
         do {
@@ -190,6 +261,38 @@ static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
     return total;
 }
 
+static void *Thread(void *data)
+{
+    struct sout_stream_udp *sys = data;
+    block_t *block;
+
+    vlc_thread_set_name("vlc-udp-send");
+
+    /* Send whatever was queued, until the queue is ended and empty */
+    while ((block = vlc_queue_DequeueKillable(&sys->queue,
+                                              &sys->dead)) != NULL) {
+        vlc_queue_Lock(&sys->queue);
+        block->p_next = vlc_queue_DequeueAllUnlocked(&sys->queue);
+        vlc_queue_Unlock(&sys->queue);
+        Write(sys, block);
+    }
+    return NULL;
+}
+
+static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
+{
+    struct sout_stream_udp *sys = access->p_sys;
+
+    if (sys->pacer.rate == 0)
+        return Write(sys, block);
+
+    size_t total;
+
+    block_ChainProperties(block, NULL, &total, NULL);
+    vlc_queue_Enqueue(&sys->queue, block);
+    return total;
+}
+
 static void Close(sout_stream_t *stream)
 {
     struct sout_stream_udp *sys = stream->p_sys;
@@ -198,6 +301,11 @@ static void Close(sout_stream_t *stream)
         sout_AnnounceUnRegister(stream, sys->sap);
 
     sout_MuxDelete(sys->mux);
+
+    if (sys->pacer.rate != 0) {
+        vlc_queue_Kill(&sys->queue, &sys->dead);
+        vlc_join(sys->thread, NULL);
+    }
     sout_AccessOutDelete(sys->access);
     net_Close(sys->fd);
     free(sys);
@@ -213,7 +321,8 @@ static const struct sout_stream_operations ops = {
 };
 
 static const char *const chain_options[] = {
-    "avformat", "dst", "sap", "name", "description", NULL
+    "avformat", "dst", "sap", "name", "description", "batch", "gso", "rate",
+    "burst", NULL
 };
 
 #define DEFAULT_PORT 1234
@@ -311,6 +420,13 @@ static int Open(vlc_object_t *obj)
     sys->access = access;
     sys->fd = fd;
     sys->mtu = var_InheritInteger(stream, "mtu");
+    sys->batch = var_GetInteger(stream, SOUT_CFG_PREFIX "batch");
+    vlc_mutex_init(&sys->lock);
+    sout_dgram_Init(&sys->dgram, fd, var_GetBool(stream, SOUT_CFG_PREFIX "gso"));
+    sout_pacer_Init(&sys->pacer, var_GetInteger(stream, SOUT_CFG_PREFIX "rate"),
+                    var_GetInteger(stream, SOUT_CFG_PREFIX "burst") * sys->mtu);
+    vlc_queue_Init(&sys->queue, offsetof (block_t, p_next));
+    sys->dead = false;
 
     sout_mux_t *mux = sout_MuxNew(access, muxmod);
     if (mux == NULL) {
@@ -319,6 +435,14 @@ static int Open(vlc_object_t *obj)
     }
     sys->mux = mux;
 
+    if (sys->pacer.rate != 0
+     && vlc_clone(&sys->thread, Thread, sys)) {
+        sout_MuxDelete(mux);
+        block_ChainRelease(vlc_queue_DequeueAll(&sys->queue));
+        ret = VLC_ENOMEM;
+        goto error;
+    }
+
     if (var_GetBool(stream, SOUT_CFG_PREFIX "sap"))
         sys->sap = CreateSDP(VLC_OBJECT(stream), fd);
     else
@@ -349,6 +473,20 @@ error:
 #define DESC_TEXT N_("SAP description")
 #define DESC_LONGTEXT N_( \
     "Short description of the stream that will be announced with SAP.")
+#define BATCH_TEXT N_("Datagrams per send call")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams handed to the operating system at once.")
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_( \
+    "Let the kernel or network device split batches of datagrams, " \
+    "if supported.")
+#define RATE_TEXT N_("Pacing rate (bits/s)")
+#define RATE_LONGTEXT N_( \
+    "Smooth the output to this bit rate, including bursts from the muxer. " \
+    "Set to 0 to send datagrams as soon as they are muxed.")
+#define BURST_TEXT N_("Pacing burst (datagrams)")
+#define BURST_LONGTEXT N_( \
+    "Number of datagrams that can be sent back-to-back when pacing.")
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -362,6 +500,13 @@ vlc_module_begin()
     add_bool(SOUT_CFG_PREFIX "sap", false, SAP_TEXT, SAP_LONGTEXT)
     add_string(SOUT_CFG_PREFIX "name", "", NAME_TEXT, NAME_LONGTEXT)
     add_string(SOUT_CFG_PREFIX "description", "", DESC_TEXT, DESC_LONGTEXT)
+    add_integer_with_range(SOUT_CFG_PREFIX "batch", SOUT_DGRAM_BATCH_MAX,
+                           1, SOUT_DGRAM_BATCH_MAX, BATCH_TEXT, BATCH_LONGTEXT)
+    add_bool(SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT)
+    add_integer_with_range(SOUT_CFG_PREFIX "rate", 0, 0, UINT32_MAX,
+                           RATE_TEXT, RATE_LONGTEXT)
+    add_integer_with_range(SOUT_CFG_PREFIX "burst", 7, 1, SOUT_DGRAM_BATCH_MAX,
+                           BURST_TEXT, BURST_LONGTEXT)
 
     set_callback(Open)
 vlc_module_end()
@@ -1166,9 +1166,29 @@ done:
     return region;
 }
 
+static uint64_t RenderGeneration( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int64_t settings[ARRAY_SIZE(p_sys->live_settings)] = {
+        var_InheritInteger( p_filter, "sub-text-scale" ),
+        var_InheritInteger( p_filter, "freetype-color" ),
+        var_InheritInteger( p_filter, "freetype-background-opacity" ),
+        var_InheritInteger( p_filter, "freetype-background-color" ),
+        var_InheritInteger( p_filter, "freetype-outline-thickness" ),
+    };
+
+    if( memcmp( settings, p_sys->live_settings, sizeof( settings ) ) )
+    {
+        memcpy( p_sys->live_settings, settings, sizeof( settings ) );
+        p_sys->i_generation++;
+    }
+    return p_sys->i_generation;
+}
+
 static const struct vlc_filter_operations filter_ops =
 {
-    .render = Render, .close = Destroy,
+    .render = Render, .render_generation = RenderGeneration,
+    .close = Destroy,
 };
 
 /*****************************************************************************
@@ -108,6 +108,10 @@ typedef struct
     int               i_font_default_size;
     int               i_outline_thickness;
 
+    /* Settings read on each rendering, and their generation */
+    int64_t           live_settings[5];
+    uint64_t          i_generation;
+
     vlc_fourcc_t      i_forced_chroma;
 
     vlc_font_select_t *fs;
@@ -54,7 +54,9 @@ static void CopyPlane(uint8_t *dst, size_t dst_pitch,
 int CopyInitCache(copy_cache_t *cache, unsigned width)
 {
 #ifdef CAN_COMPILE_SSE2
-    cache->size = __MAX((width + 0x3f) & ~ 0x3f, 16384);
+    /* Lines are 64 bytes aligned for the AVX-512 kernels, and both chroma
+     * lines must fit */
+    cache->size = __MAX((width + 0x7f) & ~ 0x7f, 16384);
     cache->buffer = aligned_alloc(64, cache->size);
     if (!cache->buffer)
         return VLC_EGENERIC;
@@ -122,6 +124,10 @@ void CopyCleanCache(copy_cache_t *cache)
     COPY64_S(dstp, srcp, load, store, "")
 
 #ifdef COPY_TEST_NOOPTIM
+# undef vlc_CPU_AVX512
+# define vlc_CPU_AVX512() (0)
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() (0)
 # undef vlc_CPU_SSE4_1
 # define vlc_CPU_SSE4_1() (0)
 # undef vlc_CPU_SSE3
@@ -130,8 +136,539 @@ void CopyCleanCache(copy_cache_t *cache)
 # define vlc_CPU_SSSE3() (0)
 # undef vlc_CPU_SSE2
 # define vlc_CPU_SSE2() (0)
+#elif defined(COPY_TEST)
+/* The test restricts the CPU capabilities to check each set of kernels */
+static unsigned test_cpu = -1U;
+# define TEST_CPU(flag) ((vlc_CPU() & test_cpu & (flag)) != 0)
+# undef vlc_CPU_AVX512
+# define vlc_CPU_AVX512() TEST_CPU(VLC_CPU_AVX512)
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() TEST_CPU(VLC_CPU_AVX2)
+# undef vlc_CPU_SSE4_1
+# define vlc_CPU_SSE4_1() TEST_CPU(VLC_CPU_SSE4_1)
+# undef vlc_CPU_SSE3
+# define vlc_CPU_SSE3() TEST_CPU(VLC_CPU_SSE3)
+# undef vlc_CPU_SSSE3
+# define vlc_CPU_SSSE3() TEST_CPU(VLC_CPU_SSSE3)
+# undef vlc_CPU_SSE2
+# define vlc_CPU_SSE2() TEST_CPU(VLC_CPU_SSE2)
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+/* Copy 32/128 bytes from srcp to dstp with the AVX2 instructions load and
+ * store. The cache lines are 32 bytes aligned.
+ */
+
+#define COPY32_SHIFTR(x) \
+    "vpsrlw "x", %%ymm1, %%ymm1\n"
+#define COPY32_SHIFTL(x) \
+    "vpsllw "x", %%ymm1, %%ymm1\n"
+
+#define COPY32_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        shiftstr                        \
+        store " %%ymm1,    0(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1")
+
+#define COPY128_SHIFTR(x) \
+    "vpsrlw "x", %%ymm1, %%ymm1\n" \
+    "vpsrlw "x", %%ymm2, %%ymm2\n" \
+    "vpsrlw "x", %%ymm3, %%ymm3\n" \
+    "vpsrlw "x", %%ymm4, %%ymm4\n"
+#define COPY128_SHIFTL(x) \
+    "vpsllw "x", %%ymm1, %%ymm1\n" \
+    "vpsllw "x", %%ymm2, %%ymm2\n" \
+    "vpsllw "x", %%ymm3, %%ymm3\n" \
+    "vpsllw "x", %%ymm4, %%ymm4\n"
+
+#define COPY128_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        load " 32(%[src]), %%ymm2\n"    \
+        load " 64(%[src]), %%ymm3\n"    \
+        load " 96(%[src]), %%ymm4\n"    \
+        shiftstr                        \
+        store " %%ymm1,    0(%[dst])\n" \
+        store " %%ymm2,   32(%[dst])\n" \
+        store " %%ymm3,   64(%[dst])\n" \
+        store " %%ymm4,   96(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
+
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height, int bitshift)
+{
+    assert(((intptr_t)dst & 0x1f) == 0 && (dst_pitch & 0x1f) == 0);
+
+    asm volatile ("mfence");
+
+#define AVX2_USWC_COPY(shiftstr32, shiftstr128) \
+    for (unsigned y = 0; y < height; y++) { \
+        const unsigned unaligned = (-(uintptr_t)src) & 0x1f; \
+        unsigned x = 0; \
+        if (width >= unaligned + 32) { \
+            if (!unaligned) { \
+                for (; x+127 < width; x += 128) \
+                    COPY128_S(&dst[x], &src[x], "vmovntdqa", "vmovdqa", shiftstr128); \
+            } else { \
+                COPY32_S(dst, src, "vmovdqu", "vmovdqa", shiftstr32); \
+                for (x = unaligned; x+127 < width; x += 128) \
+                    COPY128_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu", shiftstr128); \
+            } \
+            for (; x+31 < width; x += 32) \
+                COPY32_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu", shiftstr32); \
+        } \
+        if (x < width) \
+            CopyPlane(&dst[x], dst_pitch - x, &src[x], src_pitch - x, 1, bitshift); \
+        src += src_pitch; \
+        dst += dst_pitch; \
+    }
+
+    switch (bitshift)
+    {
+        case 0:
+            AVX2_USWC_COPY("", "")
+            break;
+        case -6:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$6"), COPY128_SHIFTL("$6"))
+            break;
+        case 6:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$6"), COPY128_SHIFTR("$6"))
+            break;
+        case 2:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$2"), COPY128_SHIFTR("$2"))
+            break;
+        case -2:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$2"), COPY128_SHIFTL("$2"))
+            break;
+        case 4:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$4"), COPY128_SHIFTR("$4"))
+            break;
+        case -4:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$4"), COPY128_SHIFTL("$4"))
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+#undef AVX2_USWC_COPY
+
+    asm volatile ("mfence\n"
+                  "vzeroupper" ::: "memory");
+}
+
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    assert(((intptr_t)src & 0x1f) == 0 && (src_pitch & 0x1f) == 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        bool unaligned = ((intptr_t)dst & 0x1f) != 0;
+        if (!unaligned) {
+            for (; x+127 < width; x += 128)
+                COPY128_S(&dst[x], &src[x], "vmovdqa", "vmovntdq", "");
+        } else {
+            for (; x+127 < width; x += 128)
+                COPY128_S(&dst[x], &src[x], "vmovdqa", "vmovdqu", "");
+        }
+        for (; x+31 < width; x += 32)
+            COPY32_S(&dst[x], &src[x], "vmovdqa", "vmovdqu", "");
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+
+    asm volatile ("sfence\n"
+                  "vzeroupper" ::: "memory");
+}
+
+static void AVX2_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned int width, unsigned int height,
+                              uint8_t pixel_size)
+{
+    assert(!((intptr_t)srcu & 0x1f) && !(srcu_pitch & 0x1f) &&
+           !((intptr_t)srcv & 0x1f) && !(srcv_pitch & 0x1f));
+
+    /* The unpacking works within 128-bits lanes: the halves are swapped
+     * back in place before storing. */
+#define INTERLEAVE64(unpckl, unpckh)                    \
+    asm volatile (                                      \
+        "vmovdqa (%[src1]), %%ymm0\n"                   \
+        "vmovdqa (%[src2]), %%ymm1\n"                   \
+        unpckl " %%ymm1, %%ymm0, %%ymm2\n"              \
+        unpckh " %%ymm1, %%ymm0, %%ymm3\n"              \
+        "vperm2i128 $0x20, %%ymm3, %%ymm2, %%ymm0\n"    \
+        "vperm2i128 $0x31, %%ymm3, %%ymm2, %%ymm1\n"    \
+        "vmovdqu %%ymm0,  0(%[dst])\n"                  \
+        "vmovdqu %%ymm1, 32(%[dst])\n"                  \
+        : : [dst]"r"(dst+2*x),                          \
+            [src1]"r"(srcu+x), [src2]"r"(srcv+x)        \
+        : "memory", "xmm0", "xmm1", "xmm2", "xmm3")
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        unsigned int x = 0;
+
+        if (pixel_size == 1)
+        {
+            for (; x < (width & ~31); x += 32)
+                INTERLEAVE64("vpunpcklbw", "vpunpckhbw");
+            for (; x < width; x++) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcv[x];
+            }
+        }
+        else
+        {
+            for (; x < (width & ~31); x += 32)
+                INTERLEAVE64("vpunpcklwd", "vpunpckhwd");
+            for (; x < width; x+= 2) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcu[x + 1];
+                dst[2*x+2] = srcv[x];
+                dst[2*x+3] = srcv[x + 1];
+            }
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst += dst_pitch;
+    }
+#undef INTERLEAVE64
+
+    asm volatile ("vzeroupper");
+}
+
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height, uint8_t pixel_size)
+{
+    assert(pixel_size == 1 || pixel_size == 2);
+    assert(((intptr_t)src & 0x1f) == 0 && (src_pitch & 0x1f) == 0);
+
+    static const uint8_t shuffle_8[] = { 0, 2, 4, 6, 8, 10, 12, 14,
+                                         1, 3, 5, 7, 9, 11, 13, 15 };
+    static const uint8_t shuffle_16[] = {  0,  1,  4,  5,  8,  9, 12, 13,
+                                           2,  3,  6,  7, 10, 11, 14, 15 };
+    const uint8_t *shuffle = pixel_size == 1 ? shuffle_8 : shuffle_16;
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+        /* Each lane is split in its U and V halves, then the 64-bits
+         * quarters are gathered per plane. */
+        for (; x < (width & ~31); x += 32)
+            asm volatile (
+                "vbroadcasti128 (%[shuffle]), %%ymm7\n"
+                "vmovdqa  0(%[src]), %%ymm0\n"
+                "vmovdqa 32(%[src]), %%ymm1\n"
+                "vpshufb %%ymm7, %%ymm0, %%ymm0\n"
+                "vpshufb %%ymm7, %%ymm1, %%ymm1\n"
+                "vpermq $0xd8, %%ymm0, %%ymm0\n"
+                "vpermq $0xd8, %%ymm1, %%ymm1\n"
+                "vperm2i128 $0x20, %%ymm1, %%ymm0, %%ymm2\n"
+                "vperm2i128 $0x31, %%ymm1, %%ymm0, %%ymm3\n"
+                "vmovdqu %%ymm2, (%[dst1])\n"
+                "vmovdqu %%ymm3, (%[dst2])\n"
+                : : [dst1]"r"(&dstu[x]), [dst2]"r"(&dstv[x]),
+                    [src]"r"(&src[2*x]), [shuffle]"r"(shuffle)
+                : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+
+        if (pixel_size == 1)
+        {
+            for (; x < width; x++) {
+                dstu[x] = src[2*x+0];
+                dstv[x] = src[2*x+1];
+            }
+        }
+        else
+        {
+            for (; x < width; x+= 2) {
+                dstu[x] = src[2*x+0];
+                dstu[x+1] = src[2*x+1];
+                dstv[x] = src[2*x+2];
+                dstv[x+1] = src[2*x+3];
+            }
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+
+    asm volatile ("vzeroupper");
+}
+#undef COPY128_S
+#undef COPY32_S
+#endif /* CAN_COMPILE_AVX2 */
+
+#ifdef CAN_COMPILE_AVX512
+/* Copy 64/256 bytes from srcp to dstp with the AVX-512 (F and BW)
+ * instructions load and store. The cache lines are 64 bytes aligned.
+ */
+
+#define COPYZ64_SHIFTR(x) \
+    "vpsrlw "x", %%zmm1, %%zmm1\n"
+#define COPYZ64_SHIFTL(x) \
+    "vpsllw "x", %%zmm1, %%zmm1\n"
+
+#define COPYZ64_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "  0(%[src]), %%zmm1\n"    \
+        shiftstr                        \
+        store " %%zmm1,    0(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "zmm1")
+
+#define COPYZ256_SHIFTR(x) \
+    "vpsrlw "x", %%zmm1, %%zmm1\n" \
+    "vpsrlw "x", %%zmm2, %%zmm2\n" \
+    "vpsrlw "x", %%zmm3, %%zmm3\n" \
+    "vpsrlw "x", %%zmm4, %%zmm4\n"
+#define COPYZ256_SHIFTL(x) \
+    "vpsllw "x", %%zmm1, %%zmm1\n" \
+    "vpsllw "x", %%zmm2, %%zmm2\n" \
+    "vpsllw "x", %%zmm3, %%zmm3\n" \
+    "vpsllw "x", %%zmm4, %%zmm4\n"
+
+#define COPYZ256_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "   0(%[src]), %%zmm1\n"   \
+        load "  64(%[src]), %%zmm2\n"   \
+        load " 128(%[src]), %%zmm3\n"   \
+        load " 192(%[src]), %%zmm4\n"   \
+        shiftstr                        \
+        store " %%zmm1,     0(%[dst])\n" \
+        store " %%zmm2,    64(%[dst])\n" \
+        store " %%zmm3,   128(%[dst])\n" \
+        store " %%zmm4,   192(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "zmm1", "zmm2", "zmm3", "zmm4")
+
+static void AVX512_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                                const uint8_t *src, size_t src_pitch,
+                                unsigned width, unsigned height, int bitshift)
+{
+    assert(((intptr_t)dst & 0x3f) == 0 && (dst_pitch & 0x3f) == 0);
+
+    asm volatile ("mfence");
+
+#define AVX512_USWC_COPY(shiftstr64, shiftstr256) \
+    for (unsigned y = 0; y < height; y++) { \
+        const unsigned unaligned = (-(uintptr_t)src) & 0x3f; \
+        unsigned x = 0; \
+        if (width >= unaligned + 64) { \
+            if (!unaligned) { \
+                for (; x+255 < width; x += 256) \
+                    COPYZ256_S(&dst[x], &src[x], "vmovntdqa", "vmovdqa64", shiftstr256); \
+            } else { \
+                COPYZ64_S(dst, src, "vmovdqu64", "vmovdqa64", shiftstr64); \
+                for (x = unaligned; x+255 < width; x += 256) \
+                    COPYZ256_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu64", shiftstr256); \
+            } \
+            for (; x+63 < width; x += 64) \
+                COPYZ64_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu64", shiftstr64); \
+        } \
+        if (x < width) \
+            CopyPlane(&dst[x], dst_pitch - x, &src[x], src_pitch - x, 1, bitshift); \
+        src += src_pitch; \
+        dst += dst_pitch; \
+    }
+
+    switch (bitshift)
+    {
+        case 0:
+            AVX512_USWC_COPY("", "")
+            break;
+        case -6:
+            AVX512_USWC_COPY(COPYZ64_SHIFTL("$6"), COPYZ256_SHIFTL("$6"))
+            break;
+        case 6:
+            AVX512_USWC_COPY(COPYZ64_SHIFTR("$6"), COPYZ256_SHIFTR("$6"))
+            break;
+        case 2:
+            AVX512_USWC_COPY(COPYZ64_SHIFTR("$2"), COPYZ256_SHIFTR("$2"))
+            break;
+        case -2:
+            AVX512_USWC_COPY(COPYZ64_SHIFTL("$2"), COPYZ256_SHIFTL("$2"))
+            break;
+        case 4:
+            AVX512_USWC_COPY(COPYZ64_SHIFTR("$4"), COPYZ256_SHIFTR("$4"))
+            break;
+        case -4:
+            AVX512_USWC_COPY(COPYZ64_SHIFTL("$4"), COPYZ256_SHIFTL("$4"))
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+#undef AVX512_USWC_COPY
+
+    asm volatile ("mfence\n"
+                  "vzeroupper" ::: "memory");
+}
+
+static void AVX512_Copy2d(uint8_t *dst, size_t dst_pitch,
+                          const uint8_t *src, size_t src_pitch,
+                          unsigned width, unsigned height)
+{
+    assert(((intptr_t)src & 0x3f) == 0 && (src_pitch & 0x3f) == 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        bool unaligned = ((intptr_t)dst & 0x3f) != 0;
+        if (!unaligned) {
+            for (; x+255 < width; x += 256)
+                COPYZ256_S(&dst[x], &src[x], "vmovdqa64", "vmovntdq", "");
+        } else {
+            for (; x+255 < width; x += 256)
+                COPYZ256_S(&dst[x], &src[x], "vmovdqa64", "vmovdqu64", "");
+        }
+        for (; x+63 < width; x += 64)
+            COPYZ64_S(&dst[x], &src[x], "vmovdqa64", "vmovdqu64", "");
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+
+    asm volatile ("sfence\n"
+                  "vzeroupper" ::: "memory");
+}
+
+static void AVX512_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                                const uint8_t *srcu, size_t srcu_pitch,
+                                const uint8_t *srcv, size_t srcv_pitch,
+                                unsigned int width, unsigned int height,
+                                uint8_t pixel_size)
+{
+    assert(!((intptr_t)srcu & 0x3f) && !(srcu_pitch & 0x3f) &&
+           !((intptr_t)srcv & 0x3f) && !(srcv_pitch & 0x3f));
+
+    /* 64-bits quarters of the low and high unpacked lanes, in order */
+    static const uint64_t order[16] = { 0, 1,  8,  9, 2, 3, 10, 11,
+                                        4, 5, 12, 13, 6, 7, 14, 15 };
+
+#define INTERLEAVE128(unpckl, unpckh)                   \
+    asm volatile (                                      \
+        "vmovdqa64 (%[src1]), %%zmm0\n"                 \
+        "vmovdqa64 (%[src2]), %%zmm1\n"                 \
+        "vmovdqu64   (%[order]), %%zmm4\n"              \
+        "vmovdqu64 64(%[order]), %%zmm5\n"              \
+        unpckl " %%zmm1, %%zmm0, %%zmm2\n"              \
+        unpckh " %%zmm1, %%zmm0, %%zmm3\n"              \
+        "vpermi2q %%zmm3, %%zmm2, %%zmm4\n"             \
+        "vpermi2q %%zmm3, %%zmm2, %%zmm5\n"             \
+        "vmovdqu64 %%zmm4,  0(%[dst])\n"                \
+        "vmovdqu64 %%zmm5, 64(%[dst])\n"                \
+        : : [dst]"r"(dst+2*x),                          \
+            [src1]"r"(srcu+x), [src2]"r"(srcv+x),       \
+            [order]"r"(order)                           \
+        : "memory", "zmm0", "zmm1", "zmm2", "zmm3", "zmm4", "zmm5")
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        unsigned int x = 0;
+
+        if (pixel_size == 1)
+        {
+            for (; x < (width & ~63); x += 64)
+                INTERLEAVE128("vpunpcklbw", "vpunpckhbw");
+            for (; x < width; x++) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcv[x];
+            }
+        }
+        else
+        {
+            for (; x < (width & ~63); x += 64)
+                INTERLEAVE128("vpunpcklwd", "vpunpckhwd");
+            for (; x < width; x+= 2) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcu[x + 1];
+                dst[2*x+2] = srcv[x];
+                dst[2*x+3] = srcv[x + 1];
+            }
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst += dst_pitch;
+    }
+#undef INTERLEAVE128
+
+    asm volatile ("vzeroupper");
+}
+
+static void AVX512_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                           uint8_t *dstv, size_t dstv_pitch,
+                           const uint8_t *src, size_t src_pitch,
+                           unsigned width, unsigned height, uint8_t pixel_size)
+{
+    assert(pixel_size == 1 || pixel_size == 2);
+    assert(((intptr_t)src & 0x3f) == 0 && (src_pitch & 0x3f) == 0);
+
+    static const uint8_t shuffle_8[] = { 0, 2, 4, 6, 8, 10, 12, 14,
+                                         1, 3, 5, 7, 9, 11, 13, 15 };
+    static const uint8_t shuffle_16[] = {  0,  1,  4,  5,  8,  9, 12, 13,
+                                           2,  3,  6,  7, 10, 11, 14, 15 };
+    /* Even 64-bits quarters hold U, odd ones hold V */
+    static const uint64_t order[16] = { 0, 2, 4,  6,  8, 10, 12, 14,
+                                        1, 3, 5,  7,  9, 11, 13, 15 };
+    const uint8_t *shuffle = pixel_size == 1 ? shuffle_8 : shuffle_16;
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+        for (; x < (width & ~63); x += 64)
+            asm volatile (
+                "vbroadcasti32x4 (%[shuffle]), %%zmm7\n"
+                "vmovdqu64   (%[order]), %%zmm2\n"
+                "vmovdqu64 64(%[order]), %%zmm3\n"
+                "vmovdqa64  0(%[src]), %%zmm0\n"
+                "vmovdqa64 64(%[src]), %%zmm1\n"
+                "vpshufb %%zmm7, %%zmm0, %%zmm0\n"
+                "vpshufb %%zmm7, %%zmm1, %%zmm1\n"
+                "vpermi2q %%zmm1, %%zmm0, %%zmm2\n"
+                "vpermi2q %%zmm1, %%zmm0, %%zmm3\n"
+                "vmovdqu64 %%zmm2, (%[dst1])\n"
+                "vmovdqu64 %%zmm3, (%[dst2])\n"
+                : : [dst1]"r"(&dstu[x]), [dst2]"r"(&dstv[x]),
+                    [src]"r"(&src[2*x]), [shuffle]"r"(shuffle),
+                    [order]"r"(order)
+                : "memory", "zmm0", "zmm1", "zmm2", "zmm3", "zmm7");
+
+        if (pixel_size == 1)
+        {
+            for (; x < width; x++) {
+                dstu[x] = src[2*x+0];
+                dstv[x] = src[2*x+1];
+            }
+        }
+        else
+        {
+            for (; x < width; x+= 2) {
+                dstu[x] = src[2*x+0];
+                dstu[x+1] = src[2*x+1];
+                dstv[x] = src[2*x+2];
+                dstv[x+1] = src[2*x+3];
+            }
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+
+    asm volatile ("vzeroupper");
+}
+#undef COPYZ256_S
+#undef COPYZ64_S
+#endif /* CAN_COMPILE_AVX512 */
+
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
  * XXX It is really efficient only when SSE4.1 is available.
@@ -141,6 +678,17 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
                          const uint8_t *src, size_t src_pitch,
                          unsigned width, unsigned height, int bitshift)
 {
+#ifdef CAN_COMPILE_AVX512
+    if (vlc_CPU_AVX512())
+        return AVX512_CopyFromUswc(dst, dst_pitch, src, src_pitch,
+                                   width, height, bitshift);
+#endif
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_CopyFromUswc(dst, dst_pitch, src, src_pitch,
+                                 width, height, bitshift);
+#endif
+
     assert(((intptr_t)dst & 0x0f) == 0 && (dst_pitch & 0x0f) == 0);
 
     asm volatile ("mfence");
@@ -196,7 +744,7 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
             SSE_USWC_COPY(COPY16_SHIFTR("$4"), COPY64_SHIFTR("$4"))
             break;
         case -4:
-            SSE_USWC_COPY(COPY16_SHIFTL("$2"), COPY64_SHIFTL("$2"))
+            SSE_USWC_COPY(COPY16_SHIFTL("$4"), COPY64_SHIFTL("$4"))
             break;
         default:
             vlc_assert_unreachable();
@@ -211,6 +759,15 @@ static void Copy2d(uint8_t *dst, size_t dst_pitch,
                    const uint8_t *src, size_t src_pitch,
                    unsigned width, unsigned height)
 {
+#ifdef CAN_COMPILE_AVX512
+    if (vlc_CPU_AVX512())
+        return AVX512_Copy2d(dst, dst_pitch, src, src_pitch, width, height);
+#endif
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_Copy2d(dst, dst_pitch, src, src_pitch, width, height);
+#endif
+
     assert(((intptr_t)src & 0x0f) == 0 && (src_pitch & 0x0f) == 0);
 
     for (unsigned y = 0; y < height; y++) {
@@ -240,6 +797,17 @@ SSE_InterleaveUV(uint8_t *dst, size_t dst_pitch,
                  uint8_t *srcv, size_t srcv_pitch,
                  unsigned int width, unsigned int height, uint8_t pixel_size)
 {
+#ifdef CAN_COMPILE_AVX512
+    if (vlc_CPU_AVX512())
+        return AVX512_InterleaveUV(dst, dst_pitch, srcu, srcu_pitch,
+                                   srcv, srcv_pitch, width, height, pixel_size);
+#endif
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_InterleaveUV(dst, dst_pitch, srcu, srcu_pitch,
+                                 srcv, srcv_pitch, width, height, pixel_size);
+#endif
+
     assert(!((intptr_t)srcu & 0xf) && !(srcu_pitch & 0x0f) &&
            !((intptr_t)srcv & 0xf) && !(srcv_pitch & 0x0f));
 
@@ -355,6 +923,17 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
                         const uint8_t *src, size_t src_pitch,
                         unsigned width, unsigned height, uint8_t pixel_size)
 {
+#ifdef CAN_COMPILE_AVX512
+    if (vlc_CPU_AVX512())
+        return AVX512_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                              src, src_pitch, width, height, pixel_size);
+#endif
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                            src, src_pitch, width, height, pixel_size);
+#endif
+
     assert(pixel_size == 1 || pixel_size == 2);
     assert(((intptr_t)src & 0xf) == 0 && (src_pitch & 0x0f) == 0);
 
@@ -467,8 +1046,8 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
 {
     const size_t copy_pitch = __MIN(src_pitch, dst_pitch);
     assert(copy_pitch > 0);
-    const unsigned w16 = (copy_pitch+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned w64 = (copy_pitch+63) & ~63;
+    const unsigned hstep = cache_size / w64;
     const unsigned cache_width = __MIN(src_pitch, cache_size);
     assert(hstep > 0);
 
@@ -480,10 +1059,10 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
         const unsigned hblock =  __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, src, src_pitch, cache_width, hblock, bitshift);
+        CopyFromUswc(cache, w64, src, src_pitch, cache_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
-        Copy2d(dst, dst_pitch, cache, w16, copy_pitch, hblock);
+        Copy2d(dst, dst_pitch, cache, w64, copy_pitch, hblock);
 
         /* */
         src += src_pitch * hblock;
@@ -500,8 +1079,8 @@ SSE_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
 {
     assert(srcu_pitch == srcv_pitch);
     size_t copy_pitch = __MIN(dst_pitch / 2, srcu_pitch);
-    unsigned int const  w16 = (srcu_pitch+15) & ~15;
-    unsigned int const  hstep = (cache_size) / (2*w16);
+    unsigned int const  w64 = (srcu_pitch+63) & ~63;
+    unsigned int const  hstep = (cache_size) / (2*w64);
     const unsigned cacheu_width = __MIN(srcu_pitch, cache_size);
     const unsigned cachev_width = __MIN(srcv_pitch, cache_size);
     assert(hstep > 0);
@@ -511,13 +1090,13 @@ SSE_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
         unsigned int const      hblock = __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, srcu, srcu_pitch, cacheu_width, hblock, bitshift);
-        CopyFromUswc(cache+w16*hblock, w16, srcv, srcv_pitch,
+        CopyFromUswc(cache, w64, srcu, srcu_pitch, cacheu_width, hblock, bitshift);
+        CopyFromUswc(cache+w64*hblock, w64, srcv, srcv_pitch,
                      cachev_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
-        SSE_InterleaveUV(dst, dst_pitch, cache, w16,
-                         cache + w16 * hblock, w16,
+        SSE_InterleaveUV(dst, dst_pitch, cache, w64,
+                         cache + w64 * hblock, w64,
                          copy_pitch, hblock, pixel_size);
 
         /* */
@@ -534,8 +1113,8 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
                             unsigned height, uint8_t pixel_size, int bitshift)
 {
     size_t copy_pitch = __MIN(__MIN(src_pitch / 2, dstu_pitch), dstv_pitch);
-    const unsigned w16 = (src_pitch+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned w64 = (src_pitch+63) & ~63;
+    const unsigned hstep = cache_size / w64;
     const unsigned cache_width = __MIN(src_pitch, cache_size);
     assert(hstep > 0);
 
@@ -543,11 +1122,11 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
         const unsigned hblock =  __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, src, src_pitch, cache_width, hblock, bitshift);
+        CopyFromUswc(cache, w64, src, src_pitch, cache_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
         SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
-                    cache, w16, copy_pitch, hblock, pixel_size);
+                    cache, w64, copy_pitch, hblock, pixel_size);
 
         /* */
         src  += src_pitch  * hblock;
@@ -1105,10 +1684,146 @@ cleanup:
     return NULL;
 }
 
-int main(void)
+struct test_kernels
 {
-    alarm(10);
+    const char *name;
+    unsigned cpu;
+};
+
+static const struct test_kernels kernels[] = {
+    { "C", 0 },
+#if defined(CAN_COMPILE_SSE2) && !defined(COPY_TEST_NOOPTIM)
+# define TEST_CPU_SSE (VLC_CPU_SSE2 | VLC_CPU_SSE3 | VLC_CPU_SSSE3 | VLC_CPU_SSE4_1)
+    { "SSE", TEST_CPU_SSE },
+# ifdef CAN_COMPILE_AVX2
+    { "AVX2", TEST_CPU_SSE | VLC_CPU_AVX | VLC_CPU_AVX2 },
+# endif
+# ifdef CAN_COMPILE_AVX512
+    { "AVX-512", TEST_CPU_SSE | VLC_CPU_AVX | VLC_CPU_AVX2 | VLC_CPU_AVX512 },
+# endif
+#endif
+};
+#define NB_KERNELS ARRAY_SIZE(kernels)
+
+/* Restricts the conversions to the given kernels, if the CPU has them */
+static bool kernels_Select(const struct test_kernels *k)
+{
+#if defined(CAN_COMPILE_SSE2) && !defined(COPY_TEST_NOOPTIM)
+    if ((vlc_CPU() & k->cpu) != k->cpu)
+        return false;
+    test_cpu = k->cpu;
+    return true;
+#else
+    return k->cpu == 0;
+#endif
+}
+
+static void convert(const struct test_dst *test_dst, picture_t *dst,
+                    const picture_t *src, const copy_cache_t *cache)
+{
+    const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
+                                      src->p[U_PLANE].p_pixels,
+                                      src->p[V_PLANE].p_pixels };
+    const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
+                                       src->p[U_PLANE].i_pitch,
+                                       src->p[V_PLANE].i_pitch };
+
+    if (test_dst->bitshift == 0)
+        test_dst->conv(dst, src_planes, src_pitches,
+                       src->format.i_visible_height, cache);
+    else
+        test_dst->conv16(dst, src_planes, src_pitches,
+                         src->format.i_visible_height, test_dst->bitshift,
+                         cache);
+}
+
+static const struct test_size bench_sizes[] = {
+    { 1280, 720, 1280, 720 },
+    { 1920, 1088, 1920, 1080 },
+    { 3840, 2160, 3840, 2160 },
+};
+
+/* Reports the throughput of each set of kernels, in source bytes */
+static void bench(void)
+{
+    for (size_t i = 0; i < NB_CONVS; ++i)
+    {
+        const struct test_conv *conv = &convs[i];
+        const vlc_chroma_description_t *src_dsc =
+            vlc_fourcc_GetChromaDescription(conv->src_chroma);
+        assert(src_dsc);
+
+        for (size_t j = 0; j < ARRAY_SIZE(bench_sizes); ++j)
+        {
+            const struct test_size *size = &bench_sizes[j];
+
+            video_format_t fmt;
+            video_format_Init(&fmt, 0);
+            video_format_Setup(&fmt, conv->src_chroma,
+                               size->i_width, size->i_height,
+                               size->i_visible_width, size->i_visible_height,
+                               1, 1);
+            picture_t *src = picture_NewFromFormat(&fmt);
+            assert(src);
+            piccheck(src, src_dsc, true);
+
+            size_t frame_size = 0;
+            for (int n = 0; n < src->i_planes; n++)
+                frame_size += src->p[n].i_visible_pitch
+                            * src->p[n].i_visible_lines;
+
+            copy_cache_t cache;
+            int ret = CopyInitCache(&cache, src->format.i_width
+                                    * src_dsc->pixel_size);
+            assert(ret == VLC_SUCCESS);
+
+            for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
+            {
+                const struct test_dst *test_dst = &conv->dsts[f];
+                const vlc_chroma_description_t *dst_dsc =
+                    vlc_fourcc_GetChromaDescription(test_dst->chroma);
+                assert(dst_dsc);
+                fmt.i_chroma = test_dst->chroma;
+                picture_t *dst = picture_NewFromFormat(&fmt);
+                assert(dst);
+
+                for (size_t k = 0; k < NB_KERNELS; ++k)
+                {
+                    if (!kernels_Select(&kernels[k]))
+                        continue;
+
+                    convert(test_dst, dst, src, &cache); /* warm up */
+
+                    unsigned count = 0;
+                    const vlc_tick_t start = vlc_tick_now();
+                    vlc_tick_t elapsed;
+                    do
+                    {
+                        convert(test_dst, dst, src, &cache);
+                        count++;
+                        elapsed = vlc_tick_now() - start;
+                    }
+                    while (elapsed < VLC_TICK_FROM_MS(250));
+
+                    piccheck(dst, dst_dsc, false);
+                    printf("%4.4s -> %4.4s %4u x %4u %-8s %6.2f GB/s\n",
+                           (const char *) &src->format.i_chroma,
+                           (const char *) &dst->format.i_chroma,
+                           size->i_visible_width, size->i_visible_height,
+                           kernels[k].name,
+                           (double) frame_size * count * CLOCK_FREQ
+                           / elapsed / 1e9);
+                }
+                picture_Release(dst);
+            }
+            picture_Release(src);
+            CopyCleanCache(&cache);
+        }
+    }
+}
 
+int main(int argc, char *argv[])
+{
 #ifndef COPY_TEST_NOOPTIM
 #ifdef CAN_COMPILE_SSE2
     if (!vlc_CPU_SSE2())
@@ -1119,6 +1834,14 @@ int main(void)
     }
 #endif
 
+    if (argc > 1 && !strcmp(argv[1], "--bench"))
+    {
+        bench();
+        return 0;
+    }
+
+    alarm(10);
+
     for (size_t i = 0; i < NB_CONVS; ++i)
     {
         const struct test_conv *conv = &convs[i];
@@ -1154,30 +1877,25 @@ int main(void)
                     vlc_fourcc_GetChromaDescription(test_dst->chroma);
                 assert(dst_dsc);
                 fmt.i_chroma = test_dst->chroma;
-                picture_t *dst = picture_NewFromFormat(&fmt);
-                assert(dst);
 
-                const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
-                                                  src->p[U_PLANE].p_pixels,
-                                                  src->p[V_PLANE].p_pixels };
-                const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
-                                                   src->p[U_PLANE].i_pitch,
-                                                   src->p[V_PLANE].i_pitch };
-
-                fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s\n",
-                        size->i_width, size->i_height,
-                        size->i_visible_width, size->i_visible_height,
-                        (const char *) &src->format.i_chroma,
-                        (const char *) &dst->format.i_chroma);
-                if (test_dst->bitshift == 0)
-                    test_dst->conv(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, &cache);
-                else
-                    test_dst->conv16(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, test_dst->bitshift,
-                                   &cache);
-                piccheck(dst, dst_dsc, false);
-                picture_Release(dst);
+                for (size_t k = 0; k < NB_KERNELS; ++k)
+                {
+                    if (!kernels_Select(&kernels[k]))
+                        continue;
+
+                    picture_t *dst = picture_NewFromFormat(&fmt);
+                    assert(dst);
+
+                    fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s (%s)\n",
+                            size->i_width, size->i_height,
+                            size->i_visible_width, size->i_visible_height,
+                            (const char *) &src->format.i_chroma,
+                            (const char *) &dst->format.i_chroma,
+                            kernels[k].name);
+                    convert(test_dst, dst, src, &cache);
+                    piccheck(dst, dst_dsc, false);
+                    picture_Release(dst);
+                }
             }
             picture_Release(src);
             CopyCleanCache(&cache);
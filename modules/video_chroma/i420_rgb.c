@@ -43,7 +43,9 @@
 
 static void SetYUV( filter_t * );
 static void Set8bppPalette( filter_t *, uint8_t * );
+static void SetDitherOffset( int, int, int, int, bool *, int *, int * );
 #endif
+static void SetOffset( int, int, int, int, bool *, int *, int * );
 
 /*****************************************************************************
  * RGB2PIXEL: assemble RGB components to a pixel value, returns a uint32_t
@@ -97,18 +99,7 @@ vlc_module_begin ()
         set_callback_chroma_conv_probe(ProbeChroma)
 vlc_module_end ()
 
-#ifndef PLUGIN_PLAIN
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_R5G5B5, Deactivate )
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_R5G6B5, Deactivate )
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_A8R8G8B8, Deactivate )
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_R8G8B8A8, Deactivate )
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_B8G8R8A8, Deactivate )
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_A8B8G8R8, Deactivate )
-#else
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_RGB8, Deactivate )
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_RGB16, Deactivate )
-VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_RGB32, Deactivate )
-#endif
+VIDEO_FILTER_WRAPPER_CLOSE( Convert, Deactivate )
 
 /*****************************************************************************
  * Activate: allocate a chroma function
@@ -117,6 +108,9 @@ VIDEO_FILTER_WRAPPER_CLOSE_EXT( I420_RGB32, Deactivate )
  *****************************************************************************/
 static int Activate( filter_t *p_filter )
 {
+    void (*pf_convert)( filter_t *, picture_t *, picture_t *, unsigned,
+                        uint8_t * );
+
     if( !vlc_CPU_capable() )
         return VLC_EGENERIC;
     if( p_filter->fmt_out.video.i_width & 1
@@ -140,47 +134,47 @@ static int Activate( filter_t *p_filter )
                 case VLC_CODEC_RGB565:
                     /* R5G6B5 pixel format */
                     msg_Dbg(p_filter, "RGB pixel format is R5G6B5");
-                    p_filter->ops = &I420_R5G6B5_ops;
+                    pf_convert = I420_R5G6B5;
                     break;
                 case VLC_CODEC_RGB555:
                     /* R5G5B5 pixel format */
                     msg_Dbg(p_filter, "RGB pixel format is R5G5B5");
-                    p_filter->ops = &I420_R5G5B5_ops;
+                    pf_convert = I420_R5G5B5;
                     break;
                 case VLC_CODEC_XRGB:
                     /* A8R8G8B8 pixel format */
                     msg_Dbg(p_filter, "RGB pixel format is XBGR");
-                    p_filter->ops = &I420_A8R8G8B8_ops;
+                    pf_convert = I420_A8R8G8B8;
                     break;
                 case VLC_CODEC_RGBX:
                     /* R8G8B8A8 pixel format */
                     msg_Dbg(p_filter, "RGB pixel format is RGBX");
-                    p_filter->ops = &I420_R8G8B8A8_ops;
+                    pf_convert = I420_R8G8B8A8;
                     break;
                 case VLC_CODEC_BGRX:
                     /* B8G8R8A8 pixel format */
                     msg_Dbg(p_filter, "RGB pixel format is BGRX");
-                    p_filter->ops = &I420_B8G8R8A8_ops;
+                    pf_convert = I420_B8G8R8A8;
                     break;
                 case VLC_CODEC_XBGR:
                     /* A8B8G8R8 pixel format */
                     msg_Dbg(p_filter, "RGB pixel format is XBGR");
-                    p_filter->ops = &I420_A8B8G8R8_ops;
+                    pf_convert = I420_A8B8G8R8;
                     break;
 #else
                 case VLC_CODEC_RGB233:
                 case VLC_CODEC_RGB332:
                 case VLC_CODEC_BGR233:
-                    p_filter->ops = &I420_RGB8_ops;
+                    pf_convert = I420_RGB8;
                     break;
                 case VLC_CODEC_RGB565:
                 case VLC_CODEC_BGR565:
                 case VLC_CODEC_RGB555:
                 case VLC_CODEC_BGR555:
-                    p_filter->ops = &I420_RGB16_ops;
+                    pf_convert = I420_RGB16;
                     break;
                 CASE_PACKED_RGBX
-                    p_filter->ops = &I420_RGB32_ops;
+                    pf_convert = I420_RGB32;
                     break;
 #endif
                 default:
@@ -230,10 +224,57 @@ static int Activate( filter_t *p_filter )
         return VLC_EGENERIC;
     }
 
+    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
+     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
+     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
+#ifdef PLUGIN_PLAIN
+    if( p_sys->i_bytespp == 1 )
+        SetDitherOffset( p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width,
+                         p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height,
+                         p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width,
+                         p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height,
+                         &p_sys->b_hscale, &p_sys->i_vscale, p_sys->p_offset );
+    else
+#endif
+    SetOffset( p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width,
+               p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height,
+               p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width,
+               p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height,
+               &p_sys->b_hscale, &p_sys->i_vscale, p_sys->p_offset );
+
+    if( SliceInitThreads( VLC_OBJECT(p_filter), &p_sys->threads ) )
+    {
+        free( p_sys->p_offset );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    /* Horizontal scaling converts each line to a buffer first: one buffer
+     * per thread, 16 bytes aligned for SSE2 */
+    if( p_sys->b_hscale )
+    {
+        p_sys->i_buffer_size = ( (size_t)( p_filter->fmt_in.video.i_x_offset
+                                   + p_filter->fmt_in.video.i_visible_width )
+                                 * p_sys->i_bytespp + 15 ) & ~(size_t)15;
+        p_sys->p_buffer = vlc_alloc( p_sys->threads.threads,
+                                     p_sys->i_buffer_size );
+        if( p_sys->p_buffer == NULL )
+        {
+            SliceCleanThreads( &p_sys->threads );
+            free( p_sys->p_offset );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+    }
+
 #ifdef PLUGIN_PLAIN
-    p_sys->p_base = malloc( p_sys->i_bytespp * RGB_TABLE_SIZE );
+    /* The 8 bpp palette lookup table is larger than the RGB tables */
+    p_sys->p_base = malloc( ( p_sys->i_bytespp == 1 ) ? PALETTE_TABLE_SIZE
+                                : p_sys->i_bytespp * RGB_TABLE_SIZE );
     if( p_sys->p_base == NULL )
     {
+        free( p_sys->p_buffer );
+        SliceCleanThreads( &p_sys->threads );
         free( p_sys->p_offset );
         free( p_sys );
         return -1;
@@ -242,6 +283,8 @@ static int Activate( filter_t *p_filter )
     SetYUV( p_filter );
 #endif
 
+    p_sys->pf_convert = pf_convert;
+    p_filter->ops = &Convert_ops;
     return 0;
 }
 
@@ -259,9 +302,119 @@ static void Deactivate( filter_t *p_filter )
 #endif
     free( p_sys->p_offset );
     free( p_sys->p_buffer );
+    SliceCleanThreads( &p_sys->threads );
     free( p_sys );
 }
 
+struct i420_rgb
+{
+    filter_t *p_filter;
+    picture_t *p_src;
+    picture_t *p_dest;
+};
+
+static void ConvertSlice( void *opaque, unsigned i_worker,
+                          unsigned i_first, unsigned i_count )
+{
+    const struct i420_rgb *p_ctx = opaque;
+    filter_sys_t *p_sys = p_ctx->p_filter->p_sys;
+    picture_t src, dest;
+
+    SlicePicture( &src, p_ctx->p_src, i_first );
+    SlicePicture( &dest, p_ctx->p_dest, i_first );
+    p_sys->pf_convert( p_ctx->p_filter, &src, &dest, i_count,
+                       p_sys->p_buffer + i_worker * p_sys->i_buffer_size );
+}
+
+/*****************************************************************************
+ * Convert: convert a picture by slices of lines
+ *****************************************************************************
+ * Vertical scaling carries its state from one line to the next: the picture
+ * is then converted as a whole. 8 bpp dithering works on blocks of 4 lines.
+ *****************************************************************************/
+static void Convert( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_height = p_filter->fmt_in.video.i_y_offset
+                            + p_filter->fmt_in.video.i_visible_height;
+
+    if( p_sys->i_vscale != 0 )
+    {
+        p_sys->pf_convert( p_filter, p_src, p_dest, i_height,
+                           p_sys->p_buffer );
+        return;
+    }
+
+    struct i420_rgb ctx = {
+        .p_filter = p_filter,
+        .p_src = p_src,
+        .p_dest = p_dest,
+    };
+
+    SliceRun( &p_sys->threads, i_height, ( p_sys->i_bytespp == 1 ) ? 4 : 2,
+              ConvertSlice, &ctx );
+}
+
+/*****************************************************************************
+ * SetOffset: build offset array for conversion functions
+ *****************************************************************************
+ * This function will build an offset array used in later conversion functions.
+ * It will also set horizontal and vertical scaling indicators.
+ *****************************************************************************/
+static void SetOffset( int i_width, int i_height, int i_pic_width,
+                       int i_pic_height, bool *pb_hscale,
+                       int *pi_vscale, int *p_offset )
+{
+    /*
+     * Prepare horizontal offset array
+     */
+    if( i_pic_width - i_width == 0 )
+    {   /* No horizontal scaling: YUV conversion is done directly to picture */
+        *pb_hscale = 0;
+    }
+    else if( i_pic_width - i_width > 0 )
+    {   /* Prepare scaling array for horizontal extension */
+        int i_scale_count = i_pic_width;
+
+        *pb_hscale = 1;
+        for( int i_x = i_width; i_x--; )
+        {
+            while( (i_scale_count -= i_width) > 0 )
+            {
+                *p_offset++ = 0;
+            }
+            *p_offset++ = 1;
+            i_scale_count += i_pic_width;
+        }
+    }
+    else /* if( i_pic_width - i_width < 0 ) */
+    {   /* Prepare scaling array for horizontal reduction */
+        int i_scale_count = i_pic_width;
+
+        *pb_hscale = 1;
+        for( int i_x = i_pic_width; i_x--; )
+        {
+            *p_offset = 1;
+            while( (i_scale_count -= i_pic_width) > 0 )
+            {
+                *p_offset += 1;
+            }
+            p_offset++;
+            i_scale_count += i_width;
+        }
+    }
+
+    /*
+     * Set vertical scaling indicator
+     */
+    if( i_pic_height - i_height == 0 )
+        *pi_vscale = 0;
+    else if( i_pic_height - i_height > 0 )
+        *pi_vscale = 1;
+    else /* if( i_pic_height - i_height < 0 ) */
+        *pi_vscale = -1;
+}
+
 #ifdef PLUGIN_PLAIN
 /*****************************************************************************
  * SetYUV: compute tables and set function pointers
@@ -391,7 +544,7 @@ static void SetYUV( filter_t *p_filter )
         for( unsigned i_index = 0; i_index < BLUE_MARGIN; i_index++ )
         {
             p_sys->p_rgb16[BLUE_OFFSET - BLUE_MARGIN + i_index] = 0;
-            p_sys->p_rgb16[BLUE_OFFSET + BLUE_MARGIN + i_index] = RGB2PIXEL( 0, 0, 255 );
+            p_sys->p_rgb16[BLUE_OFFSET + 256 + i_index] =         RGB2PIXEL( 0, 0, 255 );
         }
         for( unsigned i_index = 0; i_index < 256; i_index++ )
         {
@@ -418,7 +571,7 @@ static void SetYUV( filter_t *p_filter )
         for( unsigned i_index = 0; i_index < BLUE_MARGIN; i_index++ )
         {
             p_sys->p_rgb32[BLUE_OFFSET - BLUE_MARGIN + i_index] = 0;
-            p_sys->p_rgb32[BLUE_OFFSET + BLUE_MARGIN + i_index] = RGB2PIXEL( 0, 0, 255 );
+            p_sys->p_rgb32[BLUE_OFFSET + 256 + i_index] =         RGB2PIXEL( 0, 0, 255 );
         }
         for( unsigned i_index = 0; i_index < 256; i_index++ )
         {
@@ -548,4 +701,85 @@ static void Set8bppPalette( filter_t *p_filter, uint8_t *p_rgb8 )
         }
     }
 }
+
+/*****************************************************************************
+ * SetDitherOffset: build offset array for 8 bpp conversion functions
+ *****************************************************************************
+ * This function will build an offset array used in later conversion functions.
+ * It will also set horizontal and vertical scaling indicators. The p_offset
+ * structure has interleaved Y and U/V offsets.
+ *****************************************************************************/
+static void SetDitherOffset( int i_width, int i_height, int i_pic_width,
+                             int i_pic_height, bool *pb_hscale,
+                             int *pi_vscale, int *p_offset )
+{
+    int i_x;                                    /* x position in destination */
+    int i_scale_count;                                     /* modulo counter */
+
+    /*
+     * Prepare horizontal offset array
+     */
+    if( i_pic_width - i_width == 0 )
+    {
+        /* No horizontal scaling: YUV conversion is done directly to picture */
+        *pb_hscale = 0;
+    }
+    else if( i_pic_width - i_width > 0 )
+    {
+        int i_dummy = 0;
+
+        /* Prepare scaling array for horizontal extension */
+        *pb_hscale = 1;
+        i_scale_count = i_pic_width;
+        for( i_x = i_width; i_x--; )
+        {
+            while( (i_scale_count -= i_width) > 0 )
+            {
+                *p_offset++ = 0;
+                *p_offset++ = 0;
+            }
+            *p_offset++ = 1;
+            *p_offset++ = i_dummy;
+            i_dummy = 1 - i_dummy;
+            i_scale_count += i_pic_width;
+        }
+    }
+    else /* if( i_pic_width - i_width < 0 ) */
+    {
+        int i_remainder = 0;
+        int i_jump;
+
+        /* Prepare scaling array for horizontal reduction */
+        *pb_hscale = 1;
+        i_scale_count = i_width;
+        for( i_x = i_pic_width; i_x--; )
+        {
+            i_jump = 1;
+            while( (i_scale_count -= i_pic_width) > 0 )
+            {
+                i_jump += 1;
+            }
+            *p_offset++ = i_jump;
+            *p_offset++ = ( i_jump += i_remainder ) >> 1;
+            i_remainder = i_jump & 1;
+            i_scale_count += i_width;
+        }
+    }
+
+    /*
+     * Set vertical scaling indicator
+     */
+    if( i_pic_height - i_height == 0 )
+    {
+        *pi_vscale = 0;
+    }
+    else if( i_pic_height - i_height > 0 )
+    {
+        *pi_vscale = 1;
+    }
+    else /* if( i_pic_height - i_height < 0 ) */
+    {
+        *pi_vscale = -1;
+    }
+}
 #endif
@@ -21,6 +21,8 @@
  *****************************************************************************/
 #include <limits.h>
 
+#include "slices.h"
+
 #if !defined (PLUGIN_SSE2)
 # define PLUGIN_PLAIN
 #endif
@@ -36,10 +38,16 @@
  */
 typedef struct
 {
-    uint8_t  *p_buffer;
-    size_t    i_buffer_size;
+    uint8_t  *p_buffer;                /**< line buffers of the threads */
+    size_t    i_buffer_size;           /**< size of a line buffer */
     uint8_t   i_bytespp;
     int *p_offset;
+    bool      b_hscale;                /**< horizontal scaling */
+    int       i_vscale;                /**< vertical scaling direction */
+
+    slice_threads_t threads;
+    void (*pf_convert)( filter_t *, picture_t *, picture_t *, unsigned,
+                        uint8_t * );
 
 #ifdef PLUGIN_PLAIN
     /**< Pre-calculated conversion tables */
@@ -58,39 +66,23 @@ typedef struct
 #endif
 } filter_sys_t;
 
-/*****************************************************************************
- * Conversion buffer helper
- *****************************************************************************/
-static inline int AllocateOrGrow( uint8_t **pp_buffer, size_t *pi_buffer,
-                                  unsigned i_width, uint8_t bytespp )
-{
-    if(UINT_MAX / bytespp < i_width)
-        return -1;
-    const size_t i_realloc = i_width * bytespp;
-    if(*pi_buffer >= i_realloc)
-        return 0;
-    uint8_t *p_realloc = realloc(*pp_buffer, i_realloc);
-    if(!p_realloc)
-        return -1;
-    *pp_buffer = p_realloc;
-    *pi_buffer = i_realloc;
-    return 0;
-}
-
 /*****************************************************************************
  * Prototypes
+ *****************************************************************************
+ * The conversion functions convert the given number of lines from the top of
+ * the pictures, using the given line buffer when scaling horizontally.
  *****************************************************************************/
 #ifdef PLUGIN_PLAIN
-void I420_RGB8         ( filter_t *, picture_t *, picture_t * );
-void I420_RGB16        ( filter_t *, picture_t *, picture_t * );
-void I420_RGB32        ( filter_t *, picture_t *, picture_t * );
+void I420_RGB8         ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
+void I420_RGB16        ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
+void I420_RGB32        ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
 #else
-void I420_R5G5B5       ( filter_t *, picture_t *, picture_t * );
-void I420_R5G6B5       ( filter_t *, picture_t *, picture_t * );
-void I420_A8R8G8B8     ( filter_t *, picture_t *, picture_t * );
-void I420_R8G8B8A8     ( filter_t *, picture_t *, picture_t * );
-void I420_B8G8R8A8     ( filter_t *, picture_t *, picture_t * );
-void I420_A8B8G8R8     ( filter_t *, picture_t *, picture_t * );
+void I420_R5G5B5       ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
+void I420_R5G6B5       ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
+void I420_A8R8G8B8     ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
+void I420_R8G8B8A8     ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
+void I420_B8G8R8A8     ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
+void I420_A8B8G8R8     ( filter_t *, picture_t *, picture_t *, unsigned, uint8_t * );
 #endif
 
 /*****************************************************************************
@@ -33,66 +33,6 @@
 #include "i420_rgb.h"
 #include "i420_rgb_c.h"
 
-/*****************************************************************************
- * SetOffset: build offset array for conversion functions
- *****************************************************************************
- * This function will build an offset array used in later conversion functions.
- * It will also set horizontal and vertical scaling indicators.
- *****************************************************************************/
-static void SetOffset( int i_width, int i_height, int i_pic_width,
-                       int i_pic_height, bool *pb_hscale,
-                       unsigned int *pi_vscale, int *p_offset )
-{
-    /*
-     * Prepare horizontal offset array
-     */
-    if( i_pic_width - i_width == 0 )
-    {   /* No horizontal scaling: YUV conversion is done directly to picture */
-        *pb_hscale = 0;
-    }
-    else if( i_pic_width - i_width > 0 )
-    {   /* Prepare scaling array for horizontal extension */
-        int i_scale_count = i_pic_width;
-
-        *pb_hscale = 1;
-        for( int i_x = i_width; i_x--; )
-        {
-            while( (i_scale_count -= i_width) > 0 )
-            {
-                *p_offset++ = 0;
-            }
-            *p_offset++ = 1;
-            i_scale_count += i_pic_width;
-        }
-    }
-    else /* if( i_pic_width - i_width < 0 ) */
-    {   /* Prepare scaling array for horizontal reduction */
-        int i_scale_count = i_pic_width;
-
-        *pb_hscale = 1;
-        for( int i_x = i_pic_width; i_x--; )
-        {
-            *p_offset = 1;
-            while( (i_scale_count -= i_pic_width) > 0 )
-            {
-                *p_offset += 1;
-            }
-            p_offset++;
-            i_scale_count += i_width;
-        }
-    }
-
-    /*
-     * Set vertical scaling indicator
-     */
-    if( i_pic_height - i_height == 0 )
-        *pi_vscale = 0;
-    else if( i_pic_height - i_height > 0 )
-        *pi_vscale = 1;
-    else /* if( i_pic_height - i_height < 0 ) */
-        *pi_vscale = -1;
-}
-
 /*****************************************************************************
  * I420_RGB16: color YUV 4:2:0 to RGB 16 bpp
  *****************************************************************************
@@ -104,7 +44,8 @@ static void SetOffset( int i_width, int i_height, int i_pic_width,
  *  - output: 1 line
  *****************************************************************************/
 
-void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                 unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -114,8 +55,8 @@ void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -146,22 +87,7 @@ void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 7;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width),
-               (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height),
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint16_t*)p_sys->p_buffer;
+    p_buffer_start = (uint16_t*)p_line;
 
     /*
      * Perform conversion
@@ -169,7 +95,7 @@ void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     i_scale_count = ( i_vscale == 1 ) ?
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
-    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    for( i_y = 0; i_y < i_height; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -219,7 +145,8 @@ void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
  *  - output: 1 line
  *****************************************************************************/
 
-void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                 unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -229,8 +156,8 @@ void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -261,22 +188,7 @@ void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 7;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width),
-               (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height),
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint32_t*)p_sys->p_buffer;
+    p_buffer_start = (uint32_t*)p_line;
 
     /*
      * Perform conversion
@@ -284,7 +196,7 @@ void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     i_scale_count = ( i_vscale == 1 ) ?
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
-    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+    for( i_y = 0; i_y < i_height; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -36,68 +36,9 @@
 # define VLC_TARGET VLC_SSE
 #endif
 
-/*****************************************************************************
- * SetOffset: build offset array for conversion functions
- *****************************************************************************
- * This function will build an offset array used in later conversion functions.
- * It will also set horizontal and vertical scaling indicators.
- *****************************************************************************/
-static void SetOffset( int i_width, int i_height, int i_pic_width,
-                       int i_pic_height, bool *pb_hscale,
-                       unsigned int *pi_vscale, int *p_offset )
-{
-    /*
-     * Prepare horizontal offset array
-     */
-    if( i_pic_width - i_width == 0 )
-    {   /* No horizontal scaling: YUV conversion is done directly to picture */
-        *pb_hscale = 0;
-    }
-    else if( i_pic_width - i_width > 0 )
-    {   /* Prepare scaling array for horizontal extension */
-        int i_scale_count = i_pic_width;
-
-        *pb_hscale = 1;
-        for( int i_x = i_width; i_x--; )
-        {
-            while( (i_scale_count -= i_width) > 0 )
-            {
-                *p_offset++ = 0;
-            }
-            *p_offset++ = 1;
-            i_scale_count += i_pic_width;
-        }
-    }
-    else /* if( i_pic_width - i_width < 0 ) */
-    {   /* Prepare scaling array for horizontal reduction */
-        int i_scale_count = i_pic_width;
-
-        *pb_hscale = 1;
-        for( int i_x = i_pic_width; i_x--; )
-        {
-            *p_offset = 1;
-            while( (i_scale_count -= i_pic_width) > 0 )
-            {
-                *p_offset += 1;
-            }
-            p_offset++;
-            i_scale_count += i_width;
-        }
-    }
-
-    /*
-     * Set vertical scaling indicator
-     */
-    if( i_pic_height - i_height == 0 )
-        *pi_vscale = 0;
-    else if( i_pic_height - i_height > 0 )
-        *pi_vscale = 1;
-    else /* if( i_pic_height - i_height < 0 ) */
-        *pi_vscale = -1;
-}
-
 VLC_TARGET
-void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                  unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -107,8 +48,8 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -134,22 +75,7 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width),
-               (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height),
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint16_t*)p_sys->p_buffer;
+    p_buffer_start = (uint16_t*)p_line;
 
     /*
      * Perform conversion
@@ -175,7 +101,7 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -226,7 +152,7 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -281,7 +207,8 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 }
 
 VLC_TARGET
-void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                  unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -291,8 +218,8 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -318,22 +245,7 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width),
-               (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height),
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint16_t*)p_sys->p_buffer;
+    p_buffer_start = (uint16_t*)p_line;
 
     /*
      * Perform conversion
@@ -359,7 +271,7 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -410,7 +322,7 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -465,8 +377,8 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 }
 
 VLC_TARGET
-void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
-                                            picture_t *p_dest )
+void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                    unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -476,8 +388,8 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -502,22 +414,7 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
 
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width,
-               p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height,
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint32_t*)p_sys->p_buffer;
+    p_buffer_start = (uint32_t*)p_line;
 
     /*
      * Perform conversion
@@ -543,7 +440,7 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -594,7 +491,7 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -649,7 +546,8 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
 }
 
 VLC_TARGET
-void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                    unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -659,8 +557,8 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -685,22 +583,7 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width),
-               (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height),
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint32_t*)p_sys->p_buffer;
+    p_buffer_start = (uint32_t*)p_line;
 
     /*
      * Perform conversion
@@ -726,7 +609,7 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -777,7 +660,7 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -832,7 +715,8 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 }
 
 VLC_TARGET
-void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                    unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -842,8 +726,8 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -868,22 +752,7 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width),
-               (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height),
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint32_t*)p_sys->p_buffer;
+    p_buffer_start = (uint32_t*)p_line;
 
     /*
      * Perform conversion
@@ -909,7 +778,7 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -960,7 +829,7 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -1015,7 +884,8 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 }
 
 VLC_TARGET
-void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest,
+                    unsigned i_height, uint8_t *p_line )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -1025,8 +895,8 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     uint8_t  *p_u   = p_src->U_PIXELS;
     uint8_t  *p_v   = p_src->V_PIXELS;
 
-    bool  b_hscale;                         /* horizontal scaling type */
-    unsigned int i_vscale;                          /* vertical scaling type */
+    const bool b_hscale = p_sys->b_hscale;  /* horizontal scaling type */
+    const int i_vscale = p_sys->i_vscale;   /* vertical scaling type */
     unsigned int i_x, i_y;                /* horizontal and vertical indexes */
 
     int         i_right_margin;
@@ -1051,22 +921,7 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_right_margin = p_dest->p->i_pitch - p_dest->p->i_visible_pitch;
 
-    /* Rule: when a picture of size (x1,y1) with aspect ratio r1 is rendered
-     * on a picture of size (x2,y2) with aspect ratio r2, if x1 grows to x1'
-     * then y1 grows to y1' = x1' * y2/x2 * r2/r1 */
-    SetOffset( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width),
-               (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height),
-               (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width),
-               (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height),
-               &b_hscale, &i_vscale, p_offset_start );
-
-    if(b_hscale &&
-       AllocateOrGrow(&p_sys->p_buffer, &p_sys->i_buffer_size,
-                      p_filter->fmt_in.video.i_x_offset +
-                      p_filter->fmt_in.video.i_visible_width,
-                      p_sys->i_bytespp))
-        return;
-    else p_buffer_start = (uint32_t*)p_sys->p_buffer;
+    p_buffer_start = (uint32_t*)p_line;
 
     /*
      * Perform conversion
@@ -1092,7 +947,7 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -1143,7 +998,7 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ )
+        for( i_y = 0; i_y < i_height; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -41,6 +41,7 @@
 #endif
 
 #include "i420_yuy2.h"
+#include "slices.h"
 
 #define SRC_FOURCC  "I420,IYUV,YV12"
 
@@ -94,11 +95,30 @@ vlc_module_begin ()
         set_callback_chroma_conv_probe(ProbeChroma)
 vlc_module_end ()
 
-VIDEO_FILTER_WRAPPER( I420_YUY2 )
-VIDEO_FILTER_WRAPPER( I420_YVYU )
-VIDEO_FILTER_WRAPPER( I420_UYVY )
+typedef struct
+{
+    slice_threads_t threads;
+} filter_sys_t;
+
+static void Deactivate( filter_t * );
+static void Convert( filter_t *, picture_t *, picture_t *,
+                     void (*)( filter_t *, picture_t *, picture_t *, unsigned ) );
+
+/* Converts by slices of lines */
+#define SLICES_WRAPPER( name )                                              \
+    static void name ( filter_t *, picture_t *, picture_t *, unsigned );   \
+    static void name ## _Slices ( filter_t *p_filter, picture_t *p_source, \
+                                  picture_t *p_dest )                       \
+    {                                                                       \
+        Convert( p_filter, p_source, p_dest, name );                        \
+    }                                                                       \
+    VIDEO_FILTER_WRAPPER_CLOSE_FILT( name ## _Slices, Deactivate )
+
+SLICES_WRAPPER( I420_YUY2 )
+SLICES_WRAPPER( I420_YVYU )
+SLICES_WRAPPER( I420_UYVY )
 #if defined (PLUGIN_PLAIN)
-VIDEO_FILTER_WRAPPER( I420_Y211 )
+SLICES_WRAPPER( I420_Y211 )
 #endif
 
 static const struct vlc_filter_operations *
@@ -107,17 +127,17 @@ GetFilterOperations( filter_t *p_filter )
     switch( p_filter->fmt_out.video.i_chroma )
     {
         case VLC_CODEC_YUYV:
-            return &I420_YUY2_ops;
+            return &I420_YUY2_Slices_ops;
 
         case VLC_CODEC_YVYU:
-            return &I420_YVYU_ops;
+            return &I420_YVYU_Slices_ops;
 
         case VLC_CODEC_UYVY:
-            return &I420_UYVY_ops;
+            return &I420_UYVY_Slices_ops;
 
 #if defined (PLUGIN_PLAIN)
         case VLC_CODEC_Y211:
-            return &I420_Y211_ops;
+            return &I420_Y211_Slices_ops;
 #endif
         default:
             return NULL;
@@ -150,13 +170,79 @@ static int Activate( filter_t *p_filter )
         return VLC_EGENERIC;
 
     /* Find the adequate filter function depending on the output format. */
-    p_filter->ops = GetFilterOperations( p_filter );
-    if( p_filter->ops == NULL )
+    const struct vlc_filter_operations *ops = GetFilterOperations( p_filter );
+    if( ops == NULL )
         return VLC_EGENERIC;
 
+    filter_sys_t *p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    if( SliceInitThreads( VLC_OBJECT(p_filter), &p_sys->threads ) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_filter->p_sys = p_sys;
+    p_filter->ops = ops;
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Deactivate: free the chroma function
+ *****************************************************************************/
+static void Deactivate( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    SliceCleanThreads( &p_sys->threads );
+    free( p_sys );
+}
+
+struct i420_yuy2
+{
+    filter_t *p_filter;
+    picture_t *p_source;
+    picture_t *p_dest;
+    void (*pf_convert)( filter_t *, picture_t *, picture_t *, unsigned );
+};
+
+static void ConvertSlice( void *opaque, unsigned i_worker,
+                          unsigned i_first, unsigned i_count )
+{
+    const struct i420_yuy2 *p_ctx = opaque;
+    picture_t source, dest;
+
+    VLC_UNUSED( i_worker );
+    SlicePicture( &source, p_ctx->p_source, i_first );
+    SlicePicture( &dest, p_ctx->p_dest, i_first );
+    p_ctx->pf_convert( p_ctx->p_filter, &source, &dest, i_count );
+}
+
+/*****************************************************************************
+ * Convert: convert a picture by slices of lines
+ *****************************************************************************
+ * The conversion functions process line pairs from the top of the picture
+ * given to them, on the number of lines given to them.
+ *****************************************************************************/
+static void Convert( filter_t *p_filter, picture_t *p_source,
+                     picture_t *p_dest,
+                     void (*pf_convert)( filter_t *, picture_t *, picture_t *,
+                                         unsigned ) )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct i420_yuy2 ctx = {
+        .p_filter = p_filter,
+        .p_source = p_source,
+        .p_dest = p_dest,
+        .pf_convert = pf_convert,
+    };
+
+    SliceRun( &p_sys->threads, p_filter->fmt_in.video.i_y_offset
+                             + p_filter->fmt_in.video.i_visible_height, 2,
+              ConvertSlice, &ctx );
+}
+
 #if 0
 static inline unsigned long long read_cycles(void)
 {
@@ -174,7 +260,7 @@ static inline unsigned long long read_cycles(void)
  *****************************************************************************/
 VLC_TARGET
 static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -209,10 +295,10 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) |
-           ( (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) % 2 ) ) )
+           ( i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
@@ -226,10 +312,10 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
 #warning FIXME: converting widths % 16 but !widths % 32 is broken on altivec
 #if 0
     else if( !( ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 16 ) |
-                ( (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) % 4 ) ) )
+                ( i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 4 ; i_y-- ; )
+        for( i_y = i_height / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -277,7 +363,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
                                - ( p_filter->fmt_out.video.i_x_offset * 2 );
 
 #if !defined(PLUGIN_SSE2)
-    for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -317,7 +403,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -343,7 +429,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -377,7 +463,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -412,10 +498,10 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) |
-           ( (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) % 2 ) ) )
+           ( i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
@@ -427,10 +513,10 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
         }
     }
     else if( !( ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 16 ) |
-                ( (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) % 4 ) ) )
+                ( i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 4 ; i_y-- ; )
+        for( i_y = i_height / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -477,7 +563,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
                                - ( p_filter->fmt_out.video.i_x_offset * 2 );
 
 #if !defined(PLUGIN_SSE2)
-    for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -516,7 +602,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -542,7 +628,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -575,7 +661,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -610,10 +696,10 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) |
-           ( (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) % 2 ) ) )
+           ( i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
@@ -625,10 +711,10 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
         }
     }
     else if( !( ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 16 ) |
-                ( (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) % 4 ) ) )
+                ( i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 4 ; i_y-- ; )
+        for( i_y = i_height / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -675,7 +761,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
                                - ( p_filter->fmt_out.video.i_x_offset * 2 );
 
 #if !defined(PLUGIN_SSE2)
-    for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -714,7 +800,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -740,7 +826,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -773,7 +859,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 #if defined (PLUGIN_PLAIN)
 static void I420_Y211( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -792,7 +878,7 @@ static void I420_Y211( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch
                                - ( p_filter->fmt_out.video.i_x_offset * 2 );
 
-    for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -35,6 +35,8 @@
 #include <vlc_picture.h>
 #include <vlc_chroma_probe.h>
 
+#include "slices.h"
+
 #define SRC_FOURCC  "I422,J422"
 #define DEST_FOURCC "I420,IYUV,J420,YV12,YUVA"
 
@@ -43,6 +45,11 @@
  *****************************************************************************/
 static int  Activate ( filter_t * );
 
+typedef struct
+{
+    slice_threads_t threads;
+} filter_sys_t;
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -59,9 +66,9 @@ vlc_module_begin ()
         set_callback_chroma_conv_probe(ProbeChroma)
 vlc_module_end ()
 
-VIDEO_FILTER_WRAPPER( I422_I420 )
-VIDEO_FILTER_WRAPPER( I422_YV12 )
-VIDEO_FILTER_WRAPPER( I422_YUVA )
+VIDEO_FILTER_WRAPPER_CLOSE( I422_I420, Deactivate )
+VIDEO_FILTER_WRAPPER_CLOSE( I422_YV12, Deactivate )
+VIDEO_FILTER_WRAPPER_CLOSE( I422_YUVA, Deactivate )
 
 /*****************************************************************************
  * Activate: allocate a chroma function
@@ -106,38 +113,95 @@ static int Activate( filter_t *p_filter )
         default:
             return -1;
     }
+
+    filter_sys_t *p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    if( SliceInitThreads( VLC_OBJECT(p_filter), &p_sys->threads ) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_filter->p_sys = p_sys;
     return 0;
 }
 
+/*****************************************************************************
+ * Deactivate: free the chroma function
+ *****************************************************************************/
+static void Deactivate( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    SliceCleanThreads( &p_sys->threads );
+    free( p_sys );
+}
+
 /* Following functions are local */
 
+struct i422_i420
+{
+    const picture_t *p_source;
+    picture_t *p_dest;
+    unsigned i_width;
+    bool b_swap_uv;
+};
+
+/*****************************************************************************
+ * I422_I420_Slice: convert lines of planar 4:2:2 to planar 4:2:0
+ *****************************************************************************
+ * The 4:2:0 chroma lines are the odd 4:2:2 lines.
+ *****************************************************************************/
+static void I422_I420_Slice( void *opaque, unsigned i_worker,
+                             unsigned i_first, unsigned i_count )
+{
+    const struct i422_i420 *p_ctx = opaque;
+    const plane_t *p_sy = &p_ctx->p_source->p[Y_PLANE];
+    const plane_t *p_su = &p_ctx->p_source->p[U_PLANE];
+    const plane_t *p_sv = &p_ctx->p_source->p[V_PLANE];
+    plane_t *p_dy = &p_ctx->p_dest->p[Y_PLANE];
+    plane_t *p_du = &p_ctx->p_dest->p[p_ctx->b_swap_uv ? V_PLANE : U_PLANE];
+    plane_t *p_dv = &p_ctx->p_dest->p[p_ctx->b_swap_uv ? U_PLANE : V_PLANE];
+    const unsigned i_width = p_ctx->i_width;
+
+    VLC_UNUSED( i_worker );
+
+    for( unsigned i_y = i_first; i_y < i_first + i_count; i_y++ )
+        memcpy( &p_dy->p_pixels[i_y * p_dy->i_pitch],
+                &p_sy->p_pixels[i_y * p_sy->i_pitch], i_width );
+
+    for( unsigned i_y = i_first / 2; i_y < (i_first + i_count) / 2; i_y++ )
+    {
+        memcpy( &p_du->p_pixels[i_y * p_du->i_pitch],
+                &p_su->p_pixels[(2 * i_y + 1) * p_su->i_pitch], i_width / 2 );
+        memcpy( &p_dv->p_pixels[i_y * p_dv->i_pitch],
+                &p_sv->p_pixels[(2 * i_y + 1) * p_sv->i_pitch], i_width / 2 );
+    }
+}
+
+static void Convert( filter_t *p_filter, picture_t *p_source,
+                     picture_t *p_dest, bool b_swap_uv )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct i422_i420 ctx = {
+        .p_source = p_source,
+        .p_dest = p_dest,
+        .i_width = p_filter->fmt_in.video.i_width,
+        .b_swap_uv = b_swap_uv,
+    };
+
+    SliceRun( &p_sys->threads, p_filter->fmt_in.video.i_height, 2,
+              I422_I420_Slice, &ctx );
+}
+
 /*****************************************************************************
  * I422_I420: planar YUV 4:2:2 to planar I420 4:2:0 Y:U:V
  *****************************************************************************/
 static void I422_I420( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint16_t i_dpy = p_dest->p[Y_PLANE].i_pitch;
-    uint16_t i_spy = p_source->p[Y_PLANE].i_pitch;
-    uint16_t i_dpuv = p_dest->p[U_PLANE].i_pitch;
-    uint16_t i_spuv = p_source->p[U_PLANE].i_pitch;
-    uint16_t i_width = p_filter->fmt_in.video.i_width;
-    uint16_t i_y = p_filter->fmt_in.video.i_height;
-    uint8_t *p_dy = p_dest->Y_PIXELS + (i_y-1)*i_dpy;
-    uint8_t *p_y = p_source->Y_PIXELS + (i_y-1)*i_spy;
-    uint8_t *p_du = p_dest->U_PIXELS + (i_y/2-1)*i_dpuv;
-    uint8_t *p_u = p_source->U_PIXELS + (i_y-1)*i_spuv;
-    uint8_t *p_dv = p_dest->V_PIXELS + (i_y/2-1)*i_dpuv;
-    uint8_t *p_v = p_source->V_PIXELS + (i_y-1)*i_spuv;
-    i_y /= 2;
-
-    for ( ; i_y--; )
-    {
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_du, p_u, i_width/2); p_du -= i_dpuv; p_u -= 2*i_spuv;
-        memcpy(p_dv, p_v, i_width/2); p_dv -= i_dpuv; p_v -= 2*i_spuv;
-    }
+    Convert( p_filter, p_source, p_dest, false );
 }
 
 /*****************************************************************************
@@ -146,27 +210,7 @@ static void I422_I420( filter_t *p_filter, picture_t *p_source,
 static void I422_YV12( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint16_t i_dpy = p_dest->p[Y_PLANE].i_pitch;
-    uint16_t i_spy = p_source->p[Y_PLANE].i_pitch;
-    uint16_t i_dpuv = p_dest->p[U_PLANE].i_pitch;
-    uint16_t i_spuv = p_source->p[U_PLANE].i_pitch;
-    uint16_t i_width = p_filter->fmt_in.video.i_width;
-    uint16_t i_y = p_filter->fmt_in.video.i_height;
-    uint8_t *p_dy = p_dest->Y_PIXELS + (i_y-1)*i_dpy;
-    uint8_t *p_y = p_source->Y_PIXELS + (i_y-1)*i_spy;
-    uint8_t *p_du = p_dest->V_PIXELS + (i_y/2-1)*i_dpuv; /* U and V are swapped */
-    uint8_t *p_u = p_source->U_PIXELS + (i_y-1)*i_spuv;
-    uint8_t *p_dv = p_dest->U_PIXELS + (i_y/2-1)*i_dpuv; /* U and V are swapped */
-    uint8_t *p_v = p_source->V_PIXELS + (i_y-1)*i_spuv;
-    i_y /= 2;
-
-    for ( ; i_y--; )
-    {
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_dy, p_y, i_width); p_dy -= i_dpy; p_y -= i_spy;
-        memcpy(p_du, p_u, i_width/2); p_du -= i_dpuv; p_u -= 2*i_spuv;
-        memcpy(p_dv, p_v, i_width/2); p_dv -= i_dpuv; p_v -= 2*i_spuv;
-    }
+    Convert( p_filter, p_source, p_dest, true ); /* U and V are swapped */
 }
 
 /*****************************************************************************
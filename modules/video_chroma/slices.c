@@ -0,0 +1,218 @@
+/*****************************************************************************
+ * slices.c: slice-threaded picture conversions
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdatomic.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+#include <vlc_executor.h>
+
+#include "slices.h"
+
+/* Lines per slice: large enough to amortize the scheduling, small enough to
+ * balance the load between the threads */
+#define SLICE_LINES 32
+#define SLICE_MAX_THREADS 64
+
+struct slice_job
+{
+    slice_cb cb;
+    void *opaque;
+    unsigned lines;
+    unsigned height;
+    unsigned count;
+    atomic_uint next;
+
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    unsigned pending;
+};
+
+struct slice_task
+{
+    struct slice_job *job;
+    unsigned worker;
+    struct vlc_runnable runnable;
+};
+
+/* The worker threads are shared by all the converter instances. They are
+ * only started on demand by the executor. */
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+static vlc_executor_t *pool;
+static unsigned pool_users;
+
+int SliceInitThreads(vlc_object_t *obj, slice_threads_t *threads)
+{
+    unsigned count = var_InheritInteger(obj, "chroma-threads");
+
+    if (count == 0)
+        count = vlc_GetCPUCount();
+    threads->threads = VLC_CLIP(count, 1, SLICE_MAX_THREADS);
+    threads->tasks = NULL;
+
+    if (threads->threads == 1)
+        return VLC_SUCCESS;
+
+    threads->tasks = vlc_alloc(threads->threads - 1, sizeof (*threads->tasks));
+    if (unlikely(threads->tasks == NULL))
+        return VLC_ENOMEM;
+
+    vlc_mutex_lock(&pool_lock);
+    if (pool == NULL)
+        pool = vlc_executor_New(SLICE_MAX_THREADS - 1);
+    if (likely(pool != NULL))
+        pool_users++;
+    vlc_mutex_unlock(&pool_lock);
+
+    if (unlikely(pool == NULL))
+    {
+        free(threads->tasks);
+        return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+}
+
+void SliceCleanThreads(slice_threads_t *threads)
+{
+    if (threads->tasks == NULL)
+        return;
+
+    free(threads->tasks);
+
+    vlc_mutex_lock(&pool_lock);
+    assert(pool_users > 0);
+    if (--pool_users == 0)
+    {
+        vlc_executor_Delete(pool);
+        pool = NULL;
+    }
+    vlc_mutex_unlock(&pool_lock);
+}
+
+static void SliceProcess(struct slice_job *job, unsigned worker)
+{
+    unsigned i;
+
+    while ((i = atomic_fetch_add_explicit(&job->next, 1,
+                                          memory_order_relaxed)) < job->count)
+    {
+        unsigned first = i * job->height;
+
+        job->cb(job->opaque, worker, first,
+                __MIN(job->height, job->lines - first));
+    }
+}
+
+static void SliceTaskRun(void *data)
+{
+    struct slice_task *task = data;
+    struct slice_job *job = task->job;
+
+    SliceProcess(job, task->worker);
+
+    vlc_mutex_lock(&job->lock);
+    if (--job->pending == 0)
+        vlc_cond_signal(&job->wait);
+    vlc_mutex_unlock(&job->lock);
+}
+
+void SliceRun(slice_threads_t *threads, unsigned lines, unsigned align,
+              slice_cb cb, void *opaque)
+{
+    assert(align > 0);
+
+    const unsigned height = (SLICE_LINES + align - 1) / align * align;
+    const unsigned count = (lines + height - 1) / height;
+    const unsigned workers = __MIN(threads->threads, count);
+
+    if (workers <= 1)
+    {
+        if (lines > 0)
+            cb(opaque, 0, 0, lines);
+        return;
+    }
+
+    struct slice_job job = {
+        .cb = cb,
+        .opaque = opaque,
+        .lines = lines,
+        .height = height,
+        .count = count,
+        .pending = workers - 1,
+    };
+
+    atomic_init(&job.next, 0);
+    vlc_mutex_init(&job.lock);
+    vlc_cond_init(&job.wait);
+
+    for (unsigned i = 0; i < workers - 1; i++)
+    {
+        struct slice_task *task = &threads->tasks[i];
+
+        task->job = &job;
+        task->worker = i + 1;
+        task->runnable.run = SliceTaskRun;
+        task->runnable.userdata = task;
+        vlc_executor_SubmitWithPriority(pool, &task->runnable,
+                                        VLC_EXECUTOR_PRIORITY_HIGH);
+    }
+
+    SliceProcess(&job, 0);
+
+    /* All the slices are taken: withdraw the tasks that did not start, and
+     * wait for the others to complete their last slice. */
+    unsigned canceled = 0;
+    for (unsigned i = 0; i < workers - 1; i++)
+        if (vlc_executor_Cancel(pool, &threads->tasks[i].runnable))
+            canceled++;
+
+    vlc_mutex_lock(&job.lock);
+    job.pending -= canceled;
+    while (job.pending > 0)
+        vlc_cond_wait(&job.wait, &job.lock);
+    vlc_mutex_unlock(&job.lock);
+}
+
+void SlicePicture(picture_t *restrict view, const picture_t *pic,
+                  unsigned line)
+{
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription(pic->format.i_chroma);
+
+    assert(desc != NULL && desc->plane_count == (unsigned)pic->i_planes);
+    *view = *pic;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &view->p[i];
+        const int offset = line * desc->p[i].h.num / desc->p[i].h.den;
+
+        assert(offset * desc->p[i].h.den == line * desc->p[i].h.num);
+        p->p_pixels += offset * p->i_pitch;
+        p->i_lines = __MAX(p->i_lines - offset, 0);
+        p->i_visible_lines = __MAX(p->i_visible_lines - offset, 0);
+    }
+}
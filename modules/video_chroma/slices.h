@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * slices.h: slice-threaded picture conversions
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEOCHROMA_SLICES_H_
+#define VLC_VIDEOCHROMA_SLICES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct slice_task;
+
+typedef struct {
+    unsigned threads;
+    struct slice_task *tasks;
+} slice_threads_t;
+
+/**
+ * Converts the given lines of a picture.
+ *
+ * \param worker index of the calling worker, below the thread count: a
+ *               worker converts one slice at a time, so that the index can
+ *               select per-thread state such as line buffers
+ * \param first first line of the slice
+ * \param count number of lines of the slice
+ */
+typedef void (*slice_cb)(void *opaque, unsigned worker,
+                         unsigned first, unsigned count);
+
+/**
+ * Sets up slice threading for a converter.
+ *
+ * The thread count is read from the "chroma-threads" option. The slices are
+ * run on a pool of worker threads shared by all the converters of the
+ * plugin, and by the calling thread.
+ */
+int  SliceInitThreads(vlc_object_t *obj, slice_threads_t *threads);
+void SliceCleanThreads(slice_threads_t *threads);
+
+/**
+ * Runs a conversion by horizontal slices, and waits for its completion.
+ *
+ * The slice height is a fixed multiple of align, independent of the thread
+ * count: as long as the callback output only depends on the lines of its
+ * slice, the converted picture does not depend on the number of threads.
+ */
+void SliceRun(slice_threads_t *threads, unsigned lines, unsigned align,
+              slice_cb cb, void *opaque);
+
+/**
+ * Makes a view of a picture starting from a given line.
+ *
+ * The view shares the pixels of the picture. The line is counted in the
+ * first plane, and must be a multiple of the vertical subsampling factor.
+ */
+void SlicePicture(picture_t *restrict view, const picture_t *pic,
+                  unsigned line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
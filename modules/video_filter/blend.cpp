@@ -27,10 +27,13 @@
 # include "config.h"
 #endif
 
+#include <cstring>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
 /*****************************************************************************
@@ -39,9 +42,16 @@
 static int  Open (filter_t *);
 static void Close(filter_t *);
 
+#define KERNEL_TEXT N_("Blending kernel")
+#define KERNEL_LONGTEXT N_( \
+    "Only use the given blending kernel: \"c\", \"sse4.1\" or \"avx2\". " \
+    "By default, the fastest kernel supported by the CPU is used.")
+
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
     set_callback_video_blending(Open, 100)
+    add_string("blend-kernel", NULL, KERNEL_TEXT, KERNEL_LONGTEXT)
+        change_private()
 vlc_module_end()
 
 static inline unsigned div255(unsigned v)
@@ -58,6 +68,15 @@ void merge(T *dst, unsigned src, unsigned f)
     *dst = div255((255 - f) * (*dst) + src * f);
 }
 
+/* For samples stored in the most significant bits */
+template <unsigned shift, typename T>
+void merge(T *dst, unsigned src, unsigned f)
+{
+    unsigned v = *dst >> shift;
+    merge(&v, src, f);
+    *dst = v << shift;
+}
+
 namespace {
 
 struct CPixel {
@@ -151,7 +170,7 @@ private:
     uint8_t *data[4];
 };
 
-template <bool swap_uv>
+template <typename pixel, unsigned shift, bool swap_uv>
 class CPictureYUVSemiPlanar : public CPicture {
 public:
     CPictureYUVSemiPlanar(const CPicture &cfg) : CPicture(cfg)
@@ -161,18 +180,18 @@ public:
     }
     void get(CPixel *px, unsigned dx, bool full = true) const
     {
-        px->i = *getPointer(0, dx);
+        px->i = *getPointer(0, dx) >> shift;
         if (full) {
-            px->j = getPointer(1, dx)[swap_uv];
-            px->k = getPointer(1, dx)[!swap_uv];
+            px->j = getPointer(1, dx)[swap_uv] >> shift;
+            px->k = getPointer(1, dx)[!swap_uv] >> shift;
         }
     }
     void merge(unsigned dx, const CPixel &spx, unsigned a, bool full)
     {
-        ::merge(getPointer(0, dx), spx.i, a);
+        ::merge<shift>(getPointer(0, dx), spx.i, a);
         if (full) {
-            ::merge(&getPointer(1, dx)[ swap_uv], spx.j, a);
-            ::merge(&getPointer(1, dx)[!swap_uv], spx.k, a);
+            ::merge<shift>(&getPointer(1, dx)[ swap_uv], spx.j, a);
+            ::merge<shift>(&getPointer(1, dx)[!swap_uv], spx.k, a);
         }
     }
     bool isFull(unsigned dx) const
@@ -187,12 +206,12 @@ public:
             data[1] += picture->p[1].i_pitch;
     }
 private:
-    uint8_t *getPointer(unsigned plane, unsigned dx) const
+    pixel *getPointer(unsigned plane, unsigned dx) const
     {
         if (plane == 0)
-            return &data[plane][x + dx];
+            return (pixel*)&data[plane][(x + dx) * sizeof(pixel)];
         else
-            return &data[plane][(x + dx) / 2 * 2];
+            return (pixel*)&data[plane][(x + dx) / 2 * 2 * sizeof(pixel)];
     }
     uint8_t *data[2];
 };
@@ -405,8 +424,9 @@ typedef CPictureYUVPlanar<uint8_t,  4,4, false, false> CPictureI410_8;
 
 typedef CPictureYUVPlanar<uint8_t,  4,1, false, false> CPictureI411_8;
 
-typedef CPictureYUVSemiPlanar<false>                   CPictureNV12;
-typedef CPictureYUVSemiPlanar<true>                    CPictureNV21;
+typedef CPictureYUVSemiPlanar<uint8_t,  0, false>      CPictureNV12;
+typedef CPictureYUVSemiPlanar<uint8_t,  0, true>       CPictureNV21;
+typedef CPictureYUVSemiPlanar<uint16_t, 6, false>      CPictureP010;
 
 typedef CPictureYUVPlanar<uint8_t,  2,2, false, true>  CPictureYV12;
 typedef CPictureYUVPlanar<uint8_t,  2,2, false, false> CPictureI420_8;
@@ -607,6 +627,591 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+/*
+ * Vectorized blending
+ *
+ * The most common subpicture formats blended onto the most common video
+ * formats are processed a chunk of a line at a time: the source pixels are
+ * first converted to 8-bit planar YUV with the final alpha, which is then
+ * merged into each destination plane. The results are identical to the
+ * templates above.
+ *
+ * There are no NEON kernels: ARM uses the templates.
+ */
+#if defined __has_attribute
+# if __has_attribute(__target__)
+#  define BLEND_HAS_TARGET
+# endif
+#endif
+#if defined(BLEND_HAS_TARGET) && defined(HAVE_SSE4_1_INTRINSICS)
+# define BLEND_SSE4_1
+# include <smmintrin.h>
+#endif
+#if defined(BLEND_HAS_TARGET) && defined(HAVE_AVX2_INTRINSICS)
+# define BLEND_AVX2
+# include <immintrin.h>
+#endif
+
+#if defined(BLEND_SSE4_1) || defined(BLEND_AVX2)
+namespace {
+
+/* Number of pixels processed at once */
+#define BLEND_CHUNK 256
+
+/* Source pixels as 8-bit YUV, and alpha already scaled by the global alpha */
+struct CRow {
+    const uint8_t *y, *u, *v;
+    const uint8_t *a;
+};
+
+struct CRowBuffer {
+    uint8_t y[BLEND_CHUNK], u[BLEND_CHUNK], v[BLEND_CHUNK], a[BLEND_CHUNK];
+    /* Subsampled chroma and alpha */
+    uint8_t uv[BLEND_CHUNK], auv[BLEND_CHUNK];
+};
+
+/* The SIMD functions process as many pixels as they can, and return their
+ * count. The remaining ones are processed like in the templates. */
+template <class TSimd>
+struct rowKernels {
+    static void alpha(uint8_t *dst, const uint8_t *src, unsigned n,
+                      unsigned alpha)
+    {
+        for (unsigned i = TSimd::alpha(dst, src, n, alpha); i < n; i++)
+            dst[i] = div255(alpha * src[i]);
+    }
+    static void rgba(CRowBuffer *buf, const uint8_t *src, unsigned n,
+                     unsigned alpha)
+    {
+        for (unsigned i = TSimd::rgba(buf, src, n, alpha); i < n; i++) {
+            rgb_to_yuv(&buf->y[i], &buf->u[i], &buf->v[i],
+                       src[4 * i + 0], src[4 * i + 1], src[4 * i + 2]);
+            buf->a[i] = div255(alpha * src[4 * i + 3]);
+        }
+    }
+    static void merge(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned n)
+    {
+        for (unsigned i = TSimd::merge8(dst, src, a, n); i < n; i++)
+            ::merge(&dst[i], src[i], a[i]);
+    }
+    /* Into 10 bits samples stored in the most significant bits */
+    static void merge(uint16_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned n)
+    {
+        for (unsigned i = TSimd::merge10(dst, src, a, n); i < n; i++) {
+            if (a[i] > 0)
+                ::merge<6>(&dst[i], src[i] * 1023 / 255, a[i]);
+        }
+    }
+};
+
+template <class TKernels>
+class CRowsYUVA : public CPicture {
+public:
+    CRowsYUVA(const CPicture &cfg) : CPicture(cfg)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = CPicture::getLine<1>(i);
+    }
+    void get(CRow *row, CRowBuffer *buf, unsigned dx, unsigned n,
+             unsigned alpha) const
+    {
+        TKernels::alpha(buf->a, &data[3][x + dx], n, alpha);
+        row->y = &data[0][x + dx];
+        row->u = &data[1][x + dx];
+        row->v = &data[2][x + dx];
+        row->a = buf->a;
+    }
+    void nextLine()
+    {
+        y++;
+        for (unsigned i = 0; i < 4; i++)
+            data[i] += picture->p[i].i_pitch;
+    }
+private:
+    uint8_t *data[4];
+};
+
+template <class TKernels>
+class CRowsRGBA : public CPicture {
+public:
+    CRowsRGBA(const CPicture &cfg) : CPicture(cfg)
+    {
+        data = CPicture::getLine<1>(0);
+    }
+    void get(CRow *row, CRowBuffer *buf, unsigned dx, unsigned n,
+             unsigned alpha) const
+    {
+        TKernels::rgba(buf, &data[(x + dx) * 4], n, alpha);
+        row->y = buf->y;
+        row->u = buf->u;
+        row->v = buf->v;
+        row->a = buf->a;
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    uint8_t *data;
+};
+
+template <class TKernels>
+class CRowsI420 : public CPicture {
+public:
+    CRowsI420(const CPicture &cfg) : CPicture(cfg)
+    {
+        data[0] = CPicture::getLine<1>(0);
+        data[1] = CPicture::getLine<2>(1);
+        data[2] = CPicture::getLine<2>(2);
+    }
+    void merge(const CRow &row, CRowBuffer *buf, unsigned dx, unsigned n)
+    {
+        TKernels::merge(&data[0][x + dx], row.y, row.a, n);
+        if (y % 2 != 0)
+            return;
+
+        /* The chroma is blended from the pixels at even positions */
+        const unsigned first = (x + dx) % 2;
+        uint8_t *u = &buf->uv[0];
+        uint8_t *v = &buf->uv[BLEND_CHUNK / 2];
+        unsigned count = 0;
+        for (unsigned i = first; i < n; i += 2, count++) {
+            u[count] = row.u[i];
+            v[count] = row.v[i];
+            buf->auv[count] = row.a[i];
+        }
+        TKernels::merge(&data[1][(x + dx + first) / 2], u, buf->auv, count);
+        TKernels::merge(&data[2][(x + dx + first) / 2], v, buf->auv, count);
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0) {
+            data[1] += picture->p[1].i_pitch;
+            data[2] += picture->p[2].i_pitch;
+        }
+    }
+private:
+    uint8_t *data[3];
+};
+
+template <class TKernels, typename pixel>
+class CRowsSemiPlanar : public CPicture {
+public:
+    CRowsSemiPlanar(const CPicture &cfg) : CPicture(cfg)
+    {
+        data[0] = CPicture::getLine<1>(0);
+        data[1] = CPicture::getLine<2>(1);
+    }
+    void merge(const CRow &row, CRowBuffer *buf, unsigned dx, unsigned n)
+    {
+        TKernels::merge(&((pixel *)data[0])[x + dx], row.y, row.a, n);
+        if (y % 2 != 0)
+            return;
+
+        const unsigned first = (x + dx) % 2;
+        unsigned count = 0;
+        for (unsigned i = first; i < n; i += 2, count += 2) {
+            buf->uv[count + 0] = row.u[i];
+            buf->uv[count + 1] = row.v[i];
+            buf->auv[count + 0] =
+            buf->auv[count + 1] = row.a[i];
+        }
+        TKernels::merge(&((pixel *)data[1])[x + dx + first], buf->uv,
+                        buf->auv, count);
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0)
+            data[1] += picture->p[1].i_pitch;
+    }
+private:
+    uint8_t *data[2];
+};
+
+#ifdef BLEND_SSE4_1
+#define BLEND_SSE4_1_TARGET __attribute__((__target__("sse4.1")))
+
+struct simdSSE4_1 {
+    BLEND_SSE4_1_TARGET
+    static __m128i div255(__m128i v)
+    {
+        const __m128i one = _mm_set1_epi16(1);
+        v = _mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), one);
+        return _mm_srli_epi16(v, 8);
+    }
+    BLEND_SSE4_1_TARGET
+    static __m128i div255_32(__m128i v)
+    {
+        const __m128i one = _mm_set1_epi32(1);
+        v = _mm_add_epi32(_mm_add_epi32(v, _mm_srli_epi32(v, 8)), one);
+        return _mm_srli_epi32(v, 8);
+    }
+    BLEND_SSE4_1_TARGET
+    static unsigned alpha(uint8_t *dst, const uint8_t *src, unsigned n,
+                          unsigned alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ga = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 16 <= n; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), ga));
+            __m128i hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), ga));
+            _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+        }
+        return i;
+    }
+    /* Converts 4 pixels to 4 16-bits lanes of each component */
+    BLEND_SSE4_1_TARGET
+    static void unpackRGBA(const uint8_t *src, __m128i *r, __m128i *g,
+                           __m128i *b, __m128i *a)
+    {
+        const __m128i mask = _mm_set1_epi32(0xff);
+        __m128i p0 = _mm_loadu_si128((const __m128i *)&src[0]);
+        __m128i p1 = _mm_loadu_si128((const __m128i *)&src[16]);
+
+        *r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+        *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                             _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+        *b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                             _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+        *a = _mm_packs_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+    }
+    /* Same computations as rgb_to_yuv() */
+    BLEND_SSE4_1_TARGET
+    static void rgbToYuv(__m128i r, __m128i g, __m128i b,
+                         __m128i *y, __m128i *u, __m128i *v)
+    {
+        const __m128i c128 = _mm_set1_epi16(128);
+        const __m128i c16  = _mm_set1_epi16(16);
+        __m128i t;
+
+        t = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                          _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+        t = _mm_add_epi16(t, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+        *y = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(t, c128), 8), c16);
+
+        t = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(-38)),
+                          _mm_mullo_epi16(g, _mm_set1_epi16(-74)));
+        t = _mm_add_epi16(t, _mm_mullo_epi16(b, _mm_set1_epi16(112)));
+        *u = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(t, c128), 8), c128);
+
+        t = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(112)),
+                          _mm_mullo_epi16(g, _mm_set1_epi16(-94)));
+        t = _mm_add_epi16(t, _mm_mullo_epi16(b, _mm_set1_epi16(-18)));
+        *v = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(t, c128), 8), c128);
+    }
+    BLEND_SSE4_1_TARGET
+    static unsigned rgba(CRowBuffer *buf, const uint8_t *src, unsigned n,
+                         unsigned alpha)
+    {
+        const __m128i ga = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 16 <= n; i += 16) {
+            __m128i r, g, b, a[2], y[2], u[2], v[2];
+
+            for (unsigned j = 0; j < 2; j++) {
+                unpackRGBA(&src[4 * (i + 8 * j)], &r, &g, &b, &a[j]);
+                rgbToYuv(r, g, b, &y[j], &u[j], &v[j]);
+                a[j] = div255(_mm_mullo_epi16(a[j], ga));
+            }
+            _mm_storeu_si128((__m128i *)&buf->a[i], _mm_packus_epi16(a[0], a[1]));
+            _mm_storeu_si128((__m128i *)&buf->y[i], _mm_packus_epi16(y[0], y[1]));
+            _mm_storeu_si128((__m128i *)&buf->u[i], _mm_packus_epi16(u[0], u[1]));
+            _mm_storeu_si128((__m128i *)&buf->v[i], _mm_packus_epi16(v[0], v[1]));
+        }
+        return i;
+    }
+    BLEND_SSE4_1_TARGET
+    static __m128i merge(__m128i d, __m128i s, __m128i a)
+    {
+        const __m128i c255 = _mm_set1_epi16(255);
+        return div255(_mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(c255, a)),
+                                    _mm_mullo_epi16(s, a)));
+    }
+    BLEND_SSE4_1_TARGET
+    static unsigned merge8(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                           unsigned n)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        unsigned i = 0;
+
+        for (; i + 16 <= n; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+            __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i f = _mm_loadu_si128((const __m128i *)&a[i]);
+            __m128i lo = merge(_mm_unpacklo_epi8(d, zero),
+                               _mm_unpacklo_epi8(s, zero),
+                               _mm_unpacklo_epi8(f, zero));
+            __m128i hi = merge(_mm_unpackhi_epi8(d, zero),
+                               _mm_unpackhi_epi8(s, zero),
+                               _mm_unpackhi_epi8(f, zero));
+            _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+        }
+        return i;
+    }
+    BLEND_SSE4_1_TARGET
+    static unsigned merge10(uint16_t *dst, const uint8_t *src,
+                            const uint8_t *a, unsigned n)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i c255 = _mm_set1_epi16(255);
+        unsigned i = 0;
+
+        for (; i + 8 <= n; i += 8) {
+            __m128i raw = _mm_loadu_si128((const __m128i *)&dst[i]);
+            __m128i d = _mm_srli_epi16(raw, 6);
+            __m128i s = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&src[i]));
+            __m128i f = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&a[i]));
+            __m128i nf = _mm_sub_epi16(c255, f);
+
+            /* s * 1023 / 255 = 4 * s + s / 85 */
+            s = _mm_sub_epi16(_mm_sub_epi16(_mm_slli_epi16(s, 2),
+                                            _mm_cmpgt_epi16(s, _mm_set1_epi16(84))),
+                              _mm_add_epi16(_mm_cmpgt_epi16(s, _mm_set1_epi16(169)),
+                                            _mm_cmpgt_epi16(s, _mm_set1_epi16(254))));
+
+            __m128i lo = div255_32(_mm_madd_epi16(_mm_unpacklo_epi16(d, s),
+                                                  _mm_unpacklo_epi16(nf, f)));
+            __m128i hi = div255_32(_mm_madd_epi16(_mm_unpackhi_epi16(d, s),
+                                                  _mm_unpackhi_epi16(nf, f)));
+            __m128i r = _mm_slli_epi16(_mm_packus_epi32(lo, hi), 6);
+
+            /* Fully transparent pixels are left untouched */
+            r = _mm_blendv_epi8(r, raw, _mm_cmpeq_epi16(f, zero));
+            _mm_storeu_si128((__m128i *)&dst[i], r);
+        }
+        return i;
+    }
+};
+#endif
+
+#ifdef BLEND_AVX2
+#define BLEND_AVX2_TARGET __attribute__((__target__("avx2")))
+
+struct simdAVX2 {
+    BLEND_AVX2_TARGET
+    static __m256i div255(__m256i v)
+    {
+        const __m256i one = _mm256_set1_epi16(1);
+        v = _mm256_add_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), one);
+        return _mm256_srli_epi16(v, 8);
+    }
+    BLEND_AVX2_TARGET
+    static __m256i div255_32(__m256i v)
+    {
+        const __m256i one = _mm256_set1_epi32(1);
+        v = _mm256_add_epi32(_mm256_add_epi32(v, _mm256_srli_epi32(v, 8)), one);
+        return _mm256_srli_epi32(v, 8);
+    }
+    BLEND_AVX2_TARGET
+    static unsigned alpha(uint8_t *dst, const uint8_t *src, unsigned n,
+                          unsigned alpha)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i ga = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 32 <= n; i += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i lo = div255(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), ga));
+            __m256i hi = div255(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), ga));
+            _mm256_storeu_si256((__m256i *)&dst[i], _mm256_packus_epi16(lo, hi));
+        }
+        return i;
+    }
+    /* Converts 16 pixels to 16-bits lanes of each component. The lanes hold
+     * the groups of 4 pixels in the 0, 2, 1, 3 order. */
+    BLEND_AVX2_TARGET
+    static void unpackRGBA(const uint8_t *src, __m256i *r, __m256i *g,
+                           __m256i *b, __m256i *a)
+    {
+        const __m256i mask = _mm256_set1_epi32(0xff);
+        __m256i p0 = _mm256_loadu_si256((const __m256i *)&src[0]);
+        __m256i p1 = _mm256_loadu_si256((const __m256i *)&src[32]);
+
+        *r = _mm256_packs_epi32(_mm256_and_si256(p0, mask),
+                                _mm256_and_si256(p1, mask));
+        *g = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 8), mask),
+                                _mm256_and_si256(_mm256_srli_epi32(p1, 8), mask));
+        *b = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 16), mask),
+                                _mm256_and_si256(_mm256_srli_epi32(p1, 16), mask));
+        *a = _mm256_packs_epi32(_mm256_srli_epi32(p0, 24),
+                                _mm256_srli_epi32(p1, 24));
+    }
+    BLEND_AVX2_TARGET
+    static void rgbToYuv(__m256i r, __m256i g, __m256i b,
+                         __m256i *y, __m256i *u, __m256i *v)
+    {
+        const __m256i c128 = _mm256_set1_epi16(128);
+        const __m256i c16  = _mm256_set1_epi16(16);
+        __m256i t;
+
+        t = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)),
+                             _mm256_mullo_epi16(g, _mm256_set1_epi16(129)));
+        t = _mm256_add_epi16(t, _mm256_mullo_epi16(b, _mm256_set1_epi16(25)));
+        *y = _mm256_add_epi16(_mm256_srli_epi16(_mm256_add_epi16(t, c128), 8), c16);
+
+        t = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(-38)),
+                             _mm256_mullo_epi16(g, _mm256_set1_epi16(-74)));
+        t = _mm256_add_epi16(t, _mm256_mullo_epi16(b, _mm256_set1_epi16(112)));
+        *u = _mm256_add_epi16(_mm256_srai_epi16(_mm256_add_epi16(t, c128), 8), c128);
+
+        t = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(112)),
+                             _mm256_mullo_epi16(g, _mm256_set1_epi16(-94)));
+        t = _mm256_add_epi16(t, _mm256_mullo_epi16(b, _mm256_set1_epi16(-18)));
+        *v = _mm256_add_epi16(_mm256_srai_epi16(_mm256_add_epi16(t, c128), 8), c128);
+    }
+    /* Packs 2 vectors of 16 pixels to 32 bytes in the pixel order */
+    BLEND_AVX2_TARGET
+    static void store(uint8_t *dst, __m256i lo, __m256i hi)
+    {
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        __m256i v = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi),
+                                                order);
+        _mm256_storeu_si256((__m256i *)dst, v);
+    }
+    BLEND_AVX2_TARGET
+    static unsigned rgba(CRowBuffer *buf, const uint8_t *src, unsigned n,
+                         unsigned alpha)
+    {
+        const __m256i ga = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 32 <= n; i += 32) {
+            __m256i r, g, b, a[2], y[2], u[2], v[2];
+
+            for (unsigned j = 0; j < 2; j++) {
+                unpackRGBA(&src[4 * (i + 16 * j)], &r, &g, &b, &a[j]);
+                rgbToYuv(r, g, b, &y[j], &u[j], &v[j]);
+                a[j] = div255(_mm256_mullo_epi16(a[j], ga));
+            }
+            store(&buf->a[i], a[0], a[1]);
+            store(&buf->y[i], y[0], y[1]);
+            store(&buf->u[i], u[0], u[1]);
+            store(&buf->v[i], v[0], v[1]);
+        }
+        return i;
+    }
+    BLEND_AVX2_TARGET
+    static __m256i merge(__m256i d, __m256i s, __m256i a)
+    {
+        const __m256i c255 = _mm256_set1_epi16(255);
+        return div255(_mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(c255, a)),
+                                       _mm256_mullo_epi16(s, a)));
+    }
+    BLEND_AVX2_TARGET
+    static unsigned merge8(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                           unsigned n)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        unsigned i = 0;
+
+        for (; i + 32 <= n; i += 32) {
+            __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i f = _mm256_loadu_si256((const __m256i *)&a[i]);
+            __m256i lo = merge(_mm256_unpacklo_epi8(d, zero),
+                               _mm256_unpacklo_epi8(s, zero),
+                               _mm256_unpacklo_epi8(f, zero));
+            __m256i hi = merge(_mm256_unpackhi_epi8(d, zero),
+                               _mm256_unpackhi_epi8(s, zero),
+                               _mm256_unpackhi_epi8(f, zero));
+            _mm256_storeu_si256((__m256i *)&dst[i], _mm256_packus_epi16(lo, hi));
+        }
+        return i;
+    }
+    BLEND_AVX2_TARGET
+    static unsigned merge10(uint16_t *dst, const uint8_t *src,
+                            const uint8_t *a, unsigned n)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i c255 = _mm256_set1_epi16(255);
+        unsigned i = 0;
+
+        for (; i + 16 <= n; i += 16) {
+            __m256i raw = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            __m256i d = _mm256_srli_epi16(raw, 6);
+            __m256i s = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&src[i]));
+            __m256i f = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&a[i]));
+            __m256i nf = _mm256_sub_epi16(c255, f);
+
+            s = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_slli_epi16(s, 2),
+                                                  _mm256_cmpgt_epi16(s, _mm256_set1_epi16(84))),
+                                 _mm256_add_epi16(_mm256_cmpgt_epi16(s, _mm256_set1_epi16(169)),
+                                                  _mm256_cmpgt_epi16(s, _mm256_set1_epi16(254))));
+
+            __m256i lo = div255_32(_mm256_madd_epi16(_mm256_unpacklo_epi16(d, s),
+                                                     _mm256_unpacklo_epi16(nf, f)));
+            __m256i hi = div255_32(_mm256_madd_epi16(_mm256_unpackhi_epi16(d, s),
+                                                     _mm256_unpackhi_epi16(nf, f)));
+            __m256i r = _mm256_slli_epi16(_mm256_packus_epi32(lo, hi), 6);
+
+            r = _mm256_blendv_epi8(r, raw, _mm256_cmpeq_epi16(f, zero));
+            _mm256_storeu_si256((__m256i *)&dst[i], r);
+        }
+        return i;
+    }
+};
+#endif
+
+template <class TDst, class TSrc>
+void BlendRows(const CPicture &dst_data, const CPicture &src_data,
+               unsigned width, unsigned height, int alpha)
+{
+    TSrc src(src_data);
+    TDst dst(dst_data);
+    CRowBuffer buf;
+
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned n = __MIN(width - x, BLEND_CHUNK);
+            CRow row;
+
+            src.get(&row, &buf, x, n, alpha);
+            dst.merge(row, &buf, x, n);
+        }
+        src.nextLine();
+        dst.nextLine();
+    }
+}
+
+template <class TSimd>
+blend_function_t GetBlendRows(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    typedef rowKernels<TSimd> K;
+    static const struct {
+        vlc_fourcc_t     dst;
+        vlc_fourcc_t     src;
+        blend_function_t blend;
+    } blends[] = {
+        { VLC_CODEC_I420, VLC_CODEC_YUVA, BlendRows<CRowsI420<K>, CRowsYUVA<K> > },
+        { VLC_CODEC_I420, VLC_CODEC_RGBA, BlendRows<CRowsI420<K>, CRowsRGBA<K> > },
+        { VLC_CODEC_NV12, VLC_CODEC_YUVA, BlendRows<CRowsSemiPlanar<K, uint8_t>,  CRowsYUVA<K> > },
+        { VLC_CODEC_NV12, VLC_CODEC_RGBA, BlendRows<CRowsSemiPlanar<K, uint8_t>,  CRowsRGBA<K> > },
+        { VLC_CODEC_P010, VLC_CODEC_YUVA, BlendRows<CRowsSemiPlanar<K, uint16_t>, CRowsYUVA<K> > },
+        { VLC_CODEC_P010, VLC_CODEC_RGBA, BlendRows<CRowsSemiPlanar<K, uint16_t>, CRowsRGBA<K> > },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(blends); i++) {
+        if (blends[i].src == src && blends[i].dst == dst)
+            return blends[i].blend;
+    }
+    return NULL;
+}
+
+} // namespace
+#endif
+
 namespace {
 
 static const struct {
@@ -647,6 +1252,7 @@ static const struct {
     YUV(VLC_CODEC_YV12,     CPictureYV12,     convertNone),
     YUV(VLC_CODEC_NV12,     CPictureNV12,     convertNone),
     YUV(VLC_CODEC_NV21,     CPictureNV21,     convertNone),
+    YUV(VLC_CODEC_P010,     CPictureP010,     convert8To10Bits),
     YUV(VLC_CODEC_I420,     CPictureI420_8,   convertNone),
 #ifdef WORDS_BIGENDIAN
     YUV(VLC_CODEC_I420_9B,  CPictureI420_16,  convert8To9Bits),
@@ -741,11 +1347,26 @@ static int Open(filter_t *filter)
     const vlc_fourcc_t src = filter->fmt_in.video.i_chroma;
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
+    /* The tests compare each kernel with the others */
+    char *kernel = var_InheritString(filter, "blend-kernel");
+    auto use = [kernel](const char *name) {
+        return kernel == NULL || !strcmp(kernel, name);
+    };
+
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+#ifdef BLEND_AVX2
+    if (!sys->blend && use("avx2") && vlc_CPU_AVX2())
+        sys->blend = GetBlendRows<simdAVX2>(dst, src);
+#endif
+#ifdef BLEND_SSE4_1
+    if (!sys->blend && use("sse4.1") && vlc_CPU_SSE4_1())
+        sys->blend = GetBlendRows<simdSSE4_1>(dst, src);
+#endif
+    for (size_t i = 0; !sys->blend && use("c") && i < sizeof(blends) / sizeof(*blends); i++) {
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
+    free(kernel);
 
     if (!sys->blend) {
        msg_Err(filter, "no matching alpha blending routine (chroma: %4.4s -> %4.4s)",
@@ -55,18 +55,27 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define ALPHA_TEXT N_("Alpha of the blended image")
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
+#define WIDTH_TEXT N_("Width of the generated images")
+#define WIDTH_LONGTEXT N_("Width of the images generated when no image " \
+                          "file is given")
+
+#define HEIGHT_TEXT N_("Height of the generated images")
+#define HEIGHT_LONGTEXT N_("Height of the images generated when no image " \
+                           "file is given")
+
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
 #define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
 
-#define BASE_CHROMA_TEXT N_("Chroma for the base image")
-#define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
+#define BASE_CHROMA_TEXT N_("Chromas for the base image")
+#define BASE_CHROMA_LONGTEXT N_("Comma separated list of chromas which the " \
+                                "base image will be loaded in")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
 #define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
 
-#define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
-#define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
-                                 " in")
+#define BLEND_CHROMA_TEXT N_("Chromas for the blend image")
+#define BLEND_CHROMA_LONGTEXT N_("Comma separated list of chromas which the " \
+                                 "blend image will be loaded in")
 
 #define CFG_PREFIX "blendbench-"
 
@@ -80,27 +89,33 @@ vlc_module_begin ()
               LOOPS_LONGTEXT )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT )
+    add_integer_with_range( CFG_PREFIX "width", 1920, 16, 8192, WIDTH_TEXT,
+              WIDTH_LONGTEXT )
+    add_integer_with_range( CFG_PREFIX "height", 1080, 16, 8192, HEIGHT_TEXT,
+              HEIGHT_LONGTEXT )
 
     set_section( N_("Base image"), NULL )
     add_loadfile(CFG_PREFIX "base-image", NULL,
                  BASE_IMAGE_TEXT, BASE_IMAGE_LONGTEXT)
-    add_string( CFG_PREFIX "base-chroma", "I420", BASE_CHROMA_TEXT,
+    add_string( CFG_PREFIX "base-chroma", "I420,NV12,P010", BASE_CHROMA_TEXT,
               BASE_CHROMA_LONGTEXT )
 
     set_section( N_("Blend image"), NULL )
     add_loadfile(CFG_PREFIX "blend-image", NULL,
                  BLEND_IMAGE_TEXT, BLEND_IMAGE_LONGTEXT)
-    add_string( CFG_PREFIX "blend-chroma", "YUVA", BLEND_CHROMA_TEXT,
+    add_string( CFG_PREFIX "blend-chroma", "YUVA,RGBA", BLEND_CHROMA_TEXT,
               BLEND_CHROMA_LONGTEXT )
 
     set_callback_video_filter( Create )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "width", "height", "base-image", "base-chroma",
+    "blend-image", "blend-chroma", NULL
 };
 
+#define MAX_CHROMAS 16
+
 /*****************************************************************************
  * filter_sys_t: filter method descriptor
  *****************************************************************************/
@@ -108,12 +123,15 @@ typedef struct
 {
     bool b_done;
     int i_loops, i_alpha;
+    unsigned i_width, i_height;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
+    char *psz_base_image;
+    char *psz_blend_image;
 
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    vlc_fourcc_t pi_base_chromas[MAX_CHROMAS];
+    vlc_fourcc_t pi_blend_chromas[MAX_CHROMAS];
+    unsigned i_base_chromas;
+    unsigned i_blend_chromas;
 } filter_sys_t;
 
 static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
@@ -142,6 +160,70 @@ static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
     return VLC_SUCCESS;
 }
 
+/* Generates an image with the same content for each run */
+static int blendbench_GenerateImage( vlc_object_t *p_this, picture_t **pp_pic,
+                                     vlc_fourcc_t i_chroma, unsigned i_width,
+                                     unsigned i_height, const char *psz_name )
+{
+    *pp_pic = picture_New( i_chroma, i_width, i_height, 1, 1 );
+    if( *pp_pic == NULL )
+    {
+        msg_Err( p_this, "Unable to generate %s image", psz_name );
+        return VLC_EGENERIC;
+    }
+
+    for( int i = 0; i < (*pp_pic)->i_planes; i++ )
+    {
+        plane_t *p = &(*pp_pic)->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = x * 7 + y * 13 + i * 29;
+    }
+    return VLC_SUCCESS;
+}
+
+static int blendbench_GetImage( filter_t *p_filter, picture_t **pp_pic,
+                                vlc_fourcc_t i_chroma, char *psz_file,
+                                const char *psz_name )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( psz_file == NULL || *psz_file == '\0' )
+        return blendbench_GenerateImage( VLC_OBJECT(p_filter), pp_pic,
+                                         i_chroma, p_sys->i_width,
+                                         p_sys->i_height, psz_name );
+    return blendbench_LoadImage( VLC_OBJECT(p_filter), pp_pic, i_chroma,
+                                 psz_file, psz_name );
+}
+
+static unsigned blendbench_ParseChromas( vlc_object_t *p_this,
+                                         const char *psz_var,
+                                         vlc_fourcc_t *pi_chromas )
+{
+    char *psz_list = var_CreateGetStringCommand( p_this, psz_var );
+    char *psz_save;
+    unsigned i_count = 0;
+
+    if( psz_list == NULL )
+        return 0;
+
+    for( char *psz = strtok_r( psz_list, ",", &psz_save );
+         psz != NULL && i_count < MAX_CHROMAS;
+         psz = strtok_r( NULL, ",", &psz_save ) )
+    {
+        if( strlen( psz ) != 4 )
+        {
+            msg_Warn( p_this, "Invalid chroma %s", psz );
+            continue;
+        }
+        pi_chromas[i_count++] =
+            VLC_FOURCC( psz[0], psz[1], psz[2], psz[3] );
+    }
+    free( psz_list );
+    return i_count;
+}
+
 static const struct vlc_filter_operations filter_ops =
 {
     .filter_video = Filter, .close = Destroy,
@@ -153,8 +235,6 @@ static const struct vlc_filter_operations filter_ops =
 static int Create( filter_t *p_filter )
 {
     filter_sys_t *p_sys;
-    char *psz_temp, *psz_cmd;
-    int i_ret;
 
     /* Allocate structure */
     p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
@@ -164,8 +244,6 @@ static int Create( filter_t *p_filter )
     p_sys = p_filter->p_sys;
     p_sys->b_done = false;
 
-    p_filter->ops = &filter_ops;
-
     /* needed to get options passed in transcode using the
      * adjust{name=value} syntax */
     config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
@@ -175,39 +253,30 @@ static int Create( filter_t *p_filter )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
-
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
-        VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( VLC_OBJECT(p_filter), &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
+    p_sys->i_width = var_CreateGetIntegerCommand( p_filter,
+                                                  CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetIntegerCommand( p_filter,
+                                                   CFG_PREFIX "height" );
+
+    p_sys->i_base_chromas =
+        blendbench_ParseChromas( VLC_OBJECT(p_filter), CFG_PREFIX "base-chroma",
+                                 p_sys->pi_base_chromas );
+    p_sys->i_blend_chromas =
+        blendbench_ParseChromas( VLC_OBJECT(p_filter), CFG_PREFIX "blend-chroma",
+                                 p_sys->pi_blend_chromas );
+    if( p_sys->i_base_chromas == 0 || p_sys->i_blend_chromas == 0 )
     {
+        msg_Err( p_filter, "No chroma to benchmark" );
         free( p_sys );
-        return i_ret;
+        return VLC_EGENERIC;
     }
 
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = !psz_temp || strlen( psz_temp ) != 4
-        ? 0 : VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    i_ret = blendbench_LoadImage( VLC_OBJECT(p_filter), &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                                  psz_cmd, "Blend" );
-
-    free( psz_temp );
-    free( psz_cmd );
-
-    if( i_ret != VLC_SUCCESS )
-    {
-        picture_Release( p_sys->p_base_image );
-        free( p_sys );
+    p_sys->psz_base_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
+    p_sys->psz_blend_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
 
-        return VLC_EGENERIC;
-    }
+    p_filter->ops = &filter_ops;
 
     return VLC_SUCCESS;
 }
@@ -219,55 +288,107 @@ static void Destroy( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_blend_image );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * BenchImages: blends an image onto another, and reports the speed
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void BenchImages( filter_t *p_filter, picture_t *p_base_image,
+                         picture_t *p_blend_image )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_fourcc_t i_base_chroma = p_base_image->format.i_chroma;
+    const vlc_fourcc_t i_blend_chroma = p_blend_image->format.i_chroma;
     filter_t *p_blend;
 
-    if( p_sys->b_done )
-        return p_pic;
-
     p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+        return;
+    p_blend->fmt_out.video = p_base_image->format;
+    p_blend->fmt_in.video = p_blend_image->format;
     p_blend->p_module = vlc_filter_LoadModule( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
+        msg_Warn( p_filter, "%4.4s onto %4.4s: no blending module",
+                  (const char *)&i_blend_chroma,
+                  (const char *)&i_base_chroma );
         vlc_object_delete(p_blend);
-        return NULL;
+        return;
     }
     assert( p_blend->ops != NULL );
 
+    /* Warm the caches up */
+    filter_Blend( p_blend, p_base_image,
+                  0, 0, p_blend_image, p_sys->i_alpha );
+
     vlc_tick_t time = vlc_tick_now();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        filter_Blend( p_blend, p_sys->p_base_image,
-                      0, 0, p_sys->p_blend_image, p_sys->i_alpha );
+        filter_Blend( p_blend, p_base_image,
+                      0, 0, p_blend_image, p_sys->i_alpha );
     }
-    time = vlc_tick_now() - time;
-
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              secf_from_vlc_tick(time) );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * CLOCK_FREQ,
-              (float) p_sys->i_loops / time * CLOCK_FREQ *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+    time = __MAX( vlc_tick_now() - time, 1 );
+
+    const double f_pixels =
+        __MIN( p_base_image->format.i_visible_width,
+               p_blend_image->format.i_visible_width ) *
+        __MIN( p_base_image->format.i_visible_height,
+               p_blend_image->format.i_visible_height );
+
+    msg_Info( p_filter, "%4.4s onto %4.4s: blended %d images in %f sec",
+              (const char *)&i_blend_chroma, (const char *)&i_base_chroma,
+              p_sys->i_loops, secf_from_vlc_tick(time) );
+    msg_Info( p_filter, "%4.4s onto %4.4s: %f images/second, "
+              "%.1f Mpixels/second",
+              (const char *)&i_blend_chroma, (const char *)&i_base_chroma,
+              (double) p_sys->i_loops / time * CLOCK_FREQ,
+              (double) p_sys->i_loops / time * CLOCK_FREQ * f_pixels / 1e6 );
 
     vlc_filter_Delete( p_blend );
+}
+
+/*****************************************************************************
+ * Bench: benchmarks one pair of chromas, from the same images for each run
+ *****************************************************************************/
+static void Bench( filter_t *p_filter, vlc_fourcc_t i_base_chroma,
+                   vlc_fourcc_t i_blend_chroma )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_base_image, *p_blend_image;
+
+    if( blendbench_GetImage( p_filter, &p_base_image, i_base_chroma,
+                             p_sys->psz_base_image, "Base" ) )
+        return;
+    if( blendbench_GetImage( p_filter, &p_blend_image, i_blend_chroma,
+                             p_sys->psz_blend_image, "Blend" ) )
+    {
+        picture_Release( p_base_image );
+        return;
+    }
+
+    BenchImages( p_filter, p_base_image, p_blend_image );
+
+    picture_Release( p_blend_image );
+    picture_Release( p_base_image );
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    for( unsigned i = 0; i < p_sys->i_base_chromas; i++ )
+        for( unsigned j = 0; j < p_sys->i_blend_chromas; j++ )
+            Bench( p_filter, p_sys->pi_base_chromas[i],
+                   p_sys->pi_blend_chromas[j] );
 
     p_sys->b_done = true;
     return p_pic;
@@ -1,5 +1,5 @@
 /*****************************************************************************
- * algo_yadif.c : Wrapper for FFmpeg's Yadif algorithm
+ * algo_yadif.c : Wrapper for FFmpeg's Yadif and BWDIF algorithms
  *****************************************************************************
  * Copyright (C) 2000-2011 VLC authors and VideoLAN
  *
@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <assert.h>
+#include <string.h>
 
 #include <vlc_common.h>
 #include <vlc_cpu.h>
@@ -46,16 +47,480 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
-int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
+/* bwdif.h comes from vf_bwdif.c of FFmpeg project. */
+#include "bwdif.h"
+
+/*****************************************************************************
+ * AVX2 line filters
+ *****************************************************************************/
+
+/* These process 16 pixels at a time as 16-bit words, and leave the remaining
+ * pixels to the C functions. The results are identical to the C functions. */
+#ifdef HAVE_AVX2_INTRINSICS
+#include <immintrin.h>
+
+#define YADIF_AVX2_TARGET __attribute__((__target__("avx2")))
+
+YADIF_AVX2_TARGET
+static inline __m256i LoadAVX2( const uint8_t *p )
 {
-    return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
+    return _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)p ) );
 }
 
-int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
-                 int i_order, int i_field )
+YADIF_AVX2_TARGET
+static inline void StoreAVX2( uint8_t *p, __m256i v )
 {
-    VLC_UNUSED(p_src);
+    v = _mm256_permute4x64_epi64( _mm256_packus_epi16( v, v ), 0xD8 );
+    _mm_storeu_si128( (__m128i *)p, _mm256_castsi256_si128( v ) );
+}
+
+YADIF_AVX2_TARGET
+static inline __m256i AbsDiffAVX2( __m256i a, __m256i b )
+{
+    return _mm256_abs_epi16( _mm256_sub_epi16( a, b ) );
+}
+
+/* (a + b) >> 1, for non-negative a and b */
+YADIF_AVX2_TARGET
+static inline __m256i HalfSumAVX2( __m256i a, __m256i b )
+{
+    return _mm256_srli_epi16( _mm256_add_epi16( a, b ), 1 );
+}
+
+/* Pairs of 16-bit coefficients for _mm256_madd_epi16() */
+YADIF_AVX2_TARGET
+static inline __m256i CoefsAVX2( int a, int b )
+{
+    return _mm256_set1_epi32( (int32_t)((uint32_t)(uint16_t)b << 16 | (uint16_t)a) );
+}
+
+/* Yadif CHECK(j): replaces the spatial prediction where the score of the
+ * direction j is better, in the lanes of the mask */
+YADIF_AVX2_TARGET
+static inline __m256i YadifCheckAVX2( const uint8_t *cur, int mrefs, int prefs,
+                                      int j, __m256i mask,
+                                      __m256i *spatial_score,
+                                      __m256i *spatial_pred )
+{
+    __m256i score = _mm256_add_epi16(
+        _mm256_add_epi16(
+            AbsDiffAVX2( LoadAVX2( &cur[mrefs - 1 + j] ),
+                         LoadAVX2( &cur[prefs - 1 - j] ) ),
+            AbsDiffAVX2( LoadAVX2( &cur[mrefs + j] ),
+                         LoadAVX2( &cur[prefs - j] ) ) ),
+        AbsDiffAVX2( LoadAVX2( &cur[mrefs + 1 + j] ),
+                     LoadAVX2( &cur[prefs + 1 - j] ) ) );
+    __m256i pred = HalfSumAVX2( LoadAVX2( &cur[mrefs + j] ),
+                                LoadAVX2( &cur[prefs - j] ) );
+
+    mask = _mm256_and_si256( mask, _mm256_cmpgt_epi16( *spatial_score, score ) );
+    *spatial_score = _mm256_blendv_epi8( *spatial_score, score, mask );
+    *spatial_pred = _mm256_blendv_epi8( *spatial_pred, pred, mask );
+    return mask;
+}
+
+YADIF_AVX2_TARGET
+static void yadif_filter_line_avx2( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                    uint8_t *next, int w, int prefs, int mrefs,
+                                    int parity, int mode )
+{
+    const uint8_t *prev2 = parity ? prev : cur ;
+    const uint8_t *next2 = parity ? cur  : next;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16( -1 );
+    int x;
+
+    for( x = 0; x + 16 <= w; x += 16 )
+    {
+        __m256i c = LoadAVX2( &cur[mrefs + x] );
+        __m256i e = LoadAVX2( &cur[prefs + x] );
+        __m256i p2 = LoadAVX2( &prev2[x] );
+        __m256i n2 = LoadAVX2( &next2[x] );
+        __m256i d = HalfSumAVX2( p2, n2 );
+        __m256i temporal_diff0 = AbsDiffAVX2( p2, n2 );
+        __m256i temporal_diff1 = HalfSumAVX2(
+            AbsDiffAVX2( LoadAVX2( &prev[mrefs + x] ), c ),
+            AbsDiffAVX2( LoadAVX2( &prev[prefs + x] ), e ) );
+        __m256i temporal_diff2 = HalfSumAVX2(
+            AbsDiffAVX2( LoadAVX2( &next[mrefs + x] ), c ),
+            AbsDiffAVX2( LoadAVX2( &next[prefs + x] ), e ) );
+        __m256i diff = _mm256_max_epi16(
+            _mm256_max_epi16( _mm256_srli_epi16( temporal_diff0, 1 ),
+                              temporal_diff1 ), temporal_diff2 );
+        __m256i spatial_pred = HalfSumAVX2( c, e );
+        __m256i spatial_score = _mm256_add_epi16(
+            _mm256_add_epi16(
+                AbsDiffAVX2( LoadAVX2( &cur[mrefs - 1 + x] ),
+                             LoadAVX2( &cur[prefs - 1 + x] ) ),
+                AbsDiffAVX2( c, e ) ),
+            AbsDiffAVX2( LoadAVX2( &cur[mrefs + 1 + x] ),
+                         LoadAVX2( &cur[prefs + 1 + x] ) ) );
+        spatial_score = _mm256_add_epi16( spatial_score, ones );
+
+        __m256i mask;
+        mask = YadifCheckAVX2( &cur[x], mrefs, prefs, -1, ones,
+                               &spatial_score, &spatial_pred );
+        YadifCheckAVX2( &cur[x], mrefs, prefs, -2, mask,
+                        &spatial_score, &spatial_pred );
+        mask = YadifCheckAVX2( &cur[x], mrefs, prefs, 1, ones,
+                               &spatial_score, &spatial_pred );
+        YadifCheckAVX2( &cur[x], mrefs, prefs, 2, mask,
+                        &spatial_score, &spatial_pred );
+
+        if( mode < 2 )
+        {
+            __m256i b = HalfSumAVX2( LoadAVX2( &prev2[2 * mrefs + x] ),
+                                     LoadAVX2( &next2[2 * mrefs + x] ) );
+            __m256i f = HalfSumAVX2( LoadAVX2( &prev2[2 * prefs + x] ),
+                                     LoadAVX2( &next2[2 * prefs + x] ) );
+            __m256i dc = _mm256_sub_epi16( d, c );
+            __m256i de = _mm256_sub_epi16( d, e );
+            __m256i bc = _mm256_sub_epi16( b, c );
+            __m256i fe = _mm256_sub_epi16( f, e );
+            __m256i max = _mm256_max_epi16( _mm256_max_epi16( de, dc ),
+                                            _mm256_min_epi16( bc, fe ) );
+            __m256i min = _mm256_min_epi16( _mm256_min_epi16( de, dc ),
+                                            _mm256_max_epi16( bc, fe ) );
+
+            diff = _mm256_max_epi16( _mm256_max_epi16( diff, min ),
+                                     _mm256_sub_epi16( zero, max ) );
+        }
+
+        /* diff is never negative */
+        spatial_pred = _mm256_min_epi16( spatial_pred, _mm256_add_epi16( d, diff ) );
+        spatial_pred = _mm256_max_epi16( spatial_pred, _mm256_sub_epi16( d, diff ) );
+        StoreAVX2( &dst[x], spatial_pred );
+    }
+
+    if( x < w )
+        yadif_filter_line_c( &dst[x], &prev[x], &cur[x], &next[x], w - x,
+                             prefs, mrefs, parity, mode );
+}
+
+/* Weighted sums of the BWDIF interpolation, in 32-bit precision */
+YADIF_AVX2_TARGET
+static inline __m256i BwdifInterpolateAVX2( __m256i s0_s2, __m256i s4_zero,
+                                            __m256i ce_c3 )
+{
+    __m256i hf = _mm256_add_epi32(
+        _mm256_madd_epi16( s0_s2, CoefsAVX2( bwdif_coef_hf[0], -bwdif_coef_hf[1] ) ),
+        _mm256_madd_epi16( s4_zero, CoefsAVX2( bwdif_coef_hf[2], 0 ) ) );
+
+    hf = _mm256_add_epi32( _mm256_srai_epi32( hf, 2 ),
+        _mm256_madd_epi16( ce_c3, CoefsAVX2( bwdif_coef_lf[0], -bwdif_coef_lf[1] ) ) );
+    return _mm256_srai_epi32( hf, 13 );
+}
+
+YADIF_AVX2_TARGET
+static void bwdif_filter_line_avx2( uint8_t *dst, const uint8_t *prev,
+                                    const uint8_t *cur, const uint8_t *next,
+                                    int w, int prefs, int mrefs,
+                                    int prefs2, int mrefs2,
+                                    int prefs3, int mrefs3,
+                                    int prefs4, int mrefs4,
+                                    int parity, int clip_max )
+{
+    const uint8_t *prev2 = parity ? prev : cur ;
+    const uint8_t *next2 = parity ? cur  : next;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i coef_sp = CoefsAVX2( bwdif_coef_sp[0], -bwdif_coef_sp[1] );
+    int x;
+
+    assert( clip_max == 255 );
+
+    for( x = 0; x + 16 <= w; x += 16 )
+    {
+        __m256i c = LoadAVX2( &cur[mrefs + x] );
+        __m256i e = LoadAVX2( &cur[prefs + x] );
+        __m256i p2 = LoadAVX2( &prev2[x] );
+        __m256i n2 = LoadAVX2( &next2[x] );
+        __m256i d = HalfSumAVX2( p2, n2 );
+        __m256i temporal_diff0 = AbsDiffAVX2( p2, n2 );
+        __m256i temporal_diff1 = HalfSumAVX2(
+            AbsDiffAVX2( LoadAVX2( &prev[mrefs + x] ), c ),
+            AbsDiffAVX2( LoadAVX2( &prev[prefs + x] ), e ) );
+        __m256i temporal_diff2 = HalfSumAVX2(
+            AbsDiffAVX2( LoadAVX2( &next[mrefs + x] ), c ),
+            AbsDiffAVX2( LoadAVX2( &next[prefs + x] ), e ) );
+        __m256i temporal_diff = _mm256_max_epi16(
+            _mm256_max_epi16( _mm256_srli_epi16( temporal_diff0, 1 ),
+                              temporal_diff1 ), temporal_diff2 );
+
+        /* Spatial check */
+        __m256i p2m2 = LoadAVX2( &prev2[mrefs2 + x] );
+        __m256i n2m2 = LoadAVX2( &next2[mrefs2 + x] );
+        __m256i p2p2 = LoadAVX2( &prev2[prefs2 + x] );
+        __m256i n2p2 = LoadAVX2( &next2[prefs2 + x] );
+        __m256i b = _mm256_sub_epi16( HalfSumAVX2( p2m2, n2m2 ), c );
+        __m256i f = _mm256_sub_epi16( HalfSumAVX2( p2p2, n2p2 ), e );
+        __m256i dc = _mm256_sub_epi16( d, c );
+        __m256i de = _mm256_sub_epi16( d, e );
+        __m256i max = _mm256_max_epi16( _mm256_max_epi16( de, dc ),
+                                        _mm256_min_epi16( b, f ) );
+        __m256i min = _mm256_min_epi16( _mm256_min_epi16( de, dc ),
+                                        _mm256_max_epi16( b, f ) );
+        __m256i diff = _mm256_max_epi16( _mm256_max_epi16( temporal_diff, min ),
+                                         _mm256_sub_epi16( zero, max ) );
+
+        /* Spatial and temporal interpolation */
+        __m256i s0 = _mm256_add_epi16( p2, n2 );
+        __m256i s2 = _mm256_add_epi16( _mm256_add_epi16( p2m2, n2m2 ),
+                                       _mm256_add_epi16( p2p2, n2p2 ) );
+        __m256i s4 = _mm256_add_epi16(
+            _mm256_add_epi16( LoadAVX2( &prev2[mrefs4 + x] ),
+                              LoadAVX2( &next2[mrefs4 + x] ) ),
+            _mm256_add_epi16( LoadAVX2( &prev2[prefs4 + x] ),
+                              LoadAVX2( &next2[prefs4 + x] ) ) );
+        __m256i ce = _mm256_add_epi16( c, e );
+        __m256i c3 = _mm256_add_epi16( LoadAVX2( &cur[mrefs3 + x] ),
+                                       LoadAVX2( &cur[prefs3 + x] ) );
+        __m256i ce_c3_lo = _mm256_unpacklo_epi16( ce, c3 );
+        __m256i ce_c3_hi = _mm256_unpackhi_epi16( ce, c3 );
+
+        __m256i hf = _mm256_packs_epi32(
+            BwdifInterpolateAVX2( _mm256_unpacklo_epi16( s0, s2 ),
+                                  _mm256_unpacklo_epi16( s4, zero ), ce_c3_lo ),
+            BwdifInterpolateAVX2( _mm256_unpackhi_epi16( s0, s2 ),
+                                  _mm256_unpackhi_epi16( s4, zero ), ce_c3_hi ) );
+        __m256i sp = _mm256_packs_epi32(
+            _mm256_srai_epi32( _mm256_madd_epi16( ce_c3_lo, coef_sp ), 13 ),
+            _mm256_srai_epi32( _mm256_madd_epi16( ce_c3_hi, coef_sp ), 13 ) );
+        __m256i interpol = _mm256_blendv_epi8( sp, hf,
+            _mm256_cmpgt_epi16( AbsDiffAVX2( c, e ), temporal_diff0 ) );
+
+        /* diff is never negative; packing clips to 0-255 */
+        interpol = _mm256_min_epi16( interpol, _mm256_add_epi16( d, diff ) );
+        interpol = _mm256_max_epi16( interpol, _mm256_sub_epi16( d, diff ) );
+        interpol = _mm256_blendv_epi8( interpol, d,
+            _mm256_cmpeq_epi16( temporal_diff, zero ) );
+        StoreAVX2( &dst[x], interpol );
+    }
+
+    if( x < w )
+        bwdif_filter_line_c( &dst[x], &prev[x], &cur[x], &next[x], w - x,
+                             prefs, mrefs, prefs2, mrefs2, prefs3, mrefs3,
+                             prefs4, mrefs4, parity, clip_max );
+}
+#endif
+
+/*****************************************************************************
+ * Frame rendering
+ *****************************************************************************/
+
+typedef void (*yadif_filter_line)( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                   uint8_t *next, int w, int prefs, int mrefs,
+                                   int parity, int mode );
+typedef void (*bwdif_filter_line)( uint8_t *dst, const uint8_t *prev,
+                                   const uint8_t *cur, const uint8_t *next,
+                                   int w, int prefs, int mrefs,
+                                   int prefs2, int mrefs2,
+                                   int prefs3, int mrefs3,
+                                   int prefs4, int mrefs4,
+                                   int parity, int clip_max );
+typedef void (*bwdif_filter_edge)( uint8_t *dst, const uint8_t *prev,
+                                   const uint8_t *cur, const uint8_t *next,
+                                   int w, int prefs, int mrefs,
+                                   int prefs2, int mrefs2,
+                                   int parity, int clip_max, int spat );
+
+/** A field to interpolate, as rendered by each slice thread */
+struct yadif_job
+{
+    picture_t *p_dst;
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    const picture_t *p_next;
+    int i_field;
+    int i_parity;
+    unsigned i_pixel_size;
+    int i_clip_max;
+
+    void (*pf_render_lines)( const struct yadif_job *, int n,
+                             int y_start, int y_end );
+    yadif_filter_line pf_yadif;
+    bwdif_filter_line pf_bwdif;
+    bwdif_filter_edge pf_bwdif_edge;
+};
+
+static void YadifLines( const struct yadif_job *job, int n,
+                        int y_start, int y_end )
+{
+    const plane_t *prevp = &job->p_prev->p[n];
+    const plane_t *curp  = &job->p_cur->p[n];
+    const plane_t *nextp = &job->p_next->p[n];
+    plane_t *dstp        = &job->p_dst->p[n];
+    const int w = dstp->i_visible_pitch / job->i_pixel_size;
+
+    for( int y = __MAX( y_start, 1 );
+         y < __MIN( y_end, dstp->i_visible_lines - 1 ); y++ )
+    {
+        if( (y % 2) == job->i_field  ||  job->i_parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+            job->pf_yadif( &dstp->p_pixels[y * dstp->i_pitch],
+                           &prevp->p_pixels[y * prevp->i_pitch],
+                           &curp->p_pixels[y * curp->i_pitch],
+                           &nextp->p_pixels[y * nextp->i_pitch],
+                           w,
+                           y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                           y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                           job->i_parity,
+                           mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+}
+
+static void BwdifLines( const struct yadif_job *job, int n,
+                        int y_start, int y_end )
+{
+    const plane_t *prevp = &job->p_prev->p[n];
+    const plane_t *curp  = &job->p_cur->p[n];
+    const plane_t *nextp = &job->p_next->p[n];
+    plane_t *dstp        = &job->p_dst->p[n];
+    const int w = dstp->i_visible_pitch / job->i_pixel_size;
+    const int h = dstp->i_visible_lines;
+    const int refs = curp->i_pitch;
 
+    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+
+    for( int y = y_start; y < y_end; y++ )
+    {
+        uint8_t *dst = &dstp->p_pixels[y * dstp->i_pitch];
+        const uint8_t *prev = &prevp->p_pixels[y * refs];
+        const uint8_t *cur  = &curp->p_pixels[y * refs];
+        const uint8_t *next = &nextp->p_pixels[y * refs];
+
+        if( (y % 2) == job->i_field  ||  job->i_parity == 2 )
+            memcpy( dst, cur, dstp->i_visible_pitch );
+        else if( y < 4 || y + 5 > h )
+            /* Spatial checks and the long filter only when enough data */
+            job->pf_bwdif_edge( dst, prev, cur, next, w,
+                                y + 1 < h ? refs : -refs,
+                                y > 0 ? -refs : refs,
+                                2 * refs, -2 * refs,
+                                job->i_parity, job->i_clip_max,
+                                y >= 2 && y + 3 <= h );
+        else
+            job->pf_bwdif( dst, prev, cur, next, w, refs, -refs,
+                           2 * refs, -2 * refs, 3 * refs, -3 * refs,
+                           4 * refs, -4 * refs,
+                           job->i_parity, job->i_clip_max );
+    }
+}
+
+/* The lines of all the planes are numbered one after the other, so that
+ * a single run of slices covers the whole picture. */
+static void RenderSlice( void *opaque, unsigned worker,
+                         unsigned first, unsigned count )
+{
+    const struct yadif_job *job = opaque;
+    VLC_UNUSED(worker);
+
+    for( int n = 0; n < job->p_dst->i_planes && count > 0; n++ )
+    {
+        const unsigned lines = job->p_dst->p[n].i_visible_lines;
+
+        if( first >= lines )
+        {
+            first -= lines;
+            continue;
+        }
+
+        const unsigned plane_count = __MIN( count, lines - first );
+        job->pf_render_lines( job, n, first, first + plane_count );
+        first = 0;
+        count -= plane_count;
+    }
+}
+
+bool YadifHasKernel( const char *psz_name )
+{
+    static const char *const kernels[] = {
+        "c",
+#if defined(HAVE_X86ASM)
+        "sse2", "ssse3",
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        "avx2",
+#endif
+    };
+
+    for( size_t i = 0; i < ARRAY_SIZE(kernels); i++ )
+        if( !strcmp( kernels[i], psz_name ) )
+            return true;
+    return false;
+}
+
+static bool UseKernel( const filter_sys_t *p_sys, const char *psz_name )
+{
+    return p_sys->psz_kernel == NULL || !strcmp( p_sys->psz_kernel, psz_name );
+}
+
+static void SetupYadif( filter_sys_t *p_sys, struct yadif_job *job )
+{
+    job->pf_render_lines = YadifLines;
+
+    if( p_sys->chroma->pixel_size == 2 )
+        job->pf_yadif = yadif_filter_line_c_16bit;
+    else
+#ifdef HAVE_AVX2_INTRINSICS
+    if( UseKernel( p_sys, "avx2" ) && vlc_CPU_AVX2() )
+        job->pf_yadif = yadif_filter_line_avx2;
+    else
+#endif
+#if defined(HAVE_X86ASM)
+    if( UseKernel( p_sys, "ssse3" ) && vlc_CPU_SSSE3() )
+        job->pf_yadif = vlcpriv_yadif_filter_line_ssse3;
+    else
+    if( UseKernel( p_sys, "sse2" ) && vlc_CPU_SSE2() )
+        job->pf_yadif = vlcpriv_yadif_filter_line_sse2;
+    else
+#endif
+        job->pf_yadif = yadif_filter_line_c;
+}
+
+static void SetupBwdif( filter_sys_t *p_sys, struct yadif_job *job )
+{
+    job->pf_render_lines = BwdifLines;
+
+    if( p_sys->chroma->pixel_size == 2 )
+    {
+        job->pf_bwdif = bwdif_filter_line_c_16bit;
+        job->pf_bwdif_edge = bwdif_filter_edge_c_16bit;
+        return;
+    }
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if( UseKernel( p_sys, "avx2" ) && vlc_CPU_AVX2() )
+        job->pf_bwdif = bwdif_filter_line_avx2;
+    else
+#endif
+        job->pf_bwdif = bwdif_filter_line_c;
+    job->pf_bwdif_edge = bwdif_filter_edge_c;
+}
+
+static int RenderTemporal( filter_t *p_filter, picture_t *p_dst,
+                           int i_order, int i_field, bool b_bwdif )
+{
     filter_sys_t *p_sys = p_filter->p_sys;
 
     /* */
@@ -108,66 +573,28 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        struct yadif_job job = {
+            .p_dst = p_dst,
+            .p_prev = p_prev,
+            .p_cur = p_cur,
+            .p_next = p_next,
+            .i_field = i_field,
+            .i_parity = yadif_parity,
+            .i_pixel_size = p_sys->chroma->pixel_size,
+            .i_clip_max = (1 << p_sys->chroma->pixel_bits) - 1,
+        };
 
-#if defined(HAVE_X86ASM)
-        if( vlc_CPU_SSSE3() )
-            filter = vlcpriv_yadif_filter_line_ssse3;
+        if( b_bwdif )
+            SetupBwdif( p_sys, &job );
         else
-        if( vlc_CPU_SSE2() )
-            filter = vlcpriv_yadif_filter_line_sse2;
-        else
-#endif
-            filter = yadif_filter_line_c;
-
-        if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
+            SetupYadif( p_sys, &job );
 
+        unsigned lines = 0;
         for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+            lines += p_dst->p[n].i_visible_lines;
+
+        /* The lines of a slice only depend on the input pictures */
+        SliceRun( &p_sys->threads, lines, 1, RenderSlice, &job );
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
@@ -189,3 +616,31 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         return VLC_EGENERIC;
     }
 }
+
+int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
+{
+    return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
+}
+
+int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
+                 int i_order, int i_field )
+{
+    VLC_UNUSED(p_src);
+    return RenderTemporal( p_filter, p_dst, i_order, i_field, false );
+}
+
+/*****************************************************************************
+ * BWDIF (Bob Weaver DeInterlacing Filter).
+ *****************************************************************************/
+
+int RenderBwdifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
+{
+    return RenderBwdif( p_filter, p_dst, p_src, 0, 0 );
+}
+
+int RenderBwdif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
+                 int i_order, int i_field )
+{
+    VLC_UNUSED(p_src);
+    return RenderTemporal( p_filter, p_dst, i_order, i_field, true );
+}
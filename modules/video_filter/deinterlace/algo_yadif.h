@@ -26,8 +26,10 @@
 
 /**
  * \file
- * Adapter to fit the Yadif (Yet Another DeInterlacing Filter) algorithm
- * from FFmpeg into VLC. The algorithm itself is implemented in yadif.h.
+ * Adapter to fit the Yadif (Yet Another DeInterlacing Filter) and BWDIF
+ * (Bob Weaver DeInterlacing Filter) algorithms from FFmpeg into VLC.
+ * The algorithms themselves are implemented in yadif.h and bwdif.h.
+ * The fields are interpolated by slices on the threads of filter_sys_t.
  */
 
 /* Forward declarations */
@@ -90,4 +92,26 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
  */
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src );
 
+/**
+ * BWDIF (Bob Weaver DeInterlacing Filter) from FFmpeg.
+ * Same as RenderYadif(), with the same parameters and frame history,
+ * but interpolates with the longer filters of the Weston 3-field
+ * deinterlacer where Yadif uses a plain average, for a sharper picture.
+ * @see RenderYadif()
+ */
+int RenderBwdif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
+                 int i_order, int i_field );
+
+/**
+ * Same as RenderBwdif() but with no temporal references
+ */
+int RenderBwdifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src );
+
+/**
+ * Tells whether a line filter kernel is built in.
+ *
+ * @param psz_name "c", "sse2", "ssse3" or "avx2"
+ */
+bool YadifHasKernel( const char *psz_name );
+
 #endif
@@ -0,0 +1,178 @@
+/*
+ * BobWeaver Deinterlacing Filter
+ * Copyright (C) 2016 Thomas Mundt <loudmax@yahoo.de>
+ *
+ * Based on YADIF (Yet Another Deinterlacing Filter)
+ * Copyright (C) 2006-2011 Michael Niedermayer <michaelni@gmx.at>
+ *               2010      James Darnley <james.darnley@gmail.com>
+ *
+ * With use of Weston 3 Field Deinterlacing Filter algorithm
+ * Copyright (C) 2012 British Broadcasting Corporation, All Rights Reserved
+ * Author of de-interlace algorithm: Jim Easterbrook for BBC R&D
+ * Based on the process described by Martin Weston for BBC R&D
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#define FFABS abs
+
+/*
+ * Filter coefficients coef_lf and coef_hf taken from BBC PH-2071 (Weston 3 Field Deinterlacer).
+ * Used when there is spatial and temporal interpolation.
+ * Filter coefficients coef_sp are used when there is spatial interpolation only.
+ * Adjusted for matching visual sharpness impression of spatial and temporal interpolation.
+ */
+static const int bwdif_coef_lf[2] = { 4309, 213 };
+static const int bwdif_coef_hf[3] = { 5570, 3801, 1016 };
+static const int bwdif_coef_sp[2] = { 5077, 981 };
+
+#define BWDIF_FILTER1 \
+    for (x = 0; x < w; x++) { \
+        int c = cur[mrefs]; \
+        int d = (prev2[0] + next2[0]) >> 1; \
+        int e = cur[prefs]; \
+        int temporal_diff0 = FFABS(prev2[0] - next2[0]); \
+        int temporal_diff1 =(FFABS(prev[mrefs] - c) + FFABS(prev[prefs] - e)) >> 1; \
+        int temporal_diff2 =(FFABS(next[mrefs] - c) + FFABS(next[prefs] - e)) >> 1; \
+        int diff = FFMAX3(temporal_diff0 >> 1, temporal_diff1, temporal_diff2); \
+        int interpol; \
+ \
+        if (!diff) { \
+            dst[0] = d; \
+        } else {
+
+#define BWDIF_SPAT_CHECK \
+            int b = ((prev2[mrefs2] + next2[mrefs2]) >> 1) - c; \
+            int f = ((prev2[prefs2] + next2[prefs2]) >> 1) - e; \
+            int dc = d - c; \
+            int de = d - e; \
+            int max = FFMAX3(de, dc, FFMIN(b, f)); \
+            int min = FFMIN3(de, dc, FFMAX(b, f)); \
+            diff = FFMAX3(diff, min, -max);
+
+#define BWDIF_FILTER_LINE \
+            BWDIF_SPAT_CHECK \
+            if (FFABS(c - e) > temporal_diff0) { \
+                interpol = (((bwdif_coef_hf[0] * (prev2[0] + next2[0]) \
+                    - bwdif_coef_hf[1] * (prev2[mrefs2] + next2[mrefs2] + prev2[prefs2] + next2[prefs2]) \
+                    + bwdif_coef_hf[2] * (prev2[mrefs4] + next2[mrefs4] + prev2[prefs4] + next2[prefs4])) >> 2) \
+                    + bwdif_coef_lf[0] * (c + e) - bwdif_coef_lf[1] * (cur[mrefs3] + cur[prefs3])) >> 13; \
+            } else { \
+                interpol = (bwdif_coef_sp[0] * (c + e) - bwdif_coef_sp[1] * (cur[mrefs3] + cur[prefs3])) >> 13; \
+            }
+
+#define BWDIF_FILTER_EDGE \
+            if (spat) { \
+                BWDIF_SPAT_CHECK \
+            } \
+            interpol = (c + e) >> 1;
+
+#define BWDIF_FILTER2 \
+            if (interpol > d + diff) \
+                interpol = d + diff; \
+            else if (interpol < d - diff) \
+                interpol = d - diff; \
+ \
+            dst[0] = VLC_CLIP(interpol, 0, clip_max); \
+        } \
+ \
+        dst++; \
+        cur++; \
+        prev++; \
+        next++; \
+        prev2++; \
+        next2++; \
+    }
+
+/* The references are given in bytes, the width in pixels. */
+static void bwdif_filter_line_c(uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next,
+                                int w, int prefs, int mrefs, int prefs2, int mrefs2,
+                                int prefs3, int mrefs3, int prefs4, int mrefs4,
+                                int parity, int clip_max)
+{
+    int x;
+    const uint8_t *prev2 = parity ? prev : cur ;
+    const uint8_t *next2 = parity ? cur  : next;
+
+    BWDIF_FILTER1
+    BWDIF_FILTER_LINE
+    BWDIF_FILTER2
+}
+
+static void bwdif_filter_edge_c(uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next,
+                                int w, int prefs, int mrefs, int prefs2, int mrefs2,
+                                int parity, int clip_max, int spat)
+{
+    int x;
+    const uint8_t *prev2 = parity ? prev : cur ;
+    const uint8_t *next2 = parity ? cur  : next;
+
+    BWDIF_FILTER1
+    BWDIF_FILTER_EDGE
+    BWDIF_FILTER2
+}
+
+static void bwdif_filter_line_c_16bit(uint8_t *dst8, const uint8_t *prev8, const uint8_t *cur8, const uint8_t *next8,
+                                      int w, int prefs, int mrefs, int prefs2, int mrefs2,
+                                      int prefs3, int mrefs3, int prefs4, int mrefs4,
+                                      int parity, int clip_max)
+{
+    uint16_t *dst = (uint16_t *)dst8;
+    const uint16_t *prev = (const uint16_t *)prev8;
+    const uint16_t *cur = (const uint16_t *)cur8;
+    const uint16_t *next = (const uint16_t *)next8;
+    int x;
+    const uint16_t *prev2 = parity ? prev : cur ;
+    const uint16_t *next2 = parity ? cur  : next;
+    mrefs /= 2;
+    prefs /= 2;
+    mrefs2 /= 2;
+    prefs2 /= 2;
+    mrefs3 /= 2;
+    prefs3 /= 2;
+    mrefs4 /= 2;
+    prefs4 /= 2;
+
+    BWDIF_FILTER1
+    BWDIF_FILTER_LINE
+    BWDIF_FILTER2
+}
+
+static void bwdif_filter_edge_c_16bit(uint8_t *dst8, const uint8_t *prev8, const uint8_t *cur8, const uint8_t *next8,
+                                      int w, int prefs, int mrefs, int prefs2, int mrefs2,
+                                      int parity, int clip_max, int spat)
+{
+    uint16_t *dst = (uint16_t *)dst8;
+    const uint16_t *prev = (const uint16_t *)prev8;
+    const uint16_t *cur = (const uint16_t *)cur8;
+    const uint16_t *next = (const uint16_t *)next8;
+    int x;
+    const uint16_t *prev2 = parity ? prev : cur ;
+    const uint16_t *next2 = parity ? cur  : next;
+    mrefs /= 2;
+    prefs /= 2;
+    mrefs2 /= 2;
+    prefs2 /= 2;
+
+    BWDIF_FILTER1
+    BWDIF_FILTER_EDGE
+    BWDIF_FILTER2
+}
@@ -289,6 +289,12 @@ static int Mouse( filter_t *p_filter,
                                     "in the Phosphor framerate doubler. "\
                                     "Default: Low.")
 
+#define KERNEL_TEXT N_("Line filter kernel")
+#define KERNEL_LONGTEXT N_( \
+    "Only use the given Yadif and BWDIF line filter kernel: \"c\", " \
+    "\"sse2\", \"ssse3\" or \"avx2\". By default, the fastest kernel " \
+    "supported by the CPU is used.")
+
 vlc_module_begin ()
     set_description( N_("Deinterlacing video filter") )
     set_shortname( N_("Deinterlace" ))
@@ -306,6 +312,8 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_string( "deinterlace-kernel", NULL, KERNEL_TEXT, KERNEL_LONGTEXT )
+        change_private ()
     set_deinterlace_callback( Open )
 vlc_module_end ()
 
@@ -339,6 +347,7 @@ struct filter_mode_t
     deinterlace_algo     settings;
     bool                 can_pack;         /**< can handle packed pixel */
     bool                 b_high_bit_depth; /**< can handle high bit depth */
+    bool                 b_slices;         /**< renders by slice threads */
 };
 static struct filter_mode_t filter_mode [] = {
     { "discard", .pf_render_single_pic = RenderDiscard,
@@ -354,9 +363,13 @@ static struct filter_mode_t filter_mode [] = {
     { "blend", .pf_render_single_pic = RenderBlend,
                  { false, false, false, false }, true, true },
     { "yadif", .pf_render_single_pic = RenderYadifSingle,
-                 { false, true, false, false }, false, true },
+                 { false, true, false, false }, false, true, true },
     { "yadif2x", .pf_render_ordered = RenderYadif,
-                 { true, true, false, false }, false, true },
+                 { true, true, false, false }, false, true, true },
+    { "bwdif", .pf_render_single_pic = RenderBwdifSingle,
+                 { false, true, false, false }, false, true, true },
+    { "bwdif2x", .pf_render_ordered = RenderBwdif,
+                 { true, true, false, false }, false, true, true },
     { "x", .pf_render_single_pic = RenderX,
                  { false, false, false, false }, false, false },
     { "phosphor", .pf_render_ordered = RenderPhosphor,
@@ -401,7 +414,11 @@ static int SetFilterMethod( filter_t *p_filter, const char *mode, bool pack )
             msg_Dbg( p_filter, "using %s deinterlace method", mode );
             p_sys->context.settings = filter_mode[i].settings;
             p_sys->context.pf_render_ordered = filter_mode[i].pf_render_ordered;
-            return VLC_SUCCESS;
+
+            p_sys->threads = (slice_threads_t){ .threads = 1 };
+            if( !filter_mode[i].b_slices )
+                return VLC_SUCCESS;
+            return SliceInitThreads( VLC_OBJECT(p_filter), &p_sys->threads );
         }
     }
 
@@ -479,8 +496,12 @@ int Mouse( filter_t *p_filter,
  */
 static void Close( filter_t *p_filter )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
+
     Flush( p_filter );
-    free( p_filter->p_sys );
+    SliceCleanThreads( &p_sys->threads );
+    free( p_sys->psz_kernel );
+    free( p_sys );
 }
 
 static const struct vlc_filter_operations filter_ops = {
@@ -552,6 +573,17 @@ notsupp:
         return ret;
     }
 
+    /* The tests compare each line filter kernel with the C one */
+    p_sys->psz_kernel = var_InheritString( p_filter, "deinterlace-kernel" );
+    if( p_sys->psz_kernel != NULL && !YadifHasKernel( p_sys->psz_kernel ) )
+    {
+        msg_Err( p_filter, "line filter kernel %s not available",
+                 p_sys->psz_kernel );
+        free( psz_mode );
+        Close( p_filter );
+        return VLC_EGENERIC;
+    }
+
     IVTCClearState( p_filter );
 
 #if defined(CAN_COMPILE_C_ALTIVEC)
@@ -42,6 +42,7 @@ struct vlc_object_t;
 #include "algo_phosphor.h"
 #include "algo_ivtc.h"
 #include "common.h"
+#include "../../video_chroma/slices.h"
 
 /*****************************************************************************
  * Local data
@@ -50,12 +51,13 @@ struct vlc_object_t;
 /** Available deinterlace modes. */
 static const char *const mode_list[] = {
     "discard", "blend", "mean", "bob", "linear", "x",
-    "yadif", "yadif2x", "phosphor", "ivtc" };
+    "yadif", "yadif2x", "bwdif", "bwdif2x", "phosphor", "ivtc" };
 
 /** User labels for the available deinterlace modes. */
 static const char *const mode_list_text[] = {
     N_("Discard"), N_("Blend"), N_("Mean"), N_("Bob"), N_("Linear"), "X",
-    "Yadif", "Yadif (2x)", N_("Phosphor"), N_("Film NTSC (IVTC)") };
+    "Yadif", "Yadif (2x)", "BWDIF", "BWDIF (2x)", N_("Phosphor"),
+    N_("Film NTSC (IVTC)") };
 
 /*****************************************************************************
  * Data structures
@@ -77,6 +79,11 @@ typedef struct
 
     struct deinterlace_ctx   context;
 
+    /** Slice threads of the temporal algorithms (Yadif, BWDIF) */
+    slice_threads_t threads;
+    /** Only line filter kernel to use (Yadif, BWDIF), or NULL */
+    char *psz_kernel;
+
     /* Algorithm-specific substructures */
     union {
         phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
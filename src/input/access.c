@@ -270,6 +270,8 @@ static int AStreamControl(stream_t *s, int cmd, va_list args)
 {
     stream_t *access = s->p_sys;
 
+    if (cmd == STREAM_GET_PREFETCH_STATS)
+        return VLC_EGENERIC; /* polled by the input, never an access */
     return vlc_stream_vaControl(access, cmd, args);
 }
 
@@ -280,6 +282,21 @@ static void AStreamDestroy(stream_t *s)
     vlc_stream_Delete(access);
 }
 
+/**
+ * Whether the access hands out views of its data, such as a memory-mapped
+ * file, rather than reading into buffers.
+ */
+static bool AccessIsMapped(stream_t *access)
+{
+    bool in_place;
+
+    if (access->pf_block == NULL || access->pf_read != NULL)
+        return false;
+    if (vlc_stream_Control(access, STREAM_CAN_PEEK_BLOCK, &in_place))
+        return false;
+    return in_place;
+}
+
 stream_t *stream_AccessNew(vlc_object_t *parent, input_thread_t *input,
                            es_out_t *out, bool preparsing, const char *url)
 {
@@ -324,7 +341,21 @@ stream_t *stream_AccessNew(vlc_object_t *parent, input_thread_t *input,
         s->pf_control = AStreamControl;
         s->p_sys = access;
 
-        s = stream_FilterChainNew(s, "prefetch,cache");
+        bool fast_seek = false;
+        if (vlc_stream_Control(access, STREAM_CAN_FASTSEEK, &fast_seek))
+            fast_seek = false;
+
+        /* Memory-mapped local files hand out their data in place: caching
+         * would only add a copy. Demuxers of random access formats jump
+         * between the index and the data: if requested, slow seekable
+         * sources keep the ranges already fetched, below the read-ahead. */
+        if (AccessIsMapped(access))
+            ;
+        else if (!fast_seek && vlc_stream_CanSeek(access)
+              && var_InheritBool(access, "stream-cache"))
+            s = stream_FilterChainNew(s, "cache:prefetch");
+        else
+            s = stream_FilterChainNew(s, "prefetch,cache");
     }
     else
         s = access;
@@ -148,9 +148,14 @@ struct vlc_input_decoder_t
     bool           b_fmt_description;
     vlc_meta_t     *p_description;
     atomic_int     reload;
+    atomic_bool    status_changed; /* b_fmt_description or cc.desc_changed */
 
     /* fifo */
     block_fifo_t *p_fifo;
+    /* Frames from vlc_input_decoder_Decode(), queued without locking the fifo.
+     * Frames queued before input_discard are dropped, 0 if none (fifo lock). */
+    vlc_spsc_fifo_t *p_input;
+    uint64_t     input_discard;
 
     /* Lock for communication with decoder thread */
     vlc_cond_t  wait_request;
@@ -468,6 +473,7 @@ static void DecoderUpdateFormatLocked( vlc_input_decoder_t *p_owner )
     }
 
     p_owner->b_fmt_description = true;
+    atomic_store_explicit( &p_owner->status_changed, true, memory_order_release );
 }
 
 static void MouseEvent( const vlc_mouse_t *newmouse, void *user_data )
@@ -1236,6 +1242,8 @@ static void DecoderPlayCcLocked( vlc_input_decoder_t *p_owner, vlc_frame_t *p_cc
     {
         p_owner->cc.desc = *p_desc;
         p_owner->cc.desc_changed = true;
+        atomic_store_explicit(&p_owner->status_changed, true,
+                              memory_order_release);
     }
 
     if (p_owner->cc.count == 0)
@@ -1403,16 +1411,20 @@ static void ModuleThread_QueueVideo( decoder_t *p_dec, picture_t *p_pic )
     unsigned displayed = 0;
     unsigned vout_lost = 0;
     unsigned vout_late = 0;
+    unsigned spu_cache_hits = 0;
+    unsigned spu_cache_misses = 0;
     if( p_owner->p_vout != NULL )
     {
-        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost, &vout_late );
+        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost, &vout_late,
+                                &spu_cache_hits, &spu_cache_misses );
     }
     if (success != VLC_SUCCESS)
         vout_lost++;
 
     vlc_fifo_Unlock(p_owner->p_fifo);
 
-    decoder_Notify(p_owner, on_new_video_stats, 1, vout_lost, displayed, vout_late);
+    decoder_Notify(p_owner, on_new_video_stats, 1, vout_lost, displayed, vout_late,
+                   spu_cache_hits, spu_cache_misses);
 }
 
 static vlc_decoder_device * thumbnailer_get_device( decoder_t *p_dec )
@@ -1765,6 +1777,23 @@ static void DecoderThread_Flush( vlc_input_decoder_t *p_owner )
         p_dec->pf_flush( p_dec );
 }
 
+static vlc_frame_t *DecoderThread_Dequeue( vlc_input_decoder_t *p_owner )
+{
+    vlc_fifo_Assert( p_owner->p_fifo );
+
+    /* Drop the frames queued before the last flush or reset */
+    if( p_owner->input_discard != 0 )
+    {
+        vlc_spsc_fifo_Discard( p_owner->p_input, p_owner->input_discard );
+        p_owner->input_discard = 0;
+    }
+
+    vlc_frame_t *frame = vlc_spsc_fifo_Dequeue( p_owner->p_input );
+    if( frame == NULL ) /* CC sub-decoders are fed from the locked fifo */
+        frame = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+    return frame;
+}
+
 /**
  * The decoding main loop
  *
@@ -1839,15 +1868,19 @@ static void *DecoderThread( void *p_data )
 
         vlc_cond_signal( &p_owner->wait_fifo );
 
-        vlc_frame_t *frame = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        vlc_frame_t *frame = DecoderThread_Dequeue( p_owner );
         if( frame == NULL )
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
-                p_owner->b_idle = true;
-                vlc_cond_signal( &p_owner->wait_acknowledge );
-                vlc_fifo_Wait( p_owner->p_fifo );
-                p_owner->b_idle = false;
+                if( vlc_spsc_fifo_Park( p_owner->p_input ) )
+                {
+                    p_owner->b_idle = true;
+                    vlc_cond_signal( &p_owner->wait_acknowledge );
+                    vlc_fifo_Wait( p_owner->p_fifo );
+                    p_owner->b_idle = false;
+                    vlc_spsc_fifo_Unpark( p_owner->p_input );
+                }
                 continue;
             }
             /* We have emptied the FIFO and there is a pending request to
@@ -1976,6 +2009,7 @@ CreateDecoder( vlc_object_t *p_parent, const struct vlc_input_decoder_cfg *cfg )
     p_owner->flushing = false;
     p_owner->b_draining = false;
     atomic_init( &p_owner->reload, RELOAD_NO_REQUEST );
+    atomic_init( &p_owner->status_changed, false );
     p_owner->b_idle = false;
 
     p_owner->mouse_event = NULL;
@@ -1991,6 +2025,15 @@ CreateDecoder( vlc_object_t *p_parent, const struct vlc_input_decoder_cfg *cfg )
         return NULL;
     }
 
+    p_owner->p_input = vlc_spsc_fifo_New();
+    if( unlikely(p_owner->p_input == NULL) )
+    {
+        block_FifoRelease( p_owner->p_fifo );
+        vlc_object_delete(p_dec);
+        return NULL;
+    }
+    p_owner->input_discard = 0;
+
     vlc_mutex_init( &p_owner->mouse_lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
@@ -2157,6 +2200,7 @@ static void DeleteDecoder( vlc_input_decoder_t *p_owner, enum es_format_category
     if( p_owner->p_description )
         vlc_meta_Delete( p_owner->p_description );
 
+    vlc_spsc_fifo_Delete( p_owner->p_input );
     block_FifoRelease( p_owner->p_fifo );
     decoder_Destroy( p_owner->p_packetizer );
     decoder_Destroy( &p_owner->dec );
@@ -2417,47 +2461,73 @@ void vlc_input_decoder_DecodeWithStatus(vlc_input_decoder_t *p_owner, vlc_frame_
         return;
     }
 
-    vlc_fifo_Lock( p_owner->p_fifo );
+    /* The input thread is the only producer: only take the fifo lock when
+     * the decoder thread must be woken up or waited for. */
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
         /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        if( vlc_spsc_fifo_GetBytes( p_owner->p_input ) > 400*1024*1024 )
         {
-            msg_Warn( &p_owner->dec, "decoder/packetizer fifo full (data not "
-                      "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
-            frame->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+            vlc_fifo_Lock( p_owner->p_fifo );
+            if( p_owner->input_discard == 0 )
+            {
+                msg_Warn( &p_owner->dec, "decoder/packetizer fifo full (data not "
+                          "consumed quickly enough), resetting fifo!" );
+                p_owner->input_discard = vlc_spsc_fifo_GetMark( p_owner->p_input );
+                frame->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+            }
+            vlc_fifo_Unlock( p_owner->p_fifo );
         }
     }
     else
-    if( !p_owner->b_waiting )
+    if( !p_owner->b_waiting
+     && vlc_spsc_fifo_GetCount( p_owner->p_input ) >= 10 )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        vlc_fifo_Lock( p_owner->p_fifo );
+        while( vlc_spsc_fifo_GetCount( p_owner->p_input ) >= 10 )
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+    }
+
+    if( vlc_spsc_fifo_Queue( p_owner->p_input, frame ) )
+    {   /* The decoder thread went idle, wake it up */
+        vlc_fifo_Lock( p_owner->p_fifo );
+        vlc_fifo_Signal( p_owner->p_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, frame );
     if (status != NULL)
-        GetStatusLocked(p_owner, status);
+    {
+        if (atomic_exchange_explicit(&p_owner->status_changed, false,
+                                     memory_order_acquire))
+        {
+            vlc_fifo_Lock( p_owner->p_fifo );
+            GetStatusLocked(p_owner, status);
+            vlc_fifo_Unlock( p_owner->p_fifo );
+        }
+        else
+        {
+            status->format.changed = false;
+            status->subdec_desc.fmt_array = NULL;
+            status->subdec_desc.fmt_count = 0;
+        }
+    }
 
     struct vlc_tracer *tracer = vlc_object_get_tracer(&p_owner->dec.obj);
     if (tracer != NULL)
     {
-        size_t fifo_size = vlc_fifo_GetBytes(p_owner->p_fifo);
-        size_t fifo_count = vlc_fifo_GetCount(p_owner->p_fifo);
+        size_t fifo_size = vlc_spsc_fifo_GetBytes(p_owner->p_input);
+        size_t fifo_count = vlc_spsc_fifo_GetCount(p_owner->p_input);
         vlc_tracer_Trace(tracer,
                          VLC_TRACE("id", p_owner->psz_id),
                          VLC_TRACE("fifo_size", (uint64_t)fifo_size),
                          VLC_TRACE("fifo_count", (uint64_t)fifo_count),
                          VLC_TRACE_END);
     }
-
-
-    vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
 void vlc_input_decoder_Decode(vlc_input_decoder_t *p_owner, vlc_frame_t *frame,
@@ -2471,7 +2541,8 @@ bool vlc_input_decoder_IsEmpty( vlc_input_decoder_t * p_owner )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
+    if( !vlc_fifo_IsEmpty( p_owner->p_fifo )
+     || vlc_spsc_fifo_GetCount( p_owner->p_input ) > 0 || p_owner->b_draining )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
         return false;
@@ -2516,6 +2587,7 @@ void vlc_input_decoder_Flush( vlc_input_decoder_t *p_owner )
 
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    p_owner->input_discard = vlc_spsc_fifo_GetMark( p_owner->p_input );
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2683,7 +2755,8 @@ void vlc_input_decoder_Wait( vlc_input_decoder_t *p_owner )
          * owner */
         if( p_owner->paused )
             break;
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo )
+         && vlc_spsc_fifo_GetCount( p_owner->p_input ) == 0 )
         {
             msg_Err( &p_owner->dec, "buffer deadlock prevented" );
             break;
@@ -2713,7 +2786,8 @@ void vlc_input_decoder_FrameNext( vlc_input_decoder_t *p_owner )
 
 size_t vlc_input_decoder_GetFifoSize( vlc_input_decoder_t *p_owner )
 {
-    return block_FifoSize( p_owner->p_fifo );
+    return block_FifoSize( p_owner->p_fifo )
+         + vlc_spsc_fifo_GetBytes( p_owner->p_input );
 }
 
 static bool DecoderHasVbi( decoder_t *dec )
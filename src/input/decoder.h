@@ -42,7 +42,8 @@ struct vlc_input_decoder_callbacks {
 
     void (*on_new_video_stats)(vlc_input_decoder_t *decoder, unsigned decoded,
                                unsigned lost, unsigned displayed, unsigned late,
-                               void *userdata);
+                               unsigned spu_cache_hits,
+                               unsigned spu_cache_misses, void *userdata);
     void (*on_new_audio_stats)(vlc_input_decoder_t *decoder, unsigned decoded,
                                unsigned lost, unsigned played, void *userdata);
 
@@ -531,6 +531,9 @@ int demux_vaControl( demux_t *demux, int query, va_list args )
                 return demux->ops->demux.test_and_clear_flags(demux, flags);
             }
             return VLC_EGENERIC;
+        case DEMUX_GET_PROGRAM_STATS:
+        case DEMUX_GET_ADAPTIVE_STATS:
+            return VLC_EGENERIC;
         default:
             vlc_assert_unreachable();
     }
@@ -659,6 +662,8 @@ int demux_vaControlHelper( stream_t *s,
         case DEMUX_NAV_MENU:
         case DEMUX_FILTER_ENABLE:
         case DEMUX_FILTER_DISABLE:
+        case DEMUX_GET_PROGRAM_STATS:
+        case DEMUX_GET_ADAPTIVE_STATS:
             return VLC_EGENERIC;
 
         case DEMUX_SET_TITLE:
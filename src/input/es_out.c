@@ -218,6 +218,7 @@ typedef struct
     vlc_tick_t  i_pts_jitter;
     int         i_cr_average;
     float       rate;
+    float       rate_correction; /* requested by the demuxer */
 
     /* */
     bool        b_paused;
@@ -435,7 +436,9 @@ decoder_on_thumbnail_ready(vlc_input_decoder_t *decoder, picture_t *pic, void *u
 
 static void
 decoder_on_new_video_stats(vlc_input_decoder_t *decoder, unsigned decoded, unsigned lost,
-                           unsigned displayed, unsigned late, void *userdata)
+                           unsigned displayed, unsigned late,
+                           unsigned spu_cache_hits, unsigned spu_cache_misses,
+                           void *userdata)
 {
     (void) decoder;
 
@@ -458,6 +461,10 @@ decoder_on_new_video_stats(vlc_input_decoder_t *decoder, unsigned decoded, unsig
                               memory_order_relaxed);
     atomic_fetch_add_explicit(&stats->late_pictures, late,
                               memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->spu_cache_hits, spu_cache_hits,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->spu_cache_misses, spu_cache_misses,
+                              memory_order_relaxed);
 }
 
 static void
@@ -930,6 +937,11 @@ static void EsOutChangePause(es_out_sys_t *p_sys, bool b_paused, vlc_tick_t i_da
     p_sys->i_pause_date = i_date;
 }
 
+static float EsOutGetRate(const es_out_sys_t *p_sys)
+{
+    return p_sys->rate * p_sys->rate_correction;
+}
+
 static void EsOutChangeRate(es_out_sys_t *p_sys, float rate)
 {
     es_out_id_t *es;
@@ -939,7 +951,7 @@ static void EsOutChangeRate(es_out_sys_t *p_sys, float rate)
 
     foreach_es_then_es_slaves(es)
         if( es->p_dec != NULL )
-            vlc_input_decoder_ChangeRate( es->p_dec, rate );
+            vlc_input_decoder_ChangeRate( es->p_dec, EsOutGetRate(p_sys) );
 }
 
 static void EsOutChangePosition(es_out_sys_t *p_sys, bool b_flush,
@@ -1206,7 +1218,7 @@ static void EsOutProgramsChangeRate(es_out_sys_t *p_sys)
     es_out_pgrm_t *pgrm;
 
     vlc_list_foreach(pgrm, &p_sys->programs, node)
-        input_clock_ChangeRate(pgrm->p_input_clock, p_sys->rate);
+        input_clock_ChangeRate(pgrm->p_input_clock, EsOutGetRate(p_sys));
 }
 
 static void EsOutFrameNext(es_out_sys_t *p_sys)
@@ -1269,7 +1281,7 @@ static vlc_tick_t EsOutGetBuffering(es_out_sys_t *p_sys)
 
         }
 
-        const vlc_tick_t i_consumed = i_system_duration * p_sys->rate - i_stream_duration;
+        const vlc_tick_t i_consumed = i_system_duration * EsOutGetRate(p_sys) - i_stream_duration;
         i_delay = p_sys->i_pts_delay + p_sys->i_pts_jitter
                 + p_sys->i_tracks_pts_delay - i_consumed;
     }
@@ -1566,7 +1578,7 @@ static es_out_pgrm_t *EsOutProgramAdd(es_out_sys_t *p_sys, input_source_t *sourc
         return NULL;
     }
 
-    p_pgrm->p_input_clock = input_clock_New(vlc_object_logger(p_input), p_sys->rate);
+    p_pgrm->p_input_clock = input_clock_New(vlc_object_logger(p_input), EsOutGetRate(p_sys));
     if( !p_pgrm->p_input_clock )
     {
         vlc_clock_main_Delete(p_pgrm->clocks.main);
@@ -2379,7 +2391,7 @@ static void EsOutCreateDecoder(es_out_sys_t *p_sys, es_out_id_t *p_es)
     }
     if( dec != NULL )
     {
-        vlc_input_decoder_ChangeRate( dec, p_sys->rate );
+        vlc_input_decoder_ChangeRate( dec, EsOutGetRate(p_sys) );
 
         if( unlikely( p_sys->b_paused ) ) /* Could happen during next-frame */
             vlc_input_decoder_ChangePause( dec, true, p_sys->i_pause_date );
@@ -3659,6 +3671,25 @@ static int EsOutVaControlLocked(es_out_sys_t *p_sys, input_source_t *source,
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_SET_RATE_CORRECTION:
+    {
+        const float correction = va_arg( args, double );
+        input_thread_private_t *priv = input_priv(p_sys->p_input);
+
+        if( !(correction > 0.f) )
+            return VLC_EGENERIC;
+        /* Without pace control, the stream output is not played in real time */
+        if( priv->p_sout != NULL && !priv->b_out_pace_control )
+            return VLC_EGENERIC;
+
+        if( correction != p_sys->rate_correction )
+        {
+            p_sys->rate_correction = correction;
+            EsOutChangeRate(p_sys, p_sys->rate);
+        }
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_VOUT_SET_MOUSE_EVENT:
     {
         es_out_id_t *p_es = va_arg( args, es_out_id_t * );
@@ -4039,6 +4070,9 @@ static int EsOutVaPrivControlLocked(es_out_sys_t *p_sys, input_source_t *source,
         }
         return ret;
     }
+    case ES_OUT_PRIV_SET_TIMESHIFT_TIME:
+        /* Only the timeshift buffer can be sought */
+        return VLC_EGENERIC;
     default: vlc_assert_unreachable();
     }
 
@@ -4140,6 +4174,7 @@ input_EsOutNew(input_thread_t *p_input, input_source_t *main_source, float rate,
     p_sys->i_pause_date = -1;
 
     p_sys->rate = rate;
+    p_sys->rate_correction = 1.f;
 
     p_sys->b_buffering = true;
     p_sys->b_draining = false;
@@ -30,16 +30,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
-#include <errno.h>
 #if defined (_WIN32)
 #  include <direct.h>
 #endif
-#include <sys/stat.h>
-#include <unistd.h>
 
 #include <vlc_common.h>
 #include <vlc_arrays.h>
-#include <vlc_fs.h>
 #include <vlc_mouse.h>
 #include <vlc_es_out.h>
 #include <vlc_block.h>
@@ -48,6 +44,7 @@
 #  include <vlc_charset.h> // FromWide
 #endif
 #include "es_out.h"
+#include "timeshift_ring.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -95,7 +92,7 @@ typedef struct attribute_packed
     es_out_id_t *p_es;
     union{
         block_t *p_block;
-        int     i_offset;  /* We do not use file > INT_MAX */
+        uint64_t i_pos;   /* Position in the ring file, once stored */
     };
 } ts_cmd_send_t;
 
@@ -191,20 +188,12 @@ static_assert(offsetof(ts_cmd_t, header) == offsetof(ts_cmd_send_t, header), "in
 static_assert(offsetof(ts_cmd_t, header) == offsetof(ts_cmd_control_t, header), "invalid packing");
 static_assert(offsetof(ts_cmd_t, header) == offsetof(ts_cmd_privcontrol_t, header), "invalid packing");
 
+/* Commands are kept in memory, the data of the blocks go to the ring file */
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
     ts_storage_t *p_next;
 
-    /* */
-#ifdef _WIN32
-    char    *psz_file;  /* Filename */
-#endif
-    size_t  i_file_max; /* Max size in bytes */
-    int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
-
     /* */
     uint8_t *p_cmd_r;
     uint8_t *p_cmd_w;
@@ -219,12 +208,13 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_tsout;
     struct vlc_input_es_out *p_out;
-    int64_t        i_tmp_size_max;
-    const char     *psz_tmp_path;
+    timeshift_ring_t *p_ring;
+    vlc_tick_t     i_stats_date;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
+    vlc_cond_t     interrupt; /* Wakes the thread up before a deadline */
     vlc_sem_t      done;
 
     /* */
@@ -246,11 +236,21 @@ typedef struct
 
     vlc_tick_t     i_cmd_delay;
 
+    /* Seeking */
+    vlc_tick_t     i_seek_date;  /* Requested by the input thread */
+    vlc_tick_t     i_skip_date;  /* Data before it are dropped */
+    vlc_tick_t     i_last_date;  /* Date of the last command executed */
+    uint64_t       i_replay_pos; /* Blocks of the ring file to play again */
+    uint64_t       i_replay_end;
+    bool           b_cmd_held;   /* Popped, but put back by a seek */
+    ts_cmd_t       cmd_held;
+
 } ts_thread_t;
 
 struct es_out_id_t
 {
     es_out_id_t *p_es;
+    uint64_t    i_tag; /* Identifies the ES in the ring file */
 };
 
 struct es_out_timeshift
@@ -259,7 +259,8 @@ struct es_out_timeshift
     struct vlc_input_es_out *p_out;
 
     /* Configuration */
-    int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    uint64_t       i_ring_size;       /* Size of the ring file in bytes */
+    bool           b_ring_direct;     /* Bypass the page cache */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -278,6 +279,11 @@ struct es_out_timeshift
     /* */
     int            i_es;
     es_out_id_t    **pp_es;
+    uint64_t       i_last_tag;
+
+    /* Last times of the master source, to find the data of a given time */
+    vlc_tick_t     i_times_time;
+    vlc_tick_t     i_times_date;
 
     struct vlc_input_es_out out;
 };
@@ -289,21 +295,23 @@ static void         TsAutoStop( es_out_t * );
 
 static void         TsStop( ts_thread_t * );
 static void         TsPushCmd( ts_thread_t *, ts_cmd_t * );
+static void         TsWriteCmd( ts_thread_t *, const ts_cmd_t * );
 static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush );
 static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, vlc_tick_t i_date );
 static int          TsChangeRate( ts_thread_t *, float src_rate, float rate );
+static int          TsSeek( ts_thread_t *, vlc_tick_t i_date );
 
 static void         *TsRun( void * );
 
-static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static ts_storage_t *TsStorageNew( void );
 static void         TsStorageDelete( ts_storage_t * );
-static void         TsStoragePack( ts_storage_t *p_storage );
-static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
+static bool         TsStorageIsFull( ts_storage_t * );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static uint64_t     TsStorageGetPos( ts_storage_t *p_storage, timeshift_ring_t * );
 
 static void CmdClean( ts_cmd_t * );
 
@@ -326,34 +334,6 @@ static void CmdExecuteDel    (struct es_out_timeshift *, ts_cmd_del_t *);
 static int  CmdExecuteControl(struct es_out_timeshift *, ts_cmd_control_t *);
 static int  CmdExecutePrivControl(struct es_out_timeshift *, ts_cmd_privcontrol_t *);
 
-/* File helpers */
-static int GetTmpFile( char **filename, const char *dirname )
-{
-    if( dirname != NULL
-     && asprintf( filename, "%s"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX",
-                  dirname ) >= 0 )
-    {
-        vlc_mkdir( dirname, 0700 );
-
-        int fd = vlc_mkstemp( *filename );
-        if( fd != -1 )
-            return fd;
-
-        free( *filename );
-    }
-
-    *filename = strdup( DIR_SEP"tmp"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX" );
-    if( unlikely(*filename == NULL) )
-        return -1;
-
-    int fd = vlc_mkstemp( *filename );
-    if( fd != -1 )
-        return fd;
-
-    free( *filename );
-    return -1;
-}
-
 /*****************************************************************************
  * Internal functions
  *****************************************************************************/
@@ -401,6 +381,7 @@ static es_out_id_t *Add( es_out_t *p_out, input_source_t *in, const es_format_t
         free( p_es );
         return NULL;
     }
+    p_es->i_tag = ++p_sys->i_last_tag;
 
     if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, (ts_cmd_t *) &cmd );
@@ -722,6 +703,12 @@ static int ControlLocked( es_out_t *p_out, input_source_t *in, int i_query,
     case ES_OUT_POST_SUBNODE:
         return es_out_in_vaControl( p_sys->p_out, in, i_query, args );
 
+    case ES_OUT_SET_RATE_CORRECTION:
+        /* Meaningless while playing back from the timeshift buffer */
+        if( p_sys->b_delayed )
+            return VLC_EGENERIC;
+        return es_out_in_vaControl( p_sys->p_out, in, i_query, args );
+
     default:
         vlc_assert_unreachable();
         return VLC_EGENERIC;
@@ -762,6 +749,12 @@ static int PrivControlLocked(struct vlc_input_es_out *p_tsout,
         ts_cmd_t cmd;
         if( CmdInitPrivControl( &cmd.privcontrol, in, i_query, args, p_sys->b_delayed ) )
             return VLC_EGENERIC;
+        if( i_query == ES_OUT_PRIV_SET_TIMES && in == NULL
+         && cmd.privcontrol.u.times.i_time != VLC_TICK_INVALID )
+        {
+            p_sys->i_times_time = cmd.privcontrol.u.times.i_time;
+            p_sys->i_times_date = cmd.header.i_date;
+        }
         if( p_sys->b_delayed )
         {
             TsPushCmd( p_sys->p_ts, &cmd );
@@ -800,6 +793,16 @@ static int PrivControlLocked(struct vlc_input_es_out *p_tsout,
     }
     case ES_OUT_PRIV_GET_GROUP_FORCED:
         return es_out_in_vaPrivControl( p_sys->p_out, in, i_query, args );
+    case ES_OUT_PRIV_SET_TIMESHIFT_TIME:
+    {
+        const vlc_tick_t i_time = va_arg( args, vlc_tick_t );
+
+        if( !p_sys->b_delayed || p_sys->i_times_date == VLC_TICK_INVALID )
+            return VLC_EGENERIC;
+        /* The data of the master source arrive in real time */
+        return TsSeek( p_sys->p_ts,
+                       p_sys->i_times_date + i_time - p_sys->i_times_time );
+    }
     /* Invalid queries for this es_out level */
     case ES_OUT_PRIV_SET_ES:
     case ES_OUT_PRIV_UNSET_ES:
@@ -875,15 +878,14 @@ input_EsOutTimeshiftNew(input_thread_t *p_input,
     p_sys->p_ts = NULL;
 
     TAB_INIT( p_sys->i_es, p_sys->pp_es );
+    p_sys->i_last_tag = 0;
+    p_sys->i_times_time = VLC_TICK_INVALID;
+    p_sys->i_times_date = VLC_TICK_INVALID;
 
     /* */
-    const int i_tmp_size_max = var_CreateGetInteger( p_input, "input-timeshift-granularity" );
-    if( i_tmp_size_max < 0 )
-        p_sys->i_tmp_size_max = 50*1024*1024;
-    else
-        p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1*1024*1024 );
-    msg_Dbg( p_input, "using timeshift granularity of %d MiB",
-             (int)p_sys->i_tmp_size_max/(1024*1024) );
+    const int64_t i_ring_size = var_InheritInteger( p_input, "input-timeshift-size" );
+    p_sys->i_ring_size = (uint64_t)__MAX( i_ring_size, 16 ) << 20;
+    p_sys->b_ring_direct = var_InheritBool( p_input, "input-timeshift-direct" );
 
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32)
@@ -948,8 +950,31 @@ input_EsOutTimeshiftNew(input_thread_t *p_input,
  *****************************************************************************/
 static void TsDestroy( ts_thread_t *p_ts )
 {
+    timeshift_ring_Delete( p_ts->p_ring );
     free( p_ts );
 }
+static void TsUpdateStats( ts_thread_t *p_ts, bool b_stopped )
+{
+    struct input_stats *stats = input_priv(p_ts->p_input)->stats;
+    struct timeshift_ring_stats ring;
+
+    if( stats == NULL )
+        return;
+
+    if( b_stopped )
+        memset( &ring, 0, sizeof(ring) );
+    else
+        timeshift_ring_GetStats( p_ts->p_ring, &ring );
+
+    atomic_store_explicit( &stats->timeshift_size, ring.size,
+                           memory_order_relaxed );
+    atomic_store_explicit( &stats->timeshift_fill, ring.fill,
+                           memory_order_relaxed );
+    atomic_store_explicit( &stats->timeshift_write_latency, ring.write_latency,
+                           memory_order_relaxed );
+    atomic_store_explicit( &stats->timeshift_index, ring.index,
+                           memory_order_relaxed );
+}
 static int TsStart(struct es_out_timeshift *p_sys)
 {
     ts_thread_t *p_ts;
@@ -962,14 +987,21 @@ static int TsStart(struct es_out_timeshift *p_sys)
     if( !p_ts )
         return VLC_EGENERIC;
 
-    p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
-    p_ts->psz_tmp_path = p_sys->psz_tmp_path;
+    p_ts->p_ring = timeshift_ring_New( p_sys->p_input, p_sys->psz_tmp_path,
+                                       p_sys->i_ring_size, p_sys->b_ring_direct );
+    if( !p_ts->p_ring )
+    {
+        free( p_ts );
+        return VLC_EGENERIC;
+    }
+    p_ts->i_stats_date = VLC_TICK_INVALID;
     p_ts->p_input = p_sys->p_input;
     p_ts->ts = p_sys;
     p_ts->p_out = p_sys->p_out;
     p_ts->p_tsout = p_out;
     vlc_mutex_init( &p_ts->lock );
     vlc_cond_init( &p_ts->wait );
+    vlc_cond_init( &p_ts->interrupt );
     vlc_sem_init( &p_ts->done, 0 );
     p_ts->b_paused = p_sys->b_input_paused && !p_sys->b_input_paused_source;
     p_ts->i_pause_date = p_ts->b_paused ? vlc_tick_now() : -1;
@@ -979,6 +1011,12 @@ static int TsStart(struct es_out_timeshift *p_sys)
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->i_seek_date = VLC_TICK_INVALID;
+    p_ts->i_skip_date = VLC_TICK_INVALID;
+    p_ts->i_last_date = VLC_TICK_INVALID;
+    p_ts->i_replay_pos = 0;
+    p_ts->i_replay_end = 0;
+    p_ts->b_cmd_held = false;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
 
@@ -1012,6 +1050,7 @@ static void TsStop( ts_thread_t *p_ts )
     vlc_mutex_lock( &p_ts->lock );
     vlc_sem_post( &p_ts->done );
     vlc_cond_signal( &p_ts->wait );
+    vlc_cond_signal( &p_ts->interrupt );
     vlc_mutex_unlock( &p_ts->lock );
     vlc_join( p_ts->thread, NULL );
 
@@ -1030,19 +1069,66 @@ static void TsStop( ts_thread_t *p_ts )
         TsStorageDelete( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
+    TsUpdateStats( p_ts, true );
     TsDestroy( p_ts );
 }
+/* Commands stored in the ring file along with the blocks, to be executed
+ * again when playing the file back after a seek */
+static bool TsIsReplayable( const ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->header.i_type )
+    {
+    case C_CONTROL:
+        return p_cmd->control.in == NULL
+            && ( p_cmd->control.i_query == ES_OUT_SET_PCR
+              || p_cmd->control.i_query == ES_OUT_SET_GROUP_PCR );
+    case C_PRIVCONTROL:
+        return p_cmd->privcontrol.in == NULL
+            && p_cmd->privcontrol.i_query == ES_OUT_PRIV_SET_TIMES;
+    default:
+        return false;
+    }
+}
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
+    /* Only the input thread writes to the ring, which never waits for the
+     * disk. This is done with the lock, so that the thread finds the
+     * blocks of the ring file either played or queued. */
     vlc_mutex_lock( &p_ts->lock );
 
-    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
+    if( p_cmd->header.i_type == C_SEND )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        block_t *p_block = p_cmd->send.p_block;
+        uint64_t i_pos;
+        int i_ret = timeshift_ring_Write( p_ts->p_ring, p_block,
+                                          p_cmd->header.i_date,
+                                          p_cmd->send.p_es->i_tag, &i_pos );
+
+        block_Release( p_block );
+        if( i_ret )
+        {
+            vlc_mutex_unlock( &p_ts->lock );
+            return;
+        }
+        p_cmd->send.i_pos = i_pos;
+
+        if( p_cmd->header.i_date - p_ts->i_stats_date >= VLC_TICK_FROM_SEC(1) )
+        {
+            TsUpdateStats( p_ts, false );
+            p_ts->i_stats_date = p_cmd->header.i_date;
+        }
+    }
+    else if( TsIsReplayable( p_cmd ) )
+        TsWriteCmd( p_ts, p_cmd );
+
+    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w ) )
+    {
+        ts_storage_t *p_storage = TsStorageNew();
 
         if( !p_storage )
         {
-            CmdClean( p_cmd );
+            if( p_cmd->header.i_type != C_SEND )
+                CmdClean( p_cmd );
             vlc_mutex_unlock( &p_ts->lock );
             /* TODO warn the user (but only once) */
             return;
@@ -1054,14 +1140,12 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
         }
         else
         {
-            TsStoragePack( p_ts->p_storage_w );
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
         }
     }
 
-    /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_ts->p_storage_w, p_cmd );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -1071,6 +1155,15 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 {
     vlc_mutex_assert( &p_ts->lock );
 
+    if( p_ts->b_cmd_held )
+    {
+        *p_cmd = p_ts->cmd_held;
+        p_ts->b_cmd_held = false;
+        if( b_flush && p_cmd->header.i_type == C_SEND )
+            p_cmd->send.p_block = NULL;
+        return VLC_SUCCESS;
+    }
+
     if( TsStorageIsEmpty( p_ts->p_storage_r ) )
         return VLC_EGENERIC;
 
@@ -1088,12 +1181,17 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 
     return VLC_SUCCESS;
 }
+static bool TsIsReplayingLocked( ts_thread_t *p_ts )
+{
+    return p_ts->i_replay_pos < p_ts->i_replay_end;
+}
 static bool TsHasCmd( ts_thread_t *p_ts )
 {
     bool b_cmd;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_cmd = !TsStorageIsEmpty( p_ts->p_storage_r );
+    b_cmd = TsIsReplayingLocked( p_ts ) || p_ts->b_cmd_held ||
+            !TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_cmd;
@@ -1105,6 +1203,8 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     vlc_mutex_lock( &p_ts->lock );
     b_unused = !p_ts->b_paused &&
                p_ts->rate == p_ts->rate_source &&
+               p_ts->i_seek_date == VLC_TICK_INVALID &&
+               !TsIsReplayingLocked( p_ts ) && !p_ts->b_cmd_held &&
                TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
@@ -1160,6 +1260,137 @@ static int TsChangeRate( ts_thread_t *p_ts, float src_rate, float rate )
     return i_ret;
 }
 
+static int TsSeek( ts_thread_t *p_ts, vlc_tick_t i_date )
+{
+    /* Not ahead of the live stream */
+    const vlc_tick_t i_now = vlc_tick_now();
+    if( i_date > i_now )
+        i_date = i_now;
+
+    vlc_mutex_lock( &p_ts->lock );
+    p_ts->i_seek_date = i_date;
+    vlc_cond_signal( &p_ts->wait );
+    vlc_cond_signal( &p_ts->interrupt );
+    vlc_mutex_unlock( &p_ts->lock );
+    return VLC_SUCCESS;
+}
+
+/* Moves the playback to a date, either ahead within the queued commands, or
+ * back within the ring file, whose blocks are then played again up to the
+ * first one still queued */
+static void TsSeekLocked( ts_thread_t *p_ts )
+{
+    const vlc_tick_t i_date = p_ts->i_seek_date;
+    uint64_t i_pos;
+
+    p_ts->i_seek_date = VLC_TICK_INVALID;
+
+    const bool b_back = p_ts->i_last_date != VLC_TICK_INVALID
+                     && i_date < p_ts->i_last_date;
+
+    if( ( b_back || TsIsReplayingLocked( p_ts ) )
+     && timeshift_ring_Find( p_ts->p_ring, i_date, &i_pos ) )
+    {
+        if( !TsIsReplayingLocked( p_ts ) )
+        {
+            p_ts->i_replay_end = p_ts->b_cmd_held && p_ts->cmd_held.header.i_type == C_SEND
+                               ? p_ts->cmd_held.send.i_pos
+                               : TsStorageGetPos( p_ts->p_storage_r, p_ts->p_ring );
+        }
+        p_ts->i_replay_pos = i_pos;
+    }
+
+    /* Commands up to the date are executed without waiting, and their data
+     * are dropped, see TsRun */
+    p_ts->i_skip_date = i_date;
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+    p_ts->i_buffering_delay = 0;
+
+    es_out_Control( &p_ts->p_out->out, ES_OUT_RESET_PCR );
+}
+
+static es_out_id_t *TsFindEs( struct es_out_timeshift *p_sys, uint64_t i_tag )
+{
+    for( int i = 0; i < p_sys->i_es; i++ )
+        if( p_sys->pp_es[i]->i_tag == i_tag )
+            return p_sys->pp_es[i];
+    return NULL;
+}
+
+/* Reads the next block to play again from the ring file, as a command */
+static int TsReplayCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd,
+                              uint64_t *pi_next )
+{
+    struct timeshift_ring_entry entry;
+    const uint64_t i_pos = p_ts->i_replay_pos;
+
+    /* Without the lock, as this may wait for the disk */
+    vlc_mutex_unlock( &p_ts->lock );
+    block_t *p_block = timeshift_ring_Read( p_ts->p_ring, i_pos, &entry );
+    vlc_mutex_lock( &p_ts->lock );
+
+    if( p_block == NULL )
+    {
+        /* Overwritten by newer data: go on with the queued commands */
+        p_ts->i_replay_pos = p_ts->i_replay_end;
+        return VLC_EGENERIC;
+    }
+    *pi_next = entry.next;
+
+    if( entry.tag == 0 )
+    {
+        /* A command written by TsWriteCmd */
+        assert( p_block->i_buffer <= sizeof(*p_cmd) );
+        memcpy( p_cmd, p_block->p_buffer, p_block->i_buffer );
+        block_Release( p_block );
+        return VLC_SUCCESS;
+    }
+
+    es_out_id_t *p_es = TsFindEs( p_ts->ts, entry.tag );
+    if( p_es == NULL )
+    {
+        /* The ES was deleted since */
+        block_Release( p_block );
+        p_ts->i_replay_pos = entry.next;
+        return VLC_EGENERIC;
+    }
+    p_cmd->header.i_type = C_SEND;
+    p_cmd->header.i_date = entry.date;
+    p_cmd->send.p_es = p_es;
+    p_cmd->send.p_block = p_block;
+    return VLC_SUCCESS;
+}
+
+static void TsExecuteCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->header.i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd(p_ts->ts, &p_cmd->add);
+        CmdCleanAdd( &p_cmd->add );
+        break;
+    case C_SEND:
+        CmdExecuteSend(p_ts->ts, &p_cmd->send );
+        CmdCleanSend( &p_cmd->send );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl(p_ts->ts, &p_cmd->control);
+        CmdCleanControl( &p_cmd->control );
+        break;
+    case C_PRIVCONTROL:
+        CmdExecutePrivControl(p_ts->ts, &p_cmd->privcontrol);
+        CmdCleanPrivControl( &p_cmd->privcontrol );
+        break;
+    case C_DEL:
+        CmdExecuteDel(p_ts->ts, &p_cmd->del);
+        break;
+    default:
+        vlc_assert_unreachable();
+        break;
+    }
+}
+
 static void *TsRun( void *p_data )
 {
     vlc_thread_set_name("vlc-timeshift");
@@ -1172,17 +1403,72 @@ static void *TsRun( void *p_data )
     {
         ts_cmd_t cmd;
         vlc_tick_t  i_deadline;
+        bool b_replay = false;
+        uint64_t i_replay_next = 0;
+        uint64_t i_pos = 0;
+
+        if( p_ts->i_seek_date != VLC_TICK_INVALID )
+        {
+            TsSeekLocked( p_ts );
+            i_buffering_date = -1;
+            continue;
+        }
 
         /* Pop a command to execute */
         bool b_buffering = es_out_GetBuffering( p_ts->p_out );
 
-        if( ( p_ts->b_paused && !b_buffering )
-         || TsPopCmdLocked( p_ts, &cmd, false ) )
+        if( p_ts->b_paused && !b_buffering )
         {
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
             continue;
         }
 
+        if( TsIsReplayingLocked( p_ts ) )
+        {
+            /* Play the ring file again, before the queued commands */
+            if( TsReplayCmdLocked( p_ts, &cmd, &i_replay_next ) )
+                continue;
+            b_replay = true;
+        }
+        else if( TsPopCmdLocked( p_ts, &cmd, false ) )
+        {
+            vlc_cond_wait( &p_ts->wait, &p_ts->lock );
+            continue;
+        }
+        else if( cmd.header.i_type == C_SEND )
+        {
+            i_pos = cmd.send.i_pos;
+            cmd.send.p_block = NULL;
+        }
+
+        if( p_ts->i_skip_date != VLC_TICK_INVALID )
+        {
+            if( cmd.header.i_date < p_ts->i_skip_date )
+            {
+                /* Sought past it: drop the data, but keep the other
+                 * changes */
+                if( b_replay )
+                    p_ts->i_replay_pos = i_replay_next;
+                if( b_replay || cmd.header.i_type == C_SEND
+                 || TsIsReplayable( &cmd ) )
+                {
+                    CmdClean( &cmd );
+                    continue;
+                }
+                vlc_mutex_unlock( &p_ts->lock );
+                TsExecuteCmd( p_ts, &cmd );
+                vlc_mutex_lock( &p_ts->lock );
+                p_ts->i_last_date = cmd.header.i_date;
+                continue;
+            }
+
+            /* Play from there on now */
+            p_ts->i_skip_date = VLC_TICK_INVALID;
+            p_ts->i_cmd_delay = vlc_tick_now() - cmd.header.i_date;
+            if( p_ts->b_paused )
+                p_ts->i_pause_date = vlc_tick_now();
+        }
+
         if( b_buffering && i_buffering_date < 0 )
         {
             i_buffering_date = cmd.header.i_date;
@@ -1230,41 +1516,68 @@ static void *TsRun( void *p_data )
 
         vlc_mutex_unlock( &p_ts->lock );
 
+        /* Read the block back ahead of its deadline, without the lock as
+         * this may wait for the disk */
+        if( !b_replay && cmd.header.i_type == C_SEND )
+        {
+            cmd.send.p_block = timeshift_ring_Read( p_ts->p_ring, i_pos, NULL );
+
+            /* The data was overwritten by newer ones: skip the gap rather
+             * than waiting for it */
+            const vlc_tick_t i_now = vlc_tick_now();
+            if( cmd.send.p_block == NULL && i_deadline > i_now )
+            {
+                vlc_mutex_lock( &p_ts->lock );
+                p_ts->i_cmd_delay -= i_deadline - i_now;
+                vlc_mutex_unlock( &p_ts->lock );
+                i_deadline = i_now;
+            }
+        }
+
         /* Regulate the speed of command processing to the same one than
-         * reading  */
-        if( vlc_sem_timedwait( &p_ts->done, i_deadline ) == 0 )
+         * reading, unless stopped or sought meanwhile */
+        vlc_mutex_lock( &p_ts->lock );
+        for( ;; )
         {
-            CmdClean( &cmd );
-            return NULL;
+            if( vlc_sem_trywait( &p_ts->done ) == 0 )
+            {
+                vlc_mutex_unlock( &p_ts->lock );
+                CmdClean( &cmd );
+                return NULL;
+            }
+            if( p_ts->i_seek_date != VLC_TICK_INVALID
+             || vlc_cond_timedwait( &p_ts->interrupt, &p_ts->lock, i_deadline ) )
+                break;
         }
 
-        /* Execute the command  */
-        switch( cmd.header.i_type )
+        if( p_ts->i_seek_date != VLC_TICK_INVALID )
         {
-        case C_ADD:
-            CmdExecuteAdd(p_ts->ts, &cmd.add);
-            CmdCleanAdd( &cmd.add );
-            break;
-        case C_SEND:
-            CmdExecuteSend(p_ts->ts, &cmd.send );
-            CmdCleanSend( &cmd.send );
-            break;
-        case C_CONTROL:
-            CmdExecuteControl(p_ts->ts, &cmd.control);
-            CmdCleanControl( &cmd.control );
-            break;
-        case C_PRIVCONTROL:
-            CmdExecutePrivControl(p_ts->ts, &cmd.privcontrol);
-            CmdCleanPrivControl( &cmd.privcontrol );
-            break;
-        case C_DEL:
-            CmdExecuteDel(p_ts->ts, &cmd.del);
-            break;
-        default:
-            vlc_assert_unreachable();
-            break;
+            /* Not played yet: the blocks of the ring file are read again,
+             * the queued commands are put back */
+            if( b_replay )
+                CmdClean( &cmd );
+            else
+            {
+                if( cmd.header.i_type == C_SEND )
+                {
+                    if( cmd.send.p_block != NULL )
+                        block_Release( cmd.send.p_block );
+                    cmd.send.i_pos = i_pos;
+                }
+                p_ts->cmd_held = cmd;
+                p_ts->b_cmd_held = true;
+            }
+            continue;
         }
+        vlc_mutex_unlock( &p_ts->lock );
+
+        /* Execute the command  */
+        TsExecuteCmd( p_ts, &cmd );
+
         vlc_mutex_lock( &p_ts->lock );
+        if( b_replay )
+            p_ts->i_replay_pos = i_replay_next;
+        p_ts->i_last_date = cmd.header.i_date;
     }
     vlc_mutex_unlock( &p_ts->lock );
     return NULL;
@@ -1285,65 +1598,26 @@ static const size_t TsStorageSizeofCommand[] =
     [C_PRIVCONTROL] = sizeof(ts_cmd_privcontrol_t)
 };
 
-static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
+static ts_storage_t *TsStorageNew( void )
 {
     ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
     if( unlikely(p_storage == NULL) )
         return NULL;
 
-    char *psz_file;
-    int fd = GetTmpFile( &psz_file, psz_tmp_path );
-    if( fd == -1 )
-    {
-        free( p_storage );
-        return NULL;
-    }
-
-    p_storage->p_filew = fdopen( fd, "w+b" );
-    if( p_storage->p_filew == NULL )
-    {
-        vlc_close( fd );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
-    p_storage->p_filer = vlc_fopen( psz_file, "rb" );
-    if( p_storage->p_filer == NULL )
-    {
-        fclose( p_storage->p_filew );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
-#ifndef _WIN32
-    vlc_unlink( psz_file );
-    free( psz_file );
-#else
-    p_storage->psz_file = psz_file;
-#endif
     p_storage->p_next = NULL;
 
-    /* */
-    p_storage->i_file_max = i_tmp_size_max;
-    p_storage->i_file_size = 0;
-
     /* */
     p_storage->p_cmd_buf = vlc_alloc( TS_STORAGE_COMMAND_PREALLOC, MAX_COMMAND_SIZE );
     p_storage->i_cmd_buf = TS_STORAGE_COMMAND_PREALLOC * MAX_COMMAND_SIZE;
     p_storage->p_cmd_w = p_storage->p_cmd_buf;
     p_storage->p_cmd_r = p_storage->p_cmd_buf;
-    //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
 
     if( !p_storage->p_cmd_buf )
     {
-        TsStorageDelete( p_storage );
+        free( p_storage );
         return NULL;
     }
     return p_storage;
-error:
-    free( psz_file );
-    free( p_storage );
-    return NULL;
 }
 
 static void TsStorageDelete( ts_storage_t *p_storage )
@@ -1357,42 +1631,11 @@ static void TsStorageDelete( ts_storage_t *p_storage )
         CmdClean( &cmd );
     }
     free( p_storage->p_cmd_buf );
-
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
-#ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
-    free( p_storage->psz_file );
-#endif
     free( p_storage );
 }
 
-static void TsStoragePack( ts_storage_t *p_storage )
-{
-    /* Try to release a bit of memory */
-    if( (size_t)(p_storage->p_cmd_w - p_storage->p_cmd_buf) == p_storage->i_cmd_buf )
-        return;
-
-    size_t i_realloc = p_storage->p_cmd_w - p_storage->p_cmd_buf;
-    uint8_t *p_realloc = realloc( p_storage->p_cmd_buf, i_realloc );
-    if( p_realloc )
-    {
-        p_storage->p_cmd_r = p_realloc + (p_storage->p_cmd_r - p_storage->p_cmd_buf);
-        p_storage->p_cmd_w = p_realloc + i_realloc;
-        p_storage->i_cmd_buf = i_realloc;
-        p_storage->p_cmd_buf = p_realloc;
-    }
-}
-
-static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
+static bool TsStorageIsFull( ts_storage_t *p_storage )
 {
-    if( p_cmd && p_cmd->header.i_type == C_SEND && p_storage->p_cmd_w )
-    {
-        size_t i_size = sizeof(*p_cmd->send.p_block) + p_cmd->send.p_block->i_buffer;
-
-        if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
-            return true;
-    }
     return (size_t)(p_storage->p_cmd_w - p_storage->p_cmd_buf) > p_storage->i_cmd_buf - MAX_COMMAND_SIZE;
 }
 
@@ -1401,41 +1644,12 @@ static bool TsStorageIsEmpty( ts_storage_t *p_storage )
     return !p_storage || p_storage->p_cmd_r >= p_storage->p_cmd_w;
 }
 
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
-    assert( !TsStorageIsFull( p_storage, p_cmd ) );
-    ts_cmd_t cmd;
-    memcpy(&cmd, p_cmd, TsStorageSizeofCommand[p_cmd->header.i_type]);
-
-    if( cmd.header.i_type == C_SEND )
-    {
-        block_t *p_block = cmd.send.p_block;
+    assert( !TsStorageIsFull( p_storage ) );
 
-        cmd.send.p_block = NULL;
-        cmd.send.i_offset = ftell( p_storage->p_filew );
-
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
-        {
-            block_Release( p_block );
-            return;
-        }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
-        {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
-        }
-        p_storage->i_file_size += p_block->i_buffer;
-        block_Release( p_block );
-
-        if( b_flush )
-            fflush( p_storage->p_filew );
-    }
-    size_t i_cmdsize = TsStorageSizeofCommand[ cmd.header.i_type ];
-    memcpy( p_storage->p_cmd_w, &cmd, i_cmdsize );
+    size_t i_cmdsize = TsStorageSizeofCommand[ p_cmd->header.i_type ];
+    memcpy( p_storage->p_cmd_w, p_cmd, i_cmdsize );
     p_storage->p_cmd_w += i_cmdsize;
 }
 
@@ -1448,32 +1662,43 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     memcpy(p_cmd, p_storage->p_cmd_r, i_cmdsize);
     p_storage->p_cmd_r += i_cmdsize;
 
-    if( p_cmd->header.i_type == C_SEND )
-    {
-        block_t block;
+    /* The block is only read back from the ring when executing the command */
+    if( b_flush && p_cmd->header.i_type == C_SEND )
+        p_cmd->send.p_block = NULL;
+}
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+/* Position in the ring file of the first block queued, if any */
+static uint64_t TsStorageGetPos( ts_storage_t *p_storage, timeshift_ring_t *p_ring )
+{
+    for( ; p_storage != NULL; p_storage = p_storage->p_next )
+    {
+        for( const uint8_t *p_cmd = p_storage->p_cmd_r; p_cmd < p_storage->p_cmd_w;
+             p_cmd += TsStorageSizeofCommand[p_cmd[0]] )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
+            if( p_cmd[0] == C_SEND )
             {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
+                ts_cmd_send_t cmd;
+                memcpy( &cmd, p_cmd, sizeof(cmd) );
+                return cmd.i_pos;
             }
-            p_cmd->send.p_block = p_block;
-        }
-        else
-        {
-            //perror( "TsStoragePopCmd" );
-            p_cmd->send.p_block = block_Alloc( 1 );
         }
     }
+    return timeshift_ring_Tell( p_ring );
+}
+
+static void TsWriteCmd( ts_thread_t *p_ts, const ts_cmd_t *p_cmd )
+{
+    const size_t i_size = TsStorageSizeofCommand[p_cmd->header.i_type];
+    block_t *p_block = block_Alloc( i_size );
+    uint64_t i_pos;
+
+    if( unlikely(p_block == NULL) )
+        return;
+    memcpy( p_block->p_buffer, p_cmd, i_size );
+    /* Tag 0: not the data of an ES */
+    timeshift_ring_Write( p_ts->p_ring, p_block, p_cmd->header.i_date, 0,
+                          &i_pos );
+    block_Release( p_block );
 }
 
 /*****************************************************************************
@@ -626,6 +626,45 @@ static void MainLoopStatistics( input_thread_t *p_input )
         struct input_stats_t new_stats;
         input_stats_Compute(priv->stats, &new_stats);
 
+        struct sout_stream_stats sout_stats = { 0 };
+        if (priv->p_sout != NULL)
+            sout_StreamControl(priv->p_sout, SOUT_STREAM_GET_STATS,
+                               &sout_stats);
+        new_stats.i_sent_packets = sout_stats.sent_packets;
+        new_stats.i_sent_bytes = sout_stats.sent_bytes;
+        new_stats.i_send_calls = sout_stats.send_calls;
+        new_stats.i_paced_packets = sout_stats.paced_packets;
+        new_stats.i_pacing_slip_max = sout_stats.slip_max;
+
+        struct vlc_stream_prefetch_stats prefetch = { 0 };
+        if (priv->master->p_stream != NULL
+         && vlc_stream_Control(priv->master->p_stream,
+                               STREAM_GET_PREFETCH_STATS, &prefetch))
+            memset(&prefetch, 0, sizeof (prefetch));
+        new_stats.i_prefetch_size = prefetch.buffer_size;
+        new_stats.i_prefetch_hits = prefetch.hits;
+        new_stats.i_prefetch_stalls = prefetch.stalls;
+        new_stats.i_prefetch_seeks = prefetch.seeks;
+
+        struct vlc_demux_program_stats programs = { 0 };
+        if (demux_Control(priv->master->p_demux, DEMUX_GET_PROGRAM_STATS, -1,
+                          &programs))
+            memset(&programs, 0, sizeof (programs));
+        new_stats.i_demux_program_packets = programs.packets;
+        new_stats.i_demux_program_bytes = programs.bytes;
+        new_stats.i_demux_program_latency = programs.latency;
+        new_stats.i_demux_program_latency_max = programs.latency_max;
+
+        struct vlc_demux_adaptive_stats adaptive = { 0 };
+        if (demux_Control(priv->master->p_demux, DEMUX_GET_ADAPTIVE_STATS,
+                          &adaptive))
+            memset(&adaptive, 0, sizeof (adaptive));
+        new_stats.i_adaptive_latency = adaptive.live_latency;
+        new_stats.f_adaptive_rate = adaptive.catchup_rate;
+        new_stats.i_adaptive_http2_connections = adaptive.http2_connections;
+        new_stats.i_adaptive_http2_failures = adaptive.http2_failures;
+        new_stats.i_adaptive_http2_requests = adaptive.http2_requests;
+
         vlc_mutex_lock(&priv->p_item->lock);
         *priv->p_item->p_stats = new_stats;
         vlc_mutex_unlock(&priv->p_item->lock);
@@ -1996,6 +2035,19 @@ static bool Control( input_thread_t *p_input,
                 break;
             }
 
+            /* Streams that cannot be sought may still be within the
+             * timeshift buffer */
+            bool b_can_seek;
+            if( demux_Control( priv->master->p_demux, DEMUX_CAN_SEEK, &b_can_seek ) )
+                b_can_seek = false;
+            if( !b_can_seek
+             && es_out_SetTimeshiftTime( priv->p_es_out,
+                        priv->i_start + param.time.i_val ) == VLC_SUCCESS )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_Control(&priv->p_es_out->out, ES_OUT_RESET_PCR);
 
@@ -2590,7 +2642,10 @@ static demux_t *InputDemuxNew( input_thread_t *p_input, es_out_t *p_es_out,
     demux_t *demux = demux_NewAdvanced( obj, p_input, psz_demux, url, p_stream,
                                         p_es_out, preparsing );
     if( demux != NULL )
+    {
+        p_source->p_stream = p_stream;
         return demux;
+    }
 
 error:
     vlc_stream_Delete( p_stream );
@@ -731,6 +731,12 @@ struct input_stats {
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t late_pictures;
     atomic_uintmax_t lost_pictures;
+    atomic_uintmax_t spu_cache_hits;
+    atomic_uintmax_t spu_cache_misses;
+    atomic_uintmax_t timeshift_size;
+    atomic_uintmax_t timeshift_fill;
+    atomic_uintmax_t timeshift_write_latency;
+    atomic_uintmax_t timeshift_index;
 };
 
 struct input_stats *input_stats_Create(void);
@@ -36,6 +36,7 @@ struct input_source_t
     vlc_atomic_rc_t rc;
 
     demux_t  *p_demux; /**< Demux object (most downstream) */
+    stream_t *p_stream; /**< Stream read by the demux (owned by the demux) */
     struct vlc_input_es_out *p_slave_es_out; /**< Slave es out */
 
     char *str_id;
@@ -68,6 +68,12 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->late_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    atomic_init(&stats->spu_cache_hits, 0);
+    atomic_init(&stats->spu_cache_misses, 0);
+    atomic_init(&stats->timeshift_size, 0);
+    atomic_init(&stats->timeshift_fill, 0);
+    atomic_init(&stats->timeshift_write_latency, 0);
+    atomic_init(&stats->timeshift_index, 0);
     return stats;
 }
 
@@ -111,6 +117,20 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                     memory_order_relaxed);
     st->i_lost_pictures = atomic_load_explicit(&stats->lost_pictures,
                                                memory_order_relaxed);
+    st->i_spu_cache_hits = atomic_load_explicit(&stats->spu_cache_hits,
+                                                memory_order_relaxed);
+    st->i_spu_cache_misses = atomic_load_explicit(&stats->spu_cache_misses,
+                                                  memory_order_relaxed);
+
+    /* Timeshift */
+    st->i_timeshift_size = atomic_load_explicit(&stats->timeshift_size,
+                                                memory_order_relaxed);
+    st->i_timeshift_fill = atomic_load_explicit(&stats->timeshift_fill,
+                                                memory_order_relaxed);
+    st->i_timeshift_write_latency = atomic_load_explicit(
+                    &stats->timeshift_write_latency, memory_order_relaxed);
+    st->i_timeshift_index = atomic_load_explicit(&stats->timeshift_index,
+                                                 memory_order_relaxed);
 }
 
 /** Update a counter element with new values
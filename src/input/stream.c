@@ -52,6 +52,8 @@ typedef struct stream_priv_t
     block_t *peek;
     uint64_t offset;
     bool eof;
+    bool peek_block_probed;
+    bool peek_block; /**< blocks can be peeked in place */
 
     /* UTF-16 and UTF-32 file reading */
     struct {
@@ -99,6 +101,8 @@ stream_t *vlc_stream_CustomNew(vlc_object_t *parent,
     priv->peek = NULL;
     priv->offset = 0;
     priv->eof = false;
+    priv->peek_block_probed = false;
+    priv->peek_block = false;
 
     /* UTF16 and UTF32 text file conversion */
     priv->text.conv = (vlc_iconv_t)(-1);
@@ -529,6 +533,24 @@ ssize_t vlc_stream_Read(stream_t *s, void *buf, size_t len)
     return copied;
 }
 
+/**
+ * Whether the blocks of a stream can be peeked in place (see
+ * ::STREAM_CAN_PEEK_BLOCK). The source is only asked once.
+ */
+static bool StreamCanPeekBlock(stream_t *s)
+{
+    stream_priv_t *priv = stream_priv(s);
+
+    if (!priv->peek_block_probed)
+    {
+        priv->peek_block_probed = true;
+        if (s->ops != NULL || s->pf_block == NULL
+         || vlc_stream_Control(s, STREAM_CAN_PEEK_BLOCK, &priv->peek_block))
+            priv->peek_block = false;
+    }
+    return priv->peek_block;
+}
+
 ssize_t vlc_stream_Peek(stream_t *s, const uint8_t **restrict bufp, size_t len)
 {
     stream_priv_t *priv = stream_priv(s);
@@ -542,6 +564,21 @@ ssize_t vlc_stream_Peek(stream_t *s, const uint8_t **restrict bufp, size_t len)
         priv->block = NULL;
     }
 
+    if (peek == NULL && len > 0 && StreamCanPeekBlock(s) && !vlc_killed())
+    {
+        /* Peek in place if the next block is large enough, which spares a
+         * copy with sources handing out views, e.g. memory-mapped files.
+         * Otherwise, leave it to the buffered path below. */
+        block_t *block;
+
+        priv->eof = false;
+        block = s->pf_block(s, &priv->eof);
+        if (block != NULL && block->i_buffer >= len)
+            peek = block;
+        else
+            priv->block = block;
+    }
+
     if (peek == NULL)
     {
         peek = block_Alloc(len);
@@ -0,0 +1,260 @@
+/*****************************************************************************
+ * timeshift_ring.c: test for the timeshift ring file
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#undef NDEBUG
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include "../src/input/timeshift_ring.h"
+
+const char vlc_module_name[] = "test_timeshift_ring";
+
+#define MiB (UINT64_C(1) << 20)
+
+/* Block sizes: TS packets, a video frame, and some spanning several pages */
+static const size_t sizes[] = {
+    188, 7 * 188, 65536, 0, 1, 3 * TIMESHIFT_RING_PAGE / 2, 1316, 200000,
+};
+
+static block_t *MakeBlock(unsigned i)
+{
+    size_t size = sizes[i % ARRAY_SIZE(sizes)];
+    block_t *block = block_Alloc(size);
+
+    assert(block != NULL);
+    for (size_t j = 0; j < size; j++)
+        block->p_buffer[j] = i + j * 7;
+    block->i_dts = VLC_TICK_0 + i;
+    block->i_pts = VLC_TICK_0 + 2 * i;
+    block->i_length = i;
+    block->i_flags = i & BLOCK_FLAG_TYPE_MASK;
+    block->i_nb_samples = i;
+    return block;
+}
+
+static void CheckBlock(block_t *block, unsigned i)
+{
+    size_t size = sizes[i % ARRAY_SIZE(sizes)];
+
+    assert(block != NULL);
+    assert(block->i_buffer == size);
+    for (size_t j = 0; j < size; j++)
+        assert(block->p_buffer[j] == (uint8_t)(i + j * 7));
+    assert(block->i_dts == VLC_TICK_0 + i);
+    assert(block->i_pts == VLC_TICK_0 + 2 * (vlc_tick_t)i);
+    assert(block->i_length == i);
+    assert(block->i_flags == (i & BLOCK_FLAG_TYPE_MASK));
+    assert(block->i_nb_samples == i);
+    block_Release(block);
+}
+
+/* Writes blocks, dated and tagged by their number, until some size */
+static unsigned Fill(timeshift_ring_t *ring, uint64_t *pos, unsigned count,
+                     uint64_t size)
+{
+    uint64_t total = 0;
+    unsigned i = 0;
+
+    while (i < count && total < size)
+    {
+        block_t *block = MakeBlock(i);
+
+        /* Let the I/O thread catch up if needed */
+        while (timeshift_ring_Write(ring, block, VLC_TICK_0 + i, i, &pos[i]))
+            vlc_tick_sleep(VLC_TICK_FROM_MS(10));
+        total += block->i_buffer;
+        block_Release(block);
+        i++;
+    }
+    return i;
+}
+
+static void test_readback(vlc_object_t *obj)
+{
+    timeshift_ring_t *ring = timeshift_ring_New(obj, NULL, 64 * MiB, false);
+    uint64_t pos[256];
+    struct timeshift_ring_stats stats;
+
+    assert(ring != NULL);
+    /* The file is not allocated up front */
+    timeshift_ring_GetStats(ring, &stats);
+    assert(stats.size == 0);
+    assert(stats.fill == 0);
+
+    unsigned count = Fill(ring, pos, ARRAY_SIZE(pos), 48 * MiB);
+
+    /* Wait for the pages to be written, so that they are read from disk */
+    do
+    {
+        vlc_tick_sleep(VLC_TICK_FROM_MS(10));
+        timeshift_ring_GetStats(ring, &stats);
+    }
+    while (stats.index < 48);
+    assert(stats.size >= 48 * MiB && stats.size < 64 * MiB);
+    assert(stats.fill >= 48 * MiB);
+
+    /* The index finds the block written at or before a date */
+    for (unsigned i = 0; i < count; i += 17)
+    {
+        uint64_t found;
+
+        assert(timeshift_ring_Find(ring, VLC_TICK_0 + i, &found));
+        assert(found <= pos[i]);
+        assert(pos[i] - found < 2 * TIMESHIFT_RING_PAGE + sizes[5]);
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct timeshift_ring_entry entry;
+
+        CheckBlock(timeshift_ring_Read(ring, pos[i], &entry), i);
+        assert(entry.date == VLC_TICK_0 + i);
+        assert(entry.tag == i);
+        assert(entry.next == (i + 1 < count ? pos[i + 1]
+                                            : timeshift_ring_Tell(ring)));
+    }
+
+    /* Blocks can be read again, from a date on */
+    uint64_t next;
+    unsigned i = count / 2;
+
+    assert(timeshift_ring_Find(ring, VLC_TICK_0 + i, &next));
+    while (next < timeshift_ring_Tell(ring))
+    {
+        struct timeshift_ring_entry entry;
+        block_t *block = timeshift_ring_Read(ring, next, &entry);
+
+        assert(entry.tag <= i);
+        if (entry.tag == i)
+        {
+            CheckBlock(block, i);
+            i++;
+        }
+        else
+            block_Release(block);
+        next = entry.next;
+    }
+    assert(i == count);
+
+    timeshift_ring_GetStats(ring, &stats);
+    assert(stats.fill == 0);
+    timeshift_ring_Delete(ring);
+}
+
+static void test_overwrite(vlc_object_t *obj)
+{
+    timeshift_ring_t *ring = timeshift_ring_New(obj, NULL, 8 * MiB, false);
+    uint64_t pos[1024];
+    struct timeshift_ring_stats stats;
+
+    assert(ring != NULL);
+
+    /* Write three times the size of the ring without reading */
+    unsigned count = Fill(ring, pos, ARRAY_SIZE(pos), 24 * MiB);
+
+    /* Wait for the I/O thread to overwrite the oldest pages */
+    block_t *block;
+    while ((block = timeshift_ring_Read(ring, pos[0], NULL)) != NULL)
+    {
+        CheckBlock(block, 0);
+        vlc_tick_sleep(VLC_TICK_FROM_MS(10));
+    }
+
+    /* The oldest blocks are gone, the newest are still there */
+    assert(timeshift_ring_Read(ring, pos[1], NULL) == NULL);
+    for (unsigned i = count - 4; i < count; i++)
+        CheckBlock(timeshift_ring_Read(ring, pos[i], NULL), i);
+
+    /* The index does not point to overwritten blocks */
+    uint64_t found;
+    assert(timeshift_ring_Find(ring, VLC_TICK_0, &found));
+    assert(found > pos[1]);
+
+    timeshift_ring_GetStats(ring, &stats);
+    assert(stats.size == 8 * MiB);
+    assert(stats.fill <= stats.size);
+    assert(stats.dropped >= 2);
+    assert(stats.index <= 8);
+    timeshift_ring_Delete(ring);
+}
+
+/* The writer must not wait for the disk: measure how long appending takes
+ * while the I/O thread writes out */
+static void bench_write(vlc_object_t *obj, bool direct)
+{
+    timeshift_ring_t *ring = timeshift_ring_New(obj, NULL, 256 * MiB, direct);
+    struct timeshift_ring_stats stats;
+    block_t *block = block_Alloc(7 * 188);
+    vlc_tick_t worst = 0;
+    unsigned dropped = 0, count = (128 * MiB) / (7 * 188);
+    uint64_t pos;
+
+    assert(ring != NULL && block != NULL);
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < count; i++)
+    {
+        vlc_tick_t now = vlc_tick_now();
+
+        if (timeshift_ring_Write(ring, block, now, 0, &pos))
+            dropped++;
+
+        vlc_tick_t duration = vlc_tick_now() - now;
+        if (worst < duration)
+            worst = duration;
+    }
+    double secs = secf_from_vlc_tick(vlc_tick_now() - start);
+
+    timeshift_ring_GetStats(ring, &stats);
+    printf("%-8s %8.1f MiB/s, worst write %5"PRId64" us, "
+           "page write %5"PRId64" us (max %"PRId64" us), %u dropped\n",
+           direct ? "direct" : "buffered", count * 7 * 188 / secs / MiB,
+           US_FROM_VLC_TICK(worst), US_FROM_VLC_TICK(stats.write_latency),
+           US_FROM_VLC_TICK(stats.write_latency_max), dropped);
+
+    block_Release(block);
+    timeshift_ring_Delete(ring);
+}
+
+int main(void)
+{
+    vlc_object_t *obj = (vlc_object_create)(NULL, sizeof (*obj));
+
+    assert(obj != NULL);
+
+    test_readback(obj);
+    test_overwrite(obj);
+
+    bench_write(obj, false);
+    bench_write(obj, true);
+
+    vlc_object_delete(obj);
+    return 0;
+}
@@ -0,0 +1,835 @@
+/*****************************************************************************
+ * timeshift_ring.c: timeshift ring file
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_list.h>
+#include "timeshift_ring.h"
+
+#define PAGE TIMESHIFT_RING_PAGE
+/* Full pages waiting to be written before blocks get dropped */
+#define BACKLOG_MAX 32
+/* Spare page buffers kept for reuse */
+#define SPARE_MAX 4
+/* Alignment of the page buffers, for direct I/O */
+#define PAGE_ALIGN 4096
+
+#define NO_PAGE UINT64_MAX
+/* Smallest ring, should the disk get full while the file grows */
+#define PAGES_MIN 4
+
+static_assert(PAGE % PAGE_ALIGN == 0, "misaligned pages");
+
+/* Header stored in front of each block */
+struct record
+{
+    uint32_t   i_buffer;
+    uint32_t   i_flags;
+    uint32_t   i_nb_samples;
+    vlc_tick_t i_pts;
+    vlc_tick_t i_dts;
+    vlc_tick_t i_length;
+    vlc_tick_t i_date;
+    uint64_t   i_tag;
+};
+
+/* Index entry of a page: the first block starting in it, or the one
+ * spanning over it if none does */
+struct entry
+{
+    vlc_tick_t date;
+    uint64_t   pos;
+};
+
+struct page
+{
+    struct vlc_list node;
+    uint64_t     number; /* position in the ring / PAGE */
+    struct entry entry;
+    bool         spanned; /* no block starts in the page (yet) */
+    uint8_t     *p_buf;
+};
+
+struct timeshift_ring
+{
+    vlc_object_t *obj;
+    int           fd;
+#ifdef _WIN32
+    char         *psz_file;
+#endif
+    bool          direct;
+    uint64_t      pages; /* maximum size of the file in pages */
+    uint64_t      length; /* pages written to the file so far */
+
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;  /* wakes the I/O thread up */
+    vlc_cond_t    ready; /* wakes the reader up */
+    bool          closing;
+
+    /* Writer side */
+    struct page  *current; /* page being filled */
+    uint64_t      write_pos;
+    struct entry  last;    /* last block written */
+    struct vlc_list pending; /* full pages to write, oldest first */
+    unsigned      pending_count;
+    struct vlc_list spare;
+    unsigned      spare_count;
+
+    /* I/O thread side */
+    uint64_t      flushed;     /* pages written to the file */
+    uint64_t      overwritten; /* pages lost to newer ones */
+    uint64_t      indexed;     /* end of the pages with an index entry */
+    bool          failed;
+    struct entry *index;       /* index entry by slot of the file */
+
+    /* Reader side */
+    struct page   cache[2];    /* pages read back from the file */
+    uint64_t      request;     /* page waited for by the reader */
+    uint64_t      readahead;   /* page to read ahead */
+    uint64_t      read_pos;
+
+    /* Statistics */
+    uint64_t      index_count;
+    vlc_tick_t    latency_total;
+    vlc_tick_t    latency_max;
+    uint64_t      writes;
+    uint64_t      dropped;
+};
+
+/* File helpers */
+static int GetTmpFile( char **filename, const char *dirname )
+{
+    if( dirname != NULL
+     && asprintf( filename, "%s"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX",
+                  dirname ) >= 0 )
+    {
+        vlc_mkdir( dirname, 0700 );
+
+        int fd = vlc_mkstemp( *filename );
+        if( fd != -1 )
+            return fd;
+
+        free( *filename );
+    }
+
+    *filename = strdup( DIR_SEP"tmp"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX" );
+    if( unlikely(*filename == NULL) )
+        return -1;
+
+    int fd = vlc_mkstemp( *filename );
+    if( fd != -1 )
+        return fd;
+
+    free( *filename );
+    return -1;
+}
+
+static bool SetDirect(int fd, bool direct)
+{
+#ifdef O_DIRECT
+    int flags = fcntl(fd, F_GETFL);
+
+    if (flags == -1)
+        return false;
+    flags = direct ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+    return fcntl(fd, F_SETFL, flags) == 0;
+#else
+    VLC_UNUSED(fd);
+    return !direct;
+#endif
+}
+
+/* Only the I/O thread uses the file descriptor */
+static ssize_t PageIO(timeshift_ring_t *ring, uint8_t *buf, uint64_t number,
+                      bool out)
+{
+    off_t offset = (number % ring->pages) * PAGE;
+    size_t done = 0;
+
+    while (done < PAGE)
+    {
+        ssize_t val;
+#ifdef _WIN32
+        if (lseek(ring->fd, offset + done, SEEK_SET) == -1)
+            return -1;
+        val = out ? write(ring->fd, buf + done, PAGE - done)
+                  : read(ring->fd, buf + done, PAGE - done);
+#else
+        val = out ? pwrite(ring->fd, buf + done, PAGE - done, offset + done)
+                  : pread(ring->fd, buf + done, PAGE - done, offset + done);
+#endif
+        if (val < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            /* Not all file systems support direct I/O */
+            if (errno == EINVAL && ring->direct && done == 0)
+            {
+                msg_Warn(ring->obj, "direct I/O not supported, disabling");
+                ring->direct = false;
+                if (SetDirect(ring->fd, false))
+                    continue;
+            }
+            return -1;
+        }
+        if (val == 0)
+        {
+            errno = EIO;
+            return -1;
+        }
+        done += val;
+    }
+    return done;
+}
+
+static struct page *PageNew(timeshift_ring_t *ring)
+{
+    struct page *page;
+
+    if (ring->spare_count > 0)
+    {
+        page = vlc_list_first_entry_or_null(&ring->spare, struct page, node);
+        vlc_list_remove(&page->node);
+        ring->spare_count--;
+        return page;
+    }
+
+    page = malloc(sizeof (*page));
+    if (unlikely(page == NULL))
+        return NULL;
+    page->p_buf = aligned_alloc(PAGE_ALIGN, PAGE);
+    if (unlikely(page->p_buf == NULL))
+    {
+        free(page);
+        return NULL;
+    }
+    return page;
+}
+
+static void PageDelete(timeshift_ring_t *ring, struct page *page)
+{
+    if (ring->spare_count < SPARE_MAX)
+    {
+        vlc_list_append(&page->node, &ring->spare);
+        ring->spare_count++;
+        return;
+    }
+    aligned_free(page->p_buf);
+    free(page);
+}
+
+static void IndexSet(timeshift_ring_t *ring, uint64_t number,
+                     const struct entry *entry)
+{
+    struct entry *slot = &ring->index[number % ring->pages];
+
+    if (slot->date != VLC_TICK_INVALID)
+        ring->index_count--;
+    if (entry != NULL && entry->date != VLC_TICK_INVALID)
+    {
+        *slot = *entry;
+        ring->index_count++;
+    }
+    else
+        slot->date = VLC_TICK_INVALID;
+}
+
+/*****************************************************************************
+ * I/O thread
+ *****************************************************************************/
+
+/* Wraps the ring around at the current end of the file, if growing it failed
+ * for lack of space */
+static bool Shrink(timeshift_ring_t *ring, uint64_t number, int err)
+{
+    if ((err != ENOSPC && err != EFBIG) || number != ring->length
+     || number < PAGES_MIN)
+        return false;
+
+    msg_Warn(ring->obj, "timeshift file limited to %"PRIu64" MiB: %s",
+             number * PAGE >> 20, vlc_strerror_c(err));
+    ring->pages = number;
+    /* Drop what got written of the page anyway */
+    if (ftruncate(ring->fd, number * PAGE))
+        msg_Dbg(ring->obj, "cannot trim timeshift file: %s",
+                vlc_strerror_c(errno));
+    return true;
+}
+
+static void FlushPage(timeshift_ring_t *ring)
+{
+    struct page *page = vlc_list_first_entry_or_null(&ring->pending,
+                                                     struct page, node);
+    bool ok;
+    vlc_tick_t latency;
+
+    do
+    {
+        /* The slot now belongs to the new page, whatever the outcome */
+        if (page->number >= ring->pages)
+        {
+            uint64_t lost = page->number - ring->pages + 1;
+
+            if (ring->overwritten < lost)
+                ring->overwritten = lost;
+        }
+        IndexSet(ring, page->number, NULL);
+
+        if (ring->failed)
+        {
+            ok = false;
+            break;
+        }
+
+        /* The writer only appends, and the reader only copies: the page can
+         * be written without the lock. The file grows as needed. */
+        vlc_mutex_unlock(&ring->lock);
+
+        vlc_tick_t start = vlc_tick_now();
+        ok = PageIO(ring, page->p_buf, page->number, true) >= 0;
+        latency = vlc_tick_now() - start;
+        int err = errno;
+
+        vlc_mutex_lock(&ring->lock);
+        errno = err;
+    }
+    while (!ok && Shrink(ring, page->number, errno));
+
+    if (ok)
+    {
+        IndexSet(ring, page->number, &page->entry);
+        ring->indexed = page->number + 1;
+        if (ring->length < ring->pages)
+            ring->length = page->number + 1;
+        ring->latency_total += latency;
+        if (ring->latency_max < latency)
+            ring->latency_max = latency;
+        ring->writes++;
+    }
+    else
+    {
+        if (!ring->failed)
+            msg_Err(ring->obj, "cannot write timeshift file: %s",
+                    vlc_strerror_c(errno));
+        ring->failed = true;
+    }
+
+    ring->flushed = page->number + 1;
+    vlc_list_remove(&page->node);
+    ring->pending_count--;
+    PageDelete(ring, page);
+}
+
+static void LoadPage(timeshift_ring_t *ring, uint64_t number)
+{
+    struct page *page = &ring->cache[number % 2];
+
+    if (page->number == number)
+        return;
+
+    page->number = NO_PAGE;
+    vlc_mutex_unlock(&ring->lock);
+    bool ok = PageIO(ring, page->p_buf, number, false) >= 0;
+    vlc_mutex_lock(&ring->lock);
+
+    if (!ok)
+    {
+        if (!ring->failed)
+            msg_Err(ring->obj, "cannot read timeshift file: %s",
+                    vlc_strerror_c(errno));
+        ring->failed = true;
+    }
+    /* Drop the page if it got overwritten meanwhile */
+    else if (number >= ring->overwritten)
+        page->number = number;
+}
+
+static void *Thread(void *data)
+{
+    timeshift_ring_t *ring = data;
+
+    vlc_thread_set_name("vlc-tshift-io");
+
+    vlc_mutex_lock(&ring->lock);
+    for (;;)
+    {
+        /* Pending pages are dropped: nobody will read them anymore */
+        if (ring->closing)
+            break;
+
+        if (ring->request != NO_PAGE)
+        {
+            /* The reader is waiting */
+            uint64_t number = ring->request;
+
+            ring->request = NO_PAGE;
+            LoadPage(ring, number);
+            ring->readahead = number + 1;
+            vlc_cond_broadcast(&ring->ready);
+        }
+        else if (ring->pending_count > 0)
+            FlushPage(ring);
+        else if (ring->readahead != NO_PAGE)
+        {
+            uint64_t number = ring->readahead;
+
+            ring->readahead = NO_PAGE;
+            if (number >= ring->overwritten && number < ring->flushed
+             && !ring->failed)
+                LoadPage(ring, number);
+        }
+        else
+            vlc_cond_wait(&ring->wait, &ring->lock);
+    }
+    vlc_mutex_unlock(&ring->lock);
+    return NULL;
+}
+
+/*****************************************************************************
+ * Writer
+ *****************************************************************************/
+static void Append(timeshift_ring_t *ring, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    while (len > 0)
+    {
+        size_t offset = ring->write_pos % PAGE;
+        size_t copy = __MIN(len, PAGE - offset);
+
+        memcpy(ring->current->p_buf + offset, p, copy);
+        ring->write_pos += copy;
+        p += copy;
+        len -= copy;
+
+        if (ring->write_pos % PAGE == 0)
+        {
+            /* The caller made sure that enough pages are available */
+            struct page *page = PageNew(ring);
+
+            assert(page != NULL);
+            vlc_list_append(&ring->current->node, &ring->pending);
+            ring->pending_count++;
+            vlc_cond_signal(&ring->wait);
+
+            page->number = ring->write_pos / PAGE;
+            page->entry = ring->last;
+            page->spanned = true;
+            ring->current = page;
+        }
+    }
+}
+
+int timeshift_ring_Write(timeshift_ring_t *ring, const block_t *block,
+                         vlc_tick_t date, uint64_t tag, uint64_t *pos)
+{
+    struct record rec = {
+        .i_buffer = block->i_buffer,
+        .i_flags = block->i_flags,
+        .i_nb_samples = block->i_nb_samples,
+        .i_pts = block->i_pts,
+        .i_dts = block->i_dts,
+        .i_length = block->i_length,
+        .i_date = date,
+        .i_tag = tag,
+    };
+    uint64_t size = sizeof (rec) + block->i_buffer;
+
+    vlc_mutex_lock(&ring->lock);
+
+    /* Pages filled by the block */
+    uint64_t pages = (ring->write_pos % PAGE + size) / PAGE;
+
+    if (size > (ring->pages - 1) * PAGE
+     || ring->pending_count + pages > BACKLOG_MAX)
+        goto drop;
+
+    /* Get the buffers first, so that appending cannot fail */
+    while (ring->spare_count < pages)
+    {
+        struct page *page = malloc(sizeof (*page));
+        if (unlikely(page == NULL))
+            goto drop;
+        page->p_buf = aligned_alloc(PAGE_ALIGN, PAGE);
+        if (unlikely(page->p_buf == NULL))
+        {
+            free(page);
+            goto drop;
+        }
+        vlc_list_append(&page->node, &ring->spare);
+        ring->spare_count++;
+    }
+
+    *pos = ring->write_pos;
+    ring->last.date = date;
+    ring->last.pos = ring->write_pos;
+    if (ring->current->spanned)
+    {
+        ring->current->entry = ring->last;
+        ring->current->spanned = false;
+    }
+
+    Append(ring, &rec, sizeof (rec));
+    Append(ring, block->p_buffer, block->i_buffer);
+    vlc_mutex_unlock(&ring->lock);
+    return VLC_SUCCESS;
+
+drop:
+    if (ring->dropped++ == 0)
+        msg_Warn(ring->obj, "timeshift file too slow, dropping data");
+    vlc_mutex_unlock(&ring->lock);
+    return VLC_EGENERIC;
+}
+
+uint64_t timeshift_ring_Tell(timeshift_ring_t *ring)
+{
+    vlc_mutex_lock(&ring->lock);
+    uint64_t pos = ring->write_pos;
+    vlc_mutex_unlock(&ring->lock);
+    return pos;
+}
+
+/*****************************************************************************
+ * Reader
+ *****************************************************************************/
+static const uint8_t *GetPage(timeshift_ring_t *ring, uint64_t number)
+{
+    for (;;)
+    {
+        if (number < ring->overwritten)
+            return NULL;
+
+        /* Not written to the file yet */
+        if (number >= ring->flushed)
+        {
+            if (number == ring->current->number)
+                return ring->current->p_buf;
+
+            struct page *page;
+            vlc_list_foreach(page, &ring->pending, node)
+                if (page->number == number)
+                    return page->p_buf;
+            return NULL;
+        }
+
+        if (ring->cache[number % 2].number == number)
+            return ring->cache[number % 2].p_buf;
+        if (ring->failed)
+            return NULL;
+
+        ring->request = number;
+        vlc_cond_signal(&ring->wait);
+        while (ring->request == number)
+            vlc_cond_wait(&ring->ready, &ring->lock);
+        /* Check again, as the page may have been overwritten meanwhile */
+    }
+}
+
+static bool Copy(timeshift_ring_t *ring, uint64_t pos, void *data, size_t len)
+{
+    uint8_t *p = data;
+
+    while (len > 0)
+    {
+        const uint8_t *buf = GetPage(ring, pos / PAGE);
+        if (buf == NULL)
+            return false;
+
+        size_t offset = pos % PAGE;
+        size_t copy = __MIN(len, PAGE - offset);
+
+        memcpy(p, buf + offset, copy);
+        pos += copy;
+        p += copy;
+        len -= copy;
+    }
+    return true;
+}
+
+block_t *timeshift_ring_Read(timeshift_ring_t *ring, uint64_t pos,
+                             struct timeshift_ring_entry *entry)
+{
+    struct record rec;
+    block_t *block = NULL;
+
+    vlc_mutex_lock(&ring->lock);
+    assert(pos < ring->write_pos);
+
+    if (!Copy(ring, pos, &rec, sizeof (rec)))
+        goto lost;
+
+    block = block_Alloc(rec.i_buffer);
+    if (unlikely(block == NULL))
+        goto lost;
+
+    if (!Copy(ring, pos + sizeof (rec), block->p_buffer, rec.i_buffer))
+    {
+        block_Release(block);
+        block = NULL;
+        goto lost;
+    }
+
+    block->i_flags = rec.i_flags;
+    block->i_nb_samples = rec.i_nb_samples;
+    block->i_pts = rec.i_pts;
+    block->i_dts = rec.i_dts;
+    block->i_length = rec.i_length;
+    ring->read_pos = pos + sizeof (rec) + rec.i_buffer;
+    if (entry != NULL)
+    {
+        entry->date = rec.i_date;
+        entry->tag = rec.i_tag;
+        entry->next = ring->read_pos;
+    }
+    vlc_mutex_unlock(&ring->lock);
+    return block;
+
+lost:
+    ring->dropped++;
+    if (ring->read_pos < pos)
+        ring->read_pos = pos;
+    vlc_mutex_unlock(&ring->lock);
+    return NULL;
+}
+
+bool timeshift_ring_Find(timeshift_ring_t *ring, vlc_tick_t date,
+                         uint64_t *pos)
+{
+    const struct entry *found = NULL;
+
+    vlc_mutex_lock(&ring->lock);
+
+    /* Pages in the file, whose dates never decrease */
+    const uint64_t oldest = ring->overwritten * PAGE;
+    uint64_t lo = ring->overwritten, hi = ring->indexed;
+
+    if (lo < hi)
+    {
+        uint64_t end = hi;
+
+        while (hi - lo > 1)
+        {
+            uint64_t mid = lo + (hi - lo) / 2;
+
+            if (ring->index[mid % ring->pages].date <= date)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        /* Skip entries of blocks spanning from overwritten pages */
+        while (lo < end && ring->index[lo % ring->pages].pos < oldest)
+            lo++;
+        if (lo < end)
+            found = &ring->index[lo % ring->pages];
+    }
+
+    /* Pages still in memory */
+    if (found == NULL || found->date <= date)
+    {
+        const struct page *page;
+
+        vlc_list_foreach(page, &ring->pending, node)
+            if (page->entry.date != VLC_TICK_INVALID && page->entry.pos >= oldest
+             && (found == NULL || page->entry.date <= date))
+                found = &page->entry;
+        page = ring->current;
+        if (page->entry.date != VLC_TICK_INVALID && page->entry.pos >= oldest
+         && (found == NULL || page->entry.date <= date))
+            found = &page->entry;
+    }
+
+    if (found != NULL)
+        *pos = found->pos;
+    vlc_mutex_unlock(&ring->lock);
+    return found != NULL;
+}
+
+void timeshift_ring_GetStats(timeshift_ring_t *ring,
+                             struct timeshift_ring_stats *stats)
+{
+    vlc_mutex_lock(&ring->lock);
+    stats->size = ring->length * PAGE;
+
+    uint64_t oldest = ring->overwritten * PAGE;
+    uint64_t fill = ring->write_pos - __MAX(ring->read_pos, oldest);
+
+    stats->fill = __MIN(fill, ring->pages * PAGE);
+    stats->write_latency = ring->writes > 0
+                         ? ring->latency_total / (vlc_tick_t)ring->writes : 0;
+    stats->write_latency_max = ring->latency_max;
+    stats->index = ring->index_count;
+    stats->dropped = ring->dropped;
+    vlc_mutex_unlock(&ring->lock);
+}
+
+/*****************************************************************************
+ * Creation
+ *****************************************************************************/
+#undef timeshift_ring_New
+timeshift_ring_t *timeshift_ring_New(vlc_object_t *obj, const char *dir,
+                                     uint64_t size, bool direct)
+{
+    timeshift_ring_t *ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    ring->obj = obj;
+    ring->pages = __MAX((size + PAGE - 1) / PAGE, PAGES_MIN);
+    ring->length = 0;
+    /* Sized for the largest file: the slots do not move if it shrinks */
+    ring->index = vlc_alloc(ring->pages, sizeof (*ring->index));
+    if (unlikely(ring->index == NULL))
+        goto error;
+    for (uint64_t i = 0; i < ring->pages; i++)
+        ring->index[i].date = VLC_TICK_INVALID;
+
+    vlc_list_init(&ring->pending);
+    vlc_list_init(&ring->spare);
+    ring->pending_count = 0;
+    ring->spare_count = 0;
+
+    ring->current = PageNew(ring);
+    if (ring->current == NULL)
+        goto error;
+    ring->current->number = 0;
+    ring->current->spanned = true;
+    ring->write_pos = 0;
+    ring->last.date = VLC_TICK_INVALID;
+    ring->last.pos = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(ring->cache); i++)
+    {
+        ring->cache[i].number = NO_PAGE;
+        ring->cache[i].p_buf = aligned_alloc(PAGE_ALIGN, PAGE);
+        if (unlikely(ring->cache[i].p_buf == NULL))
+        {
+            while (i > 0)
+                aligned_free(ring->cache[--i].p_buf);
+            goto error_page;
+        }
+    }
+
+    char *psz_file;
+    ring->fd = GetTmpFile(&psz_file, dir);
+    if (ring->fd == -1)
+    {
+        msg_Err(obj, "cannot create timeshift file: %s",
+                vlc_strerror_c(errno));
+        goto error_cache;
+    }
+#ifndef _WIN32
+    vlc_unlink(psz_file);
+    free(psz_file);
+#else
+    ring->psz_file = psz_file;
+#endif
+
+    ring->direct = direct && SetDirect(ring->fd, true);
+    if (direct && !ring->direct)
+        msg_Warn(obj, "direct I/O not supported");
+
+    vlc_mutex_init(&ring->lock);
+    vlc_cond_init(&ring->wait);
+    vlc_cond_init(&ring->ready);
+    ring->closing = false;
+    ring->flushed = 0;
+    ring->overwritten = 0;
+    ring->indexed = 0;
+    ring->failed = false;
+    ring->request = NO_PAGE;
+    ring->readahead = NO_PAGE;
+    ring->read_pos = 0;
+    ring->index_count = 0;
+    ring->latency_total = 0;
+    ring->latency_max = 0;
+    ring->writes = 0;
+    ring->dropped = 0;
+
+    if (vlc_clone(&ring->thread, Thread, ring))
+        goto error_file;
+
+    msg_Dbg(obj, "using a timeshift file of up to %"PRIu64" MiB%s",
+            ring->pages * PAGE >> 20, ring->direct ? " (direct I/O)" : "");
+    return ring;
+
+error_file:
+    vlc_close(ring->fd);
+#ifdef _WIN32
+    vlc_unlink(ring->psz_file);
+    free(ring->psz_file);
+#endif
+error_cache:
+    for (size_t i = 0; i < ARRAY_SIZE(ring->cache); i++)
+        aligned_free(ring->cache[i].p_buf);
+error_page:
+    aligned_free(ring->current->p_buf);
+    free(ring->current);
+error:
+    free(ring->index);
+    free(ring);
+    return NULL;
+}
+
+void timeshift_ring_Delete(timeshift_ring_t *ring)
+{
+    struct page *page;
+
+    vlc_mutex_lock(&ring->lock);
+    ring->closing = true;
+    vlc_cond_signal(&ring->wait);
+    vlc_mutex_unlock(&ring->lock);
+    vlc_join(ring->thread, NULL);
+
+    vlc_list_foreach(page, &ring->pending, node)
+    {
+        aligned_free(page->p_buf);
+        free(page);
+    }
+    vlc_list_foreach(page, &ring->spare, node)
+    {
+        aligned_free(page->p_buf);
+        free(page);
+    }
+    aligned_free(ring->current->p_buf);
+    free(ring->current);
+    for (size_t i = 0; i < ARRAY_SIZE(ring->cache); i++)
+        aligned_free(ring->cache[i].p_buf);
+
+    vlc_close(ring->fd);
+#ifdef _WIN32
+    vlc_unlink(ring->psz_file);
+    free(ring->psz_file);
+#endif
+    free(ring->index);
+    free(ring);
+}
@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * timeshift_ring.h: timeshift ring file
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_INPUT_TIMESHIFT_RING_H
+#define LIBVLC_INPUT_TIMESHIFT_RING_H 1
+
+#include <vlc_block.h>
+
+/**
+ * Timeshift ring file
+ *
+ * Blocks are appended to a temporary file used as a ring buffer. The file
+ * grows as needed, up to a maximum size, or less if the disk gets full.
+ * The file is written and read back, one page at a time, by a dedicated I/O
+ * thread: neither the writer nor the reader ever touch the disk.
+ *
+ * Once the file is full, the oldest pages are overwritten, whether they were
+ * read or not. Each page of the file is indexed by the date of the first
+ * block starting in it, so that blocks can be read back again from a date.
+ *
+ * There must be only one writer and one reader thread.
+ */
+typedef struct timeshift_ring timeshift_ring_t;
+
+/** Size of the pages of the file, in bytes */
+#define TIMESHIFT_RING_PAGE (1 << 20)
+
+struct timeshift_ring_stats
+{
+    uint64_t   size;          /**< Current size of the file, in bytes */
+    uint64_t   fill;          /**< Bytes written but not read yet */
+    vlc_tick_t write_latency; /**< Average page write duration */
+    vlc_tick_t write_latency_max; /**< Longest page write duration */
+    uint64_t   index;         /**< Number of index entries */
+    uint64_t   dropped;       /**< Blocks lost to overwriting or I/O errors */
+};
+
+/** Attributes of a block read back */
+struct timeshift_ring_entry
+{
+    vlc_tick_t date; /**< Date given to timeshift_ring_Write() */
+    uint64_t   tag;  /**< Tag given to timeshift_ring_Write() */
+    uint64_t   next; /**< Position of the following block */
+};
+
+/**
+ * Creates a ring file.
+ *
+ * \param obj object to log with
+ * \param dir directory of the temporary file (NULL for the default)
+ * \param size maximum size of the file in bytes, rounded up to whole pages
+ * \param direct whether to bypass the page cache, if supported
+ */
+timeshift_ring_t *timeshift_ring_New(vlc_object_t *obj, const char *dir,
+                                     uint64_t size, bool direct);
+#define timeshift_ring_New(o, d, s, direct) \
+    timeshift_ring_New(VLC_OBJECT(o), d, s, direct)
+
+void timeshift_ring_Delete(timeshift_ring_t *);
+
+/**
+ * Appends a copy of a block.
+ *
+ * This only copies the block in memory, and never waits for the disk. If the
+ * I/O thread lags too much behind, the block is dropped.
+ *
+ * \param date date of the block, for the index (must not decrease)
+ * \param tag value stored along with the block, for the caller
+ * \param pos where to store the position of the block in the ring
+ * \return VLC_SUCCESS or VLC_EGENERIC if the block was dropped
+ */
+int timeshift_ring_Write(timeshift_ring_t *, const block_t *, vlc_tick_t date,
+                         uint64_t tag, uint64_t *pos);
+
+/**
+ * Returns the position of the next block to be written.
+ */
+uint64_t timeshift_ring_Tell(timeshift_ring_t *);
+
+/**
+ * Reads a block back.
+ *
+ * This may wait for the I/O thread to read the data from the file.
+ * The pages following the block are read ahead.
+ *
+ * \param entry where to store the attributes of the block (can be NULL)
+ * \return the block, or NULL if it was overwritten or could not be read
+ */
+block_t *timeshift_ring_Read(timeshift_ring_t *, uint64_t pos,
+                             struct timeshift_ring_entry *entry);
+
+/**
+ * Looks the index up.
+ *
+ * \param date date to look for
+ * \param pos where to store the position of the last indexed block written
+ *            at or before the date (or the oldest one)
+ * \return true if found, false if the ring holds no indexed block
+ */
+bool timeshift_ring_Find(timeshift_ring_t *, vlc_tick_t date, uint64_t *pos);
+
+void timeshift_ring_GetStats(timeshift_ring_t *, struct timeshift_ring_stats *);
+
+#endif
@@ -379,13 +379,13 @@ static const char * const  ppsz_deinterlace_text[] = {
     "Deinterlace method to use for video processing.")
 static const char * const ppsz_deinterlace_mode[] = {
     "auto", "discard", "blend", "mean", "bob",
-    "linear", "x", "yadif", "yadif2x", "phosphor",
-    "ivtc"
+    "linear", "x", "yadif", "yadif2x", "bwdif", "bwdif2x",
+    "phosphor", "ivtc"
 };
 static const char * const ppsz_deinterlace_mode_text[] = {
     N_("Auto"), N_("Discard"), N_("Blend"), N_("Mean"), N_("Bob"),
-    N_("Linear"), "X", "Yadif", "Yadif (2x)", N_("Phosphor"),
-    N_("Film NTSC (IVTC)")
+    N_("Linear"), "X", "Yadif", "Yadif (2x)", "BWDIF", "BWDIF (2x)",
+    N_("Phosphor"), N_("Film NTSC (IVTC)")
 };
 
 #define DEINTERLACE_FILTER_TEXT N_("Deinterlace filter")
@@ -443,6 +443,12 @@ static const char *const screensaver_texts[] = {
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define CHROMA_THREADS_TEXT N_("Video conversion threads")
+#define CHROMA_THREADS_LONGTEXT N_( \
+    "Number of threads running the built-in software converters and " \
+    "deinterlacers on each picture, by horizontal slices (0 for one per " \
+    "CPU). The swscale scaler always runs on a single thread.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -783,10 +789,16 @@ static const char* const ppsz_restore_playback_desc[] = {
 #define INPUT_TIMESHIFT_PATH_LONGTEXT N_( \
     "Directory used to store the timeshift temporary files." )
 
-#define INPUT_TIMESHIFT_GRANULARITY_TEXT N_("Timeshift granularity")
-#define INPUT_TIMESHIFT_GRANULARITY_LONGTEXT N_( \
-    "This is the maximum size in bytes of the temporary files " \
-    "that will be used to store the timeshifted streams." )
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift size")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "Maximum size in MiB of the temporary file used to store the " \
+    "timeshifted streams. The file grows as needed. Once it is full, or " \
+    "if the disk gets full, the oldest data are overwritten." )
+
+#define INPUT_TIMESHIFT_DIRECT_TEXT N_("Timeshift direct I/O")
+#define INPUT_TIMESHIFT_DIRECT_LONGTEXT N_( \
+    "Bypass the operating system cache when writing and reading the " \
+    "timeshift file, if supported." )
 
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
@@ -937,6 +949,11 @@ static const char* const ppsz_restore_playback_desc[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the HTTP and HTTPS clients " \
+    "(0 for one per CPU)." )
+
 #define HTTPS_PORT_TEXT N_( "HTTPS server port" )
 #define HTTPS_PORT_LONGTEXT N_( \
     "The HTTPS server will listen on this TCP port. " \
@@ -1107,6 +1124,13 @@ static const char* const ppsz_restore_playback_desc[] = {
 #define STREAM_FILTER_LONGTEXT N_( \
     "Stream filters are used to modify the stream that is being read." )
 
+#define STREAM_CACHE_TEXT N_("Cache seekable network streams")
+#define STREAM_CACHE_LONGTEXT N_( \
+    "Keep the data read from slow seekable sources, such as HTTP or SMB, " \
+    "in a block cache, so that demuxers jumping between an index and the " \
+    "data do not fetch it again. The cache memory size is set by the " \
+    "cache stream filter options." )
+
 #define DEMUX_FILTER_TEXT N_("Demux filter module")
 #define DEMUX_FILTER_LONGTEXT N_( \
     "Demux filters are used to modify/control the stream that is being read." )
@@ -1787,6 +1811,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list("video-filter", "video filter", NULL,
                     VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT)
+    add_integer_with_range( "chroma-threads", 0, 0, 64,
+                            CHROMA_THREADS_TEXT, CHROMA_THREADS_LONGTEXT )
 
 #if 0
     add_string( "pixel-ratio", "1", PIXEL_RATIO_TEXT, PIXEL_RATIO_TEXT )
@@ -1945,6 +1971,8 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 0, HTTP_THREADS_TEXT, HTTP_THREADS_LONGTEXT )
+        change_integer_range( 0, 64 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT )
         change_integer_range( 1, 65535 )
@@ -2036,8 +2064,12 @@ vlc_module_begin ()
 
     add_directory("input-timeshift-path", NULL,
                   INPUT_TIMESHIFT_PATH_TEXT, INPUT_TIMESHIFT_PATH_LONGTEXT)
-    add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
-                 INPUT_TIMESHIFT_GRANULARITY_LONGTEXT )
+    add_obsolete_integer( "input-timeshift-granularity" ) /* since 4.0.0 */
+    add_integer( "input-timeshift-size", 2048, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT )
+        change_integer_range( 16, INT_MAX )
+    add_bool( "input-timeshift-direct", false, INPUT_TIMESHIFT_DIRECT_TEXT,
+              INPUT_TIMESHIFT_DIRECT_LONGTEXT )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT )
 
@@ -2065,6 +2097,7 @@ vlc_module_begin ()
 
     add_module_list("stream-filter", "stream_filter", NULL,
                     STREAM_FILTER_TEXT, STREAM_FILTER_LONGTEXT)
+    add_bool("stream-cache", false, STREAM_CACHE_TEXT, STREAM_CACHE_LONGTEXT)
 
 /* Stream output options */
     set_subcategory( SUBCAT_SOUT_GENERAL )
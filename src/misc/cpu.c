@@ -57,24 +57,32 @@ VLC_WEAK unsigned vlc_CPU_raw(void)
     uint32_t i_capabilities = 0;
 
 #if defined( __i386__ ) || defined( __x86_64__ )
-    unsigned int i_eax, i_ebx, i_ecx, i_edx;
+    unsigned int i_eax, i_ebx, i_ecx, i_edx, i_level;
 
     /* Needed for x86 CPU capabilities detection */
 #if defined(_MSC_VER) && !defined(__clang__)
 # define cpuid(reg)  \
     do { \
         int cpuInfo[4]; \
-        __cpuid(cpuInfo, reg); \
+        __cpuidex(cpuInfo, reg, 0); \
         i_eax = cpuInfo[0]; i_ebx = cpuInfo[1]; i_ecx = cpuInfo[2]; i_edx = cpuInfo[3]; \
     } while(0)
 #else // !_MSC_VER
 # define cpuid(reg) \
     asm ("cpuid" \
          : "=a" (i_eax), "=b" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-         : "a" (reg) \
+         : "a" (reg), "c" (0) \
          : "cc");
 #endif // !_MSC_VER
 
+    /* Extended registers states enabled by the OS */
+#if defined(_MSC_VER) && !defined(__clang__)
+# define xgetbv() (i_eax = (unsigned int)_xgetbv(0))
+#else
+# define xgetbv() \
+    asm ("xgetbv" : "=a" (i_eax), "=d" (i_edx) : "c" (0))
+#endif
+
      /* Check if the OS really supports the requested instructions */
 # if defined (__i386__) && !defined (__i586__) \
   && !defined (__i686__) && !defined (__pentium4__) \
@@ -97,13 +105,14 @@ VLC_WEAK unsigned vlc_CPU_raw(void)
     if( after == before )
         goto out;
 # endif
+#endif
 
     /* the CPU supports the CPUID instruction - get its level */
     cpuid( 0x00000000 );
 
     if( !i_eax )
         goto out;
-#endif
+    i_level = i_eax;
 
     cpuid( 0x00000001 );
 
@@ -116,6 +125,29 @@ VLC_WEAK unsigned vlc_CPU_raw(void)
     if (i_ecx & 0x00080000)
         i_capabilities |= VLC_CPU_SSE4_1;
 
+    /* AVX also needs the OS to save the YMM registers (OSXSAVE) */
+    if ((i_ecx & 0x18000000) == 0x18000000)
+    {
+        xgetbv();
+        const unsigned int xcr0 = i_eax;
+
+        if ((xcr0 & 0x06) == 0x06)
+        {
+            i_capabilities |= VLC_CPU_AVX;
+
+            if (i_level >= 7)
+            {
+                cpuid( 0x00000007 );
+                if (i_ebx & 0x00000020)
+                    i_capabilities |= VLC_CPU_AVX2;
+                /* AVX-512F, AVX-512BW, and the opmask and ZMM states */
+                if ((i_ebx & 0x40010000) == 0x40010000
+                 && (xcr0 & 0xe0) == 0xe0)
+                    i_capabilities |= VLC_CPU_AVX512;
+            }
+        }
+    }
+
     /* test for additional capabilities */
     cpuid( 0x80000000 );
 
@@ -176,6 +208,8 @@ void vlc_CPU_dump (vlc_object_t *obj)
         vlc_memstream_puts(&stream, "AVX ");
     if (vlc_CPU_AVX2())
         vlc_memstream_puts(&stream, "AVX2 ");
+    if (vlc_CPU_AVX512())
+        vlc_memstream_puts(&stream, "AVX-512 ");
 
 #elif defined (__powerpc__) || defined (__ppc__) || defined (__ppc64__)
     if (vlc_CPU_ALTIVEC())
@@ -24,28 +24,54 @@
 
 #include <vlc_executor.h>
 
+#include <assert.h>
+
 #include <vlc_atomic.h>
 #include <vlc_list.h>
 #include <vlc_threads.h>
 #include "../libvlc.h"
 
+#define PRIORITY_COUNT (VLC_EXECUTOR_PRIORITY_HIGH + 1)
+
+/**
+ * Queue of runnables, one FIFO per priority level.
+ *
+ * Each executor thread owns one queue. Runnables are pushed to the queue of
+ * the submitting executor thread if any, or distributed among the queues
+ * otherwise. Threads serve their own queue, and steal from the other queues
+ * when they run out of work, always taking the highest priority runnable
+ * available first.
+ */
+struct vlc_executor_queue {
+    vlc_mutex_t lock;
+
+    /** Lists of vlc_runnable, indexed by priority */
+    struct vlc_list lists[PRIORITY_COUNT];
+
+    /** Number of runnables in each list (readable without the lock) */
+    atomic_uint counts[PRIORITY_COUNT];
+};
+
 /**
  * An executor can spawn several threads.
  *
  * This structure contains the data specific to one thread.
  */
 struct vlc_executor_thread {
-    /** Node of vlc_executor.threads list */
-    struct vlc_list node;
-
     /** The executor owning the thread */
     vlc_executor_t *owner;
 
     /** The system thread */
     vlc_thread_t thread;
 
+    /** Index of the thread in vlc_executor.threads */
+    unsigned index;
+
     /** The current task executed by the thread, NULL if none */
     struct vlc_runnable *current_task;
+
+    /** Runnables submitted to this thread */
+    struct vlc_executor_queue queue;
 };
 
 /**
@@ -53,66 +79,170 @@ struct vlc_executor_thread {
  * header).
  */
 struct vlc_executor {
+    /** Protects thread creation, sleeping and closing */
     vlc_mutex_t lock;
 
     /** Maximum number of threads to run the tasks */
     unsigned max_threads;
 
-    /** List of active vlc_executor_thread */
-    struct vlc_list threads;
+    /** Array of max_threads vlc_executor_thread, nthreads of which are
+     * active */
+    struct vlc_executor_thread **threads;
 
-    /** Thread count (in a separate field to quickly compare to max_threads) */
-    unsigned nthreads;
+    /** Thread count (written with the lock held) */
+    atomic_uint nthreads;
+
+    /** Round-robin counter to distribute the runnables among the threads */
+    atomic_uint next;
+
+    /** Number of queued runnables (updated with a queue lock held) */
+    atomic_uint pending;
 
     /* Number of tasks requested but not finished. */
-    unsigned unfinished;
+    atomic_uint unfinished;
 
     /** Wait for the executor to be idle (i.e. unfinished == 0) */
     vlc_cond_t idle_wait;
 
-    /** Queue of vlc_runnable */
-    struct vlc_list queue;
+    /** Number of threads waiting for runnables */
+    unsigned sleeping;
 
-    /** Wait for the queue to be non-empty */
+    /** Wait for the queues to be non-empty */
     vlc_cond_t queue_wait;
 
     /** True if executor deletion is requested */
     bool closing;
 };
 
+/** The executor thread running on the calling thread, if any */
+static thread_local struct vlc_executor_thread *current_thread;
+
 static void
-QueuePush(vlc_executor_t *executor, struct vlc_runnable *runnable)
+QueueInit(struct vlc_executor_queue *queue)
 {
-    vlc_mutex_assert(&executor->lock);
+    vlc_mutex_init(&queue->lock);
+    for (int i = 0; i < PRIORITY_COUNT; ++i)
+    {
+        vlc_list_init(&queue->lists[i]);
+        atomic_init(&queue->counts[i], 0);
+    }
+}
 
-    vlc_list_append(&runnable->node, &executor->queue);
-    vlc_cond_signal(&executor->queue_wait);
+static void
+QueuePush(vlc_executor_t *executor, struct vlc_executor_queue *queue,
+          struct vlc_runnable *runnable, enum vlc_executor_priority priority)
+{
+    vlc_mutex_lock(&queue->lock);
+    runnable->queue = queue;
+    runnable->priority = priority;
+    vlc_list_append(&runnable->node, &queue->lists[priority]);
+    atomic_fetch_add_explicit(&queue->counts[priority], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add(&executor->pending, 1);
+    vlc_mutex_unlock(&queue->lock);
 }
 
 static struct vlc_runnable *
-QueueTake(vlc_executor_t *executor)
+QueuePop(vlc_executor_t *executor, struct vlc_executor_queue *queue,
+         int priority)
 {
-    vlc_mutex_assert(&executor->lock);
-
-    while (!executor->closing && vlc_list_is_empty(&executor->queue))
-        vlc_cond_wait(&executor->queue_wait, &executor->lock);
-
-    if (executor->closing)
+    /* Skip empty queues without locking */
+    if (atomic_load_explicit(&queue->counts[priority],
+                             memory_order_relaxed) == 0)
         return NULL;
 
+    vlc_mutex_lock(&queue->lock);
+
     struct vlc_runnable *runnable =
-        vlc_list_first_entry_or_null(&executor->queue, struct vlc_runnable,
-                                     node);
-    assert(runnable);
-    vlc_list_remove(&runnable->node);
+        vlc_list_first_entry_or_null(&queue->lists[priority],
+                                     struct vlc_runnable, node);
+    if (runnable != NULL)
+    {
+        vlc_list_remove(&runnable->node);
+
+        /* Set links to NULL to know that it has been taken by a thread in
+         * vlc_executor_Cancel() */
+        runnable->node.prev = runnable->node.next = NULL;
+
+        atomic_fetch_sub_explicit(&queue->counts[priority], 1,
+                                  memory_order_relaxed);
+        atomic_fetch_sub(&executor->pending, 1);
+    }
 
-    /* Set links to NULL to know that it has been taken by a thread in
-     * vlc_executor_Cancel() */
-    runnable->node.prev = runnable->node.next = NULL;
+    vlc_mutex_unlock(&queue->lock);
 
     return runnable;
 }
 
+static struct vlc_runnable *
+TryTake(struct vlc_executor_thread *thread)
+{
+    vlc_executor_t *executor = thread->owner;
+    unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                             memory_order_acquire);
+    if (nthreads <= thread->index)
+        /* This thread started before its spawner published the count */
+        nthreads = thread->index + 1;
+
+    for (int priority = PRIORITY_COUNT - 1; priority >= 0; --priority)
+    {
+        /* Own queue first, then steal from the other threads */
+        for (unsigned i = 0; i < nthreads; ++i)
+        {
+            struct vlc_executor_thread *victim =
+                executor->threads[(thread->index + i) % nthreads];
+            struct vlc_runnable *runnable =
+                QueuePop(executor, &victim->queue, priority);
+
+            if (runnable != NULL)
+                return runnable;
+        }
+    }
+
+    return NULL;
+}
+
+static struct vlc_runnable *
+Take(struct vlc_executor_thread *thread)
+{
+    vlc_executor_t *executor = thread->owner;
+
+    for (;;)
+    {
+        struct vlc_runnable *runnable = TryTake(thread);
+        if (runnable != NULL)
+            return runnable;
+
+        vlc_mutex_lock(&executor->lock);
+        while (!executor->closing && atomic_load(&executor->pending) == 0)
+        {
+            executor->sleeping++;
+            vlc_cond_wait(&executor->queue_wait, &executor->lock);
+            executor->sleeping--;
+        }
+
+        bool closing = executor->closing;
+        vlc_mutex_unlock(&executor->lock);
+
+        if (closing)
+            return NULL;
+    }
+}
+
+static void
+TaskDone(vlc_executor_t *executor)
+{
+    unsigned unfinished = atomic_fetch_sub(&executor->unfinished, 1);
+
+    assert(unfinished > 0);
+    if (unfinished == 1)
+    {
+        vlc_mutex_lock(&executor->lock);
+        vlc_cond_broadcast(&executor->idle_wait);
+        vlc_mutex_unlock(&executor->lock);
+    }
+}
+
 static void *
 ThreadRun(void *userdata)
 {
@@ -121,30 +251,25 @@ ThreadRun(void *userdata)
 
     vlc_thread_set_name("vlc-exec-runner");
 
-    vlc_mutex_lock(&executor->lock);
+    current_thread = thread;
 
     struct vlc_runnable *runnable;
-    /* When the executor is closing, QueueTake() returns NULL */
-    while ((runnable = QueueTake(executor)))
+    /* When the executor is closing, Take() returns NULL */
+    while ((runnable = Take(thread)))
     {
         thread->current_task = runnable;
-        vlc_mutex_unlock(&executor->lock);
 
-        /* Execute the user-provided runnable, without the executor lock */
+        /* Execute the user-provided runnable, without any lock */
         runnable->run(runnable->userdata);
 
-        vlc_mutex_lock(&executor->lock);
         thread->current_task = NULL;
 
         vlc_thread_set_name("vlc-exec-runner");
 
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        TaskDone(executor);
     }
 
-    vlc_mutex_unlock(&executor->lock);
+    current_thread = NULL;
 
     return NULL;
 }
@@ -152,14 +277,23 @@ ThreadRun(void *userdata)
 static int
 SpawnThread(vlc_executor_t *executor)
 {
-    assert(executor->nthreads < executor->max_threads);
+    vlc_mutex_assert(&executor->lock);
+
+    unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                             memory_order_relaxed);
+    assert(nthreads < executor->max_threads);
 
     struct vlc_executor_thread *thread = malloc(sizeof(*thread));
     if (!thread)
         return VLC_ENOMEM;
 
     thread->owner = executor;
+    thread->index = nthreads;
     thread->current_task = NULL;
+    QueueInit(&thread->queue);
+
+    /* Publish the thread before it can steal from the others */
+    executor->threads[nthreads] = thread;
 
     if (vlc_clone(&thread->thread, ThreadRun, thread))
     {
@@ -167,8 +301,8 @@ SpawnThread(vlc_executor_t *executor)
         return VLC_EGENERIC;
     }
 
-    executor->nthreads++;
-    vlc_list_append(&thread->node, &executor->threads);
+    atomic_store_explicit(&executor->nthreads, nthreads + 1,
+                          memory_order_release);
 
     return VLC_SUCCESS;
 }
@@ -181,14 +315,21 @@ vlc_executor_New(unsigned max_threads)
     if (!executor)
         return NULL;
 
+    executor->threads = vlc_alloc(max_threads, sizeof(*executor->threads));
+    if (!executor->threads)
+    {
+        free(executor);
+        return NULL;
+    }
+
     vlc_mutex_init(&executor->lock);
 
     executor->max_threads = max_threads;
-    executor->nthreads = 0;
-    executor->unfinished = 0;
-
-    vlc_list_init(&executor->threads);
-    vlc_list_init(&executor->queue);
+    atomic_init(&executor->nthreads, 0);
+    atomic_init(&executor->next, 0);
+    atomic_init(&executor->pending, 0);
+    atomic_init(&executor->unfinished, 0);
+    executor->sleeping = 0;
 
     vlc_cond_init(&executor->idle_wait);
     vlc_cond_init(&executor->queue_wait);
@@ -196,9 +337,12 @@ vlc_executor_New(unsigned max_threads)
     executor->closing = false;
 
     /* Create one thread on init so that vlc_executor_Submit() may never fail */
+    vlc_mutex_lock(&executor->lock);
     int ret = SpawnThread(executor);
+    vlc_mutex_unlock(&executor->lock);
     if (ret != VLC_SUCCESS)
     {
+        free(executor->threads);
         free(executor);
         return NULL;
     }
@@ -207,26 +351,57 @@ vlc_executor_New(unsigned max_threads)
 }
 
 void
-vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable)
+vlc_executor_SubmitWithPriority(vlc_executor_t *executor,
+                                struct vlc_runnable *runnable,
+                                enum vlc_executor_priority priority)
 {
+    assert(priority >= VLC_EXECUTOR_PRIORITY_LOW
+        && priority <= VLC_EXECUTOR_PRIORITY_HIGH);
+
+    struct vlc_executor_thread *thread = current_thread;
+    unsigned unfinished = atomic_fetch_add(&executor->unfinished, 1) + 1;
+
+    if (thread == NULL || thread->owner != executor)
+    {
+        /* Submitted from outside of the executor: distribute */
+        unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                                 memory_order_acquire);
+        unsigned index = atomic_fetch_add_explicit(&executor->next, 1,
+                                                   memory_order_relaxed);
+
+        thread = executor->threads[index % nthreads];
+    }
+
+    QueuePush(executor, &thread->queue, runnable, priority);
+
     vlc_mutex_lock(&executor->lock);
 
     assert(!executor->closing);
 
-    QueuePush(executor, runnable);
-
-    if (++executor->unfinished > executor->nthreads
-            && executor->nthreads < executor->max_threads)
+    unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                             memory_order_relaxed);
+    if (executor->sleeping > 0)
+        vlc_cond_signal(&executor->queue_wait);
+    else if (unfinished > nthreads && nthreads < executor->max_threads)
         /* If it fails, this is not an error, there is at least one thread */
         SpawnThread(executor);
 
     vlc_mutex_unlock(&executor->lock);
 }
 
+void
+vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable)
+{
+    vlc_executor_SubmitWithPriority(executor, runnable,
+                                    VLC_EXECUTOR_PRIORITY_NORMAL);
+}
+
 bool
 vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
 {
-    vlc_mutex_lock(&executor->lock);
+    struct vlc_executor_queue *queue = runnable->queue;
+
+    vlc_mutex_lock(&queue->lock);
 
     /* Either both prev and next are set, either both are NULL */
     assert(!runnable->node.prev == !runnable->node.next);
@@ -235,14 +410,17 @@ vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
     if (in_queue)
     {
         vlc_list_remove(&runnable->node);
+        runnable->node.prev = runnable->node.next = NULL;
 
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        atomic_fetch_sub_explicit(&queue->counts[runnable->priority], 1,
+                                  memory_order_relaxed);
+        atomic_fetch_sub(&executor->pending, 1);
     }
 
-    vlc_mutex_unlock(&executor->lock);
+    vlc_mutex_unlock(&queue->lock);
+
+    if (in_queue)
+        TaskDone(executor);
 
     return in_queue;
 }
@@ -251,7 +429,7 @@ void
 vlc_executor_WaitIdle(vlc_executor_t *executor)
 {
     vlc_mutex_lock(&executor->lock);
-    while (executor->unfinished)
+    while (atomic_load(&executor->unfinished))
         vlc_cond_wait(&executor->idle_wait, &executor->lock);
     vlc_mutex_unlock(&executor->lock);
 }
@@ -264,29 +442,32 @@ vlc_executor_Delete(vlc_executor_t *executor)
     executor->closing = true;
 
     /* All the tasks must be canceled on delete */
-    assert(vlc_list_is_empty(&executor->queue));
+    assert(atomic_load(&executor->pending) == 0);
 
     /* "closing" is now true, this will wake up threads */
     vlc_cond_broadcast(&executor->queue_wait);
 
     vlc_mutex_unlock(&executor->lock);
 
-    /* The threads list may not be written at this point, so it is safe to read
-     * it without mutex locked (the mutex must be released to join the
-     * threads). */
+    /* No threads may be spawned at this point, so it is safe to read the
+     * threads array without mutex locked (the mutex must be released to join
+     * the threads). */
 
-    struct vlc_executor_thread *thread;
-    vlc_list_foreach(thread, &executor->threads, node)
+    unsigned nthreads = atomic_load(&executor->nthreads);
+    for (unsigned i = 0; i < nthreads; ++i)
     {
+        struct vlc_executor_thread *thread = executor->threads[i];
+
         vlc_join(thread->thread, NULL);
         free(thread);
     }
 
-    /* The queue must still be empty (no runnable submitted a new runnable) */
-    assert(vlc_list_is_empty(&executor->queue));
+    /* The queues must still be empty (no runnable submitted a new runnable) */
+    assert(atomic_load(&executor->pending) == 0);
 
     /* There are no tasks anymore */
-    assert(!executor->unfinished);
+    assert(!atomic_load(&executor->unfinished));
 
+    free(executor->threads);
     free(executor);
 }
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include "../libvlc.h"
 
@@ -141,3 +142,172 @@ block_t *vlc_fifo_Show( block_fifo_t *p_fifo )
 
     return b;
 }
+
+/**
+ * Internal state for single producer single consumer block queues
+ *
+ * The producer pushes blocks onto a lock-free LIFO. The consumer takes the
+ * whole LIFO at once and reverses it into its own list.
+ */
+struct vlc_spsc_fifo
+{
+    /* Shared */
+    _Atomic(vlc_frame_t *) inbox; /* newest first */
+    atomic_bool         parked;
+
+    /* Written by the producer only, on its own cache line */
+    struct {
+        atomic_uint_least64_t count;
+        atomic_size_t   bytes;
+    } queued __attribute__((aligned(64)));
+
+    /* Written by the consumer only */
+    struct {
+        atomic_uint_least64_t count;
+        atomic_size_t   bytes;
+        vlc_frame_t    *first;
+    } dequeued __attribute__((aligned(64)));
+};
+
+vlc_spsc_fifo_t *vlc_spsc_fifo_New(void)
+{
+    vlc_spsc_fifo_t *fifo = aligned_alloc(64, sizeof (*fifo));
+
+    if (likely(fifo != NULL)) {
+        atomic_init(&fifo->inbox, NULL);
+        atomic_init(&fifo->parked, false);
+        atomic_init(&fifo->queued.count, 0);
+        atomic_init(&fifo->queued.bytes, 0);
+        atomic_init(&fifo->dequeued.count, 0);
+        atomic_init(&fifo->dequeued.bytes, 0);
+        fifo->dequeued.first = NULL;
+    }
+
+    return fifo;
+}
+
+void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *fifo)
+{
+    vlc_spsc_fifo_Discard(fifo, vlc_spsc_fifo_GetMark(fifo));
+    assert(fifo->dequeued.first == NULL);
+    aligned_free(fifo);
+}
+
+bool vlc_spsc_fifo_Queue(vlc_spsc_fifo_t *fifo, vlc_frame_t *block)
+{
+    assert(block->p_next == NULL);
+
+    /* Only this thread writes the counters, no read-modify-write needed */
+    atomic_store_explicit(&fifo->queued.count,
+        atomic_load_explicit(&fifo->queued.count, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    atomic_store_explicit(&fifo->queued.bytes,
+        atomic_load_explicit(&fifo->queued.bytes, memory_order_relaxed)
+        + block->i_buffer, memory_order_relaxed);
+
+    vlc_frame_t *head = atomic_load_explicit(&fifo->inbox,
+                                             memory_order_relaxed);
+    do
+        block->p_next = head;
+    while (!atomic_compare_exchange_weak_explicit(&fifo->inbox, &head, block,
+                                                  memory_order_release,
+                                                  memory_order_relaxed));
+
+    /* Pairs with the consumer storing parked then loading inbox: either it
+     * sees the block, or we see it parked. Only the first block queued
+     * while parked wakes the consumer up. */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&fifo->parked, memory_order_relaxed))
+        return false;
+    return atomic_exchange_explicit(&fifo->parked, false,
+                                    memory_order_relaxed);
+}
+
+uint64_t vlc_spsc_fifo_GetMark(const vlc_spsc_fifo_t *fifo)
+{
+    return atomic_load_explicit(&fifo->queued.count, memory_order_relaxed);
+}
+
+vlc_frame_t *vlc_spsc_fifo_Dequeue(vlc_spsc_fifo_t *fifo)
+{
+    if (fifo->dequeued.first == NULL) {
+        vlc_frame_t *block = atomic_exchange_explicit(&fifo->inbox, NULL,
+                                                      memory_order_acquire);
+        if (block == NULL)
+            return NULL;
+
+        /* Reverse the batch into queue order */
+        vlc_frame_t *first = NULL;
+        while (block != NULL) {
+            vlc_frame_t *next = block->p_next;
+
+            block->p_next = first;
+            first = block;
+            block = next;
+        }
+        fifo->dequeued.first = first;
+    }
+
+    vlc_frame_t *block = fifo->dequeued.first;
+
+    fifo->dequeued.first = block->p_next;
+    block->p_next = NULL;
+
+    atomic_store_explicit(&fifo->dequeued.count,
+        atomic_load_explicit(&fifo->dequeued.count, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    atomic_store_explicit(&fifo->dequeued.bytes,
+        atomic_load_explicit(&fifo->dequeued.bytes, memory_order_relaxed)
+        + block->i_buffer, memory_order_relaxed);
+    return block;
+}
+
+void vlc_spsc_fifo_Discard(vlc_spsc_fifo_t *fifo, uint64_t mark)
+{
+    while (atomic_load_explicit(&fifo->dequeued.count,
+                                memory_order_relaxed) < mark) {
+        vlc_frame_t *block = vlc_spsc_fifo_Dequeue(fifo);
+
+        /* Blocks before the mark were queued before it was taken */
+        assert(block != NULL);
+        vlc_frame_Release(block);
+    }
+}
+
+bool vlc_spsc_fifo_Park(vlc_spsc_fifo_t *fifo)
+{
+    if (fifo->dequeued.first != NULL)
+        return false;
+
+    atomic_store_explicit(&fifo->parked, true, memory_order_seq_cst);
+    if (atomic_load_explicit(&fifo->inbox, memory_order_seq_cst) != NULL) {
+        atomic_store_explicit(&fifo->parked, false, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void vlc_spsc_fifo_Unpark(vlc_spsc_fifo_t *fifo)
+{
+    atomic_store_explicit(&fifo->parked, false, memory_order_relaxed);
+}
+
+/* The consumer counters may be seen ahead of the producer ones */
+
+size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *fifo)
+{
+    uint_least64_t out = atomic_load_explicit(&fifo->dequeued.count,
+                                              memory_order_relaxed);
+    uint_least64_t in = atomic_load_explicit(&fifo->queued.count,
+                                             memory_order_relaxed);
+    return in > out ? in - out : 0;
+}
+
+size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *fifo)
+{
+    size_t out = atomic_load_explicit(&fifo->dequeued.bytes,
+                                      memory_order_relaxed);
+    size_t in = atomic_load_explicit(&fifo->queued.bytes,
+                                     memory_order_relaxed);
+    return in > out ? in - out : 0;
+}
@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
 #ifdef _WIN32
 # include <windows.h>
 #endif
@@ -38,6 +39,7 @@
 #include <vlc_atomic.h>
 #include <vlc_frame.h>
 #include <vlc_fs.h>
+#include <vlc_threads.h>
 
 #include <vlc_ancillary.h>
 
@@ -116,6 +118,306 @@ vlc_frame_t *vlc_frame_Init(vlc_frame_t *restrict f, const struct vlc_frame_call
 # define VLC_FRAME_PADDING      32 /* Avoid <= 32 bytes reallocs */
 #endif
 
+/** Whether AddressSanitizer is enabled (GCC defines the macro, Clang only
+ * reports the feature). */
+#if defined(__SANITIZE_ADDRESS__)
+# define VLC_FRAME_ASAN 1
+#elif defined(__has_feature)
+# if __has_feature(address_sanitizer)
+#  define VLC_FRAME_ASAN 1
+# endif
+#endif
+
+/** Whether to recycle small frames (see below). */
+#if defined(FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION) \
+ || defined(VLC_FRAME_ASAN) || !defined(HAVE_ALIGNED_ALLOC)
+# define VLC_FRAME_POOL 0 /* Let the sanitizers see every allocation */
+#else
+# define VLC_FRAME_POOL 1
+#endif
+
+#if VLC_FRAME_POOL
+/*
+ * Frame pool
+ *
+ * Small frames are allocated along with their buffer in a single chunk, and
+ * recycled by size class rather than freed. Each thread keeps a bounded cache
+ * of free chunks per class, so that allocations and releases do not contend.
+ * Caches exchange batches of chunks with a shared depot, which serves
+ * producer/consumer patterns where frames are allocated on one thread and
+ * released on another. Both the caches and the depot are bounded in bytes,
+ * and whatever they still hold is freed when the library is unloaded.
+ *
+ * Set the VLC_FRAME_POOL environment variable to 0 to disable recycling.
+ */
+#define FRAME_POOL_MIN_SHIFT 8 /* 256 bytes */
+#define FRAME_POOL_CLASSES 9 /* up to 64 KiB */
+#define FRAME_POOL_CACHE_MAX 32 /* chunks per thread and class */
+#define FRAME_POOL_BATCH (FRAME_POOL_CACHE_MAX / 2)
+#define FRAME_POOL_CACHE_BYTES (1 << 20) /* bytes per thread */
+#define FRAME_POOL_DEPOT_MAX (16 << 20) /* bytes */
+
+struct vlc_frame_pooled
+{
+    vlc_frame_t frame;
+    unsigned class;
+};
+
+/* Offset of the buffer within a pooled chunk */
+#define FRAME_POOL_HEADER \
+    ((sizeof (struct vlc_frame_pooled) + VLC_FRAME_ALIGN - 1) \
+     & ~(size_t)(VLC_FRAME_ALIGN - 1))
+
+struct vlc_frame_freelist
+{
+    vlc_frame_t *head; /* linked through p_next */
+    unsigned count;
+};
+
+struct vlc_frame_cache
+{
+    size_t bytes;
+    struct vlc_frame_freelist lists[FRAME_POOL_CLASSES];
+};
+
+static struct
+{
+    vlc_once_t once;
+    vlc_threadvar_t key;
+    bool enabled;
+    vlc_mutex_t lock;
+    size_t bytes;
+    struct vlc_frame_freelist lists[FRAME_POOL_CLASSES];
+} frame_depot = {
+    .once = VLC_STATIC_ONCE,
+    .lock = VLC_STATIC_MUTEX,
+};
+
+static thread_local struct vlc_frame_cache *frame_cache;
+
+static size_t vlc_frame_pool_ClassSize(unsigned class)
+{
+    return (size_t)1 << (class + FRAME_POOL_MIN_SHIFT);
+}
+
+static void vlc_frame_pool_Destroy(vlc_frame_t *frame)
+{
+    free(container_of(frame, struct vlc_frame_pooled, frame));
+}
+
+static vlc_frame_t *vlc_frame_freelist_Pop(struct vlc_frame_freelist *list)
+{
+    vlc_frame_t *frame = list->head;
+
+    if (frame != NULL)
+    {
+        list->head = frame->p_next;
+        list->count--;
+    }
+    return frame;
+}
+
+static void vlc_frame_freelist_Push(struct vlc_frame_freelist *list,
+                                    vlc_frame_t *frame)
+{
+    frame->p_next = list->head;
+    list->head = frame;
+    list->count++;
+}
+
+/** Moves up to count chunks from a thread cache to the depot. */
+static void vlc_frame_pool_Drain(struct vlc_frame_cache *cache,
+                                 unsigned class, unsigned count)
+{
+    struct vlc_frame_freelist *list = &cache->lists[class];
+    size_t size = vlc_frame_pool_ClassSize(class);
+
+    vlc_mutex_lock(&frame_depot.lock);
+    while (count-- > 0 && list->head != NULL)
+    {
+        vlc_frame_t *frame = vlc_frame_freelist_Pop(list);
+
+        cache->bytes -= size;
+        if (frame_depot.bytes + size > FRAME_POOL_DEPOT_MAX)
+        {
+            vlc_frame_pool_Destroy(frame);
+            continue;
+        }
+        frame_depot.bytes += size;
+        vlc_frame_freelist_Push(&frame_depot.lists[class], frame);
+    }
+    vlc_mutex_unlock(&frame_depot.lock);
+}
+
+/** Moves up to count chunks from the depot to a thread cache. */
+static void vlc_frame_pool_Refill(struct vlc_frame_cache *cache,
+                                  unsigned class, unsigned count)
+{
+    struct vlc_frame_freelist *depot = &frame_depot.lists[class];
+    size_t size = vlc_frame_pool_ClassSize(class);
+
+    vlc_mutex_lock(&frame_depot.lock);
+    while (count-- > 0 && depot->head != NULL)
+    {
+        frame_depot.bytes -= size;
+        cache->bytes += size;
+        vlc_frame_freelist_Push(&cache->lists[class],
+                                vlc_frame_freelist_Pop(depot));
+    }
+    vlc_mutex_unlock(&frame_depot.lock);
+}
+
+static void vlc_frame_cache_Destroy(void *data)
+{
+    struct vlc_frame_cache *cache = data;
+
+    for (unsigned i = 0; i < FRAME_POOL_CLASSES; i++)
+        vlc_frame_pool_Drain(cache, i, UINT_MAX);
+
+    if (frame_cache == cache)
+        frame_cache = NULL;
+    free(cache);
+}
+
+static void vlc_frame_pool_Init(void *data)
+{
+    const char *env = getenv("VLC_FRAME_POOL");
+
+    frame_depot.enabled = (env == NULL || strcmp(env, "0") != 0)
+                       && vlc_threadvar_create(&frame_depot.key,
+                                               vlc_frame_cache_Destroy) == 0;
+    (void) data;
+}
+
+static struct vlc_frame_cache *vlc_frame_cache_Get(void)
+{
+    struct vlc_frame_cache *cache = frame_cache;
+
+    if (likely(cache != NULL))
+        return cache;
+
+    vlc_once(&frame_depot.once, vlc_frame_pool_Init, NULL);
+    if (!frame_depot.enabled)
+        return NULL;
+
+    cache = calloc(1, sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    /* Register the cache so that it is flushed when the thread exits */
+    if (vlc_threadvar_set(frame_depot.key, cache))
+    {
+        free(cache);
+        return NULL;
+    }
+    frame_cache = cache;
+    return cache;
+}
+
+static void vlc_frame_pool_Release(vlc_frame_t *frame)
+{
+    struct vlc_frame_pooled *chunk =
+        container_of(frame, struct vlc_frame_pooled, frame);
+    struct vlc_frame_cache *cache = vlc_frame_cache_Get();
+
+    if (unlikely(cache == NULL))
+    {
+        free(chunk);
+        return;
+    }
+
+    struct vlc_frame_freelist *list = &cache->lists[chunk->class];
+
+    vlc_frame_freelist_Push(list, frame);
+    cache->bytes += vlc_frame_pool_ClassSize(chunk->class);
+
+    if (list->count > FRAME_POOL_CACHE_MAX)
+        vlc_frame_pool_Drain(cache, chunk->class, FRAME_POOL_BATCH);
+    else if (cache->bytes > FRAME_POOL_CACHE_BYTES)
+        /* Over budget: hand half of this class back, at least this chunk */
+        vlc_frame_pool_Drain(cache, chunk->class, (list->count + 1) / 2);
+}
+
+static const struct vlc_frame_callbacks vlc_frame_pool_cbs =
+{
+    vlc_frame_pool_Release,
+};
+
+static vlc_frame_t *vlc_frame_pool_Alloc(size_t capacity)
+{
+    if (capacity > vlc_frame_pool_ClassSize(FRAME_POOL_CLASSES - 1))
+        return NULL;
+
+    unsigned class = 0;
+
+    while (vlc_frame_pool_ClassSize(class) < capacity)
+        class++;
+
+    struct vlc_frame_cache *cache = vlc_frame_cache_Get();
+    if (cache == NULL)
+        return NULL;
+
+    struct vlc_frame_freelist *list = &cache->lists[class];
+    size_t size = vlc_frame_pool_ClassSize(class);
+    vlc_frame_t *frame;
+
+    if (list->head == NULL)
+    {
+        size_t room = (FRAME_POOL_CACHE_BYTES - cache->bytes) / size;
+
+        vlc_frame_pool_Refill(cache, class,
+                              VLC_CLIP(room, 1, FRAME_POOL_BATCH));
+    }
+
+    frame = vlc_frame_freelist_Pop(list);
+    if (frame != NULL)
+        cache->bytes -= size;
+    else
+    {
+        struct vlc_frame_pooled *chunk =
+            aligned_alloc(VLC_FRAME_ALIGN, FRAME_POOL_HEADER + size);
+        if (unlikely(chunk == NULL))
+            return NULL;
+
+        chunk->class = class;
+        frame = &chunk->frame;
+    }
+
+    return vlc_frame_Init(frame, &vlc_frame_pool_cbs,
+                          (unsigned char *)frame + FRAME_POOL_HEADER, size);
+}
+
+/**
+ * Frees the pooled chunks on unload.
+ *
+ * Thread-specific destructors do not run for the thread that exits the
+ * process, so its cache is torn down here along with the depot.
+ */
+__attribute__((destructor))
+static void vlc_frame_pool_Deinit(void)
+{
+    struct vlc_frame_cache *cache = frame_cache;
+
+    if (cache != NULL)
+    {
+        vlc_threadvar_set(frame_depot.key, NULL);
+        vlc_frame_cache_Destroy(cache);
+    }
+
+    vlc_mutex_lock(&frame_depot.lock);
+    for (unsigned i = 0; i < FRAME_POOL_CLASSES; i++)
+    {
+        struct vlc_frame_freelist *list = &frame_depot.lists[i];
+        vlc_frame_t *frame;
+
+        while ((frame = vlc_frame_freelist_Pop(list)) != NULL)
+            vlc_frame_pool_Destroy(frame);
+    }
+    frame_depot.bytes = 0;
+    vlc_mutex_unlock(&frame_depot.lock);
+}
+#endif
+
 vlc_frame_t *vlc_frame_Alloc (size_t size)
 {
     if (unlikely(size >> 28))
@@ -130,6 +432,17 @@ vlc_frame_t *vlc_frame_Alloc (size_t size)
     /* 2 * VLC_FRAME_PADDING: pre + post padding */
     size_t capacity = (2 * VLC_FRAME_PADDING) + size;
     unsigned char *buf;
+
+#if VLC_FRAME_POOL
+    vlc_frame_t *pooled = vlc_frame_pool_Alloc(capacity);
+    if (pooled != NULL)
+    {
+        pooled->p_buffer += VLC_FRAME_PADDING;
+        pooled->i_buffer = size;
+        return pooled;
+    }
+#endif
+
 #ifdef HAVE_ALIGNED_ALLOC
     capacity += (-size) % VLC_FRAME_ALIGN;
     buf = aligned_alloc(VLC_FRAME_ALIGN, capacity);
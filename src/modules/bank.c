@@ -106,11 +106,11 @@ static struct
 vlc_plugin_t *vlc_plugins = NULL;
 
 /**
- * Adds a module to the bank
+ * Adds modules of a given capability to the bank
  */
-static int vlc_module_store(module_t *mod)
+static int vlc_modcap_store(const char *name, module_t *const *modv,
+                            size_t modc, void *opaque)
 {
-    const char *name = module_get_capability(mod);
     vlc_modcap_t *cap = malloc(sizeof (*cap));
     if (unlikely(cap == NULL))
         return -1;
@@ -132,23 +132,34 @@ static int vlc_module_store(module_t *mod)
         cap = *cp;
     }
 
-    module_t **modv = realloc(cap->modv, sizeof (*modv) * (cap->modc + 1));
-    if (unlikely(modv == NULL))
+    module_t **tab = realloc(cap->modv, sizeof (*tab) * (cap->modc + modc));
+    if (unlikely(tab == NULL))
         return -1;
 
-    cap->modv = modv;
-    cap->modv[cap->modc] = mod;
-    cap->modc++;
+    cap->modv = tab;
+    memcpy(cap->modv + cap->modc, modv, sizeof (*modv) * modc);
+    cap->modc += modc;
+    (void) opaque;
     return 0;
 error:
     vlc_modcap_free(cap);
     return -1;
 }
 
+/**
+ * Adds a module to the bank
+ */
+static int vlc_module_store(module_t *mod)
+{
+    return vlc_modcap_store(module_get_capability(mod), &mod, 1, NULL);
+}
+
 /**
  * Adds a plugin (and all its modules) to the bank
+ *
+ * \param indexed whether the modules are added from the cache index instead
  */
-static void vlc_plugin_store(vlc_plugin_t *lib)
+static void vlc_plugin_store(vlc_plugin_t *lib, bool indexed)
 {
     vlc_mutex_assert(&modules.lock);
 
@@ -156,6 +167,9 @@ static void vlc_plugin_store(vlc_plugin_t *lib)
     vlc_plugins = lib;
     modules.count += lib->modules_count;
 
+    if (indexed)
+        return;
+
     for (module_t *m = lib->module; m != NULL; m = m->next)
         vlc_module_store(m);
 }
@@ -197,7 +211,7 @@ static void module_InitStaticModules(void)
     {
         vlc_plugin_t *lib = module_InitStatic(vlc_static_modules[i]);
         if (likely(lib != NULL))
-            vlc_plugin_store(lib);
+            vlc_plugin_store(lib, false);
     }
 }
 #else
@@ -305,6 +319,7 @@ typedef struct module_bank
     size_t        size;
     vlc_plugin_t **plugins;
     vlc_plugin_t *cache;
+    vlc_cache_index_t *index;
 } module_bank_t;
 
 /**
@@ -326,11 +341,14 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
         {
             msg_Err(bank->obj, "stale plugins cache: modified %s",
                     plugin->abspath);
+            vlc_cache_index_drop(bank->index, plugin);
             vlc_plugin_destroy(plugin);
             plugin = NULL;
         }
     }
 
+    bool cached = plugin != NULL;
+
     if (plugin == NULL)
     {
         char *path = strdup(relpath);
@@ -351,7 +369,7 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
     if (plugin == NULL)
         return -1;
 
-    vlc_plugin_store(plugin);
+    vlc_plugin_store(plugin, cached);
 
     if (bank->mode & CACHE_WRITE_FILE) /* Add entry to to-be-saved cache */
     {
@@ -523,7 +541,7 @@ static void AllocatePluginPath(libvlc_int_t *obj, const char *path,
     };
 
     if (mode & CACHE_READ_FILE)
-        bank.cache = vlc_cache_load(obj, path, &modules.caches);
+        bank.cache = vlc_cache_load(obj, path, &modules.caches, &bank.index);
     else
         msg_Dbg(bank.obj, "ignoring plugins cache file");
 
@@ -542,9 +560,19 @@ static void AllocatePluginPath(libvlc_int_t *obj, const char *path,
 
         bank.cache = plugin->next;
         if (mode & CACHE_SCAN_DIR)
+        {
+            vlc_cache_index_drop(bank.index, plugin);
             vlc_plugin_destroy(plugin);
+        }
         else
-            vlc_plugin_store(plugin);
+            vlc_plugin_store(plugin, true);
+    }
+
+    /* Add the modules of the cached plugins, a capability at a time */
+    if (bank.index != NULL)
+    {
+        vlc_cache_index_walk(bank.index, vlc_modcap_store, NULL);
+        vlc_cache_index_delete(bank.index);
     }
 
     if (mode & CACHE_WRITE_FILE)
@@ -734,7 +762,7 @@ void module_InitBank (void)
          * as for every other module. */
         vlc_plugin_t *plugin = module_InitStatic(VLC_MODULE_ENTRY(core));
         if (likely(plugin != NULL))
-            vlc_plugin_store(plugin);
+            vlc_plugin_store(plugin, false);
         config_SortConfig ();
     }
     modules.usage++;
@@ -38,7 +38,9 @@
 #include <assert.h>
 
 #include <vlc_common.h>
+#include <vlc_arrays.h>
 #include <vlc_block.h>
+#include <vlc_memstream.h>
 #include "../libvlc.h"
 
 #include <vlc_plugin.h>
@@ -57,13 +59,84 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 36
+#define CACHE_SUBVERSION_NUM 37
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
 /* Magic for the cache filename */
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
 
+/*
+ * After the header, the cache contains, in order:
+ *  - the table of contents,
+ *  - the plugin, module and shortcut records,
+ *  - the capability index: the capabilities sorted by name, each with the
+ *    run of its modules by decreasing score (modules without a capability
+ *    are not indexed),
+ *  - the string table, which the records refer to by offset (0 for NULL),
+ *  - the configuration items of each plugin in turn.
+ * Only the configuration items are parsed, as they are copied into the
+ * mutable settings. All the rest is checked once, then used in place.
+ */
+struct vlc_cache_toc
+{
+    uint32_t plugins;
+    uint32_t modules;
+    uint32_t shortcuts;
+    uint32_t caps;
+    uint32_t cap_modules;
+    uint32_t strings; /**< Size of the string table */
+};
+
+struct vlc_cache_plugin
+{
+    int64_t  mtime;
+    uint64_t size;
+    uint32_t path;
+    uint32_t textdomain;
+    uint32_t first_module;
+    uint32_t modules;
+    uint8_t  unloadable;
+    uint8_t  reserved[7];
+};
+
+struct vlc_cache_module
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t help_html;
+    uint32_t capability;
+    uint32_t activate;
+    uint32_t deactivate;
+    uint32_t first_shortcut;
+    uint32_t shortcuts;
+    int32_t  score;
+};
+
+struct vlc_cache_cap
+{
+    uint32_t name;
+    uint32_t first_module; /**< Index in the capability modules table */
+    uint32_t modules;
+};
+
+struct vlc_cache_index
+{
+    /* Mapped from the file */
+    const struct vlc_cache_toc *toc;
+    const struct vlc_cache_plugin *plugins;
+    const struct vlc_cache_module *modules;
+    const uint32_t *shortcuts;
+    const struct vlc_cache_cap *caps;
+    const uint32_t *cap_modules;
+    const char *strings;
+
+    /* Loaded from the records, NULL once dropped */
+    vlc_plugin_t **plugin_tab;
+    module_t **module_tab;
+};
+
 
 static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
 {
@@ -293,67 +366,74 @@ error:
     return -1; /* FIXME: leaks */
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+static const char *vlc_cache_string(const vlc_cache_index_t *index,
+                                    uint32_t offset)
+{
+    return offset ? index->strings + offset : NULL;
+}
+
+static module_t *vlc_cache_load_module(vlc_plugin_t *plugin,
+                                       const vlc_cache_index_t *index,
+                                       const struct vlc_cache_module *rec)
 {
     module_t *module = vlc_module_create(plugin);
     if (unlikely(module == NULL))
-        return -1;
+        return NULL;
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
-    LOAD_STRING(module->psz_help_html);
+    module->psz_shortname = vlc_cache_string(index, rec->shortname);
+    module->psz_longname = vlc_cache_string(index, rec->longname);
+    module->psz_help = vlc_cache_string(index, rec->help);
+    module->psz_help_html = vlc_cache_string(index, rec->help_html);
 
-    LOAD_IMMEDIATE(module->i_shortcuts);
-    if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
-        goto error;
-    else
+    if (rec->shortcuts > 0)
     {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            LOAD_STRING(module->pp_shortcuts[j]);
+        module->pp_shortcuts = vlc_alloc(rec->shortcuts,
+                                         sizeof (*module->pp_shortcuts));
+        if (unlikely(module->pp_shortcuts == NULL))
+            return NULL;
+
+        for (unsigned j = 0; j < rec->shortcuts; j++)
+            module->pp_shortcuts[j] =
+                vlc_cache_string(index, index->shortcuts[rec->first_shortcut + j]);
     }
+    module->i_shortcuts = rec->shortcuts;
 
-    LOAD_STRING(module->activate_name);
-    LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
-    return 0;
-error:
-    return -1;
+    module->activate_name = vlc_cache_string(index, rec->activate);
+    module->deactivate_name = vlc_cache_string(index, rec->deactivate);
+    module->psz_capability = vlc_cache_string(index, rec->capability);
+    module->i_score = rec->score;
+    return module;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+static vlc_plugin_t *vlc_cache_load_plugin(vlc_cache_index_t *index, size_t i,
+                                           block_t *file)
 {
+    const struct vlc_cache_plugin *rec = &index->plugins[i];
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
         return NULL;
 
-    uint32_t modules;
-    LOAD_IMMEDIATE(modules);
-
-    for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+    for (uint32_t j = rec->first_module;
+         j < rec->first_module + rec->modules; j++)
+    {
+        module_t *module = vlc_cache_load_module(plugin, index,
+                                                 &index->modules[j]);
+        if (module == NULL)
             goto error;
+        index->module_tab[j] = module;
+    }
 
     if (vlc_cache_load_plugin_config(plugin, file))
         goto error;
 
-    LOAD_STRING(plugin->textdomain);
-
-    const char *path;
-    LOAD_STRING(path);
-    if (path == NULL)
-        goto error;
-
-    plugin->path = strdup(path);
+    plugin->textdomain = vlc_cache_string(index, rec->textdomain);
+    plugin->path = strdup(vlc_cache_string(index, rec->path));
     if (unlikely(plugin->path == NULL))
         goto error;
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+    plugin->unloadable = rec->unloadable;
+    plugin->mtime = rec->mtime;
+    plugin->size = rec->size;
 
     if (plugin->textdomain != NULL)
         vlc_bindtextdomain(plugin->textdomain);
@@ -365,6 +445,143 @@ error:
     return NULL;
 }
 
+static bool vlc_cache_check_string(const struct vlc_cache_toc *toc,
+                                   uint32_t offset)
+{
+    /* The string table ends with a nul, so any offset within is a string */
+    return offset < toc->strings;
+}
+
+/**
+ * Checks all records once, so that they can be used without further checks.
+ */
+static int vlc_cache_check_index(const vlc_cache_index_t *index)
+{
+    const struct vlc_cache_toc *toc = index->toc;
+
+    if (toc->strings == 0 || index->strings[toc->strings - 1] != '\0')
+        return -1;
+
+    uint32_t next_module = 0;
+
+    for (size_t i = 0; i < toc->plugins; i++)
+    {
+        const struct vlc_cache_plugin *rec = &index->plugins[i];
+
+        /* Each plugin has the modules right after those of the previous one */
+        if (rec->first_module != next_module
+         || rec->modules > toc->modules - next_module
+         || rec->path == 0 || !vlc_cache_check_string(toc, rec->path)
+         || !vlc_cache_check_string(toc, rec->textdomain)
+         || rec->unloadable > 1)
+            return -1;
+        next_module += rec->modules;
+    }
+
+    if (next_module != toc->modules)
+        return -1;
+
+    for (size_t i = 0; i < toc->modules; i++)
+    {
+        const struct vlc_cache_module *rec = &index->modules[i];
+
+        if (!vlc_cache_check_string(toc, rec->shortname)
+         || !vlc_cache_check_string(toc, rec->longname)
+         || !vlc_cache_check_string(toc, rec->help)
+         || !vlc_cache_check_string(toc, rec->help_html)
+         || !vlc_cache_check_string(toc, rec->activate)
+         || !vlc_cache_check_string(toc, rec->deactivate)
+         || !vlc_cache_check_string(toc, rec->capability)
+         || rec->shortcuts > MODULE_SHORTCUT_MAX
+         || rec->first_shortcut > toc->shortcuts
+         || rec->shortcuts > toc->shortcuts - rec->first_shortcut)
+            return -1;
+    }
+
+    for (size_t i = 0; i < toc->shortcuts; i++)
+        if (index->shortcuts[i] == 0
+         || !vlc_cache_check_string(toc, index->shortcuts[i]))
+            return -1;
+
+    for (size_t i = 0; i < toc->caps; i++)
+    {
+        const struct vlc_cache_cap *cap = &index->caps[i];
+
+        if (cap->name == 0
+         || cap->first_module > toc->cap_modules
+         || cap->modules > toc->cap_modules - cap->first_module)
+            return -1;
+
+        /* Strings are only stored once, so offsets can be compared */
+        for (uint32_t j = 0; j < cap->modules; j++)
+        {
+            uint32_t m = index->cap_modules[cap->first_module + j];
+
+            if (m >= toc->modules || index->modules[m].capability != cap->name)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+void vlc_cache_index_delete(vlc_cache_index_t *index)
+{
+    free(index->plugin_tab);
+    free(index->module_tab);
+    free(index);
+}
+
+void vlc_cache_index_drop(vlc_cache_index_t *index, const vlc_plugin_t *plugin)
+{
+    for (size_t i = 0; i < index->toc->plugins; i++)
+    {
+        if (index->plugin_tab[i] != plugin)
+            continue;
+
+        const struct vlc_cache_plugin *rec = &index->plugins[i];
+
+        for (uint32_t j = 0; j < rec->modules; j++)
+            index->module_tab[rec->first_module + j] = NULL;
+        index->plugin_tab[i] = NULL;
+        break;
+    }
+}
+
+int vlc_cache_index_walk(const vlc_cache_index_t *index,
+                         int (*cb)(const char *, module_t *const *, size_t,
+                                   void *),
+                         void *opaque)
+{
+    const struct vlc_cache_toc *toc = index->toc;
+    module_t **modv = vlc_alloc(toc->modules, sizeof (*modv));
+    int ret = 0;
+
+    if (unlikely(modv == NULL) && toc->modules > 0)
+        return -1;
+
+    for (size_t i = 0; i < toc->caps && ret == 0; i++)
+    {
+        const struct vlc_cache_cap *cap = &index->caps[i];
+        size_t modc = 0;
+
+        for (uint32_t j = 0; j < cap->modules; j++)
+        {
+            module_t *module =
+                index->module_tab[index->cap_modules[cap->first_module + j]];
+
+            if (module != NULL)
+                modv[modc++] = module;
+        }
+
+        if (modc > 0)
+            ret = cb(vlc_cache_string(index, cap->name), modv, modc, opaque);
+    }
+
+    free(modv);
+    return ret;
+}
+
 /**
  * Loads a plugins cache file.
  *
@@ -374,7 +591,7 @@ error:
  * This allows us to only fully load plugins when they are actually used.
  */
 vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
-                             block_t **backingp)
+                             block_t **backingp, vlc_cache_index_t **indexp)
 {
     char *psz_filename;
 
@@ -444,11 +661,45 @@ vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
         return NULL;
     }
 
+    vlc_cache_index_t *index = calloc(1, sizeof (*index));
     vlc_plugin_t *cache = NULL;
 
-    while (file->i_buffer > 0)
+    if (unlikely(index == NULL))
+    {
+        block_Release(file);
+        return NULL;
+    }
+
+    LOAD_ALIGNOF(struct vlc_cache_toc);
+    LOAD_ARRAY(index->toc, 1);
+
+    const struct vlc_cache_toc *toc = index->toc;
+
+    LOAD_ALIGNOF(struct vlc_cache_plugin);
+    LOAD_ARRAY(index->plugins, toc->plugins);
+    LOAD_ALIGNOF(struct vlc_cache_module);
+    LOAD_ARRAY(index->modules, toc->modules);
+    LOAD_ALIGNOF(uint32_t);
+    LOAD_ARRAY(index->shortcuts, toc->shortcuts);
+    LOAD_ALIGNOF(struct vlc_cache_cap);
+    LOAD_ARRAY(index->caps, toc->caps);
+    LOAD_ALIGNOF(uint32_t);
+    LOAD_ARRAY(index->cap_modules, toc->cap_modules);
+    LOAD_ARRAY(index->strings, toc->strings);
+
+    if (vlc_cache_check_index(index))
+        goto error;
+
+    index->plugin_tab = vlc_alloc(toc->plugins, sizeof (*index->plugin_tab));
+    index->module_tab = calloc(toc->modules, sizeof (*index->module_tab));
+    if (unlikely((index->plugin_tab == NULL && toc->plugins > 0)
+              || (index->module_tab == NULL && toc->modules > 0)))
+        goto error;
+
+    /* Only the configuration items remain to be parsed, in plugins order */
+    for (size_t i = 0; i < toc->plugins; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(index, i, file);
         if (plugin == NULL)
             goto error;
 
@@ -460,18 +711,30 @@ vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
             goto error;
         }
 
+        index->plugin_tab[i] = plugin;
         plugin->next = cache;
         cache = plugin;
     }
 
+    if (file->i_buffer > 0)
+        goto error;
+
     file->p_next = *backingp;
     *backingp = file;
+    *indexp = index;
     return cache;
 
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
+    while (cache != NULL)
+    {
+        vlc_plugin_t *plugin = cache;
+
+        cache = plugin->next;
+        vlc_plugin_destroy(plugin);
+    }
+    vlc_cache_index_delete(index);
     block_Release(file);
     return NULL;
 }
@@ -578,29 +841,165 @@ error:
     return -1;
 }
 
-static int CacheSaveModule(FILE *file, const module_t *module)
+struct cache_writer
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
-    SAVE_STRING(module->psz_help_html);
-    SAVE_IMMEDIATE(module->i_shortcuts);
+    struct vlc_memstream strings;
+    size_t size; /* of the strings so far */
+    vlc_dictionary_t offsets;
+};
 
-    for (size_t j = 0; j < module->i_shortcuts; j++)
-         SAVE_STRING(module->pp_shortcuts[j]);
+/* Adds a string to the table, once */
+static uint32_t CacheSaveStringOffset(struct cache_writer *w, const char *str)
+{
+    if (str == NULL)
+        return 0;
 
-    SAVE_STRING(module->activate_name);
-    SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
-    return 0;
-error:
-    return -1;
+    void *offset = vlc_dictionary_value_for_key(&w->offsets, str);
+    if (offset != kVLCDictionaryNotFound)
+        return (uintptr_t)offset;
+
+    size_t len = strlen(str) + 1;
+    uint32_t ret = w->size;
+
+    vlc_memstream_write(&w->strings, str, len);
+    w->size += len;
+    vlc_dictionary_insert(&w->offsets, str, (void *)(uintptr_t)ret);
+    return ret;
+}
+
+struct cache_cap_entry
+{
+    const char *name;
+    int score;
+    uint32_t module;
+};
+
+static int CacheCapCmp(const void *a, const void *b)
+{
+    const struct cache_cap_entry *ea = a, *eb = b;
+    int ret = strcmp(ea->name, eb->name);
+
+    if (ret == 0)
+        ret = (eb->score > ea->score) - (eb->score < ea->score);
+    if (ret == 0)
+        ret = (ea->module > eb->module) - (ea->module < eb->module);
+    return ret;
 }
 
+#define SAVE_ARRAY(a, n) \
+    if ((n) > 0 && fwrite((a), sizeof (*(a)), (n), file) != (n)) \
+        goto error
+
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
     uint32_t i_file_size = 0;
+    struct vlc_cache_toc toc = { .plugins = n };
+    struct vlc_cache_plugin *plugins = NULL;
+    struct vlc_cache_module *modules = NULL;
+    uint32_t *shortcuts = NULL;
+    struct cache_cap_entry *entries = NULL;
+    struct vlc_cache_cap *caps = NULL;
+    uint32_t *cap_modules = NULL;
+    struct cache_writer w;
+    int ret = -1;
+
+    if (vlc_memstream_open(&w.strings))
+        return -1;
+    vlc_dictionary_init(&w.offsets, 0);
+    /* Offset 0 stands for NULL */
+    vlc_memstream_putc(&w.strings, '\0');
+    w.size = 1;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        toc.modules += cache[i]->modules_count;
+        for (const module_t *module = cache[i]->module;
+             module != NULL;
+             module = module->next)
+            toc.shortcuts += module->i_shortcuts;
+    }
+
+    plugins = calloc(n, sizeof (*plugins));
+    modules = calloc(toc.modules, sizeof (*modules));
+    shortcuts = vlc_alloc(toc.shortcuts, sizeof (*shortcuts));
+    entries = vlc_alloc(toc.modules, sizeof (*entries));
+    caps = vlc_alloc(toc.modules, sizeof (*caps));
+    cap_modules = vlc_alloc(toc.modules, sizeof (*cap_modules));
+    if (unlikely((plugins == NULL && n > 0)
+              || (shortcuts == NULL && toc.shortcuts > 0)
+              || ((modules == NULL || entries == NULL || caps == NULL
+                || cap_modules == NULL) && toc.modules > 0)))
+        goto error;
+
+    /* Build the records */
+    uint32_t m = 0, sc = 0, e = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const vlc_plugin_t *plugin = cache[i];
+        struct vlc_cache_plugin *prec = &plugins[i];
+
+        prec->mtime = plugin->mtime;
+        prec->size = plugin->size;
+        prec->path = CacheSaveStringOffset(&w, plugin->path);
+        prec->textdomain = CacheSaveStringOffset(&w, plugin->textdomain);
+        prec->first_module = m;
+        prec->modules = plugin->modules_count;
+        prec->unloadable = plugin->unloadable;
+
+        for (const module_t *module = plugin->module;
+             module != NULL;
+             module = module->next, m++)
+        {
+            struct vlc_cache_module *mrec = &modules[m];
+
+            mrec->shortname = CacheSaveStringOffset(&w, module->psz_shortname);
+            mrec->longname = CacheSaveStringOffset(&w, module->psz_longname);
+            mrec->help = CacheSaveStringOffset(&w, module->psz_help);
+            mrec->help_html = CacheSaveStringOffset(&w, module->psz_help_html);
+            mrec->capability = CacheSaveStringOffset(&w, module->psz_capability);
+            mrec->activate = CacheSaveStringOffset(&w, module->activate_name);
+            mrec->deactivate = CacheSaveStringOffset(&w, module->deactivate_name);
+            mrec->first_shortcut = sc;
+            mrec->shortcuts = module->i_shortcuts;
+            mrec->score = module->i_score;
+
+            for (size_t j = 0; j < module->i_shortcuts; j++)
+                shortcuts[sc++] = CacheSaveStringOffset(&w,
+                                                        module->pp_shortcuts[j]);
+
+            /* Modules without capability are left out of the index */
+            if (module->psz_capability == NULL)
+                continue;
+            entries[e].name = module->psz_capability;
+            entries[e].score = module->i_score;
+            entries[e].module = m;
+            e++;
+        }
+    }
+    assert(m == toc.modules && sc == toc.shortcuts);
+
+    /* Build the capability index */
+    qsort(entries, e, sizeof (*entries), CacheCapCmp);
+
+    for (uint32_t i = 0; i < e; i++)
+    {
+        if (i == 0 || strcmp(entries[i].name, entries[i - 1].name))
+        {
+            caps[toc.caps].name = modules[entries[i].module].capability;
+            caps[toc.caps].first_module = i;
+            caps[toc.caps].modules = 0;
+            toc.caps++;
+        }
+        caps[toc.caps - 1].modules++;
+        cap_modules[i] = entries[i].module;
+    }
+    toc.cap_modules = e;
+
+    if (vlc_memstream_flush(&w.strings) || w.strings.length != w.size
+     || w.size > UINT32_MAX)
+        goto error;
+    toc.strings = w.strings.length;
 
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
@@ -621,37 +1020,40 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
+    SAVE_ALIGNOF(struct vlc_cache_toc);
+    SAVE_IMMEDIATE(toc);
+    SAVE_ALIGNOF(struct vlc_cache_plugin);
+    SAVE_ARRAY(plugins, toc.plugins);
+    SAVE_ALIGNOF(struct vlc_cache_module);
+    SAVE_ARRAY(modules, toc.modules);
+    SAVE_ALIGNOF(uint32_t);
+    SAVE_ARRAY(shortcuts, toc.shortcuts);
+    SAVE_ALIGNOF(struct vlc_cache_cap);
+    SAVE_ARRAY(caps, toc.caps);
+    SAVE_ALIGNOF(uint32_t);
+    SAVE_ARRAY(cap_modules, toc.cap_modules);
+    SAVE_ARRAY(w.strings.ptr, toc.strings);
+
+    /* Config stuff */
     for (size_t i = 0; i < n; i++)
-    {
-        const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
-
-        SAVE_IMMEDIATE(count);
-
-        for (module_t *module = plugin->module;
-             module != NULL;
-             module = module->next)
-            if (CacheSaveModule(file, module))
-                goto error;
-
-        /* Config stuff */
-        if (CacheSaveModuleConfig(file, plugin))
+        if (CacheSaveModuleConfig(file, cache[i]))
             goto error;
 
-        /* Save common info */
-        SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
-    }
-
     if (fflush (file)) /* flush libc buffers */
         goto error;
-    return 0; /* success! */
+    ret = 0; /* success! */
 
 error:
-    return -1;
+    if (vlc_memstream_close(&w.strings) == 0)
+        free(w.strings.ptr);
+    vlc_dictionary_clear(&w.offsets, NULL, NULL);
+    free(cap_modules);
+    free(caps);
+    free(entries);
+    free(shortcuts);
+    free(modules);
+    free(plugins);
+    return ret;
 }
 
 /**
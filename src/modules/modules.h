@@ -177,9 +177,29 @@ void *vlc_dlsym(void *handle, const char *name) VLC_USED;
 char *vlc_dlerror(void) VLC_USED;
 
 /* Plugins cache */
-vlc_plugin_t *vlc_cache_load(libvlc_int_t *, const char *, block_t **);
+typedef struct vlc_cache_index vlc_cache_index_t;
+
+vlc_plugin_t *vlc_cache_load(libvlc_int_t *, const char *, block_t **,
+                             vlc_cache_index_t **);
 vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
 
+/**
+ * Forgets a cached plug-in that will not be used, before it is destroyed.
+ */
+void vlc_cache_index_drop(vlc_cache_index_t *, const vlc_plugin_t *);
+
+/**
+ * Enumerates the modules of the cached plug-ins still in use, by capability.
+ *
+ * The callback is invoked once per capability, with its modules sorted by
+ * decreasing score, until it returns non-zero.
+ */
+int vlc_cache_index_walk(const vlc_cache_index_t *,
+                         int (*)(const char *cap, module_t *const *modv,
+                                 size_t modc, void *opaque),
+                         void *opaque);
+void vlc_cache_index_delete(vlc_cache_index_t *);
+
 void CacheSave(libvlc_int_t *, const char *, vlc_plugin_t *const *, size_t);
 
 #endif /* !LIBVLC_MODULES_H */
@@ -32,6 +32,8 @@
 #include <vlc_threads.h>
 #include <vlc_poll.h>
 #include <vlc_httpd.h>
+#include <vlc_cpu.h>
+#include <vlc_fs.h>
 
 #include <assert.h>
 
@@ -63,6 +65,11 @@
 #   include <sys/socket.h>
 #endif
 
+#ifdef __linux__
+#   include <sys/epoll.h>
+#   define HTTPD_USE_EPOLL 1
+#endif
+
 #if defined(_WIN32)
 /* We need HUGE buffer otherwise TCP throughput is very limited */
 #define HTTPD_CL_BUFSIZE 1000000
@@ -70,10 +77,20 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* read-ahead buffer for requests, so that pipelined requests are parsed
+ * without a system call per byte */
+#define HTTPD_RECV_BUFSIZE 4096
+/* number of steps a client can run before others get their turn */
+#define HTTPD_CLIENT_BUDGET 64
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
+static void httpd_ClientSchedule(httpd_client_t *cl, uint8_t sched);
+static void httpd_HostWake(httpd_host_t *host);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
-/* each host run in his own thread */
+typedef struct httpd_worker_t httpd_worker_t;
+
+/* each host runs a few worker threads */
 struct httpd_host_t
 {
     struct vlc_object_t obj;
@@ -87,8 +104,7 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
-    vlc_mutex_t lock;
+    vlc_mutex_t lock; /* protects the urls */
 
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
      * This will slow down the url research but make my live easier
@@ -96,14 +112,35 @@ struct httpd_host_t
      * */
     struct vlc_list urls;
 
-    size_t client_count;
-    struct vlc_list clients;
     unsigned timeout_sec;
 
+    /* each worker accepts and serves its own clients */
+    httpd_worker_t *workers;
+    unsigned        nworkers;
+
     /* TLS data */
     vlc_tls_server_t *p_tls;
 };
 
+struct httpd_worker_t
+{
+    httpd_host_t *host;
+    vlc_thread_t thread;
+    vlc_mutex_t lock; /* protects the clients and their state */
+
+    size_t client_count;
+    struct vlc_list clients;
+    struct vlc_list ready;   /* clients to run without waiting for I/O */
+    struct vlc_list waiting; /* clients waiting for stream data or a url */
+
+#ifdef HTTPD_USE_EPOLL
+    int epfd;
+#endif
+    int wakefd[2]; /* signaled when streams get data */
+    atomic_bool woken;
+    vlc_tick_t timeout_check;
+};
+
 
 struct httpd_url_t
 {
@@ -132,29 +169,55 @@ enum
     HTTPD_CLIENT_SEND_DONE,
 
     HTTPD_CLIENT_WAITING,
+    HTTPD_CLIENT_DEFERRED, /* the url cannot answer the request yet */
 
     HTTPD_CLIENT_DEAD,
 
     HTTPD_CLIENT_TLS_HS_IN,
-    HTTPD_CLIENT_TLS_HS_OUT
+    HTTPD_CLIENT_TLS_HS_OUT,
+
+    HTTPD_CLIENT_STREAMING, /* sending straight from a stream buffer */
+};
+
+/* scheduling */
+enum
+{
+    HTTPD_CLIENT_POLLED,
+    HTTPD_CLIENT_READY,
+    HTTPD_CLIENT_PARKED,
 };
 
 struct httpd_client_t
 {
     httpd_url_t *url;
     vlc_tls_t   *sock;
+    httpd_worker_t *worker;
 
     struct vlc_list node;
+    struct vlc_list sched_node; /* in the ready or waiting list */
 
     bool    b_stream_mode;
     uint8_t i_state;
+    uint8_t i_sched;
+    short   i_events; /* polled events */
+    short   i_revents;
 
     vlc_tick_t i_timeout_date;
+    vlc_tick_t i_defer_date; /* deadline of a deferred request */
 
     /* buffer for reading header */
     int     i_buffer_size;
     int     i_buffer;
     uint8_t *p_buffer;
+    block_t *p_buffer_block; /* owner of p_buffer, if not NULL */
+
+    /* read-ahead */
+    uint8_t *p_recv;
+    size_t   i_recv;
+    size_t   i_recv_pos;
+
+    /* stream being sent, if any */
+    httpd_stream_t *stream;
 
     /*
      * If waiting for a keyframe, this is the position (in bytes) of the
@@ -663,120 +726,80 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
     if (!answer || !query || !cl)
         return VLC_SUCCESS;
 
-    if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
-
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
-        }
-
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
-
-        /* using HTTPD_MSG_ANSWER -> data available */
-        answer->i_proto  = HTTPD_PROTO_HTTP;
-        answer->i_version= 0;
-        answer->i_type   = HTTPD_MSG_ANSWER;
+    /* the data itself is sent by httpd_ClientStream() */
+    assert(answer->i_body_offset == 0);
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 0;
+    answer->i_type   = HTTPD_MSG_ANSWER;
 
-        return VLC_SUCCESS;
-    } else {
-        answer->i_proto  = HTTPD_PROTO_HTTP;
-        answer->i_version= 0;
-        answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_status = 200;
 
-        answer->i_status = 200;
+    bool b_has_content_type = false;
+    bool b_has_cache_control = false;
 
-        bool b_has_content_type = false;
-        bool b_has_cache_control = false;
+    vlc_mutex_lock(&stream->lock);
+    for (size_t i = 0; i < stream->i_http_headers; i++)
+        if (strncasecmp(stream->p_http_headers[i].name, "Content-Length", 14)) {
+            httpd_MsgAdd(answer, stream->p_http_headers[i].name, "%s",
+                          stream->p_http_headers[i].value);
+
+            if (!strncasecmp(stream->p_http_headers[i].name, "Content-Type", 12))
+                b_has_content_type = true;
+            else if (!strncasecmp(stream->p_http_headers[i].name, "Cache-Control", 13))
+                b_has_cache_control = true;
+        }
+    vlc_mutex_unlock(&stream->lock);
 
+    if (query->i_type != HTTPD_MSG_HEAD) {
+        cl->b_stream_mode = true;
+        cl->stream = stream;
         vlc_mutex_lock(&stream->lock);
-        for (size_t i = 0; i < stream->i_http_headers; i++)
-            if (strncasecmp(stream->p_http_headers[i].name, "Content-Length", 14)) {
-                httpd_MsgAdd(answer, stream->p_http_headers[i].name, "%s",
-                              stream->p_http_headers[i].value);
-
-                if (!strncasecmp(stream->p_http_headers[i].name, "Content-Type", 12))
-                    b_has_content_type = true;
-                else if (!strncasecmp(stream->p_http_headers[i].name, "Cache-Control", 13))
-                    b_has_cache_control = true;
-            }
-        vlc_mutex_unlock(&stream->lock);
-
-        if (query->i_type != HTTPD_MSG_HEAD) {
-            cl->b_stream_mode = true;
-            vlc_mutex_lock(&stream->lock);
-            /* Send the header */
-            if (stream->i_header > 0) {
-                answer->i_body = stream->i_header;
-                answer->p_body = xmalloc(stream->i_header);
-                memcpy(answer->p_body, stream->p_header, stream->i_header);
-            }
-            answer->i_body_offset = stream->i_buffer_last_pos;
-            if (stream->b_has_keyframes)
-                cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
-            else
-                cl->i_keyframe_wait_to_pass = -1;
-            vlc_mutex_unlock(&stream->lock);
-        } else {
-            httpd_MsgAdd(answer, "Content-Length", "0");
-            answer->i_body_offset = 0;
+        /* Send the header */
+        if (stream->i_header > 0) {
+            answer->i_body = stream->i_header;
+            answer->p_body = xmalloc(stream->i_header);
+            memcpy(answer->p_body, stream->p_header, stream->i_header);
         }
+        answer->i_body_offset = stream->i_buffer_last_pos;
+        if (stream->b_has_keyframes)
+            cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
+        else
+            cl->i_keyframe_wait_to_pass = -1;
+        vlc_mutex_unlock(&stream->lock);
+    } else {
+        httpd_MsgAdd(answer, "Content-Length", "0");
+        answer->i_body_offset = 0;
+    }
 
-        /* FIXME: move to http access_output */
-        if (!strcmp(stream->psz_mime, "video/x-ms-asf-stream")) {
-            bool b_xplaystream = false;
+    /* FIXME: move to http access_output */
+    if (!strcmp(stream->psz_mime, "video/x-ms-asf-stream")) {
+        bool b_xplaystream = false;
 
-            httpd_MsgAdd(answer, "Content-type", "application/octet-stream");
-            httpd_MsgAdd(answer, "Server", "Cougar 4.1.0.3921");
-            httpd_MsgAdd(answer, "Pragma", "no-cache");
-            httpd_MsgAdd(answer, "Pragma", "client-id=%lu",
-                          vlc_mrand48()&0x7fff);
-            httpd_MsgAdd(answer, "Pragma", "features=\"broadcast\"");
+        httpd_MsgAdd(answer, "Content-type", "application/octet-stream");
+        httpd_MsgAdd(answer, "Server", "Cougar 4.1.0.3921");
+        httpd_MsgAdd(answer, "Pragma", "no-cache");
+        httpd_MsgAdd(answer, "Pragma", "client-id=%lu",
+                      vlc_mrand48()&0x7fff);
+        httpd_MsgAdd(answer, "Pragma", "features=\"broadcast\"");
 
-            /* Check if there is a xPlayStrm=1 */
-            for (size_t i = 0; i < query->i_headers; i++)
-                if (!strcasecmp(query->p_headers[i].name,  "Pragma") &&
-                    strstr(query->p_headers[i].value, "xPlayStrm=1"))
-                    b_xplaystream = true;
+        /* Check if there is a xPlayStrm=1 */
+        for (size_t i = 0; i < query->i_headers; i++)
+            if (!strcasecmp(query->p_headers[i].name,  "Pragma") &&
+                strstr(query->p_headers[i].value, "xPlayStrm=1"))
+                b_xplaystream = true;
 
-            if (!b_xplaystream)
-                answer->i_body_offset = 0;
-        } else if (!b_has_content_type)
-            httpd_MsgAdd(answer, "Content-type", "%s", stream->psz_mime);
+        if (!b_xplaystream)
+            answer->i_body_offset = 0;
+    } else if (!b_has_content_type)
+        httpd_MsgAdd(answer, "Content-type", "%s", stream->psz_mime);
 
-        if (!b_has_cache_control)
-            httpd_MsgAdd(answer, "Cache-Control", "no-cache");
+    if (!b_has_cache_control)
+        httpd_MsgAdd(answer, "Cache-Control", "no-cache");
 
-        httpd_MsgAdd(answer, "Connection", "close");
+    httpd_MsgAdd(answer, "Connection", "close");
 
-        return VLC_SUCCESS;
-    }
+    return VLC_SUCCESS;
 }
 
 httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
@@ -891,6 +914,7 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
     httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
 
     vlc_mutex_unlock(&stream->lock);
+    httpd_HostWake(stream->url->host);
     return VLC_SUCCESS;
 }
 
@@ -911,15 +935,25 @@ void httpd_StreamDelete(httpd_stream_t *stream)
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread(void *);
+static void* httpd_WorkerThread(void *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                       const char *, vlc_tls_server_t *,
-                                      unsigned);
+                                      unsigned, unsigned);
+
+static unsigned httpd_ThreadCount(vlc_object_t *obj)
+{
+    unsigned count = var_InheritInteger(obj, "http-threads");
+
+    if (count == 0)
+        count = __MIN(vlc_GetCPUCount(), 8);
+    return count;
+}
 
 /* create a new host */
 httpd_host_t *vlc_http_HostNew(vlc_object_t *p_this)
 {
-    return httpd_HostCreate(p_this, "http-host", "http-port", NULL, 10);
+    return httpd_HostCreate(p_this, "http-host", "http-port", NULL, 10,
+                            httpd_ThreadCount(p_this));
 }
 
 httpd_host_t *vlc_https_HostNew(vlc_object_t *obj)
@@ -943,13 +977,14 @@ httpd_host_t *vlc_https_HostNew(vlc_object_t *obj)
     free(key);
     free(cert);
 
-    return httpd_HostCreate(obj, "http-host", "https-port", tls, 10);
+    return httpd_HostCreate(obj, "http-host", "https-port", tls, 10,
+                            httpd_ThreadCount(obj));
 }
 
 httpd_host_t *vlc_rtsp_HostNew(vlc_object_t *p_this)
 {
     unsigned timeout = var_InheritInteger(p_this, "rtsp-timeout");
-    return httpd_HostCreate(p_this, "rtsp-host", "rtsp-port", NULL, timeout);
+    return httpd_HostCreate(p_this, "rtsp-host", "rtsp-port", NULL, timeout, 1);
 }
 
 static struct httpd
@@ -958,11 +993,96 @@ static struct httpd
     struct vlc_list hosts;
 } httpd = { VLC_STATIC_MUTEX, VLC_LIST_INITIALIZER(&httpd.hosts) };
 
+static int httpd_WorkerInit(httpd_worker_t *w, httpd_host_t *host)
+{
+    w->host = host;
+    vlc_mutex_init(&w->lock);
+    w->client_count = 0;
+    vlc_list_init(&w->clients);
+    vlc_list_init(&w->ready);
+    vlc_list_init(&w->waiting);
+    atomic_init(&w->woken, false);
+    w->timeout_check = VLC_TICK_INVALID;
+
+    /* Without a wake up socket, waiting clients are polled */
+#ifndef _WIN32
+    if (vlc_socketpair(AF_LOCAL, SOCK_STREAM, 0, w->wakefd, true))
+#endif
+        w->wakefd[0] = w->wakefd[1] = -1;
+
+#ifdef HTTPD_USE_EPOLL
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->epfd == -1)
+        goto error;
+
+    for (unsigned i = 0; i < host->nfd; i++) {
+        /* only wake one worker up per connection */
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = host };
+# ifdef EPOLLEXCLUSIVE
+        ev.events |= EPOLLEXCLUSIVE;
+# endif
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error;
+    }
+
+    if (w->wakefd[0] != -1) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = w };
+
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wakefd[0], &ev))
+            goto error;
+    }
+#endif
+    return 0;
+
+#ifdef HTTPD_USE_EPOLL
+error:
+    msg_Err(host, "cannot create HTTP poller: %s", vlc_strerror_c(errno));
+    if (w->epfd != -1)
+        vlc_close(w->epfd);
+    if (w->wakefd[0] != -1) {
+        vlc_close(w->wakefd[1]);
+        vlc_close(w->wakefd[0]);
+    }
+    return -1;
+#endif
+}
+
+static void httpd_WorkerClean(httpd_worker_t *w)
+{
+    httpd_client_t *client;
+
+    vlc_list_foreach(client, &w->clients, node) {
+        msg_Warn(w->host, "client still connected");
+        httpd_ClientDestroy(client);
+    }
+
+#ifdef HTTPD_USE_EPOLL
+    vlc_close(w->epfd);
+#endif
+    if (w->wakefd[0] != -1) {
+        vlc_close(w->wakefd[1]);
+        vlc_close(w->wakefd[0]);
+    }
+}
+
+/* Wakes up the workers with clients waiting for stream data */
+static void httpd_HostWake(httpd_host_t *host)
+{
+    for (unsigned i = 0; i < host->nworkers; i++) {
+        httpd_worker_t *w = &host->workers[i];
+
+        if (w->wakefd[1] != -1
+         && !atomic_exchange_explicit(&w->woken, true, memory_order_acq_rel))
+            vlc_send(w->wakefd[1], "", 1, 0);
+    }
+}
+
 static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                        const char *hostvar,
                                        const char *portvar,
                                        vlc_tls_server_t *p_tls,
-                                       unsigned timeout_sec)
+                                       unsigned timeout_sec,
+                                       unsigned nworkers)
 {
     httpd_host_t *host;
     unsigned port = var_InheritInteger(p_this, portvar);
@@ -993,6 +1113,8 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     vlc_mutex_init(&host->lock);
     atomic_init(&host->ref, 1);
+    host->nworkers = 0;
+    host->workers = NULL;
 
     char *hostname = var_InheritString(p_this, hostvar);
 
@@ -1007,16 +1129,27 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     host->port     = port;
     vlc_list_init(&host->urls);
-    host->client_count = 0;
-    vlc_list_init(&host->clients);
     host->timeout_sec = timeout_sec;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+    host->workers = vlc_alloc(nworkers, sizeof (*host->workers));
+    if (unlikely(host->workers == NULL))
         goto error;
+
+    /* create the threads */
+    while (host->nworkers < nworkers) {
+        httpd_worker_t *w = &host->workers[host->nworkers];
+
+        if (httpd_WorkerInit(w, host))
+            goto error;
+        if (vlc_clone(&w->thread, httpd_WorkerThread, w)) {
+            msg_Err(p_this, "cannot spawn http host thread");
+            httpd_WorkerClean(w);
+            goto error;
+        }
+        host->nworkers++;
     }
+    msg_Dbg(host, "HTTP host running %u thread(s)", nworkers);
 
     /* now add it to httpd */
     vlc_list_append(&host->node, &httpd.hosts);
@@ -1028,6 +1161,12 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        for (unsigned i = 0; i < host->nworkers; i++) {
+            vlc_cancel(host->workers[i].thread);
+            vlc_join(host->workers[i].thread, NULL);
+            httpd_WorkerClean(&host->workers[i]);
+        }
+        free(host->workers);
         net_ListenClose(host->fds);
         vlc_object_delete(host);
     }
@@ -1039,8 +1178,6 @@ error:
 /* delete a host */
 void httpd_HostDelete(httpd_host_t *host)
 {
-    httpd_client_t *client;
-
     vlc_mutex_lock(&httpd.mutex);
 
     if (atomic_fetch_sub_explicit(&host->ref, 1, memory_order_relaxed) > 1) {
@@ -1051,15 +1188,16 @@ void httpd_HostDelete(httpd_host_t *host)
     }
 
     vlc_list_remove(&host->node);
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->nworkers; i++)
+        vlc_cancel(host->workers[i].thread);
+    for (unsigned i = 0; i < host->nworkers; i++)
+        vlc_join(host->workers[i].thread, NULL);
 
     msg_Dbg(host, "HTTP host removed");
 
-    vlc_list_foreach(client, &host->clients, node) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(client);
-    }
+    for (unsigned i = 0; i < host->nworkers; i++)
+        httpd_WorkerClean(&host->workers[i]);
+    free(host->workers);
 
     assert(vlc_list_is_empty(&host->urls));
     vlc_tls_ServerDelete(host->p_tls);
@@ -1148,22 +1286,51 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     vlc_list_remove(&url->node);
+    vlc_mutex_unlock(&host->lock);
 
-    free(url->psz_url);
-    free(url->psz_user);
-    free(url->psz_password);
+    /* The clients are destroyed by their worker, but must not use the url
+     * anymore. */
+    for (unsigned i = 0; i < host->nworkers; i++) {
+        httpd_worker_t *w = &host->workers[i];
+        bool wake = false;
 
-    vlc_list_foreach(client, &host->clients, node) {
-        if (client->url != url)
-            continue;
+        vlc_mutex_lock(&w->lock);
+        vlc_list_foreach(client, &w->clients, node) {
+            if (client->url != url)
+                continue;
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        host->client_count--;
-        httpd_ClientDestroy(client);
+            if (client->i_state == HTTPD_CLIENT_SENDING
+             && !client->b_stream_mode && client->answer.i_body_offset == 0) {
+                /* the answer does not need the url anymore: let it end */
+                client->url = NULL;
+                continue;
+            }
+
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+            httpd_ClientSchedule(client, HTTPD_CLIENT_READY);
+            wake = true;
+        }
+        vlc_mutex_unlock(&w->lock);
+
+        if (wake && w->wakefd[1] != -1)
+            vlc_send(w->wakefd[1], "", 1, 0);
     }
+    /* the requests deferred by the url get their 404 without delay */
+    httpd_HostWake(host);
+
+    free(url->psz_url);
+    free(url->psz_user);
+    free(url->psz_password);
     free(url);
-    vlc_mutex_unlock(&host->lock);
+}
+
+void httpd_UrlSignal(httpd_url_t *url)
+{
+    /* the deferred requests are retried along with the waiting streams */
+    httpd_HostWake(url->host);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1184,6 +1351,7 @@ static void httpd_MsgInit(httpd_message_t *msg)
     msg->i_body_offset = 0;
     msg->i_body        = 0;
     msg->p_body        = NULL;
+    msg->p_body_block  = NULL;
 }
 
 static void httpd_MsgClean(httpd_message_t *msg)
@@ -1195,7 +1363,10 @@ static void httpd_MsgClean(httpd_message_t *msg)
         free(msg->p_headers[i].value);
     }
     free(msg->p_headers);
-    free(msg->p_body);
+    if (msg->p_body_block != NULL)
+        block_Release(msg->p_body_block);
+    else
+        free(msg->p_body);
     httpd_MsgInit(msg);
 }
 
@@ -1245,41 +1416,136 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(vlc_tls_GetFD(cl->sock), ip, port) ? NULL : ip;
 }
 
+static void httpd_ClientFreeBuffer(httpd_client_t *cl)
+{
+    if (cl->p_buffer_block != NULL) {
+        block_Release(cl->p_buffer_block);
+        cl->p_buffer_block = NULL;
+    } else
+        free(cl->p_buffer);
+    cl->p_buffer = NULL;
+}
+
+/* Moves the answer body to the send buffer, without copying it */
+static void httpd_ClientTakeBody(httpd_client_t *cl)
+{
+    httpd_ClientFreeBuffer(cl);
+    cl->p_buffer = cl->answer.p_body;
+    cl->p_buffer_block = cl->answer.p_body_block;
+    cl->i_buffer_size = cl->answer.i_body;
+
+    cl->answer.i_body = 0;
+    cl->answer.p_body = NULL;
+    cl->answer.p_body_block = NULL;
+}
+
 static void httpd_ClientDestroy(httpd_client_t *cl)
 {
+    httpd_worker_t *w = cl->worker;
+
+#ifdef HTTPD_USE_EPOLL
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, vlc_tls_GetFD(cl->sock), NULL);
+#endif
+    httpd_ClientSchedule(cl, HTTPD_CLIENT_POLLED);
+    w->client_count--;
     vlc_list_remove(&cl->node);
     vlc_tls_Close(cl->sock);
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
-    free(cl->p_buffer);
+    free(cl->p_recv);
+    httpd_ClientFreeBuffer(cl);
     free(cl);
 }
 
-static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock)
+static httpd_client_t *httpd_ClientNew(httpd_worker_t *w, vlc_tls_t *sock)
 {
     httpd_client_t *cl = malloc(sizeof(httpd_client_t));
 
     if (!cl) return NULL;
 
     cl->sock    = sock;
+    cl->worker  = w;
     cl->url     = NULL;
+    cl->stream  = NULL;
     cl->i_state = HTTPD_CLIENT_RECEIVING;
+    cl->i_sched = HTTPD_CLIENT_POLLED;
+    cl->i_events = 0;
+    cl->i_revents = 0;
+    cl->i_defer_date = VLC_TICK_INVALID;
     cl->i_buffer_size = HTTPD_CL_BUFSIZE;
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc(cl->i_buffer_size);
+    cl->p_buffer_block = NULL;
+    cl->p_recv = NULL;
+    cl->i_recv = 0;
+    cl->i_recv_pos = 0;
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
 
+#ifdef HTTPD_USE_EPOLL
+    struct epoll_event ev = { .events = 0, .data.ptr = cl };
+
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, vlc_tls_GetFD(sock), &ev)) {
+        free(cl->p_buffer);
+        free(cl);
+        return NULL;
+    }
+#endif
+
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
+    w->client_count++;
+    vlc_list_append(&cl->node, &w->clients);
     return cl;
 }
 
+/* Moves a client to the ready or waiting list, or neither */
+static void httpd_ClientSchedule(httpd_client_t *cl, uint8_t sched)
+{
+    httpd_worker_t *w = cl->worker;
+
+    if (cl->i_sched == sched)
+        return;
+    if (cl->i_sched != HTTPD_CLIENT_POLLED)
+        vlc_list_remove(&cl->sched_node);
+    if (sched == HTTPD_CLIENT_READY)
+        vlc_list_append(&cl->sched_node, &w->ready);
+    else if (sched == HTTPD_CLIENT_PARKED)
+        vlc_list_append(&cl->sched_node, &w->waiting);
+    cl->i_sched = sched;
+}
+
 static
 ssize_t httpd_NetRecv (httpd_client_t *cl, uint8_t *p, size_t i_len)
 {
     vlc_tls_t *sock = cl->sock;
+
+    if (cl->i_recv_pos == cl->i_recv && i_len < HTTPD_RECV_BUFSIZE) {
+        /* refill the read-ahead buffer */
+        if (cl->p_recv == NULL) {
+            cl->p_recv = malloc(HTTPD_RECV_BUFSIZE);
+            if (unlikely(cl->p_recv == NULL))
+                return -1;
+        }
+
+        struct iovec iov = { .iov_base = cl->p_recv,
+                             .iov_len = HTTPD_RECV_BUFSIZE };
+        ssize_t val = sock->ops->readv(sock, &iov, 1);
+        if (val <= 0)
+            return val;
+        cl->i_recv = val;
+        cl->i_recv_pos = 0;
+    }
+
+    if (cl->i_recv_pos < cl->i_recv) {
+        size_t copy = __MIN(i_len, cl->i_recv - cl->i_recv_pos);
+
+        memcpy(p, cl->p_recv + cl->i_recv_pos, copy);
+        cl->i_recv_pos += copy;
+        return copy;
+    }
+
     struct iovec iov = { .iov_base = p, .iov_len = i_len };
     return sock->ops->readv(sock, &iov, 1);
 }
@@ -1566,9 +1832,10 @@ static int httpd_ClientRecv(httpd_client_t *cl)
                     }
                     i_len = 0; /* drop */
                 }
-                break;
             } else
                 cl->i_state = HTTPD_CLIENT_RECEIVE_DONE;
+            /* leave any pipelined request in the read-ahead buffer */
+            break;
         }
     }
 
@@ -1615,9 +1882,9 @@ static int httpd_ClientSend(httpd_client_t *cl)
             i_size += strlen(cl->answer.p_headers[i].name) + 2 +
                       strlen(cl->answer.p_headers[i].value) + 2;
 
-        if (cl->i_buffer_size < i_size) {
+        if (cl->i_buffer_size < i_size || cl->p_buffer_block != NULL) {
             cl->i_buffer_size = i_size;
-            free(cl->p_buffer);
+            httpd_ClientFreeBuffer(cl);
             cl->p_buffer = xmalloc(i_size);
         }
         p = (char *)cl->p_buffer;
@@ -1635,8 +1902,24 @@ static int httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
+    if (cl->answer.i_body > 0) {
+        /* send the end of the header along with the body */
+        vlc_tls_t *sock = cl->sock;
+        size_t i_header = cl->i_buffer_size - cl->i_buffer;
+        struct iovec iov[2] = {
+            { .iov_base = &cl->p_buffer[cl->i_buffer], .iov_len = i_header },
+            { .iov_base = cl->answer.p_body, .iov_len = cl->answer.i_body },
+        };
+
+        i_len = sock->ops->writev(sock, iov, 2);
+        if (i_len > 0 && (size_t)i_len > i_header) {
+            httpd_ClientTakeBody(cl);
+            cl->i_buffer = i_len - i_header;
+            i_len = 0;
+        }
+    } else
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
 
     if (i_len < 0) {
 #if defined(_WIN32)
@@ -1654,7 +1937,8 @@ static int httpd_ClientSend(httpd_client_t *cl)
     cl->i_buffer += i_len;
 
     if (cl->i_buffer >= cl->i_buffer_size) {
-        if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+        if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0
+         && cl->stream == NULL) {
             /* catch more body data */
             int64_t i_offset = cl->answer.i_body_offset;
 
@@ -1666,13 +1950,8 @@ static int httpd_ClientSend(httpd_client_t *cl)
 
         if (cl->answer.i_body != 0) {
             /* send the body data */
-            free(cl->p_buffer);
-            cl->p_buffer = cl->answer.p_body;
-            cl->i_buffer_size = cl->answer.i_body;
+            httpd_ClientTakeBody(cl);
             cl->i_buffer = 0;
-
-            cl->answer.i_body = 0;
-            cl->answer.p_body = NULL;
         } else /* send finished */
             cl->i_state = HTTPD_CLIENT_SEND_DONE;
     }
@@ -1730,24 +2009,320 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Handles a complete request */
+static void httpd_ClientRequest(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->client_count];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
+    httpd_message_t *answer = &cl->answer;
+    httpd_message_t *query  = &cl->query;
+
+    httpd_MsgInit(answer);
+
+    /* Handle what we received */
+    switch (query->i_type) {
+        case HTTPD_MSG_ANSWER:
+            cl->url     = NULL;
+            cl->i_state = HTTPD_CLIENT_DEAD;
+            break;
+
+        case HTTPD_MSG_OPTIONS:
+            answer->i_type   = HTTPD_MSG_ANSWER;
+            answer->i_proto  = query->i_proto;
+            answer->i_status = 200;
+            answer->i_body = 0;
+            answer->p_body = NULL;
+
+            httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+            httpd_MsgAdd(answer, "Content-Length", "0");
+
+            switch(query->i_proto) {
+            case HTTPD_PROTO_HTTP:
+                answer->i_version = 1;
+                httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                break;
+
+            case HTTPD_PROTO_RTSP:
+                answer->i_version = 0;
+
+                const char *p = httpd_MsgGet(query, "Cseq");
+                if (p)
+                    httpd_MsgAdd(answer, "Cseq", "%s", p);
+                p = httpd_MsgGet(query, "Timestamp");
+                if (p)
+                    httpd_MsgAdd(answer, "Timestamp", "%s", p);
+
+                p = httpd_MsgGet(query, "Require");
+                if (p) {
+                    answer->i_status = 551;
+                    httpd_MsgAdd(query, "Unsupported", "%s", p);
+                }
+
+                httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                        "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                break;
+            }
+
+            if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                httpd_MsgAdd(answer, "Connection", "close");
+
+            cl->i_buffer = -1;  /* Force the creation of the answer in
+                                 * httpd_ClientSend */
+            cl->i_state = HTTPD_CLIENT_SENDING;
+            break;
+
+        case HTTPD_MSG_NONE:
+            if (query->i_proto == HTTPD_PROTO_NONE) {
+                cl->url = NULL;
+                cl->i_state = HTTPD_CLIENT_DEAD;
+            } else {
+                /* unimplemented */
+                answer->i_proto  = query->i_proto ;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
+                answer->i_status = 501;
+
+                char *p;
+                answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                answer->p_body = (uint8_t *)p;
+                httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
+                httpd_MsgAdd(answer, "Connection", "close");
+
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+            break;
+
+        default: {
+            httpd_url_t *url;
+            bool b_auth_failed = false;
+            bool b_deferred = false;
+
+            /* Search the url and trigger callbacks */
+            vlc_mutex_lock(&host->lock);
+            vlc_list_foreach(url, &host->urls, node) {
+                if (strcmp(url->psz_url, query->psz_url))
+                    continue;
+
+                if (answer) {
+                    b_auth_failed = !httpdAuthOk(url->psz_user,
+                       url->psz_password,
+                       httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                    if (b_auth_failed)
+                       break;
+                }
+
+                int status = httpd_UrlCatchCall(url, cl);
+                if (status == VLC_EAGAIN) {
+                    b_deferred = true;
+                    break;
+                }
+                if (status)
+                    continue;
+
+                if (answer->i_proto == HTTPD_PROTO_NONE)
+                    cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                else
+                    cl->i_buffer = -1;
+
+                /* only one url can answer */
+                answer = NULL;
+                if (!cl->url)
+                    cl->url = url;
+            }
+            vlc_mutex_unlock(&host->lock);
+
+            if (b_deferred) {
+                /* retried when the url is signaled, see httpd_ClientRun() */
+                httpd_MsgClean(answer);
+                if (cl->i_defer_date == VLC_TICK_INVALID)
+                    cl->i_defer_date = vlc_tick_now() + HTTPD_DEFER_TIMEOUT;
+                cl->i_state = HTTPD_CLIENT_DEFERRED;
+                return;
+            }
+            cl->i_defer_date = VLC_TICK_INVALID;
+
+            if (answer) {
+                answer->i_proto  = query->i_proto;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
+
+               if (b_auth_failed) {
+                    httpd_MsgAdd(answer, "WWW-Authenticate",
+                            "Basic realm=\"VLC stream\"");
+                    answer->i_status = 401;
+                } else
+                    answer->i_status = 404; /* no url registered */
+
+                char *p;
+                answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                        query->psz_url);
+                answer->p_body = (uint8_t *)p;
+
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
+                httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+                if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                    httpd_MsgAdd(answer, "Connection", "close");
+            }
+
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
     }
+}
 
-    vlc_mutex_lock(&host->lock);
-    /* add all socket that should be read/write and close dead connection */
-    vlc_tick_t now = vlc_tick_now();
-    int delay = -1;
-    httpd_client_t *cl;
+/* Answers a deferred request that the url could not answer in time */
+static void httpd_ClientDeferTimeout(httpd_client_t *cl)
+{
+    httpd_message_t *answer = &cl->answer;
+    const httpd_message_t *query = &cl->query;
+    char *p;
 
-    int canc = vlc_savecancel();
-    vlc_list_foreach(cl, &host->clients, node) {
+    answer->i_proto  = query->i_proto;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_version= 0;
+    answer->i_status = 503;
+    answer->i_body = httpd_HtmlError (&p, 503, query->psz_url);
+    answer->p_body = (uint8_t *)p;
+    httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
+    httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+    if (httpd_MsgGet(query, "Connection") != NULL)
+        httpd_MsgAdd(answer, "Connection", "close");
+
+    cl->i_defer_date = VLC_TICK_INVALID;
+    cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+    cl->i_state = HTTPD_CLIENT_SENDING;
+}
+
+/* Prepares for the next request, or for streaming */
+static void httpd_ClientSendDone(httpd_client_t *cl)
+{
+    if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+        bool do_close = false;
+
+        cl->url = NULL;
+        cl->stream = NULL;
+
+        if (cl->query.i_proto != HTTPD_PROTO_HTTP
+         || cl->query.i_version > 0)
+        {
+            const char *psz_connection = httpd_MsgGet(&cl->answer,
+                                                     "Connection");
+            if (psz_connection != NULL)
+                do_close = !strcasecmp(psz_connection, "close");
+        }
+        else
+            do_close = true;
+
+        if (!do_close) {
+            httpd_MsgClean(&cl->query);
+            httpd_MsgInit(&cl->query);
+
+            cl->i_buffer = 0;
+            cl->i_buffer_size = 1000;
+            httpd_ClientFreeBuffer(cl);
+            // Allocate an extra byte for the null terminating byte
+            cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
+            cl->i_state = HTTPD_CLIENT_RECEIVING;
+        } else
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        httpd_MsgClean(&cl->answer);
+    } else {
+        int64_t i_offset = cl->answer.i_body_offset;
+        httpd_MsgClean(&cl->answer);
+
+        cl->answer.i_body_offset = i_offset;
+        httpd_ClientFreeBuffer(cl);
+        cl->i_buffer = 0;
+        cl->i_buffer_size = 0;
+
+        cl->i_state = HTTPD_CLIENT_STREAMING;
+    }
+}
+
+/* Sends stream data straight from the circular buffer of the stream */
+static int httpd_ClientStream(httpd_client_t *cl)
+{
+    httpd_stream_t *stream = cl->stream;
+    int64_t i_offset = cl->answer.i_body_offset;
+    ssize_t i_len;
+
+    vlc_mutex_lock(&stream->lock);
+    if (cl->i_keyframe_wait_to_pass >= 0) {
+        if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            goto wait; /* still waiting for the next keyframe */
+
+        /* seek to the new keyframe */
+        i_offset = stream->i_last_keyframe_seen_pos;
+        cl->i_keyframe_wait_to_pass = -1;
+    }
+
+    if (i_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        i_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+
+    if (i_offset >= stream->i_buffer_pos)
+        goto wait; /* no data available */
+
+    /* The data can wrap around the end of the buffer */
+    size_t i_pos = i_offset % stream->i_buffer_size;
+    size_t i_avail = stream->i_buffer_pos - i_offset;
+    size_t i_first = __MIN(i_avail, stream->i_buffer_size - i_pos);
+    struct iovec iov[2] = {
+        { .iov_base = &stream->p_buffer[i_pos], .iov_len = i_first },
+        { .iov_base = stream->p_buffer, .iov_len = i_avail - i_first },
+    };
+
+    i_len = cl->sock->ops->writev(cl->sock, iov, (i_avail > i_first) ? 2 : 1);
+    vlc_mutex_unlock(&stream->lock);
+
+    if (i_len < 0) {
+        cl->answer.i_body_offset = i_offset;
+#if defined(_WIN32)
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+        if (errno == EAGAIN)
+#endif
+            return -1;
+
+        cl->i_state = HTTPD_CLIENT_DEAD;
+        return 0;
+    }
+
+    cl->answer.i_body_offset = i_offset + i_len;
+    return 0;
+
+wait:
+    vlc_mutex_unlock(&stream->lock);
+    cl->answer.i_body_offset = i_offset;
+    cl->i_state = HTTPD_CLIENT_WAITING;
+    return -1;
+}
+
+/* Runs a client until it would block */
+static void httpd_ClientRun(httpd_worker_t *w, httpd_client_t *cl,
+                            vlc_tick_t now)
+{
+    httpd_host_t *host = w->host;
+
+    if (cl->i_state == HTTPD_CLIENT_WAITING) {
+        /* woken up by the stream */
+        if (cl->i_revents & (POLLHUP|POLLERR))
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        else
+            cl->i_state = HTTPD_CLIENT_STREAMING;
+    } else if (cl->i_state == HTTPD_CLIENT_DEFERRED) {
+        /* woken up by the url, or by the deadline */
+        if (cl->i_revents & (POLLHUP|POLLERR))
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        else if (now >= cl->i_defer_date)
+            httpd_ClientDeferTimeout(cl);
+        else
+            cl->i_state = HTTPD_CLIENT_RECEIVE_DONE;
+        /* the client was waiting for us, not idle */
+        cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
+    }
+    cl->i_revents = 0;
+
+    for (unsigned budget = HTTPD_CLIENT_BUDGET;;) {
+        uint8_t i_state = cl->i_state;
         int val = -1;
 
         switch (cl->i_state) {
@@ -1757,6 +2332,9 @@ static void httpdLoop(httpd_host_t *host)
             case HTTPD_CLIENT_SENDING:
                 val = httpd_ClientSend(cl);
                 break;
+            case HTTPD_CLIENT_STREAMING:
+                val = httpd_ClientStream(cl);
+                break;
             case HTTPD_CLIENT_TLS_HS_IN:
             case HTTPD_CLIENT_TLS_HS_OUT:
                 httpd_ClientTlsHandshake(host, cl);
@@ -1765,328 +2343,314 @@ static void httpdLoop(httpd_host_t *host)
 
         if (cl->i_state == HTTPD_CLIENT_DEAD
          || (host->timeout_sec > 0 && cl->i_timeout_date < now)) {
-            host->client_count--;
             httpd_ClientDestroy(cl);
-            continue;
+            return;
         }
 
-        if (val == 0) {
+        if (val == 0)
             cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
-            delay = 0;
+
+        switch (cl->i_state) {
+            case HTTPD_CLIENT_RECEIVE_DONE:
+                httpd_ClientRequest(host, cl);
+                break;
+            case HTTPD_CLIENT_SEND_DONE:
+                httpd_ClientSendDone(cl);
+                break;
         }
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + ARRAY_SIZE (ufd));
+        if (cl->i_state == HTTPD_CLIENT_WAITING
+         || cl->i_state == HTTPD_CLIENT_DEFERRED)
+            break; /* until the stream gets more data or the url is ready */
+        if (val != 0 && cl->i_state == i_state)
+            break; /* would block */
 
-        pufd->events = pufd->revents = 0;
+        if (--budget == 0) {
+            /* let the other clients run first */
+            httpd_ClientSchedule(cl, HTTPD_CLIENT_READY);
+            return;
+        }
+    }
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+    short events = 0;
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            events = POLLIN;
+            break;
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_STREAMING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            events = POLLOUT;
+            break;
+    }
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+    if (cl->i_state == HTTPD_CLIENT_WAITING
+     || cl->i_state == HTTPD_CLIENT_DEFERRED)
+        httpd_ClientSchedule(cl, HTTPD_CLIENT_PARKED);
+    else {
+        vlc_tls_GetPollFD(cl->sock, &events);
+        httpd_ClientSchedule(cl, HTTPD_CLIENT_POLLED);
+    }
 
-                httpd_MsgInit(answer);
+#ifdef HTTPD_USE_EPOLL
+    if (events != cl->i_events) {
+        struct epoll_event ev = { .data.ptr = cl };
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
+        if (events & POLLIN)
+            ev.events |= EPOLLIN;
+        if (events & POLLOUT)
+            ev.events |= EPOLLOUT;
+        epoll_ctl(w->epfd, EPOLL_CTL_MOD, vlc_tls_GetFD(cl->sock), &ev);
+    }
+#endif
+    cl->i_events = events;
+}
 
-                    case HTTPD_MSG_OPTIONS:
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+static void httpd_WorkerAccept(httpd_worker_t *w, vlc_tick_t now)
+{
+    httpd_host_t *host = w->host;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+    for (unsigned i = 0; i < host->nfd; i++) {
+        for (;;) {
+            int fd = vlc_accept(host->fds[i], NULL, NULL, true);
+            if (fd == -1)
+                break;
+            setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+                    &(int){ 1 }, sizeof(int));
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+            vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+            if (unlikely(sk == NULL))
+            {
+                vlc_close(fd);
+                continue;
+            }
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+            if (host->p_tls != NULL)
+            {
+                const char *alpn[] = { "http/1.1", NULL };
+                vlc_tls_t *tls;
+
+                tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+                if (tls == NULL)
+                {
+                    vlc_tls_SessionDelete(sk);
+                    continue;
+                }
+                sk = tls;
+            }
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+            httpd_client_t *cl = httpd_ClientNew(w, sk);
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+            if (unlikely(cl == NULL))
+            {
+                vlc_tls_Close(sk);
+                continue;
+            }
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
-                        }
+            if (host->p_tls != NULL)
+                cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
 
-                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                            httpd_MsgAdd(answer, "Connection", "close");
+            cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
+            httpd_ClientSchedule(cl, HTTPD_CLIENT_READY);
+        }
+    }
+}
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
+/* Moves the waiting stream and deferred clients to the ready list */
+static void httpd_WorkerWake(httpd_worker_t *w)
+{
+    httpd_client_t *cl;
+    char buf[64];
 
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
-                            httpd_MsgAdd(answer, "Connection", "close");
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+    if (w->wakefd[0] != -1) {
+        atomic_store_explicit(&w->woken, false, memory_order_release);
+        while (recv(w->wakefd[0], buf, sizeof (buf), 0) > 0);
+    }
 
-                    default: {
-                        httpd_url_t *url;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        vlc_list_foreach(url, &host->urls, node) {
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (httpd_UrlCatchCall(url, cl))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+    vlc_list_foreach(cl, &w->waiting, sched_node)
+        httpd_ClientSchedule(cl, HTTPD_CLIENT_READY);
+}
 
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                            if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                                httpd_MsgAdd(answer, "Connection", "close");
-                        }
+/* Returns how long to wait for events */
+static int httpd_WorkerTimeout(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
-                }
-                break;
-            }
+    if (!vlc_list_is_empty(&w->ready))
+        return 0;
+    /* without a wake up socket, poll the streams */
+    if (w->wakefd[0] == -1)
+        return 20;
+    /* check the idle clients and the deferred requests deadlines */
+    if (w->client_count > 0
+     && (host->timeout_sec > 0 || !vlc_list_is_empty(&w->waiting)))
+        return 1000;
+    return -1;
+}
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    bool do_close = false;
-
-                    cl->url = NULL;
-
-                    if (cl->query.i_proto != HTTPD_PROTO_HTTP
-                     || cl->query.i_version > 0)
-                    {
-                        const char *psz_connection = httpd_MsgGet(&cl->answer,
-                                                                 "Connection");
-                        if (psz_connection != NULL)
-                            do_close = !strcasecmp(psz_connection, "close");
-                    }
-                    else
-                        do_close = true;
-
-                    if (!do_close) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        // Allocate an extra byte for the null terminating byte
-                        cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    int64_t i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+static void httpd_WorkerRun(httpd_worker_t *w, vlc_tick_t now)
+{
+    httpd_host_t *host = w->host;
+    httpd_client_t *cl;
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+    if (w->wakefd[0] == -1)
+        httpd_WorkerWake(w);
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                break;
+    /* clients scheduled while running go to the next round */
+    struct vlc_list ready;
+    vlc_list_init(&ready);
+    vlc_list_foreach(cl, &w->ready, sched_node) {
+        vlc_list_remove(&cl->sched_node);
+        vlc_list_append(&cl->sched_node, &ready);
+    }
+    vlc_list_foreach(cl, &ready, sched_node) {
+        vlc_list_remove(&cl->sched_node);
+        cl->i_sched = HTTPD_CLIENT_POLLED;
+        httpd_ClientRun(w, cl, now);
+    }
 
-            case HTTPD_CLIENT_WAITING: {
-                int64_t i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
-
-                httpd_MsgInit(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
-
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
-            }
+    /* drop the idle clients and expire the deferred requests, once a
+     * second */
+    if ((host->timeout_sec > 0 || !vlc_list_is_empty(&w->waiting))
+     && now >= w->timeout_check) {
+        vlc_list_foreach(cl, &w->clients, node) {
+            /* deferred requests are answered by their own deadline */
+            if (cl->i_state == HTTPD_CLIENT_DEFERRED) {
+                if (cl->i_defer_date <= now)
+                    httpd_ClientSchedule(cl, HTTPD_CLIENT_READY);
+            } else if (host->timeout_sec > 0 && cl->i_timeout_date < now)
+                httpd_ClientDestroy(cl);
         }
+        w->timeout_check = now + VLC_TICK_FROM_SEC(1);
+    }
+}
 
-        pufd->fd = vlc_tls_GetPollFD(cl->sock, &pufd->events);
+#ifdef HTTPD_USE_EPOLL
+static void httpd_WorkerLoop(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
+    struct epoll_event events[64];
 
-        if (pufd->events != 0)
-            nfd++;
-        /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-        else if (delay != 0)
-            delay = 20;
-    }
-    vlc_mutex_unlock(&host->lock);
-    vlc_restorecancel(canc);
+    vlc_mutex_lock(&w->lock);
+    int timeout = httpd_WorkerTimeout(w);
+    vlc_mutex_unlock(&w->lock);
 
-    while (poll(ufd, nfd, delay) < 0)
-    {
+    int n = epoll_wait(w->epfd, events, ARRAY_SIZE(events), timeout);
+    if (n < 0) {
         if (errno != EINTR)
             msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+        n = 0;
     }
 
-    canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&w->lock);
+    vlc_tick_t now = vlc_tick_now();
 
-    /* Handle client sockets */
-    now = vlc_tick_now();
-    nfd = host->nfd;
+    for (int i = 0; i < n; i++) {
+        void *data = events[i].data.ptr;
+
+        if (data == host)
+            httpd_WorkerAccept(w, now);
+        else if (data == w)
+            httpd_WorkerWake(w);
+        else {
+            httpd_client_t *cl = data;
+
+            if (events[i].events & EPOLLIN)
+                cl->i_revents |= POLLIN;
+            if (events[i].events & EPOLLOUT)
+                cl->i_revents |= POLLOUT;
+            if (events[i].events & EPOLLHUP)
+                cl->i_revents |= POLLHUP;
+            if (events[i].events & EPOLLERR)
+                cl->i_revents |= POLLERR;
+            httpd_ClientSchedule(cl, HTTPD_CLIENT_READY);
+        }
+    }
 
-    /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        int fd = ufd[nfd].fd;
+    httpd_WorkerRun(w, now);
+    vlc_mutex_unlock(&w->lock);
+    vlc_restorecancel(canc);
+}
+#else
+static void httpd_WorkerLoop(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
 
-        assert (fd == host->fds[nfd]);
+    vlc_mutex_lock(&w->lock);
+    struct pollfd ufd[host->nfd + 1 + w->client_count];
+    httpd_client_t *clients[w->client_count + 1];
+    unsigned nfd = 0, ncl = 0;
 
-        if (ufd[nfd].revents == 0)
-            continue;
+    for (unsigned i = 0; i < host->nfd; i++) {
+        ufd[nfd].fd = host->fds[i];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd++].revents = 0;
+    }
+    if (w->wakefd[0] != -1) {
+        ufd[nfd].fd = w->wakefd[0];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd++].revents = 0;
+    }
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+    const unsigned nlisten = nfd;
+    httpd_client_t *cl;
 
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
+    vlc_list_foreach(cl, &w->clients, node) {
+        if (cl->i_sched != HTTPD_CLIENT_POLLED || cl->i_events == 0)
             continue;
-        }
+        ufd[nfd].fd = vlc_tls_GetFD(cl->sock);
+        ufd[nfd].events = cl->i_events;
+        ufd[nfd++].revents = 0;
+        clients[ncl++] = cl;
+    }
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
+    int timeout = httpd_WorkerTimeout(w);
+    vlc_mutex_unlock(&w->lock);
 
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
-        }
+    while (poll(ufd, nfd, timeout) < 0)
+    {
+        if (errno != EINTR)
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+    }
 
-        cl = httpd_ClientNew(sk);
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&w->lock);
+    vlc_tick_t now = vlc_tick_now();
 
-        if (unlikely(cl == NULL))
-        {
-            vlc_tls_Close(sk);
+    for (unsigned i = 0; i < nlisten; i++) {
+        if (ufd[i].revents == 0)
             continue;
-        }
-
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+        if (ufd[i].fd == w->wakefd[0])
+            httpd_WorkerWake(w);
+        else
+            httpd_WorkerAccept(w, now);
+    }
 
-        cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
-        host->client_count++;
-        vlc_list_append(&cl->node, &host->clients);
+    for (unsigned i = 0; i < ncl; i++) {
+        if (ufd[nlisten + i].revents == 0)
+            continue;
+        clients[i]->i_revents = ufd[nlisten + i].revents;
+        httpd_ClientSchedule(clients[i], HTTPD_CLIENT_READY);
     }
 
-    vlc_mutex_unlock(&host->lock);
+    httpd_WorkerRun(w, now);
+    vlc_mutex_unlock(&w->lock);
     vlc_restorecancel(canc);
 }
+#endif
 
-static void* httpd_HostThread(void *data)
+static void* httpd_WorkerThread(void *data)
 {
     vlc_thread_set_name("vlc-httpd");
 
-    httpd_host_t *host = data;
+    httpd_worker_t *w = data;
 
-    while (atomic_load_explicit(&host->ref, memory_order_relaxed) > 0)
-        httpdLoop(host);
-    return NULL;
+    for (;;)
+        httpd_WorkerLoop(w);
+    vlc_assert_unreachable();
 }
 
 int httpd_StreamSetHTTPHeaders(httpd_stream_t * p_stream,
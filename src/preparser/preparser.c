@@ -682,7 +682,13 @@ vlc_preparser_req_id vlc_preparser_Push( vlc_preparser_t *preparser, input_item_
     {
         vlc_preparser_req_id id = PreparserAddTask(preparser, task);
 
-        vlc_executor_Submit(preparser->parser, &task->runnable);
+        /* Requests the user may interact with are user-visible: serve them
+         * before background requests (e.g. media library scans) */
+        enum vlc_executor_priority priority =
+            type_options & VLC_PREPARSER_OPTION_INTERACT
+                ? VLC_EXECUTOR_PRIORITY_HIGH : VLC_EXECUTOR_PRIORITY_NORMAL;
+        vlc_executor_SubmitWithPriority(preparser->parser, &task->runnable,
+                                        priority);
 
         return id;
     }
@@ -0,0 +1,158 @@
+/*****************************************************************************
+ * block_alloc.c: block_t allocation benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_threads.h>
+#include <vlc_tick.h>
+
+/* Total number of allocations per run, split among the threads */
+#define ALLOCS (1 << 19)
+/* Number of blocks each thread keeps alive at any time */
+#define LIVE 64
+
+static const size_t sizes[] = {
+    188, 7 * 188, 1500, 4096, 188, 1316, 16384, 188,
+};
+
+static void check_block(block_t *block, size_t size)
+{
+    assert(block != NULL);
+    assert(block->i_buffer == size);
+    assert(((uintptr_t)block->p_buffer % 16) == 0);
+    assert(block->p_start <= block->p_buffer);
+    assert(block->p_buffer + block->i_buffer
+           <= block->p_start + block->i_size);
+    assert(block->p_next == NULL);
+    assert(block->i_flags == 0);
+    assert(block->i_pts == VLC_TICK_INVALID);
+    memset(block->p_buffer, 0x47, block->i_buffer);
+}
+
+struct worker
+{
+    vlc_thread_t thread;
+    unsigned count;
+};
+
+static void *Worker(void *data)
+{
+    struct worker *worker = data;
+    block_t *live[LIVE] = { NULL };
+
+    for (unsigned i = 0; i < worker->count; i++)
+    {
+        size_t size = sizes[i % ARRAY_SIZE(sizes)];
+        unsigned slot = (i * 7) % LIVE;
+
+        if (live[slot] != NULL)
+            block_Release(live[slot]);
+
+        live[slot] = block_Alloc(size);
+        check_block(live[slot], size);
+        live[slot]->i_flags = BLOCK_FLAG_DISCONTINUITY;
+        live[slot]->i_pts = VLC_TICK_0;
+    }
+
+    for (unsigned i = 0; i < LIVE; i++)
+        if (live[i] != NULL)
+            block_Release(live[i]);
+    return NULL;
+}
+
+static void bench_threads(unsigned threads)
+{
+    struct worker workers[threads];
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < threads; i++)
+    {
+        workers[i].count = ALLOCS / threads;
+        assert(vlc_clone(&workers[i].thread, Worker, &workers[i]) == 0);
+    }
+    for (unsigned i = 0; i < threads; i++)
+        vlc_join(workers[i].thread, NULL);
+
+    double secs = secf_from_vlc_tick(vlc_tick_now() - start);
+
+    printf("%2u thread(s): %10.0f allocs/s\n", threads, ALLOCS / secs);
+}
+
+/* Blocks allocated on one thread and released on another */
+static void *Releaser(void *data)
+{
+    block_t *chain = data;
+
+    while (chain != NULL)
+    {
+        block_t *next = chain->p_next;
+
+        chain->p_next = NULL;
+        block_Release(chain);
+        chain = next;
+    }
+    return NULL;
+}
+
+static void test_cross_thread(void)
+{
+    for (unsigned round = 0; round < 64; round++)
+    {
+        block_t *chain = NULL;
+
+        for (unsigned i = 0; i < 256; i++)
+        {
+            size_t size = sizes[(round + i) % ARRAY_SIZE(sizes)];
+            block_t *block = block_Alloc(size);
+
+            check_block(block, size);
+            block->p_next = chain;
+            chain = block;
+        }
+
+        vlc_thread_t th;
+        assert(vlc_clone(&th, Releaser, chain) == 0);
+        vlc_join(th, NULL);
+    }
+}
+
+int main(void)
+{
+    const char *env = getenv("VLC_FRAME_POOL");
+
+    printf("frame pool: %s\n",
+           (env != NULL && strcmp(env, "0") == 0) ? "disabled" : "default");
+
+    test_cross_thread();
+
+    for (unsigned threads = 1; threads <= 32; threads *= 2)
+        bench_threads(threads);
+    return 0;
+}
@@ -0,0 +1,240 @@
+/*****************************************************************************
+ * block_fifo.c: block FIFO test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_threads.h>
+#include <vlc_tick.h>
+
+/* Number of blocks sent per run */
+#define BLOCKS (1 << 20)
+
+/* The blocks carry their sequence number as DTS, so that the consumer can
+ * check the order. Both consumers run like the decoder thread: they hold the
+ * block_fifo_t lock except while handling a block, and wait on it. */
+
+struct bench
+{
+    block_fifo_t *fifo;
+    vlc_spsc_fifo_t *spsc;
+    unsigned received;
+    bool done;
+};
+
+static void *LockedConsumer(void *data)
+{
+    struct bench *bench = data;
+
+    vlc_fifo_Lock(bench->fifo);
+    for (;;)
+    {
+        block_t *block = vlc_fifo_DequeueUnlocked(bench->fifo);
+
+        if (block == NULL)
+        {
+            if (bench->done)
+                break;
+            vlc_fifo_Wait(bench->fifo);
+            continue;
+        }
+
+        vlc_fifo_Unlock(bench->fifo);
+        assert(block->i_dts == (vlc_tick_t)bench->received);
+        bench->received++;
+        block_Release(block);
+        vlc_fifo_Lock(bench->fifo);
+    }
+    vlc_fifo_Unlock(bench->fifo);
+    return NULL;
+}
+
+static void LockedProduce(struct bench *bench, block_t *block)
+{
+    block_FifoPut(bench->fifo, block);
+}
+
+static void *SPSCConsumer(void *data)
+{
+    struct bench *bench = data;
+
+    vlc_fifo_Lock(bench->fifo);
+    for (;;)
+    {
+        block_t *block = vlc_spsc_fifo_Dequeue(bench->spsc);
+
+        if (block == NULL)
+        {
+            if (bench->done)
+                break;
+            if (vlc_spsc_fifo_Park(bench->spsc))
+            {
+                vlc_fifo_Wait(bench->fifo);
+                vlc_spsc_fifo_Unpark(bench->spsc);
+            }
+            continue;
+        }
+
+        vlc_fifo_Unlock(bench->fifo);
+        assert(block->i_dts == (vlc_tick_t)bench->received);
+        bench->received++;
+        block_Release(block);
+        vlc_fifo_Lock(bench->fifo);
+    }
+    vlc_fifo_Unlock(bench->fifo);
+    return NULL;
+}
+
+static unsigned wakeups;
+
+static void SPSCProduce(struct bench *bench, block_t *block)
+{
+    if (vlc_spsc_fifo_Queue(bench->spsc, block))
+    {
+        vlc_fifo_Lock(bench->fifo);
+        vlc_fifo_Signal(bench->fifo);
+        vlc_fifo_Unlock(bench->fifo);
+        wakeups++;
+    }
+}
+
+static void Bench(const char *name, void *(*consumer)(void *),
+                  void (*produce)(struct bench *, block_t *))
+{
+    struct bench bench = {
+        .fifo = block_FifoNew(),
+        .spsc = vlc_spsc_fifo_New(),
+    };
+    vlc_thread_t th;
+
+    assert(bench.fifo != NULL && bench.spsc != NULL);
+
+    /* Allocate before timing, so as to only measure the queues */
+    block_t **blocks = malloc(BLOCKS * sizeof (*blocks));
+    assert(blocks != NULL);
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        blocks[i] = block_Alloc(188);
+        assert(blocks[i] != NULL);
+        blocks[i]->i_dts = i;
+    }
+
+    wakeups = 0;
+    vlc_tick_t start = vlc_tick_now();
+    assert(vlc_clone(&th, consumer, &bench) == 0);
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+        produce(&bench, blocks[i]);
+
+    vlc_fifo_Lock(bench.fifo);
+    bench.done = true;
+    vlc_fifo_Signal(bench.fifo);
+    vlc_fifo_Unlock(bench.fifo);
+    vlc_join(th, NULL);
+
+    double secs = secf_from_vlc_tick(vlc_tick_now() - start);
+
+    assert(bench.received == BLOCKS);
+    printf("%-8s %10.0f blocks/s", name, BLOCKS / secs);
+    if (produce == SPSCProduce)
+        printf(", %u wake up(s)", wakeups);
+    printf("\n");
+
+    free(blocks);
+    vlc_spsc_fifo_Delete(bench.spsc);
+    block_FifoRelease(bench.fifo);
+}
+
+static void test_spsc(void)
+{
+    vlc_spsc_fifo_t *fifo = vlc_spsc_fifo_New();
+
+    assert(fifo != NULL);
+    assert(vlc_spsc_fifo_Dequeue(fifo) == NULL);
+    assert(vlc_spsc_fifo_GetMark(fifo) == 0);
+
+    /* Parked consumer: only the first block wakes it up */
+    assert(vlc_spsc_fifo_Park(fifo));
+    for (unsigned i = 0; i < 8; i++)
+    {
+        block_t *block = block_Alloc(100);
+
+        assert(block != NULL);
+        block->i_dts = i;
+        assert(vlc_spsc_fifo_Queue(fifo, block) == (i == 0));
+    }
+    vlc_spsc_fifo_Unpark(fifo);
+
+    assert(vlc_spsc_fifo_GetCount(fifo) == 8);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 800);
+    assert(!vlc_spsc_fifo_Park(fifo));
+
+    /* Blocks come out in order, across batches */
+    uint64_t mark = vlc_spsc_fifo_GetMark(fifo);
+    assert(mark == 8);
+    for (unsigned i = 0; i < 3; i++)
+    {
+        block_t *block = vlc_spsc_fifo_Dequeue(fifo);
+
+        assert(block != NULL && block->i_dts == i);
+        block_Release(block);
+    }
+    for (unsigned i = 8; i < 12; i++)
+    {
+        block_t *block = block_Alloc(10);
+
+        assert(block != NULL);
+        block->i_dts = i;
+        assert(!vlc_spsc_fifo_Queue(fifo, block));
+    }
+
+    /* Discarding only drops the blocks before the mark */
+    vlc_spsc_fifo_Discard(fifo, mark);
+    assert(vlc_spsc_fifo_GetCount(fifo) == 4);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 40);
+    vlc_spsc_fifo_Discard(fifo, mark);
+
+    block_t *block = vlc_spsc_fifo_Dequeue(fifo);
+    assert(block != NULL && block->i_dts == 8);
+    block_Release(block);
+
+    /* Remaining blocks are released with the FIFO */
+    vlc_spsc_fifo_Delete(fifo);
+}
+
+int main(void)
+{
+    test_spsc();
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        Bench("locked", LockedConsumer, LockedProduce);
+        Bench("spsc", SPSCConsumer, SPSCProduce);
+    }
+    return 0;
+}
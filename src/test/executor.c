@@ -25,6 +25,8 @@
 #undef NDEBUG
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include <vlc_common.h>
 #include <vlc_threads.h>
@@ -271,6 +273,313 @@ static void test_task_chain(void)
         assert(array[i] == 2 * i);
 }
 
+struct gate
+{
+    vlc_mutex_t lock;
+    vlc_cond_t cond;
+    bool entered;
+    bool open;
+};
+
+static void InitGate(struct gate *gate)
+{
+    vlc_mutex_init(&gate->lock);
+    vlc_cond_init(&gate->cond);
+    gate->entered = false;
+    gate->open = false;
+}
+
+static void RunGate(void *userdata)
+{
+    struct gate *gate = userdata;
+
+    vlc_mutex_lock(&gate->lock);
+    gate->entered = true;
+    vlc_cond_broadcast(&gate->cond);
+    while (!gate->open)
+        vlc_cond_wait(&gate->cond, &gate->lock);
+    vlc_mutex_unlock(&gate->lock);
+}
+
+static void WaitGateEntered(struct gate *gate)
+{
+    vlc_mutex_lock(&gate->lock);
+    while (!gate->entered)
+        vlc_cond_wait(&gate->cond, &gate->lock);
+    vlc_mutex_unlock(&gate->lock);
+}
+
+static void OpenGate(struct gate *gate)
+{
+    vlc_mutex_lock(&gate->lock);
+    gate->open = true;
+    vlc_cond_broadcast(&gate->cond);
+    vlc_mutex_unlock(&gate->lock);
+}
+
+struct order
+{
+    atomic_uint next;
+    unsigned ranks[64];
+};
+
+struct ordered_task
+{
+    struct order *order;
+    unsigned id;
+    struct vlc_runnable runnable;
+};
+
+static void RunOrdered(void *userdata)
+{
+    struct ordered_task *task = userdata;
+    task->order->ranks[task->id] =
+        atomic_fetch_add_explicit(&task->order->next, 1, memory_order_relaxed);
+}
+
+static void test_priority(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(1);
+    assert(executor);
+
+    struct gate gate;
+    InitGate(&gate);
+    struct vlc_runnable gate_runnable = {
+        .run = RunGate,
+        .userdata = &gate,
+    };
+
+    /* Keep the single worker busy while the tasks are queued */
+    vlc_executor_Submit(executor, &gate_runnable);
+    WaitGateEntered(&gate);
+
+    struct order order = { .next = 0 };
+    struct ordered_task tasks[48];
+    static const enum vlc_executor_priority priorities[3] = {
+        VLC_EXECUTOR_PRIORITY_LOW,
+        VLC_EXECUTOR_PRIORITY_NORMAL,
+        VLC_EXECUTOR_PRIORITY_HIGH,
+    };
+
+    /* Interleave the submissions: 0, 3, 6... are LOW, 1, 4, 7... are NORMAL
+     * and 2, 5, 8... are HIGH */
+    for (unsigned i = 0; i < ARRAY_SIZE(tasks); ++i)
+    {
+        tasks[i].order = &order;
+        tasks[i].id = i;
+        tasks[i].runnable.run = RunOrdered;
+        tasks[i].runnable.userdata = &tasks[i];
+        vlc_executor_SubmitWithPriority(executor, &tasks[i].runnable,
+                                        priorities[i % 3]);
+    }
+
+    OpenGate(&gate);
+    vlc_executor_WaitIdle(executor);
+    vlc_executor_Delete(executor);
+
+    /* Higher priorities first, FIFO within the same priority */
+    const unsigned per_priority = ARRAY_SIZE(tasks) / 3;
+    for (unsigned i = 0; i < ARRAY_SIZE(tasks); ++i)
+    {
+        unsigned level = 2 - i % 3;
+        assert(order.ranks[i] == level * per_priority + i / 3);
+    }
+}
+
+struct steal_task
+{
+    vlc_executor_t *executor;
+    struct data *data;
+    struct vlc_runnable children[8];
+    struct vlc_runnable runnable;
+};
+
+static void RunSpawnAndWait(void *userdata)
+{
+    struct steal_task *task = userdata;
+
+    /* Tasks submitted from a worker land on its own queue: the other
+     * workers must steal them, since this one blocks until they are done */
+    for (size_t i = 0; i < ARRAY_SIZE(task->children); ++i)
+    {
+        task->children[i].run = RunIncrement;
+        task->children[i].userdata = task->data;
+        vlc_executor_Submit(task->executor, &task->children[i]);
+    }
+
+    vlc_mutex_lock(&task->data->lock);
+    while ((size_t) task->data->ended < ARRAY_SIZE(task->children))
+        vlc_cond_wait(&task->data->cond, &task->data->lock);
+    vlc_mutex_unlock(&task->data->lock);
+}
+
+static void test_work_stealing(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(4);
+    assert(executor);
+
+    struct data data;
+    InitData(&data);
+
+    struct steal_task task = {
+        .executor = executor,
+        .data = &data,
+        .runnable = {
+            .run = RunSpawnAndWait,
+            .userdata = &task,
+        },
+    };
+
+    vlc_executor_Submit(executor, &task.runnable);
+    vlc_executor_WaitIdle(executor);
+    vlc_executor_Delete(executor);
+
+    assert((size_t) data.started == ARRAY_SIZE(task.children));
+    assert((size_t) data.ended == ARRAY_SIZE(task.children));
+}
+
+#define BENCH_TASKS (1 << 17)
+#define BENCH_SUBMITTERS 4
+
+struct bench_task
+{
+    atomic_uint *counter;
+    struct vlc_runnable runnable;
+};
+
+static void RunBench(void *userdata)
+{
+    struct bench_task *task = userdata;
+    atomic_fetch_add_explicit(task->counter, 1, memory_order_relaxed);
+}
+
+struct bench_submitter
+{
+    vlc_thread_t thread;
+    vlc_executor_t *executor;
+    struct bench_task *tasks;
+    size_t count;
+};
+
+static void *Submitter(void *userdata)
+{
+    struct bench_submitter *submitter = userdata;
+
+    for (size_t i = 0; i < submitter->count; ++i)
+        vlc_executor_Submit(submitter->executor,
+                            &submitter->tasks[i].runnable);
+    return NULL;
+}
+
+static void bench_throughput(unsigned threads)
+{
+    vlc_executor_t *executor = vlc_executor_New(threads);
+    assert(executor);
+
+    struct bench_task *tasks = malloc(BENCH_TASKS * sizeof(*tasks));
+    assert(tasks);
+
+    atomic_uint counter = 0;
+    for (size_t i = 0; i < BENCH_TASKS; ++i)
+    {
+        tasks[i].counter = &counter;
+        tasks[i].runnable.run = RunBench;
+        tasks[i].runnable.userdata = &tasks[i];
+    }
+
+    struct bench_submitter submitters[BENCH_SUBMITTERS];
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < BENCH_SUBMITTERS; ++i)
+    {
+        submitters[i].executor = executor;
+        submitters[i].count = BENCH_TASKS / BENCH_SUBMITTERS;
+        submitters[i].tasks = &tasks[i * submitters[i].count];
+        int ret = vlc_clone(&submitters[i].thread, Submitter, &submitters[i]);
+        assert(ret == 0);
+    }
+    for (unsigned i = 0; i < BENCH_SUBMITTERS; ++i)
+        vlc_join(submitters[i].thread, NULL);
+
+    vlc_executor_WaitIdle(executor);
+    double secs = secf_from_vlc_tick(vlc_tick_now() - start);
+    vlc_executor_Delete(executor);
+
+    assert(atomic_load(&counter) == BENCH_TASKS);
+    printf("%2u thread(s): %10.0f tasks/s\n", threads, BENCH_TASKS / secs);
+    free(tasks);
+}
+
+struct latency_task
+{
+    vlc_tick_t submitted;
+    vlc_tick_t started;
+    struct vlc_runnable runnable;
+};
+
+static void RunLatency(void *userdata)
+{
+    struct latency_task *task = userdata;
+    task->started = vlc_tick_now();
+}
+
+static void RunBackground(void *userdata)
+{
+    (void) userdata;
+
+    /* Busy for a short while, too short to sleep for */
+    vlc_tick_t deadline = vlc_tick_now() + VLC_TICK_FROM_US(50);
+    while (vlc_tick_now() < deadline);
+}
+
+static void bench_fairness(enum vlc_executor_priority priority)
+{
+    vlc_executor_t *executor = vlc_executor_New(2);
+    assert(executor);
+
+    /* Flood the executor with low priority background work, then measure
+     * how long a few foreground tasks wait before being run */
+    enum { BACKGROUND = 2000, FOREGROUND = 16 };
+    struct vlc_runnable *background =
+        malloc(BACKGROUND * sizeof(*background));
+    assert(background);
+
+    for (size_t i = 0; i < BACKGROUND; ++i)
+    {
+        background[i].run = RunBackground;
+        background[i].userdata = NULL;
+        vlc_executor_SubmitWithPriority(executor, &background[i],
+                                        VLC_EXECUTOR_PRIORITY_LOW);
+    }
+
+    struct latency_task tasks[FOREGROUND];
+    for (size_t i = 0; i < FOREGROUND; ++i)
+    {
+        tasks[i].runnable.run = RunLatency;
+        tasks[i].runnable.userdata = &tasks[i];
+        tasks[i].submitted = vlc_tick_now();
+        vlc_executor_SubmitWithPriority(executor, &tasks[i].runnable,
+                                        priority);
+    }
+
+    vlc_executor_WaitIdle(executor);
+    vlc_executor_Delete(executor);
+
+    vlc_tick_t total = 0, max = 0;
+    for (size_t i = 0; i < FOREGROUND; ++i)
+    {
+        vlc_tick_t wait = tasks[i].started - tasks[i].submitted;
+        total += wait;
+        if (wait > max)
+            max = wait;
+    }
+
+    printf("priority %d: average wait %6"PRId64" us, max %6"PRId64" us\n",
+           (int) priority, US_FROM_VLC_TICK(total / FOREGROUND),
+           US_FROM_VLC_TICK(max));
+    free(background);
+}
+
 int main(void)
 {
     test_single_runnable();
@@ -278,5 +587,13 @@ int main(void)
     test_blocking_delete();
     test_cancel();
     test_task_chain();
+    test_priority();
+    test_work_stealing();
+
+    for (unsigned threads = 1; threads <= 8; threads *= 2)
+        bench_throughput(threads);
+
+    bench_fairness(VLC_EXECUTOR_PRIORITY_LOW);
+    bench_fairness(VLC_EXECUTOR_PRIORITY_HIGH);
     return 0;
 }
@@ -272,11 +272,17 @@ static void vout_UpdateWindowSizeLocked(vout_thread_sys_t *vout)
 
 /* */
 void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
-                            unsigned *restrict lost, unsigned *restrict late)
+                            unsigned *restrict lost, unsigned *restrict late,
+                            unsigned *restrict spu_cache_hits,
+                            unsigned *restrict spu_cache_misses)
 {
     vout_thread_sys_t *sys = VOUT_THREAD_TO_SYS(vout);
     assert(!sys->dummy);
     vout_statistic_GetReset( &sys->statistic, displayed, lost, late );
+    if (sys->spu != NULL)
+        spu_GetResetStatistic(sys->spu, spu_cache_hits, spu_cache_misses);
+    else
+        *spu_cache_hits = *spu_cache_misses = 0;
 }
 
 bool vout_IsEmpty(vout_thread_t *vout)
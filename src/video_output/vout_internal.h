@@ -198,6 +198,8 @@ void spu_Detach( spu_t * );
 void spu_SetClockDelay(spu_t *spu, size_t channel_id, vlc_tick_t delay);
 void spu_SetClockRate(spu_t *spu, size_t channel_id, float rate);
 void spu_ChangeChannelOrderMargin(spu_t *, enum vlc_vout_order, int);
+void spu_GetResetStatistic(spu_t *, unsigned *cache_hits,
+                           unsigned *cache_misses);
 void spu_SetHighlight(spu_t *, const vlc_spu_highlight_t*);
 
 /**
@@ -234,7 +236,9 @@ void vout_ChangeSpuDelay( vout_thread_t *, size_t channel_id, vlc_tick_t delay )
  * This function will return and reset internal statistics.
  */
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
-                             unsigned *pi_lost, unsigned *pi_late );
+                             unsigned *pi_lost, unsigned *pi_late,
+                             unsigned *pi_spu_cache_hits,
+                             unsigned *pi_spu_cache_misses );
 
 /**
  * This function will force to display the next picture while paused
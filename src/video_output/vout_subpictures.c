@@ -31,8 +31,10 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
+#include <vlc_configuration.h>
 #include <vlc_filter.h>
 #include <vlc_spu.h>
 #include <vlc_vector.h>
@@ -84,6 +86,64 @@ struct subtitle_position_cache
 };
 typedef struct VLC_VECTOR(struct subtitle_position_cache) subtitles_positions_vector;
 
+/* Rendered text regions, reused by later subpictures showing the same text */
+#define SPU_TEXT_CACHE_ENTRIES 32
+#define SPU_TEXT_CACHE_MAX_SIZE (32 * 1024 * 1024)
+
+/* Everything but the text segments a rendered text region depends on.
+ * It is hashed and compared as raw bytes, so it must be zeroed first. */
+struct spu_text_key
+{
+    unsigned output_width;
+    unsigned output_height;
+    vlc_fourcc_t chroma_list[SPU_CHROMALIST_COUNT+1];
+
+    int text_flags;
+    int align;
+    int x;
+    int y;
+    int max_width;
+    int max_height;
+    int alpha;
+    bool absolute;
+    bool in_window;
+
+    unsigned sar_num;
+    unsigned sar_den;
+    video_transfer_func_t transfer;
+    video_color_primaries_t primaries;
+    video_color_space_t space;
+    video_color_range_t color_range;
+    uint16_t mastering_primaries[3*2];
+    uint16_t mastering_white_point[2];
+    uint32_t mastering_max_luminance;
+    uint32_t mastering_min_luminance;
+
+    uint64_t generation;            /**< text renderer style generation */
+};
+
+struct spu_text_cache_entry
+{
+    uint64_t hash;
+    struct spu_text_key key;
+    text_segment_t *text;                  /**< copy of the rendered text */
+    subpicture_region_t *region;                    /**< rendered region */
+    picture_t *scaled;   /**< last scaled/converted picture of the region */
+    size_t size;                          /**< bytes used by the pictures */
+    uint64_t last_use;
+};
+
+struct spu_text_cache
+{
+    vlc_mutex_t lock;
+    struct spu_text_cache_entry entries[SPU_TEXT_CACHE_ENTRIES];
+    size_t count;
+    size_t size;
+    uint64_t clock;
+    atomic_uint hits;
+    atomic_uint misses;
+};
+
 typedef struct spu_private_t spu_private_t;
 
 struct spu_private_t {
@@ -97,6 +157,7 @@ struct spu_private_t {
     int channel;             /**< number of subpicture channels registered */
     filter_t *text;                              /**< text renderer module */
     vlc_mutex_t textlock;
+    struct spu_text_cache text_cache;       /**< rendered text regions */
     filter_t *scale_yuvp;                     /**< scaling module for YUVP */
     filter_t *scale;                    /**< scaling module (all but YUVP) */
     bool crop_highlight;                     /**< force cropping of subpicture */
@@ -403,6 +464,357 @@ static void region_FixFmt(subpicture_region_t *region)
         region->p_picture->format.color_range = COLOR_RANGE_FULL;
 }
 
+/**
+ * Rendered text cache helpers.
+ *
+ * Subtitles are often sent again with the same text (ASS lines, repeated
+ * or static subtitles, OSD), each time in a new subpicture. The rendered
+ * regions are kept, with their last scaled picture, and shared with any
+ * later text region rendering to the same result.
+ */
+
+static void spu_text_key_Init(struct spu_text_key *key, filter_t *text,
+                              const subpicture_region_t *region,
+                              unsigned output_width, unsigned output_height,
+                              const vlc_fourcc_t *chroma_list)
+{
+    const video_format_t *fmt = &region->fmt;
+
+    memset(key, 0, sizeof (*key));
+    key->output_width = output_width;
+    key->output_height = output_height;
+    for (size_t i = 0; i < SPU_CHROMALIST_COUNT && chroma_list[i]; i++)
+        key->chroma_list[i] = chroma_list[i];
+
+    key->text_flags = region->text_flags;
+    key->align = region->i_align;
+    key->x = region->i_x;
+    key->y = region->i_y;
+    key->max_width = region->i_max_width;
+    key->max_height = region->i_max_height;
+    key->alpha = region->i_alpha;
+    key->absolute = region->b_absolute;
+    key->in_window = region->b_in_window;
+
+    key->sar_num = fmt->i_sar_num;
+    key->sar_den = fmt->i_sar_den;
+    key->transfer = fmt->transfer;
+    key->primaries = fmt->primaries;
+    key->space = fmt->space;
+    key->color_range = fmt->color_range;
+    memcpy(key->mastering_primaries, fmt->mastering.primaries,
+           sizeof (key->mastering_primaries));
+    memcpy(key->mastering_white_point, fmt->mastering.white_point,
+           sizeof (key->mastering_white_point));
+    key->mastering_max_luminance = fmt->mastering.max_luminance;
+    key->mastering_min_luminance = fmt->mastering.min_luminance;
+
+    if (text->ops->render_generation != NULL)
+        key->generation = text->ops->render_generation(text);
+}
+
+static uint64_t spu_text_HashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+
+    /* FNV-1a */
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+static uint64_t spu_text_HashString(uint64_t hash, const char *str)
+{
+    if (str == NULL)
+        return hash;
+    return spu_text_HashBytes(hash, str, strlen(str) + 1);
+}
+
+static uint64_t spu_text_HashStyle(uint64_t hash, const text_style_t *style)
+{
+    if (style == NULL)
+        return hash;
+
+    const uint32_t values[] = {
+        style->i_features, style->i_style_flags, style->i_font_size,
+        style->i_font_color, style->i_font_alpha, style->i_spacing,
+        style->i_outline_color, style->i_outline_alpha, style->i_outline_width,
+        style->i_shadow_color, style->i_shadow_alpha, style->i_shadow_width,
+        style->i_background_color, style->i_background_alpha,
+        style->e_wrapinfo,
+    };
+
+    hash = spu_text_HashString(hash, style->psz_fontname);
+    hash = spu_text_HashString(hash, style->psz_monofontname);
+    hash = spu_text_HashBytes(hash, values, sizeof (values));
+    return spu_text_HashBytes(hash, &style->f_font_relsize,
+                              sizeof (style->f_font_relsize));
+}
+
+static uint64_t spu_text_Hash(const struct spu_text_key *key,
+                              const text_segment_t *text)
+{
+    uint64_t hash = spu_text_HashBytes(UINT64_C(0xcbf29ce484222325),
+                                       key, sizeof (*key));
+
+    for (; text != NULL; text = text->p_next)
+    {
+        hash = spu_text_HashString(hash, text->psz_text);
+        hash = spu_text_HashStyle(hash, text->style);
+        for (const text_segment_ruby_t *ruby = text->p_ruby; ruby != NULL;
+             ruby = ruby->p_next)
+        {
+            hash = spu_text_HashString(hash, ruby->psz_base);
+            hash = spu_text_HashString(hash, ruby->psz_rt);
+        }
+    }
+    return hash;
+}
+
+static bool spu_text_IsSameString(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return !strcmp(a, b);
+}
+
+static bool spu_text_IsSameStyle(const text_style_t *a, const text_style_t *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+
+    return spu_text_IsSameString(a->psz_fontname, b->psz_fontname) &&
+           spu_text_IsSameString(a->psz_monofontname, b->psz_monofontname) &&
+           a->i_features == b->i_features &&
+           a->i_style_flags == b->i_style_flags &&
+           a->f_font_relsize == b->f_font_relsize &&
+           a->i_font_size == b->i_font_size &&
+           a->i_font_color == b->i_font_color &&
+           a->i_font_alpha == b->i_font_alpha &&
+           a->i_spacing == b->i_spacing &&
+           a->i_outline_color == b->i_outline_color &&
+           a->i_outline_alpha == b->i_outline_alpha &&
+           a->i_outline_width == b->i_outline_width &&
+           a->i_shadow_color == b->i_shadow_color &&
+           a->i_shadow_alpha == b->i_shadow_alpha &&
+           a->i_shadow_width == b->i_shadow_width &&
+           a->i_background_color == b->i_background_color &&
+           a->i_background_alpha == b->i_background_alpha &&
+           a->e_wrapinfo == b->e_wrapinfo;
+}
+
+static bool spu_text_IsSameText(const text_segment_t *a,
+                                const text_segment_t *b)
+{
+    for (; a != NULL && b != NULL; a = a->p_next, b = b->p_next)
+    {
+        if (!spu_text_IsSameString(a->psz_text, b->psz_text) ||
+            !spu_text_IsSameStyle(a->style, b->style))
+            return false;
+
+        const text_segment_ruby_t *ra = a->p_ruby, *rb = b->p_ruby;
+        for (; ra != NULL && rb != NULL; ra = ra->p_next, rb = rb->p_next)
+            if (!spu_text_IsSameString(ra->psz_base, rb->psz_base) ||
+                !spu_text_IsSameString(ra->psz_rt, rb->psz_rt))
+                return false;
+        if (ra != rb)
+            return false;
+    }
+    return a == b;
+}
+
+static size_t spu_text_PictureSize(const picture_t *picture)
+{
+    size_t size = 0;
+
+    for (int i = 0; i < picture->i_planes; i++)
+        size += (size_t)picture->p[i].i_pitch * picture->p[i].i_lines;
+    return size;
+}
+
+/* Creates a region sharing the picture of a rendered text region */
+static subpicture_region_t *spu_text_CopyRegion(const subpicture_region_t *src)
+{
+    subpicture_region_t *dst = subpicture_region_ForPicture(src->p_picture);
+    if (unlikely(dst == NULL))
+        return NULL;
+
+    video_format_Clean(&dst->fmt);
+    if (video_format_Copy(&dst->fmt, &src->fmt) != VLC_SUCCESS)
+    {
+        subpicture_region_Delete(dst);
+        return NULL;
+    }
+    dst->b_absolute = src->b_absolute;
+    dst->b_in_window = src->b_in_window;
+    dst->i_x = src->i_x;
+    dst->i_y = src->i_y;
+    dst->i_align = src->i_align;
+    dst->i_alpha = src->i_alpha;
+    dst->text_flags = src->text_flags;
+    dst->i_max_width = src->i_max_width;
+    dst->i_max_height = src->i_max_height;
+    return dst;
+}
+
+static void spu_text_cache_Init(struct spu_text_cache *cache)
+{
+    vlc_mutex_init(&cache->lock);
+    cache->count = 0;
+    cache->size = 0;
+    cache->clock = 0;
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+}
+
+static void spu_text_cache_Remove(struct spu_text_cache *cache, size_t index)
+{
+    struct spu_text_cache_entry *entry = &cache->entries[index];
+
+    text_segment_ChainDelete(entry->text);
+    subpicture_region_Delete(entry->region);
+    if (entry->scaled != NULL)
+        picture_Release(entry->scaled);
+    cache->size -= entry->size;
+    cache->entries[index] = cache->entries[--cache->count];
+}
+
+static void spu_text_cache_RemoveOldest(struct spu_text_cache *cache)
+{
+    size_t oldest = 0;
+
+    assert(cache->count > 0);
+    for (size_t i = 1; i < cache->count; i++)
+        if (cache->entries[i].last_use < cache->entries[oldest].last_use)
+            oldest = i;
+    spu_text_cache_Remove(cache, oldest);
+}
+
+static void spu_text_cache_Flush(struct spu_text_cache *cache)
+{
+    vlc_mutex_lock(&cache->lock);
+    while (cache->count > 0)
+        spu_text_cache_Remove(cache, cache->count - 1);
+    vlc_mutex_unlock(&cache->lock);
+}
+
+/* Returns a copy of the cached rendering of a text region, if any */
+static subpicture_region_t *spu_text_cache_Get(struct spu_text_cache *cache,
+                                               uint64_t hash,
+                                               const struct spu_text_key *key,
+                                               const text_segment_t *text)
+{
+    subpicture_region_t *region = NULL;
+
+    vlc_mutex_lock(&cache->lock);
+    for (size_t i = 0; i < cache->count; i++)
+    {
+        struct spu_text_cache_entry *entry = &cache->entries[i];
+
+        if (entry->hash != hash || memcmp(&entry->key, key, sizeof (*key))
+         || !spu_text_IsSameText(entry->text, text))
+            continue;
+
+        region = spu_text_CopyRegion(entry->region);
+        if (region != NULL && entry->scaled != NULL
+         && subpicture_region_cache_Assign(region,
+                                picture_Hold(entry->scaled)) != VLC_SUCCESS)
+            picture_Release(entry->scaled);
+        entry->last_use = ++cache->clock;
+        break;
+    }
+    vlc_mutex_unlock(&cache->lock);
+
+    atomic_fetch_add_explicit(region != NULL ? &cache->hits : &cache->misses,
+                              1, memory_order_relaxed);
+    return region;
+}
+
+static void spu_text_cache_Put(struct spu_text_cache *cache, uint64_t hash,
+                               const struct spu_text_key *key,
+                               const text_segment_t *text,
+                               const subpicture_region_t *rendered)
+{
+    /* Forced palettes are applied in place, do not share such pictures */
+    if (rendered->p_picture == NULL ||
+        rendered->p_picture->format.i_chroma == VLC_CODEC_YUVP ||
+        rendered->p_picture->format.i_chroma == VLC_CODEC_RGBP)
+        return;
+
+    const size_t size = spu_text_PictureSize(rendered->p_picture);
+    if (size > SPU_TEXT_CACHE_MAX_SIZE / 4)
+        return;
+
+    text_segment_t *copy = text_segment_Copy((text_segment_t *)text);
+    subpicture_region_t *region = spu_text_CopyRegion(rendered);
+    if (unlikely(copy == NULL || region == NULL))
+    {
+        text_segment_ChainDelete(copy);
+        subpicture_region_Delete(region);
+        return;
+    }
+
+    vlc_mutex_lock(&cache->lock);
+    while (cache->count == SPU_TEXT_CACHE_ENTRIES ||
+           (cache->count > 0 && cache->size + size > SPU_TEXT_CACHE_MAX_SIZE))
+        spu_text_cache_RemoveOldest(cache);
+
+    cache->entries[cache->count++] = (struct spu_text_cache_entry) {
+        .hash = hash,
+        .key = *key,
+        .text = copy,
+        .region = region,
+        .scaled = NULL,
+        .size = size,
+        .last_use = ++cache->clock,
+    };
+    cache->size += size;
+    vlc_mutex_unlock(&cache->lock);
+}
+
+/* Keeps the scaled picture of a region, if it comes from the cache */
+static void spu_text_cache_SetScaled(struct spu_text_cache *cache,
+                                     subpicture_region_t *region)
+{
+    if (!subpicture_region_cache_IsValid(region))
+        return;
+
+    picture_t *scaled = subpicture_region_cache_GetPicture(region);
+
+    vlc_mutex_lock(&cache->lock);
+    for (size_t i = 0; i < cache->count; i++)
+    {
+        struct spu_text_cache_entry *entry = &cache->entries[i];
+
+        if (entry->region->p_picture != region->p_picture)
+            continue;
+
+        if (entry->scaled != scaled)
+        {
+            const size_t size = spu_text_PictureSize(scaled);
+
+            if (entry->scaled != NULL)
+            {
+                const size_t old_size = spu_text_PictureSize(entry->scaled);
+                entry->size -= old_size;
+                cache->size -= old_size;
+                picture_Release(entry->scaled);
+            }
+            entry->scaled = picture_Hold(scaled);
+            entry->size += size;
+            cache->size += size;
+
+            while (cache->size > SPU_TEXT_CACHE_MAX_SIZE)
+                spu_text_cache_RemoveOldest(cache);
+        }
+        break;
+    }
+    vlc_mutex_unlock(&cache->lock);
+}
+
 static subpicture_region_t *SpuRenderText(spu_t *spu,
                           const subpicture_region_t *region,
                           unsigned output_width,
@@ -422,6 +834,19 @@ static subpicture_region_t *SpuRenderText(spu_t *spu,
         return NULL;
     }
 
+    struct spu_text_key key;
+    spu_text_key_Init(&key, text, region, output_width, output_height,
+                      chroma_list);
+    const uint64_t hash = spu_text_Hash(&key, region->p_text);
+
+    subpicture_region_t *cached_region =
+        spu_text_cache_Get(&sys->text_cache, hash, &key, region->p_text);
+    if (cached_region != NULL)
+    {
+        vlc_mutex_unlock(&sys->textlock);
+        return cached_region;
+    }
+
     /* FIXME aspect ratio ? */
     text->fmt_out.video.i_width =
     text->fmt_out.video.i_visible_width  = output_width;
@@ -433,6 +858,13 @@ static subpicture_region_t *SpuRenderText(spu_t *spu,
     subpicture_region_t *rendered_region = text->ops->render(text, region, chroma_list);
     assert(rendered_region == NULL || !subpicture_region_IsText(rendered_region));
 
+    if (rendered_region != NULL)
+    {
+        region_FixFmt(rendered_region);
+        spu_text_cache_Put(&sys->text_cache, hash, &key, region->p_text,
+                           rendered_region);
+    }
+
     vlc_mutex_unlock(&sys->textlock);
     return rendered_region;
 }
@@ -1488,6 +1920,8 @@ static vlc_render_subpicture *SpuRenderSubpictures(spu_t *spu,
             if (unlikely(output_last_ptr == NULL))
                 continue;
 
+            spu_text_cache_SetScaled(&sys->text_cache, region);
+
             if (subpic_in_video) {
                 // place the region inside the video area
                 output_last_ptr->place.x += video_position->x;
@@ -1835,6 +2269,7 @@ static void spu_Cleanup(spu_t *spu)
 
     if (sys->text)
         vlc_filter_Delete(sys->text);
+    spu_text_cache_Flush(&sys->text_cache);
 
     if (sys->scale_yuvp)
         vlc_filter_Delete(sys->scale_yuvp);
@@ -1949,6 +2384,7 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
     /* Load text and scale module */
     sys->text = SpuRenderCreateAndLoadText(spu);
     vlc_mutex_init(&sys->textlock);
+    spu_text_cache_Init(&sys->text_cache);
 
     /* XXX spu->p_scale is used for all conversion/scaling except yuvp to
      * yuva/rgba */
@@ -1999,6 +2435,7 @@ void spu_Attach(spu_t *spu, input_thread_t *input)
         if (sys->text)
             vlc_filter_Delete(sys->text);
         sys->text = SpuRenderCreateAndLoadText(spu);
+        spu_text_cache_Flush(&sys->text_cache);
         vlc_mutex_unlock(&sys->textlock);
     }
     vlc_mutex_unlock(&sys->lock);
@@ -2016,6 +2453,20 @@ void spu_Detach(spu_t *spu)
     vlc_mutex_unlock(&sys->lock);
 }
 
+/**
+ * Return and reset the rendered text cache statistics
+ */
+void spu_GetResetStatistic(spu_t *spu, unsigned *restrict cache_hits,
+                           unsigned *restrict cache_misses)
+{
+    spu_private_t *sys = container_of(spu, spu_private_t, spu);
+
+    *cache_hits = atomic_exchange_explicit(&sys->text_cache.hits, 0,
+                                           memory_order_relaxed);
+    *cache_misses = atomic_exchange_explicit(&sys->text_cache.misses, 0,
+                                             memory_order_relaxed);
+}
+
 void spu_SetClockDelay(spu_t *spu, size_t channel_id, vlc_tick_t delay)
 {
     spu_private_t *sys = container_of(spu, spu_private_t, spu);
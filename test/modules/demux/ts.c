@@ -0,0 +1,308 @@
+/*****************************************************************************
+ * ts.c: MPEG-TS demuxer packet handling test
+ *****************************************************************************
+ * Copyright (C) 2026 VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+
+#include <string.h>
+
+#define PMT_PID 0x100
+#define ES_PID  0x101
+
+/* Each PES spans two packets: a PCR and the PES header in the first one */
+#define PES_COUNT   8
+#define PES_PAYLOAD (188 - 4 - 8 - 14 + 184)
+
+/* PES with its second packet sent twice */
+#define PES_DUPLICATE 2
+/* PES with a packet lost according to the continuity counter */
+#define PES_LOSS      4
+/* PES preceded by garbage, read packet-wise once in sync again */
+#define PES_RESYNC    6
+
+#define STREAM_SIZE (188 * (2 + 2 * PES_COUNT + 2) + 1)
+
+struct es_out_id_t
+{
+    int dummy;
+};
+
+struct test_es_out
+{
+    es_out_t out;
+    es_out_id_t id;
+    unsigned added;
+    unsigned received;
+    uint32_t flags[PES_COUNT];
+    bool intact[PES_COUNT];
+};
+
+static es_out_id_t *EsOutAdd(es_out_t *out, input_source_t *in,
+                             const es_format_t *fmt)
+{
+    struct test_es_out *ctx = container_of(out, struct test_es_out, out);
+
+    (void) in;
+    assert(fmt->i_cat == AUDIO_ES);
+    ctx->added++;
+    return &ctx->id;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    struct test_es_out *ctx = container_of(out, struct test_es_out, out);
+
+    assert(id == &ctx->id);
+
+    /* Identify the PES by its payload */
+    unsigned n = block->i_buffer > 0 ? block->p_buffer[0] : PES_COUNT;
+    assert(n < PES_COUNT);
+
+    bool intact = block->i_buffer == PES_PAYLOAD;
+    for (size_t i = 0; i < block->i_buffer; i++)
+        if (block->p_buffer[i] != n)
+            intact = false;
+
+    ctx->flags[n] = block->i_flags;
+    ctx->intact[n] = intact;
+    ctx->received++;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl(es_out_t *out, input_source_t *in, int query,
+                        va_list args)
+{
+    (void) out; (void) in;
+
+    switch (query)
+    {
+        case ES_OUT_GET_ES_STATE:
+            (void) va_arg(args, es_out_id_t *);
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case ES_OUT_IS_EMPTY:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_SET_GROUP:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_ES_SCRAMBLED_STATE:
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+static const struct es_out_callbacks es_out_cbs =
+{
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDel,
+    .control = EsOutControl,
+    .destroy = EsOutDestroy,
+};
+
+static uint32_t CRC32(const uint8_t *p, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (len-- > 0)
+    {
+        crc ^= (uint32_t)*(p++) << 24;
+        for (unsigned i = 0; i < 8; i++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04C11DB7 : 0);
+    }
+    return crc;
+}
+
+static uint8_t *WriteHeader(uint8_t *p, uint16_t pid, bool start,
+                            unsigned cc)
+{
+    p[0] = 0x47;
+    p[1] = (start ? 0x40 : 0x00) | (pid >> 8);
+    p[2] = pid & 0xFF;
+    p[3] = 0x10 | (cc & 0x0F);
+    return p + 4;
+}
+
+static uint8_t *WriteSection(uint8_t *p, uint16_t pid, const uint8_t *section,
+                             size_t len)
+{
+    uint8_t *pkt = p;
+
+    memset(p, 0xFF, 188);
+    p = WriteHeader(p, pid, true, 0);
+    *(p++) = 0; /* pointer field */
+    memcpy(p, section, len);
+    SetDWBE(p + len, CRC32(section, len));
+    return pkt + 188;
+}
+
+static uint8_t *WriteNull(uint8_t *p)
+{
+    memset(p, 0xFF, 188);
+    WriteHeader(p, 0x1FFF, false, 0);
+    return p + 188;
+}
+
+static uint8_t *WritePES(uint8_t *p, unsigned n, unsigned *cc, bool dup,
+                         bool loss)
+{
+    const uint64_t ts = 90000 + 3600 * n;
+
+    /* First packet: adaptation field with the PCR, then the PES header */
+    uint8_t *h = p;
+    WriteHeader(p, ES_PID, true, (*cc)++);
+    p[3] |= 0x20;
+    p[4] = 7;
+    p[5] = 0x10;
+    p[6] = ts >> 25;
+    p[7] = ts >> 17;
+    p[8] = ts >> 9;
+    p[9] = ts >> 1;
+    p[10] = ((ts & 1) << 7) | 0x7E;
+    p[11] = 0;
+    p += 12;
+
+    static const uint8_t pes[] = { 0x00, 0x00, 0x01, 0xC0 };
+    memcpy(p, pes, 4);
+    SetWBE(p + 4, 3 + 5 + PES_PAYLOAD);
+    p[6] = 0x80;
+    p[7] = 0x80; /* PTS only */
+    p[8] = 5;
+    p[9] = 0x21 | ((ts >> 29) & 0x0E);
+    SetWBE(p + 10, ((ts >> 14) & 0xFFFE) | 1);
+    SetWBE(p + 12, ((ts << 1) & 0xFFFE) | 1);
+    p += 14;
+    memset(p, n, h + 188 - p);
+    p = h + 188;
+
+    /* Second packet: payload only */
+    if (loss)
+        (*cc)++;
+    h = p;
+    p = WriteHeader(p, ES_PID, false, (*cc)++);
+    memset(p, n, 184);
+    p = h + 188;
+
+    if (dup)
+    {
+        memcpy(p, h, 188);
+        p += 188;
+    }
+    return p;
+}
+
+static size_t BuildStream(uint8_t *buf)
+{
+    static const uint8_t pat[] = {
+        0x00, 0xB0, 13, 0x00, 0x01, 0xC1, 0x00, 0x00,
+        0x00, 0x01, 0xE0 | (PMT_PID >> 8), PMT_PID & 0xFF,
+    };
+    static const uint8_t pmt[] = {
+        0x02, 0xB0, 18, 0x00, 0x01, 0xC1, 0x00, 0x00,
+        0xE0 | (ES_PID >> 8), ES_PID & 0xFF, 0xF0, 0x00,
+        0x03, 0xE0 | (ES_PID >> 8), ES_PID & 0xFF, 0xF0, 0x00,
+    };
+    uint8_t *p = buf;
+    unsigned cc = 0;
+
+    p = WriteSection(p, 0, pat, sizeof (pat));
+    p = WriteSection(p, PMT_PID, pmt, sizeof (pmt));
+
+    for (unsigned n = 0; n < PES_COUNT; n++)
+    {
+        if (n == PES_RESYNC)
+        {
+            /* The packet read out of sync is dropped: make it a null one */
+            *(p++) = 0x00;
+            p = WriteNull(p);
+        }
+        p = WritePES(p, n, &cc, n == PES_DUPLICATE, n == PES_LOSS);
+    }
+
+    assert((size_t)(p - buf) <= STREAM_SIZE);
+    return p - buf;
+}
+
+static void test_demux(vlc_object_t *obj)
+{
+    static uint8_t buf[STREAM_SIZE];
+    size_t len = BuildStream(buf);
+
+    stream_t *s = vlc_stream_MemoryNew(obj, buf, len, true);
+    assert(s != NULL);
+
+    struct test_es_out ctx = { .out = { .cbs = &es_out_cbs } };
+    demux_t *demux = demux_New(VLC_OBJECT(s), "ts", "vlc://nop", s,
+                               &ctx.out);
+    assert(demux != NULL);
+
+    while (demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+
+    demux_Delete(demux);
+    vlc_stream_Delete(s);
+
+    assert(ctx.added == 1);
+    /* The last PES is complete once its size is reached */
+    assert(ctx.received == PES_COUNT);
+
+    for (unsigned n = 0; n < PES_COUNT; n++)
+    {
+        /* Duplicates are dropped, but data is missing after a loss */
+        assert(ctx.intact[n] || n == PES_LOSS);
+        assert(!(ctx.flags[n] & BLOCK_FLAG_CORRUPTED) == (n != PES_LOSS));
+    }
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_demux(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*****************************************************************************
+ * ts_workers.c: MPEG TS per program worker threads tests
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+
+#include "../../../modules/demux/mpeg/ts_streams.h"
+#include "../../../modules/demux/mpeg/ts_pid_fwd.h"
+#include "../../../modules/demux/mpeg/ts_streams_private.h"
+#include "../../../modules/demux/mpeg/ts_workers.h"
+
+#include "../../libvlc/test.h"
+
+const char vlc_module_name[] = "test_ts_workers";
+
+#define TEST_PROGRAMS 4
+#define TEST_PACKETS  4096
+#define TEST_PCR_RATE 16
+
+typedef struct
+{
+    ts_pmt_t  *p_pmt;
+    ts_es_t   *p_es;
+    unsigned   i_pushed; /* by the input thread */
+    unsigned   i_run; /* by the worker */
+    unsigned   i_pcrs_run;
+    unsigned   i_sent; /* by the input thread */
+    unsigned   i_pcrs_sent;
+} test_program_t;
+
+static test_program_t programs[TEST_PROGRAMS];
+static unsigned long input_thread;
+
+static test_program_t * TestProgram( const ts_pmt_t *p_pmt )
+{
+    for( unsigned i = 0; i < TEST_PROGRAMS; i++ )
+        if( programs[i].p_pmt == p_pmt )
+            return &programs[i];
+    abort();
+}
+
+static void TestPacket( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt,
+                        size_t i_skip )
+{
+    (void) p_demux; (void) p_pid;
+
+    /* Packets carry their program and their rank within it */
+    assert( i_skip == 4 );
+    test_program_t *p_prg = &programs[p_pkt->p_buffer[0]];
+    assert( vlc_thread_id() != input_thread );
+    assert( GetDWBE( &p_pkt->p_buffer[i_skip] ) == p_prg->i_run );
+    p_prg->i_run++;
+
+    bool b_queued = ts_workers_QueueSend( p_prg->p_pmt, p_prg->p_es, p_pkt );
+    assert( b_queued );
+}
+
+static void TestPCR( demux_t *p_demux, ts_pmt_t *p_pmt, ts_90khz_t i_pcr,
+                     uint64_t i_pos )
+{
+    (void) p_demux;
+
+    test_program_t *p_prg = TestProgram( p_pmt );
+    assert( i_pcr == p_prg->i_run );
+    assert( i_pos == (uint64_t)i_pcr * 188 );
+    p_prg->i_pcrs_run++;
+
+    bool b_queued = ts_workers_QueuePCR( p_pmt, i_pcr, i_pos );
+    assert( b_queued );
+}
+
+static void TestSend( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
+{
+    (void) p_demux;
+
+    /* The es_out is only called by the input thread, in order */
+    assert( vlc_thread_id() == input_thread );
+    test_program_t *p_prg = &programs[p_chain->p_buffer[0]];
+    assert( p_prg->p_es == p_es );
+    assert( GetDWBE( &p_chain->p_buffer[4] ) == p_prg->i_sent );
+    p_prg->i_sent++;
+    block_ChainRelease( p_chain );
+}
+
+static void TestSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, vlc_tick_t i_pcr,
+                        uint64_t i_pos )
+{
+    (void) p_demux; (void) i_pos;
+
+    assert( vlc_thread_id() == input_thread );
+    test_program_t *p_prg = TestProgram( p_pmt );
+    assert( i_pcr == p_prg->i_sent );
+    p_prg->i_pcrs_sent++;
+}
+
+static void TestPush( ts_workers_t *p_workers, unsigned i_program )
+{
+    test_program_t *p_prg = &programs[i_program];
+
+    if( !ts_workers_IsSharded( p_workers, p_prg->p_pmt ) )
+        ts_workers_Shard( p_workers, p_prg->p_pmt );
+
+    if( p_prg->i_pushed % TEST_PCR_RATE == 0 )
+        ts_workers_PushPCR( p_workers, p_prg->p_pmt, p_prg->i_pushed,
+                            p_prg->i_pushed * 188 );
+
+    block_t *p_pkt = block_Alloc( 188 );
+    assert( p_pkt != NULL );
+    p_pkt->p_buffer[0] = i_program;
+    SetDWBE( &p_pkt->p_buffer[4], p_prg->i_pushed++ );
+    ts_workers_PushPacket( p_workers, p_prg->p_pmt, NULL, p_pkt, 4 );
+}
+
+int main( void )
+{
+    static const ts_workers_callbacks_t cbs = {
+        .pf_packet = TestPacket,
+        .pf_pcr = TestPCR,
+        .pf_send = TestSend,
+        .pf_set_pcr = TestSetPCR,
+    };
+
+    test_init();
+    input_thread = vlc_thread_id();
+
+    for( unsigned i = 0; i < TEST_PROGRAMS; i++ )
+    {
+        programs[i].p_pmt = calloc( 1, sizeof(ts_pmt_t) );
+        programs[i].p_es = calloc( 1, sizeof(ts_es_t) );
+        assert( programs[i].p_pmt != NULL && programs[i].p_es != NULL );
+        ts_workers_ProgramInit( programs[i].p_pmt );
+        programs[i].p_pmt->i_number = i + 1;
+        programs[i].p_es->p_program = programs[i].p_pmt;
+    }
+
+    /* Outside of a worker, the caller calls the es_out itself */
+    assert( !ts_workers_QueueSend( programs[0].p_pmt, programs[0].p_es, NULL ) );
+    assert( !ts_workers_QueuePCR( programs[0].p_pmt, VLC_TICK_0, 0 ) );
+
+    /* No demuxer: nothing is logged */
+    ts_workers_t *p_workers = ts_workers_New( NULL, &cbs, 2 );
+    assert( p_workers != NULL );
+
+    for( unsigned i = 0; i < TEST_PACKETS; i++ )
+    {
+        TestPush( p_workers, i % TEST_PROGRAMS );
+        /* As the demuxer does after each batch, without waiting */
+        if( i % 64 == 63 )
+        {
+            ts_workers_Flush( p_workers );
+            ts_workers_Output( p_workers );
+        }
+    }
+
+    /* Taking a program back sends all its output, and leaves the other ones
+     * with their worker */
+    ts_workers_DrainProgram( p_workers, programs[0].p_pmt );
+    assert( !ts_workers_IsSharded( p_workers, programs[0].p_pmt ) );
+    assert( programs[0].i_sent == TEST_PACKETS / TEST_PROGRAMS );
+    assert( programs[0].i_pcrs_sent == programs[0].i_sent / TEST_PCR_RATE );
+    for( unsigned i = 1; i < TEST_PROGRAMS; i++ )
+        assert( ts_workers_IsSharded( p_workers, programs[i].p_pmt ) );
+
+    /* Already taken back */
+    ts_workers_DrainProgram( p_workers, programs[0].p_pmt );
+
+    for( unsigned i = 0; i < TEST_PACKETS; i++ )
+        TestPush( p_workers, i % TEST_PROGRAMS );
+
+    ts_workers_Drain( p_workers );
+
+    uint64_t i_outputs = 0;
+    for( unsigned i = 0; i < TEST_PROGRAMS; i++ )
+    {
+        const test_program_t *p_prg = &programs[i];
+        assert( !ts_workers_IsSharded( p_workers, p_prg->p_pmt ) );
+        assert( p_prg->i_sent == 2 * TEST_PACKETS / TEST_PROGRAMS );
+        assert( p_prg->i_run == p_prg->i_sent );
+        assert( p_prg->i_pcrs_sent == p_prg->i_sent / TEST_PCR_RATE );
+        assert( p_prg->i_pcrs_run == p_prg->i_pcrs_sent );
+        i_outputs += p_prg->i_sent + p_prg->i_pcrs_sent;
+
+        ts_workers_program_stats_t stats;
+        ts_workers_GetProgramStats( p_workers, p_prg->p_pmt, &stats );
+        assert( stats.i_packets == p_prg->i_sent );
+        assert( stats.i_bytes == 188 * p_prg->i_sent );
+        assert( stats.i_pcrs == p_prg->i_pcrs_sent );
+        assert( stats.i_latency_max >= 0 );
+    }
+
+    ts_workers_stats_t stats;
+    ts_workers_GetStats( p_workers, &stats );
+    assert( stats.i_packets == 2 * TEST_PACKETS );
+    assert( stats.i_pcrs == 2 * TEST_PACKETS / TEST_PCR_RATE );
+    assert( stats.i_outputs == i_outputs );
+    assert( stats.i_drains == 1 );
+    assert( stats.i_program_drains == 1 );
+
+    ts_workers_Delete( p_workers );
+    for( unsigned i = 0; i < TEST_PROGRAMS; i++ )
+    {
+        free( programs[i].p_es );
+        free( programs[i].p_pmt );
+    }
+    return 0;
+}
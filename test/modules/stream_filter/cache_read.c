@@ -0,0 +1,604 @@
+/*****************************************************************************
+ * cache_read.c: block cache stream filter test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* Define a builtin module for the delayed access */
+#define MODULE_NAME test_cache_read
+#undef VLC_DYNAMIC_PLUGIN
+
+#include "../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_interrupt.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+#include <vlc_tick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/libvlc_internal.h"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+/*
+ * The MP4 demuxer reads a file with the index at the end and non-interleaved
+ * tracks, as written by some muxers, from a local access emulating an HTTP
+ * server: every request for a new range costs a round trip. Opening the file
+ * jumps from the header to the index and back, and demuxing alternates
+ * between the video and audio regions of the file.
+ */
+
+#define DURATION 10 /* seconds */
+#define VIDEO_RATE 25
+#define VIDEO_SAMPLES (DURATION * VIDEO_RATE)
+#define AUDIO_RATE 43
+#define AUDIO_SAMPLES (DURATION * AUDIO_RATE)
+#define LATENCY VLC_TICK_FROM_MS(50)
+#define BANDWIDTH (32 << 20)
+
+static struct
+{
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} file;
+
+static struct
+{
+    unsigned long seeks;
+    uint64_t bytes;
+} upstream;
+
+static uint64_t spills;
+
+static uint32_t VideoSampleSize(unsigned i)
+{
+    return (i % VIDEO_RATE) ? 24000 + (i % 7) * 1000 : 60000;
+}
+
+static uint32_t AudioSampleSize(unsigned i)
+{
+    return 400 + (i % 5) * 50;
+}
+
+static uint8_t Pattern(unsigned track, unsigned sample, size_t offset)
+{
+    return track * 31 + sample * 7 + offset;
+}
+
+/*
+ * MP4 writer
+ */
+static void Put(const void *data, size_t len)
+{
+    if (file.size + len > file.capacity)
+    {
+        file.capacity = (file.size + len) * 2;
+        file.data = realloc(file.data, file.capacity);
+        assert(file.data != NULL);
+    }
+    memcpy(file.data + file.size, data, len);
+    file.size += len;
+}
+
+static void Put8(uint8_t v)
+{
+    Put(&v, 1);
+}
+
+static void Put16(uint16_t v)
+{
+    Put8(v >> 8);
+    Put8(v);
+}
+
+static void Put32(uint32_t v)
+{
+    Put16(v >> 16);
+    Put16(v);
+}
+
+static void PutZero(size_t len)
+{
+    while (len-- > 0)
+        Put8(0);
+}
+
+static size_t BoxStart(const char *type)
+{
+    size_t pos = file.size;
+
+    Put32(0);
+    Put(type, 4);
+    return pos;
+}
+
+static size_t FullBoxStart(const char *type, uint32_t flags)
+{
+    size_t pos = BoxStart(type);
+
+    Put32(flags);
+    return pos;
+}
+
+static void BoxEnd(size_t pos)
+{
+    SetDWBE(file.data + pos, file.size - pos);
+}
+
+static void PutMatrix(void)
+{
+    static const uint32_t matrix[9] = {
+        0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(matrix); i++)
+        Put32(matrix[i]);
+}
+
+static void PutTrack(unsigned id, bool video, unsigned count,
+                     uint32_t (*size)(unsigned), const uint32_t *offsets)
+{
+    const uint32_t timescale = video ? VIDEO_RATE : AUDIO_RATE;
+
+    size_t trak = BoxStart("trak");
+    size_t box = FullBoxStart("tkhd", 7);
+    Put32(0); Put32(0); Put32(id); Put32(0);
+    Put32(DURATION * 1000);
+    PutZero(8);
+    Put16(0); Put16(0); Put16(video ? 0 : 0x100); Put16(0);
+    PutMatrix();
+    Put32(video ? 320 << 16 : 0); Put32(video ? 240 << 16 : 0);
+    BoxEnd(box);
+
+    size_t mdia = BoxStart("mdia");
+    box = FullBoxStart("mdhd", 0);
+    Put32(0); Put32(0); Put32(timescale); Put32(count);
+    Put16(0x55c4); Put16(0);
+    BoxEnd(box);
+    box = FullBoxStart("hdlr", 0);
+    Put32(0); Put(video ? "vide" : "soun", 4); PutZero(12); Put8(0);
+    BoxEnd(box);
+
+    size_t minf = BoxStart("minf");
+    if (video)
+    {
+        box = FullBoxStart("vmhd", 1);
+        PutZero(8);
+    }
+    else
+    {
+        box = FullBoxStart("smhd", 0);
+        PutZero(4);
+    }
+    BoxEnd(box);
+    size_t dinf = BoxStart("dinf");
+    box = FullBoxStart("dref", 0);
+    Put32(1);
+    BoxEnd(FullBoxStart("url ", 1));
+    BoxEnd(box);
+    BoxEnd(dinf);
+
+    size_t stbl = BoxStart("stbl");
+    box = FullBoxStart("stsd", 0);
+    Put32(1);
+    size_t entry = BoxStart(video ? "mp4v" : "mp4a");
+    PutZero(6); Put16(1);
+    if (video)
+    {
+        PutZero(16);
+        Put16(320); Put16(240);
+        Put32(0x480000); Put32(0x480000); Put32(0);
+        Put16(1); PutZero(32); Put16(0x18); Put16(0xffff);
+    }
+    else
+    {
+        PutZero(8);
+        Put16(2); Put16(16); Put16(0); Put16(0);
+        Put32(44100 << 16);
+    }
+    BoxEnd(entry);
+    BoxEnd(box);
+
+    box = FullBoxStart("stts", 0);
+    Put32(1); Put32(count); Put32(1);
+    BoxEnd(box);
+    /* One sample per chunk */
+    box = FullBoxStart("stsc", 0);
+    Put32(1); Put32(1); Put32(1); Put32(1);
+    BoxEnd(box);
+    box = FullBoxStart("stsz", 0);
+    Put32(0); Put32(count);
+    for (unsigned i = 0; i < count; i++)
+        Put32(size(i));
+    BoxEnd(box);
+    box = FullBoxStart("stco", 0);
+    Put32(count);
+    for (unsigned i = 0; i < count; i++)
+        Put32(offsets[i]);
+    BoxEnd(box);
+    BoxEnd(stbl);
+
+    BoxEnd(minf);
+    BoxEnd(mdia);
+    BoxEnd(trak);
+}
+
+static void WriteFile(void)
+{
+    static uint32_t video_offsets[VIDEO_SAMPLES];
+    static uint32_t audio_offsets[AUDIO_SAMPLES];
+
+    size_t box = BoxStart("ftyp");
+    Put("isom", 4); Put32(0x200); Put("isommp41", 8);
+    BoxEnd(box);
+
+    /* All the video samples, then all the audio samples */
+    box = BoxStart("mdat");
+    for (unsigned i = 0; i < VIDEO_SAMPLES; i++)
+    {
+        video_offsets[i] = file.size;
+        for (uint32_t j = 0; j < VideoSampleSize(i); j++)
+            Put8(Pattern(1, i, j));
+    }
+    for (unsigned i = 0; i < AUDIO_SAMPLES; i++)
+    {
+        audio_offsets[i] = file.size;
+        for (uint32_t j = 0; j < AudioSampleSize(i); j++)
+            Put8(Pattern(2, i, j));
+    }
+    BoxEnd(box);
+
+    size_t moov = BoxStart("moov");
+    box = FullBoxStart("mvhd", 0);
+    Put32(0); Put32(0); Put32(1000); Put32(DURATION * 1000);
+    Put32(0x10000); Put16(0x100); PutZero(10);
+    PutMatrix();
+    PutZero(24); Put32(3);
+    BoxEnd(box);
+    PutTrack(1, true, VIDEO_SAMPLES, VideoSampleSize, video_offsets);
+    PutTrack(2, false, AUDIO_SAMPLES, AudioSampleSize, audio_offsets);
+    BoxEnd(moov);
+}
+
+/*
+ * Delayed access
+ */
+struct access_sys
+{
+    uint64_t offset;
+    bool request; /**< a new range request is pending */
+};
+
+static ssize_t AccessRead(stream_t *access, void *buf, size_t len)
+{
+    struct access_sys *sys = access->p_sys;
+
+    if (sys->offset >= file.size)
+        return 0;
+    if (len > file.size - sys->offset)
+        len = file.size - sys->offset;
+
+    vlc_tick_t delay = len * CLOCK_FREQ / BANDWIDTH;
+    if (sys->request)
+    {   /* Round trip to the server */
+        delay += LATENCY;
+        sys->request = false;
+    }
+    if (vlc_msleep_i11e(delay))
+        return -1;
+
+    memcpy(buf, file.data + sys->offset, len);
+    sys->offset += len;
+    upstream.bytes += len;
+    return len;
+}
+
+static int AccessSeek(stream_t *access, uint64_t offset)
+{
+    struct access_sys *sys = access->p_sys;
+
+    sys->offset = offset;
+    sys->request = true;
+    upstream.seeks++;
+    return VLC_SUCCESS;
+}
+
+static int AccessControl(stream_t *access, int query, va_list args)
+{
+    (void) access;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = true;
+            break;
+        case STREAM_CAN_FASTSEEK:
+            *va_arg(args, bool *) = false;
+            break;
+        case STREAM_GET_SIZE:
+            *va_arg(args, uint64_t *) = file.size;
+            break;
+        case STREAM_GET_PTS_DELAY:
+            *va_arg(args, vlc_tick_t *) = VLC_TICK_FROM_MS(300);
+            break;
+        case STREAM_SET_PAUSE_STATE:
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int OpenAccess(vlc_object_t *obj)
+{
+    stream_t *access = (stream_t *)obj;
+    struct access_sys *sys = vlc_obj_malloc(obj, sizeof (*sys));
+
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->offset = 0;
+    sys->request = true;
+    access->p_sys = sys;
+    access->pf_read = AccessRead;
+    access->pf_seek = AccessSeek;
+    access->pf_control = AccessControl;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_callback(OpenAccess)
+    set_capability("access", 0)
+    add_shortcut("delayed")
+vlc_module_end()
+
+VLC_EXPORT const vlc_plugin_cb vlc_static_modules[] = {
+    VLC_SYMBOL(vlc_entry),
+    NULL
+};
+
+/*
+ * Output checking the samples
+ */
+struct es_out_id_t
+{
+    unsigned track;
+    unsigned samples;
+};
+
+static struct es_out_id_t tracks[2];
+static vlc_tick_t first_frame;
+
+static es_out_id_t *EsOutAdd(es_out_t *out, input_source_t *in,
+                             const es_format_t *fmt)
+{
+    (void) out; (void) in;
+
+    es_out_id_t *id = &tracks[fmt->i_cat == VIDEO_ES ? 0 : 1];
+    id->track = fmt->i_cat == VIDEO_ES ? 1 : 2;
+    id->samples = 0;
+    return id;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    (void) out;
+
+    if (first_frame == VLC_TICK_INVALID)
+        first_frame = vlc_tick_now();
+
+    uint32_t size = id->track == 1 ? VideoSampleSize(id->samples)
+                                   : AudioSampleSize(id->samples);
+    assert(block->i_buffer == size);
+    for (size_t i = 0; i < block->i_buffer; i++)
+        assert(block->p_buffer[i] == Pattern(id->track, id->samples, i));
+    id->samples++;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDelete(es_out_t *out, es_out_id_t *id)
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl(es_out_t *out, input_source_t *in, int query,
+                        va_list args)
+{
+    (void) out; (void) in;
+
+    switch (query)
+    {
+        case ES_OUT_GET_ES_STATE:
+            (void) va_arg(args, es_out_id_t *);
+            *va_arg(args, bool *) = true;
+            break;
+        case ES_OUT_IS_EMPTY:
+            *va_arg(args, bool *) = true;
+            break;
+        default:
+            break;
+    }
+    return VLC_SUCCESS;
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+static const struct es_out_callbacks es_out_cbs = {
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDelete,
+    .control = EsOutControl,
+    .destroy = EsOutDestroy,
+};
+
+/* Follows the statistics reported by the cache on close */
+static void Log(void *data, int level, const libvlc_log_t *ctx,
+                const char *fmt, va_list ap)
+{
+    const char *module, *file_name;
+    unsigned line;
+    char msg[512];
+
+    (void) data; (void) level;
+    libvlc_log_get_context(ctx, &module, &file_name, &line);
+    if (module == NULL || strcmp(module, "cache_read"))
+        return;
+
+    vsnprintf(msg, sizeof (msg), fmt, ap);
+
+    const char *p = strstr(msg, "KiB in ");
+    if (p != NULL && (p = strstr(p, "ms, ")) != NULL)
+        spills = strtoull(p + 4, NULL, 10);
+}
+
+static void DemuxAll(demux_t *demux)
+{
+    int val;
+
+    tracks[0].samples = tracks[1].samples = 0;
+    while ((val = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS);
+    assert(val == VLC_DEMUXER_EOF);
+    assert(tracks[0].samples == VIDEO_SAMPLES);
+    assert(tracks[1].samples == AUDIO_SAMPLES);
+}
+
+struct scenario
+{
+    const char *name;
+    const char *memory; /**< cache memory option */
+    const char *disk; /**< cache disk option */
+    bool retained; /**< whether the whole file can be retained */
+    bool spilled; /**< whether blocks are written to disk */
+};
+
+static void RunScenario(const struct scenario *scenario)
+{
+    /* The read-ahead buffer is smaller than the file, as with long media */
+    const char *args[] = {
+        "-vv", "--vout=vdummy", "--aout=adummy", "--text-renderer=tdummy",
+        "--prefetch-buffer-size=1024", "--stream-cache",
+        scenario->memory, scenario->disk,
+    };
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+    libvlc_log_set(vlc, Log, NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    es_out_t out = { .cbs = &es_out_cbs };
+
+    memset(&upstream, 0, sizeof (upstream));
+    spills = 0;
+    first_frame = VLC_TICK_INVALID;
+
+    const vlc_tick_t start = vlc_tick_now();
+
+    /* The cache and prefetch filters are inserted as the access can seek,
+     * but not fast, as with HTTP, and the cache is enabled */
+    stream_t *stream = vlc_stream_NewURL(obj, "delayed://");
+    assert(stream != NULL);
+
+    demux_t *demux = demux_New(obj, "mp4", "delayed://", stream, &out);
+    assert(demux != NULL);
+    const vlc_tick_t opened = vlc_tick_now();
+    const unsigned long open_seeks = upstream.seeks;
+
+    DemuxAll(demux);
+    const vlc_tick_t end = vlc_tick_now();
+    const unsigned long seeks = upstream.seeks;
+    const uint64_t bytes = upstream.bytes;
+
+    /* Play again from the start */
+    assert(demux_Control(demux, DEMUX_SET_POSITION, 0., true) == VLC_SUCCESS);
+    DemuxAll(demux);
+    const vlc_tick_t replay = vlc_tick_now() - end;
+
+    demux_Delete(demux); /* also deletes the stream */
+    libvlc_release(vlc);
+
+    printf("%s: opened in %"PRId64" ms (%lu seeks), first frame after "
+           "%"PRId64" ms, demuxed in %"PRId64" ms (%lu seeks, %"PRIu64" KiB "
+           "read, file: %zu KiB), replayed in %"PRId64" ms (%lu seeks, "
+           "%"PRIu64" KiB read), %"PRIu64" spills\n", scenario->name,
+           MS_FROM_VLC_TICK(opened - start), open_seeks,
+           MS_FROM_VLC_TICK(first_frame - start),
+           MS_FROM_VLC_TICK(end - start), seeks, bytes >> 10,
+           file.size >> 10, MS_FROM_VLC_TICK(replay),
+           upstream.seeks - seeks, (upstream.bytes - bytes) >> 10, spills);
+
+    /* Jumping back from the index to the data costs no round trip */
+    assert(open_seeks == 1);
+    assert(seeks == 2);
+    if (scenario->retained)
+    {   /* The data is read from the server only once */
+        assert(bytes == file.size);
+        assert(upstream.seeks == seeks);
+        assert(upstream.bytes == bytes);
+    }
+    assert((spills > 0) == scenario->spilled);
+}
+
+static const struct scenario scenarios[] = {
+    {   /* Everything fits in memory */
+        .name = "memory",
+        .memory = "--cache-read-memory=16384",
+        .disk = "--cache-read-disk=0",
+        .retained = true,
+    },
+    {   /* Blocks go back and forth from the disk */
+        .name = "disk",
+        .memory = "--cache-read-memory=256",
+        .disk = "--cache-read-disk=16",
+        .retained = true,
+        .spilled = true,
+    },
+    {   /* Blocks are dropped */
+        .name = "small",
+        .memory = "--cache-read-memory=64",
+        .disk = "--cache-read-disk=0",
+        .retained = false,
+    },
+};
+
+int main(void)
+{
+    test_init();
+
+    WriteFile();
+
+    for (size_t i = 0; i < ARRAY_SIZE(scenarios); i++)
+        RunScenario(&scenarios[i]);
+
+    free(file.data);
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*****************************************************************************
+ * prefetch.c: prefetch stream filter benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* Define a builtin module for the throttled access */
+#define MODULE_NAME test_prefetch
+#undef VLC_DYNAMIC_PLUGIN
+
+#include "../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_interrupt.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+#include <vlc_tick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/libvlc_internal.h"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+/*
+ * The prefetch filter reads from a local access that emulates a network
+ * source, with a fixed latency per request and a limited bandwidth. The
+ * consumer reads at a constant rate, as a demuxer would, and regularly seeks
+ * a few kilobytes backward.
+ */
+
+#define SOURCE_SIZE (UINT64_C(1) << 30)
+#define CHUNK_SIZE 4096
+
+struct scenario
+{
+    const char *name;
+    uint64_t bandwidth; /**< upstream bytes per second */
+    vlc_tick_t latency; /**< upstream latency per request */
+    uint64_t rate; /**< consumption bytes per second */
+    vlc_tick_t duration;
+};
+
+static const struct scenario *scenario;
+
+static struct
+{
+    unsigned long requests;
+    unsigned long seeks;
+    uint64_t bytes;
+    size_t max_request;
+} upstream;
+
+static uint8_t Pattern(uint64_t offset)
+{
+    return offset ^ (offset >> 8) ^ (offset >> 16);
+}
+
+static ssize_t AccessRead(stream_t *access, void *buf, size_t len)
+{
+    uint64_t *offset = access->p_sys;
+
+    if (*offset >= SOURCE_SIZE)
+        return 0;
+    if (len > SOURCE_SIZE - *offset)
+        len = SOURCE_SIZE - *offset;
+
+    if (vlc_msleep_i11e(scenario->latency
+                      + len * CLOCK_FREQ / scenario->bandwidth))
+        return -1;
+
+    uint8_t *p = buf;
+    for (size_t i = 0; i < len; i++)
+        p[i] = Pattern(*offset + i);
+
+    *offset += len;
+    upstream.requests++;
+    upstream.bytes += len;
+    if (len > upstream.max_request)
+        upstream.max_request = len;
+    return len;
+}
+
+static int AccessSeek(stream_t *access, uint64_t offset)
+{
+    if (vlc_msleep_i11e(scenario->latency))
+        return VLC_EGENERIC;
+
+    *(uint64_t *)access->p_sys = offset;
+    upstream.seeks++;
+    return VLC_SUCCESS;
+}
+
+static int AccessControl(stream_t *access, int query, va_list args)
+{
+    (void) access;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = true;
+            break;
+        case STREAM_CAN_FASTSEEK:
+            *va_arg(args, bool *) = false;
+            break;
+        case STREAM_GET_SIZE:
+            *va_arg(args, uint64_t *) = SOURCE_SIZE;
+            break;
+        case STREAM_GET_PTS_DELAY:
+            *va_arg(args, vlc_tick_t *) = VLC_TICK_FROM_MS(300);
+            break;
+        case STREAM_SET_PAUSE_STATE:
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int OpenAccess(vlc_object_t *obj)
+{
+    stream_t *access = (stream_t *)obj;
+    uint64_t *offset = vlc_obj_malloc(obj, sizeof (*offset));
+
+    if (unlikely(offset == NULL))
+        return VLC_ENOMEM;
+
+    *offset = 0;
+    access->p_sys = offset;
+    access->pf_read = AccessRead;
+    access->pf_seek = AccessSeek;
+    access->pf_control = AccessControl;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_callback(OpenAccess)
+    set_capability("access", 0)
+    add_shortcut("throttle")
+vlc_module_end()
+
+VLC_EXPORT const vlc_plugin_cb vlc_static_modules[] = {
+    VLC_SYMBOL(vlc_entry),
+    NULL
+};
+
+static void RunScenario(vlc_object_t *obj, const struct scenario *s)
+{
+    scenario = s;
+    memset(&upstream, 0, sizeof (upstream));
+
+    /* The prefetch filter is inserted as the access cannot seek fast */
+    stream_t *stream = vlc_stream_NewURL(obj, "throttle://");
+    assert(stream != NULL);
+
+    const uint64_t total = s->rate * s->duration / CLOCK_FREQ;
+    uint8_t buf[CHUNK_SIZE];
+    uint64_t offset = 0;
+    unsigned reads = 0;
+    const vlc_tick_t start = vlc_tick_now();
+
+    while (offset < total)
+    {
+        /* Consume at a constant rate */
+        vlc_tick_wait(start + vlc_tick_from_samples(offset, s->rate));
+
+        ssize_t val = vlc_stream_Read(stream, buf, sizeof (buf));
+        assert(val == (ssize_t)sizeof (buf));
+        for (size_t i = 0; i < sizeof (buf); i++)
+            assert(buf[i] == Pattern(offset + i));
+        offset += val;
+
+        if (++reads % 64 == 0)
+        {   /* Resynchronize a few kilobytes backward */
+            offset -= 3 * CHUNK_SIZE;
+            assert(vlc_stream_Seek(stream, offset) == VLC_SUCCESS);
+        }
+    }
+
+    /* The counters of the prefetch filter */
+    struct vlc_stream_prefetch_stats stats;
+    assert(vlc_stream_Control(stream, STREAM_GET_PREFETCH_STATS,
+                              &stats) == VLC_SUCCESS);
+    vlc_stream_Delete(stream);
+
+    /* The stall time depends on the load of the machine: it is only
+     * reported. */
+    printf("%s: %"PRIu64" KiB consumed, %"PRIu64" reads, %"PRIu64" stalls "
+           "(%"PRId64" ms), %lu requests (%"PRIu64" KiB average, "
+           "%zu KiB max), %lu seeks, buffer size: %"PRIu64" KiB\n", s->name,
+           total >> 10, stats.reads, stats.stalls,
+           MS_FROM_VLC_TICK(stats.stall_time), upstream.requests,
+           (upstream.bytes / upstream.requests) >> 10,
+           upstream.max_request >> 10, upstream.seeks,
+           stats.buffer_size >> 10);
+
+    assert(stats.reads >= reads);
+    assert(stats.hits + stats.stalls == stats.reads);
+    assert(stats.buffer_size > 0);
+    /* Short backward seeks are served from the retained data */
+    assert(stats.seeks == 0);
+    assert(upstream.seeks == 0);
+}
+
+static const struct scenario scenarios[] = {
+    {
+        .name = "audio",
+        .bandwidth = 1 << 20,
+        .latency = VLC_TICK_FROM_MS(50),
+        .rate = 32 << 10,
+        .duration = VLC_TICK_FROM_SEC(2),
+    },
+    {
+        .name = "video",
+        .bandwidth = 16 << 20,
+        .latency = VLC_TICK_FROM_MS(20),
+        .rate = 4 << 20,
+        .duration = VLC_TICK_FROM_MS(2500),
+    },
+};
+
+int main(void)
+{
+    static const char *const args[] = {
+        "-vv", "--vout=vdummy", "--aout=adummy", "--text-renderer=tdummy",
+    };
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    for (size_t i = 0; i < ARRAY_SIZE(scenarios); i++)
+        RunScenario(obj, &scenarios[i]);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,461 @@
+/*****************************************************************************
+ * low_latency.c: HLS low-latency (partial segments) end-to-end test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* Define a builtin module for the mocked muxer */
+#define MODULE_NAME test_hls_low_latency
+#undef VLC_DYNAMIC_PLUGIN
+
+#include "../../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_network.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_tick.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../lib/libvlc_internal.h"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+/*
+ * The HLS output is fed with frames in real time, and followed by a client
+ * that behaves as a low-latency HLS player: it requests the part announced by
+ * the preload hint, which the server holds until the part is muxed, then
+ * reloads the playlist with the blocking reload directives.
+ *
+ * Each frame carries its number, so that the client can compute the latency
+ * of every frame, from its submission to the HLS output to its reception.
+ */
+
+#define FRAME_LENGTH VLC_TICK_FROM_MS(40)
+#define FRAME_SIZE 1500
+#define GOP_FRAMES 25
+#define FRAMES 125
+#define PART_LENGTH VLC_TICK_FROM_MS(500)
+#define SEGMENT_LENGTH VLC_TICK_FROM_SEC(2)
+
+static const char frame_magic[4] = { 'V', 'L', 'C', 'F' };
+
+static _Atomic vlc_tick_t sent_dates[FRAMES];
+
+/*
+ * Mocked "ts" muxer: every frame is written as is, with the header flag set
+ * on the synchronization frames, as the TS muxer does with use-key-frames.
+ */
+static int MuxControl(sout_mux_t *mux, int query, va_list args)
+{
+    (void)mux;
+    switch (query)
+    {
+        case MUX_CAN_ADD_STREAM_WHILE_MUXING:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static int MuxAddStream(sout_mux_t *mux, sout_input_t *input)
+{
+    (void)mux; (void)input;
+    return VLC_SUCCESS;
+}
+
+static void MuxDelStream(sout_mux_t *mux, sout_input_t *input)
+{
+    (void)mux; (void)input;
+}
+
+static int Mux(sout_mux_t *mux)
+{
+    for (int i = 0; i < mux->i_nb_inputs; i++)
+    {
+        vlc_fifo_t *fifo = mux->pp_inputs[i]->p_fifo;
+        vlc_fifo_Lock(fifo);
+        block_t *chain = vlc_fifo_DequeueAllUnlocked(fifo);
+        vlc_fifo_Unlock(fifo);
+
+        while (chain != NULL)
+        {
+            block_t *block = chain;
+            chain = block->p_next;
+            block->p_next = NULL;
+            block->i_flags = (block->i_flags & BLOCK_FLAG_TYPE_I)
+                                 ? BLOCK_FLAG_HEADER : 0;
+            if (sout_AccessOutWrite(mux->p_access, block) < 0)
+            {
+                block_ChainRelease(chain);
+                return VLC_EGENERIC;
+            }
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+static int OpenMux(vlc_object_t *obj)
+{
+    sout_mux_t *mux = (sout_mux_t *)obj;
+
+    mux->pf_control = MuxControl;
+    mux->pf_addstream = MuxAddStream;
+    mux->pf_delstream = MuxDelStream;
+    mux->pf_mux = Mux;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_callback(OpenMux)
+    set_capability("sout mux", INT_MAX)
+    add_shortcut("ts")
+vlc_module_end()
+
+VLC_EXPORT const vlc_plugin_cb vlc_static_modules[] = {
+    VLC_SYMBOL(vlc_entry),
+    NULL
+};
+
+struct feeder
+{
+    sout_stream_t *stream;
+    void *id;
+};
+
+static void *FeedThread(void *data)
+{
+    struct feeder *feeder = data;
+    const vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned n = 0; n < FRAMES; n++)
+    {
+        vlc_tick_wait(start + n * FRAME_LENGTH);
+
+        block_t *frame = block_Alloc(FRAME_SIZE);
+        assert(frame != NULL);
+        memset(frame->p_buffer, 0, FRAME_SIZE);
+        memcpy(frame->p_buffer, frame_magic, sizeof (frame_magic));
+        memcpy(frame->p_buffer + sizeof (frame_magic), &n, sizeof (n));
+        frame->i_dts = frame->i_pts = VLC_TICK_0 + n * FRAME_LENGTH;
+        frame->i_length = FRAME_LENGTH;
+        if (n % GOP_FRAMES == 0)
+            frame->i_flags |= BLOCK_FLAG_TYPE_I;
+
+        atomic_store_explicit(&sent_dates[n], vlc_tick_now(),
+                              memory_order_relaxed);
+        assert(sout_StreamIdSend(feeder->stream, feeder->id, frame)
+               == VLC_SUCCESS);
+        sout_StreamSetPCR(feeder->stream, VLC_TICK_0 + n * FRAME_LENGTH);
+    }
+
+    /* End the playlist: it is removed from the server along with its parts */
+    sout_StreamIdDel(feeder->stream, feeder->id);
+    return NULL;
+}
+
+/* Fetches a resource, returns the HTTP status code and, unless body is
+ * NULL, the body to free */
+static int Get(uint16_t port, const char *path, char **body, size_t *len)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = vlc_socket(AF_INET, SOCK_STREAM, 0, false);
+    assert(fd != -1);
+    assert(connect(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+
+    char req[256];
+    int reqlen = snprintf(req, sizeof (req), "GET %s HTTP/1.1\r\n"
+                          "Host: 127.0.0.1\r\nConnection: close\r\n\r\n",
+                          path);
+    assert(send(fd, req, reqlen, MSG_NOSIGNAL) == reqlen);
+
+    /* The connection is closed after the answer */
+    size_t size = 0, alloc = 4096;
+    char *buf = malloc(alloc);
+    assert(buf != NULL);
+    for (;;)
+    {
+        if (size + 1 == alloc)
+        {
+            alloc *= 2;
+            buf = realloc(buf, alloc);
+            assert(buf != NULL);
+        }
+        ssize_t val = recv(fd, buf + size, alloc - size - 1, 0);
+        if (val < 0 && errno == EINTR)
+            continue;
+        if (val <= 0)
+            break;
+        size += val;
+    }
+    vlc_close(fd);
+    buf[size] = '\0';
+
+    int status = 0;
+    if (sscanf(buf, "HTTP/1.%*u %d", &status) != 1)
+        status = 0;
+
+    const char *head_end = strstr(buf, "\r\n\r\n");
+    assert(head_end != NULL);
+
+    if (body == NULL)
+    {
+        free(buf);
+        return status;
+    }
+
+    *len = size - (head_end + 4 - buf);
+    *body = malloc(*len + 1);
+    assert(*body != NULL);
+    memcpy(*body, head_end + 4, *len);
+    (*body)[*len] = '\0';
+    free(buf);
+    return status;
+}
+
+/* Finds the part announced by the preload hint */
+static bool ParseHint(const char *playlist, unsigned *msn, unsigned *part)
+{
+    const char *hint = strstr(playlist, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=");
+    return hint != NULL
+        && sscanf(hint, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"/playlist-0-%u.%u.ts",
+                  msn, part) == 2;
+}
+
+/* Checks the durations of the parts and segments of a playlist */
+static unsigned CheckPlaylist(const char *playlist)
+{
+    const double target = secf_from_vlc_tick(PART_LENGTH);
+    double part_target, hold_back;
+    unsigned segment_target, parts = 0;
+
+    assert(strstr(playlist, "CAN-BLOCK-RELOAD=YES") != NULL);
+    const char *tag = strstr(playlist, "PART-HOLD-BACK=");
+    assert(tag != NULL && sscanf(tag, "PART-HOLD-BACK=%lf", &hold_back) == 1);
+    tag = strstr(playlist, "#EXT-X-PART-INF:PART-TARGET=");
+    assert(tag != NULL
+        && sscanf(tag, "#EXT-X-PART-INF:PART-TARGET=%lf", &part_target) == 1);
+    tag = strstr(playlist, "#EXT-X-TARGETDURATION:");
+    assert(tag != NULL
+        && sscanf(tag, "#EXT-X-TARGETDURATION:%u", &segment_target) == 1);
+    assert(part_target == target);
+    assert(hold_back >= 3 * part_target);
+
+    double parts_duration = 0., last_duration = 0.;
+    bool last_independent = true;
+
+    for (const char *line = playlist; line != NULL; line = strchr(line, '\n'))
+    {
+        line += (*line == '\n');
+
+        double duration;
+        if (sscanf(line, "#EXT-X-PART:DURATION=%lf", &duration) == 1)
+        {
+            /* Only the last part of a segment, or an independent one, can
+             * be shorter than 85% of the part target (RFC 8216bis 4.4.4.9) */
+            assert(duration <= part_target + 0.001);
+            assert(last_independent || last_duration >= 0.85 * part_target);
+            last_duration = duration;
+            last_independent = strstr(line, "INDEPENDENT=YES") != NULL
+                && strstr(line, "INDEPENDENT=YES") < strchr(line, '\n');
+            parts_duration += duration;
+            parts++;
+        }
+        else if (sscanf(line, "#EXTINF:%lf", &duration) == 1)
+        {
+            assert(duration <= segment_target);
+            /* A segment is made of the parts listed before it */
+            if (parts_duration > 0.)
+                assert(duration > parts_duration - 0.02
+                    && duration < parts_duration + 0.02);
+            parts_duration = 0.;
+            last_independent = true;
+        }
+    }
+    return parts;
+}
+
+static int CompareTick(const void *a, const void *b)
+{
+    vlc_tick_t x = *(const vlc_tick_t *)a, y = *(const vlc_tick_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void RunClient(uint16_t port)
+{
+    static vlc_tick_t latencies[FRAMES];
+    bool received[FRAMES] = { false };
+    unsigned count = 0, part_count = 0, checked_parts = 0, part_frames = 0;
+    vlc_tick_t first_part = VLC_TICK_INVALID, last_part = VLC_TICK_INVALID;
+    char path[128];
+    char *body;
+    size_t len;
+
+    /* Wait for the playlist to be created */
+    int status;
+    status = Get(port, "/playlist-0-index.m3u8", &body, &len);
+    assert(status == 200);
+
+    for (;;)
+    {
+        unsigned msn, part;
+        assert(ParseHint(body, &msn, &part));
+        unsigned parts = CheckPlaylist(body);
+        if (parts > checked_parts)
+            checked_parts = parts;
+        free(body);
+
+        /* The hinted part is held until it is muxed. Once the playlist
+         * ended, it is removed from the server along with its parts. */
+        snprintf(path, sizeof (path), "/playlist-0-%u.%u.ts", msn, part);
+        status = Get(port, path, &body, &len);
+        if (status == 404)
+            break;
+        assert(status == 200);
+
+        const vlc_tick_t now = vlc_tick_now();
+        if (first_part == VLC_TICK_INVALID)
+            first_part = now;
+        last_part = now;
+        part_count++;
+
+        unsigned frames = 0;
+        for (const char *p = body; p + 8 <= body + len; p++)
+        {
+            unsigned n;
+            if (memcmp(p, frame_magic, sizeof (frame_magic)))
+                continue;
+            memcpy(&n, p + sizeof (frame_magic), sizeof (n));
+            assert(n < FRAMES && !received[n]);
+            received[n] = true;
+            latencies[count++] = now
+                - atomic_load_explicit(&sent_dates[n], memory_order_relaxed);
+            frames++;
+        }
+        if (part_frames < frames)
+            part_frames = frames;
+        free(body);
+        body = NULL;
+
+        /* Far future segments are refused rather than waited for */
+        snprintf(path, sizeof (path),
+                 "/playlist-0-index.m3u8?_HLS_msn=%u", msn + 10);
+        status = Get(port, path, NULL, NULL);
+        if (status == 404)
+            break;
+        assert(status == 400);
+
+        /* The blocking reload answers once the part is in the playlist */
+        snprintf(path, sizeof (path),
+                 "/playlist-0-index.m3u8?_HLS_msn=%u&_HLS_part=%u", msn, part);
+        status = Get(port, path, &body, &len);
+        if (status == 404)
+            break;
+        assert(status == 200);
+        snprintf(path, sizeof (path), "/playlist-0-%u.%u.ts", msn, part);
+        assert(strstr(body, path) != NULL);
+    }
+    free(body);
+
+    /* All the frames were received, but the ones of the last parts, that
+     * can be removed along with the playlist before they are requested */
+    assert(count >= FRAMES - 2 * (PART_LENGTH / FRAME_LENGTH) - 1);
+    assert(part_count > 2 && checked_parts > 2);
+
+    qsort(latencies, count, sizeof (*latencies), CompareTick);
+    const vlc_tick_t p50 = latencies[count / 2];
+    const vlc_tick_t max = latencies[count - 1];
+    const vlc_tick_t interval = (last_part - first_part) / (part_count - 1);
+
+    printf("%u parts, every %"PRId64" ms, %u frames latency: "
+           "p50 %"PRId64" ms, max %"PRId64" ms\n", part_count,
+           MS_FROM_VLC_TICK(interval), count, MS_FROM_VLC_TICK(p50),
+           MS_FROM_VLC_TICK(max));
+
+    /* The frames are served part by part, not segment by segment. The
+     * latencies depend on the load of the machine, so they are only
+     * reported. */
+    assert(part_frames > 0);
+    assert(part_frames <= (PART_LENGTH + FRAME_LENGTH - 1) / FRAME_LENGTH);
+}
+
+int main(void)
+{
+#ifndef ENABLE_SOUT
+    return 77;
+#endif
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = vlc_object_create(vlc->p_libvlc_int, sizeof (*obj));
+    assert(obj != NULL);
+
+    uint16_t port = 20000 + getpid() % 20000;
+    var_Create(obj, "http-host", VLC_VAR_STRING);
+    var_SetString(obj, "http-host", "127.0.0.1");
+    var_Create(obj, "http-port", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "http-port", port);
+    /* Mux the frames as they come */
+    var_Create(obj, "sout-mux-caching", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "sout-mux-caching", 0);
+
+    char chain[256];
+    snprintf(chain, sizeof (chain), "hls{variants=\"{video/1}\",host-http,"
+             "seg-len=%"PRId64",part-len=%"PRId64"}",
+             SEC_FROM_VLC_TICK(SEGMENT_LENGTH), MS_FROM_VLC_TICK(PART_LENGTH));
+    sout_stream_t *stream = sout_StreamChainNew(obj, chain, NULL);
+    assert(stream != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_H264);
+    fmt.video.i_width = fmt.video.i_visible_width = 640;
+    fmt.video.i_height = fmt.video.i_visible_height = 360;
+    fmt.video.i_frame_rate = 25;
+    fmt.video.i_frame_rate_base = 1;
+
+    struct feeder feeder = { .stream = stream };
+    feeder.id = sout_StreamIdAdd(stream, &fmt, "video/1");
+    assert(feeder.id != NULL);
+
+    vlc_thread_t thread;
+    assert(vlc_clone(&thread, FeedThread, &feeder) == 0);
+    RunClient(port);
+    vlc_join(thread, NULL);
+
+    sout_StreamChainDelete(stream, NULL);
+    vlc_object_delete(obj);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*****************************************************************************
+ * storage.c: HLS segment storage unit tests
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+
+#include "../../../../modules/stream_out/hls/hls.h"
+#include "../../../../modules/stream_out/hls/storage.h"
+
+const char vlc_module_name[] = "test_hls_storage";
+
+#define SEGMENT_SIZE 100000
+
+static block_t *MakeSegment(uint8_t seed)
+{
+    /* A segment is muxed as a chain of TS packet blocks */
+    block_t *chain = NULL;
+    block_t **last = &chain;
+    size_t offset = 0;
+
+    while (offset < SEGMENT_SIZE)
+    {
+        const size_t size = __MIN(7 * 188, SEGMENT_SIZE - offset);
+        block_t *block = block_Alloc(size);
+        assert(block != NULL);
+        for (size_t i = 0; i < size; ++i)
+            block->p_buffer[i] = seed + (offset + i) * 3;
+        offset += size;
+        block_ChainLastAppend(&last, block);
+    }
+    return chain;
+}
+
+static void CheckContent(const block_t *content, uint8_t seed)
+{
+    assert(content->i_buffer == SEGMENT_SIZE);
+    for (size_t i = 0; i < SEGMENT_SIZE; ++i)
+        assert(content->p_buffer[i] == (uint8_t)(seed + i * 3));
+}
+
+static void TestSharedContent(const struct hls_config *config)
+{
+    const struct hls_storage_config storage_config = {
+        .name = "playlist-0-0.ts",
+        .mime = "video/MP2T",
+    };
+    hls_storage_t *storage =
+        hls_storage_FromBlocks(MakeSegment(1), &storage_config, config);
+    assert(storage != NULL);
+    assert(hls_storage_GetSize(storage) == SEGMENT_SIZE);
+    assert(strcmp(storage->mime, "video/MP2T") == 0);
+
+    struct hls_storage_stats stats;
+    hls_storage_GetStats(storage, &stats);
+    assert(stats.hits == 0 && stats.bytes == 0);
+
+    /* Every client is served the same data, without any copy */
+    block_t *first = storage->get_content(storage);
+    block_t *second = storage->get_content(storage);
+    assert(first != NULL && second != NULL);
+    assert(first->p_buffer == second->p_buffer);
+    CheckContent(first, 1);
+
+    hls_storage_GetStats(storage, &stats);
+    assert(stats.hits == 2);
+    assert(stats.bytes == 2 * SEGMENT_SIZE);
+
+    /* The segment leaves the playlist while being served */
+    hls_storage_Destroy(storage);
+    CheckContent(second, 1);
+    block_Release(second);
+    CheckContent(first, 1);
+    block_Release(first);
+}
+
+static void TestRewrite(const struct hls_config *config)
+{
+    const struct hls_storage_config storage_config = {
+        .name = "playlist-0.m3u8",
+        .mime = "application/vnd.apple.mpegurl",
+    };
+
+    hls_storage_t *old =
+        hls_storage_FromBlocks(MakeSegment(2), &storage_config, config);
+    assert(old != NULL);
+    block_t *old_content = old->get_content(old);
+    assert(old_content != NULL);
+
+    /* The manifest is replaced while the previous version is being served */
+    hls_storage_t *new =
+        hls_storage_FromBlocks(MakeSegment(3), &storage_config, config);
+    assert(new != NULL);
+    hls_storage_Destroy(old);
+    CheckContent(old_content, 2);
+    block_Release(old_content);
+
+    block_t *new_content = new->get_content(new);
+    assert(new_content != NULL);
+    CheckContent(new_content, 3);
+    block_Release(new_content);
+    hls_storage_Destroy(new);
+
+    if (hls_config_IsMemStorageEnabled(config))
+        return;
+
+    /* The file holds the last version, and was written aside */
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", config->outdir, storage_config.name);
+    block_t *file = block_FilePath(path, false);
+    assert(file != NULL);
+    CheckContent(file, 3);
+    block_Release(file);
+
+    strcat(path, ".tmp");
+    assert(vlc_unlink(path) != 0);
+}
+
+static void TestBytes(const struct hls_config *config)
+{
+    const struct hls_storage_config storage_config = {
+        .name = "stream.m3u8",
+        .mime = "application/vnd.apple.mpegurl",
+    };
+    static const char manifest[] = "#EXTM3U\n";
+
+    char *bytes = strdup(manifest);
+    assert(bytes != NULL);
+    hls_storage_t *storage = hls_storage_FromBytes(
+        bytes, strlen(manifest), &storage_config, config);
+    assert(storage != NULL);
+    assert(hls_storage_GetSize(storage) == strlen(manifest));
+
+    block_t *content = storage->get_content(storage);
+    assert(content != NULL);
+    assert(content->i_buffer == strlen(manifest));
+    assert(memcmp(content->p_buffer, manifest, strlen(manifest)) == 0);
+    block_Release(content);
+    hls_storage_Destroy(storage);
+}
+
+static void RunTests(const struct hls_config *config)
+{
+    TestSharedContent(config);
+    TestRewrite(config);
+    TestBytes(config);
+}
+
+int main(void)
+{
+    struct hls_config config = {
+        .outdir = NULL,
+    };
+
+    RunTests(&config);
+
+    char outdir[] = "/tmp/vlc-hls-XXXXXX";
+    config.outdir = mkdtemp(outdir);
+    assert(config.outdir != NULL);
+
+    RunTests(&config);
+
+    static const char *const files[] = {
+        "playlist-0-0.ts", "playlist-0.m3u8", "stream.m3u8",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(files); ++i)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", outdir, files[i]);
+        assert(vlc_unlink(path) == 0);
+    }
+    assert(rmdir(outdir) == 0);
+    return 0;
+}
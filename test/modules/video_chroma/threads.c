@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * threads.c: slice-threaded chroma conversion test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/libvlc_internal.h"
+
+/*
+ * Converts the same pictures with 1 to N threads, checks that the output does
+ * not depend on the number of threads, and reports the conversion time.
+ *
+ * Run with --bench to average over more frames.
+ */
+
+struct converter
+{
+    const char *module;
+    vlc_fourcc_t in;
+    vlc_fourcc_t out;
+    unsigned width_div; /**< output width divider */
+    unsigned height_div; /**< output height divider */
+};
+
+static const struct converter converters[] = {
+    { "i422_i420",      VLC_CODEC_I422, VLC_CODEC_I420,   1, 1 },
+    { "i420_yuy2",      VLC_CODEC_I420, VLC_CODEC_YUYV,   1, 1 },
+    { "i420_yuy2_sse2", VLC_CODEC_I420, VLC_CODEC_UYVY,   1, 1 },
+    { "i420_rgb",       VLC_CODEC_I420, VLC_CODEC_XRGB,   1, 1 },
+    { "i420_rgb",       VLC_CODEC_I420, VLC_CODEC_RGB233, 1, 1 },
+    { "i420_rgb",       VLC_CODEC_I420, VLC_CODEC_RGB565, 2, 1 },
+    { "i420_rgb_sse2",  VLC_CODEC_I420, VLC_CODEC_RGB565, 1, 1 },
+    { "i420_rgb_sse2",  VLC_CODEC_I420, VLC_CODEC_BGRX,   1, 1 },
+    { "i420_rgb_sse2",  VLC_CODEC_I420, VLC_CODEC_BGRX,   2, 2 },
+};
+
+static const struct
+{
+    unsigned width;
+    unsigned height;
+} sizes[] = {
+    { 1920, 1080 },
+    { 3840, 2160 },
+};
+
+static void FillPicture(picture_t *pic)
+{
+    uint32_t seed = 0x12345678;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = (seed >> 16) + x + y;
+            }
+    }
+}
+
+static uint64_t HashPicture(const picture_t *pic)
+{
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+            for (int x = 0; x < p->i_visible_pitch; x++)
+            {
+                hash ^= p->p_pixels[y * p->i_pitch + x];
+                hash *= UINT64_C(0x100000001b3);
+            }
+    }
+    return hash;
+}
+
+static filter_t *CreateConverter(vlc_object_t *obj, const struct converter *c,
+                                 unsigned width, unsigned height)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, c->in);
+    video_format_Setup(&filter->fmt_in.video, c->in, width, height,
+                       width, height, 1, 1);
+    es_format_Init(&filter->fmt_out, VIDEO_ES, c->out);
+    video_format_Setup(&filter->fmt_out.video, c->out,
+                       width / c->width_div, height / c->height_div,
+                       width / c->width_div, height / c->height_div, 1, 1);
+
+    if (vlc_filter_LoadModule(filter, "video converter", c->module,
+                              true) == NULL)
+    {
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteConverter(filter_t *filter)
+{
+    vlc_filter_UnloadModule(filter);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+/* Returns the average conversion time, and the hash of the last output */
+static vlc_tick_t Run(vlc_object_t *obj, const struct converter *c,
+                      picture_t *src, unsigned threads, unsigned frames,
+                      uint64_t *hash)
+{
+    var_SetInteger(obj, "chroma-threads", threads);
+
+    filter_t *filter = CreateConverter(obj, c, src->format.i_width,
+                                       src->format.i_height);
+    if (filter == NULL)
+        return VLC_TICK_INVALID;
+
+    picture_t *dst = NULL;
+    vlc_tick_t start = 0;
+
+    /* The first frame warms the caches and starts the threads up */
+    for (unsigned i = 0; i <= frames; i++)
+    {
+        if (i == 1)
+            start = vlc_tick_now();
+        if (dst != NULL)
+            picture_Release(dst);
+        dst = filter->ops->filter_video(filter, picture_Hold(src));
+        assert(dst != NULL);
+    }
+
+    vlc_tick_t duration = (vlc_tick_now() - start) / frames;
+
+    *hash = HashPicture(dst);
+    picture_Release(dst);
+    DeleteConverter(filter);
+    return duration;
+}
+
+static void Bench(vlc_object_t *obj, const struct converter *c,
+                  unsigned width, unsigned height, unsigned max_threads,
+                  unsigned frames)
+{
+    picture_t *src = picture_New(c->in, width, height, 1, 1);
+    assert(src != NULL);
+    FillPicture(src);
+
+    uint64_t ref_hash;
+    vlc_tick_t ref = Run(obj, c, src, 1, frames, &ref_hash);
+
+    if (ref == VLC_TICK_INVALID)
+    {
+        printf("%-14s %4.4s -> %4.4s: not available\n", c->module,
+               (const char *)&c->in, (const char *)&c->out);
+        picture_Release(src);
+        return;
+    }
+
+    for (unsigned threads = 1; threads <= max_threads; threads++)
+    {
+        uint64_t hash = ref_hash;
+        vlc_tick_t duration = threads > 1
+            ? Run(obj, c, src, threads, frames, &hash) : ref;
+
+        printf("%-14s %4.4s -> %4.4s %4ux%-4u -> %4ux%-4u %2u threads: "
+               "%7.2f ms/frame (x%.2f)\n", c->module,
+               (const char *)&c->in, (const char *)&c->out, width, height,
+               width / c->width_div, height / c->height_div, threads,
+               (double)duration / VLC_TICK_FROM_MS(1),
+               (double)ref / duration);
+        /* The output does not depend on the number of threads */
+        assert(hash == ref_hash);
+    }
+
+    picture_Release(src);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *const args[] = {
+        "-v", "--vout=vdummy", "--aout=adummy", "--text-renderer=tdummy",
+    };
+    const bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+    unsigned frames = bench ? 20 : 2;
+    unsigned max_threads = vlc_GetCPUCount();
+
+    /* Check the determinism even on a single CPU */
+    if (max_threads < 2)
+        max_threads = 2;
+    if (bench && argc > 2)
+        max_threads = atoi(argv[2]);
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    var_Create(obj, "chroma-threads", VLC_VAR_INTEGER);
+
+    for (size_t i = 0; i < ARRAY_SIZE(converters); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(sizes); j++)
+            Bench(obj, &converters[i], sizes[j].width, sizes[j].height,
+                  max_threads, frames);
+
+    libvlc_release(vlc);
+    return 0;
+}
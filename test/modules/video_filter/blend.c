@@ -0,0 +1,303 @@
+/*****************************************************************************
+ * blend.c: video blending test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../lib/libvlc_internal.h"
+
+/*
+ * Blends subpictures onto pictures with the blend module, forcing each of
+ * its kernels that the CPU supports in turn, and compares the result with a
+ * plain implementation of the blending.
+ */
+
+static const struct
+{
+    const char *name;
+    unsigned cpu; /* required CPU capabilities */
+} kernels[] = {
+    { "c", 0 },
+#if defined (__i386__) || defined (__x86_64__)
+    { "sse4.1", VLC_CPU_SSE4_1 },
+    { "avx2", VLC_CPU_AVX2 },
+#endif
+};
+
+static const vlc_fourcc_t dst_chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_NV12, VLC_CODEC_P010,
+};
+
+static const vlc_fourcc_t src_chromas[] = {
+    VLC_CODEC_YUVA, VLC_CODEC_RGBA,
+};
+
+static const struct
+{
+    unsigned width;
+    unsigned height;
+    unsigned x;
+    unsigned y;
+} regions[] = {
+    { 1920, 1080,    0,   0 },
+    {  333,   77,    1,   1 },
+    {  600,   41,  101, 998 },
+    {   31,    9, 1900,   3 },
+    { 1023,  200, 1200, 900 }, /* clipped */
+};
+
+static const int alphas[] = { 255, 200, 1 };
+
+static void FillPicture(picture_t *pic, uint32_t seed)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_lines; y++)
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = seed >> 16;
+            }
+    }
+
+    /* Make fully transparent and fully opaque runs */
+    plane_t *a = &pic->p[pic->i_planes - 1];
+    const int pixel_size = pic->format.i_chroma == VLC_CODEC_RGBA ? 4 : 1;
+    for (int y = 0; y < a->i_lines; y += 3)
+        for (int x = 0; x < a->i_pitch / pixel_size; x++)
+            if ((x / 40) % 3 != 2)
+                a->p_pixels[y * a->i_pitch + x * pixel_size + pixel_size - 1] =
+                    (x / 40) % 3 ? 0xff : 0;
+
+    /* Valid P010 samples only use the 10 most significant bits */
+    if (pic->format.i_chroma == VLC_CODEC_P010)
+        for (int i = 0; i < pic->i_planes; i++)
+        {
+            plane_t *p = &pic->p[i];
+
+            for (int y = 0; y < p->i_lines; y++)
+                for (int x = 0; x < p->i_pitch / 2; x++)
+                    ((uint16_t *)&p->p_pixels[y * p->i_pitch])[x] &= 0xffc0;
+        }
+}
+
+static unsigned div255(unsigned v)
+{
+    return ((v >> 8) + v + 1) >> 8;
+}
+
+static void Merge8(uint8_t *dst, unsigned src, unsigned a)
+{
+    *dst = div255((255 - a) * *dst + src * a);
+}
+
+static void Merge10(uint8_t *dst, unsigned src, unsigned a)
+{
+    uint16_t *p = (uint16_t *)dst;
+
+    *p = div255((255 - a) * (*p >> 6) + (src * 1023 / 255) * a) << 6;
+}
+
+static void MergeSample(picture_t *dst, int plane, unsigned x, unsigned y,
+                        unsigned src, unsigned a)
+{
+    plane_t *p = &dst->p[plane];
+
+    if (dst->format.i_chroma == VLC_CODEC_P010)
+        Merge10(&p->p_pixels[y * p->i_pitch + 2 * x], src, a);
+    else
+        Merge8(&p->p_pixels[y * p->i_pitch + x], src, a);
+}
+
+static void Reference(picture_t *dst, const picture_t *src,
+                      unsigned x0, unsigned y0, unsigned width,
+                      unsigned height, int alpha)
+{
+    for (unsigned y = 0; y < height; y++)
+        for (unsigned x = 0; x < width; x++)
+        {
+            unsigned sy, su, sv, sa;
+
+            if (src->format.i_chroma == VLC_CODEC_RGBA)
+            {
+                const uint8_t *px = &src->p[0].p_pixels[y * src->p[0].i_pitch
+                                                        + 4 * x];
+                int r = px[0], g = px[1], b = px[2];
+
+                sy = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+                su = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+                sv = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+                sa = px[3];
+            }
+            else
+            {
+                sy = src->p[0].p_pixels[y * src->p[0].i_pitch + x];
+                su = src->p[1].p_pixels[y * src->p[1].i_pitch + x];
+                sv = src->p[2].p_pixels[y * src->p[2].i_pitch + x];
+                sa = src->p[3].p_pixels[y * src->p[3].i_pitch + x];
+            }
+
+            const unsigned a = div255(alpha * sa);
+            const unsigned dx = x0 + x, dy = y0 + y;
+
+            if (a == 0)
+                continue;
+
+            MergeSample(dst, 0, dx, dy, sy, a);
+            if (dx % 2 || dy % 2)
+                continue;
+
+            if (dst->format.i_chroma == VLC_CODEC_I420)
+            {
+                MergeSample(dst, 1, dx / 2, dy / 2, su, a);
+                MergeSample(dst, 2, dx / 2, dy / 2, sv, a);
+            }
+            else
+            {
+                MergeSample(dst, 1, dx, dy / 2, su, a);
+                MergeSample(dst, 1, dx + 1, dy / 2, sv, a);
+            }
+        }
+}
+
+static bool ComparePictures(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++)
+        for (int y = 0; y < a->p[i].i_visible_lines; y++)
+            if (memcmp(&a->p[i].p_pixels[y * a->p[i].i_pitch],
+                       &b->p[i].p_pixels[y * b->p[i].i_pitch],
+                       a->p[i].i_visible_pitch))
+                return false;
+    return true;
+}
+
+static bool Test(vlc_object_t *obj, const char *kernel,
+                 vlc_fourcc_t dst_chroma, vlc_fourcc_t src_chroma)
+{
+    picture_t *base = picture_New(dst_chroma, 1920, 1080, 1, 1);
+    assert(base != NULL);
+    FillPicture(base, dst_chroma);
+
+    filter_t *blend = vlc_object_create(obj, sizeof (*blend));
+    assert(blend != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(regions); i++)
+    {
+        picture_t *src = picture_New(src_chroma, regions[i].width,
+                                     regions[i].height, 1, 1);
+        assert(src != NULL);
+        FillPicture(src, src_chroma + i);
+
+        blend->fmt_out.video = base->format;
+        blend->fmt_in.video = src->format;
+        if (blend->p_module == NULL)
+            blend->p_module = vlc_filter_LoadModule(blend, "video blending",
+                                                    "blend", true);
+        if (blend->p_module == NULL)
+        {
+            /* Only the C kernel is always built */
+            assert(strcmp(kernel, "c"));
+            picture_Release(src);
+            vlc_object_delete(blend);
+            picture_Release(base);
+            return false;
+        }
+
+        const unsigned width = __MIN(regions[i].width, 1920 - regions[i].x);
+        const unsigned height = __MIN(regions[i].height, 1080 - regions[i].y);
+
+        for (size_t j = 0; j < ARRAY_SIZE(alphas); j++)
+        {
+            picture_t *out = picture_NewFromFormat(&base->format);
+            picture_t *ref = picture_NewFromFormat(&base->format);
+            assert(out != NULL && ref != NULL);
+            picture_Copy(out, base);
+            picture_Copy(ref, base);
+
+            blend->ops->blend_video(blend, out, src, regions[i].x,
+                                    regions[i].y, alphas[j]);
+            Reference(ref, src, regions[i].x, regions[i].y, width, height,
+                      alphas[j]);
+
+            bool same = ComparePictures(out, ref);
+            printf("%-6s %4.4s <- %4.4s %4ux%-4u at %4u,%-4u alpha %3d: %s\n",
+                   kernel, (const char *)&dst_chroma, (const char *)&src_chroma,
+                   regions[i].width, regions[i].height, regions[i].x,
+                   regions[i].y, alphas[j], same ? "ok" : "MISMATCH");
+            assert(same);
+
+            picture_Release(ref);
+            picture_Release(out);
+        }
+        picture_Release(src);
+    }
+
+    vlc_filter_UnloadModule(blend);
+    vlc_object_delete(blend);
+    picture_Release(base);
+    return true;
+}
+
+int main(void)
+{
+    static const char *const args[] = {
+        "-v", "--vout=vdummy", "--aout=adummy", "--text-renderer=tdummy",
+    };
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    var_Create(obj, "blend-kernel", VLC_VAR_STRING);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if ((vlc_CPU() & kernels[k].cpu) != kernels[k].cpu)
+        {
+            printf("%-6s not supported by the CPU\n", kernels[k].name);
+            continue;
+        }
+
+        var_SetString(obj, "blend-kernel", kernels[k].name);
+        for (size_t i = 0; i < ARRAY_SIZE(dst_chromas); i++)
+            for (size_t j = 0; j < ARRAY_SIZE(src_chromas); j++)
+                if (!Test(obj, kernels[k].name, dst_chromas[i],
+                          src_chromas[j]))
+                    printf("%-6s %4.4s <- %4.4s: not built\n",
+                           kernels[k].name, (const char *)&dst_chromas[i],
+                           (const char *)&src_chromas[j]);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
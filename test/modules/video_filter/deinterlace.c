@@ -0,0 +1,462 @@
+/*****************************************************************************
+ * deinterlace.c: Yadif and BWDIF deinterlacing test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/libvlc_internal.h"
+
+/* The C line filters are the reference of the SIMD ones */
+#include "../../../modules/video_filter/deinterlace/common.h"
+#include "../../../modules/video_filter/deinterlace/yadif.h"
+#include "../../../modules/video_filter/deinterlace/bwdif.h"
+
+/*
+ * Deinterlaces the same frames with the deinterlace module, forcing each of
+ * its line filter kernels that the CPU supports in turn, with 1 to N threads,
+ * and compares the fields with a plain rendering by the C line filters.
+ *
+ * Run with --bench to report the deinterlacing time instead.
+ */
+
+static const struct
+{
+    const char *name;
+    unsigned cpu;
+} kernels[] = {
+    { "c", 0 },
+#if defined (__i386__) || defined (__x86_64__)
+    { "sse2", VLC_CPU_SSE2 },
+    { "ssse3", VLC_CPU_SSSE3 },
+    { "avx2", VLC_CPU_AVX2 },
+#endif
+};
+
+static const char *const modes[] = {
+    "yadif", "yadif2x", "bwdif", "bwdif2x",
+};
+
+static const vlc_fourcc_t chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_I420_10L,
+};
+
+static const struct
+{
+    unsigned width;
+    unsigned height;
+} sizes[] = {
+    { 1920, 1080 },
+    {  722,  483 },
+    {   40,   14 },
+};
+
+#define FRAMES 4
+
+/* Noise, moving edges and still areas, to take all the branches */
+static void FillPicture(picture_t *pic, unsigned frame, unsigned bits)
+{
+    uint32_t seed = 0x12345678 + frame;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        const unsigned width = p->i_visible_pitch / p->i_pixel_pitch;
+
+        for (int y = 0; y < p->i_lines; y++)
+            for (unsigned x = 0; x < (unsigned)p->i_pitch / p->i_pixel_pitch; x++)
+            {
+                unsigned v;
+
+                seed = seed * 1103515245 + 12345;
+                if (x < width / 3)
+                    v = seed >> 16;
+                else if (x < 2 * width / 3)
+                    v = ((x + 4 * frame) / 8 + y / 4) % 2 ? 0xffff : 0x4000;
+                else
+                    v = (x * 3 + y * 7) << 6;
+
+                v >>= 16 - bits;
+                if (p->i_pixel_pitch == 2)
+                    ((uint16_t *)&p->p_pixels[y * p->i_pitch])[x] = v;
+                else
+                    p->p_pixels[y * p->i_pitch + x] = v;
+            }
+    }
+}
+
+static void ReferenceYadif(picture_t *dst, const picture_t *prev,
+                           const picture_t *cur, const picture_t *next,
+                           int field, int parity)
+{
+    for (int n = 0; n < dst->i_planes; n++)
+    {
+        const plane_t *prevp = &prev->p[n], *curp = &cur->p[n];
+        const plane_t *nextp = &next->p[n];
+        plane_t *dstp = &dst->p[n];
+        const int h = dstp->i_visible_lines;
+        const int refs = curp->i_pitch;
+        const int w = dstp->i_visible_pitch / dstp->i_pixel_pitch;
+
+        for (int y = 1; y < h - 1; y++)
+        {
+            if (y % 2 == field)
+                memcpy(&dstp->p_pixels[y * dstp->i_pitch],
+                       &curp->p_pixels[y * refs], dstp->i_visible_pitch);
+            else
+                (dstp->i_pixel_pitch == 2 ? yadif_filter_line_c_16bit
+                                          : yadif_filter_line_c)(
+                    &dstp->p_pixels[y * dstp->i_pitch],
+                    &prevp->p_pixels[y * refs], &curp->p_pixels[y * refs],
+                    &nextp->p_pixels[y * refs], w,
+                    y < h - 2 ? refs : -refs, y > 1 ? -refs : refs,
+                    parity, y >= 2 && y < h - 2 ? 0 : 2);
+        }
+        memcpy(dstp->p_pixels, &dstp->p_pixels[dstp->i_pitch],
+               dstp->i_pitch);
+        memcpy(&dstp->p_pixels[(h - 1) * dstp->i_pitch],
+               &dstp->p_pixels[(h - 2) * dstp->i_pitch], dstp->i_pitch);
+    }
+}
+
+static void ReferenceBwdif(picture_t *dst, const picture_t *prev,
+                           const picture_t *cur, const picture_t *next,
+                           int field, int parity, int clip_max)
+{
+    for (int n = 0; n < dst->i_planes; n++)
+    {
+        const plane_t *prevp = &prev->p[n], *curp = &cur->p[n];
+        const plane_t *nextp = &next->p[n];
+        plane_t *dstp = &dst->p[n];
+        const int h = dstp->i_visible_lines;
+        const int refs = curp->i_pitch;
+        const int w = dstp->i_visible_pitch / dstp->i_pixel_pitch;
+        const bool wide = dstp->i_pixel_pitch == 2;
+
+        for (int y = 0; y < h; y++)
+        {
+            uint8_t *d = &dstp->p_pixels[y * dstp->i_pitch];
+            const uint8_t *p = &prevp->p_pixels[y * refs];
+            const uint8_t *c = &curp->p_pixels[y * refs];
+            const uint8_t *nx = &nextp->p_pixels[y * refs];
+
+            if (y % 2 == field)
+                memcpy(d, c, dstp->i_visible_pitch);
+            else if (y < 4 || y + 5 > h)
+                (wide ? bwdif_filter_edge_c_16bit : bwdif_filter_edge_c)(
+                    d, p, c, nx, w, y + 1 < h ? refs : -refs,
+                    y > 0 ? -refs : refs, 2 * refs, -2 * refs,
+                    parity, clip_max, y >= 2 && y + 3 <= h);
+            else
+                (wide ? bwdif_filter_line_c_16bit : bwdif_filter_line_c)(
+                    d, p, c, nx, w, refs, -refs, 2 * refs, -2 * refs,
+                    3 * refs, -3 * refs, 4 * refs, -4 * refs,
+                    parity, clip_max);
+        }
+    }
+}
+
+static bool ComparePictures(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++)
+        for (int y = 0; y < a->p[i].i_visible_lines; y++)
+            if (memcmp(&a->p[i].p_pixels[y * a->p[i].i_pitch],
+                       &b->p[i].p_pixels[y * b->p[i].i_pitch],
+                       a->p[i].i_visible_pitch))
+                return false;
+    return true;
+}
+
+static filter_t *CreateDeinterlacer(vlc_object_t *obj, const char *mode,
+                                    const video_format_t *fmt,
+                                    unsigned threads)
+{
+    var_SetString(obj, "sout-deinterlace-mode", mode);
+    var_SetInteger(obj, "chroma-threads", threads);
+
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, fmt->i_chroma);
+    video_format_Copy(&filter->fmt_in.video, fmt);
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+
+    filter->p_module = vlc_filter_LoadModule(filter, "video filter",
+                                             "deinterlace", true);
+    if (filter->p_module == NULL)
+    {
+        es_format_Clean(&filter->fmt_in);
+        es_format_Clean(&filter->fmt_out);
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteDeinterlacer(filter_t *filter)
+{
+    vlc_filter_UnloadModule(filter);
+    es_format_Clean(&filter->fmt_in);
+    es_format_Clean(&filter->fmt_out);
+    vlc_object_delete(filter);
+}
+
+/* The fields of the frames with history, rendered by the C line filters */
+#define FIELDS (2 * (FRAMES - 2))
+
+static picture_t **NewReferences(const char *mode, picture_t **in)
+{
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription(in[0]->format.i_chroma);
+    const bool bwdif = !strncmp(mode, "bwdif", 5);
+    const bool double_rate = strstr(mode, "2x") != NULL;
+    picture_t **refs = calloc(FIELDS, sizeof (*refs));
+    assert(refs != NULL);
+
+    for (unsigned k = 2; k < FRAMES; k++)
+        for (unsigned order = 0; order < (double_rate ? 2 : 1); order++)
+        {
+            picture_t *ref = picture_NewFromFormat(&in[k]->format);
+            assert(ref != NULL);
+
+            /* Top field first */
+            if (bwdif)
+                ReferenceBwdif(ref, in[k - 2], in[k - 1], in[k], order,
+                               1 - order, (1 << desc->pixel_bits) - 1);
+            else
+                ReferenceYadif(ref, in[k - 2], in[k - 1], in[k], order,
+                               1 - order);
+            refs[2 * (k - 2) + order] = ref;
+        }
+    return refs;
+}
+
+static void DeleteReferences(picture_t **refs)
+{
+    for (unsigned i = 0; i < FIELDS; i++)
+        if (refs[i] != NULL)
+            picture_Release(refs[i]);
+    free(refs);
+}
+
+/* Returns false if the kernel is not built */
+static bool Test(vlc_object_t *obj, const char *kernel, const char *mode,
+                 picture_t **in, picture_t **refs, unsigned threads)
+{
+    const bool double_rate = strstr(mode, "2x") != NULL;
+    bool same = true;
+
+    filter_t *filter = CreateDeinterlacer(obj, mode, &in[0]->format, threads);
+    if (filter == NULL)
+    {
+        /* Only the C kernel is always built */
+        assert(strcmp(kernel, "c"));
+        return false;
+    }
+
+    for (unsigned k = 0; k < FRAMES; k++)
+    {
+        picture_t *out = filter->ops->filter_video(filter, picture_Hold(in[k]));
+
+        /* The first frames are rendered without history */
+        if (k < 2)
+        {
+            if (out != NULL)
+                picture_Release(out);
+            continue;
+        }
+        assert(out != NULL);
+
+        picture_t *field = out;
+        for (unsigned order = 0; order < (double_rate ? 2 : 1); order++)
+        {
+            assert(field != NULL);
+            same = same && ComparePictures(field, refs[2 * (k - 2) + order]);
+            field = field->p_next;
+        }
+        picture_Release(out);
+    }
+
+    DeleteDeinterlacer(filter);
+
+    printf("%-6s %-8s %4.4s %4ux%-4u %2u threads: %s\n", kernel, mode,
+           (const char *)&in[0]->format.i_chroma, in[0]->format.i_width,
+           in[0]->format.i_height, threads, same ? "ok" : "MISMATCH");
+    assert(same);
+    return true;
+}
+
+static picture_t **NewFrames(vlc_fourcc_t chroma, unsigned width,
+                             unsigned height)
+{
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription(chroma);
+    picture_t **in = malloc(FRAMES * sizeof (*in));
+    assert(in != NULL && desc != NULL);
+
+    for (unsigned k = 0; k < FRAMES; k++)
+    {
+        video_format_t fmt;
+
+        video_format_Init(&fmt, chroma);
+        video_format_Setup(&fmt, chroma, width, height, width, height, 1, 1);
+        fmt.i_frame_rate = 25;
+        fmt.i_frame_rate_base = 1;
+        in[k] = picture_NewFromFormat(&fmt);
+        assert(in[k] != NULL);
+        FillPicture(in[k], k, desc->pixel_bits);
+        in[k]->date = VLC_TICK_0 + k * VLC_TICK_FROM_MS(40);
+        in[k]->b_progressive = false;
+        in[k]->b_top_field_first = true;
+        in[k]->i_nb_fields = 2;
+    }
+    return in;
+}
+
+static void DeleteFrames(picture_t **in)
+{
+    for (unsigned k = 0; k < FRAMES; k++)
+        picture_Release(in[k]);
+    free(in);
+}
+
+static void Bench(vlc_object_t *obj, const char *mode, unsigned max_threads)
+{
+    picture_t **in = NewFrames(VLC_CODEC_I420, 1920, 1080);
+    vlc_tick_t ref = 0;
+
+    for (unsigned threads = 1; threads <= max_threads; threads++)
+    {
+        filter_t *filter = CreateDeinterlacer(obj, mode, &in[0]->format,
+                                              threads);
+        assert(filter != NULL);
+        const unsigned frames = 100;
+        vlc_tick_t start = 0;
+
+        /* The first frames fill the history and start the threads up */
+        for (unsigned i = 0; i < frames + 2; i++)
+        {
+            if (i == 2)
+                start = vlc_tick_now();
+
+            picture_t *pic = picture_Hold(in[i % FRAMES]);
+            pic->date = VLC_TICK_0 + i * VLC_TICK_FROM_MS(40);
+
+            picture_t *out = filter->ops->filter_video(filter, pic);
+            if (out != NULL)
+                picture_Release(out);
+        }
+
+        vlc_tick_t duration = (vlc_tick_now() - start) / frames;
+        if (threads == 1)
+            ref = duration;
+
+        printf("%-8s 1920x1080 %2u threads: %7.2f ms/frame (x%.2f)\n",
+               mode, threads, (double)duration / VLC_TICK_FROM_MS(1),
+               (double)ref / duration);
+        DeleteDeinterlacer(filter);
+    }
+
+    DeleteFrames(in);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *const args[] = {
+        "-v", "--vout=vdummy", "--aout=adummy", "--text-renderer=tdummy",
+    };
+    const bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+    unsigned max_threads = vlc_GetCPUCount();
+
+    /* Check the determinism even on a single CPU */
+    if (max_threads < 2)
+        max_threads = 2;
+    if (bench && argc > 2)
+        max_threads = atoi(argv[2]);
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    var_Create(obj, "sout-deinterlace-mode", VLC_VAR_STRING);
+    var_Create(obj, "chroma-threads", VLC_VAR_INTEGER);
+    var_Create(obj, "deinterlace-kernel", VLC_VAR_STRING);
+
+    if (bench)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(modes); i++)
+            Bench(obj, modes[i], max_threads);
+        libvlc_release(vlc);
+        return 0;
+    }
+
+    bool built[ARRAY_SIZE(kernels)];
+
+    for (size_t l = 0; l < ARRAY_SIZE(kernels); l++)
+    {
+        built[l] = (vlc_CPU() & kernels[l].cpu) == kernels[l].cpu;
+        if (!built[l])
+            printf("%-6s not supported by the CPU\n", kernels[l].name);
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(chromas); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            picture_t **in = NewFrames(chromas[i], sizes[j].width,
+                                       sizes[j].height);
+
+            for (size_t k = 0; k < ARRAY_SIZE(modes); k++)
+            {
+                picture_t **refs = NewReferences(modes[k], in);
+
+                /* Only the C kernel handles high bit depth */
+                for (size_t l = 0; l < (i > 0 ? 1 : ARRAY_SIZE(kernels)); l++)
+                {
+                    var_SetString(obj, "deinterlace-kernel", kernels[l].name);
+                    for (unsigned threads = 1;
+                         built[l] && threads <= max_threads;
+                         threads = threads == 1 ? max_threads : threads + 1)
+                        if (!Test(obj, kernels[l].name, modes[k], in, refs,
+                                  threads))
+                        {
+                            printf("%-6s not built\n", kernels[l].name);
+                            built[l] = false;
+                        }
+                }
+                DeleteReferences(refs);
+            }
+            DeleteFrames(in);
+        }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -54,7 +54,7 @@ libvlc_instance_t *libvlc_create(const struct vlc_run_args *args)
 
     /* Override argc/argv with "--verbose lvl" or "--quiet" depending on the V
      * environment variable */
-    const char *argv[2];
+    const char *argv[2 + args->option_count];
     char verbose[2];
     int argc = args->verbose == 0 ? 1 : 2;
 
@@ -67,6 +67,9 @@ libvlc_instance_t *libvlc_create(const struct vlc_run_args *args)
     else
         argv[0] = "--quiet";
 
+    for (unsigned i = 0; i < args->option_count; i++)
+        argv[argc++] = args->options[i];
+
     libvlc_instance_t *vlc = libvlc_new(argc, argv);
     if (vlc == NULL)
         fprintf(stderr, "Error: cannot initialize LibVLC.\n");
@@ -37,6 +37,10 @@ struct vlc_run_args
 
     /* true to test demux controls */
     bool test_demux_controls;
+
+    /* extra LibVLC command line options */
+    const char *const *options;
+    unsigned option_count;
 };
 
 void vlc_run_args_init(struct vlc_run_args *args);
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * cache.c: plugins cache startup benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_tick.h>
+
+/* Time to first module: from libvlc_new() to the first capability lookup.
+ * The cold runs scan and load every plug-in, then write the cache. The warm
+ * runs use the cache, with and without checking the plug-in files. */
+
+#define RUNS 8
+
+static const char capability[] = "access";
+
+struct lookup_entry
+{
+    int score;
+    char *name;
+};
+
+struct lookup
+{
+    ssize_t count;
+    struct lookup_entry *modules;
+};
+
+/* Modules of equal scores come in any order: sort them by name */
+static int CompareEntry(const void *a, const void *b)
+{
+    const struct lookup_entry *ea = a, *eb = b;
+
+    if (ea->score != eb->score)
+        return (eb->score > ea->score) - (eb->score < ea->score);
+    return strcmp(ea->name, eb->name);
+}
+
+static void LookupClean(struct lookup *lookup)
+{
+    for (ssize_t i = 0; i < lookup->count; i++)
+        free(lookup->modules[i].name);
+    free(lookup->modules);
+}
+
+static vlc_tick_t TimeToFirstModule(const char *extra, struct lookup *lookup)
+{
+    const char *argv[] = {
+        "--ignore-config", extra,
+    };
+    int argc = ARRAY_SIZE(argv) - (extra == NULL);
+    module_t **mods;
+    size_t strict;
+
+    vlc_tick_t start = vlc_tick_now();
+    libvlc_instance_t *vlc = libvlc_new(argc, argv);
+    assert(vlc != NULL);
+
+    ssize_t count = vlc_module_match(capability, NULL, false, &mods, &strict);
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    assert(count >= 0);
+    lookup->count = count;
+    lookup->modules = calloc(count, sizeof (*lookup->modules));
+    assert(lookup->modules != NULL || count == 0);
+    for (ssize_t i = 0; i < count; i++)
+    {
+        if (i > 0) /* by decreasing score */
+            assert(module_get_score(mods[i - 1]) >= module_get_score(mods[i]));
+        lookup->modules[i].score = module_get_score(mods[i]);
+        lookup->modules[i].name = strdup(module_get_object(mods[i]));
+        assert(lookup->modules[i].name != NULL);
+    }
+    qsort(lookup->modules, count, sizeof (*lookup->modules), CompareEntry);
+    free(mods);
+
+    libvlc_release(vlc);
+    return elapsed;
+}
+
+static int CompareTick(const void *a, const void *b)
+{
+    const vlc_tick_t *ta = a, *tb = b;
+    return (*ta > *tb) - (*ta < *tb);
+}
+
+static void Bench(const char *name, const char *extra,
+                  const struct lookup *expected, unsigned runs)
+{
+    vlc_tick_t times[RUNS];
+    struct lookup lookup;
+
+    assert(runs <= RUNS);
+    for (unsigned i = 0; i < runs; i++)
+    {
+        times[i] = TimeToFirstModule(extra, &lookup);
+
+        /* Same modules, whichever way they were found */
+        assert(lookup.count == expected->count);
+        for (ssize_t j = 0; j < lookup.count; j++)
+        {
+            assert(lookup.modules[j].score == expected->modules[j].score);
+            assert(!strcmp(lookup.modules[j].name, expected->modules[j].name));
+        }
+        if (i + 1 < runs)
+            LookupClean(&lookup);
+    }
+    qsort(times, runs, sizeof (*times), CompareTick);
+
+    test_log("%-16s median %7.2f ms, best %7.2f ms (%zd %s modules)\n", name,
+             secf_from_vlc_tick(times[runs / 2]) * 1000.,
+             secf_from_vlc_tick(times[0]) * 1000., lookup.count, capability);
+    LookupClean(&lookup);
+}
+
+int main(void)
+{
+    struct lookup expected;
+
+    test_init();
+
+    /* Make sure that the cache is up to date to start with */
+    TimeToFirstModule("--reset-plugins-cache", &expected);
+
+    Bench("cold", "--reset-plugins-cache", &expected, 3);
+    Bench("warm", NULL, &expected, RUNS);
+    Bench("warm, no scan", "--no-plugins-scan", &expected, RUNS);
+    LookupClean(&expected);
+    return 0;
+}
@@ -0,0 +1,395 @@
+/*****************************************************************************
+ * httpd.c: HTTP server load test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_httpd.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_network.h>
+#include <vlc_tick.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Load test: many keep-alive clients fetch a segment over and over, with a
+ * few requests pipelined on each connection, while some others follow a live
+ * stream. Throughput and the latency distribution of the segment requests are
+ * reported for each number of server threads.
+ *
+ * Usage: test_src_network_httpd [clients [requests per client]] */
+
+#define SEGMENT_SIZE  (64 * 1024)
+#define PIPELINE      2
+#define LIVE_CLIENTS  16
+#define LIVE_BLOCK    (7 * 188)
+
+struct client
+{
+    int fd;
+    bool live;
+    unsigned sent;
+    unsigned done;
+    vlc_tick_t dates[PIPELINE];
+    /* response being received */
+    char head[512];
+    size_t head_len;
+    size_t body_left;
+    bool in_body;
+    size_t received;
+};
+
+struct load
+{
+    unsigned clients;
+    unsigned requests;
+    struct client *tab;
+    vlc_tick_t *latencies;
+    size_t count;
+    uint64_t bytes;
+};
+
+static uint8_t segment[SEGMENT_SIZE];
+
+static int FillSegment(httpd_file_sys_t *sys, httpd_file_t *file,
+                       uint8_t *request, uint8_t **data, size_t *len)
+{
+    (void) sys; (void) file; (void) request;
+
+    *data = malloc(sizeof (segment));
+    if (*data == NULL)
+        return VLC_ENOMEM;
+    memcpy(*data, segment, sizeof (segment));
+    *len = sizeof (segment);
+    return VLC_SUCCESS;
+}
+
+struct live
+{
+    httpd_stream_t *stream;
+    atomic_bool stop;
+};
+
+static void *LiveThread(void *data)
+{
+    struct live *live = data;
+    block_t *block = block_Alloc(LIVE_BLOCK);
+
+    assert(block != NULL);
+    memset(block->p_buffer, 0x47, block->i_buffer);
+    for (vlc_tick_t deadline = vlc_tick_now();
+         !atomic_load(&live->stop); deadline += VLC_TICK_FROM_MS(10))
+    {
+        httpd_StreamSend(live->stream, block);
+        vlc_tick_wait(deadline);
+    }
+    block_Release(block);
+    return NULL;
+}
+
+static int Connect(uint16_t port)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = vlc_socket(AF_INET, SOCK_STREAM, 0, true);
+
+    assert(fd != -1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof (addr))
+     && errno != EINPROGRESS)
+        assert(!"connect");
+    return fd;
+}
+
+static void Send(struct client *c, const char *path)
+{
+    char req[128];
+    int len = snprintf(req, sizeof (req),
+                       "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n", path);
+
+    /* Requests are tiny: they fit in the socket buffer */
+    ssize_t val = send(c->fd, req, len, MSG_NOSIGNAL);
+    assert(val == len);
+}
+
+/* Queues requests until the pipeline is full */
+static void Request(struct load *load, struct client *c)
+{
+    while (c->sent < load->requests && c->sent - c->done < PIPELINE)
+    {
+        c->dates[c->sent % PIPELINE] = vlc_tick_now();
+        Send(c, "/segment");
+        c->sent++;
+    }
+}
+
+/* Parses the received bytes, returns false once the client is finished */
+static bool Receive(struct load *load, struct client *c,
+                    const char *buf, size_t len)
+{
+    load->bytes += len;
+
+    if (c->live)
+    {
+        c->received += len;
+        return true;
+    }
+
+    while (len > 0)
+    {
+        if (c->in_body)
+        {
+            size_t n = __MIN(len, c->body_left);
+
+            buf += n;
+            len -= n;
+            c->body_left -= n;
+            if (c->body_left > 0)
+                continue;
+
+            c->in_body = false;
+            load->latencies[load->count++] =
+                vlc_tick_now() - c->dates[c->done % PIPELINE];
+            if (++c->done == load->requests)
+                return false;
+            Request(load, c);
+            continue;
+        }
+
+        /* Accumulate the header up to the empty line */
+        assert(c->head_len + 1 < sizeof (c->head));
+        c->head[c->head_len++] = *(buf++);
+        len--;
+        if (c->head_len < 4
+         || memcmp(c->head + c->head_len - 4, "\r\n\r\n", 4))
+            continue;
+        c->head[c->head_len] = '\0';
+
+        assert(strncmp(c->head, "HTTP/1.1 200 ", 13) == 0);
+        const char *cl = strcasestr(c->head, "Content-Length:");
+        assert(cl != NULL);
+        c->body_left = strtoul(cl + 15, NULL, 10);
+        assert(c->body_left == SEGMENT_SIZE);
+        assert(strcasestr(c->head, "Connection: close") == NULL);
+        c->head_len = 0;
+        c->in_body = true;
+    }
+    return true;
+}
+
+static int CompareTick(const void *a, const void *b)
+{
+    vlc_tick_t x = *(const vlc_tick_t *)a, y = *(const vlc_tick_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double Percentile(const struct load *load, double p)
+{
+    size_t i = (size_t)(p * (load->count - 1));
+    return MS_FROM_VLC_TICK((double)load->latencies[i]);
+}
+
+static void Run(libvlc_int_t *libvlc, uint16_t port, unsigned threads,
+                unsigned clients, unsigned requests)
+{
+    vlc_object_t *obj = vlc_object_create(libvlc, sizeof (*obj));
+    assert(obj != NULL);
+
+    var_Create(obj, "http-host", VLC_VAR_STRING);
+    var_SetString(obj, "http-host", "127.0.0.1");
+    var_Create(obj, "http-port", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "http-port", port);
+    var_Create(obj, "http-threads", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "http-threads", threads);
+
+    httpd_host_t *host = vlc_http_HostNew(obj);
+    assert(host != NULL);
+    httpd_file_t *file = httpd_FileNew(host, "/segment", "video/mp2t",
+                                       NULL, NULL, FillSegment, NULL);
+    assert(file != NULL);
+
+    struct live live = { .stream = httpd_StreamNew(host, "/live", "video/mp2t",
+                                                   NULL, NULL) };
+    vlc_thread_t live_thread;
+    assert(live.stream != NULL);
+    atomic_init(&live.stop, false);
+    assert(vlc_clone(&live_thread, LiveThread, &live) == 0);
+
+    struct load load = {
+        .clients = clients,
+        .requests = requests,
+        .tab = calloc(clients + LIVE_CLIENTS, sizeof (*load.tab)),
+        .latencies = malloc(clients * requests * sizeof (*load.latencies)),
+    };
+    struct pollfd *ufd = malloc((clients + LIVE_CLIENTS) * sizeof (*ufd));
+    assert(load.tab != NULL && load.latencies != NULL && ufd != NULL);
+
+    for (unsigned i = 0; i < LIVE_CLIENTS; i++)
+    {
+        struct client *c = &load.tab[clients + i];
+
+        c->fd = Connect(port);
+        c->live = true;
+        ufd[clients + i].fd = c->fd;
+        ufd[clients + i].events = POLLOUT;
+    }
+
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < clients; i++)
+    {
+        struct client *c = &load.tab[i];
+
+        c->fd = Connect(port);
+        ufd[i].fd = c->fd;
+        ufd[i].events = POLLOUT;
+    }
+
+    unsigned active = clients;
+    while (active > 0)
+    {
+        int val = poll(ufd, clients + LIVE_CLIENTS, 5000);
+        assert(val > 0);
+
+        for (unsigned i = 0; i < clients + LIVE_CLIENTS; i++)
+        {
+            struct client *c = &load.tab[i];
+
+            if (ufd[i].revents == 0 || ufd[i].fd == -1)
+                continue;
+            assert(!(ufd[i].revents & (POLLERR|POLLNVAL)));
+
+            if (ufd[i].events & POLLOUT)
+            {   /* connected */
+                ufd[i].events = POLLIN;
+                if (c->live)
+                    Send(c, "/live");
+                else
+                    Request(&load, c);
+                continue;
+            }
+
+            char buf[16384];
+            ssize_t len = recv(c->fd, buf, sizeof (buf), 0);
+            if (len < 0 && errno == EAGAIN)
+                continue;
+            assert(len > 0);
+
+            if (!Receive(&load, c, buf, len))
+            {
+                vlc_close(c->fd);
+                ufd[i].fd = -1;
+                active--;
+            }
+        }
+    }
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    double secs = secf_from_vlc_tick(elapsed);
+
+    assert(load.count == (size_t)clients * requests);
+    qsort(load.latencies, load.count, sizeof (*load.latencies), CompareTick);
+
+    size_t live_bytes = 0;
+    for (unsigned i = 0; i < LIVE_CLIENTS; i++)
+    {
+        struct client *c = &load.tab[clients + i];
+
+        /* The live clients got the stream while the server was busy */
+        assert(c->received > 0);
+        live_bytes += c->received;
+    }
+
+    printf("%2u thread(s), %u clients: %8.0f req/s, %7.1f MiB/s, "
+           "latency p50 %6.2f ms, p99 %6.2f ms, p99.9 %6.2f ms, "
+           "max %6.2f ms, live %zu KiB\n", threads, clients,
+           load.count / secs, load.bytes / secs / (1 << 20),
+           Percentile(&load, .5), Percentile(&load, .99),
+           Percentile(&load, .999), Percentile(&load, 1.),
+           live_bytes / 1024);
+
+    atomic_store(&live.stop, true);
+    vlc_join(live_thread, NULL);
+
+    free(ufd);
+    free(load.latencies);
+    /* Drop the stream from under its clients: they get disconnected */
+    httpd_StreamDelete(live.stream);
+    for (unsigned i = 0; i < LIVE_CLIENTS; i++)
+    {
+        struct pollfd pfd = { .fd = load.tab[clients + i].fd, .events = POLLIN };
+        char buf[16384];
+        ssize_t len;
+
+        do
+        {
+            assert(poll(&pfd, 1, 5000) == 1);
+            len = recv(pfd.fd, buf, sizeof (buf), 0);
+        }
+        while (len > 0 || (len < 0 && errno == EAGAIN));
+        assert(len == 0);
+        vlc_close(pfd.fd);
+    }
+    free(load.tab);
+    httpd_FileDelete(file);
+    httpd_HostDelete(host);
+    vlc_object_delete(obj);
+}
+
+int main(int argc, char *argv[])
+{
+    struct rlimit lim;
+    unsigned clients = 1000, requests = 4;
+
+    test_init();
+
+    /* Keep clear of the file descriptor limit: each client takes two */
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur != RLIM_INFINITY
+     && clients > (lim.rlim_cur - 64) / 2 - LIVE_CLIENTS)
+        clients = (lim.rlim_cur - 64) / 2 - LIVE_CLIENTS;
+    if (argc > 1)
+        clients = atoi(argv[1]);
+    if (argc > 2)
+        requests = atoi(argv[2]);
+    assert(clients > 0 && requests > 0);
+
+    for (size_t i = 0; i < sizeof (segment); i++)
+        segment[i] = i;
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    uint16_t port = 20000 + getpid() % 20000;
+    Run(vlc->p_libvlc_int, port, 1, clients, requests);
+    Run(vlc->p_libvlc_int, port + 1, 4, clients, requests);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,269 @@
+/*****************************************************************************
+ * spu_text_cache.c: test for the cache of rendered text regions
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+/* Define a builtin module for mocked parts */
+#define MODULE_NAME test_spu_text_cache
+#undef VLC_DYNAMIC_PLUGIN
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_spu.h>
+#include <vlc_subpicture.h>
+#include <vlc_text_style.h>
+#include <vlc_vout.h>
+
+#include <limits.h>
+#include <string.h>
+
+/* Number of calls to the text renderer */
+static unsigned render_count;
+
+static subpicture_region_t *RenderText(filter_t *filter,
+                                       const subpicture_region_t *region_in,
+                                       const vlc_fourcc_t *chroma_list)
+{
+    (void) filter; (void) chroma_list;
+
+    video_format_t fmt;
+    video_format_Init(&fmt, VLC_CODEC_RGBA);
+    video_format_Setup(&fmt, VLC_CODEC_RGBA, 64, 16, 64, 16, 1, 1);
+
+    subpicture_region_t *region = subpicture_region_New(&fmt);
+    assert(region != NULL);
+
+    /* Draw something depending on the text */
+    const plane_t *p = &region->p_picture->p[0];
+    memset(p->p_pixels, strlen(region_in->p_text->psz_text),
+           p->i_pitch * p->i_lines);
+
+    region->i_x = region_in->i_x;
+    region->i_y = region_in->i_y;
+    region->i_align = region_in->i_align;
+    region->b_absolute = region_in->b_absolute;
+    region->b_in_window = region_in->b_in_window;
+
+    render_count++;
+    return region;
+}
+
+/* Generation of the renderer settings */
+static uint64_t style_generation;
+
+static uint64_t RenderGeneration(filter_t *filter)
+{
+    (void) filter;
+    return style_generation;
+}
+
+static int OpenRenderer(filter_t *filter)
+{
+    static const struct vlc_filter_operations ops = {
+        .render = RenderText,
+        .render_generation = RenderGeneration,
+    };
+    filter->ops = &ops;
+    return VLC_SUCCESS;
+}
+
+/* Number of calls to the scaler */
+static unsigned scale_count;
+
+static picture_t *Convert(filter_t *filter, picture_t *input)
+{
+    picture_t *output = picture_NewFromFormat(&filter->fmt_out.video);
+    assert(output != NULL);
+
+    for (int i = 0; i < output->i_planes; i++)
+        memset(output->p[i].p_pixels, input->p[0].p_pixels[0],
+               output->p[i].i_pitch * output->p[i].i_lines);
+
+    picture_Release(input);
+    scale_count++;
+    return output;
+}
+
+static int OpenConverter(filter_t *filter)
+{
+    static const struct vlc_filter_operations ops = {
+        .filter_video = Convert,
+    };
+    filter->ops = &ops;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_callback_text_renderer(OpenRenderer, 0)
+
+    add_submodule()
+        set_callback_video_converter(OpenConverter, INT_MAX)
+vlc_module_end()
+
+VLC_EXPORT const vlc_plugin_cb vlc_static_modules[] = {
+    VLC_SYMBOL(vlc_entry),
+    NULL
+};
+
+static void PutText(spu_t *spu, const char *text, uint32_t color)
+{
+    subpicture_t *subpic = subpicture_New(NULL);
+    assert(subpic != NULL);
+
+    subpic->i_channel = VOUT_SPU_CHANNEL_OSD;
+    subpic->i_start = vlc_tick_now();
+    subpic->i_stop = subpic->i_start + VLC_TICK_FROM_SEC(60);
+
+    subpicture_region_t *region = subpicture_region_NewText();
+    assert(region != NULL);
+    region->p_text = text_segment_New(text);
+    assert(region->p_text != NULL);
+    region->p_text->style = text_style_Create(STYLE_NO_DEFAULTS);
+    assert(region->p_text->style != NULL);
+    region->p_text->style->i_font_color = color;
+    region->p_text->style->i_features |= STYLE_HAS_FONT_COLOR;
+    region->i_x = region->i_y = 0;
+    region->i_align = SUBPICTURE_ALIGN_BOTTOM;
+    vlc_spu_regions_push(&subpic->regions, region);
+
+    spu_PutSubpicture(spu, subpic);
+}
+
+static void Render(spu_t *spu, unsigned src_size, unsigned dst_size)
+{
+    video_format_t fmt_src, fmt_dst;
+    video_format_Init(&fmt_src, VLC_CODEC_I420);
+    video_format_Setup(&fmt_src, VLC_CODEC_I420, src_size, src_size,
+                       src_size, src_size, 1, 1);
+    video_format_Init(&fmt_dst, VLC_CODEC_RGBA);
+    video_format_Setup(&fmt_dst, VLC_CODEC_RGBA, dst_size, dst_size,
+                       dst_size, dst_size, 1, 1);
+
+    const vlc_tick_t now = vlc_tick_now();
+    vlc_render_subpicture *render =
+        spu_Render(spu, NULL, &fmt_dst, &fmt_src, false, NULL, now, now,
+                   false);
+    assert(render != NULL);
+    assert(render->regions.size == 1);
+    vlc_render_subpicture_Delete(render);
+
+    video_format_Clean(&fmt_dst);
+    video_format_Clean(&fmt_src);
+}
+
+static void test_spu_text_cache(vlc_object_t *root)
+{
+    spu_t *spu = spu_Create(root, NULL);
+    assert(spu != NULL);
+
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 480, 480);
+    assert(render_count == 1 && scale_count == 0);
+
+    /* Same text in a new subpicture, rendered to a larger size */
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 480, 960);
+    assert(render_count == 1 && scale_count == 1);
+
+    /* Once more, reusing the scaled picture */
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 480, 960);
+    assert(render_count == 1 && scale_count == 1);
+
+    /* Different text */
+    PutText(spu, "other text", 0xffffff);
+    Render(spu, 480, 480);
+    assert(render_count == 2);
+
+    /* Different style */
+    PutText(spu, "text", 0xff0000);
+    Render(spu, 480, 480);
+    assert(render_count == 3);
+
+    /* All of them are still cached */
+    PutText(spu, "other text", 0xffffff);
+    Render(spu, 480, 480);
+    PutText(spu, "text", 0xff0000);
+    Render(spu, 480, 480);
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 480, 480);
+    assert(render_count == 3);
+
+    /* Different text rendering size (set it before the next subpicture,
+     * which may be prerendered as soon as it is queued) */
+    Render(spu, 720, 720);
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 720, 720);
+    assert(render_count == 4);
+
+    /* Older entries are dropped once the cache is full */
+    for (unsigned i = 0; i < 64; i++)
+    {
+        char text[16];
+        snprintf(text, sizeof (text), "line %u", i);
+        PutText(spu, text, 0xffffff);
+        Render(spu, 480, 480);
+    }
+    assert(render_count == 68);
+
+    PutText(spu, "line 63", 0xffffff);
+    Render(spu, 480, 480);
+    assert(render_count == 68);
+
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 480, 480);
+    assert(render_count == 69);
+
+    /* The renderer settings changed */
+    style_generation++;
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 480, 480);
+    assert(render_count == 70);
+
+    PutText(spu, "text", 0xffffff);
+    Render(spu, 480, 480);
+    assert(render_count == 70);
+
+    spu_Destroy(spu);
+}
+
+int main( int argc, char **argv )
+{
+    (void)argc; (void)argv;
+    test_init();
+
+    const char * const vlc_argv[] = {
+        "-vvv", "--aout=dummy", "--text-renderer=" MODULE_STRING,
+    };
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(vlc_argv), vlc_argv);
+    assert(vlc != NULL);
+    vlc_object_t *root = &vlc->p_libvlc_int->obj;
+
+    test_spu_text_cache(root);
+
+    libvlc_release(vlc);
+    return 0;
+}
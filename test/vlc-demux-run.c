@@ -29,8 +29,49 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include "src/input/demux-run.h"
 
+/* Demuxes the whole file several times with read() and with memory-mapped
+ * file access, and reports the best throughput of each. */
+static int bench(struct vlc_run_args *args, const char *filename, int runs)
+{
+    static const char *const modes[] = { "--no-file-mmap", "--file-mmap" };
+    struct stat st;
+
+    if (stat(filename, &st))
+    {
+        perror(filename);
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof (modes) / sizeof (modes[0]); i++)
+    {
+        int64_t best = INT64_MAX;
+
+        args->options = &modes[i];
+        args->option_count = 1;
+
+        /* One run to warm up the page cache, then the timed runs */
+        for (int run = 0; run <= runs; run++)
+        {
+            int64_t start = libvlc_clock();
+
+            if (vlc_demux_process_path(args, filename))
+                return 1;
+
+            int64_t elapsed = libvlc_clock() - start;
+            if (run > 0 && elapsed < best)
+                best = elapsed;
+        }
+
+        printf("%-15s %8.1f MiB/s (%lld us)\n", modes[i] + 2,
+               (double)st.st_size / (1 << 20) / best * 1e6, (long long)best);
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     const char *filename;
@@ -43,9 +84,14 @@ int main(int argc, char *argv[])
             filename = argv[argc - 1];
             break;
         default:
-            fprintf(stderr, "Usage: [VLC_TARGET=demux] %s <filename>\n", argv[0]);
+            fprintf(stderr, "Usage: [VLC_TARGET=demux] [VLC_DEMUX_BENCH=runs] "
+                            "%s <filename>\n", argv[0]);
             return 1;
     }
 
+    const char *runs = getenv("VLC_DEMUX_BENCH");
+    if (runs != NULL && atoi(runs) > 0)
+        return bench(&args, filename, atoi(runs));
+
     return -vlc_demux_process_path(&args, filename);
 }